@@ -88,6 +88,10 @@ typedef struct Address
 	 */
 	Coordinate *ad_gps_south_west_p;
 
+	/**
+	 * A pointer to the elevation, in metres, of this Address.
+	 * This can be <code>NULL</code> if it has not yet been calculated
+	 */
 	double64 *ad_elevation_p;
 } Address;
 
@@ -370,6 +374,20 @@ GRASSROOTS_GEOCODER_API bool SetAddressNorthEastCoordinate (Address *address_p,
 GRASSROOTS_GEOCODER_API bool SetAddressSouthWestCoordinate (Address *address_p, const double64 latitude, const double64 longitude, const double64 *elevation_p);
 
 
+/**
+ * Copy the centre Coordinate and, if they are set, the bounds of one
+ * Address to another.
+ *
+ * @param dest_p The Address to copy the location to.
+ * @param src_p The Address to copy the location from.
+ * @return <code>true</code> if src_p has a centre Coordinate and the
+ * location was copied successfully, <code>false</code> otherwise.
+ * @memberof Address
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool CopyAddressLocation (Address *dest_p, const Address *src_p);
+
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,123 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * address_bounds.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * Checks of user-entered GPS Coordinates against the bounds that the
+ * geocoding services have given for an Address, so that rows whose
+ * location disagrees with their stated town can be found without
+ * geocoding them again.
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_ADDRESS_BOUNDS_H_
+#define LIBS_GEOCODER_INCLUDE_ADDRESS_BOUNDS_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "address.h"
+#include "fixed_coordinate.h"
+
+
+/**
+ * The outcomes of checking a Coordinate against the bounds of an Address.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum AddressBoundsCheck
+{
+	/** The Coordinate is within the Address's bounds. */
+	ABC_INSIDE,
+
+	/** The Coordinate is outside of the Address's bounds. */
+	ABC_OUTSIDE,
+
+	/** The Address doesn't have valid bounds to check against. */
+	ABC_NO_BOUNDS,
+
+	/** The Coordinate isn't a valid latitude and longitude. */
+	ABC_INVALID_COORDINATE
+} AddressBoundsCheck;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Get the bounds of an Address from its north-east and south-west Coordinates.
+ *
+ * @param address_p The Address.
+ * @param box_p The FixedBoundingBox to store the bounds in. If the
+ * south-west longitude is greater than the north-east longitude, the
+ * bounds cross the antimeridian.
+ * @return <code>true</code> if the Address has valid bounds, <code>false</code>
+ * if either corner is missing or out of range, or the south-west corner is
+ * north of the north-east corner.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetAddressBoundingBox (const Address *address_p, FixedBoundingBox *box_p);
+
+
+/**
+ * Check whether a Coordinate is within the bounds of an Address.
+ *
+ * @param point_p The Coordinate to check.
+ * @param address_p The Address.
+ * @param tolerance The distance in metres outside of the Address's bounds
+ * that still counts as inside them. Viewports from the geocoding services
+ * can be tight, so a small tolerance avoids flagging points near the edge
+ * of a town.
+ * @return The AddressBoundsCheck for the Coordinate.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API AddressBoundsCheck CheckCoordinateAgainstAddressBounds (const Coordinate *point_p, const Address *address_p, const double64 tolerance);
+
+
+/**
+ * Check a set of Coordinates against the bounds of their Addresses.
+ *
+ * This is intended for validating imported rows in bulk. The corners are
+ * converted to FixedCoordinates a block at a time and then compared with
+ * a branch-free loop that the compiler can vectorise. Consecutive rows
+ * with the same Address, which is common when many plots are in one town,
+ * reuse its bounds.
+ *
+ * @param points_p The Coordinates to check.
+ * @param addresses_pp The Addresses to check each Coordinate against, so
+ * points_p [i] is checked against addresses_pp [i]. A <code>NULL</code> entry
+ * gives ABC_NO_BOUNDS.
+ * @param num_points The number of Coordinates.
+ * @param tolerance The distance in metres outside of each Address's bounds
+ * that still counts as inside them.
+ * @param results_p The array of num_points values to store the AddressBoundsCheck
+ * for each Coordinate in.
+ * @return The number of Coordinates that are outside of their Address's bounds.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API size_t CheckCoordinatesAgainstAddressBounds (const Coordinate *points_p, const Address * const *addresses_pp, const size_t num_points, const double64 tolerance, AddressBoundsCheck *results_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_ADDRESS_BOUNDS_H_ */
@@ -0,0 +1,150 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * address_bson.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_ADDRESS_BSON_H_
+#define LIBS_GEOCODER_INCLUDE_ADDRESS_BSON_H_
+
+#include "bson.h"
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "address.h"
+#include "coordinate.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Get the BSON representation of a Coordinate and add it to a BSON document.
+ *
+ * The sub-document has the same layout as GetCoordinateAsJSON().
+ *
+ * @param coord_p The Coordinate to add. If this is <code>NULL</code> then
+ * nothing is added.
+ * @param dest_p The BSON document to add the Coordinate to.
+ * @param coord_key_s The key to use for the Coordinate.
+ * @return <code>true</code> if the Coordinate was added successfully, <code>false</code> otherwise.
+ * @memberof Coordinate
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddCoordinateToBSON (const Coordinate *coord_p, bson_t *dest_p, const char * const coord_key_s);
+
+
+/**
+ * Set a Coordinate from its BSON representation.
+ *
+ * As with SetCoordinateFromJSON(), the values can be stored as either
+ * numbers or strings.
+ *
+ * @param coord_p The Coordinate to set.
+ * @param coord_bson_p The BSON document to get the values from.
+ * @return <code>true</code> if the Coordinate was set successfully, <code>false</code> otherwise.
+ * @memberof Coordinate
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool SetCoordinateFromBSON (Coordinate *coord_p, const bson_t *coord_bson_p);
+
+
+/**
+ * Store the BSON representation of an Address in a given BSON document.
+ *
+ * This writes the same document as ConvertAddressToJSON() followed by
+ * converting the result to BSON, but without going through jansson.
+ *
+ * @param address_p The Address to get the values from.
+ * @param dest_p The BSON document where the values will be stored.
+ * @return <code>true</code> if the Address was converted successfully, <code>false</code> otherwise.
+ * @memberof Address
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool ConvertAddressToBSON (const Address *address_p, bson_t *dest_p);
+
+
+/**
+ * Get the BSON representation of an Address.
+ *
+ * This calls ConvertAddressToBSON() on a newly-allocated BSON document.
+ *
+ * @param address_p The Address to get the BSON representation for.
+ * @return The BSON representation which should be freed with bson_destroy()
+ * or <code>NULL</code> upon error.
+ * @memberof Address
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bson_t *GetAddressAsBSON (const Address *address_p);
+
+
+/**
+ * Add an array of Addresses to a BSON document.
+ *
+ * Each element has the same layout as GetAddressAsBSON().
+ *
+ * @param addresses_pp The Addresses to add.
+ * @param num_addresses The number of Addresses.
+ * @param dest_p The BSON document to add the array to.
+ * @param key_s The key to use for the array.
+ * @return <code>true</code> if all of the Addresses were added successfully, <code>false</code> otherwise.
+ * @memberof Address
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddAddressesToBSONArray (const Address * const *addresses_pp, const size_t num_addresses, bson_t *dest_p, const char * const key_s);
+
+
+/**
+ * Fill in an Address from its BSON representation.
+ *
+ * Any existing values in the Address are replaced and its Coordinates
+ * are reused where possible.
+ *
+ * @param address_p The Address to fill in.
+ * @param address_bson_p The BSON representation of the Address.
+ * @return <code>true</code> if the document has a schema.org PostalAddress
+ * and was read successfully, <code>false</code> otherwise.
+ * @memberof Address
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool SetAddressFromBSON (Address *address_p, const bson_t *address_bson_p);
+
+
+/**
+ * Get a new Address from its BSON representation.
+ *
+ * This is the BSON equivalent of GetAddressFromJSON().
+ *
+ * @param address_bson_p The BSON representation of the Address to create.
+ * @return The newly-allocated Address or <code>NULL</code> upon error.
+ * @memberof Address
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API Address *GetAddressFromBSON (const bson_t *address_bson_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_ADDRESS_BSON_H_ */
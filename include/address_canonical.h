@@ -0,0 +1,245 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * address_canonical.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * A canonical form of an Address and a fingerprint of it, so that Addresses
+ * which only differ in how they are written, e.g. "12 High St., St Albans"
+ * and "12 HIGH STREET, SAINT ALBANS", can be recognised as the same for
+ * caching and removing duplicates.
+ *
+ * Each value is canonicalised by:
+ *
+ * - Case-folding it, which covers the Latin, Greek and Cyrillic alphabets.
+ * - Removing apostrophes and replacing any other punctuation with spaces.
+ * - Collapsing runs of whitespace to a single space and trimming the ends.
+ * - Expanding common abbreviations such as "rd" to "road". "st" becomes
+ * "street" when it is the last word of a value and "saint" anywhere else.
+ *
+ * Postcodes have all of their spaces removed too and aren't expanded, and
+ * the country is replaced by its ISO 3166-1 alpha-2 code when it is known.
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_ADDRESS_CANONICAL_H_
+#define LIBS_GEOCODER_INCLUDE_ADDRESS_CANONICAL_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "address.h"
+
+
+/**
+ * The space available for all of the components of a CanonicalAddress,
+ * including a terminating <code>NULL</code> for each one.
+ *
+ * @ingroup geocoder_library
+ */
+#define CANONICAL_ADDRESS_BUFFER_SIZE (1024)
+
+
+/**
+ * The values in a CanonicalAddress.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum
+{
+	/** The Address's name. */
+	CAC_NAME,
+
+	/** The Address's street. */
+	CAC_STREET,
+
+	/** The Address's town. */
+	CAC_TOWN,
+
+	/** The Address's county. */
+	CAC_COUNTY,
+
+	/** The Address's postcode. */
+	CAC_POSTCODE,
+
+	/**
+	 * The Address's country code or, if this isn't set and the country's
+	 * name isn't known, its canonical country name.
+	 */
+	CAC_COUNTRY,
+
+	/** The number of components. */
+	CAC_NUM_COMPONENTS
+} CanonicalAddressComponent;
+
+
+/**
+ * The canonical form of an Address.
+ *
+ * This doesn't use any heap memory so can be declared on the stack.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct CanonicalAddress
+{
+	/**
+	 * @private
+	 *
+	 * The components, in the order of CanonicalAddressComponent, each
+	 * followed by a <code>NULL</code>. Missing components are empty.
+	 */
+	char ca_buffer_s [CANONICAL_ADDRESS_BUFFER_SIZE];
+
+	/** @private */
+	uint16 ca_offsets [CAC_NUM_COMPONENTS];
+
+	/** @private */
+	uint16 ca_length;
+} CanonicalAddress;
+
+
+/**
+ * A 128-bit fingerprint of a CanonicalAddress.
+ *
+ * Either half can be used on its own as a 64-bit fingerprint.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AddressFingerprint
+{
+	/** The first 64 bits of the fingerprint. */
+	uint64 af_high;
+
+	/** The last 64 bits of the fingerprint. */
+	uint64 af_low;
+} AddressFingerprint;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Get the canonical form of a single value.
+ *
+ * @param value_s The value to canonicalise.
+ * @param buffer_s The buffer to write the <code>NULL</code>-terminated
+ * canonical value to.
+ * @param buffer_size The size of buffer_s.
+ * @return <code>true</code> if the value was canonicalised successfully,
+ * <code>false</code> if it was too long for the buffer.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool CanonicaliseAddressValue (const char *value_s, char *buffer_s, const size_t buffer_size);
+
+
+/**
+ * Get the ISO 3166-1 alpha-2 code for a country given its name, one of
+ * its common names such as "UK" or "England", or its code, ignoring case,
+ * punctuation and spacing.
+ *
+ * @param country_s The country.
+ * @return The upper case code or <code>NULL</code> if the country isn't known.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API const char *GetCanonicalCountryCode (const char *country_s);
+
+
+/**
+ * Get the canonical form of an Address.
+ *
+ * @param address_p The Address to canonicalise.
+ * @param canonical_p The CanonicalAddress to store the canonical values in.
+ * @return <code>true</code> if the Address was canonicalised successfully,
+ * <code>false</code> if its values were too long to fit in CANONICAL_ADDRESS_BUFFER_SIZE.
+ * @memberof CanonicalAddress
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool CanonicaliseAddress (const Address *address_p, CanonicalAddress *canonical_p);
+
+
+/**
+ * Get one of the values of a CanonicalAddress.
+ *
+ * @param canonical_p The CanonicalAddress.
+ * @param component The value to get.
+ * @return The value, which is an empty string if the Address didn't have it.
+ * This is only valid for as long as the CanonicalAddress.
+ * @memberof CanonicalAddress
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API const char *GetCanonicalAddressComponent (const CanonicalAddress *canonical_p, const CanonicalAddressComponent component);
+
+
+/**
+ * Get the fingerprint of a CanonicalAddress. This is a MurmurHash3
+ * of all of its values, so equal CanonicalAddresses always have the same
+ * fingerprint and different ones almost certainly won't.
+ *
+ * @param canonical_p The CanonicalAddress.
+ * @param fingerprint_p Where to store the fingerprint.
+ * @memberof CanonicalAddress
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void GetCanonicalAddressFingerprint (const CanonicalAddress *canonical_p, AddressFingerprint *fingerprint_p);
+
+
+/**
+ * Canonicalise an Address and get its fingerprint.
+ *
+ * @param address_p The Address.
+ * @param fingerprint_p Where to store the fingerprint.
+ * @return <code>true</code> if the fingerprint was calculated successfully,
+ * <code>false</code> if the Address's values were too long to canonicalise.
+ * @memberof Address
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetAddressFingerprint (const Address *address_p, AddressFingerprint *fingerprint_p);
+
+
+/**
+ * Get the fingerprints of a set of Addresses.
+ *
+ * @param addresses_pp The Addresses.
+ * @param num_addresses The number of Addresses.
+ * @param fingerprints_p The array of num_addresses AddressFingerprints to
+ * store the fingerprints in. Any Address that can't be canonicalised gets
+ * a fingerprint of all zeros.
+ * @return The number of fingerprints that were calculated successfully.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API size_t GetAddressFingerprints (const Address * const *addresses_pp, const size_t num_addresses, AddressFingerprint *fingerprints_p);
+
+
+/**
+ * Check whether two AddressFingerprints are the same.
+ *
+ * @param fingerprint0_p The first AddressFingerprint.
+ * @param fingerprint1_p The second AddressFingerprint.
+ * @return <code>true</code> if they are the same, <code>false</code> otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AreAddressFingerprintsEqual (const AddressFingerprint *fingerprint0_p, const AddressFingerprint *fingerprint1_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_ADDRESS_CANONICAL_H_ */
@@ -0,0 +1,283 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * address_index.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * An R-tree over a set of Addresses for nearest neighbour, radius
+ * and bounding box queries.
+ *
+ * Each Address is indexed by its extent, which covers its centre and
+ * its north-east and south-west bounds, and by its centre, which is
+ * its centre Coordinate if it has one and the middle of its bounds
+ * otherwise. Box queries match against the extent and distance queries
+ * measure the great-circle distance to the centre.
+ *
+ * The index does not take ownership of the Addresses so they must
+ * remain valid and unchanged for as long as the index is used.
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_ADDRESS_INDEX_H_
+#define LIBS_GEOCODER_INCLUDE_ADDRESS_INDEX_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "address.h"
+#include "fixed_coordinate.h"
+
+
+/**
+ * The maximum number of children of each node in an AddressIndex.
+ *
+ * @ingroup geocoder_library
+ */
+#define ADDRESS_INDEX_NODE_CAPACITY (16)
+
+
+/**
+ * A node in an AddressIndex.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AddressIndexNode
+{
+	/**
+	 * The extents of the children. There is room for one more than
+	 * ADDRESS_INDEX_NODE_CAPACITY so that a full node can take
+	 * a new child before it is split.
+	 */
+	FixedBoundingBox ain_boxes [ADDRESS_INDEX_NODE_CAPACITY + 1];
+
+	/**
+	 * The indexes of the children. For leaf nodes these are in
+	 * AddressIndex::ai_entries_p and otherwise they are in
+	 * AddressIndex::ai_nodes_p.
+	 */
+	uint32 ain_children [ADDRESS_INDEX_NODE_CAPACITY + 1];
+
+	/** The number of children. */
+	uint32 ain_num_children;
+
+	/** The height of this node above the leaves, which are at level 0. */
+	uint32 ain_level;
+} AddressIndexNode;
+
+
+/**
+ * An Address stored in an AddressIndex.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AddressIndexEntry
+{
+	/** The Address. */
+	const Address *aie_address_p;
+
+	/** The point used for distance queries. */
+	FixedCoordinate aie_centre;
+
+	/**
+	 * aie_centre as a point on the unit sphere. Distances are
+	 * ranked by the straight line distance between these which
+	 * needs no trigonometry.
+	 */
+	double64 aie_position [3];
+} AddressIndexEntry;
+
+
+/**
+ * A spatial index over a set of Addresses.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AddressIndex
+{
+	/** The nodes of the tree. */
+	AddressIndexNode *ai_nodes_p;
+
+	/** The number of nodes in use. */
+	uint32 ai_num_nodes;
+
+	/** The number of nodes that ai_nodes_p has room for. */
+	uint32 ai_nodes_capacity;
+
+	/** The index of the root node in ai_nodes_p. */
+	uint32 ai_root;
+
+	/** The indexed Addresses. */
+	AddressIndexEntry *ai_entries_p;
+
+	/** The number of indexed Addresses. */
+	uint32 ai_num_entries;
+
+	/** The number of entries that ai_entries_p has room for. */
+	uint32 ai_entries_capacity;
+} AddressIndex;
+
+
+/**
+ * A match from a distance query on an AddressIndex.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AddressIndexResult
+{
+	/** The Address. */
+	const Address *air_address_p;
+
+	/** The distance in metres from the query point to the Address's centre. */
+	double64 air_distance;
+} AddressIndexResult;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Create an AddressIndex for a set of Addresses.
+ *
+ * The tree is bulk loaded using the Sort-Tile-Recursive algorithm which
+ * gives full nodes that overlap very little. Any Addresses without
+ * valid coordinates are skipped.
+ *
+ * @param addresses_pp The Addresses to index. This can be <code>NULL</code>
+ * if num_addresses is 0.
+ * @param num_addresses The number of Addresses.
+ * @return The new AddressIndex or <code>NULL</code> upon error.
+ * @memberof AddressIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API AddressIndex *AllocateAddressIndex (const Address * const *addresses_pp, const size_t num_addresses);
+
+
+/**
+ * Free an AddressIndex. The indexed Addresses are not freed.
+ *
+ * @param index_p The AddressIndex to free.
+ * @memberof AddressIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void FreeAddressIndex (AddressIndex *index_p);
+
+
+/**
+ * Add an Address to an AddressIndex.
+ *
+ * @param index_p The AddressIndex to add to.
+ * @param address_p The Address to add.
+ * @return <code>true</code> if the Address was added successfully, <code>false</code>
+ * if it has no valid coordinates or memory could not be allocated.
+ * @memberof AddressIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddAddressToIndex (AddressIndex *index_p, const Address *address_p);
+
+
+/**
+ * Get the number of Addresses in an AddressIndex.
+ *
+ * @param index_p The AddressIndex.
+ * @return The number of Addresses.
+ * @memberof AddressIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API size_t GetAddressIndexSize (const AddressIndex *index_p);
+
+
+/**
+ * Find the Addresses whose extents overlap a bounding box.
+ *
+ * @param index_p The AddressIndex to search.
+ * @param box_p The FixedBoundingBox to search within. If its south-west longitude
+ * is greater than its north-east longitude, it is treated as crossing the antimeridian.
+ * @param results_pp The array to store the matching Addresses in.
+ * @param max_results The number of Addresses that results_pp can hold.
+ * @return The total number of matching Addresses, which can be more than max_results.
+ * @memberof AddressIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API size_t FindAddressesInBoundingBox (const AddressIndex *index_p, const FixedBoundingBox *box_p, const Address **results_pp, const size_t max_results);
+
+
+/**
+ * Find the Addresses nearest to a point.
+ *
+ * @param index_p The AddressIndex to search.
+ * @param point_p The point to search from.
+ * @param max_results The maximum number of Addresses to find.
+ * @param results_p The array of at least max_results AddressIndexResults to store
+ * the matches in, nearest first.
+ * @return The number of Addresses found.
+ * @memberof AddressIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API size_t FindNearestAddresses (const AddressIndex *index_p, const Coordinate *point_p, const size_t max_results, AddressIndexResult *results_p);
+
+
+/**
+ * Find the Addresses within a given distance of a point.
+ *
+ * @param index_p The AddressIndex to search.
+ * @param point_p The point to search from.
+ * @param radius The distance in metres.
+ * @param max_results The maximum number of Addresses to find. If there are more
+ * than this within the radius, the nearest ones are returned.
+ * @param results_p The array of at least max_results AddressIndexResults to store
+ * the matches in, nearest first.
+ * @return The number of Addresses found.
+ * @memberof AddressIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API size_t FindAddressesWithinDistance (const AddressIndex *index_p, const Coordinate *point_p, const double64 radius, const size_t max_results, AddressIndexResult *results_p);
+
+
+/**
+ * Find the nearest Addresses to each of a set of points.
+ *
+ * The points are searched in Morton order so that consecutive searches
+ * visit the same parts of the tree, which is quicker than searching for
+ * each point in turn when there are a lot of them.
+ *
+ * @param index_p The AddressIndex to search.
+ * @param points_p The points to search from.
+ * @param num_points The number of points.
+ * @param max_results The maximum number of Addresses to find for each point.
+ * @param radius The maximum distance in metres of any match. Use a negative value
+ * for no limit.
+ * @param results_p The array of num_points * max_results AddressIndexResults to
+ * store the matches in. The matches for points_p [i] start at results_p [i * max_results].
+ * @param num_results_p The array of num_points values to store the number of
+ * matches for each point in.
+ * @return <code>true</code> if the searches were run successfully, <code>false</code>
+ * if any of the points are invalid or memory could not be allocated.
+ * @memberof AddressIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool FindNearestAddressesForCoordinates (const AddressIndex *index_p, const Coordinate *points_p, const size_t num_points, const size_t max_results, const double64 radius,
+	AddressIndexResult *results_p, size_t *num_results_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_ADDRESS_INDEX_H_ */
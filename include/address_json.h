@@ -0,0 +1,241 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * address_json.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_ADDRESS_JSON_H_
+#define LIBS_GEOCODER_INCLUDE_ADDRESS_JSON_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "address.h"
+#include "byte_buffer.h"
+
+
+/**
+ * A flag that can be combined with the jansson JSON_* dump flags
+ * to write real numbers using WriteShortestDouble() rather than
+ * printf's "%.17g". The values still convert back to exactly the
+ * same doubles but the output is no longer byte-for-byte the same
+ * as json_dumps().
+ *
+ * @ingroup geocoder_library
+ */
+#define ADDRESS_JSON_SHORTEST_REALS ((size_t) 1 << 30)
+
+
+/**
+ * The layouts that an AddressJSONStream can write.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum
+{
+	/** A single JSON array of Address objects. */
+	AJF_ARRAY,
+
+	/** One Address object per line. */
+	AJF_JSON_LINES
+} AddressJSONFormat;
+
+
+/**
+ * A datatype for writing the JSON for many Addresses to a ByteBuffer
+ * one at a time.
+ *
+ * The ByteBuffer can be flushed and reset between calls so the output
+ * never needs to be held in memory all at once.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AddressJSONStream
+{
+	/** @private */
+	ByteBuffer *ajs_buffer_p;
+
+	/** @private */
+	size_t ajs_flags;
+
+	/** @private */
+	AddressJSONFormat ajs_format;
+
+	/** @private */
+	size_t ajs_num_addresses;
+} AddressJSONStream;
+
+
+/**
+ * The signature of the function called for each Address by
+ * ParseAddressesFromJSONText().
+ *
+ * @param address_p The Address that has just been parsed. This is reused
+ * for the next value so anything that needs to be kept must either be
+ * copied or taken by setting the relevant member to <code>NULL</code>.
+ * @param user_data_p The user data that was passed to ParseAddressesFromJSONText().
+ * @return <code>true</code> to carry on parsing, <code>false</code> to stop.
+ * @ingroup geocoder_library
+ */
+typedef bool (*AddressJSONCallback) (Address *address_p, void *user_data_p);
+
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Write the JSON representation of an Address directly to a ByteBuffer.
+ *
+ * This gives exactly the same output as calling json_dumps() on the
+ * result of GetAddressAsJSON() with the same flags, but without building
+ * a jansson tree. All of the jansson formatting flags are supported apart
+ * from JSON_EMBED and ADDRESS_JSON_SHORTEST_REALS can be used as well.
+ *
+ * @param address_p The Address to write.
+ * @param buffer_p The ByteBuffer to append the JSON to.
+ * @param flags The jansson JSON_* dump flags to use.
+ * @return <code>true</code> if the JSON was written successfully, <code>false</code>
+ * if the Address has a string that is not valid UTF-8, a coordinate that is
+ * not a finite number or upon error.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AppendAddressAsJSONToByteBuffer (const Address *address_p, ByteBuffer *buffer_p, const size_t flags);
+
+
+/**
+ * Write the JSON representation of an Address into a caller-supplied buffer.
+ *
+ * This is the same as AppendAddressAsJSONToByteBuffer() but, like snprintf(),
+ * it writes at most buffer_size bytes including the terminating '\0' and returns
+ * the length that the full output needs.
+ *
+ * @param address_p The Address to write.
+ * @param buffer_s The buffer to write to. This can be <code>NULL</code> if buffer_size is 0.
+ * @param buffer_size The size of buffer_s.
+ * @param flags The jansson JSON_* dump flags to use.
+ * @param length_p Where the length of the full output, not including the
+ * terminating '\0', will be stored. If this is greater than or equal to buffer_size
+ * then the output was truncated.
+ * @return <code>true</code> if the JSON was generated successfully, <code>false</code> otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool WriteAddressAsJSON (const Address *address_p, char *buffer_s, const size_t buffer_size, const size_t flags, size_t *length_p);
+
+
+/**
+ * Start writing the JSON for a number of Addresses.
+ *
+ * @param stream_p The AddressJSONStream to initialise.
+ * @param buffer_p The ByteBuffer to append the JSON to.
+ * @param format The AddressJSONFormat to use.
+ * @param flags The jansson JSON_* dump flags to use. For AJF_JSON_LINES, any
+ * indentation is ignored so that each Address stays on a single line.
+ * @return <code>true</code> if the stream was started successfully, <code>false</code> otherwise.
+ * @memberof AddressJSONStream
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool StartAddressJSONStream (AddressJSONStream *stream_p, ByteBuffer *buffer_p, const AddressJSONFormat format, const size_t flags);
+
+
+/**
+ * Add the JSON for an Address to an AddressJSONStream.
+ *
+ * For AJF_ARRAY, the complete output is the same as calling json_dumps() on a
+ * json array of the results of GetAddressAsJSON().
+ *
+ * @param stream_p The AddressJSONStream to use.
+ * @param address_p The Address to add.
+ * @return <code>true</code> if the Address was added successfully, <code>false</code> otherwise.
+ * @memberof AddressJSONStream
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AppendAddressToJSONStream (AddressJSONStream *stream_p, const Address *address_p);
+
+
+/**
+ * Finish writing the JSON for an AddressJSONStream.
+ *
+ * @param stream_p The AddressJSONStream to finish.
+ * @return <code>true</code> if the stream was finished successfully, <code>false</code> otherwise.
+ * @memberof AddressJSONStream
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool EndAddressJSONStream (AddressJSONStream *stream_p);
+
+
+/**
+ * Fill in an Address from the raw text of a JSON document in the format
+ * written by GetAddressAsJSON().
+ *
+ * This is equivalent to calling GetAddressFromJSON() on the parsed
+ * document, but the text is read in a single pass without building
+ * a jansson tree. Any existing values in the Address are replaced and
+ * its Coordinates are reused where possible.
+ *
+ * @param address_p The Address to fill in.
+ * @param json_s The JSON text.
+ * @param length The length of json_s.
+ * @return <code>true</code> if the document has a schema.org PostalAddress
+ * and was parsed successfully, <code>false</code> otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool SetAddressFromJSONText (Address *address_p, const char *json_s, const size_t length);
+
+
+/**
+ * Create an Address from the raw text of a JSON document.
+ *
+ * @param json_s The JSON text.
+ * @param length The length of json_s.
+ * @return The newly-allocated Address which should be freed with FreeAddress()
+ * or <code>NULL</code> upon error.
+ * @see SetAddressFromJSONText
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API Address *GetAddressFromJSONText (const char *json_s, const size_t length);
+
+
+/**
+ * Parse many Addresses from either a JSON array or a JSON Lines
+ * document, such as a MongoDB export, calling a function for each one.
+ *
+ * A single Address is reused for every value, so no memory is allocated
+ * beyond that needed for the values themselves. Values that are not
+ * valid Addresses are skipped.
+ *
+ * @param json_s The JSON text.
+ * @param length The length of json_s.
+ * @param callback_fn The function to call for each Address.
+ * @param user_data_p Any custom data to pass to callback_fn.
+ * @return The number of Addresses passed to callback_fn or -1 if json_s
+ * is not valid JSON.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API int64 ParseAddressesFromJSONText (const char *json_s, const size_t length, AddressJSONCallback callback_fn, void *user_data_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_ADDRESS_JSON_H_ */
@@ -0,0 +1,433 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * address_record.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * A compact binary format for storing and passing around geocoded
+ * Addresses without converting them to JSON.
+ *
+ * All values are little-endian. A file starts with a 16 byte header:
+ *
+ *   offset  size  value
+ *   0       4     "GGAR"
+ *   4       2     format version, currently ADDRESS_RECORD_VERSION
+ *   6       2     header size in bytes
+ *   8       4     the number of records, or 0 if unknown
+ *   12      4     reserved, set to 0
+ *
+ * which is followed by the records. Each record is:
+ *
+ *   offset  size  value
+ *   0       4     the total size of the record in bytes
+ *   4       2     flags stating which coordinates and elevations are present
+ *   6       2     reserved, set to 0
+ *   8       8     timestamp, in seconds since the Unix epoch
+ *   16      ...   for each of the centre, north-east and south-west points
+ *                 that are present: the latitude and longitude as int32
+ *                 values in units of 1e-7 degrees followed by the elevation,
+ *                 if present, as an int32 number of millimetres
+ *   ...     ...   for each AddressRecordComponent in order: a uint16 length,
+ *                 or 0xFFFF if the component is not set, followed by that
+ *                 many bytes and a terminating '\0'
+ *
+ * Since every string is stored with its terminator, the AddressRecordViews
+ * returned by the readers point straight into the underlying data.
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_ADDRESS_RECORD_H_
+#define LIBS_GEOCODER_INCLUDE_ADDRESS_RECORD_H_
+
+#include <stdio.h>
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "address.h"
+#include "byte_buffer.h"
+#include "mapped_file.h"
+
+
+/**
+ * The current version of the binary record format.
+ *
+ * @ingroup geocoder_library
+ */
+#define ADDRESS_RECORD_VERSION (1)
+
+
+/**
+ * The size, in bytes, of the header at the start of a
+ * binary record file.
+ *
+ * @ingroup geocoder_library
+ */
+#define ADDRESS_RECORD_HEADER_SIZE (16)
+
+
+/**
+ * The string values stored in each record.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum
+{
+	/** The Address's name. */
+	ARC_NAME,
+
+	/** The Address's street. */
+	ARC_STREET,
+
+	/** The Address's town. */
+	ARC_TOWN,
+
+	/** The Address's county. */
+	ARC_COUNTY,
+
+	/** The Address's country. */
+	ARC_COUNTRY,
+
+	/** The Address's postcode. */
+	ARC_POSTCODE,
+
+	/** The Address's country code. */
+	ARC_COUNTRY_CODE,
+
+	/** The Address's raw GPS string. */
+	ARC_GPS,
+
+	/** The name of the geocoder that gave the result, e.g. "nominatim". */
+	ARC_PROVIDER,
+
+	/** Where the result came from, e.g. the request url or a cache name. */
+	ARC_PROVENANCE,
+
+	/** The number of components. */
+	ARC_NUM_COMPONENTS
+} AddressRecordComponent;
+
+
+/**
+ * The points that can be stored in each record.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum
+{
+	/** The centre of the Address. */
+	ARP_CENTRE,
+
+	/** The north-east corner of the Address's bounds. */
+	ARP_NORTH_EAST,
+
+	/** The south-west corner of the Address's bounds. */
+	ARP_SOUTH_WEST,
+
+	/** The number of points. */
+	ARP_NUM_POINTS
+} AddressRecordPoint;
+
+
+/**
+ * A read-only view of a single binary record.
+ *
+ * None of the values are copied, so the view is only valid for
+ * as long as the data that it was read from.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AddressRecordView
+{
+	/**
+	 * The <code>NULL</code>-terminated values for each AddressRecordComponent.
+	 * These are <code>NULL</code> for any that are not set.
+	 */
+	const char *arv_components_ss [ARC_NUM_COMPONENTS];
+
+	/** The lengths of the values in arv_components_ss. */
+	uint16 arv_component_lengths [ARC_NUM_COMPONENTS];
+
+	/** The timestamp, in seconds since the Unix epoch. */
+	int64 arv_timestamp;
+
+	/** @private */
+	uint16 arv_flags;
+
+	/** @private */
+	int32 arv_points [ARP_NUM_POINTS][3];
+} AddressRecordView;
+
+
+/**
+ * A datatype for writing binary records to a file.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AddressRecordWriter
+{
+	/** @private */
+	FILE *arw_out_f;
+
+	/** @private */
+	ByteBuffer *arw_buffer_p;
+
+	/** @private */
+	uint32 arw_num_records;
+} AddressRecordWriter;
+
+
+/**
+ * A memory-mapped binary record file.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AddressRecordFile
+{
+	/** @private */
+	MappedFile arf_file;
+
+	/** @private */
+	uint32 arf_num_records;
+} AddressRecordFile;
+
+
+/**
+ * An iterator over the records in an AddressRecordFile or a buffer.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AddressRecordIterator
+{
+	/** @private */
+	const uint8 *ari_current_p;
+
+	/** @private */
+	const uint8 *ari_end_p;
+
+	/** @private */
+	bool ari_failed_flag;
+} AddressRecordIterator;
+
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Append the binary record file header to a ByteBuffer.
+ *
+ * @param buffer_p The ByteBuffer to append to.
+ * @param num_records The number of records that will follow, or 0 if this is not known.
+ * @return <code>true</code> if the header was appended successfully, <code>false</code> otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AppendAddressRecordHeaderToByteBuffer (ByteBuffer *buffer_p, const uint32 num_records);
+
+
+/**
+ * Append the binary record for an Address to a ByteBuffer.
+ *
+ * @param address_p The Address to append.
+ * @param provider_s The name of the geocoder that gave the result. This can be <code>NULL</code>.
+ * @param provenance_s Where the result came from. This can be <code>NULL</code>.
+ * @param timestamp When the result was made, in seconds since the Unix epoch.
+ * @param buffer_p The ByteBuffer to append to.
+ * @return <code>true</code> if the record was appended successfully, <code>false</code>
+ * if any value is too long or any coordinate is out of range or upon error.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AppendAddressRecordToByteBuffer (const Address *address_p, const char *provider_s, const char *provenance_s, const int64 timestamp, ByteBuffer *buffer_p);
+
+
+/**
+ * Read the binary record at the start of a buffer.
+ *
+ * @param data_p The buffer to read from.
+ * @param length The number of bytes available in data_p.
+ * @param view_p The AddressRecordView to set.
+ * @param record_length_p If this is not <code>NULL</code>, the size of the record will be stored here.
+ * @return <code>true</code> if a valid record was read, <code>false</code> otherwise.
+ * @memberof AddressRecordView
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool ReadAddressRecord (const void *data_p, const size_t length, AddressRecordView *view_p, size_t *record_length_p);
+
+
+/**
+ * Get one of the points from an AddressRecordView.
+ *
+ * @param view_p The AddressRecordView to get the point from.
+ * @param point The point to get.
+ * @param latitude_p Where the latitude, in degrees, will be stored.
+ * @param longitude_p Where the longitude, in degrees, will be stored.
+ * @param elevation_p Where the elevation, in metres, will be stored if it
+ * is present. This can be <code>NULL</code>.
+ * @param has_elevation_p If this is not <code>NULL</code>, whether the point
+ * has an elevation will be stored here.
+ * @return <code>true</code> if the point is present in the record, <code>false</code> otherwise.
+ * @memberof AddressRecordView
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetAddressRecordPoint (const AddressRecordView *view_p, const AddressRecordPoint point, double64 *latitude_p, double64 *longitude_p, double64 *elevation_p, bool *has_elevation_p);
+
+
+/**
+ * Fill in an Address with copies of the values from an AddressRecordView.
+ *
+ * Any existing values in the Address are replaced.
+ *
+ * @param address_p The Address to fill in.
+ * @param view_p The AddressRecordView to copy the values from.
+ * @return <code>true</code> if the Address was filled in successfully, <code>false</code> otherwise.
+ * @memberof AddressRecordView
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool SetAddressFromRecordView (Address *address_p, const AddressRecordView *view_p);
+
+
+/**
+ * Start writing a binary record file.
+ *
+ * @param filename_s The file to write to. Any existing file will be overwritten.
+ * @return The newly-allocated AddressRecordWriter or <code>NULL</code> upon error.
+ * @memberof AddressRecordWriter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API AddressRecordWriter *AllocateAddressRecordWriter (const char *filename_s);
+
+
+/**
+ * Add the binary record for an Address to an AddressRecordWriter.
+ *
+ * @param writer_p The AddressRecordWriter to use.
+ * @param address_p The Address to add.
+ * @param provider_s The name of the geocoder that gave the result. This can be <code>NULL</code>.
+ * @param provenance_s Where the result came from. This can be <code>NULL</code>.
+ * @param timestamp When the result was made, in seconds since the Unix epoch.
+ * @return <code>true</code> if the record was added successfully, <code>false</code> otherwise.
+ * @memberof AddressRecordWriter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddAddressRecord (AddressRecordWriter *writer_p, const Address *address_p, const char *provider_s, const char *provenance_s, const int64 timestamp);
+
+
+/**
+ * Finish writing a binary record file and free the AddressRecordWriter.
+ *
+ * @param writer_p The AddressRecordWriter to close.
+ * @return <code>true</code> if all of the records were written successfully, <code>false</code> otherwise.
+ * @memberof AddressRecordWriter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool CloseAddressRecordWriter (AddressRecordWriter *writer_p);
+
+
+/**
+ * Memory-map a binary record file for reading.
+ *
+ * @param filename_s The file to open.
+ * @return The newly-allocated AddressRecordFile or <code>NULL</code> if the file
+ * could not be mapped, is not a binary record file or is from a newer version
+ * of the format.
+ * @memberof AddressRecordFile
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API AddressRecordFile *OpenAddressRecordFile (const char *filename_s);
+
+
+/**
+ * Unmap and free an AddressRecordFile.
+ *
+ * Any AddressRecordViews from this file must not be used afterwards.
+ *
+ * @param record_file_p The AddressRecordFile to close.
+ * @memberof AddressRecordFile
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void CloseAddressRecordFile (AddressRecordFile *record_file_p);
+
+
+/**
+ * Get the number of records in an AddressRecordFile as stated in its header.
+ *
+ * @param record_file_p The AddressRecordFile to check.
+ * @return The number of records or 0 if this was not known when the file was written.
+ * @memberof AddressRecordFile
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API uint32 GetAddressRecordFileSize (const AddressRecordFile *record_file_p);
+
+
+/**
+ * Start iterating over the records in an AddressRecordFile.
+ *
+ * @param iterator_p The AddressRecordIterator to initialise.
+ * @param record_file_p The AddressRecordFile to iterate over.
+ * @memberof AddressRecordIterator
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void InitAddressRecordIterator (AddressRecordIterator *iterator_p, const AddressRecordFile *record_file_p);
+
+
+/**
+ * Start iterating over the records in a buffer, such as one received
+ * from another process.
+ *
+ * @param iterator_p The AddressRecordIterator to initialise.
+ * @param data_p The records. This must start with the file header.
+ * @param length The length of data_p.
+ * @return <code>true</code> if the header is valid, <code>false</code> otherwise.
+ * @memberof AddressRecordIterator
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool InitAddressRecordBufferIterator (AddressRecordIterator *iterator_p, const void *data_p, const size_t length);
+
+
+/**
+ * Get the next record.
+ *
+ * @param iterator_p The AddressRecordIterator to use.
+ * @param view_p The AddressRecordView to set.
+ * @return <code>true</code> if there was another record, <code>false</code> at the end
+ * of the records or if a record is not valid.
+ * @memberof AddressRecordIterator
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetNextAddressRecord (AddressRecordIterator *iterator_p, AddressRecordView *view_p);
+
+
+/**
+ * Check whether an AddressRecordIterator stopped because of an invalid record
+ * rather than by reaching the end of the data.
+ *
+ * @param iterator_p The AddressRecordIterator to check.
+ * @return <code>true</code> if an invalid record was found, <code>false</code> otherwise.
+ * @memberof AddressRecordIterator
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool HasAddressRecordIteratorFailed (const AddressRecordIterator *iterator_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_ADDRESS_RECORD_H_ */
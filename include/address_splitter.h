@@ -0,0 +1,231 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * address_splitter.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * Split a free-text address, such as "Rothamsted Research, West Common,
+ * Harpenden AL5 2JQ, UK", into the separate fields of an Address so that
+ * the geocoders can be given a structured query.
+ *
+ * This is done entirely offline with rules and dictionaries rather than
+ * a statistical model:
+ *
+ * - The country is found from the end of the text using the country table
+ * along with common names such as "UK" and "USA".
+ * - The postcode is found by matching the words nearest the end against
+ * each country's postcode formats.
+ * - Towns and counties are looked up in an optional AddressSplitter which
+ * holds the names from an AdminRegionIndex, a file of previously geocoded
+ * Addresses or any other source.
+ * - Anything left over is given to the name, street, town and county from
+ * the order of the comma-separated parts of the text.
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_ADDRESS_SPLITTER_H_
+#define LIBS_GEOCODER_INCLUDE_ADDRESS_SPLITTER_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "address.h"
+#include "address_record.h"
+#include "admin_regions.h"
+
+
+/**
+ * A dictionary of known town and county names used by SplitAddressText ().
+ *
+ * Once it has been filled, an AddressSplitter is only read from so it can
+ * be used by several threads at the same time.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AddressSplitter
+{
+	/** @private */
+	struct SplitterPlace *as_places_p;
+
+	/** @private */
+	uint32 as_num_places;
+
+	/** @private */
+	uint32 as_capacity;
+
+	/** @private */
+	uint32 as_max_words;
+} AddressSplitter;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Allocate an empty AddressSplitter.
+ *
+ * @return The AddressSplitter or <code>NULL</code> upon error.
+ * @memberof AddressSplitter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API AddressSplitter *AllocateAddressSplitter (void);
+
+
+/**
+ * Free an AddressSplitter.
+ *
+ * @param splitter_p The AddressSplitter to free.
+ * @memberof AddressSplitter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void FreeAddressSplitter (AddressSplitter *splitter_p);
+
+
+/**
+ * Add a town name to an AddressSplitter.
+ *
+ * @param splitter_p The AddressSplitter to add the name to.
+ * @param town_s The name of the town.
+ * @param country_code_s The code of the town's country. If this is
+ * <code>NULL</code>, the name will be recognised in every country.
+ * @return <code>true</code> if the name was added successfully, <code>false</code>
+ * otherwise.
+ * @memberof AddressSplitter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddTownToAddressSplitter (AddressSplitter *splitter_p, const char *town_s, const char *country_code_s);
+
+
+/**
+ * Add a county, state or province name to an AddressSplitter.
+ *
+ * @param splitter_p The AddressSplitter to add the name to.
+ * @param county_s The name of the county.
+ * @param country_code_s The code of the county's country. If this is
+ * <code>NULL</code>, the name will be recognised in every country.
+ * @return <code>true</code> if the name was added successfully, <code>false</code>
+ * otherwise.
+ * @memberof AddressSplitter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddCountyToAddressSplitter (AddressSplitter *splitter_p, const char *county_s, const char *country_code_s);
+
+
+/**
+ * Add the names of the counties, which are the regions at admin_level 4
+ * to 6, and towns, which are at admin_level 7 and 8, from an
+ * AdminRegionIndex to an AddressSplitter.
+ *
+ * @param splitter_p The AddressSplitter to add the names to.
+ * @param index_p The AdminRegionIndex to get the names from.
+ * @return <code>true</code> if the names were added successfully, <code>false</code>
+ * otherwise.
+ * @memberof AddressSplitter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddAdminRegionsToAddressSplitter (AddressSplitter *splitter_p, const AdminRegionIndex *index_p);
+
+
+/**
+ * Add the town and county names from a file of previously geocoded
+ * Addresses to an AddressSplitter.
+ *
+ * @param splitter_p The AddressSplitter to add the names to.
+ * @param record_file_p The AddressRecordFile to get the names from.
+ * @return <code>true</code> if the names were added successfully, <code>false</code>
+ * otherwise.
+ * @memberof AddressSplitter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddAddressRecordsToAddressSplitter (AddressSplitter *splitter_p, const AddressRecordFile *record_file_p);
+
+
+/**
+ * Split a free-text address into the fields of an Address.
+ *
+ * Only the fields of the Address that are <code>NULL</code> are set, so any
+ * country code that it already has is used to choose the postcode formats
+ * and dictionary entries.
+ *
+ * @param splitter_p The AddressSplitter to look up towns and counties in.
+ * This can be <code>NULL</code> in which case they are chosen from their
+ * positions in the text alone.
+ * @param text_s The free-text address. Its parts should be separated by
+ * commas, semicolons or new lines.
+ * @param address_p The Address to store the values in.
+ * @return <code>true</code> if the text was split successfully, <code>false</code>
+ * if it was empty, had too many words or upon error.
+ * @memberof AddressSplitter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool SplitAddressText (const AddressSplitter *splitter_p, const char *text_s, Address *address_p);
+
+
+/**
+ * Check whether an Address only has a name, which is how free-text
+ * addresses are usually stored.
+ *
+ * @param address_p The Address to check.
+ * @return <code>true</code> if the name is the only field that is set,
+ * <code>false</code> otherwise.
+ * @memberof Address
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool IsFreeTextAddress (const Address *address_p);
+
+
+/**
+ * If an Address only has a name, split it into the Address's fields
+ * with SplitAddressText (). Any part of the name that isn't recognised
+ * as anything else is left as the name.
+ *
+ * @param splitter_p The AddressSplitter to look up towns and counties in.
+ * This can be <code>NULL</code>.
+ * @param address_p The Address to split.
+ * @return <code>true</code> if the Address was split, <code>false</code> if
+ * it isn't a free-text address, couldn't be split or upon error in which
+ * case it is left unchanged.
+ * @memberof AddressSplitter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool SplitAddressName (const AddressSplitter *splitter_p, Address *address_p);
+
+
+/**
+ * Split a batch of free-text Addresses with SplitAddressName ().
+ * Addresses that aren't free-text are left as they are.
+ *
+ * @param splitter_p The AddressSplitter to look up towns and counties in.
+ * This can be <code>NULL</code>.
+ * @param addresses_pp The Addresses to split.
+ * @param num_addresses The number of Addresses.
+ * @param num_threads The number of threads to use, or 0 to use one per processor.
+ * @return The number of Addresses that were split.
+ * @memberof AddressSplitter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API size_t SplitAddressNames (const AddressSplitter *splitter_p, Address **addresses_pp, const size_t num_addresses, const uint32 num_threads);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_ADDRESS_SPLITTER_H_ */
@@ -0,0 +1,267 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * admin_regions.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * An offline index of administrative boundaries, such as countries,
+ * counties and towns, for reverse geocoding without a web service.
+ *
+ * The index is a memory-mapped file holding the simplified boundary
+ * polygons along with a packed R-tree over their bounding boxes. It can
+ * be built from an OpenStreetMap PBF extract with the
+ * admin_region_importer tool.
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_ADMIN_REGIONS_H_
+#define LIBS_GEOCODER_INCLUDE_ADMIN_REGIONS_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "address.h"
+#include "coordinate.h"
+#include "fixed_coordinate.h"
+#include "mapped_file.h"
+
+
+/**
+ * The lowest OpenStreetMap admin_level that is indexed, which is used
+ * for countries.
+ *
+ * @ingroup geocoder_library
+ */
+#define ADMIN_REGION_MIN_LEVEL (2)
+
+
+/**
+ * The highest OpenStreetMap admin_level that is indexed, which is
+ * typically used for towns, cities and civil parishes.
+ *
+ * @ingroup geocoder_library
+ */
+#define ADMIN_REGION_MAX_LEVEL (8)
+
+
+/**
+ * An administrative region to be saved by SaveAdminRegionIndex ().
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AdminRegionData
+{
+	/** The name of the region. */
+	const char *ard_name_s;
+
+	/**
+	 * The ISO 3166-1 alpha-2 code of the region if it is a country.
+	 * This can be <code>NULL</code>.
+	 */
+	const char *ard_country_code_s;
+
+	/** The OpenStreetMap admin_level of the region. */
+	uint32 ard_level;
+
+	/**
+	 * The points of all of the region's rings, one after another. Each
+	 * ring should finish with the same point that it starts with.
+	 */
+	const FixedCoordinate *ard_points_p;
+
+	/** The number of points in each ring. */
+	const uint32 *ard_ring_lengths_p;
+
+	/**
+	 * The number of rings. Outer boundaries and holes are both rings
+	 * and a point is inside the region if it is inside an odd number
+	 * of them.
+	 */
+	uint32 ard_num_rings;
+} AdminRegionData;
+
+
+/**
+ * An administrative region found by FindAdminRegions ().
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AdminRegion
+{
+	/**
+	 * The name of the region. This points into the AdminRegionIndex
+	 * so is only valid until the index is closed.
+	 */
+	const char *ar_name_s;
+
+	/** The ISO 3166-1 alpha-2 code of the region if it is a country, or an empty string. */
+	char ar_country_code_s [3];
+
+	/** The OpenStreetMap admin_level of the region. */
+	uint32 ar_level;
+} AdminRegion;
+
+
+/**
+ * A memory-mapped index of administrative regions.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AdminRegionIndex
+{
+	/** @private */
+	MappedFile ari_file;
+
+	/** @private */
+	uint32 ari_num_regions;
+
+	/** @private */
+	uint32 ari_num_rings;
+
+	/** @private */
+	uint32 ari_num_nodes;
+
+	/** @private */
+	uint32 ari_num_points;
+
+	/** @private */
+	const uint8 *ari_regions_p;
+
+	/** @private */
+	const uint8 *ari_rings_p;
+
+	/** @private */
+	const uint8 *ari_nodes_p;
+
+	/** @private */
+	const uint8 *ari_points_p;
+
+	/** @private */
+	const char *ari_strings_s;
+
+	/** @private */
+	uint32 ari_strings_size;
+} AdminRegionIndex;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Open an AdminRegionIndex file.
+ *
+ * @param filename_s The filename.
+ * @return The AdminRegionIndex or <code>NULL</code> upon error.
+ * @memberof AdminRegionIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API AdminRegionIndex *OpenAdminRegionIndex (const char *filename_s);
+
+
+/**
+ * Close an AdminRegionIndex.
+ *
+ * @param index_p The AdminRegionIndex to close.
+ * @memberof AdminRegionIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void CloseAdminRegionIndex (AdminRegionIndex *index_p);
+
+
+/**
+ * Save a set of administrative regions as an AdminRegionIndex file.
+ *
+ * @param filename_s The filename.
+ * @param regions_p The regions to save.
+ * @param num_regions The number of regions.
+ * @return <code>true</code> if the file was saved successfully, <code>false</code> otherwise.
+ * @memberof AdminRegionIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool SaveAdminRegionIndex (const char *filename_s, const AdminRegionData *regions_p, const size_t num_regions);
+
+
+/**
+ * Find the administrative regions that contain a Coordinate.
+ *
+ * @param index_p The AdminRegionIndex to search.
+ * @param coord_p The Coordinate.
+ * @param regions_p The array to store the regions in, ordered from the
+ * lowest admin_level to the highest.
+ * @param max_regions The number of AdminRegions that regions_p can hold.
+ * If more regions than this contain the Coordinate, those with the highest
+ * admin_levels are left out.
+ * @return The number of regions stored in regions_p.
+ * @memberof AdminRegionIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API uint32 FindAdminRegions (const AdminRegionIndex *index_p, const Coordinate *coord_p, AdminRegion *regions_p, const uint32 max_regions);
+
+
+/**
+ * Get the number of administrative regions in an AdminRegionIndex.
+ *
+ * @param index_p The AdminRegionIndex.
+ * @return The number of regions.
+ * @memberof AdminRegionIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API uint32 GetNumberOfAdminRegions (const AdminRegionIndex *index_p);
+
+
+/**
+ * Get an administrative region from an AdminRegionIndex by its position,
+ * for going through all of the regions.
+ *
+ * @param index_p The AdminRegionIndex.
+ * @param i The position of the region, from 0 to one less than
+ * GetNumberOfAdminRegions ().
+ * @param region_p The AdminRegion to store the region's details in.
+ * @return <code>true</code> if the region was found, <code>false</code> if i
+ * is out of range.
+ * @memberof AdminRegionIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetAdminRegion (const AdminRegionIndex *index_p, const uint32 i, AdminRegion *region_p);
+
+
+/**
+ * Set the country, county and town of an Address from the administrative
+ * regions that contain its centre Coordinate.
+ *
+ * The country comes from admin_level 2, the county from the highest of
+ * levels 4 to 6 and the town from the highest of levels 7 and 8. Any
+ * of these that aren't in the index are left unchanged.
+ *
+ * @param index_p The AdminRegionIndex to search.
+ * @param address_p The Address, which must have its centre Coordinate set.
+ * @return <code>true</code> if any of the Address's values were set, <code>false</code>
+ * otherwise.
+ * @memberof AdminRegionIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool SetAddressFromAdminRegions (const AdminRegionIndex *index_p, Address *address_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_ADMIN_REGIONS_H_ */
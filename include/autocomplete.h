@@ -0,0 +1,412 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * autocomplete.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * As-you-type suggestions for the town, county and country of an Address.
+ *
+ * The values are collected, along with how often each one has been used,
+ * in an AutocompleteBuilder. This is then turned into a read-only
+ * AutocompleteIndex, which is a radix trie stored in flat arrays where
+ * each node also holds the highest count below it, so that the most used
+ * completions of a prefix can be found without visiting every value that
+ * starts with it.
+ *
+ * Values are matched ignoring case, punctuation and repeated spaces.
+ *
+ * An Autocompleter wraps these up for a long-running server, so that new
+ * Addresses can be added and the index rebuilt on a background thread
+ * while other threads carry on using the previous index.
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_AUTOCOMPLETE_H_
+#define LIBS_GEOCODER_INCLUDE_AUTOCOMPLETE_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "address.h"
+#include "address_record.h"
+#include "admin_regions.h"
+
+
+/**
+ * The parts of an Address that suggestions are given for.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum
+{
+	/** The Address's town. */
+	AF_TOWN,
+
+	/** The Address's county. */
+	AF_COUNTY,
+
+	/** The Address's country. */
+	AF_COUNTRY,
+
+	/** The number of fields. */
+	AF_NUM_FIELDS
+} AutocompleteField;
+
+
+/**
+ * A single suggestion from GetAutocompleteSuggestions ().
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AutocompleteSuggestion
+{
+	/**
+	 * The suggested value. This points into the AutocompleteIndex so is
+	 * only valid until the index is freed.
+	 */
+	const char *as_value_s;
+
+	/** The number of times that the value has been used. */
+	uint32 as_count;
+} AutocompleteSuggestion;
+
+
+/**
+ * A set of values and their counts that an AutocompleteIndex can be built from.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AutocompleteBuilder
+{
+	/** @private */
+	struct AutocompleteValue *ab_values_p;
+
+	/** @private */
+	uint32 ab_num_values;
+
+	/** @private */
+	uint32 ab_values_capacity;
+
+	/** @private */
+	uint32 *ab_slots_p;
+
+	/** @private */
+	uint32 ab_slots_capacity;
+} AutocompleteBuilder;
+
+
+/**
+ * @private
+ *
+ * The values of one AutocompleteField in an AutocompleteIndex.
+ */
+typedef struct AutocompleteTrie
+{
+	/** @private */
+	struct AutocompleteNode *at_nodes_p;
+
+	/** @private */
+	uint32 at_num_nodes;
+} AutocompleteTrie;
+
+
+/**
+ * A read-only index for finding the most used values that start with a
+ * given prefix.
+ *
+ * Any number of threads can search an AutocompleteIndex at the same time.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct AutocompleteIndex
+{
+	/** @private */
+	AutocompleteTrie aci_tries [AF_NUM_FIELDS];
+
+	/** @private */
+	char *aci_strings_p;
+
+	/**
+	 * @private
+	 *
+	 * The number of threads using the index from an Autocompleter.
+	 */
+	uint32 aci_num_users;
+
+	/**
+	 * @private
+	 *
+	 * This is <code>true</code> once an Autocompleter has replaced the index
+	 * with a newer one, so that it is freed once it is no longer being used.
+	 */
+	bool aci_retired_flag;
+} AutocompleteIndex;
+
+
+/**
+ * An AutocompleteIndex that can be rebuilt in the background as new
+ * values are added.
+ *
+ * An Autocompleter can be used by any number of threads at the same time.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct Autocompleter
+{
+	/** @private */
+	AutocompleteBuilder *ac_builder_p;
+
+	/** @private */
+	AutocompleteIndex *ac_index_p;
+
+	/** @private */
+	struct AutocompleterSync *ac_sync_p;
+
+	/**
+	 * @private
+	 *
+	 * This is <code>true</code> if values have been added since the
+	 * index was last built.
+	 */
+	bool ac_dirty_flag;
+} Autocompleter;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Allocate an empty AutocompleteBuilder.
+ *
+ * @return The AutocompleteBuilder or <code>NULL</code> upon error.
+ * @memberof AutocompleteBuilder
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API AutocompleteBuilder *AllocateAutocompleteBuilder (void);
+
+
+/**
+ * Free an AutocompleteBuilder. Any AutocompleteIndexes built from it
+ * are unaffected.
+ *
+ * @param builder_p The AutocompleteBuilder to free.
+ * @memberof AutocompleteBuilder
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void FreeAutocompleteBuilder (AutocompleteBuilder *builder_p);
+
+
+/**
+ * Add a value to an AutocompleteBuilder or, if it is already there,
+ * add to its count. Values that only differ in case, punctuation or
+ * spacing are treated as the same and the first one to be added is
+ * the one that is suggested.
+ *
+ * @param builder_p The AutocompleteBuilder to add the value to.
+ * @param field The AutocompleteField that the value is for.
+ * @param value_s The value.
+ * @param count The number of uses to add to the value's count. If this
+ * is 0, the value isn't added.
+ * @return <code>true</code> if the value was added successfully, <code>false</code>
+ * otherwise.
+ * @memberof AutocompleteBuilder
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddAutocompleteValue (AutocompleteBuilder *builder_p, const AutocompleteField field, const char *value_s, const uint32 count);
+
+
+/**
+ * Add the names of all of the countries in the built-in country table
+ * to an AutocompleteBuilder, each with a count of 1.
+ *
+ * @param builder_p The AutocompleteBuilder to add the countries to.
+ * @return <code>true</code> if the countries were added successfully, <code>false</code>
+ * otherwise.
+ * @memberof AutocompleteBuilder
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddCountriesToAutocompleteBuilder (AutocompleteBuilder *builder_p);
+
+
+/**
+ * Add the countries, counties and towns from an AdminRegionIndex to an
+ * AutocompleteBuilder, each with a count of 1. These use the same
+ * admin_levels as SetAddressFromAdminRegions ().
+ *
+ * @param builder_p The AutocompleteBuilder to add the regions to.
+ * @param index_p The AdminRegionIndex to get the regions from.
+ * @return <code>true</code> if the regions were added successfully, <code>false</code>
+ * otherwise.
+ * @memberof AutocompleteBuilder
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddAdminRegionsToAutocompleteBuilder (AutocompleteBuilder *builder_p, const AdminRegionIndex *index_p);
+
+
+/**
+ * Add the town, county and country of each record in a file of
+ * previously geocoded Addresses to an AutocompleteBuilder, adding 1
+ * to their counts for each record.
+ *
+ * @param builder_p The AutocompleteBuilder to add the values to.
+ * @param record_file_p The AddressRecordFile to get the values from.
+ * @return <code>true</code> if the values were added successfully, <code>false</code>
+ * otherwise.
+ * @memberof AutocompleteBuilder
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddAddressRecordsToAutocompleteBuilder (AutocompleteBuilder *builder_p, const AddressRecordFile *record_file_p);
+
+
+/**
+ * Add the town, county and country of an Address to an
+ * AutocompleteBuilder, adding 1 to their counts.
+ *
+ * @param builder_p The AutocompleteBuilder to add the values to.
+ * @param address_p The Address to get the values from.
+ * @return <code>true</code> if the values were added successfully, <code>false</code>
+ * otherwise.
+ * @memberof AutocompleteBuilder
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddAddressToAutocompleteBuilder (AutocompleteBuilder *builder_p, const Address *address_p);
+
+
+/**
+ * Build an AutocompleteIndex from the values in an AutocompleteBuilder.
+ *
+ * @param builder_p The AutocompleteBuilder to use.
+ * @return The AutocompleteIndex or <code>NULL</code> upon error.
+ * @memberof AutocompleteBuilder
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API AutocompleteIndex *BuildAutocompleteIndex (const AutocompleteBuilder *builder_p);
+
+
+/**
+ * Free an AutocompleteIndex.
+ *
+ * @param index_p The AutocompleteIndex to free.
+ * @memberof AutocompleteIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void FreeAutocompleteIndex (AutocompleteIndex *index_p);
+
+
+/**
+ * Get the most used values that start with a given prefix.
+ *
+ * @param index_p The AutocompleteIndex to search.
+ * @param field The AutocompleteField to get the values for.
+ * @param prefix_s The prefix, such as the text typed so far. If this is empty,
+ * the most used values overall are returned.
+ * @param suggestions_p The array to store the suggestions in, with the most
+ * used first.
+ * @param max_suggestions The size of suggestions_p.
+ * @return The number of suggestions found.
+ * @memberof AutocompleteIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API uint32 GetAutocompleteSuggestions (const AutocompleteIndex *index_p, const AutocompleteField field, const char *prefix_s, AutocompleteSuggestion *suggestions_p, const uint32 max_suggestions);
+
+
+/**
+ * Allocate an Autocompleter and build its first AutocompleteIndex.
+ *
+ * @param builder_p The AutocompleteBuilder with the starting values. The
+ * Autocompleter takes ownership of this, so it must not be used or freed
+ * afterwards unless this function fails.
+ * @return The Autocompleter or <code>NULL</code> upon error.
+ * @memberof Autocompleter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API Autocompleter *AllocateAutocompleter (AutocompleteBuilder *builder_p);
+
+
+/**
+ * Free an Autocompleter. This waits for any background rebuild to finish
+ * and must not be called while any thread still has an AutocompleteIndex
+ * from AcquireAutocompleteIndex ().
+ *
+ * @param autocompleter_p The Autocompleter to free.
+ * @memberof Autocompleter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void FreeAutocompleter (Autocompleter *autocompleter_p);
+
+
+/**
+ * Add the town, county and country of an Address to an Autocompleter.
+ * These won't be suggested until the index is next rebuilt.
+ *
+ * @param autocompleter_p The Autocompleter to add the values to.
+ * @param address_p The Address to get the values from.
+ * @return <code>true</code> if the values were added successfully, <code>false</code>
+ * otherwise.
+ * @memberof Autocompleter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddAddressToAutocompleter (Autocompleter *autocompleter_p, const Address *address_p);
+
+
+/**
+ * Rebuild an Autocompleter's AutocompleteIndex on a background thread if
+ * any values have been added since it was last built. If a rebuild is
+ * already running, it will carry on with another one after it finishes.
+ * If the thread can't be started, the index is rebuilt on the calling thread.
+ *
+ * @param autocompleter_p The Autocompleter to rebuild.
+ * @return <code>true</code> if the rebuild was started successfully, <code>false</code>
+ * otherwise.
+ * @memberof Autocompleter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool StartAutocompleterRebuild (Autocompleter *autocompleter_p);
+
+
+/**
+ * Get an Autocompleter's current AutocompleteIndex to search. This must be
+ * given back with ReleaseAutocompleteIndex () once the suggestions have been
+ * used, as the index can't be freed until then.
+ *
+ * @param autocompleter_p The Autocompleter to use.
+ * @return The AutocompleteIndex.
+ * @memberof Autocompleter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API AutocompleteIndex *AcquireAutocompleteIndex (Autocompleter *autocompleter_p);
+
+
+/**
+ * Give back an AutocompleteIndex from AcquireAutocompleteIndex ().
+ *
+ * @param autocompleter_p The Autocompleter that the index came from.
+ * @param index_p The AutocompleteIndex.
+ * @memberof Autocompleter
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void ReleaseAutocompleteIndex (Autocompleter *autocompleter_p, AutocompleteIndex *index_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_AUTOCOMPLETE_H_ */
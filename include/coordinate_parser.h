@@ -0,0 +1,104 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * coordinate_parser.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * Parsing of the ways that people write latitudes and longitudes, so
+ * that Addresses which already have their location written in them
+ * don't need a geocoding service.
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_COORDINATE_PARSER_H_
+#define LIBS_GEOCODER_INCLUDE_COORDINATE_PARSER_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "coordinate.h"
+
+
+/**
+ * The forms of coordinate text that can be parsed.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum CoordinateStringFormat
+{
+	/** The text isn't a valid pair of coordinates. */
+	CSF_NONE,
+
+	/** Signed decimal degrees, e.g. "52.6167, -1.2167". */
+	CSF_SIGNED_DECIMAL,
+
+	/** Decimal degrees with hemisphere letters, e.g. "52.6167N 1.2167W" or "N 52.6167 W 1.2167". */
+	CSF_HEMISPHERE_DECIMAL,
+
+	/** Degrees with minutes and optionally seconds, e.g. "52°37'N 1°13'W" or "52 37 0 N, 1 13 0 W". */
+	CSF_DEGREES_MINUTES_SECONDS
+} CoordinateStringFormat;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Parse a latitude and longitude from some text.
+ *
+ * The latitude comes first unless hemisphere letters say otherwise, so
+ * "1°13'W 52°37'N" is also accepted. The two values can be separated by
+ * whitespace, a comma, a semicolon or a slash. The degree, minute and
+ * second marks can be ASCII, e.g. 52°37'12", or their Unicode equivalents
+ * in UTF-8, and a Latin-1 degree sign is also accepted.
+ *
+ * Nothing is allocated and the text is only read once, so this is cheap
+ * enough to try on every Address before calling a geocoding service.
+ *
+ * @param value_s The text to parse.
+ * @param latitude_p Where the latitude in degrees will be stored.
+ * @param longitude_p Where the longitude in degrees will be stored.
+ * @return The CoordinateStringFormat that the text was written in, or
+ * CSF_NONE if it isn't a valid latitude and longitude. Nothing is stored
+ * in this case.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API CoordinateStringFormat ParseCoordinateString (const char *value_s, double64 *latitude_p, double64 *longitude_p);
+
+
+/**
+ * Parse the latitudes and longitudes from a set of strings.
+ *
+ * @param values_ss The strings to parse. Any of these can be <code>NULL</code>.
+ * @param num_values The number of strings.
+ * @param coords_p The array of num_values Coordinates to store the latitudes
+ * and longitudes in. Their elevations are not changed. Any strings that can't
+ * be parsed have their latitudes and longitudes set to NAN.
+ * @return The number of strings that were parsed successfully.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API size_t ParseCoordinateStrings (const char * const *values_ss, const size_t num_values, Coordinate *coords_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_COORDINATE_PARSER_H_ */
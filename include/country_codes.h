@@ -38,6 +38,39 @@ struct CountryCode
 };
 
 
+/**
+ * The approximate location of a country.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct CountryLocation
+{
+	/** The ISO 3166-1 alpha-2 code for the country. */
+	const char *cl_code_s;
+
+	/** The latitude of the centre of the country in degrees. */
+	double64 cl_latitude;
+
+	/** The longitude of the centre of the country in degrees. */
+	double64 cl_longitude;
+
+	/** The latitude of the southern edge of the country in degrees. */
+	double64 cl_south;
+
+	/**
+	 * The longitude of the western edge of the country in degrees.
+	 * If this is greater than cl_east, the country crosses the antimeridian.
+	 */
+	double64 cl_west;
+
+	/** The latitude of the northern edge of the country in degrees. */
+	double64 cl_north;
+
+	/** The longitude of the eastern edge of the country in degrees. */
+	double64 cl_east;
+} CountryLocation;
+
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -53,6 +86,44 @@ GRASSROOTS_GEOCODER_API const char *GetCountryNameFromCode (const char * const c
 GRASSROOTS_GEOCODER_API bool IsValidCountryCode (const char * const code_s);
 
 
+/**
+ * Get the approximate centre and bounds of a country.
+ *
+ * These come from a table that is compiled into the library, so no
+ * geocoding service is needed.
+ *
+ * @param country_code_s The ISO 3166-1 alpha-2 code for the country.
+ * This is case-insensitive.
+ * @return The CountryLocation or <code>NULL</code> if the code isn't known.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API const CountryLocation *GetCountryLocation (const char * const country_code_s);
+
+
+/**
+ * Get the number of countries in the built-in country table.
+ *
+ * @return The number of countries.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API uint32 GetNumberOfCountries (void);
+
+
+/**
+ * Get a country from the built-in country table by its position, for
+ * going through all of the countries in alphabetical order of name.
+ *
+ * @param i The position of the country, from 0 to one less than
+ * GetNumberOfCountries ().
+ * @param name_ss Where to store the country's name.
+ * @param code_ss Where to store the country's ISO 3166-1 alpha-2 code.
+ * @return <code>true</code> if the country was found, <code>false</code> if i
+ * is out of range.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetCountryByIndex (const uint32 i, const char **name_ss, const char **code_ss);
+
+
 //GRASSROOTS_UTIL_API bool GetLocationData (MongoTool *tool_p, json_t *row_p, PathogenomicsServiceData *data_p, const char *id_s);
 
 
@@ -0,0 +1,102 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * double_conversion.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_DOUBLE_CONVERSION_H_
+#define LIBS_GEOCODER_INCLUDE_DOUBLE_CONVERSION_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+
+
+/**
+ * The size of the buffer needed by WriteShortestDouble(),
+ * including the terminating '\0'.
+ *
+ * @ingroup geocoder_library
+ */
+#define DOUBLE_CONVERSION_BUFFER_SIZE (32)
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Write the shortest decimal representation of a double that
+ * converts back to exactly the same value.
+ *
+ * This uses the Grisu3 algorithm so nothing is allocated and no
+ * locale-dependent printf calls are made. For the few values that Grisu3
+ * can't decide, Grisu2's digits are shortened by checking each shorter
+ * candidate with ParseDouble (), so the result is always the shortest
+ * string that converts back, e.g. "169.6628501". The output uses plain
+ * decimal notation such as "51.8095" or "-0.0003" where the decimal
+ * exponent is between -6 and 21 and scientific notation, e.g. "1e+22",
+ * otherwise. Non-finite values are written as "nan", "inf" or "-inf".
+ *
+ * @param value The value to write.
+ * @param buffer_s The buffer to write to. This must have room for
+ * at least DOUBLE_CONVERSION_BUFFER_SIZE bytes.
+ * @return The length of the string written to buffer_s, not including
+ * the terminating '\0'.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL size_t WriteShortestDouble (const double64 value, char *buffer_s);
+
+
+/**
+ * Parse a decimal number.
+ *
+ * Numbers with up to 19 significant digits are converted exactly using
+ * the Clinger fast path and the Eisel-Lemire algorithm. The rare values
+ * that neither can decide, or that have more digits, are passed to strtod().
+ *
+ * @param value_s The text to parse. This does not need to be <code>NULL</code>-terminated.
+ * @param length The number of bytes of value_s to parse. All of these must be part of the number.
+ * @param value_p Where the parsed value will be stored.
+ * @return <code>true</code> if the text was a valid number, <code>false</code> otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool ParseDouble (const char *value_s, const size_t length, double64 *value_p);
+
+
+/**
+ * Parse a <code>NULL</code>-terminated decimal number.
+ *
+ * This is the same as ParseDouble() for <code>NULL</code>-terminated strings.
+ *
+ * @param value_s The string to parse.
+ * @param value_p Where the parsed value will be stored.
+ * @return <code>true</code> if the whole of value_s was a valid number, <code>false</code> otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool ParseDoubleString (const char *value_s, double64 *value_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_DOUBLE_CONVERSION_H_ */
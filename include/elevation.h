@@ -0,0 +1,219 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * elevation.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * Offline elevation lookups from a directory of SRTM ".hgt" tiles.
+ *
+ * Each tile covers one degree of latitude and longitude and is named
+ * after its south-west corner, e.g. "N51W001.hgt". It holds a square
+ * grid of big-endian 16-bit heights in metres, starting at the north-west
+ * corner and going along each row in turn, such as the 1201 x 1201 grid
+ * of SRTM3 or the 3601 x 3601 grid of SRTM1. Other digital elevation
+ * models, such as GeoTIFFs, can be converted into this format with
+ * "gdal_translate -of SRTMHGT".
+ *
+ * The tiles are memory-mapped when they are first needed and the least
+ * recently used ones are unmapped when there are too many.
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_ELEVATION_H_
+#define LIBS_GEOCODER_INCLUDE_ELEVATION_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "address.h"
+#include "coordinate.h"
+#include "mapped_file.h"
+
+
+/**
+ * The default number of tiles that an ElevationEngine keeps mapped.
+ *
+ * @ingroup geocoder_library
+ */
+#define ELEVATION_DEFAULT_MAX_TILES (16)
+
+
+/**
+ * The value used in ".hgt" tiles for points without a height.
+ *
+ * @ingroup geocoder_library
+ */
+#define ELEVATION_VOID (-32768)
+
+
+/**
+ * A memory-mapped ".hgt" tile.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct ElevationTile
+{
+	/** @private */
+	MappedFile et_file;
+
+	/** @private */
+	uint32 et_num_samples;
+
+	/** @private */
+	int32 et_latitude;
+
+	/** @private */
+	int32 et_longitude;
+
+	/** @private */
+	uint64 et_last_used;
+
+	/**
+	 * @private
+	 *
+	 * This is <code>false</code> if there is no file for the tile, so that
+	 * it isn't looked for again.
+	 */
+	bool et_found_flag;
+} ElevationTile;
+
+
+/**
+ * A set of ".hgt" tiles from a directory.
+ *
+ * An ElevationEngine isn't thread-safe, so each thread should use its own.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct ElevationEngine
+{
+	/** @private */
+	char *ee_directory_s;
+
+	/** @private */
+	ElevationTile *ee_tiles_p;
+
+	/** @private */
+	uint32 ee_num_tiles;
+
+	/** @private */
+	uint32 ee_max_tiles;
+
+	/** @private */
+	ElevationTile *ee_last_tile_p;
+
+	/** @private */
+	uint64 ee_clock;
+} ElevationEngine;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Allocate an ElevationEngine.
+ *
+ * @param directory_s The directory containing the ".hgt" tiles.
+ * @param max_tiles The maximum number of tiles to keep mapped and the
+ * number of missing tiles to remember. If this is 0, ELEVATION_DEFAULT_MAX_TILES
+ * is used.
+ * @return The ElevationEngine or <code>NULL</code> upon error.
+ * @memberof ElevationEngine
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API ElevationEngine *AllocateElevationEngine (const char *directory_s, const uint32 max_tiles);
+
+
+/**
+ * Free an ElevationEngine and unmap all of its tiles.
+ *
+ * @param engine_p The ElevationEngine to free.
+ * @memberof ElevationEngine
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void FreeElevationEngine (ElevationEngine *engine_p);
+
+
+/**
+ * Get the elevation at a given position by bilinear interpolation between
+ * the four surrounding points of its tile. Any of these points that are voids
+ * are left out.
+ *
+ * @param engine_p The ElevationEngine to use.
+ * @param latitude The latitude in degrees.
+ * @param longitude The longitude in degrees.
+ * @param elevation_p Where to store the elevation in metres.
+ * @return <code>true</code> if the elevation was found, <code>false</code> if the
+ * position is invalid, its tile is missing or it is in a void.
+ * @memberof ElevationEngine
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetElevation (ElevationEngine *engine_p, const double64 latitude, const double64 longitude, double64 *elevation_p);
+
+
+/**
+ * Set the elevation of a Coordinate from its latitude and longitude.
+ *
+ * @param engine_p The ElevationEngine to use.
+ * @param coord_p The Coordinate whose elevation will be set.
+ * @return <code>true</code> if the elevation was set successfully, <code>false</code>
+ * otherwise in which case the Coordinate's elevation is left unchanged.
+ * @memberof ElevationEngine
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool SetCoordinateElevationFromTiles (ElevationEngine *engine_p, Coordinate *coord_p);
+
+
+/**
+ * Set the elevations of a set of Coordinates.
+ *
+ * The Coordinates are looked up grouped by tile, so that each tile is
+ * only mapped once however they are ordered.
+ *
+ * @param engine_p The ElevationEngine to use.
+ * @param coords_p The Coordinates whose elevations will be set.
+ * @param num_coords The number of Coordinates.
+ * @return The number of Coordinates whose elevations were set. The others
+ * are left unchanged.
+ * @memberof ElevationEngine
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API size_t SetCoordinateElevationsFromTiles (ElevationEngine *engine_p, Coordinate *coords_p, const size_t num_coords);
+
+
+/**
+ * Set the elevation of an Address from its centre Coordinate. This
+ * sets both the Address's elevation and that of its centre Coordinate.
+ *
+ * @param engine_p The ElevationEngine to use.
+ * @param address_p The Address, which must have its centre Coordinate set.
+ * @return <code>true</code> if the elevation was set successfully, <code>false</code>
+ * otherwise.
+ * @memberof ElevationEngine
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool SetAddressElevationFromTiles (ElevationEngine *engine_p, Address *address_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_ELEVATION_H_ */
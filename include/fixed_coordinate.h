@@ -0,0 +1,375 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * fixed_coordinate.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_FIXED_COORDINATE_H_
+#define LIBS_GEOCODER_INCLUDE_FIXED_COORDINATE_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "coordinate.h"
+
+
+/**
+ * The number of FixedCoordinate units in a degree, so each
+ * unit is 1e-7 degrees which is about 1cm.
+ *
+ * @ingroup geocoder_library
+ */
+#define FIXED_COORDINATE_SCALE (10000000)
+
+
+/**
+ * The largest latitude in FixedCoordinate units.
+ *
+ * @ingroup geocoder_library
+ */
+#define FIXED_COORDINATE_LATITUDE_LIMIT (90 * FIXED_COORDINATE_SCALE)
+
+
+/**
+ * The largest longitude in FixedCoordinate units.
+ *
+ * @ingroup geocoder_library
+ */
+#define FIXED_COORDINATE_LONGITUDE_LIMIT (180 * FIXED_COORDINATE_SCALE)
+
+
+/**
+ * The longest geohash that can be generated from a FixedCoordinate.
+ *
+ * @ingroup geocoder_library
+ */
+#define FIXED_COORDINATE_MAX_GEOHASH_LENGTH (12)
+
+
+/**
+ * A compact form of a Coordinate for use in caches and spatial indexes.
+ *
+ * The latitude and longitude are stored as integers in units of
+ * 1 / FIXED_COORDINATE_SCALE degrees and there is no elevation.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct FixedCoordinate
+{
+	/** The latitude in units of 1e-7 degrees. */
+	int32 fc_latitude;
+
+	/** The longitude in units of 1e-7 degrees. */
+	int32 fc_longitude;
+} FixedCoordinate;
+
+
+/**
+ * A bounding box made from FixedCoordinates.
+ *
+ * If the south-west longitude is greater than the north-east longitude,
+ * the box crosses the antimeridian and covers the longitudes from its
+ * west edge eastwards through 180 degrees to its east edge.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct FixedBoundingBox
+{
+	/** The south-west corner. */
+	FixedCoordinate fbb_south_west;
+
+	/** The north-east corner. */
+	FixedCoordinate fbb_north_east;
+} FixedBoundingBox;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Set a FixedCoordinate from a latitude and longitude.
+ *
+ * The values are rounded to the nearest 1e-7 degrees.
+ *
+ * @param fixed_p The FixedCoordinate to set.
+ * @param latitude The latitude in degrees. This must be between -90 and 90.
+ * @param longitude The longitude in degrees. This must be between -180 and 180.
+ * @return <code>true</code> if the FixedCoordinate was set successfully, <code>false</code>
+ * if either value is out of range or not a number.
+ * @memberof FixedCoordinate
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool SetFixedCoordinate (FixedCoordinate *fixed_p, const double64 latitude, const double64 longitude);
+
+
+/**
+ * Set a FixedCoordinate from a Coordinate.
+ *
+ * @param fixed_p The FixedCoordinate to set.
+ * @param coord_p The Coordinate to get the values from. Any elevation is ignored.
+ * @return <code>true</code> if the FixedCoordinate was set successfully, <code>false</code> otherwise.
+ * @see SetFixedCoordinate
+ * @memberof FixedCoordinate
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool SetFixedCoordinateFromCoordinate (FixedCoordinate *fixed_p, const Coordinate *coord_p);
+
+
+/**
+ * Set the latitude and longitude of a Coordinate from a FixedCoordinate.
+ *
+ * Converting the result back with SetFixedCoordinateFromCoordinate()
+ * always gives the original FixedCoordinate. The Coordinate's elevation
+ * is left unaltered.
+ *
+ * @param coord_p The Coordinate to set.
+ * @param fixed_p The FixedCoordinate to get the values from.
+ * @memberof FixedCoordinate
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void SetCoordinateFromFixedCoordinate (Coordinate *coord_p, const FixedCoordinate *fixed_p);
+
+
+/**
+ * Get the latitude of a FixedCoordinate in degrees.
+ *
+ * @param fixed_p The FixedCoordinate.
+ * @return The latitude.
+ * @memberof FixedCoordinate
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API double64 GetFixedCoordinateLatitude (const FixedCoordinate *fixed_p);
+
+
+/**
+ * Get the longitude of a FixedCoordinate in degrees.
+ *
+ * @param fixed_p The FixedCoordinate.
+ * @return The longitude.
+ * @memberof FixedCoordinate
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API double64 GetFixedCoordinateLongitude (const FixedCoordinate *fixed_p);
+
+
+/**
+ * Compare two FixedCoordinates by latitude and then by longitude.
+ *
+ * @param fixed0_p The first FixedCoordinate.
+ * @param fixed1_p The second FixedCoordinate.
+ * @return A negative value, zero or a positive value if fixed0_p is less than,
+ * equal to or greater than fixed1_p respectively.
+ * @memberof FixedCoordinate
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API int CompareFixedCoordinates (const FixedCoordinate *fixed0_p, const FixedCoordinate *fixed1_p);
+
+
+/**
+ * Check whether two FixedCoordinates are the same.
+ *
+ * @param fixed0_p The first FixedCoordinate.
+ * @param fixed1_p The second FixedCoordinate.
+ * @return <code>true</code> if they are equal, <code>false</code> otherwise.
+ * @memberof FixedCoordinate
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AreFixedCoordinatesEqual (const FixedCoordinate *fixed0_p, const FixedCoordinate *fixed1_p);
+
+
+/**
+ * Get a hash value for a FixedCoordinate suitable for use in hash tables.
+ *
+ * @param fixed_p The FixedCoordinate.
+ * @return The hash value.
+ * @memberof FixedCoordinate
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API uint32 GetFixedCoordinateHash (const FixedCoordinate *fixed_p);
+
+
+/**
+ * Get the position of a latitude across the full range of a uint32.
+ *
+ * The top bit splits the latitudes in half, the next bit splits each
+ * half and so on, which is how geohashes and Morton codes subdivide
+ * each axis. The result is the latitude part of a Morton code.
+ *
+ * @param latitude The latitude in FixedCoordinate units.
+ * @return The index.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API uint32 GetFixedLatitudeIndex (const int32 latitude);
+
+
+/**
+ * Get the position of a longitude across the full range of a uint32.
+ *
+ * @param longitude The longitude in FixedCoordinate units.
+ * @return The index.
+ * @see GetFixedLatitudeIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API uint32 GetFixedLongitudeIndex (const int32 longitude);
+
+
+/**
+ * Get the 64-bit Morton code for a FixedCoordinate.
+ *
+ * The latitude and longitude are each scaled to 32 bits across their full
+ * range and then interleaved with the longitude in the higher bit of each
+ * pair, the same order that geohashes use. Sorting by Morton code keeps
+ * nearby points close together and the top 5n bits give the geohash of
+ * length n.
+ *
+ * @param fixed_p The FixedCoordinate.
+ * @return The Morton code.
+ * @memberof FixedCoordinate
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API uint64 GetFixedCoordinateMortonCode (const FixedCoordinate *fixed_p);
+
+
+/**
+ * Get the geohash for a FixedCoordinate.
+ *
+ * @param fixed_p The FixedCoordinate.
+ * @param precision The number of characters to generate, from 1 to FIXED_COORDINATE_MAX_GEOHASH_LENGTH.
+ * @param geohash_s The buffer to write the geohash to. This must have room for
+ * precision + 1 characters.
+ * @return <code>true</code> if the geohash was generated successfully, <code>false</code> if
+ * precision is out of range.
+ * @memberof FixedCoordinate
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetFixedCoordinateGeohash (const FixedCoordinate *fixed_p, const size_t precision, char *geohash_s);
+
+
+/**
+ * Set a FixedBoundingBox from its south-west and north-east corners.
+ *
+ * @param box_p The FixedBoundingBox to set.
+ * @param south_west_p The south-west corner.
+ * @param north_east_p The north-east corner.
+ * @return <code>true</code> if the FixedBoundingBox was set successfully, <code>false</code>
+ * if either corner is out of range.
+ * @memberof FixedBoundingBox
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool SetFixedBoundingBox (FixedBoundingBox *box_p, const Coordinate *south_west_p, const Coordinate *north_east_p);
+
+
+/**
+ * Check whether a FixedBoundingBox crosses the antimeridian.
+ *
+ * @param box_p The FixedBoundingBox.
+ * @return <code>true</code> if the box crosses the antimeridian, <code>false</code> otherwise.
+ * @memberof FixedBoundingBox
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool DoesFixedBoundingBoxCrossAntimeridian (const FixedBoundingBox *box_p);
+
+
+/**
+ * Check whether a FixedBoundingBox contains a FixedCoordinate.
+ *
+ * Points on the edges of the box are treated as inside it. Boxes that
+ * cross the antimeridian are supported.
+ *
+ * @param box_p The FixedBoundingBox.
+ * @param fixed_p The FixedCoordinate.
+ * @return <code>true</code> if the point is inside the box, <code>false</code> otherwise.
+ * @memberof FixedBoundingBox
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool DoesFixedBoundingBoxContain (const FixedBoundingBox *box_p, const FixedCoordinate *fixed_p);
+
+
+/**
+ * Check whether two FixedBoundingBoxes overlap. Boxes that cross the
+ * antimeridian are supported.
+ *
+ * @param box0_p The first FixedBoundingBox.
+ * @param box1_p The second FixedBoundingBox.
+ * @return <code>true</code> if the boxes overlap or touch, <code>false</code> otherwise.
+ * @memberof FixedBoundingBox
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool DoFixedBoundingBoxesIntersect (const FixedBoundingBox *box0_p, const FixedBoundingBox *box1_p);
+
+
+/**
+ * Grow a FixedBoundingBox so that it includes a FixedCoordinate.
+ *
+ * The box is grown without wrapping around the antimeridian so a box
+ * that doesn't cross it never will. Use GetFixedBoundingBoxUnion ()
+ * to get the smallest box that may wrap.
+ *
+ * @param box_p The FixedBoundingBox to grow.
+ * @param fixed_p The FixedCoordinate to include.
+ * @memberof FixedBoundingBox
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void ExpandFixedBoundingBox (FixedBoundingBox *box_p, const FixedCoordinate *fixed_p);
+
+
+/**
+ * Get the smallest FixedBoundingBox that covers two others.
+ *
+ * This can cross the antimeridian, e.g. the union of boxes on either
+ * side of 180 degrees will cover the narrow gap between them rather
+ * than going round the world the other way.
+ *
+ * @param box0_p The first FixedBoundingBox.
+ * @param box1_p The second FixedBoundingBox.
+ * @param union_p The FixedBoundingBox to store the union in. This can be
+ * the same as either box0_p or box1_p.
+ * @memberof FixedBoundingBox
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void GetFixedBoundingBoxUnion (const FixedBoundingBox *box0_p, const FixedBoundingBox *box1_p, FixedBoundingBox *union_p);
+
+
+/**
+ * Grow a FixedBoundingBox so that it includes every point within a given
+ * distance of it.
+ *
+ * The result can cross the antimeridian and, if it reaches either
+ * pole, covers all longitudes.
+ *
+ * @param box_p The FixedBoundingBox to grow.
+ * @param distance The distance in metres.
+ * @param expanded_p The FixedBoundingBox to store the grown box in. This can be
+ * the same as box_p.
+ * @return <code>true</code> if the box was grown successfully, <code>false</code>
+ * if the distance is negative or not a number.
+ * @memberof FixedBoundingBox
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool ExpandFixedBoundingBoxByDistance (const FixedBoundingBox *box_p, const double64 distance, FixedBoundingBox *expanded_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_FIXED_COORDINATE_H_ */
@@ -0,0 +1,309 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * geo_cell.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * Spatial keys for coordinates.
+ *
+ * The world is split in half by longitude, each half is split by latitude,
+ * each quarter by longitude again and so on. A cell is named by the
+ * sequence of choices made to reach it, which gives a Morton code when
+ * stored in the top bits of a uint64 and a geohash when written out five
+ * bits at a time. Cells sharing a prefix are nested, so every cell is a
+ * contiguous range of full-depth Morton codes and a region can be
+ * searched with a handful of range scans.
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_GEO_CELL_H_
+#define LIBS_GEOCODER_INCLUDE_GEO_CELL_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "coordinate.h"
+#include "fixed_coordinate.h"
+
+
+/**
+ * The deepest level of GeoCell, equivalent to a 12 character
+ * geohash.
+ *
+ * @ingroup geocoder_library
+ */
+#define GEO_CELL_MAX_DEPTH (60)
+
+
+/**
+ * The maximum number of neighbours that a GeoCell can have.
+ *
+ * @ingroup geocoder_library
+ */
+#define GEO_CELL_MAX_NEIGHBOURS (8)
+
+
+/**
+ * A cell in the hierarchical subdivision of the world.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct GeoCell
+{
+	/**
+	 * The Morton code prefix of the cell, stored in the top
+	 * gc_depth bits. All of the other bits are 0.
+	 */
+	uint64 gc_code;
+
+	/**
+	 * The number of subdivisions used to reach the cell, from 0 for
+	 * the whole world up to GEO_CELL_MAX_DEPTH. A geohash of length n
+	 * has a depth of 5n.
+	 */
+	uint32 gc_depth;
+} GeoCell;
+
+
+/**
+ * An inclusive range of full-depth Morton codes.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct GeoCellRange
+{
+	/** The first Morton code in the range. */
+	uint64 gcr_first;
+
+	/** The last Morton code in the range. */
+	uint64 gcr_last;
+} GeoCellRange;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Interleave a pair of latitude and longitude indexes into a Morton code.
+ *
+ * The longitude bits take the higher bit of each pair.
+ *
+ * @param latitude_index The latitude index.
+ * @param longitude_index The longitude index.
+ * @return The Morton code.
+ * @see GetFixedLatitudeIndex
+ * @see GetFixedLongitudeIndex
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API uint64 InterleaveMortonIndices (const uint32 latitude_index, const uint32 longitude_index);
+
+
+/**
+ * Split a Morton code back into its latitude and longitude indexes.
+ *
+ * @param code The Morton code.
+ * @param latitude_index_p Where the latitude index will be stored.
+ * @param longitude_index_p Where the longitude index will be stored.
+ * @see InterleaveMortonIndices
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void DeinterleaveMortonCode (const uint64 code, uint32 *latitude_index_p, uint32 *longitude_index_p);
+
+
+/**
+ * Write the geohash for a Morton code.
+ *
+ * @param code The Morton code.
+ * @param precision The number of characters to generate, from 1 to FIXED_COORDINATE_MAX_GEOHASH_LENGTH.
+ * @param geohash_s The buffer to write the geohash to. This must have room for
+ * precision + 1 characters.
+ * @return <code>true</code> if the geohash was generated successfully, <code>false</code> if
+ * precision is out of range.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetGeohashForMortonCode (const uint64 code, const size_t precision, char *geohash_s);
+
+
+/**
+ * Get the Morton codes for an array of FixedCoordinates.
+ *
+ * This gives the same results as calling GetFixedCoordinateMortonCode()
+ * on each element but, on x86-64 builds with GCC or Clang, it uses AVX2
+ * or BMI2 instructions when the processor supports them.
+ *
+ * @param coords_p The FixedCoordinates.
+ * @param num_coords The number of FixedCoordinates.
+ * @param codes_p The array to store the num_coords Morton codes in.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void GetMortonCodesForFixedCoordinates (const FixedCoordinate *coords_p, const size_t num_coords, uint64 *codes_p);
+
+
+/**
+ * Get the Morton codes for an array of Coordinates.
+ *
+ * @param coords_p The Coordinates.
+ * @param num_coords The number of Coordinates.
+ * @param codes_p The array to store the num_coords Morton codes in.
+ * @return <code>true</code> if all of the Morton codes were generated successfully,
+ * <code>false</code> if any of the Coordinates are out of range. In that case
+ * the contents of codes_p are undefined.
+ * @see GetMortonCodesForFixedCoordinates
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetMortonCodesForCoordinates (const Coordinate *coords_p, const size_t num_coords, uint64 *codes_p);
+
+
+/**
+ * Get the GeoCell at a given depth that contains a FixedCoordinate.
+ *
+ * @param cell_p The GeoCell to set.
+ * @param fixed_p The FixedCoordinate.
+ * @param depth The depth of the GeoCell. Values greater than GEO_CELL_MAX_DEPTH are
+ * reduced to GEO_CELL_MAX_DEPTH.
+ * @memberof GeoCell
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void SetGeoCellFromFixedCoordinate (GeoCell *cell_p, const FixedCoordinate *fixed_p, const uint32 depth);
+
+
+/**
+ * Get the GeoCell at a given depth that contains a Morton code.
+ *
+ * @param cell_p The GeoCell to set.
+ * @param code The Morton code.
+ * @param depth The depth of the GeoCell. Values greater than GEO_CELL_MAX_DEPTH are
+ * reduced to GEO_CELL_MAX_DEPTH.
+ * @memberof GeoCell
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void SetGeoCellFromMortonCode (GeoCell *cell_p, const uint64 code, const uint32 depth);
+
+
+/**
+ * Get the GeoCell for a geohash.
+ *
+ * Upper case characters are accepted.
+ *
+ * @param cell_p The GeoCell to set.
+ * @param geohash_s The geohash.
+ * @return <code>true</code> if the geohash was decoded successfully, <code>false</code>
+ * if it is empty, too long or has invalid characters.
+ * @memberof GeoCell
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool SetGeoCellFromGeohash (GeoCell *cell_p, const char *geohash_s);
+
+
+/**
+ * Write the geohash for a GeoCell.
+ *
+ * @param cell_p The GeoCell. Its depth must be a non-zero multiple of 5.
+ * @param geohash_s The buffer to write the geohash to. This must have room for
+ * (depth / 5) + 1 characters.
+ * @return <code>true</code> if the geohash was generated successfully, <code>false</code>
+ * if the GeoCell's depth does not correspond to a geohash.
+ * @memberof GeoCell
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetGeohashForGeoCell (const GeoCell *cell_p, char *geohash_s);
+
+
+/**
+ * Get the range of full-depth Morton codes within a GeoCell.
+ *
+ * @param cell_p The GeoCell.
+ * @param range_p The GeoCellRange to set.
+ * @memberof GeoCell
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void GetGeoCellRange (const GeoCell *cell_p, GeoCellRange *range_p);
+
+
+/**
+ * Get the extent of a GeoCell.
+ *
+ * The FixedBoundingBox contains exactly the FixedCoordinates that
+ * lie within the GeoCell.
+ *
+ * @param cell_p The GeoCell.
+ * @param box_p The FixedBoundingBox to set.
+ * @memberof GeoCell
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void GetGeoCellBoundingBox (const GeoCell *cell_p, FixedBoundingBox *box_p);
+
+
+/**
+ * Get the centre of a GeoCell.
+ *
+ * @param cell_p The GeoCell.
+ * @param centre_p The FixedCoordinate to set.
+ * @memberof GeoCell
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void GetGeoCellCentre (const GeoCell *cell_p, FixedCoordinate *centre_p);
+
+
+/**
+ * Get the cells of the same depth that surround a GeoCell.
+ *
+ * The neighbours are given clockwise starting from the north. Cells
+ * wrap around the antimeridian, there are no neighbours beyond the
+ * poles and a cell is never listed more than once, so cells at the
+ * edges or at very low depths have fewer than eight neighbours.
+ *
+ * @param cell_p The GeoCell.
+ * @param neighbours_p The array of at least GEO_CELL_MAX_NEIGHBOURS GeoCells to store
+ * the neighbours in.
+ * @return The number of neighbours.
+ * @memberof GeoCell
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API size_t GetGeoCellNeighbours (const GeoCell *cell_p, GeoCell *neighbours_p);
+
+
+/**
+ * Get the ranges of Morton codes that cover a FixedBoundingBox.
+ *
+ * Every point within the box has a Morton code in one of the ranges.
+ * Cells are subdivided up to max_depth so the ranges may also include
+ * points just outside of the box. If more than max_ranges ranges would
+ * be needed, the depth is reduced until they fit, giving fewer but
+ * looser ranges. The ranges are in ascending order and do not overlap.
+ *
+ * A box whose south-west longitude is greater than its north-east
+ * longitude is treated as crossing the antimeridian.
+ *
+ * @param box_p The FixedBoundingBox.
+ * @param max_depth The deepest cells to use, up to GEO_CELL_MAX_DEPTH.
+ * @param ranges_p The array to store the GeoCellRanges in.
+ * @param max_ranges The number of GeoCellRanges that ranges_p can hold.
+ * @return The number of GeoCellRanges or 0 upon error.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API size_t GetGeoCellRangesForBoundingBox (const FixedBoundingBox *box_p, const uint32 max_depth, GeoCellRange *ranges_p, const size_t max_ranges);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_GEO_CELL_H_ */
@@ -0,0 +1,138 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * geo_distance.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_GEO_DISTANCE_H_
+#define LIBS_GEOCODER_INCLUDE_GEO_DISTANCE_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "coordinate.h"
+
+
+/**
+ * The mean radius of the Earth in metres that is used
+ * for spherical distances.
+ *
+ * @ingroup geocoder_library
+ */
+#define GEO_DISTANCE_EARTH_RADIUS (6371008.8)
+
+
+/**
+ * The ways that the distance between two Coordinates
+ * can be calculated.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum GeoDistanceMethod
+{
+	/**
+	 * The great-circle distance on a sphere of radius GEO_DISTANCE_EARTH_RADIUS.
+	 * This is the quickest method and is within 0.5% of the true distance.
+	 */
+	GDM_SPHERICAL,
+
+	/**
+	 * The distance on the WGS84 ellipsoid using Vincenty's formulae,
+	 * accurate to within a millimetre.
+	 */
+	GDM_ELLIPSOIDAL
+} GeoDistanceMethod;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Get the great-circle distance between two Coordinates using
+ * the haversine formula.
+ *
+ * @param coord0_p The first Coordinate.
+ * @param coord1_p The second Coordinate.
+ * @return The distance in metres.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API double64 GetHaversineDistance (const Coordinate *coord0_p, const Coordinate *coord1_p);
+
+
+/**
+ * Get the distance between two Coordinates on the WGS84
+ * ellipsoid using Vincenty's inverse formula.
+ *
+ * @param coord0_p The first Coordinate.
+ * @param coord1_p The second Coordinate.
+ * @param distance_p Where the distance in metres will be stored.
+ * @return <code>true</code> if the distance was calculated successfully, <code>false</code>
+ * if the formula did not converge, which can happen for nearly antipodal points.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetVincentyDistance (const Coordinate *coord0_p, const Coordinate *coord1_p, double64 *distance_p);
+
+
+/**
+ * Get the distance between two Coordinates.
+ *
+ * @param coord0_p The first Coordinate.
+ * @param coord1_p The second Coordinate.
+ * @param method The GeoDistanceMethod to use.
+ * @param distance_p Where the distance in metres will be stored.
+ * @return <code>true</code> if the distance was calculated successfully, <code>false</code> otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetCoordinateDistance (const Coordinate *coord0_p, const Coordinate *coord1_p, const GeoDistanceMethod method, double64 *distance_p);
+
+
+/**
+ * Get the distances between every pair of Coordinates taken from two arrays.
+ *
+ * The work is split into tiles that fit in the processor's cache and, for
+ * large matrices, spread across several threads. Spherical distances use
+ * AVX2 on x86-64 builds with GCC or Clang when the processor supports it.
+ * For ellipsoidal distances, any pair where Vincenty's formula does not
+ * converge is given its spherical distance.
+ *
+ * @param rows_p The Coordinates for the rows of the matrix.
+ * @param num_rows The number of row Coordinates.
+ * @param columns_p The Coordinates for the columns of the matrix.
+ * @param num_columns The number of column Coordinates.
+ * @param method The GeoDistanceMethod to use.
+ * @param num_threads The maximum number of threads to use. If this is 0,
+ * one thread per processor will be used.
+ * @param distances_p The array of num_rows * num_columns values to store the
+ * distances in metres in. The distance between rows_p [i] and columns_p [j] is
+ * stored at distances_p [i * num_columns + j].
+ * @return <code>true</code> if the distances were calculated successfully, <code>false</code>
+ * if any of the Coordinates are invalid or memory could not be allocated.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetDistanceMatrix (const Coordinate *rows_p, const size_t num_rows, const Coordinate *columns_p, const size_t num_columns, const GeoDistanceMethod method, const uint32 num_threads, double64 *distances_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_GEO_DISTANCE_H_ */
@@ -13,6 +13,13 @@
 #include "jansson.h"
 #include "address.h"
 #include "grassroots_server.h"
+#include "url_template.h"
+#include "json_stream.h"
+#include "json_on_demand.h"
+#include "admin_regions.h"
+#include "address_record.h"
+#include "town_matcher.h"
+#include "address_splitter.h"
 
 
 /**
@@ -65,6 +72,90 @@ typedef struct
 	 */
 	const char *gt_reverse_geocoder_url_s;
 
+
+	/**
+	 * The compiled version of the optional "geocode_template" for
+	 * this geocoder. If this is set, it is used instead of
+	 * gt_geocoder_fn to build the url for geocoding. It is compiled
+	 * when the GeocoderTool is built and reused for every request.
+	 *
+	 * @private
+	 */
+	URLTemplate *gt_geocoder_template_p;
+
+
+	/**
+	 * The compiled version of the optional "reverse_geocode_template" for
+	 * this geocoder. If this is set, it is used instead of
+	 * gt_reverse_geocoder_fn to build the url for reverse geocoding.
+	 * Like gt_geocoder_template_p, it is only compiled once.
+	 *
+	 * @private
+	 */
+	URLTemplate *gt_reverse_geocoder_template_p;
+
+
+	/**
+	 * The function used to parse the responses from gt_geocoder_template_p.
+	 *
+	 * @private
+	 */
+	int (*gt_parse_results_fn) (Address *address_p, const json_t *web_service_results_p);
+
+
+	/**
+	 * The function used to parse the responses from gt_reverse_geocoder_template_p.
+	 *
+	 * @private
+	 */
+	int (*gt_parse_reverse_results_fn) (Address *address_p, const json_t *web_service_results_p);
+
+
+	/**
+	 * The optional function used to parse the raw responses from
+	 * gt_geocoder_template_p. If this is set, it is used instead of
+	 * gt_parse_results_fn and no jansson tree is built.
+	 *
+	 * @private
+	 */
+	ParseRawResultsFunction gt_parse_raw_results_fn;
+
+
+	/**
+	 * The optional offline index of administrative regions which, if set,
+	 * is tried before the reverse geocoding web service.
+	 *
+	 * @private
+	 */
+	AdminRegionIndex *gt_admin_regions_p;
+
+
+	/**
+	 * The optional file of previously geocoded Addresses which, if set,
+	 * is checked before the geocoding web service.
+	 *
+	 * @private
+	 */
+	AddressRecordFile *gt_address_cache_p;
+
+
+	/**
+	 * The town names from gt_admin_regions_p and gt_address_cache_p,
+	 * used to correct misspelt towns before geocoding.
+	 *
+	 * @private
+	 */
+	TownMatcher *gt_town_matcher_p;
+
+
+	/**
+	 * The town and county names from gt_admin_regions_p and
+	 * gt_address_cache_p, used to split free-text addresses.
+	 *
+	 * @private
+	 */
+	AddressSplitter *gt_address_splitter_p;
+
 } GeocoderTool;
 
 
@@ -78,8 +169,29 @@ extern "C"
 /**
  * Determine the geographic coordinates for a given Address using a given GeocoderTool.
  *
+ * If the Address's GPS text, or its name or street, is already a latitude
+ * and longitude in any of the forms accepted by ParseCoordinateString (),
+ * that is used and no geocoding service is called. Similarly, an Address
+ * with nothing other than its country gets the country's centre and bounds
+ * from a built-in table, which is also used if the rest of an Address
+ * can't be found.
+ *
+ * An Address that only has a name, which is how free-text addresses are
+ * usually given, is first split into its street, town, county, postcode
+ * and country by SplitAddressName ().
+ *
+ * If the GeocoderTool has an admin region index or an address cache, their
+ * town and county names are used to help split free-text addresses and a
+ * misspelt town is then corrected to the closest known town name and the
+ * Address is then looked up in the cache before any geocoding service is
+ * called.
+ *
  * @param address_p The Address to determine the GPS coordinates for.
- * @param tool_p The GeocoderTool used to calculate the GPS coordinates for the given Address
+ * @param tool_p The GeocoderTool used to calculate the GPS coordinates for the given Address.
+ * If this is <code>NULL</code>, the GeocoderTool for the "geocoder" configuration of
+ * grassroots_p is used. This is built on its first use and then kept until
+ * FreeCachedGeocoderTools () is called.
+ * @param grassroots_p The GrassrootsServer whose configuration is used if tool_p is <code>NULL</code>.
  * @return <code>true</code> if the GPS location was calculated successfully, <code>false</code> otherwise.
  * @ingroup geocoder_library
  */
@@ -90,14 +202,56 @@ GRASSROOTS_GEOCODER_API bool DetermineGPSLocationForAddress (Address *address_p,
 /**
  * Determine the geographic coordinates for a given Address using a given GeocoderTool.
  *
+ * If the GeocoderTool has an "admin_regions_file" index of administrative
+ * regions, the country, county and town are looked up in that first and
+ * the web service is only called if none of them are found.
+ *
  * @param address_p The Address whose GPS coordinates will be used.
  * @param tool_p The GeocoderTool used to calculate the Address for the given GPS coordinates.
+ * If this is <code>NULL</code>, the cached GeocoderTool for grassroots_p is used as
+ * with DetermineGPSLocationForAddress ().
+ * @param grassroots_p The GrassrootsServer whose configuration is used if tool_p is <code>NULL</code>.
  * @return <code>true</code> if the Address was calculated successfully, <code>false</code> otherwise.
  * @ingroup geocoder_library
  */
 GRASSROOTS_GEOCODER_API bool DetermineAddressForGPSLocation (Address *address_p, GeocoderTool *tool_p, GrassrootsServer *grassroots_p);
 
 
+/**
+ * Build a GeocoderTool from the "geocoder" configuration of a GrassrootsServer.
+ *
+ * This loads the admin regions and address cache and fills the TownMatcher
+ * and AddressSplitter from them, so it should be done once and the
+ * GeocoderTool reused. It can be used by several threads at the same time.
+ *
+ * @param grassroots_p The GrassrootsServer.
+ * @return The new GeocoderTool or <code>NULL</code> if the configuration
+ * doesn't have a usable geocoder or upon error.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API GeocoderTool *AllocateGeocoderToolFromGrassrootsConfig (GrassrootsServer *grassroots_p);
+
+
+/**
+ * Free a GeocoderTool.
+ *
+ * @param tool_p The GeocoderTool to free.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void FreeGeocoderTool (GeocoderTool *tool_p);
+
+
+/**
+ * Free the GeocoderTools that DetermineGPSLocationForAddress () and
+ * DetermineAddressForGPSLocation () have built and kept for each
+ * GrassrootsServer. This must not be called while either of them
+ * is running.
+ *
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void FreeCachedGeocoderTools (void);
+
+
 
 GRASSROOTS_GEOCODER_LOCAL bool DetermineGPSLocationForAddressByOpencage (Address *address_p, const char *geocoder_uri_s);
 
@@ -109,10 +263,44 @@ GRASSROOTS_GEOCODER_LOCAL bool DetermineGPSLocationForAddressByLocationIQ (Addre
 GRASSROOTS_GEOCODER_LOCAL int CallGeocoderWebService (CurlTool *curl_tool_p, const char *url_s, Address *address_p, int (*parse_results_fn) (Address *address_p, const json_t *web_service_results_p));
 
 
-GRASSROOTS_GEOCODER_LOCAL int AddEscapedValueToByteBuffer (const char *value_s, ByteBuffer *buffer_p, CurlTool *tool_p, const char *prefix_s);
+/**
+ * Call a geocoder web service and pass the raw text of its response
+ * to a parse function rather than loading it as a jansson tree.
+ *
+ * @param curl_tool_p The CurlTool to make the call with.
+ * @param url_s The url to call.
+ * @param address_p The Address to pass to parse_raw_results_fn.
+ * @param parse_raw_results_fn The function used to parse the response.
+ * @return The value returned by parse_raw_results_fn or -1 if the call failed.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL int CallGeocoderWebServiceOnDemand (CurlTool *curl_tool_p, const char *url_s, Address *address_p, ParseRawResultsFunction parse_raw_results_fn);
+
+
+/**
+ * Call a geocoder web service and parse its response as it arrives.
+ *
+ * Rather than storing the whole response and loading it as a jansson tree,
+ * each chunk of data is fed to a JSONStreamParser from within the curl write
+ * callback. If the callback function returns JSS_STOP, the transfer is
+ * stopped straight away. Since this replaces the CurlTool's write callback,
+ * the CurlTool should only be used for further streaming calls afterwards.
+ *
+ * @param curl_tool_p The CurlTool to make the call with.
+ * @param url_s The url to call.
+ * @param callback_fn The function to pass the parsed values to.
+ * @param callback_data_p The custom data to pass to callback_fn.
+ * @return <code>true</code> if the response was parsed completely or the callback
+ * function stopped the transfer, <code>false</code> otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool CallGeocoderWebServiceStreaming (CurlTool *curl_tool_p, const char *url_s, JSONStreamCallback callback_fn, void *callback_data_p);
+
+
+GRASSROOTS_GEOCODER_LOCAL int AddEscapedValueToByteBuffer (const char *value_s, ByteBuffer *buffer_p, const char *prefix_s);
 
 
-GRASSROOTS_GEOCODER_LOCAL bool BuildURLUsingAddressParameter (ByteBuffer *buffer_p, CurlTool *curl_p, const Address * const address_p, const char *api_call_s, const char *sep_s);
+GRASSROOTS_GEOCODER_LOCAL bool BuildURLUsingAddressParameter (ByteBuffer *buffer_p, const Address * const address_p, const char *api_call_s, const char *sep_s);
 
 
 #ifdef __cplusplus
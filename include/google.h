@@ -43,6 +43,32 @@ GRASSROOTS_GEOCODER_LOCAL bool RunGoogleGeocoder (Address *address_p, const char
 GRASSROOTS_GEOCODER_LOCAL bool RunGoogleReverseGeocoder (Address *address_p, const char *geocoder_uri_s);
 
 
+/**
+ * Parse the results of a Google geocoding call and use the first
+ * valid result to set the centre and bounds of an Address.
+ *
+ * @param address_p The Address to fill in.
+ * @param web_service_results_p The JSON response from the geocoding call.
+ * @return 1 if the Address was updated, 0 if there were no results and -1 upon error.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL int ParseGoogleResults (Address *address_p, const json_t *web_service_results_p);
+
+
+/**
+ * Parse the raw text of the results of a Google geocoding call without
+ * building a jansson tree. This has the same behaviour as ParseGoogleResults()
+ * but only scans the parts of the response that it needs.
+ *
+ * @param address_p The Address to fill in.
+ * @param response_s The response text from the geocoding call.
+ * @param length The length of response_s.
+ * @return 1 if the Address was updated, 0 if there were no results and -1 upon error.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL int ParseGoogleResultsOnDemand (Address *address_p, const char *response_s, const size_t length);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,294 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * json_on_demand.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_JSON_ON_DEMAND_H_
+#define LIBS_GEOCODER_INCLUDE_JSON_ON_DEMAND_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "address.h"
+
+
+/**
+ * The types of value that a JSONSpan can refer to.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum
+{
+	JST_INVALID,
+	JST_OBJECT,
+	JST_ARRAY,
+	JST_STRING,
+	JST_NUMBER,
+	JST_TRUE,
+	JST_FALSE,
+	JST_NULL
+} JSONSpanType;
+
+
+/**
+ * A single value within a raw JSON document.
+ *
+ * Rather than building a tree, a JSONSpan simply points at the
+ * bytes of a value in the original response text. Members and
+ * elements are found by scanning forward from it and skipping
+ * over any values that are not wanted, so only the parts of the
+ * document that are actually asked for are ever looked at in detail.
+ *
+ * The underlying data must stay valid for as long as the JSONSpan
+ * is in use.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct JSONSpan
+{
+	/** The first byte of the value. */
+	const char *js_start_p;
+
+	/** The byte immediately after the value. */
+	const char *js_end_p;
+} JSONSpan;
+
+
+/**
+ * An iterator over the elements of a JSON array, the members
+ * of a JSON object or a sequence of JSON values such as JSON Lines.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct JSONSpanIterator
+{
+	/** @private */
+	const char *jsi_current_p;
+
+	/** @private */
+	const char *jsi_end_p;
+
+	/** @private */
+	bool jsi_failed_flag;
+} JSONSpanIterator;
+
+
+/**
+ * The signature of a function that parses the raw text of a web service
+ * response. This has the same return values as the parse functions
+ * that are passed to CallGeocoderWebService().
+ *
+ * @param address_p The Address to fill in.
+ * @param response_s The response text.
+ * @param length The length of response_s.
+ * @return 1 if the Address was updated, 0 if there were no results and -1 upon error.
+ * @ingroup geocoder_library
+ */
+typedef int (*ParseRawResultsFunction) (Address *address_p, const char *response_s, const size_t length);
+
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Set a JSONSpan to the top-level value of a JSON document.
+ *
+ * Only the extent of the top-level value is checked, its
+ * contents are validated lazily as they are accessed.
+ *
+ * @param span_p The JSONSpan to set.
+ * @param data_s The JSON document.
+ * @param length The length of data_s.
+ * @return <code>true</code> if the JSONSpan was set successfully, <code>false</code> otherwise.
+ * @memberof JSONSpan
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool InitJSONSpan (JSONSpan *span_p, const char *data_s, const size_t length);
+
+
+/**
+ * Get the type of value that a JSONSpan refers to.
+ *
+ * @param span_p The JSONSpan to check.
+ * @return The JSONSpanType.
+ * @memberof JSONSpan
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL JSONSpanType GetJSONSpanType (const JSONSpan *span_p);
+
+
+/**
+ * Find the value of an object member.
+ *
+ * Keys are compared with their raw, still-escaped, text so this
+ * is only suitable for keys that do not need escaping.
+ *
+ * @param object_p The JSONSpan for the object.
+ * @param key_s The key to find.
+ * @param value_p Where the JSONSpan for the value will be stored.
+ * @return <code>true</code> if the member was found, <code>false</code> otherwise.
+ * @memberof JSONSpan
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool GetJSONSpanMember (const JSONSpan *object_p, const char *key_s, JSONSpan *value_p);
+
+
+/**
+ * Find a value within nested objects.
+ *
+ * @param span_p The JSONSpan for the outermost object.
+ * @param path_s The keys to follow separated by dots, e.g. "geometry.location".
+ * @param value_p Where the JSONSpan for the value will be stored.
+ * @return <code>true</code> if the value was found, <code>false</code> otherwise.
+ * @memberof JSONSpan
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool GetJSONSpanPath (const JSONSpan *span_p, const char *path_s, JSONSpan *value_p);
+
+
+/**
+ * Start iterating over the elements of an array.
+ *
+ * @param iterator_p The JSONSpanIterator to initialise.
+ * @param array_p The JSONSpan for the array.
+ * @return <code>true</code> if array_p is an array, <code>false</code> otherwise.
+ * @memberof JSONSpanIterator
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool InitJSONSpanIterator (JSONSpanIterator *iterator_p, const JSONSpan *array_p);
+
+
+/**
+ * Get the next element of an array.
+ *
+ * @param iterator_p The JSONSpanIterator to use.
+ * @param value_p Where the JSONSpan for the element will be stored.
+ * @return <code>true</code> if there was another element, <code>false</code> at the
+ * end of the array or if the array is not valid JSON.
+ * @memberof JSONSpanIterator
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool GetNextJSONSpanElement (JSONSpanIterator *iterator_p, JSONSpan *value_p);
+
+
+/**
+ * Start iterating over a sequence of top-level values separated by
+ * whitespace, such as a JSON Lines document.
+ *
+ * GetNextJSONSpanElement() is then used to get each value in turn.
+ *
+ * @param iterator_p The JSONSpanIterator to initialise.
+ * @param data_s The JSON text.
+ * @param length The length of data_s.
+ * @memberof JSONSpanIterator
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL void InitJSONSpanSequenceIterator (JSONSpanIterator *iterator_p, const char *data_s, const size_t length);
+
+
+/**
+ * Start iterating over the members of an object.
+ *
+ * @param iterator_p The JSONSpanIterator to initialise.
+ * @param object_p The JSONSpan for the object.
+ * @return <code>true</code> if object_p is an object, <code>false</code> otherwise.
+ * @memberof JSONSpanIterator
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool InitJSONSpanMemberIterator (JSONSpanIterator *iterator_p, const JSONSpan *object_p);
+
+
+/**
+ * Get the next member of an object.
+ *
+ * @param iterator_p The JSONSpanIterator to use.
+ * @param key_p Where the JSONSpan for the key, including its quotes, will be stored.
+ * @param value_p Where the JSONSpan for the value will be stored.
+ * @return <code>true</code> if there was another member, <code>false</code> at the
+ * end of the object or if the object is not valid JSON.
+ * @memberof JSONSpanIterator
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool GetNextJSONSpanMember (JSONSpanIterator *iterator_p, JSONSpan *key_p, JSONSpan *value_p);
+
+
+/**
+ * Check whether a JSONSpanIterator stopped because of invalid JSON
+ * rather than by reaching the end of its values.
+ *
+ * @param iterator_p The JSONSpanIterator to check.
+ * @return <code>true</code> if the iterator found invalid JSON, <code>false</code> otherwise.
+ * @memberof JSONSpanIterator
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool HasJSONSpanIteratorFailed (const JSONSpanIterator *iterator_p);
+
+
+/**
+ * Get the real number from a JSONSpan. Since some providers
+ * send their coordinates as strings, both numbers and strings
+ * containing numbers are accepted.
+ *
+ * @param span_p The JSONSpan to convert.
+ * @param value_p Where the number will be stored.
+ * @return <code>true</code> if the value was a valid number, <code>false</code> otherwise.
+ * @memberof JSONSpan
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool GetJSONSpanReal (const JSONSpan *span_p, double64 *value_p);
+
+
+/**
+ * Check whether a JSONSpan is a string with a given value.
+ *
+ * As with GetJSONSpanMember(), the raw text of the string is used.
+ *
+ * @param span_p The JSONSpan to check.
+ * @param value_s The value to compare against.
+ * @return <code>true</code> if the JSONSpan is a string equal to value_s, <code>false</code> otherwise.
+ * @memberof JSONSpan
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool IsJSONSpanStringEqualTo (const JSONSpan *span_p, const char *value_s);
+
+
+/**
+ * Get a copy of the string that a JSONSpan refers to with
+ * all of its escape sequences decoded.
+ *
+ * @param span_p The JSONSpan for the string.
+ * @return The newly-allocated string which should be freed with
+ * FreeCopiedString() or <code>NULL</code> if the JSONSpan is not a
+ * valid string or upon error.
+ * @memberof JSONSpan
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL char *GetJSONSpanString (const JSONSpan *span_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_JSON_ON_DEMAND_H_ */
@@ -0,0 +1,249 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * json_stream.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_JSON_STREAM_H_
+#define LIBS_GEOCODER_INCLUDE_JSON_STREAM_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "byte_buffer.h"
+
+
+/**
+ * The maximum nesting depth of the JSON documents that
+ * a JSONStreamParser can handle.
+ *
+ * @ingroup geocoder_library
+ */
+#define JSON_STREAM_MAX_DEPTH (32)
+
+
+/**
+ * The number of bytes stored for each object key. Longer
+ * keys are truncated.
+ *
+ * @ingroup geocoder_library
+ */
+#define JSON_STREAM_MAX_KEY_LENGTH (32)
+
+
+/**
+ * The events that a JSONStreamParser sends to its callback function.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum
+{
+	JSE_OBJECT_START,
+	JSE_OBJECT_END,
+	JSE_ARRAY_START,
+	JSE_ARRAY_END,
+	JSE_STRING,
+	JSE_NUMBER,
+	JSE_TRUE,
+	JSE_FALSE,
+	JSE_NULL
+} JSONStreamEvent;
+
+
+/**
+ * The values that a JSONStreamParser's callback function and
+ * FeedJSONStreamParser() return.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum
+{
+	/** Keep parsing */
+	JSS_CONTINUE,
+
+	/** The callback has everything that it needs so stop parsing */
+	JSS_STOP,
+
+	/** The data is not valid JSON or the callback failed */
+	JSS_ERROR
+} JSONStreamStatus;
+
+
+struct JSONStreamParser;
+
+
+/**
+ * The function called by a JSONStreamParser for each value in the document.
+ *
+ * @param data_p The custom data that was passed to InitJSONStreamParser().
+ * @param parser_p The JSONStreamParser that is calling this function.
+ * @param event The JSONStreamEvent for this value.
+ * @param depth The nesting depth of this value, with the top-level value being at depth 0.
+ * @param key_s The key for this value if it is within an object, <code>NULL</code> otherwise.
+ * @param value_s For strings, this is the unescaped value and for numbers it is the raw
+ * text of the number. It is always <code>NULL</code>-terminated and is only valid until
+ * this function returns. For all other events this is <code>NULL</code>.
+ * @param value_length The length of value_s.
+ * @return The JSONStreamStatus telling the parser whether to continue.
+ * @ingroup geocoder_library
+ */
+typedef JSONStreamStatus (*JSONStreamCallback) (void *data_p, const struct JSONStreamParser *parser_p, const JSONStreamEvent event, const size_t depth, const char *key_s, const char *value_s, const size_t value_length);
+
+
+/**
+ * An incremental, event-based, JSON tokenizer.
+ *
+ * Data can be fed to it in arbitrarily-sized chunks, such as from a curl
+ * write callback, and it calls a JSONStreamCallback for each value as soon
+ * as that value is complete. This allows the interesting values from a
+ * web service response to be pulled out without building a full jansson
+ * tree and for the transfer to be stopped as soon as they have been found.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct JSONStreamParser
+{
+	/** @private */
+	JSONStreamCallback jsp_callback_fn;
+
+	/** @private */
+	void *jsp_callback_data_p;
+
+	/** @private The buffer for the current string, number or literal */
+	ByteBuffer *jsp_token_p;
+
+	/** @private '{' or '[' for each open container */
+	char jsp_containers [JSON_STREAM_MAX_DEPTH];
+
+	/** @private The current key for each open object */
+	char jsp_keys [JSON_STREAM_MAX_DEPTH][JSON_STREAM_MAX_KEY_LENGTH];
+
+	/** @private The number of open containers */
+	size_t jsp_depth;
+
+	/** @private */
+	int jsp_state;
+
+	/** @private Is the current string an object key? */
+	bool jsp_key_flag;
+
+	/** @private */
+	uint32 jsp_code_point;
+
+	/** @private */
+	uint32 jsp_high_surrogate;
+
+	/** @private */
+	int jsp_num_hex_digits;
+
+	/** @private */
+	JSONStreamStatus jsp_status;
+} JSONStreamParser;
+
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Initialise a JSONStreamParser.
+ *
+ * @param parser_p The JSONStreamParser to initialise.
+ * @param callback_fn The function to call for each value.
+ * @param callback_data_p The custom data to pass to callback_fn.
+ * @return <code>true</code> if the JSONStreamParser was initialised successfully, <code>false</code> otherwise.
+ * @memberof JSONStreamParser
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool InitJSONStreamParser (JSONStreamParser *parser_p, JSONStreamCallback callback_fn, void *callback_data_p);
+
+
+/**
+ * Free any resources used by a JSONStreamParser.
+ *
+ * @param parser_p The JSONStreamParser to clear.
+ * @memberof JSONStreamParser
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL void ClearJSONStreamParser (JSONStreamParser *parser_p);
+
+
+/**
+ * Parse the next chunk of data.
+ *
+ * @param parser_p The JSONStreamParser to use.
+ * @param data_p The data to parse.
+ * @param length The length of data_p.
+ * @return JSS_CONTINUE if more data can be fed to the parser, JSS_STOP
+ * if the callback function has asked to stop and JSS_ERROR upon error.
+ * Once JSS_STOP or JSS_ERROR have been returned, any further data is ignored.
+ * @memberof JSONStreamParser
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL JSONStreamStatus FeedJSONStreamParser (JSONStreamParser *parser_p, const char *data_p, const size_t length);
+
+
+/**
+ * Check whether a JSONStreamParser has parsed a complete
+ * top-level value.
+ *
+ * @param parser_p The JSONStreamParser to check.
+ * @return <code>true</code> if the document is complete, <code>false</code> otherwise.
+ * @memberof JSONStreamParser
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool IsJSONStreamParserComplete (const JSONStreamParser *parser_p);
+
+
+/**
+ * Get the key of an enclosing object member.
+ *
+ * @param parser_p The JSONStreamParser to query. This is typically called from
+ * within a JSONStreamCallback.
+ * @param depth The depth of the value whose key is wanted.
+ * @return The key or <code>NULL</code> if the value at the given depth is not
+ * a member of an object.
+ * @memberof JSONStreamParser
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL const char *GetJSONStreamKey (const JSONStreamParser *parser_p, const size_t depth);
+
+
+/**
+ * Convert a string or number value from a JSONStreamCallback into a real number.
+ *
+ * Some providers such as Nominatim send their coordinates as strings so this
+ * accepts either.
+ *
+ * @param value_s The value to convert.
+ * @param value_p Where the converted value will be stored.
+ * @return <code>true</code> if the whole of value_s was a valid number, <code>false</code> otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool GetJSONStreamReal (const char *value_s, double64 *value_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_JSON_STREAM_H_ */
@@ -0,0 +1,110 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * mapped_file.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * Read-only memory mapping of the binary files, such as the address
+ * caches, admin region indexes, grid shift tables and elevation
+ * tiles, that are read in place rather than loaded.
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_MAPPED_FILE_H_
+#define LIBS_GEOCODER_INCLUDE_MAPPED_FILE_H_
+
+#include <stddef.h>
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+
+
+/**
+ * How the contents of a MappedFile will be read, which lets
+ * the operating system choose how much to read ahead.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum
+{
+	/** The file is usually read from start to end. */
+	MFA_SEQUENTIAL,
+
+	/** Each lookup only reads a few small parts of the file. */
+	MFA_RANDOM
+} MappedFileAccess;
+
+
+/**
+ * A file that is mapped read-only into memory.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct MappedFile
+{
+	/** @private The contents of the file. */
+	const uint8 *mf_data_p;
+
+	/** @private The size of the file in bytes. */
+	size_t mf_size;
+
+	/** @private The mapping handle on Windows, unused elsewhere. */
+	void *mf_handle_p;
+} MappedFile;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Map a file read-only into memory.
+ *
+ * The mapping stays valid until CloseMappedFile () is called,
+ * even though the file itself is closed straight away.
+ *
+ * @param file_p The MappedFile to fill in.
+ * @param filename_s The file to map.
+ * @param min_size The size that the file must be at least, e.g. the
+ * size of its header. This must be greater than 0.
+ * @param access How the file will be read.
+ * @return <code>true</code> if the file was mapped, <code>false</code> if it
+ * couldn't be opened, is too small or upon error. On failure, file_p is
+ * left empty and doesn't need closing.
+ * @memberof MappedFile
+ */
+GRASSROOTS_GEOCODER_LOCAL bool OpenMappedFile (MappedFile *file_p, const char *filename_s, const size_t min_size, const MappedFileAccess access);
+
+
+/**
+ * Unmap a file that was mapped by OpenMappedFile ().
+ * It is safe to call this on an empty MappedFile.
+ *
+ * @param file_p The MappedFile to unmap.
+ * @memberof MappedFile
+ */
+GRASSROOTS_GEOCODER_LOCAL void CloseMappedFile (MappedFile *file_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_MAPPED_FILE_H_ */
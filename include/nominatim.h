@@ -40,6 +40,45 @@ GRASSROOTS_GEOCODER_LOCAL	bool RunNominatimGeocoder (Address *address_p, const c
 GRASSROOTS_GEOCODER_LOCAL	bool RunNominatimReverseGeocoder (Address *address_p, const char *reverse_geocoder_url_s);
 
 
+/**
+ * Parse the results of a Nominatim search call and use the first
+ * valid result to set the centre and bounds of an Address.
+ *
+ * @param address_p The Address to fill in.
+ * @param web_service_results_p The JSON response from the search call.
+ * @return 1 if the Address was updated, 0 if there were no results and -1 upon error.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL int ParseNominatimResults (Address *address_p, const json_t *web_service_results_p);
+
+
+/**
+ * Parse the raw text of the results of a Nominatim search call without
+ * building a jansson tree. This has the same behaviour as
+ * ParseNominatimResults() but only scans as far through the response
+ * as is needed to find the first valid result.
+ *
+ * @param address_p The Address to fill in.
+ * @param response_s The response text from the search call.
+ * @param length The length of response_s.
+ * @return 1 if the Address was updated, 0 if there were no results and -1 upon error.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL int ParseNominatimResultsOnDemand (Address *address_p, const char *response_s, const size_t length);
+
+
+/**
+ * Parse the results of a Nominatim reverse call and use them
+ * to fill in the components of an Address.
+ *
+ * @param address_p The Address to fill in.
+ * @param result_p The JSON response from the reverse call.
+ * @return 1 if the Address was updated, 0 otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL int PopulateAddressForNominatim (Address *address_p, const json_t *result_p);
+
+
 
 #ifdef __cplusplus
 }
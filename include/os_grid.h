@@ -0,0 +1,260 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * os_grid.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * Conversion between WGS84 Coordinates and eastings and northings on the
+ * Ordnance Survey National Grid, which uses the OSGB36 datum, along with
+ * parsing and formatting of grid references such as "TL 123 456".
+ *
+ * Without a GridShiftTable, the datum change is done with a Helmert
+ * transformation, which is accurate to about 5 metres. With the
+ * Ordnance Survey's OSTN15 grid shifts it is accurate to about 10
+ * centimetres. The official OSTN15 data file can be converted into a
+ * GridShiftTable with the grid_shift_converter tool.
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_OS_GRID_H_
+#define LIBS_GEOCODER_INCLUDE_OS_GRID_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "coordinate.h"
+#include "mapped_file.h"
+
+
+/**
+ * The size of buffer needed to hold the longest grid reference
+ * written by GetGridReference (), including its terminating '\0'.
+ *
+ * @ingroup geocoder_library
+ */
+#define OS_GRID_MAX_REFERENCE_LENGTH (15)
+
+
+/**
+ * The maximum number of digits in each of the easting and the northing
+ * of a grid reference, which gives a precision of 1 metre.
+ *
+ * @ingroup geocoder_library
+ */
+#define OS_GRID_MAX_REFERENCE_DIGITS (5)
+
+
+/**
+ * The value used in a GridShiftTable for points that it has no shifts for.
+ *
+ * @ingroup geocoder_library
+ */
+#define OS_GRID_NO_SHIFT (-2147483647 - 1)
+
+
+/**
+ * A position on the National Grid.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct GridPosition
+{
+	/** The distance east of the grid's origin in metres. */
+	double64 gp_easting;
+
+	/** The distance north of the grid's origin in metres. */
+	double64 gp_northing;
+} GridPosition;
+
+
+/**
+ * A memory-mapped table of the shifts between ETRS89 and OSGB36
+ * positions, such as OSTN15.
+ *
+ * The table is a regular grid of points starting at the grid's origin,
+ * each holding the shifts in millimetres that are added to an ETRS89
+ * easting and northing to give the OSGB36 easting and northing.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct GridShiftTable
+{
+	/** @private */
+	MappedFile gst_file;
+
+	/** @private */
+	uint32 gst_num_columns;
+
+	/** @private */
+	uint32 gst_num_rows;
+
+	/** @private */
+	uint32 gst_spacing;
+} GridShiftTable;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Open a GridShiftTable file.
+ *
+ * @param filename_s The filename.
+ * @return The GridShiftTable or <code>NULL</code> upon error.
+ * @memberof GridShiftTable
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API GridShiftTable *OpenGridShiftTable (const char *filename_s);
+
+
+/**
+ * Close a GridShiftTable.
+ *
+ * @param table_p The GridShiftTable to close.
+ * @memberof GridShiftTable
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void CloseGridShiftTable (GridShiftTable *table_p);
+
+
+/**
+ * Save a GridShiftTable file.
+ *
+ * @param filename_s The filename.
+ * @param num_columns The number of points along each row of the table, going east.
+ * @param num_rows The number of rows of the table, going north.
+ * @param spacing The distance between neighbouring points in metres.
+ * @param shifts_p The array of num_columns * num_rows pairs of easting and northing
+ * shifts in millimetres, starting at the south-west corner and going along each row
+ * in turn. Points without shifts should have both set to OS_GRID_NO_SHIFT.
+ * @return <code>true</code> if the file was saved successfully, <code>false</code> otherwise.
+ * @memberof GridShiftTable
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool SaveGridShiftTable (const char *filename_s, const uint32 num_columns, const uint32 num_rows, const uint32 spacing, const int32 *shifts_p);
+
+
+/**
+ * Convert a WGS84 Coordinate to a position on the National Grid.
+ *
+ * @param coord_p The Coordinate to convert.
+ * @param table_p The GridShiftTable to use. If this is <code>NULL</code> or the
+ * Coordinate is outside of the table, a Helmert transformation is used instead.
+ * @param position_p The GridPosition to store the result in.
+ * @return <code>true</code> if the Coordinate was converted successfully, <code>false</code>
+ * if it is not a valid latitude and longitude.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool ConvertCoordinateToGridPosition (const Coordinate *coord_p, const GridShiftTable *table_p, GridPosition *position_p);
+
+
+/**
+ * Convert a position on the National Grid to a WGS84 Coordinate.
+ *
+ * @param position_p The GridPosition to convert.
+ * @param table_p The GridShiftTable to use. If this is <code>NULL</code> or the
+ * position is outside of the table, a Helmert transformation is used instead.
+ * @param coord_p The Coordinate to store the latitude and longitude in. Its
+ * elevation is not changed.
+ * @return <code>true</code> if the position was converted successfully, <code>false</code>
+ * if its easting or northing are not numbers.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool ConvertGridPositionToCoordinate (const GridPosition *position_p, const GridShiftTable *table_p, Coordinate *coord_p);
+
+
+/**
+ * Convert a set of WGS84 Coordinates to positions on the National Grid.
+ *
+ * Large sets are split between several threads.
+ *
+ * @param coords_p The Coordinates to convert.
+ * @param num_coords The number of Coordinates.
+ * @param table_p The GridShiftTable to use. This can be <code>NULL</code>.
+ * @param num_threads The maximum number of threads to use. If this is 0,
+ * one thread per processor will be used.
+ * @param positions_p The array of num_coords GridPositions to store the results in.
+ * Any Coordinates that can't be converted have their eastings and northings
+ * set to NAN.
+ * @return The number of Coordinates that were converted successfully.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API size_t ConvertCoordinatesToGridPositions (const Coordinate *coords_p, const size_t num_coords, const GridShiftTable *table_p, const uint32 num_threads, GridPosition *positions_p);
+
+
+/**
+ * Convert a set of positions on the National Grid to WGS84 Coordinates.
+ *
+ * Large sets are split between several threads.
+ *
+ * @param positions_p The GridPositions to convert.
+ * @param num_positions The number of GridPositions.
+ * @param table_p The GridShiftTable to use. This can be <code>NULL</code>.
+ * @param num_threads The maximum number of threads to use. If this is 0,
+ * one thread per processor will be used.
+ * @param coords_p The array of num_positions Coordinates to store the latitudes
+ * and longitudes in. Their elevations are not changed. Any positions that can't
+ * be converted have their latitudes and longitudes set to NAN.
+ * @return The number of GridPositions that were converted successfully.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API size_t ConvertGridPositionsToCoordinates (const GridPosition *positions_p, const size_t num_positions, const GridShiftTable *table_p, const uint32 num_threads, Coordinate *coords_p);
+
+
+/**
+ * Parse a National Grid reference.
+ *
+ * This accepts two grid letters followed by an easting and a northing
+ * of up to 5 digits each, either as separate groups or run together,
+ * e.g. "TL 123 456", "TL123456" or "tl 12345 67890". The letters on
+ * their own give the 100 kilometre square.
+ *
+ * @param grid_ref_s The grid reference.
+ * @param position_p The GridPosition to store the south-west corner of the
+ * referenced square in.
+ * @param precision_p If this is not <code>NULL</code>, the width of the referenced
+ * square in metres will be stored here, e.g. 100 for "TL 123 456".
+ * @return <code>true</code> if the grid reference was parsed successfully, <code>false</code>
+ * otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool ParseGridReference (const char *grid_ref_s, GridPosition *position_p, double64 *precision_p);
+
+
+/**
+ * Write the National Grid reference for a position.
+ *
+ * @param position_p The GridPosition.
+ * @param num_digits The number of digits to use for each of the easting and the
+ * northing, from 0 to OS_GRID_MAX_REFERENCE_DIGITS.
+ * @param grid_ref_s The buffer of at least OS_GRID_MAX_REFERENCE_LENGTH bytes to
+ * write the grid reference to, e.g. "TL 123 456".
+ * @return <code>true</code> if the grid reference was written successfully, <code>false</code>
+ * if the position is not on the grid or num_digits is too large.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetGridReference (const GridPosition *position_p, const uint32 num_digits, char *grid_ref_s);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_OS_GRID_H_ */
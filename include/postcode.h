@@ -0,0 +1,165 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * postcode.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * Validation and normalisation of postcodes for each country, so that
+ * postcodes which can't be valid aren't sent to the geocoders.
+ *
+ * Each country's postcode formats are compiled into a deterministic
+ * finite automaton the first time that any postcode is checked, so each
+ * check is a single pass over the postcode's characters.
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_POSTCODE_H_
+#define LIBS_GEOCODER_INCLUDE_POSTCODE_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "address.h"
+
+
+/**
+ * The size of a buffer that can hold any normalised postcode,
+ * including its terminating <code>NULL</code>.
+ *
+ * @ingroup geocoder_library
+ */
+#define POSTCODE_BUFFER_SIZE (16)
+
+
+/**
+ * The result of checking a postcode.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum
+{
+	/** The postcode is valid and already in its normal form. */
+	PS_VALID,
+
+	/**
+	 * The postcode is valid once its case and spacing have been
+	 * normalised, e.g. "al52jq" to "AL5 2JQ".
+	 */
+	PS_NORMALISED,
+
+	/**
+	 * The postcode was invalid but has been corrected, either by
+	 * swapping letters and digits that are easily mistaken for each
+	 * other, e.g. "ALS 2JQ" to "AL5 2JQ", or by putting back the leading
+	 * zeros that spreadsheets remove, e.g. "2134" to "02134" in the US.
+	 */
+	PS_CORRECTED,
+
+	/** The postcode can't be valid for the country. */
+	PS_INVALID,
+
+	/** There are no formats for the country so the postcode can't be checked. */
+	PS_UNSUPPORTED_COUNTRY
+} PostcodeStatus;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Check whether the postcodes of a country can be validated.
+ *
+ * @param country_code_s The ISO 3166-1 alpha-2 code of the country.
+ * @return <code>true</code> if the country's postcode formats are known,
+ * <code>false</code> otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool IsPostcodeCountrySupported (const char *country_code_s);
+
+
+/**
+ * Validate, normalise and, if possible, correct a postcode.
+ *
+ * @param postcode_s The postcode.
+ * @param country_code_s The ISO 3166-1 alpha-2 code of the postcode's country.
+ * @param normalised_s If this is not <code>NULL</code>, the buffer of
+ * POSTCODE_BUFFER_SIZE bytes where the normalised or corrected postcode
+ * is stored when the result is PS_VALID, PS_NORMALISED or PS_CORRECTED.
+ * @return The PostcodeStatus of the postcode.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API PostcodeStatus ValidatePostcode (const char *postcode_s, const char *country_code_s, char *normalised_s);
+
+
+/**
+ * Validate a batch of postcodes, such as a column of a file that is
+ * being imported.
+ *
+ * @param postcodes_ss The postcodes. Any of these can be <code>NULL</code>
+ * which is given PS_INVALID.
+ * @param country_codes_ss The country code for each postcode. Any of these
+ * can be <code>NULL</code> which is given PS_UNSUPPORTED_COUNTRY.
+ * @param num_postcodes The number of postcodes.
+ * @param statuses_p The array of num_postcodes PostcodeStatuses to store
+ * the results in.
+ * @param normalised_s If this is not <code>NULL</code>, the buffer of
+ * num_postcodes * POSTCODE_BUFFER_SIZE bytes where the normalised postcodes
+ * are stored, each one POSTCODE_BUFFER_SIZE bytes after the previous one.
+ * Invalid or unchecked postcodes are stored as empty strings.
+ * @return The number of postcodes that are valid, normalised or corrected.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API size_t ValidatePostcodes (const char * const *postcodes_ss, const char * const *country_codes_ss, const size_t num_postcodes, PostcodeStatus *statuses_p, char *normalised_s);
+
+
+/**
+ * Get the postcode of an Address that should be sent to a geocoder.
+ *
+ * @param address_p The Address.
+ * @param postcode_s The buffer of POSTCODE_BUFFER_SIZE bytes to store the
+ * postcode in. This is the normalised or corrected postcode if the
+ * Address's country is supported, or the postcode with any surrounding
+ * whitespace removed if it isn't.
+ * @return <code>true</code> if the Address has a postcode which might be valid,
+ * <code>false</code> if it doesn't have one or it can't be valid.
+ * @memberof Address
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetAddressPostcodeForQuery (const Address *address_p, char *postcode_s);
+
+
+/**
+ * Validate and normalise the postcode of an Address in place. A postcode
+ * that can't be valid is removed.
+ *
+ * @param address_p The Address.
+ * @return The PostcodeStatus of the Address's original postcode, which is
+ * PS_INVALID if it didn't have one.
+ * @memberof Address
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API PostcodeStatus CorrectAddressPostcode (Address *address_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_POSTCODE_H_ */
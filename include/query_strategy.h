@@ -0,0 +1,287 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * query_strategy.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * The geocoders that accept both a structured query, with a parameter
+ * for each field of an Address, and a free-text one can try them in
+ * either order. The hit rate of each form is recorded for each
+ * provider and each combination of fields that an Address has, e.g.
+ * just a postcode or a town and a country, so that the form most
+ * likely to find a location is tried first. Alternatively, both forms
+ * can be sent at the same time and the first location found is used.
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_QUERY_STRATEGY_H_
+#define LIBS_GEOCODER_INCLUDE_QUERY_STRATEGY_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "address.h"
+#include "byte_buffer.h"
+#include "curl_tools.h"
+
+
+/**
+ * The ways that an Address can be sent to a geocoder.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum
+{
+	/** A separate parameter for each of the Address's fields. */
+	QF_STRUCTURED,
+
+	/** All of the Address's fields in a single parameter. */
+	QF_FREE_TEXT,
+
+	/** The number of forms. */
+	QF_NUM_FORMS
+} QueryForm;
+
+
+/**
+ * The geocoders that can be sent either QueryForm.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum
+{
+	/** The Google geocoder. */
+	QP_GOOGLE,
+
+	/** The Nominatim geocoder. */
+	QP_NOMINATIM,
+
+	/** The number of providers. */
+	QP_NUM_PROVIDERS
+} QueryProvider;
+
+
+/**
+ * How a QueryProvider chooses between the QueryForms.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum
+{
+	/**
+	 * Try the form with the best hit rate for the Address's fields
+	 * first and the other one if that doesn't find anything. This
+	 * is the default.
+	 */
+	QM_ADAPTIVE,
+
+	/** Always try the provider's default form first. */
+	QM_FIXED,
+
+	/**
+	 * Send both forms at the same time and use the first location
+	 * that is found.
+	 */
+	QM_CONCURRENT
+} QueryMode;
+
+
+/*
+ * The bits for each of an Address's fields that are used
+ * to keep the hit rates.
+ */
+
+/** The bit for an Address's name. @ingroup geocoder_library */
+#define QS_NAME_FIELD (1 << 0)
+
+/** The bit for an Address's street. @ingroup geocoder_library */
+#define QS_STREET_FIELD (1 << 1)
+
+/** The bit for an Address's town. @ingroup geocoder_library */
+#define QS_TOWN_FIELD (1 << 2)
+
+/** The bit for an Address's county. @ingroup geocoder_library */
+#define QS_COUNTY_FIELD (1 << 3)
+
+/** The bit for an Address's postcode. @ingroup geocoder_library */
+#define QS_POSTCODE_FIELD (1 << 4)
+
+/** The bit for an Address's country or country code. @ingroup geocoder_library */
+#define QS_COUNTRY_FIELD (1 << 5)
+
+/** The number of combinations of fields. @ingroup geocoder_library */
+#define QS_NUM_FIELD_SETS (1 << 6)
+
+
+/**
+ * A function that appends the query for an Address to the url of a
+ * geocoder.
+ *
+ * @param buffer_p The ByteBuffer holding the url.
+ * @param address_p The Address.
+ * @return <code>true</code> if the query was added, <code>false</code> if
+ * the Address can't be sent in this form or upon error.
+ * @ingroup geocoder_library
+ */
+typedef bool (*BuildQueryFunction) (ByteBuffer *buffer_p, const Address * const address_p);
+
+
+/**
+ * A function that calls a geocoder and stores the location that it finds
+ * in an Address.
+ *
+ * @param curl_p The CurlTool to make the call with.
+ * @param url_s The url to call.
+ * @param address_p The Address to store the location in.
+ * @return 1 if a location was found, 0 if the geocoder found nothing
+ * and -1 upon error.
+ * @ingroup geocoder_library
+ */
+typedef int (*CallQueryFunction) (CurlTool *curl_p, const char *url_s, Address *address_p);
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Get the bits, from QS_NAME_FIELD to QS_COUNTRY_FIELD, for the
+ * fields that an Address has.
+ *
+ * @param address_p The Address.
+ * @return The bits for the Address's fields.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API uint32 GetAddressQueryFields (const Address *address_p);
+
+
+/**
+ * Get the QueryMode for a value of the "query_forms" configuration
+ * key, which is one of "adaptive", "fixed" or "concurrent".
+ *
+ * @param mode_s The value.
+ * @param mode_p Where the QueryMode will be stored.
+ * @return <code>true</code> if the value is known, <code>false</code> otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool GetQueryModeFromString (const char *mode_s, QueryMode *mode_p);
+
+
+/**
+ * Set how a QueryProvider chooses between the QueryForms.
+ *
+ * The QueryModes and hit rates are shared by the whole process, so this
+ * should only be called at startup. The "query_forms" configuration key
+ * is applied when a GeocoderTool is built, which is once for each server.
+ *
+ * @param provider The QueryProvider.
+ * @param mode The QueryMode to use.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void SetQueryMode (const QueryProvider provider, const QueryMode mode);
+
+
+/**
+ * Get how a QueryProvider chooses between the QueryForms.
+ *
+ * @param provider The QueryProvider.
+ * @return The QueryMode.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API QueryMode GetQueryMode (const QueryProvider provider);
+
+
+/**
+ * Choose the QueryForm to try first. Only the results of the form that is
+ * tried first are recorded, so until both forms have been tried first
+ * enough times for the given fields, they take turns. After that, the one
+ * with the better hit rate is chosen apart from one call in every 16,
+ * when the other one is, so that both forms keep getting tried.
+ *
+ * @param provider The QueryProvider.
+ * @param fields The bits for the Address's fields from GetAddressQueryFields ().
+ * @param default_form The QueryForm to use when both forms have the same
+ * number of results so far.
+ * @return The QueryForm to try first.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API QueryForm ChooseFirstQueryForm (const QueryProvider provider, const uint32 fields, const QueryForm default_form);
+
+
+/**
+ * Record whether a query found a location.
+ *
+ * @param provider The QueryProvider that was called.
+ * @param fields The bits for the Address's fields from GetAddressQueryFields ().
+ * @param form The QueryForm that was sent.
+ * @param hit_flag <code>true</code> if a location was found, <code>false</code>
+ * otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void RecordQueryResult (const QueryProvider provider, const uint32 fields, const QueryForm form, const bool hit_flag);
+
+
+/**
+ * Get the recorded results for a QueryForm. Older results are gradually
+ * given less weight so these are approximate once there are many of them.
+ *
+ * @param provider The QueryProvider.
+ * @param fields The bits for the Address's fields from GetAddressQueryFields ().
+ * @param form The QueryForm.
+ * @param attempts_p Where the number of queries will be stored.
+ * @param hits_p Where the number of queries that found a location will be stored.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void GetQueryFormResults (const QueryProvider provider, const uint32 fields, const QueryForm form, uint32 *attempts_p, uint32 *hits_p);
+
+
+/**
+ * Clear all of the recorded results for a QueryProvider.
+ *
+ * @param provider The QueryProvider.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void ResetQueryResults (const QueryProvider provider);
+
+
+/**
+ * Geocode an Address with whichever QueryForms it can be sent as,
+ * using the QueryProvider's QueryMode, and record the results.
+ *
+ * @param provider The QueryProvider.
+ * @param address_p The Address to geocode.
+ * @param uri_s The url of the geocoder that the queries are appended to.
+ * @param build_fns_p The BuildQueryFunction for each QueryForm.
+ * @param call_fn The function to call the geocoder with. This can be
+ * called on other threads, each with a different CurlTool and its own
+ * copy of address_p.
+ * @param default_form The QueryForm to try first when there isn't
+ * enough to go on.
+ * @return <code>true</code> if a location was found, <code>false</code>
+ * otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool RunQueryForms (const QueryProvider provider, Address *address_p, const char *uri_s, const BuildQueryFunction *build_fns_p, CallQueryFunction call_fn, const QueryForm default_form);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_QUERY_STRATEGY_H_ */
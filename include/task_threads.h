@@ -0,0 +1,85 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * task_threads.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * Splitting a large batch of work, such as a distance matrix or a set
+ * of addresses, into tasks and running each of them on its own thread.
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_TASK_THREADS_H_
+#define LIBS_GEOCODER_INCLUDE_TASK_THREADS_H_
+
+#include <stddef.h>
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+
+
+/**
+ * A function that runs a single task.
+ *
+ * @param task_p The task to run.
+ * @ingroup geocoder_library
+ */
+typedef void (*TaskFunction) (void *task_p);
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Get the number of threads to split a batch of work between.
+ *
+ * @param num_threads The number of threads asked for, or 0 to use one
+ * per processor.
+ * @param num_items The number of items in the batch.
+ * @param min_items_per_thread The smallest number of items that is worth
+ * starting a thread for.
+ * @return The number of threads to use, which is always at least 1.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL uint32 GetNumberOfTaskThreads (const uint32 num_threads, const size_t num_items, const size_t min_items_per_thread);
+
+
+/**
+ * Run an array of tasks, each on its own thread, and wait for them
+ * all to finish.
+ *
+ * The first task is run on the calling thread, as is any task whose
+ * thread can't be started, so every task is always run.
+ *
+ * @param task_fn The function to run each task with.
+ * @param tasks_p The array of tasks.
+ * @param task_size The size in bytes of each task.
+ * @param num_tasks The number of tasks.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL void RunTasksOnThreads (TaskFunction task_fn, void *tasks_p, const size_t task_size, const uint32 num_tasks);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_TASK_THREADS_H_ */
@@ -0,0 +1,251 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * town_matcher.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * Fuzzy matching of misspelt town names, such as "Rothamstead" or
+ * "Harpendon", against a set of known names from a gazetteer or from
+ * previously geocoded Addresses.
+ *
+ * Names are compared after converting them to lower case and replacing
+ * any runs of spaces and punctuation with a single space. Candidates
+ * are found with an inverted index of the trigrams of each name and are
+ * then checked with Myers' bit-parallel edit distance algorithm.
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_TOWN_MATCHER_H_
+#define LIBS_GEOCODER_INCLUDE_TOWN_MATCHER_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "address.h"
+#include "address_record.h"
+#include "admin_regions.h"
+
+
+/**
+ * The max_distance to pass to FindTownMatch () to have it chosen
+ * from the length of the name: none for names of up to 3 characters,
+ * 1 for up to 7 characters and 2 for anything longer.
+ *
+ * @ingroup geocoder_library
+ */
+#define TOWN_MATCHER_AUTO_DISTANCE (0xFFFFFFFF)
+
+
+/**
+ * A town name found by FindTownMatch ().
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct TownMatch
+{
+	/**
+	 * The name as it was added to the TownMatcher. This is only valid
+	 * until the TownMatcher is freed.
+	 */
+	const char *tm_town_s;
+
+	/**
+	 * The country code that the name was added with, or <code>NULL</code>
+	 * if it was added without one.
+	 */
+	const char *tm_country_code_s;
+
+	/** The edit distance between the matched name and the one searched for. */
+	uint32 tm_distance;
+} TownMatch;
+
+
+/**
+ * An index of town names for fuzzy matching.
+ *
+ * Once it has been filled, a TownMatcher can be searched by several
+ * threads at the same time. Names must not be added to it while it is
+ * being searched.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct TownMatcher
+{
+	/** @private */
+	struct TownEntry *tm_towns_p;
+
+	/** @private */
+	uint32 tm_num_towns;
+
+	/** @private */
+	uint32 tm_towns_capacity;
+
+	/** @private */
+	uint32 *tm_town_slots_p;
+
+	/** @private */
+	uint32 tm_town_slots_capacity;
+
+	/** @private */
+	struct TrigramPostings *tm_trigrams_p;
+
+	/** @private */
+	uint32 tm_num_trigrams;
+
+	/** @private */
+	uint32 tm_trigrams_capacity;
+
+	/** @private */
+	struct CachedTownRecord *tm_records_p;
+
+	/** @private */
+	size_t tm_num_records;
+
+	/** @private */
+	size_t tm_records_capacity;
+
+	/** @private */
+	struct TownMatcherSync *tm_sync_p;
+} TownMatcher;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Allocate an empty TownMatcher.
+ *
+ * @return The TownMatcher or <code>NULL</code> upon error.
+ * @memberof TownMatcher
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API TownMatcher *AllocateTownMatcher (void);
+
+
+/**
+ * Free a TownMatcher.
+ *
+ * @param matcher_p The TownMatcher to free.
+ * @memberof TownMatcher
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API void FreeTownMatcher (TownMatcher *matcher_p);
+
+
+/**
+ * Add a town name to a TownMatcher. Adding a name that is already there
+ * has no effect.
+ *
+ * @param matcher_p The TownMatcher to add the name to.
+ * @param town_s The name of the town.
+ * @param country_code_s The code of the town's country. If this is
+ * <code>NULL</code>, the name will match in every country.
+ * @return <code>true</code> if the name was added successfully, <code>false</code>
+ * otherwise.
+ * @memberof TownMatcher
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddTownToMatcher (TownMatcher *matcher_p, const char *town_s, const char *country_code_s);
+
+
+/**
+ * Add the names of the towns, which are the regions at admin_level 7
+ * and 8, from an AdminRegionIndex to a TownMatcher.
+ *
+ * @param matcher_p The TownMatcher to add the names to.
+ * @param index_p The AdminRegionIndex to get the names from.
+ * @return <code>true</code> if the names were added successfully, <code>false</code>
+ * otherwise.
+ * @memberof TownMatcher
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddAdminRegionsToTownMatcher (TownMatcher *matcher_p, const AdminRegionIndex *index_p);
+
+
+/**
+ * Add the town names from a file of previously geocoded Addresses to a
+ * TownMatcher. The records are remembered too, so that
+ * SetAddressFromTownMatcherCache () can find them.
+ *
+ * @param matcher_p The TownMatcher to add the names to.
+ * @param record_file_p The AddressRecordFile to get the names from. This
+ * must not be closed until the TownMatcher has been freed.
+ * @return <code>true</code> if the names were added successfully, <code>false</code>
+ * otherwise.
+ * @memberof TownMatcher
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool AddAddressRecordsToTownMatcher (TownMatcher *matcher_p, const AddressRecordFile *record_file_p);
+
+
+/**
+ * Find the known town name that is closest to a given one.
+ *
+ * @param matcher_p The TownMatcher to search.
+ * @param town_s The town name to search for.
+ * @param country_code_s If this is not <code>NULL</code>, only names added
+ * without a country code or with this one are matched.
+ * @param max_distance The largest edit distance to accept or
+ * TOWN_MATCHER_AUTO_DISTANCE to choose it from the length of town_s.
+ * @param match_p Where to store the match.
+ * @return <code>true</code> if exactly one name is the closest and it is
+ * within max_distance, <code>false</code> otherwise.
+ * @memberof TownMatcher
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool FindTownMatch (const TownMatcher *matcher_p, const char *town_s, const char *country_code_s, const uint32 max_distance, TownMatch *match_p);
+
+
+/**
+ * Replace a misspelt town name in an Address with the closest known one,
+ * using TOWN_MATCHER_AUTO_DISTANCE and the Address's country code.
+ *
+ * @param matcher_p The TownMatcher to search.
+ * @param address_p The Address whose town will be corrected.
+ * @return <code>true</code> if the town was changed, <code>false</code> if it
+ * was already correct, no match was found or upon error.
+ * @memberof TownMatcher
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool CorrectAddressTown (const TownMatcher *matcher_p, Address *address_p);
+
+
+/**
+ * Fill in an Address from a record added with AddAddressRecordsToTownMatcher ().
+ *
+ * A record is used if it has a centre Coordinate and the same town as the
+ * Address, along with the same values for any of the name, street, county,
+ * country and postcode that the Address has. Case is ignored throughout.
+ *
+ * @param matcher_p The TownMatcher to search.
+ * @param address_p The Address to fill in.
+ * @return <code>true</code> if a record was found and copied to the Address,
+ * <code>false</code> otherwise.
+ * @memberof TownMatcher
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_API bool SetAddressFromTownMatcherCache (const TownMatcher *matcher_p, Address *address_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_TOWN_MATCHER_H_ */
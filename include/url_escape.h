@@ -0,0 +1,107 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * url_escape.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_URL_ESCAPE_H_
+#define LIBS_GEOCODER_INCLUDE_URL_ESCAPE_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "byte_buffer.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Percent-encode a string and append it to a ByteBuffer.
+ *
+ * The unreserved characters from RFC 3986 (letters, digits and "-._~")
+ * are copied verbatim and every other byte is written as %XX, which gives the
+ * same output as curl_easy_escape() without needing a CurlTool or a temporary
+ * string. The buffer is grown at most once per call.
+ *
+ * @param buffer_p The ByteBuffer to append the escaped value to.
+ * @param value_s The value to escape.
+ * @param spaces_as_plus_flag If this is <code>true</code> then spaces will be
+ * written as "+" rather than "%20".
+ * @return <code>true</code> if the value was appended successfully, <code>false</code> otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool AppendURLEscapedStringToByteBuffer (ByteBuffer *buffer_p, const char *value_s, const bool spaces_as_plus_flag);
+
+
+/**
+ * Percent-encode a given number of bytes and append them to a ByteBuffer.
+ *
+ * This is the same as AppendURLEscapedStringToByteBuffer() but for
+ * data that is not necessarily <code>NULL</code>-terminated.
+ *
+ * @param buffer_p The ByteBuffer to append the escaped value to.
+ * @param value_s The data to escape.
+ * @param length The number of bytes of value_s to escape.
+ * @param spaces_as_plus_flag If this is <code>true</code> then spaces will be
+ * written as "+" rather than "%20".
+ * @return <code>true</code> if the value was appended successfully, <code>false</code> otherwise.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool AppendURLEscapedDataToByteBuffer (ByteBuffer *buffer_p, const char *value_s, const size_t length, const bool spaces_as_plus_flag);
+
+
+/**
+ * Percent-encode a given number of bytes into a caller-supplied buffer.
+ *
+ * No checks are made on the size of the destination so the caller
+ * must make sure that it has room for at least GetURLEscapedLength()
+ * bytes. No terminating '\0' is written.
+ *
+ * @param dest_p The buffer to write the escaped value to.
+ * @param value_s The data to escape.
+ * @param length The number of bytes of value_s to escape.
+ * @param spaces_as_plus_flag If this is <code>true</code> then spaces will be
+ * written as "+" rather than "%20".
+ * @return The position in dest_p immediately after the escaped value.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL char *WriteURLEscapedData (char *dest_p, const char *value_s, const size_t length, const bool spaces_as_plus_flag);
+
+
+/**
+ * Get the number of bytes that a value will need once it has
+ * been percent-encoded.
+ *
+ * @param value_s The data to check.
+ * @param length The number of bytes of value_s to check.
+ * @return The length of the escaped value, not including any terminating '\0'.
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL size_t GetURLEscapedLength (const char *value_s, const size_t length);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_URL_ESCAPE_H_ */
@@ -0,0 +1,205 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * url_template.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#ifndef LIBS_GEOCODER_INCLUDE_URL_TEMPLATE_H_
+#define LIBS_GEOCODER_INCLUDE_URL_TEMPLATE_H_
+
+#include "grassroots_geocoder_library.h"
+#include "typedefs.h"
+#include "byte_buffer.h"
+#include "address.h"
+
+
+/**
+ * The values from an Address that can be used
+ * as a slot within a URLTemplate.
+ *
+ * @ingroup geocoder_library
+ */
+typedef enum
+{
+	/** Address::ad_name_s, using "{name}" */
+	UTS_NAME,
+
+	/** Address::ad_street_s, using "{street}" */
+	UTS_STREET,
+
+	/** Address::ad_town_s, using "{town}" or "{city}" */
+	UTS_TOWN,
+
+	/** Address::ad_county_s, using "{county}" */
+	UTS_COUNTY,
+
+	/** Address::ad_country_s, using "{country}" */
+	UTS_COUNTRY,
+
+	/** Address::ad_country_code_s, using "{country_code}" */
+	UTS_COUNTRY_CODE,
+
+	/** Address::ad_postcode_s, using "{postcode}" */
+	UTS_POSTCODE,
+
+	/** The latitude of Address::ad_gps_centre_p, using "{lat}" */
+	UTS_LATITUDE,
+
+	/** The longitude of Address::ad_gps_centre_p, using "{lon}" */
+	UTS_LONGITUDE,
+
+	/** The comma-separated name, street, town, county and country, using "{address}" */
+	UTS_ADDRESS,
+
+	/** The number of available slots */
+	UTS_NUM_SLOTS
+} URLTemplateSlot;
+
+
+/**
+ * A piece of a compiled URLTemplate.
+ *
+ * Each segment is some literal text followed, optionally, by a slot.
+ *
+ * @private
+ * @ingroup geocoder_library
+ */
+typedef struct URLTemplateSegment
+{
+	/** The literal text which points into URLTemplate::ut_template_s */
+	const char *uts_literal_s;
+
+	/** The length of uts_literal_s */
+	size_t uts_literal_length;
+
+	/**
+	 * Optional text that is only written if the slot has a value,
+	 * e.g. "&street=". This points into URLTemplate::ut_template_s
+	 */
+	const char *uts_prefix_s;
+
+	/** The length of uts_prefix_s */
+	size_t uts_prefix_length;
+
+	/** The slot to fill or UTS_NUM_SLOTS if this segment is only literal text */
+	URLTemplateSlot uts_slot;
+} URLTemplateSegment;
+
+
+/**
+ * A geocoder web address with named slots that are filled in
+ * from an Address.
+ *
+ * The template is compiled once into literal segments and slot indices so
+ * that building a url is a single pass with a single allocation. A slot is
+ * written as "{name}" and is always expanded, with an empty value if the
+ * Address does not have it. A slot can also be written as "{&key=name}",
+ * where everything up to and including the "=" is only written if the
+ * Address has a value for that slot. For example
+ *
+ * <code>https://nominatim.openstreetmap.org/search?format=json{&street=street}{&city=town}{&postalcode=postcode}</code>
+ *
+ * Compiling a template is the expensive part, so a URLTemplate should be
+ * kept for as long as its geocoder is used. Building a url only reads it,
+ * so several threads can use the same URLTemplate at the same time.
+ *
+ * @ingroup geocoder_library
+ */
+typedef struct URLTemplate
+{
+	/** @private Our copy of the template that the segments point into */
+	char *ut_template_s;
+
+	/** @private The compiled segments */
+	URLTemplateSegment *ut_segments_p;
+
+	/** @private The number of compiled segments */
+	size_t ut_num_segments;
+
+	/** @private The total length of all of the literal text */
+	size_t ut_literal_length;
+
+	/** @private A bitmask of which URLTemplateSlots are used */
+	uint32 ut_used_slots;
+} URLTemplate;
+
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/**
+ * Compile a URLTemplate.
+ *
+ * @param template_s The template to compile.
+ * @return The newly-allocated URLTemplate or <code>NULL</code> upon error, such
+ * as an unknown slot name or an unterminated slot.
+ * @memberof URLTemplate
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL URLTemplate *AllocateURLTemplate (const char *template_s);
+
+
+/**
+ * Free a URLTemplate.
+ *
+ * @param template_p The URLTemplate to free.
+ * @memberof URLTemplate
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL void FreeURLTemplate (URLTemplate *template_p);
+
+
+/**
+ * Check whether a URLTemplate uses a given slot.
+ *
+ * @param template_p The URLTemplate to check.
+ * @param slot The URLTemplateSlot to check for.
+ * @return <code>true</code> if the slot is used, <code>false</code> otherwise.
+ * @memberof URLTemplate
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool DoesURLTemplateUseSlot (const URLTemplate *template_p, const URLTemplateSlot slot);
+
+
+/**
+ * Fill in a URLTemplate from an Address and append the resultant url to a ByteBuffer.
+ *
+ * The length of the url is calculated first so that the ByteBuffer is
+ * resized at most once and then each segment is written straight into it.
+ *
+ * @param template_p The URLTemplate to use.
+ * @param address_p The Address to get the slot values from.
+ * @param buffer_p The ByteBuffer to append the url to.
+ * @return <code>true</code> if the url was built successfully, <code>false</code> otherwise.
+ * @memberof URLTemplate
+ * @ingroup geocoder_library
+ */
+GRASSROOTS_GEOCODER_LOCAL bool BuildURLFromTemplate (const URLTemplate *template_p, const Address *address_p, ByteBuffer *buffer_p);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LIBS_GEOCODER_INCLUDE_URL_TEMPLATE_H_ */
@@ -154,6 +154,11 @@ void ClearAddress (Address *address_p)
 			FreeCoordinate (address_p -> ad_gps_south_west_p);
 		}
 
+	if (address_p -> ad_elevation_p)
+		{
+			FreeMemory (address_p -> ad_elevation_p);
+		}
+
 	memset (address_p, 0, sizeof (Address));
 }
 
@@ -459,6 +464,30 @@ bool SetAddressSouthWestCoordinate (Address *address_p, const double64 latitude,
 }
 
 
+bool CopyAddressLocation (Address *dest_p, const Address *src_p)
+{
+	bool success_flag = false;
+	const Coordinate *coord_p = src_p -> ad_gps_centre_p;
+
+	if (coord_p)
+		{
+			success_flag = SetAddressCentreCoordinate (dest_p, coord_p -> co_x, coord_p -> co_y, coord_p -> co_elevation_p);
+
+			if (success_flag && ((coord_p = src_p -> ad_gps_north_east_p) != NULL))
+				{
+					success_flag = SetAddressNorthEastCoordinate (dest_p, coord_p -> co_x, coord_p -> co_y, coord_p -> co_elevation_p);
+				}
+
+			if (success_flag && ((coord_p = src_p -> ad_gps_south_west_p) != NULL))
+				{
+					success_flag = SetAddressSouthWestCoordinate (dest_p, coord_p -> co_x, coord_p -> co_y, coord_p -> co_elevation_p);
+				}
+		}
+
+	return success_flag;
+}
+
+
 
 
 static bool SetCoordinateValue (Coordinate **coord_pp, const double64 latitude, const double64 longitude, const double64 *elevation_p)
@@ -532,4 +561,4 @@ static bool AddAddressComponent (ByteBuffer *buffer_p, const char *address_value
 
 	return success_flag;
 }
-
+
@@ -0,0 +1,196 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * address_bounds.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <string.h>
+
+#include "address_bounds.h"
+
+
+/* The number of rows that are gathered before they are compared */
+#define AB_BLOCK_SIZE (256)
+
+
+/* A block of rows with their points and bounds held in separate arrays */
+typedef struct BoundsBlock
+{
+	int32 bb_latitudes [AB_BLOCK_SIZE];
+	int32 bb_longitudes [AB_BLOCK_SIZE];
+	int32 bb_south [AB_BLOCK_SIZE];
+	int32 bb_north [AB_BLOCK_SIZE];
+	int32 bb_west [AB_BLOCK_SIZE];
+	int32 bb_east [AB_BLOCK_SIZE];
+	uint8 bb_inside [AB_BLOCK_SIZE];
+} BoundsBlock;
+
+
+static bool GetCheckBounds (const Address *address_p, const double64 tolerance, FixedBoundingBox *box_p);
+
+static void CheckBoundsBlock (BoundsBlock *block_p, const size_t num_rows);
+
+
+
+bool GetAddressBoundingBox (const Address *address_p, FixedBoundingBox *box_p)
+{
+	if ((address_p -> ad_gps_south_west_p) && (address_p -> ad_gps_north_east_p))
+		{
+			FixedBoundingBox box;
+
+			if (SetFixedBoundingBox (&box, address_p -> ad_gps_south_west_p, address_p -> ad_gps_north_east_p) && (box.fbb_south_west.fc_latitude <= box.fbb_north_east.fc_latitude))
+				{
+					*box_p = box;
+					return true;
+				}
+		}
+
+	return false;
+}
+
+
+AddressBoundsCheck CheckCoordinateAgainstAddressBounds (const Coordinate *point_p, const Address *address_p, const double64 tolerance)
+{
+	FixedCoordinate point;
+	FixedBoundingBox box;
+
+	if (!SetFixedCoordinateFromCoordinate (&point, point_p))
+		{
+			return ABC_INVALID_COORDINATE;
+		}
+
+	if (!GetCheckBounds (address_p, tolerance, &box))
+		{
+			return ABC_NO_BOUNDS;
+		}
+
+	return DoesFixedBoundingBoxContain (&box, &point) ? ABC_INSIDE : ABC_OUTSIDE;
+}
+
+
+size_t CheckCoordinatesAgainstAddressBounds (const Coordinate *points_p, const Address * const *addresses_pp, const size_t num_points, const double64 tolerance, AddressBoundsCheck *results_p)
+{
+	BoundsBlock block;
+	FixedBoundingBox box;
+	const Address *previous_address_p = NULL;
+	bool bounds_flag = false;
+	size_t num_outside = 0;
+	size_t start;
+
+	memset (&box, 0, sizeof (FixedBoundingBox));
+
+	for (start = 0; start < num_points; start += AB_BLOCK_SIZE)
+		{
+			const size_t num_rows = (num_points - start < AB_BLOCK_SIZE) ? (num_points - start) : AB_BLOCK_SIZE;
+			size_t i;
+
+			/*
+			 * Gather the points and bounds. Rows that can't be compared get
+			 * their results now and ABC_INSIDE marks the ones that still
+			 * need checking.
+			 */
+			for (i = 0; i < num_rows; ++ i)
+				{
+					const size_t row = start + i;
+					const Address *address_p = addresses_pp [row];
+					FixedCoordinate point;
+
+					if (address_p != previous_address_p)
+						{
+							bounds_flag = GetCheckBounds (address_p, tolerance, &box);
+							previous_address_p = address_p;
+						}
+
+					if (!SetFixedCoordinateFromCoordinate (&point, points_p + row))
+						{
+							point.fc_latitude = 0;
+							point.fc_longitude = 0;
+
+							results_p [row] = ABC_INVALID_COORDINATE;
+						}
+					else if (!bounds_flag)
+						{
+							results_p [row] = ABC_NO_BOUNDS;
+						}
+					else
+						{
+							results_p [row] = ABC_INSIDE;
+						}
+
+					block.bb_latitudes [i] = point.fc_latitude;
+					block.bb_longitudes [i] = point.fc_longitude;
+					block.bb_south [i] = box.fbb_south_west.fc_latitude;
+					block.bb_north [i] = box.fbb_north_east.fc_latitude;
+					block.bb_west [i] = box.fbb_south_west.fc_longitude;
+					block.bb_east [i] = box.fbb_north_east.fc_longitude;
+				}
+
+			CheckBoundsBlock (&block, num_rows);
+
+			for (i = 0; i < num_rows; ++ i)
+				{
+					AddressBoundsCheck *result_p = results_p + start + i;
+
+					if ((*result_p == ABC_INSIDE) && (!block.bb_inside [i]))
+						{
+							*result_p = ABC_OUTSIDE;
+							++ num_outside;
+						}
+				}
+		}
+
+	return num_outside;
+}
+
+
+static bool GetCheckBounds (const Address *address_p, const double64 tolerance, FixedBoundingBox *box_p)
+{
+	/* A missing Address has no bounds to check against */
+	if (address_p && GetAddressBoundingBox (address_p, box_p))
+		{
+			return (tolerance > 0.0) ? ExpandFixedBoundingBoxByDistance (box_p, tolerance, box_p) : true;
+		}
+
+	return false;
+}
+
+
+/*
+ * The same test as DoesFixedBoundingBoxContain () but using bitwise
+ * operators so that there are no branches to stop the loop being
+ * vectorised.
+ */
+static void CheckBoundsBlock (BoundsBlock *block_p, const size_t num_rows)
+{
+	size_t i;
+
+	for (i = 0; i < num_rows; ++ i)
+		{
+			const int32 latitude = block_p -> bb_latitudes [i];
+			const int32 longitude = block_p -> bb_longitudes [i];
+			const int32 west = block_p -> bb_west [i];
+			const int32 east = block_p -> bb_east [i];
+			const int in_latitude = (latitude >= block_p -> bb_south [i]) & (latitude <= block_p -> bb_north [i]);
+			const int east_of_west = (longitude >= west);
+			const int west_of_east = (longitude <= east);
+			const int crosses_antimeridian = (west > east);
+
+			block_p -> bb_inside [i] = (uint8) (in_latitude & ((east_of_west & west_of_east) | (crosses_antimeridian & (east_of_west | west_of_east))));
+		}
+}
@@ -0,0 +1,599 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * address_bson.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * The documents written here have the same layout that the server's
+ * JSON to BSON conversion gives for GetAddressAsJSON () so that
+ * existing records can be read by either route.
+ */
+
+#include <string.h>
+
+#include "address_bson.h"
+#include "country_codes.h"
+#include "double_conversion.h"
+
+#include "memory_allocations.h"
+#include "streams.h"
+#include "string_utils.h"
+
+
+static const char * const S_TYPE_KEY_S = "@type";
+static const char * const S_POSTAL_ADDRESS_S = "PostalAddress";
+static const char * const S_GEO_COORDINATES_S = "so:GeoCoordinates";
+
+
+static bool AddPostalAddressToBSON (const Address *address_p, bson_t *dest_p);
+
+static bool AddValidBSONField (bson_t *bson_p, const char *key_s, const char *value_s);
+
+static bool SetPostalAddressFromBSON (Address *address_p, const bson_iter_t *postal_address_iter_p);
+
+static bool SetLocationFromBSON (Address *address_p, const bson_iter_t *location_iter_p);
+
+static bool GetCoordinateFromBSON (const bson_iter_t *coord_iter_p, double64 *latitude_p, double64 *longitude_p, double64 *elevation_p, bool *has_elevation_p);
+
+static bool GetCoordinateValuesFromBSON (bson_iter_t *iter_p, double64 *latitude_p, double64 *longitude_p, double64 *elevation_p, bool *has_elevation_p);
+
+static bool GetBSONReal (const bson_iter_t *iter_p, double64 *value_p);
+
+static char *CopyBSONString (const bson_iter_t *iter_p);
+
+static void ReplaceAddressString (char **value_ss, char *value_s);
+
+static void RemoveCoordinate (Coordinate **coord_pp);
+
+
+
+bool AddCoordinateToBSON (const Coordinate *coord_p, bson_t *dest_p, const char * const coord_key_s)
+{
+	bool success_flag = true;
+
+	if (coord_p)
+		{
+			bson_t coord_bson;
+
+			success_flag = false;
+
+			if (bson_append_document_begin (dest_p, coord_key_s, -1, &coord_bson))
+				{
+					if (bson_append_utf8 (&coord_bson, S_TYPE_KEY_S, -1, S_GEO_COORDINATES_S, -1) &&
+							bson_append_double (&coord_bson, CO_LATITUDE_S, -1, coord_p -> co_x) &&
+							bson_append_double (&coord_bson, CO_LONGITUDE_S, -1, coord_p -> co_y))
+						{
+							success_flag = true;
+
+							if (coord_p -> co_elevation_p)
+								{
+									success_flag = bson_append_double (&coord_bson, CO_ELEVATION_S, -1, * (coord_p -> co_elevation_p));
+								}
+						}
+
+					/* The child must always be ended, even after an error */
+					if (!bson_append_document_end (dest_p, &coord_bson))
+						{
+							success_flag = false;
+						}
+				}
+
+			if (!success_flag)
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to add \"%s\" coordinate [" DOUBLE64_FMT ", " DOUBLE64_FMT "] to BSON", coord_key_s, coord_p -> co_x, coord_p -> co_y);
+				}
+		}
+
+	return success_flag;
+}
+
+
+bool SetCoordinateFromBSON (Coordinate *coord_p, const bson_t *coord_bson_p)
+{
+	bson_iter_t iter;
+
+	if (bson_iter_init (&iter, coord_bson_p))
+		{
+			double64 latitude;
+			double64 longitude;
+			double64 elevation;
+			bool elevation_flag;
+
+			if (GetCoordinateValuesFromBSON (&iter, &latitude, &longitude, &elevation, &elevation_flag))
+				{
+					coord_p -> co_x = latitude;
+					coord_p -> co_y = longitude;
+
+					if (elevation_flag)
+						{
+							return SetCoordinateElevation (coord_p, elevation);
+						}
+
+					ClearCoordinateElevation (coord_p);
+
+					return true;
+				}
+		}
+
+	return false;
+}
+
+
+bool ConvertAddressToBSON (const Address *address_p, bson_t *dest_p)
+{
+	bool success_flag = false;
+
+	if (AddPostalAddressToBSON (address_p, dest_p))
+		{
+			bson_t location_bson;
+
+			if (bson_append_document_begin (dest_p, AD_LOCATION_S, -1, &location_bson))
+				{
+					success_flag = AddCoordinateToBSON (address_p -> ad_gps_centre_p, &location_bson, AD_CENTRE_LOCATION_S) &&
+						AddCoordinateToBSON (address_p -> ad_gps_north_east_p, &location_bson, AD_NORTH_EAST_LOCATION_S) &&
+						AddCoordinateToBSON (address_p -> ad_gps_south_west_p, &location_bson, AD_SOUTH_WEST_LOCATION_S);
+
+					if (!bson_append_document_end (dest_p, &location_bson))
+						{
+							success_flag = false;
+						}
+				}
+		}
+
+	return success_flag;
+}
+
+
+bson_t *GetAddressAsBSON (const Address *address_p)
+{
+	bson_t *address_bson_p = bson_new ();
+
+	if (address_bson_p)
+		{
+			if (ConvertAddressToBSON (address_p, address_bson_p))
+				{
+					return address_bson_p;
+				}
+
+			bson_destroy (address_bson_p);
+		}
+
+	return NULL;
+}
+
+
+bool AddAddressesToBSONArray (const Address * const *addresses_pp, const size_t num_addresses, bson_t *dest_p, const char * const key_s)
+{
+	bool success_flag = false;
+	bson_t array_bson;
+
+	if (bson_append_array_begin (dest_p, key_s, -1, &array_bson))
+		{
+			size_t i;
+
+			success_flag = true;
+
+			for (i = 0; success_flag && (i < num_addresses); ++ i)
+				{
+					char index_s [16];
+					const char *element_key_s;
+					const size_t key_length = bson_uint32_to_string ((uint32_t) i, &element_key_s, index_s, sizeof (index_s));
+					bson_t address_bson;
+
+					success_flag = false;
+
+					if (bson_append_document_begin (&array_bson, element_key_s, (int) key_length, &address_bson))
+						{
+							success_flag = ConvertAddressToBSON (* (addresses_pp + i), &address_bson);
+
+							if (!bson_append_document_end (&array_bson, &address_bson))
+								{
+									success_flag = false;
+								}
+						}
+				}
+
+			if (!bson_append_array_end (dest_p, &array_bson))
+				{
+					success_flag = false;
+				}
+		}
+
+	if (!success_flag)
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to add array of addresses to BSON as \"%s\"", key_s);
+		}
+
+	return success_flag;
+}
+
+
+bool SetAddressFromBSON (Address *address_p, const bson_t *address_bson_p)
+{
+	bool postal_address_flag = false;
+	bool location_flag = false;
+	bson_iter_t iter;
+
+	if (!bson_iter_init (&iter, address_bson_p))
+		{
+			return false;
+		}
+
+	/* The coordinates are kept so that they can be reused */
+	ReplaceAddressString (& (address_p -> ad_name_s), NULL);
+	ReplaceAddressString (& (address_p -> ad_street_s), NULL);
+	ReplaceAddressString (& (address_p -> ad_town_s), NULL);
+	ReplaceAddressString (& (address_p -> ad_county_s), NULL);
+	ReplaceAddressString (& (address_p -> ad_country_s), NULL);
+	ReplaceAddressString (& (address_p -> ad_postcode_s), NULL);
+	ReplaceAddressString (& (address_p -> ad_country_code_s), NULL);
+	ReplaceAddressString (& (address_p -> ad_gps_s), NULL);
+
+	while (bson_iter_next (&iter))
+		{
+			const char *key_s = bson_iter_key (&iter);
+
+			if (strcmp (key_s, AD_ADDRESS_S) == 0)
+				{
+					postal_address_flag = SetPostalAddressFromBSON (address_p, &iter);
+				}
+			else if (strcmp (key_s, AD_LOCATION_S) == 0)
+				{
+					if (!SetLocationFromBSON (address_p, &iter))
+						{
+							return false;
+						}
+
+					location_flag = true;
+				}
+		}
+
+	if (!location_flag)
+		{
+			RemoveCoordinate (& (address_p -> ad_gps_centre_p));
+			RemoveCoordinate (& (address_p -> ad_gps_north_east_p));
+			RemoveCoordinate (& (address_p -> ad_gps_south_west_p));
+		}
+
+	return postal_address_flag;
+}
+
+
+Address *GetAddressFromBSON (const bson_t *address_bson_p)
+{
+	Address *address_p = (Address *) AllocMemory (sizeof (Address));
+
+	if (address_p)
+		{
+			memset (address_p, 0, sizeof (Address));
+
+			if (SetAddressFromBSON (address_p, address_bson_p))
+				{
+					return address_p;
+				}
+
+			FreeAddress (address_p);
+		}
+
+	return NULL;
+}
+
+
+/*
+ * The same rules as ParseAddressForSchemaOrg ()
+ */
+static bool AddPostalAddressToBSON (const Address *address_p, bson_t *dest_p)
+{
+	bool success_flag = true;
+
+	if (address_p -> ad_town_s || address_p -> ad_county_s || address_p -> ad_country_s || address_p -> ad_postcode_s)
+		{
+			bson_t postal_address_bson;
+
+			success_flag = false;
+
+			if (bson_append_document_begin (dest_p, AD_ADDRESS_S, -1, &postal_address_bson))
+				{
+					success_flag = AddValidBSONField (&postal_address_bson, S_TYPE_KEY_S, S_POSTAL_ADDRESS_S) &&
+						AddValidBSONField (&postal_address_bson, AD_NAME_S, address_p -> ad_name_s) &&
+						AddValidBSONField (&postal_address_bson, AD_STREET_S, address_p -> ad_street_s) &&
+						AddValidBSONField (&postal_address_bson, AD_TOWN_S, address_p -> ad_town_s) &&
+						AddValidBSONField (&postal_address_bson, AD_COUNTY_S, address_p -> ad_county_s) &&
+						AddValidBSONField (&postal_address_bson, AD_COUNTRY_S, address_p -> ad_country_s) &&
+						AddValidBSONField (&postal_address_bson, AD_POSTCODE_S, address_p -> ad_postcode_s);
+
+					if (!bson_append_document_end (dest_p, &postal_address_bson))
+						{
+							success_flag = false;
+						}
+				}
+
+			if (!success_flag)
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to add \"%s\" to BSON", AD_ADDRESS_S);
+				}
+		}
+
+	return success_flag;
+}
+
+
+static bool AddValidBSONField (bson_t *bson_p, const char *key_s, const char *value_s)
+{
+	bool success_flag = true;
+
+	if (value_s)
+		{
+			success_flag = bson_append_utf8 (bson_p, key_s, -1, value_s, -1);
+		}
+
+	return success_flag;
+}
+
+
+static bool SetPostalAddressFromBSON (Address *address_p, const bson_iter_t *postal_address_iter_p)
+{
+	const char *keys_ss [] = { AD_NAME_S, AD_STREET_S, AD_TOWN_S, AD_COUNTY_S, AD_COUNTRY_S, AD_POSTCODE_S, NULL };
+	char **values_sss [] = { & (address_p -> ad_name_s), & (address_p -> ad_street_s), & (address_p -> ad_town_s), & (address_p -> ad_county_s), & (address_p -> ad_country_s), & (address_p -> ad_postcode_s) };
+	bool type_flag = false;
+	bson_iter_t iter;
+
+	if (! (BSON_ITER_HOLDS_DOCUMENT (postal_address_iter_p) && bson_iter_recurse (postal_address_iter_p, &iter)))
+		{
+			return false;
+		}
+
+	while (bson_iter_next (&iter))
+		{
+			if (BSON_ITER_HOLDS_UTF8 (&iter))
+				{
+					const char *key_s = bson_iter_key (&iter);
+
+					if (strcmp (key_s, S_TYPE_KEY_S) == 0)
+						{
+							type_flag = (strcmp (bson_iter_utf8 (&iter, NULL), S_POSTAL_ADDRESS_S) == 0);
+						}
+					else
+						{
+							size_t i = 0;
+
+							while (keys_ss [i])
+								{
+									if (strcmp (key_s, keys_ss [i]) == 0)
+										{
+											char *value_s = CopyBSONString (&iter);
+
+											if (!value_s)
+												{
+													return false;
+												}
+
+											ReplaceAddressString (values_sss [i], value_s);
+											break;
+										}
+
+									++ i;
+								}
+						}
+				}
+		}
+
+	if (!type_flag)
+		{
+			return false;
+		}
+
+	if (address_p -> ad_country_s)
+		{
+			const char *country_code_s = GetCountryCodeFromName (address_p -> ad_country_s);
+
+			if (country_code_s)
+				{
+					char *copied_country_code_s = EasyCopyToNewString (country_code_s);
+
+					if (!copied_country_code_s)
+						{
+							return false;
+						}
+
+					ReplaceAddressString (& (address_p -> ad_country_code_s), copied_country_code_s);
+				}
+		}
+
+	return true;
+}
+
+
+static bool SetLocationFromBSON (Address *address_p, const bson_iter_t *location_iter_p)
+{
+	bool success_flag = true;
+	bool centre_flag = false;
+	bool north_east_flag = false;
+	bool south_west_flag = false;
+	bson_iter_t iter;
+
+	/* A location that isn't a document just has no coordinates */
+	if (BSON_ITER_HOLDS_DOCUMENT (location_iter_p) && bson_iter_recurse (location_iter_p, &iter))
+		{
+			while (success_flag && bson_iter_next (&iter))
+				{
+					double64 latitude;
+					double64 longitude;
+					double64 elevation;
+					bool elevation_flag;
+
+					if (GetCoordinateFromBSON (&iter, &latitude, &longitude, &elevation, &elevation_flag))
+						{
+							const char *key_s = bson_iter_key (&iter);
+							const double64 *elevation_p = elevation_flag ? &elevation : NULL;
+
+							if (strcmp (key_s, AD_CENTRE_LOCATION_S) == 0)
+								{
+									success_flag = centre_flag = SetAddressCentreCoordinate (address_p, latitude, longitude, elevation_p);
+								}
+							else if (strcmp (key_s, AD_NORTH_EAST_LOCATION_S) == 0)
+								{
+									success_flag = north_east_flag = SetAddressNorthEastCoordinate (address_p, latitude, longitude, elevation_p);
+								}
+							else if (strcmp (key_s, AD_SOUTH_WEST_LOCATION_S) == 0)
+								{
+									success_flag = south_west_flag = SetAddressSouthWestCoordinate (address_p, latitude, longitude, elevation_p);
+								}
+						}
+				}
+		}
+
+	if (!centre_flag)
+		{
+			RemoveCoordinate (& (address_p -> ad_gps_centre_p));
+		}
+
+	if (!north_east_flag)
+		{
+			RemoveCoordinate (& (address_p -> ad_gps_north_east_p));
+		}
+
+	if (!south_west_flag)
+		{
+			RemoveCoordinate (& (address_p -> ad_gps_south_west_p));
+		}
+
+	return success_flag;
+}
+
+
+static bool GetCoordinateFromBSON (const bson_iter_t *coord_iter_p, double64 *latitude_p, double64 *longitude_p, double64 *elevation_p, bool *has_elevation_p)
+{
+	bson_iter_t iter;
+
+	if (BSON_ITER_HOLDS_DOCUMENT (coord_iter_p) && bson_iter_recurse (coord_iter_p, &iter))
+		{
+			return GetCoordinateValuesFromBSON (&iter, latitude_p, longitude_p, elevation_p, has_elevation_p);
+		}
+
+	return false;
+}
+
+
+/*
+ * As with SetCoordinateFromJSON (), the latitude and longitude are
+ * required and the elevation is optional.
+ */
+static bool GetCoordinateValuesFromBSON (bson_iter_t *iter_p, double64 *latitude_p, double64 *longitude_p, double64 *elevation_p, bool *has_elevation_p)
+{
+	bool latitude_flag = false;
+	bool longitude_flag = false;
+
+	*has_elevation_p = false;
+
+	while (bson_iter_next (iter_p))
+		{
+			const char *key_s = bson_iter_key (iter_p);
+
+			if (strcmp (key_s, CO_LATITUDE_S) == 0)
+				{
+					latitude_flag = GetBSONReal (iter_p, latitude_p);
+				}
+			else if (strcmp (key_s, CO_LONGITUDE_S) == 0)
+				{
+					longitude_flag = GetBSONReal (iter_p, longitude_p);
+				}
+			else if (strcmp (key_s, CO_ELEVATION_S) == 0)
+				{
+					*has_elevation_p = GetBSONReal (iter_p, elevation_p);
+				}
+		}
+
+	return (latitude_flag && longitude_flag);
+}
+
+
+/*
+ * Get a number from either a BSON number or a string containing one
+ */
+static bool GetBSONReal (const bson_iter_t *iter_p, double64 *value_p)
+{
+	bool success_flag = true;
+
+	switch (bson_iter_type (iter_p))
+		{
+			case BSON_TYPE_DOUBLE:
+				*value_p = bson_iter_double (iter_p);
+				break;
+
+			case BSON_TYPE_INT32:
+				*value_p = (double64) bson_iter_int32 (iter_p);
+				break;
+
+			case BSON_TYPE_INT64:
+				*value_p = (double64) bson_iter_int64 (iter_p);
+				break;
+
+			case BSON_TYPE_UTF8:
+				{
+					uint32_t length;
+					const char *value_s = bson_iter_utf8 (iter_p, &length);
+
+					success_flag = ParseDouble (value_s, length, value_p);
+				}
+				break;
+
+			default:
+				success_flag = false;
+				break;
+		}
+
+	return success_flag;
+}
+
+
+static char *CopyBSONString (const bson_iter_t *iter_p)
+{
+	uint32_t length;
+	const char *value_s = bson_iter_utf8 (iter_p, &length);
+	char *copied_value_s = (char *) AllocMemory (length + 1);
+
+	if (copied_value_s)
+		{
+			memcpy (copied_value_s, value_s, length);
+			* (copied_value_s + length) = '\0';
+		}
+
+	return copied_value_s;
+}
+
+
+static void ReplaceAddressString (char **value_ss, char *value_s)
+{
+	if (*value_ss)
+		{
+			FreeCopiedString (*value_ss);
+		}
+
+	*value_ss = value_s;
+}
+
+
+static void RemoveCoordinate (Coordinate **coord_pp)
+{
+	if (*coord_pp)
+		{
+			FreeCoordinate (*coord_pp);
+			*coord_pp = NULL;
+		}
+}
@@ -0,0 +1,799 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * address_canonical.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "address_canonical.h"
+#include "country_codes.h"
+
+#include "string_utils.h"
+
+
+/* The longest abbreviation in s_abbreviations_p */
+#define AC_MAX_ABBREVIATION_LENGTH (4)
+
+/* Longer values than this can't be the name of a country */
+#define AC_MAX_COUNTRY_LENGTH (63)
+
+#define AC_MURMUR_SEED (0x67656F636F646572ULL)
+
+#define AC_ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+
+/* How the words of a value are treated */
+typedef enum
+{
+	/* Separate the words with spaces and expand any abbreviations */
+	CM_EXPAND,
+
+	/* Separate the words with spaces */
+	CM_WORDS,
+
+	/* Join the words together, for postcodes */
+	CM_JOIN
+} CanonicalMode;
+
+
+typedef struct Abbreviation
+{
+	const char *ab_short_s;
+	const char *ab_long_s;
+} Abbreviation;
+
+
+/* These are sorted by ab_short_s for bsearch () */
+static const Abbreviation s_abbreviations_p [] =
+{
+	{ "av", "avenue" },
+	{ "ave", "avenue" },
+	{ "bldg", "building" },
+	{ "blvd", "boulevard" },
+	{ "cl", "close" },
+	{ "cres", "crescent" },
+	{ "ct", "court" },
+	{ "ctr", "centre" },
+	{ "dr", "drive" },
+	{ "gdns", "gardens" },
+	{ "gr", "grove" },
+	{ "ho", "house" },
+	{ "hwy", "highway" },
+	{ "ln", "lane" },
+	{ "mt", "mount" },
+	{ "pde", "parade" },
+	{ "pk", "park" },
+	{ "pl", "place" },
+	{ "rd", "road" },
+	{ "sq", "square" },
+	{ "st", "street" },
+	{ "tce", "terrace" },
+	{ "terr", "terrace" },
+	{ "univ", "university" }
+};
+
+
+/*
+ * Common names for countries that aren't in the country table, in
+ * their canonical forms and sorted by name for bsearch ()
+ */
+static const CountryCode s_country_aliases_p [] =
+{
+	{ "america", "US" },
+	{ "britain", "GB" },
+	{ "england", "GB" },
+	{ "great britain", "GB" },
+	{ "northern ireland", "GB" },
+	{ "scotland", "GB" },
+	{ "u k", "GB" },
+	{ "u s", "US" },
+	{ "u s a", "US" },
+	{ "uk", "GB" },
+	{ "united kingdom", "GB" },
+	{ "united states", "US" },
+	{ "us", "US" },
+	{ "usa", "US" },
+	{ "wales", "GB" }
+};
+
+
+static bool CanonicaliseValue (const char *value_s, const CanonicalMode mode, char *buffer_s, const size_t buffer_size, size_t *length_p);
+
+static bool EndWord (char *buffer_s, const size_t buffer_size, const size_t word_start, const bool last_word_flag, size_t *length_p);
+
+static bool HasAnotherWord (const char *value_s);
+
+static uint32 GetNextCodePoint (const char **value_ss);
+
+static bool AppendFoldedCodePoint (const uint32 code_point, char *buffer_s, const size_t buffer_size, size_t *length_p);
+
+static bool AppendCodePoint (const uint32 code_point, char *buffer_s, const size_t buffer_size, size_t *length_p);
+
+static bool IsSeparator (const uint32 code_point);
+
+static bool AddCanonicalComponent (CanonicalAddress *canonical_p, const CanonicalAddressComponent component, const char *value_s, const CanonicalMode mode);
+
+static bool AddCanonicalCountry (CanonicalAddress *canonical_p, const Address *address_p);
+
+static bool AddCanonicalCountryCode (CanonicalAddress *canonical_p, const char *code_s);
+
+static int CompareAbbreviations (const void *v0_p, const void *v1_p);
+
+static int CompareCountryAliases (const void *v0_p, const void *v1_p);
+
+static uint64 LoadUInt64 (const uint8 *src_p);
+
+static uint64 MixMurmurHash (uint64 k);
+
+
+
+bool CanonicaliseAddressValue (const char *value_s, char *buffer_s, const size_t buffer_size)
+{
+	size_t length;
+
+	return CanonicaliseValue (value_s, CM_EXPAND, buffer_s, buffer_size, &length);
+}
+
+
+const char *GetCanonicalCountryCode (const char *country_s)
+{
+	const char *code_s = GetCountryCodeFromName (country_s);
+
+	if (!code_s)
+		{
+			char buffer_s [AC_MAX_COUNTRY_LENGTH + 1];
+			size_t length;
+
+			if (CanonicaliseValue (country_s, CM_WORDS, buffer_s, sizeof (buffer_s), &length))
+				{
+					const CountryCode *alias_p = (const CountryCode *) bsearch (buffer_s, s_country_aliases_p, sizeof (s_country_aliases_p) / sizeof (CountryCode), sizeof (CountryCode), CompareCountryAliases);
+
+					if (alias_p)
+						{
+							code_s = alias_p -> cc_code_s;
+						}
+					else if (length == 2)
+						{
+							/* Use the code from the country table as it is upper case */
+							const char *name_s = GetCountryNameFromCode (buffer_s);
+
+							if (name_s)
+								{
+									code_s = GetCountryCodeFromName (name_s);
+								}
+						}
+				}
+		}
+
+	return code_s;
+}
+
+
+bool CanonicaliseAddress (const Address *address_p, CanonicalAddress *canonical_p)
+{
+	canonical_p -> ca_length = 0;
+
+	return (AddCanonicalComponent (canonical_p, CAC_NAME, address_p -> ad_name_s, CM_EXPAND) &&
+		AddCanonicalComponent (canonical_p, CAC_STREET, address_p -> ad_street_s, CM_EXPAND) &&
+		AddCanonicalComponent (canonical_p, CAC_TOWN, address_p -> ad_town_s, CM_EXPAND) &&
+		AddCanonicalComponent (canonical_p, CAC_COUNTY, address_p -> ad_county_s, CM_EXPAND) &&
+		AddCanonicalComponent (canonical_p, CAC_POSTCODE, address_p -> ad_postcode_s, CM_JOIN) &&
+		AddCanonicalCountry (canonical_p, address_p));
+}
+
+
+const char *GetCanonicalAddressComponent (const CanonicalAddress *canonical_p, const CanonicalAddressComponent component)
+{
+	return canonical_p -> ca_buffer_s + canonical_p -> ca_offsets [component];
+}
+
+
+/* MurmurHash3_x64_128 by Austin Appleby, which is in the public domain */
+void GetCanonicalAddressFingerprint (const CanonicalAddress *canonical_p, AddressFingerprint *fingerprint_p)
+{
+	const uint8 *data_p = (const uint8 *) (canonical_p -> ca_buffer_s);
+	const size_t length = canonical_p -> ca_length;
+	const size_t num_blocks = length / 16;
+	const size_t tail_length = length & 15;
+	const uint8 *tail_p = data_p + (num_blocks * 16);
+	const uint64 c1 = 0x87C37B91114253D5ULL;
+	const uint64 c2 = 0x4CF5AD432745937FULL;
+	uint64 h1 = AC_MURMUR_SEED;
+	uint64 h2 = AC_MURMUR_SEED;
+	uint64 k1 = 0;
+	uint64 k2 = 0;
+	size_t i;
+
+	for (i = 0; i < num_blocks; ++ i)
+		{
+			k1 = LoadUInt64 (data_p + (i * 16));
+			k2 = LoadUInt64 (data_p + (i * 16) + 8);
+
+			k1 *= c1;
+			k1 = AC_ROTL64 (k1, 31);
+			k1 *= c2;
+			h1 ^= k1;
+
+			h1 = AC_ROTL64 (h1, 27);
+			h1 += h2;
+			h1 = (h1 * 5) + 0x52DCE729;
+
+			k2 *= c2;
+			k2 = AC_ROTL64 (k2, 33);
+			k2 *= c1;
+			h2 ^= k2;
+
+			h2 = AC_ROTL64 (h2, 31);
+			h2 += h1;
+			h2 = (h2 * 5) + 0x38495AB5;
+		}
+
+	k1 = 0;
+	k2 = 0;
+
+	for (i = 0; i < tail_length; ++ i)
+		{
+			if (i < 8)
+				{
+					k1 |= ((uint64) tail_p [i]) << (8 * i);
+				}
+			else
+				{
+					k2 |= ((uint64) tail_p [i]) << (8 * (i - 8));
+				}
+		}
+
+	if (tail_length > 8)
+		{
+			k2 *= c2;
+			k2 = AC_ROTL64 (k2, 33);
+			k2 *= c1;
+			h2 ^= k2;
+		}
+
+	if (tail_length > 0)
+		{
+			k1 *= c1;
+			k1 = AC_ROTL64 (k1, 31);
+			k1 *= c2;
+			h1 ^= k1;
+		}
+
+	h1 ^= (uint64) length;
+	h2 ^= (uint64) length;
+
+	h1 += h2;
+	h2 += h1;
+
+	h1 = MixMurmurHash (h1);
+	h2 = MixMurmurHash (h2);
+
+	h1 += h2;
+	h2 += h1;
+
+	fingerprint_p -> af_high = h1;
+	fingerprint_p -> af_low = h2;
+}
+
+
+bool GetAddressFingerprint (const Address *address_p, AddressFingerprint *fingerprint_p)
+{
+	CanonicalAddress canonical;
+
+	if (CanonicaliseAddress (address_p, &canonical))
+		{
+			GetCanonicalAddressFingerprint (&canonical, fingerprint_p);
+			return true;
+		}
+
+	return false;
+}
+
+
+size_t GetAddressFingerprints (const Address * const *addresses_pp, const size_t num_addresses, AddressFingerprint *fingerprints_p)
+{
+	CanonicalAddress canonical;
+	size_t num_fingerprints = 0;
+	size_t i;
+
+	for (i = 0; i < num_addresses; ++ i)
+		{
+			AddressFingerprint *fingerprint_p = fingerprints_p + i;
+
+			if (CanonicaliseAddress (* (addresses_pp + i), &canonical))
+				{
+					GetCanonicalAddressFingerprint (&canonical, fingerprint_p);
+					++ num_fingerprints;
+				}
+			else
+				{
+					fingerprint_p -> af_high = 0;
+					fingerprint_p -> af_low = 0;
+				}
+		}
+
+	return num_fingerprints;
+}
+
+
+bool AreAddressFingerprintsEqual (const AddressFingerprint *fingerprint0_p, const AddressFingerprint *fingerprint1_p)
+{
+	return ((fingerprint0_p -> af_high == fingerprint1_p -> af_high) && (fingerprint0_p -> af_low == fingerprint1_p -> af_low));
+}
+
+
+
+/*
+ * STATIC DEFINITIONS
+ */
+
+
+static bool CanonicaliseValue (const char *value_s, const CanonicalMode mode, char *buffer_s, const size_t buffer_size, size_t *length_p)
+{
+	size_t length = 0;
+	size_t word_start = 0;
+	bool word_flag = false;
+
+	if (buffer_size == 0)
+		{
+			return false;
+		}
+
+	while (*value_s != '\0')
+		{
+			const uint32 code_point = GetNextCodePoint (&value_s);
+
+			/* Apostrophes are dropped so that "St John's" matches "St Johns" */
+			if ((code_point == '\'') || (code_point == 0x2018) || (code_point == 0x2019))
+				{
+					continue;
+				}
+
+			if (IsSeparator (code_point))
+				{
+					if (word_flag)
+						{
+							if (mode == CM_EXPAND)
+								{
+									if (!EndWord (buffer_s, buffer_size, word_start, !HasAnotherWord (value_s), &length))
+										{
+											return false;
+										}
+								}
+
+							word_flag = false;
+						}
+				}
+			else
+				{
+					if (!word_flag)
+						{
+							if ((length > 0) && (mode != CM_JOIN))
+								{
+									if (length + 1 >= buffer_size)
+										{
+											return false;
+										}
+
+									buffer_s [length] = ' ';
+									++ length;
+								}
+
+							word_start = length;
+							word_flag = true;
+						}
+
+					if (!AppendFoldedCodePoint (code_point, buffer_s, buffer_size, &length))
+						{
+							return false;
+						}
+				}
+		}
+
+	if (word_flag && (mode == CM_EXPAND))
+		{
+			if (!EndWord (buffer_s, buffer_size, word_start, true, &length))
+				{
+					return false;
+				}
+		}
+
+	buffer_s [length] = '\0';
+	*length_p = length;
+
+	return true;
+}
+
+
+/* Expand the word that has just been added if it is an abbreviation */
+static bool EndWord (char *buffer_s, const size_t buffer_size, const size_t word_start, const bool last_word_flag, size_t *length_p)
+{
+	const size_t word_length = *length_p - word_start;
+
+	if (word_length <= AC_MAX_ABBREVIATION_LENGTH)
+		{
+			char word_s [AC_MAX_ABBREVIATION_LENGTH + 1];
+			const Abbreviation *abbreviation_p;
+
+			memcpy (word_s, buffer_s + word_start, word_length);
+			word_s [word_length] = '\0';
+
+			abbreviation_p = (const Abbreviation *) bsearch (word_s, s_abbreviations_p, sizeof (s_abbreviations_p) / sizeof (Abbreviation), sizeof (Abbreviation), CompareAbbreviations);
+
+			if (abbreviation_p)
+				{
+					/* "High St" but "St Albans" and "Rue St-Denis" */
+					const char *long_s = ((!last_word_flag) && (strcmp (word_s, "st") == 0)) ? "saint" : abbreviation_p -> ab_long_s;
+					const size_t long_length = strlen (long_s);
+
+					if (word_start + long_length >= buffer_size)
+						{
+							return false;
+						}
+
+					memcpy (buffer_s + word_start, long_s, long_length);
+					*length_p = word_start + long_length;
+				}
+		}
+
+	return true;
+}
+
+
+/* Check whether there are any more words after a separator */
+static bool HasAnotherWord (const char *value_s)
+{
+	while (*value_s != '\0')
+		{
+			if (!IsSeparator (GetNextCodePoint (&value_s)))
+				{
+					return true;
+				}
+		}
+
+	return false;
+}
+
+
+/*
+ * Decode the next UTF-8 character. Any byte that isn't part of a valid
+ * sequence is returned on its own, as if it were Latin-1.
+ */
+static uint32 GetNextCodePoint (const char **value_ss)
+{
+	const uint8 *value_p = (const uint8 *) *value_ss;
+	const uint8 c = *value_p;
+	uint32 code_point = c;
+	uint32 num_continuation_bytes = 0;
+	uint32 min_code_point = 0;
+	uint32 i;
+
+	if ((c & 0xE0) == 0xC0)
+		{
+			code_point = c & 0x1F;
+			num_continuation_bytes = 1;
+			min_code_point = 0x80;
+		}
+	else if ((c & 0xF0) == 0xE0)
+		{
+			code_point = c & 0x0F;
+			num_continuation_bytes = 2;
+			min_code_point = 0x800;
+		}
+	else if ((c & 0xF8) == 0xF0)
+		{
+			code_point = c & 0x07;
+			num_continuation_bytes = 3;
+			min_code_point = 0x10000;
+		}
+
+	for (i = 1; i <= num_continuation_bytes; ++ i)
+		{
+			if ((value_p [i] & 0xC0) != 0x80)
+				{
+					break;
+				}
+
+			code_point = (code_point << 6) | (value_p [i] & 0x3F);
+		}
+
+	if ((i <= num_continuation_bytes) || (code_point < min_code_point) || (code_point > 0x10FFFF))
+		{
+			*value_ss = (const char *) (value_p + 1);
+			return c;
+		}
+
+	*value_ss = (const char *) (value_p + 1 + num_continuation_bytes);
+
+	return code_point;
+}
+
+
+/*
+ * Add the simple case folding of a character, along with the full
+ * folding of sharp s to "ss", for Latin, Greek and Cyrillic.
+ */
+static bool AppendFoldedCodePoint (const uint32 code_point, char *buffer_s, const size_t buffer_size, size_t *length_p)
+{
+	uint32 folded = code_point;
+
+	if (code_point < 0x80)
+		{
+			folded = (uint32) tolower ((int) code_point);
+		}
+	else if (code_point == 0xDF)
+		{
+			return (AppendCodePoint ('s', buffer_s, buffer_size, length_p) && AppendCodePoint ('s', buffer_s, buffer_size, length_p));
+		}
+	else if ((code_point >= 0xC0) && (code_point <= 0xDE) && (code_point != 0xD7))
+		{
+			folded = code_point + 0x20;
+		}
+	else if (code_point == 0x130)
+		{
+			/* Dotted capital I */
+			folded = 'i';
+		}
+	else if (code_point == 0x178)
+		{
+			folded = 0xFF;
+		}
+	else if (((code_point >= 0x139) && (code_point <= 0x148)) || ((code_point >= 0x179) && (code_point <= 0x17E)))
+		{
+			/* In these parts of Latin Extended-A, the capitals are odd */
+			if (code_point & 1)
+				{
+					folded = code_point + 1;
+				}
+		}
+	else if ((code_point >= 0x100) && (code_point <= 0x177))
+		{
+			/* Elsewhere they are even */
+			if ((code_point & 1) == 0)
+				{
+					folded = code_point + 1;
+				}
+		}
+	else if (code_point == 0x386)
+		{
+			folded = 0x3AC;
+		}
+	else if ((code_point >= 0x388) && (code_point <= 0x38A))
+		{
+			folded = code_point + 0x25;
+		}
+	else if (code_point == 0x38C)
+		{
+			folded = 0x3CC;
+		}
+	else if ((code_point == 0x38E) || (code_point == 0x38F))
+		{
+			folded = code_point + 0x3F;
+		}
+	else if ((code_point >= 0x391) && (code_point <= 0x3AB) && (code_point != 0x3A2))
+		{
+			folded = code_point + 0x20;
+		}
+	else if (code_point == 0x3C2)
+		{
+			/* Final sigma */
+			folded = 0x3C3;
+		}
+	else if ((code_point >= 0x400) && (code_point <= 0x40F))
+		{
+			folded = code_point + 0x50;
+		}
+	else if ((code_point >= 0x410) && (code_point <= 0x42F))
+		{
+			folded = code_point + 0x20;
+		}
+
+	return AppendCodePoint (folded, buffer_s, buffer_size, length_p);
+}
+
+
+static bool AppendCodePoint (const uint32 code_point, char *buffer_s, const size_t buffer_size, size_t *length_p)
+{
+	uint8 bytes [4];
+	size_t num_bytes;
+
+	if (code_point < 0x80)
+		{
+			bytes [0] = (uint8) code_point;
+			num_bytes = 1;
+		}
+	else if (code_point < 0x800)
+		{
+			bytes [0] = (uint8) (0xC0 | (code_point >> 6));
+			bytes [1] = (uint8) (0x80 | (code_point & 0x3F));
+			num_bytes = 2;
+		}
+	else if (code_point < 0x10000)
+		{
+			bytes [0] = (uint8) (0xE0 | (code_point >> 12));
+			bytes [1] = (uint8) (0x80 | ((code_point >> 6) & 0x3F));
+			bytes [2] = (uint8) (0x80 | (code_point & 0x3F));
+			num_bytes = 3;
+		}
+	else
+		{
+			bytes [0] = (uint8) (0xF0 | (code_point >> 18));
+			bytes [1] = (uint8) (0x80 | ((code_point >> 12) & 0x3F));
+			bytes [2] = (uint8) (0x80 | ((code_point >> 6) & 0x3F));
+			bytes [3] = (uint8) (0x80 | (code_point & 0x3F));
+			num_bytes = 4;
+		}
+
+	if (*length_p + num_bytes >= buffer_size)
+		{
+			return false;
+		}
+
+	memcpy (buffer_s + *length_p, bytes, num_bytes);
+	*length_p += num_bytes;
+
+	return true;
+}
+
+
+/* Whitespace, control characters and punctuation */
+static bool IsSeparator (const uint32 code_point)
+{
+	if (code_point < 0x80)
+		{
+			return (isalnum ((int) code_point) == 0);
+		}
+
+	/* Latin-1 spaces and symbols, apart from the ordinal indicators and micro sign */
+	if (code_point < 0xC0)
+		{
+			return ((code_point != 0xAA) && (code_point != 0xB5) && (code_point != 0xBA));
+		}
+
+	return ((code_point == 0xD7) || (code_point == 0xF7) ||
+		((code_point >= 0x2000) && (code_point <= 0x206F)) ||
+		(code_point == 0x3000));
+}
+
+
+static bool AddCanonicalComponent (CanonicalAddress *canonical_p, const CanonicalAddressComponent component, const char *value_s, const CanonicalMode mode)
+{
+	const size_t offset = canonical_p -> ca_length;
+	size_t length = 0;
+
+	canonical_p -> ca_offsets [component] = (uint16) offset;
+
+	if (value_s)
+		{
+			if (!CanonicaliseValue (value_s, mode, canonical_p -> ca_buffer_s + offset, CANONICAL_ADDRESS_BUFFER_SIZE - offset, &length))
+				{
+					return false;
+				}
+		}
+	else
+		{
+			if (offset >= CANONICAL_ADDRESS_BUFFER_SIZE)
+				{
+					return false;
+				}
+
+			canonical_p -> ca_buffer_s [offset] = '\0';
+		}
+
+	canonical_p -> ca_length = (uint16) (offset + length + 1);
+
+	return true;
+}
+
+
+static bool AddCanonicalCountry (CanonicalAddress *canonical_p, const Address *address_p)
+{
+	const char *code_s = address_p -> ad_country_code_s;
+
+	if (code_s && GetCountryNameFromCode (code_s))
+		{
+			return AddCanonicalCountryCode (canonical_p, code_s);
+		}
+
+	if (address_p -> ad_country_s)
+		{
+			code_s = GetCanonicalCountryCode (address_p -> ad_country_s);
+
+			if (code_s)
+				{
+					return AddCanonicalCountryCode (canonical_p, code_s);
+				}
+
+			return AddCanonicalComponent (canonical_p, CAC_COUNTRY, address_p -> ad_country_s, CM_WORDS);
+		}
+
+	return AddCanonicalComponent (canonical_p, CAC_COUNTRY, NULL, CM_WORDS);
+}
+
+
+static bool AddCanonicalCountryCode (CanonicalAddress *canonical_p, const char *code_s)
+{
+	const size_t offset = canonical_p -> ca_length;
+	const size_t length = strlen (code_s);
+	size_t i;
+
+	if (offset + length >= CANONICAL_ADDRESS_BUFFER_SIZE)
+		{
+			return false;
+		}
+
+	canonical_p -> ca_offsets [CAC_COUNTRY] = (uint16) offset;
+
+	for (i = 0; i < length; ++ i)
+		{
+			canonical_p -> ca_buffer_s [offset + i] = (char) toupper ((unsigned char) code_s [i]);
+		}
+
+	canonical_p -> ca_buffer_s [offset + length] = '\0';
+	canonical_p -> ca_length = (uint16) (offset + length + 1);
+
+	return true;
+}
+
+
+static int CompareAbbreviations (const void *v0_p, const void *v1_p)
+{
+	const char *word_s = (const char *) v0_p;
+	const Abbreviation *abbreviation_p = (const Abbreviation *) v1_p;
+
+	return strcmp (word_s, abbreviation_p -> ab_short_s);
+}
+
+
+static int CompareCountryAliases (const void *v0_p, const void *v1_p)
+{
+	const char *name_s = (const char *) v0_p;
+	const CountryCode *alias_p = (const CountryCode *) v1_p;
+
+	return strcmp (name_s, alias_p -> cc_name_s);
+}
+
+
+static uint64 LoadUInt64 (const uint8 *src_p)
+{
+	uint64 value = 0;
+	int i;
+
+	for (i = 7; i >= 0; -- i)
+		{
+			value = (value << 8) | src_p [i];
+		}
+
+	return value;
+}
+
+
+static uint64 MixMurmurHash (uint64 k)
+{
+	k ^= k >> 33;
+	k *= 0xFF51AFD7ED558CCDULL;
+	k ^= k >> 33;
+	k *= 0xC4CEB9FE1A85EC53ULL;
+	k ^= k >> 33;
+
+	return k;
+}
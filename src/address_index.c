@@ -0,0 +1,1135 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * address_index.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "address_index.h"
+#include "geo_cell.h"
+#include "geo_distance.h"
+
+#include "memory_allocations.h"
+#include "streams.h"
+
+
+#define AI_DEGREES_TO_RADIANS (0.017453292519943295)
+
+#define AI_RADIANS_TO_DEGREES (57.29577951308232)
+
+#define AI_HALF_PI (1.5707963267948966)
+
+#define AI_INITIAL_CAPACITY (64)
+
+
+/* A child of a node, used while building and splitting nodes */
+typedef struct IndexItem
+{
+	FixedBoundingBox ii_box;
+	uint32 ii_child;
+} IndexItem;
+
+
+/* A point to search from with the values that every distance calculation needs */
+typedef struct IndexQuery
+{
+	double64 iq_latitude;
+	double64 iq_longitude;
+	double64 iq_cos_latitude;
+	double64 iq_tan_latitude;
+	double64 iq_position [3];
+} IndexQuery;
+
+
+typedef struct IndexHeapItem
+{
+	double64 ihi_separation;
+	uint32 ihi_child;
+	bool ihi_entry_flag;
+} IndexHeapItem;
+
+
+/* A binary min-heap of nodes and entries ordered by their separation from the query point */
+typedef struct IndexHeap
+{
+	IndexHeapItem *ih_items_p;
+	size_t ih_size;
+	size_t ih_capacity;
+} IndexHeap;
+
+
+typedef struct IndexQueryOrder
+{
+	uint64 iqo_code;
+	size_t iqo_index;
+} IndexQueryOrder;
+
+
+static bool GetAddressExtent (const Address *address_p, FixedBoundingBox *extent_p, FixedCoordinate *centre_p);
+
+static bool AddIndexEntry (AddressIndex *index_p, const Address *address_p, const FixedCoordinate *centre_p, uint32 *entry_index_p);
+
+static bool ReserveIndexNodes (AddressIndex *index_p, const size_t num_nodes);
+
+static uint32 AllocateIndexNode (AddressIndex *index_p, const uint32 level);
+
+static bool BuildIndexTree (AddressIndex *index_p, IndexItem *items_p, size_t num_items);
+
+static size_t PackIndexItems (AddressIndex *index_p, IndexItem *items_p, const size_t num_items, const uint32 level);
+
+static void InsertIndexItem (AddressIndex *index_p, const uint32 node_index, const IndexItem *item_p, IndexItem *split_item_p, bool *split_flag_p);
+
+static uint32 ChooseIndexSubtree (const AddressIndexNode *node_p, const FixedBoundingBox *box_p);
+
+static void SplitIndexNode (AddressIndex *index_p, const uint32 node_index, IndexItem *split_item_p);
+
+static void GetIndexNodeExtent (const AddressIndexNode *node_p, FixedBoundingBox *extent_p);
+
+static void ExtendBoundingBox (FixedBoundingBox *box_p, const FixedBoundingBox *other_box_p);
+
+static double64 GetBoundingBoxArea (const FixedBoundingBox *box_p);
+
+static int CompareIndexItemsByLongitude (const void *v0_p, const void *v1_p);
+
+static int CompareIndexItemsByLatitude (const void *v0_p, const void *v1_p);
+
+static void CollectAddressesInBox (const AddressIndex *index_p, const uint32 node_index, const FixedBoundingBox *box_p, const Address **results_pp, const size_t max_results, size_t *num_results_p);
+
+static bool SearchNearestAddresses (const AddressIndex *index_p, const IndexQuery *query_p, const size_t max_results, const double64 radius, IndexHeap *heap_p, AddressIndexResult *results_p, size_t *num_results_p);
+
+static bool SetIndexQuery (IndexQuery *query_p, const Coordinate *point_p);
+
+static void GetUnitSpherePosition (const double64 latitude, const double64 longitude, double64 *position_p);
+
+static double64 GetQuerySeparationToBox (const IndexQuery *query_p, const FixedBoundingBox *box_p);
+
+static bool InitIndexHeap (IndexHeap *heap_p);
+
+static void ClearIndexHeap (IndexHeap *heap_p);
+
+static bool PushIndexHeapItem (IndexHeap *heap_p, const double64 separation, const uint32 child, const bool entry_flag);
+
+static void PopIndexHeapItem (IndexHeap *heap_p, IndexHeapItem *item_p);
+
+static int CompareIndexQueryOrders (const void *v0_p, const void *v1_p);
+
+
+
+AddressIndex *AllocateAddressIndex (const Address * const *addresses_pp, const size_t num_addresses)
+{
+	AddressIndex *index_p = (AddressIndex *) AllocMemory (sizeof (AddressIndex));
+
+	if (index_p)
+		{
+			IndexItem *items_p = NULL;
+			bool success_flag = false;
+
+			memset (index_p, 0, sizeof (AddressIndex));
+
+			if (num_addresses > 0)
+				{
+					items_p = (IndexItem *) AllocMemory (num_addresses * sizeof (IndexItem));
+				}
+
+			if ((num_addresses == 0) || items_p)
+				{
+					const size_t initial_capacity = (num_addresses > AI_INITIAL_CAPACITY) ? num_addresses : AI_INITIAL_CAPACITY;
+
+					index_p -> ai_entries_p = (AddressIndexEntry *) AllocMemory (initial_capacity * sizeof (AddressIndexEntry));
+
+					if (index_p -> ai_entries_p)
+						{
+							size_t num_items = 0;
+							size_t num_skipped = 0;
+							size_t i;
+
+							index_p -> ai_entries_capacity = (uint32) initial_capacity;
+
+							for (i = 0; i < num_addresses; ++ i)
+								{
+									IndexItem *item_p = items_p + num_items;
+									FixedCoordinate centre;
+
+									if (GetAddressExtent (addresses_pp [i], & (item_p -> ii_box), &centre))
+										{
+											AddIndexEntry (index_p, addresses_pp [i], &centre, & (item_p -> ii_child));
+											++ num_items;
+										}
+									else
+										{
+											++ num_skipped;
+										}
+								}
+
+							if (num_skipped > 0)
+								{
+									PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Skipped " SIZET_FMT " of " SIZET_FMT " addresses without valid coordinates", num_skipped, num_addresses);
+								}
+
+							if (num_items > 0)
+								{
+									success_flag = BuildIndexTree (index_p, items_p, num_items);
+								}
+							else if (ReserveIndexNodes (index_p, 1))
+								{
+									index_p -> ai_root = AllocateIndexNode (index_p, 0);
+									success_flag = true;
+								}
+						}
+				}
+
+			if (items_p)
+				{
+					FreeMemory (items_p);
+				}
+
+			if (success_flag)
+				{
+					return index_p;
+				}
+
+			FreeAddressIndex (index_p);
+		}
+
+	PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to create index for " SIZET_FMT " addresses", num_addresses);
+
+	return NULL;
+}
+
+
+void FreeAddressIndex (AddressIndex *index_p)
+{
+	if (index_p -> ai_nodes_p)
+		{
+			FreeMemory (index_p -> ai_nodes_p);
+		}
+
+	if (index_p -> ai_entries_p)
+		{
+			FreeMemory (index_p -> ai_entries_p);
+		}
+
+	FreeMemory (index_p);
+}
+
+
+bool AddAddressToIndex (AddressIndex *index_p, const Address *address_p)
+{
+	IndexItem item;
+	FixedCoordinate centre;
+
+	if (!GetAddressExtent (address_p, & (item.ii_box), &centre))
+		{
+			PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Cannot index address without valid coordinates");
+			return false;
+		}
+
+	/*
+	 * An insertion splits at most one node per level and then adds a new
+	 * root, so reserving those nodes up front means that the tree can't be
+	 * left half updated by a failed allocation.
+	 */
+	if (ReserveIndexNodes (index_p, index_p -> ai_nodes_p [index_p -> ai_root].ain_level + 2) && AddIndexEntry (index_p, address_p, &centre, & (item.ii_child)))
+		{
+			IndexItem split_item;
+			bool split_flag;
+
+			InsertIndexItem (index_p, index_p -> ai_root, &item, &split_item, &split_flag);
+
+			if (split_flag)
+				{
+					const uint32 old_root = index_p -> ai_root;
+					const uint32 new_root = AllocateIndexNode (index_p, index_p -> ai_nodes_p [old_root].ain_level + 1);
+					AddressIndexNode *root_p = index_p -> ai_nodes_p + new_root;
+
+					GetIndexNodeExtent (index_p -> ai_nodes_p + old_root, root_p -> ain_boxes);
+					root_p -> ain_children [0] = old_root;
+
+					root_p -> ain_boxes [1] = split_item.ii_box;
+					root_p -> ain_children [1] = split_item.ii_child;
+
+					root_p -> ain_num_children = 2;
+
+					index_p -> ai_root = new_root;
+				}
+
+			return true;
+		}
+
+	PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to add address to index");
+
+	return false;
+}
+
+
+size_t GetAddressIndexSize (const AddressIndex *index_p)
+{
+	return index_p -> ai_num_entries;
+}
+
+
+size_t FindAddressesInBoundingBox (const AddressIndex *index_p, const FixedBoundingBox *box_p, const Address **results_pp, const size_t max_results)
+{
+	size_t num_results = 0;
+
+	CollectAddressesInBox (index_p, index_p -> ai_root, box_p, results_pp, max_results, &num_results);
+
+	return num_results;
+}
+
+
+size_t FindNearestAddresses (const AddressIndex *index_p, const Coordinate *point_p, const size_t max_results, AddressIndexResult *results_p)
+{
+	return FindAddressesWithinDistance (index_p, point_p, -1.0, max_results, results_p);
+}
+
+
+size_t FindAddressesWithinDistance (const AddressIndex *index_p, const Coordinate *point_p, const double64 radius, const size_t max_results, AddressIndexResult *results_p)
+{
+	size_t num_results = 0;
+	IndexQuery query;
+
+	if (SetIndexQuery (&query, point_p))
+		{
+			IndexHeap heap;
+
+			if (InitIndexHeap (&heap))
+				{
+					SearchNearestAddresses (index_p, &query, max_results, radius, &heap, results_p, &num_results);
+					ClearIndexHeap (&heap);
+				}
+		}
+	else
+		{
+			PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Invalid search point [" DOUBLE64_FMT ", " DOUBLE64_FMT "]", point_p -> co_x, point_p -> co_y);
+		}
+
+	return num_results;
+}
+
+
+bool FindNearestAddressesForCoordinates (const AddressIndex *index_p, const Coordinate *points_p, const size_t num_points, const size_t max_results, const double64 radius,
+	AddressIndexResult *results_p, size_t *num_results_p)
+{
+	bool success_flag = false;
+	uint64 *codes_p;
+
+	if (num_points == 0)
+		{
+			return true;
+		}
+
+	codes_p = (uint64 *) AllocMemory (num_points * sizeof (uint64));
+
+	if (codes_p)
+		{
+			if (GetMortonCodesForCoordinates (points_p, num_points, codes_p))
+				{
+					IndexQueryOrder *order_p = (IndexQueryOrder *) AllocMemory (num_points * sizeof (IndexQueryOrder));
+
+					if (order_p)
+						{
+							IndexHeap heap;
+
+							if (InitIndexHeap (&heap))
+								{
+									size_t i;
+
+									for (i = 0; i < num_points; ++ i)
+										{
+											(order_p + i) -> iqo_code = codes_p [i];
+											(order_p + i) -> iqo_index = i;
+										}
+
+									qsort (order_p, num_points, sizeof (IndexQueryOrder), CompareIndexQueryOrders);
+
+									success_flag = true;
+
+									for (i = 0; (i < num_points) && success_flag; ++ i)
+										{
+											const size_t point_index = (order_p + i) -> iqo_index;
+											IndexQuery query;
+
+											SetIndexQuery (&query, points_p + point_index);
+
+											success_flag = SearchNearestAddresses (index_p, &query, max_results, radius, &heap, results_p + (point_index * max_results), num_results_p + point_index);
+										}
+
+									ClearIndexHeap (&heap);
+								}
+
+							FreeMemory (order_p);
+						}
+				}
+
+			FreeMemory (codes_p);
+		}
+
+	return success_flag;
+}
+
+
+/*
+ * Work out the box that an Address covers and the point to measure its
+ * distance from. Bounds that cross the antimeridian are treated as
+ * covering every longitude which is loose but never misses a match.
+ */
+static bool GetAddressExtent (const Address *address_p, FixedBoundingBox *extent_p, FixedCoordinate *centre_p)
+{
+	FixedCoordinate centre;
+	FixedCoordinate north_east;
+	FixedCoordinate south_west;
+	const bool centre_flag = (address_p -> ad_gps_centre_p) && SetFixedCoordinateFromCoordinate (&centre, address_p -> ad_gps_centre_p);
+	const bool bounds_flag = (address_p -> ad_gps_north_east_p) && (address_p -> ad_gps_south_west_p) &&
+		SetFixedCoordinateFromCoordinate (&north_east, address_p -> ad_gps_north_east_p) && SetFixedCoordinateFromCoordinate (&south_west, address_p -> ad_gps_south_west_p) &&
+		(south_west.fc_latitude <= north_east.fc_latitude);
+
+	if (bounds_flag)
+		{
+			extent_p -> fbb_south_west = south_west;
+			extent_p -> fbb_north_east = north_east;
+
+			if (south_west.fc_longitude > north_east.fc_longitude)
+				{
+					extent_p -> fbb_south_west.fc_longitude = -FIXED_COORDINATE_LONGITUDE_LIMIT;
+					extent_p -> fbb_north_east.fc_longitude = FIXED_COORDINATE_LONGITUDE_LIMIT;
+				}
+
+			if (centre_flag)
+				{
+					ExpandFixedBoundingBox (extent_p, &centre);
+				}
+			else
+				{
+					int64 longitude = (int64) south_west.fc_longitude;
+
+					if (south_west.fc_longitude <= north_east.fc_longitude)
+						{
+							longitude += ((int64) north_east.fc_longitude - (int64) south_west.fc_longitude) / 2;
+						}
+					else
+						{
+							longitude += ((int64) north_east.fc_longitude + (2 * (int64) FIXED_COORDINATE_LONGITUDE_LIMIT) - (int64) south_west.fc_longitude) / 2;
+
+							if (longitude > FIXED_COORDINATE_LONGITUDE_LIMIT)
+								{
+									longitude -= 2 * (int64) FIXED_COORDINATE_LONGITUDE_LIMIT;
+								}
+						}
+
+					centre.fc_latitude = (int32) (((int64) south_west.fc_latitude + (int64) north_east.fc_latitude) / 2);
+					centre.fc_longitude = (int32) longitude;
+				}
+		}
+	else if (centre_flag)
+		{
+			extent_p -> fbb_south_west = centre;
+			extent_p -> fbb_north_east = centre;
+		}
+	else
+		{
+			return false;
+		}
+
+	*centre_p = centre;
+
+	return true;
+}
+
+
+static bool AddIndexEntry (AddressIndex *index_p, const Address *address_p, const FixedCoordinate *centre_p, uint32 *entry_index_p)
+{
+	AddressIndexEntry *entry_p;
+
+	if (index_p -> ai_num_entries == index_p -> ai_entries_capacity)
+		{
+			const uint32 new_capacity = (index_p -> ai_entries_capacity > 0) ? (2 * index_p -> ai_entries_capacity) : AI_INITIAL_CAPACITY;
+			AddressIndexEntry *entries_p = (AddressIndexEntry *) ReallocMemory (index_p -> ai_entries_p, new_capacity * sizeof (AddressIndexEntry), index_p -> ai_entries_capacity * sizeof (AddressIndexEntry));
+
+			if (!entries_p)
+				{
+					return false;
+				}
+
+			index_p -> ai_entries_p = entries_p;
+			index_p -> ai_entries_capacity = new_capacity;
+		}
+
+	entry_p = index_p -> ai_entries_p + index_p -> ai_num_entries;
+	entry_p -> aie_address_p = address_p;
+	entry_p -> aie_centre = *centre_p;
+	GetUnitSpherePosition (GetFixedCoordinateLatitude (centre_p), GetFixedCoordinateLongitude (centre_p), entry_p -> aie_position);
+
+	*entry_index_p = index_p -> ai_num_entries;
+	++ (index_p -> ai_num_entries);
+
+	return true;
+}
+
+
+static bool ReserveIndexNodes (AddressIndex *index_p, const size_t num_nodes)
+{
+	const size_t required_capacity = index_p -> ai_num_nodes + num_nodes;
+
+	if (required_capacity > index_p -> ai_nodes_capacity)
+		{
+			size_t new_capacity = (index_p -> ai_nodes_capacity > 0) ? (2 * index_p -> ai_nodes_capacity) : AI_INITIAL_CAPACITY;
+			AddressIndexNode *nodes_p;
+
+			if (new_capacity < required_capacity)
+				{
+					new_capacity = required_capacity;
+				}
+
+			nodes_p = (AddressIndexNode *) ReallocMemory (index_p -> ai_nodes_p, new_capacity * sizeof (AddressIndexNode), index_p -> ai_nodes_capacity * sizeof (AddressIndexNode));
+
+			if (!nodes_p)
+				{
+					return false;
+				}
+
+			index_p -> ai_nodes_p = nodes_p;
+			index_p -> ai_nodes_capacity = (uint32) new_capacity;
+		}
+
+	return true;
+}
+
+
+/* The space must already have been reserved with ReserveIndexNodes () */
+static uint32 AllocateIndexNode (AddressIndex *index_p, const uint32 level)
+{
+	const uint32 node_index = index_p -> ai_num_nodes;
+	AddressIndexNode *node_p = index_p -> ai_nodes_p + node_index;
+
+	node_p -> ain_num_children = 0;
+	node_p -> ain_level = level;
+
+	++ (index_p -> ai_num_nodes);
+
+	return node_index;
+}
+
+
+/*
+ * Sort-Tile-Recursive bulk loading. Each level is packed into full nodes
+ * whose extents become the items for the level above until a single
+ * node, the root, remains.
+ */
+static bool BuildIndexTree (AddressIndex *index_p, IndexItem *items_p, size_t num_items)
+{
+	uint32 level = 0;
+
+	while (true)
+		{
+			const size_t num_nodes = (num_items + ADDRESS_INDEX_NODE_CAPACITY - 1) / ADDRESS_INDEX_NODE_CAPACITY;
+
+			if (!ReserveIndexNodes (index_p, num_nodes))
+				{
+					return false;
+				}
+
+			num_items = PackIndexItems (index_p, items_p, num_items, level);
+
+			if (num_items == 1)
+				{
+					index_p -> ai_root = items_p -> ii_child;
+					return true;
+				}
+
+			++ level;
+		}
+}
+
+
+/*
+ * Sort the items into vertical slices by longitude, sort each slice by
+ * latitude and then fill nodes from each slice in turn. The parent items
+ * are written back over the start of items_p which is safe since each node
+ * has been filled before its item is written.
+ */
+static size_t PackIndexItems (AddressIndex *index_p, IndexItem *items_p, const size_t num_items, const uint32 level)
+{
+	const size_t num_nodes = (num_items + ADDRESS_INDEX_NODE_CAPACITY - 1) / ADDRESS_INDEX_NODE_CAPACITY;
+	const size_t num_slices = (size_t) ceil (sqrt ((double) num_nodes));
+	const size_t slice_size = num_slices * ADDRESS_INDEX_NODE_CAPACITY;
+	size_t num_parents = 0;
+	size_t i;
+
+	qsort (items_p, num_items, sizeof (IndexItem), CompareIndexItemsByLongitude);
+
+	for (i = 0; i < num_items; i += slice_size)
+		{
+			const size_t num_slice_items = (num_items - i < slice_size) ? (num_items - i) : slice_size;
+
+			qsort (items_p + i, num_slice_items, sizeof (IndexItem), CompareIndexItemsByLatitude);
+		}
+
+	for (i = 0; i < num_items; i += ADDRESS_INDEX_NODE_CAPACITY)
+		{
+			const size_t num_children = (num_items - i < ADDRESS_INDEX_NODE_CAPACITY) ? (num_items - i) : ADDRESS_INDEX_NODE_CAPACITY;
+			const uint32 node_index = AllocateIndexNode (index_p, level);
+			AddressIndexNode *node_p = index_p -> ai_nodes_p + node_index;
+			IndexItem *parent_p = items_p + num_parents;
+			size_t j;
+
+			for (j = 0; j < num_children; ++ j)
+				{
+					node_p -> ain_boxes [j] = (items_p + i + j) -> ii_box;
+					node_p -> ain_children [j] = (items_p + i + j) -> ii_child;
+				}
+
+			node_p -> ain_num_children = (uint32) num_children;
+
+			GetIndexNodeExtent (node_p, & (parent_p -> ii_box));
+			parent_p -> ii_child = node_index;
+
+			++ num_parents;
+		}
+
+	return num_parents;
+}
+
+
+static void InsertIndexItem (AddressIndex *index_p, const uint32 node_index, const IndexItem *item_p, IndexItem *split_item_p, bool *split_flag_p)
+{
+	AddressIndexNode *node_p = index_p -> ai_nodes_p + node_index;
+
+	if (node_p -> ain_level > 0)
+		{
+			const uint32 i = ChooseIndexSubtree (node_p, & (item_p -> ii_box));
+			const uint32 child_index = node_p -> ain_children [i];
+			IndexItem child_split_item;
+			bool child_split_flag;
+
+			InsertIndexItem (index_p, child_index, item_p, &child_split_item, &child_split_flag);
+
+			/* The child may have been split so recalculate its extent rather than just extending it */
+			GetIndexNodeExtent (index_p -> ai_nodes_p + child_index, node_p -> ain_boxes + i);
+
+			if (child_split_flag)
+				{
+					node_p -> ain_boxes [node_p -> ain_num_children] = child_split_item.ii_box;
+					node_p -> ain_children [node_p -> ain_num_children] = child_split_item.ii_child;
+					++ (node_p -> ain_num_children);
+				}
+		}
+	else
+		{
+			node_p -> ain_boxes [node_p -> ain_num_children] = item_p -> ii_box;
+			node_p -> ain_children [node_p -> ain_num_children] = item_p -> ii_child;
+			++ (node_p -> ain_num_children);
+		}
+
+	if (node_p -> ain_num_children > ADDRESS_INDEX_NODE_CAPACITY)
+		{
+			SplitIndexNode (index_p, node_index, split_item_p);
+			*split_flag_p = true;
+		}
+	else
+		{
+			*split_flag_p = false;
+		}
+}
+
+
+/* Choose the child whose extent grows the least, breaking ties by the smallest area */
+static uint32 ChooseIndexSubtree (const AddressIndexNode *node_p, const FixedBoundingBox *box_p)
+{
+	uint32 best_child = 0;
+	double64 best_growth = HUGE_VAL;
+	double64 best_area = HUGE_VAL;
+	uint32 i;
+
+	for (i = 0; i < node_p -> ain_num_children; ++ i)
+		{
+			FixedBoundingBox extended_box = node_p -> ain_boxes [i];
+			const double64 area = GetBoundingBoxArea (&extended_box);
+			double64 growth;
+
+			ExtendBoundingBox (&extended_box, box_p);
+			growth = GetBoundingBoxArea (&extended_box) - area;
+
+			if ((growth < best_growth) || ((growth == best_growth) && (area < best_area)))
+				{
+					best_child = i;
+					best_growth = growth;
+					best_area = area;
+				}
+		}
+
+	return best_child;
+}
+
+
+/*
+ * Split an overfull node in two by sorting its children along the axis
+ * where their centres are most spread out and moving the upper half
+ * into a new node.
+ */
+static void SplitIndexNode (AddressIndex *index_p, const uint32 node_index, IndexItem *split_item_p)
+{
+	IndexItem items [ADDRESS_INDEX_NODE_CAPACITY + 1];
+	const uint32 new_node_index = AllocateIndexNode (index_p, index_p -> ai_nodes_p [node_index].ain_level);
+	AddressIndexNode *node_p = index_p -> ai_nodes_p + node_index;
+	AddressIndexNode *new_node_p = index_p -> ai_nodes_p + new_node_index;
+	const uint32 num_items = node_p -> ain_num_children;
+	const uint32 num_kept = num_items / 2;
+	FixedBoundingBox centres;
+	uint32 i;
+
+	for (i = 0; i < num_items; ++ i)
+		{
+			const FixedBoundingBox *box_p = node_p -> ain_boxes + i;
+			FixedCoordinate centre;
+
+			centre.fc_latitude = (int32) (((int64) box_p -> fbb_south_west.fc_latitude + (int64) box_p -> fbb_north_east.fc_latitude) / 2);
+			centre.fc_longitude = (int32) (((int64) box_p -> fbb_south_west.fc_longitude + (int64) box_p -> fbb_north_east.fc_longitude) / 2);
+
+			if (i == 0)
+				{
+					centres.fbb_south_west = centre;
+					centres.fbb_north_east = centre;
+				}
+			else
+				{
+					ExpandFixedBoundingBox (&centres, &centre);
+				}
+
+			items [i].ii_box = *box_p;
+			items [i].ii_child = node_p -> ain_children [i];
+		}
+
+	if (((int64) centres.fbb_north_east.fc_longitude - (int64) centres.fbb_south_west.fc_longitude) >= ((int64) centres.fbb_north_east.fc_latitude - (int64) centres.fbb_south_west.fc_latitude))
+		{
+			qsort (items, num_items, sizeof (IndexItem), CompareIndexItemsByLongitude);
+		}
+	else
+		{
+			qsort (items, num_items, sizeof (IndexItem), CompareIndexItemsByLatitude);
+		}
+
+	for (i = 0; i < num_kept; ++ i)
+		{
+			node_p -> ain_boxes [i] = items [i].ii_box;
+			node_p -> ain_children [i] = items [i].ii_child;
+		}
+
+	node_p -> ain_num_children = num_kept;
+
+	for (i = num_kept; i < num_items; ++ i)
+		{
+			new_node_p -> ain_boxes [i - num_kept] = items [i].ii_box;
+			new_node_p -> ain_children [i - num_kept] = items [i].ii_child;
+		}
+
+	new_node_p -> ain_num_children = num_items - num_kept;
+
+	GetIndexNodeExtent (new_node_p, & (split_item_p -> ii_box));
+	split_item_p -> ii_child = new_node_index;
+}
+
+
+static void GetIndexNodeExtent (const AddressIndexNode *node_p, FixedBoundingBox *extent_p)
+{
+	uint32 i;
+
+	*extent_p = node_p -> ain_boxes [0];
+
+	for (i = 1; i < node_p -> ain_num_children; ++ i)
+		{
+			ExtendBoundingBox (extent_p, node_p -> ain_boxes + i);
+		}
+}
+
+
+static void ExtendBoundingBox (FixedBoundingBox *box_p, const FixedBoundingBox *other_box_p)
+{
+	ExpandFixedBoundingBox (box_p, & (other_box_p -> fbb_south_west));
+	ExpandFixedBoundingBox (box_p, & (other_box_p -> fbb_north_east));
+}
+
+
+static double64 GetBoundingBoxArea (const FixedBoundingBox *box_p)
+{
+	return ((double64) box_p -> fbb_north_east.fc_latitude - (double64) box_p -> fbb_south_west.fc_latitude) *
+		((double64) box_p -> fbb_north_east.fc_longitude - (double64) box_p -> fbb_south_west.fc_longitude);
+}
+
+
+static int CompareIndexItemsByLongitude (const void *v0_p, const void *v1_p)
+{
+	const FixedBoundingBox *box0_p = & (((const IndexItem *) v0_p) -> ii_box);
+	const FixedBoundingBox *box1_p = & (((const IndexItem *) v1_p) -> ii_box);
+	const int64 centre0 = (int64) box0_p -> fbb_south_west.fc_longitude + (int64) box0_p -> fbb_north_east.fc_longitude;
+	const int64 centre1 = (int64) box1_p -> fbb_south_west.fc_longitude + (int64) box1_p -> fbb_north_east.fc_longitude;
+
+	return (centre0 < centre1) ? -1 : ((centre0 > centre1) ? 1 : 0);
+}
+
+
+static int CompareIndexItemsByLatitude (const void *v0_p, const void *v1_p)
+{
+	const FixedBoundingBox *box0_p = & (((const IndexItem *) v0_p) -> ii_box);
+	const FixedBoundingBox *box1_p = & (((const IndexItem *) v1_p) -> ii_box);
+	const int64 centre0 = (int64) box0_p -> fbb_south_west.fc_latitude + (int64) box0_p -> fbb_north_east.fc_latitude;
+	const int64 centre1 = (int64) box1_p -> fbb_south_west.fc_latitude + (int64) box1_p -> fbb_north_east.fc_latitude;
+
+	return (centre0 < centre1) ? -1 : ((centre0 > centre1) ? 1 : 0);
+}
+
+
+static void CollectAddressesInBox (const AddressIndex *index_p, const uint32 node_index, const FixedBoundingBox *box_p, const Address **results_pp, const size_t max_results, size_t *num_results_p)
+{
+	const AddressIndexNode *node_p = index_p -> ai_nodes_p + node_index;
+	uint32 i;
+
+	for (i = 0; i < node_p -> ain_num_children; ++ i)
+		{
+			const FixedBoundingBox *child_box_p = node_p -> ain_boxes + i;
+
+			if (DoFixedBoundingBoxesIntersect (child_box_p, box_p))
+				{
+					if (node_p -> ain_level > 0)
+						{
+							CollectAddressesInBox (index_p, node_p -> ain_children [i], box_p, results_pp, max_results, num_results_p);
+						}
+					else
+						{
+							if (*num_results_p < max_results)
+								{
+									results_pp [*num_results_p] = index_p -> ai_entries_p [node_p -> ain_children [i]].aie_address_p;
+								}
+
+							++ (*num_results_p);
+						}
+				}
+		}
+}
+
+
+/*
+ * A best-first search: the heap holds nodes keyed by the distance to
+ * the nearest point of their extent and entries keyed by the distance
+ * to their centre, so entries come off the heap in order of distance.
+ * Distances are compared using the haversine of the angle between the
+ * points, which rises with the distance, so the inverse trigonometry
+ * is only done for the matches.
+ */
+static bool SearchNearestAddresses (const AddressIndex *index_p, const IndexQuery *query_p, const size_t max_results, const double64 radius, IndexHeap *heap_p, AddressIndexResult *results_p, size_t *num_results_p)
+{
+	size_t num_results = 0;
+	bool success_flag = true;
+	double64 limit = 1.0;
+
+	if (radius >= 0.0)
+		{
+			const double64 half_angle = 0.5 * radius / GEO_DISTANCE_EARTH_RADIUS;
+
+			if (half_angle < AI_HALF_PI)
+				{
+					limit = sin (half_angle);
+					limit *= limit;
+				}
+		}
+
+	heap_p -> ih_size = 0;
+
+	if ((max_results > 0) && (index_p -> ai_num_entries > 0))
+		{
+			success_flag = PushIndexHeapItem (heap_p, 0.0, index_p -> ai_root, false);
+		}
+
+	while (success_flag && (heap_p -> ih_size > 0) && (num_results < max_results))
+		{
+			IndexHeapItem item;
+
+			PopIndexHeapItem (heap_p, &item);
+
+			if (item.ihi_entry_flag)
+				{
+					AddressIndexResult *result_p = results_p + num_results;
+					const double64 separation = (item.ihi_separation < 1.0) ? item.ihi_separation : 1.0;
+
+					result_p -> air_address_p = index_p -> ai_entries_p [item.ihi_child].aie_address_p;
+					result_p -> air_distance = 2.0 * GEO_DISTANCE_EARTH_RADIUS * asin (sqrt (separation));
+
+					++ num_results;
+				}
+			else
+				{
+					const AddressIndexNode *node_p = index_p -> ai_nodes_p + item.ihi_child;
+					uint32 i;
+
+					for (i = 0; (i < node_p -> ain_num_children) && success_flag; ++ i)
+						{
+							const uint32 child = node_p -> ain_children [i];
+							double64 separation;
+
+							if (node_p -> ain_level > 0)
+								{
+									separation = GetQuerySeparationToBox (query_p, node_p -> ain_boxes + i);
+								}
+							else
+								{
+									/* The haversine of the angle is a quarter of the square of the chord length */
+									const double64 *position_p = index_p -> ai_entries_p [child].aie_position;
+									const double64 dx = *position_p - query_p -> iq_position [0];
+									const double64 dy = * (position_p + 1) - query_p -> iq_position [1];
+									const double64 dz = * (position_p + 2) - query_p -> iq_position [2];
+
+									separation = 0.25 * ((dx * dx) + (dy * dy) + (dz * dz));
+								}
+
+							if (separation <= limit)
+								{
+									success_flag = PushIndexHeapItem (heap_p, separation, child, (node_p -> ain_level == 0));
+								}
+						}
+				}
+		}
+
+	*num_results_p = num_results;
+
+	return success_flag;
+}
+
+
+static bool SetIndexQuery (IndexQuery *query_p, const Coordinate *point_p)
+{
+	/* This also catches NaNs */
+	if ((point_p -> co_x >= -90.0) && (point_p -> co_x <= 90.0) && (point_p -> co_y >= -180.0) && (point_p -> co_y <= 180.0))
+		{
+			query_p -> iq_latitude = point_p -> co_x;
+			query_p -> iq_longitude = point_p -> co_y;
+			query_p -> iq_cos_latitude = cos ((point_p -> co_x) * AI_DEGREES_TO_RADIANS);
+			query_p -> iq_tan_latitude = tan ((point_p -> co_x) * AI_DEGREES_TO_RADIANS);
+
+			GetUnitSpherePosition (point_p -> co_x, point_p -> co_y, query_p -> iq_position);
+
+			return true;
+		}
+
+	return false;
+}
+
+
+static void GetUnitSpherePosition (const double64 latitude, const double64 longitude, double64 *position_p)
+{
+	const double64 latitude_radians = latitude * AI_DEGREES_TO_RADIANS;
+	const double64 longitude_radians = longitude * AI_DEGREES_TO_RADIANS;
+	const double64 cos_latitude = cos (latitude_radians);
+
+	*position_p = cos_latitude * cos (longitude_radians);
+	* (position_p + 1) = cos_latitude * sin (longitude_radians);
+	* (position_p + 2) = sin (latitude_radians);
+}
+
+
+/*
+ * Get the haversine of the angle from the query point to the nearest point
+ * of a box. If the point is within the box's longitudes, that is straight
+ * north or south. Otherwise it is on the nearer of the box's meridian
+ * edges, at the latitude where the great circle through the query point
+ * meets that meridian at right angles, limited to the box's latitudes.
+ */
+static double64 GetQuerySeparationToBox (const IndexQuery *query_p, const FixedBoundingBox *box_p)
+{
+	const double64 south = GetFixedCoordinateLatitude (& (box_p -> fbb_south_west));
+	const double64 north = GetFixedCoordinateLatitude (& (box_p -> fbb_north_east));
+	const double64 west = GetFixedCoordinateLongitude (& (box_p -> fbb_south_west));
+	const double64 east = GetFixedCoordinateLongitude (& (box_p -> fbb_north_east));
+	const double64 latitude = query_p -> iq_latitude;
+	const double64 longitude = query_p -> iq_longitude;
+
+	if ((longitude >= west) && (longitude <= east))
+		{
+			double64 sin_half_latitude = 0.0;
+
+			if (latitude < south)
+				{
+					sin_half_latitude = sin (0.5 * (south - latitude) * AI_DEGREES_TO_RADIANS);
+				}
+			else if (latitude > north)
+				{
+					sin_half_latitude = sin (0.5 * (latitude - north) * AI_DEGREES_TO_RADIANS);
+				}
+
+			return sin_half_latitude * sin_half_latitude;
+		}
+	else
+		{
+			/* The longitude differences eastwards to the west edge and westwards to the east edge */
+			const double64 to_west = (west >= longitude) ? (west - longitude) : (west - longitude + 360.0);
+			const double64 to_east = (longitude >= east) ? (longitude - east) : (longitude - east + 360.0);
+			const double64 sin_half_difference = sin (0.5 * ((to_west < to_east) ? to_west : to_east) * AI_DEGREES_TO_RADIANS);
+			const double64 sin_half_difference_sq = sin_half_difference * sin_half_difference;
+			const double64 cos_difference = 1.0 - (2.0 * sin_half_difference_sq);
+			double64 edge_latitude = (latitude >= 0.0) ? 90.0 : -90.0;
+			double64 sin_half_latitude;
+
+			if (cos_difference > 0.0)
+				{
+					edge_latitude = atan (query_p -> iq_tan_latitude / cos_difference) * AI_RADIANS_TO_DEGREES;
+
+					if ((edge_latitude >= south) && (edge_latitude <= north))
+						{
+							/*
+							 * The angle d to the meridian satisfies sin d = cos (latitude) sin (difference)
+							 * and the haversine of d is (1 - cos d) / 2
+							 */
+							const double64 sin_angle_sq = query_p -> iq_cos_latitude * query_p -> iq_cos_latitude * 4.0 * sin_half_difference_sq * (1.0 - sin_half_difference_sq);
+
+							return 0.5 * sin_angle_sq / (1.0 + sqrt (1.0 - sin_angle_sq));
+						}
+				}
+
+			if (edge_latitude < south)
+				{
+					edge_latitude = south;
+				}
+			else if (edge_latitude > north)
+				{
+					edge_latitude = north;
+				}
+
+			sin_half_latitude = sin (0.5 * (edge_latitude - latitude) * AI_DEGREES_TO_RADIANS);
+
+			return (sin_half_latitude * sin_half_latitude) + (query_p -> iq_cos_latitude * cos (edge_latitude * AI_DEGREES_TO_RADIANS) * sin_half_difference_sq);
+		}
+}
+
+
+static bool InitIndexHeap (IndexHeap *heap_p)
+{
+	heap_p -> ih_items_p = (IndexHeapItem *) AllocMemory (AI_INITIAL_CAPACITY * sizeof (IndexHeapItem));
+
+	if (heap_p -> ih_items_p)
+		{
+			heap_p -> ih_size = 0;
+			heap_p -> ih_capacity = AI_INITIAL_CAPACITY;
+
+			return true;
+		}
+
+	return false;
+}
+
+
+static void ClearIndexHeap (IndexHeap *heap_p)
+{
+	FreeMemory (heap_p -> ih_items_p);
+	heap_p -> ih_items_p = NULL;
+	heap_p -> ih_size = 0;
+	heap_p -> ih_capacity = 0;
+}
+
+
+static bool PushIndexHeapItem (IndexHeap *heap_p, const double64 separation, const uint32 child, const bool entry_flag)
+{
+	size_t i;
+
+	if (heap_p -> ih_size == heap_p -> ih_capacity)
+		{
+			const size_t new_capacity = 2 * heap_p -> ih_capacity;
+			IndexHeapItem *items_p = (IndexHeapItem *) ReallocMemory (heap_p -> ih_items_p, new_capacity * sizeof (IndexHeapItem), heap_p -> ih_capacity * sizeof (IndexHeapItem));
+
+			if (!items_p)
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to grow search heap to " SIZET_FMT " items", new_capacity);
+					return false;
+				}
+
+			heap_p -> ih_items_p = items_p;
+			heap_p -> ih_capacity = new_capacity;
+		}
+
+	i = heap_p -> ih_size;
+	++ (heap_p -> ih_size);
+
+	while (i > 0)
+		{
+			const size_t parent = (i - 1) / 2;
+
+			if (heap_p -> ih_items_p [parent].ihi_separation <= separation)
+				{
+					break;
+				}
+
+			heap_p -> ih_items_p [i] = heap_p -> ih_items_p [parent];
+			i = parent;
+		}
+
+	heap_p -> ih_items_p [i].ihi_separation = separation;
+	heap_p -> ih_items_p [i].ihi_child = child;
+	heap_p -> ih_items_p [i].ihi_entry_flag = entry_flag;
+
+	return true;
+}
+
+
+static void PopIndexHeapItem (IndexHeap *heap_p, IndexHeapItem *item_p)
+{
+	IndexHeapItem *items_p = heap_p -> ih_items_p;
+	const IndexHeapItem last = items_p [-- (heap_p -> ih_size)];
+	const size_t size = heap_p -> ih_size;
+	size_t i = 0;
+
+	*item_p = items_p [0];
+
+	while (true)
+		{
+			size_t child = (2 * i) + 1;
+
+			if (child >= size)
+				{
+					break;
+				}
+
+			if ((child + 1 < size) && (items_p [child + 1].ihi_separation < items_p [child].ihi_separation))
+				{
+					++ child;
+				}
+
+			if (last.ihi_separation <= items_p [child].ihi_separation)
+				{
+					break;
+				}
+
+			items_p [i] = items_p [child];
+			i = child;
+		}
+
+	if (size > 0)
+		{
+			items_p [i] = last;
+		}
+}
+
+
+static int CompareIndexQueryOrders (const void *v0_p, const void *v1_p)
+{
+	const uint64 code0 = ((const IndexQueryOrder *) v0_p) -> iqo_code;
+	const uint64 code1 = ((const IndexQueryOrder *) v1_p) -> iqo_code;
+
+	return (code0 < code1) ? -1 : ((code0 > code1) ? 1 : 0);
+}
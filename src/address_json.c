@@ -0,0 +1,1108 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * address_json.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * The layout written here follows jansson's dump.c so that the output
+ * matches json_dumps() byte for byte. Reading uses the JSONSpan
+ * functions so no jansson tree is built in either direction.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "address_json.h"
+#include "coordinate.h"
+#include "country_codes.h"
+#include "double_conversion.h"
+#include "json_on_demand.h"
+
+#include "jansson.h"
+#include "memory_allocations.h"
+#include "streams.h"
+#include "string_utils.h"
+
+
+/*
+ * These are the same as the private macros in jansson's dump.c
+ */
+#define AJ_FLAGS_TO_INDENT(f) ((f) & 0x1F)
+#define AJ_FLAGS_TO_PRECISION(f) (((f) >> 11) & 0x1F)
+
+
+static const char * const S_TYPE_KEY_S = "@type";
+static const char * const S_POSTAL_ADDRESS_S = "PostalAddress";
+static const char * const S_GEO_COORDINATES_S = "so:GeoCoordinates";
+
+
+/*
+ * Where the JSON is being written to, either a ByteBuffer or
+ * a fixed-size caller buffer.
+ */
+typedef struct AddressJSONWriter
+{
+	ByteBuffer *ajw_buffer_p;
+	char *ajw_data_s;
+	size_t ajw_size;
+	size_t ajw_length;
+	size_t ajw_flags;
+} AddressJSONWriter;
+
+
+typedef enum
+{
+	AJM_STRING,
+	AJM_REAL,
+	AJM_COORDINATE,
+	AJM_POSTAL_ADDRESS,
+	AJM_LOCATION
+} AddressJSONMemberType;
+
+
+/*
+ * A member of one of the objects being written
+ */
+typedef struct AddressJSONMember
+{
+	const char *ajm_key_s;
+	AddressJSONMemberType ajm_type;
+	const void *ajm_value_p;
+} AddressJSONMember;
+
+
+/* The most members that any of the objects have: @type plus the 6 address fields */
+#define AJ_MAX_MEMBERS (7)
+
+
+static void InitAddressJSONWriter (AddressJSONWriter *writer_p, ByteBuffer *buffer_p, char *data_s, const size_t size, const size_t flags);
+
+static bool WriteJSONData (AddressJSONWriter *writer_p, const char *data_p, const size_t length);
+
+static bool WriteJSONIndent (AddressJSONWriter *writer_p, const size_t depth, const bool space_flag);
+
+static bool WriteJSONString (AddressJSONWriter *writer_p, const char *value_s);
+
+static bool WriteJSONReal (AddressJSONWriter *writer_p, const double64 value);
+
+static bool WriteJSONObject (AddressJSONWriter *writer_p, AddressJSONMember *members_p, const size_t num_members, const size_t depth);
+
+static bool WriteJSONMemberValue (AddressJSONWriter *writer_p, const AddressJSONMember *member_p, const size_t depth);
+
+static bool WriteAddressJSON (AddressJSONWriter *writer_p, const Address *address_p, const size_t depth);
+
+static void AddMember (AddressJSONMember *members_p, size_t *num_members_p, const char *key_s, const AddressJSONMemberType member_type, const void *value_p);
+
+static int CompareAddressJSONMembers (const void *v0_p, const void *v1_p);
+
+static const char *GetNextCodePoint (const char *value_s, uint32 *code_point_p);
+
+static size_t TidyJSONReal (char *buffer_s, size_t length);
+
+static bool SetAddressFromJSONSpan (Address *address_p, const JSONSpan *address_json_p);
+
+static bool SetPostalAddressFromJSONSpan (Address *address_p, const JSONSpan *postal_address_json_p);
+
+static bool SetLocationFromJSONSpan (Address *address_p, const JSONSpan *location_json_p);
+
+static bool GetCoordinateFromJSONSpan (const JSONSpan *coord_json_p, double64 *latitude_p, double64 *longitude_p, double64 *elevation_p, bool *has_elevation_p);
+
+static void ReplaceAddressString (char **value_ss, char *value_s);
+
+static void RemoveCoordinate (Coordinate **coord_pp);
+
+
+
+bool AppendAddressAsJSONToByteBuffer (const Address *address_p, ByteBuffer *buffer_p, const size_t flags)
+{
+	AddressJSONWriter writer;
+
+	InitAddressJSONWriter (&writer, buffer_p, NULL, 0, flags);
+
+	return WriteAddressJSON (&writer, address_p, 0);
+}
+
+
+bool WriteAddressAsJSON (const Address *address_p, char *buffer_s, const size_t buffer_size, const size_t flags, size_t *length_p)
+{
+	bool success_flag;
+	AddressJSONWriter writer;
+
+	InitAddressJSONWriter (&writer, NULL, buffer_s, buffer_size, flags);
+
+	success_flag = WriteAddressJSON (&writer, address_p, 0);
+
+	if (buffer_size > 0)
+		{
+			const size_t terminator_index = (writer.ajw_length < buffer_size) ? writer.ajw_length : buffer_size - 1;
+
+			* (buffer_s + terminator_index) = '\0';
+		}
+
+	if (length_p)
+		{
+			*length_p = writer.ajw_length;
+		}
+
+	return success_flag;
+}
+
+
+bool StartAddressJSONStream (AddressJSONStream *stream_p, ByteBuffer *buffer_p, const AddressJSONFormat format, const size_t flags)
+{
+	stream_p -> ajs_buffer_p = buffer_p;
+	stream_p -> ajs_format = format;
+	stream_p -> ajs_num_addresses = 0;
+
+	if (format == AJF_JSON_LINES)
+		{
+			stream_p -> ajs_flags = flags & ~ ((size_t) JSON_MAX_INDENT);
+
+			return true;
+		}
+	else
+		{
+			stream_p -> ajs_flags = flags;
+
+			return AppendToByteBuffer (buffer_p, "[", 1);
+		}
+}
+
+
+bool AppendAddressToJSONStream (AddressJSONStream *stream_p, const Address *address_p)
+{
+	bool success_flag = false;
+	AddressJSONWriter writer;
+
+	InitAddressJSONWriter (&writer, stream_p -> ajs_buffer_p, NULL, 0, stream_p -> ajs_flags);
+
+	if (stream_p -> ajs_format == AJF_JSON_LINES)
+		{
+			if (WriteAddressJSON (&writer, address_p, 0))
+				{
+					success_flag = WriteJSONData (&writer, "\n", 1);
+				}
+		}
+	else
+		{
+			if (stream_p -> ajs_num_addresses > 0)
+				{
+					success_flag = WriteJSONData (&writer, ",", 1) && WriteJSONIndent (&writer, 1, true);
+				}
+			else
+				{
+					success_flag = WriteJSONIndent (&writer, 1, false);
+				}
+
+			if (success_flag)
+				{
+					success_flag = WriteAddressJSON (&writer, address_p, 1);
+				}
+		}
+
+	if (success_flag)
+		{
+			++ (stream_p -> ajs_num_addresses);
+		}
+
+	return success_flag;
+}
+
+
+bool EndAddressJSONStream (AddressJSONStream *stream_p)
+{
+	bool success_flag = true;
+
+	if (stream_p -> ajs_format == AJF_ARRAY)
+		{
+			AddressJSONWriter writer;
+
+			InitAddressJSONWriter (&writer, stream_p -> ajs_buffer_p, NULL, 0, stream_p -> ajs_flags);
+
+			if (stream_p -> ajs_num_addresses > 0)
+				{
+					success_flag = WriteJSONIndent (&writer, 0, false);
+				}
+
+			if (success_flag)
+				{
+					success_flag = WriteJSONData (&writer, "]", 1);
+				}
+		}
+
+	return success_flag;
+}
+
+
+bool SetAddressFromJSONText (Address *address_p, const char *json_s, const size_t length)
+{
+	JSONSpan address_json;
+
+	if (InitJSONSpan (&address_json, json_s, length))
+		{
+			return SetAddressFromJSONSpan (address_p, &address_json);
+		}
+
+	return false;
+}
+
+
+Address *GetAddressFromJSONText (const char *json_s, const size_t length)
+{
+	Address *address_p = (Address *) AllocMemory (sizeof (Address));
+
+	if (address_p)
+		{
+			memset (address_p, 0, sizeof (Address));
+
+			if (SetAddressFromJSONText (address_p, json_s, length))
+				{
+					return address_p;
+				}
+
+			FreeAddress (address_p);
+		}
+
+	return NULL;
+}
+
+
+int64 ParseAddressesFromJSONText (const char *json_s, const size_t length, AddressJSONCallback callback_fn, void *user_data_p)
+{
+	int64 num_addresses = 0;
+	const char *data_p = json_s;
+	const char *end_p = json_s + length;
+	JSONSpanIterator iterator;
+	JSONSpan address_json;
+	Address address;
+
+	while ((data_p < end_p) && ((*data_p == ' ') || (*data_p == '\t') || (*data_p == '\n') || (*data_p == '\r')))
+		{
+			++ data_p;
+		}
+
+	/*
+	 * An array's elements are read in the same way as a sequence of values,
+	 * stopping at its closing bracket, so the whole array doesn't need to be
+	 * scanned up front.
+	 */
+	if ((data_p < end_p) && (*data_p == '['))
+		{
+			++ data_p;
+		}
+
+	InitJSONSpanSequenceIterator (&iterator, data_p, end_p - data_p);
+	memset (&address, 0, sizeof (Address));
+
+	while (GetNextJSONSpanElement (&iterator, &address_json))
+		{
+			if (SetAddressFromJSONSpan (&address, &address_json))
+				{
+					++ num_addresses;
+
+					if (!callback_fn (&address, user_data_p))
+						{
+							break;
+						}
+				}
+			else
+				{
+					const size_t l = address_json.js_end_p - address_json.js_start_p;
+
+					PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Skipping invalid address \"%.*s\"", (int) ((l < 64) ? l : 64), address_json.js_start_p);
+				}
+		}
+
+	ClearAddress (&address);
+
+	if (HasJSONSpanIteratorFailed (&iterator))
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Stopped reading addresses at invalid JSON");
+			num_addresses = -1;
+		}
+
+	return num_addresses;
+}
+
+
+static bool SetAddressFromJSONSpan (Address *address_p, const JSONSpan *address_json_p)
+{
+	bool postal_address_flag = false;
+	bool location_flag = false;
+	JSONSpanIterator iterator;
+	JSONSpan key;
+	JSONSpan value;
+
+	if (!InitJSONSpanMemberIterator (&iterator, address_json_p))
+		{
+			return false;
+		}
+
+	/* The coordinates are kept so that they can be reused */
+	ReplaceAddressString (& (address_p -> ad_name_s), NULL);
+	ReplaceAddressString (& (address_p -> ad_street_s), NULL);
+	ReplaceAddressString (& (address_p -> ad_town_s), NULL);
+	ReplaceAddressString (& (address_p -> ad_county_s), NULL);
+	ReplaceAddressString (& (address_p -> ad_country_s), NULL);
+	ReplaceAddressString (& (address_p -> ad_postcode_s), NULL);
+	ReplaceAddressString (& (address_p -> ad_country_code_s), NULL);
+	ReplaceAddressString (& (address_p -> ad_gps_s), NULL);
+
+	while (GetNextJSONSpanMember (&iterator, &key, &value))
+		{
+			if (IsJSONSpanStringEqualTo (&key, AD_ADDRESS_S))
+				{
+					postal_address_flag = SetPostalAddressFromJSONSpan (address_p, &value);
+				}
+			else if (IsJSONSpanStringEqualTo (&key, AD_LOCATION_S))
+				{
+					if (!SetLocationFromJSONSpan (address_p, &value))
+						{
+							return false;
+						}
+
+					location_flag = true;
+				}
+		}
+
+	if (HasJSONSpanIteratorFailed (&iterator))
+		{
+			return false;
+		}
+
+	if (!location_flag)
+		{
+			RemoveCoordinate (& (address_p -> ad_gps_centre_p));
+			RemoveCoordinate (& (address_p -> ad_gps_north_east_p));
+			RemoveCoordinate (& (address_p -> ad_gps_south_west_p));
+		}
+
+	return postal_address_flag;
+}
+
+
+static bool SetPostalAddressFromJSONSpan (Address *address_p, const JSONSpan *postal_address_json_p)
+{
+	const char *keys_ss [] = { AD_NAME_S, AD_STREET_S, AD_TOWN_S, AD_COUNTY_S, AD_COUNTRY_S, AD_POSTCODE_S, NULL };
+	char **values_sss [] = { & (address_p -> ad_name_s), & (address_p -> ad_street_s), & (address_p -> ad_town_s), & (address_p -> ad_county_s), & (address_p -> ad_country_s), & (address_p -> ad_postcode_s) };
+	bool type_flag = false;
+	JSONSpanIterator iterator;
+	JSONSpan key;
+	JSONSpan value;
+
+	if (!InitJSONSpanMemberIterator (&iterator, postal_address_json_p))
+		{
+			return false;
+		}
+
+	while (GetNextJSONSpanMember (&iterator, &key, &value))
+		{
+			if (GetJSONSpanType (&value) == JST_STRING)
+				{
+					if (IsJSONSpanStringEqualTo (&key, S_TYPE_KEY_S))
+						{
+							type_flag = IsJSONSpanStringEqualTo (&value, S_POSTAL_ADDRESS_S);
+						}
+					else
+						{
+							size_t i = 0;
+
+							while (keys_ss [i])
+								{
+									if (IsJSONSpanStringEqualTo (&key, keys_ss [i]))
+										{
+											char *value_s = GetJSONSpanString (&value);
+
+											if (!value_s)
+												{
+													return false;
+												}
+
+											ReplaceAddressString (values_sss [i], value_s);
+											break;
+										}
+
+									++ i;
+								}
+						}
+				}
+		}
+
+	if (HasJSONSpanIteratorFailed (&iterator) || !type_flag)
+		{
+			return false;
+		}
+
+	if (address_p -> ad_country_s)
+		{
+			const char *country_code_s = GetCountryCodeFromName (address_p -> ad_country_s);
+
+			if (country_code_s)
+				{
+					char *copied_country_code_s = EasyCopyToNewString (country_code_s);
+
+					if (!copied_country_code_s)
+						{
+							return false;
+						}
+
+					ReplaceAddressString (& (address_p -> ad_country_code_s), copied_country_code_s);
+				}
+		}
+
+	return true;
+}
+
+
+static bool SetLocationFromJSONSpan (Address *address_p, const JSONSpan *location_json_p)
+{
+	bool success_flag = true;
+	bool centre_flag = false;
+	bool north_east_flag = false;
+	bool south_west_flag = false;
+	JSONSpanIterator iterator;
+
+	/* Like json_object_get (), a location that isn't an object just has no coordinates */
+	if (InitJSONSpanMemberIterator (&iterator, location_json_p))
+		{
+			JSONSpan key;
+			JSONSpan value;
+
+			while (success_flag && GetNextJSONSpanMember (&iterator, &key, &value))
+				{
+					double64 latitude;
+					double64 longitude;
+					double64 elevation;
+					bool elevation_flag;
+
+					if (GetCoordinateFromJSONSpan (&value, &latitude, &longitude, &elevation, &elevation_flag))
+						{
+							const double64 *elevation_p = elevation_flag ? &elevation : NULL;
+
+							if (IsJSONSpanStringEqualTo (&key, AD_CENTRE_LOCATION_S))
+								{
+									success_flag = centre_flag = SetAddressCentreCoordinate (address_p, latitude, longitude, elevation_p);
+								}
+							else if (IsJSONSpanStringEqualTo (&key, AD_NORTH_EAST_LOCATION_S))
+								{
+									success_flag = north_east_flag = SetAddressNorthEastCoordinate (address_p, latitude, longitude, elevation_p);
+								}
+							else if (IsJSONSpanStringEqualTo (&key, AD_SOUTH_WEST_LOCATION_S))
+								{
+									success_flag = south_west_flag = SetAddressSouthWestCoordinate (address_p, latitude, longitude, elevation_p);
+								}
+						}
+				}
+
+			if (HasJSONSpanIteratorFailed (&iterator))
+				{
+					success_flag = false;
+				}
+		}
+
+	if (!centre_flag)
+		{
+			RemoveCoordinate (& (address_p -> ad_gps_centre_p));
+		}
+
+	if (!north_east_flag)
+		{
+			RemoveCoordinate (& (address_p -> ad_gps_north_east_p));
+		}
+
+	if (!south_west_flag)
+		{
+			RemoveCoordinate (& (address_p -> ad_gps_south_west_p));
+		}
+
+	return success_flag;
+}
+
+
+/*
+ * As with SetCoordinateFromJSON (), the latitude and longitude are
+ * required and the elevation is optional.
+ */
+static bool GetCoordinateFromJSONSpan (const JSONSpan *coord_json_p, double64 *latitude_p, double64 *longitude_p, double64 *elevation_p, bool *has_elevation_p)
+{
+	bool latitude_flag = false;
+	bool longitude_flag = false;
+	JSONSpanIterator iterator;
+	JSONSpan key;
+	JSONSpan value;
+
+	*has_elevation_p = false;
+
+	if (!InitJSONSpanMemberIterator (&iterator, coord_json_p))
+		{
+			return false;
+		}
+
+	while (GetNextJSONSpanMember (&iterator, &key, &value))
+		{
+			if (IsJSONSpanStringEqualTo (&key, CO_LATITUDE_S))
+				{
+					latitude_flag = GetJSONSpanReal (&value, latitude_p);
+				}
+			else if (IsJSONSpanStringEqualTo (&key, CO_LONGITUDE_S))
+				{
+					longitude_flag = GetJSONSpanReal (&value, longitude_p);
+				}
+			else if (IsJSONSpanStringEqualTo (&key, CO_ELEVATION_S))
+				{
+					*has_elevation_p = GetJSONSpanReal (&value, elevation_p);
+				}
+		}
+
+	return (latitude_flag && longitude_flag && !HasJSONSpanIteratorFailed (&iterator));
+}
+
+
+static void ReplaceAddressString (char **value_ss, char *value_s)
+{
+	if (*value_ss)
+		{
+			FreeCopiedString (*value_ss);
+		}
+
+	*value_ss = value_s;
+}
+
+
+static void RemoveCoordinate (Coordinate **coord_pp)
+{
+	if (*coord_pp)
+		{
+			FreeCoordinate (*coord_pp);
+			*coord_pp = NULL;
+		}
+}
+
+
+static void InitAddressJSONWriter (AddressJSONWriter *writer_p, ByteBuffer *buffer_p, char *data_s, const size_t size, const size_t flags)
+{
+	writer_p -> ajw_buffer_p = buffer_p;
+	writer_p -> ajw_data_s = data_s;
+	writer_p -> ajw_size = size;
+	writer_p -> ajw_length = 0;
+	writer_p -> ajw_flags = flags;
+}
+
+
+/*
+ * The same objects and member order as GetAddressAsJSON ()
+ */
+static bool WriteAddressJSON (AddressJSONWriter *writer_p, const Address *address_p, const size_t depth)
+{
+	AddressJSONMember members [2];
+	size_t num_members = 0;
+
+	if (address_p -> ad_town_s || address_p -> ad_county_s || address_p -> ad_country_s || address_p -> ad_postcode_s)
+		{
+			AddMember (members, &num_members, AD_ADDRESS_S, AJM_POSTAL_ADDRESS, address_p);
+		}
+
+	AddMember (members, &num_members, AD_LOCATION_S, AJM_LOCATION, address_p);
+
+	return WriteJSONObject (writer_p, members, num_members, depth);
+}
+
+
+static bool WriteJSONMemberValue (AddressJSONWriter *writer_p, const AddressJSONMember *member_p, const size_t depth)
+{
+	AddressJSONMember members [AJ_MAX_MEMBERS];
+	size_t num_members = 0;
+
+	switch (member_p -> ajm_type)
+		{
+			case AJM_STRING:
+				return WriteJSONString (writer_p, (const char *) (member_p -> ajm_value_p));
+
+			case AJM_REAL:
+				return WriteJSONReal (writer_p, * ((const double64 *) (member_p -> ajm_value_p)));
+
+			case AJM_COORDINATE:
+				{
+					const Coordinate *coord_p = (const Coordinate *) (member_p -> ajm_value_p);
+
+					AddMember (members, &num_members, S_TYPE_KEY_S, AJM_STRING, S_GEO_COORDINATES_S);
+					AddMember (members, &num_members, CO_LATITUDE_S, AJM_REAL, & (coord_p -> co_x));
+					AddMember (members, &num_members, CO_LONGITUDE_S, AJM_REAL, & (coord_p -> co_y));
+
+					if (coord_p -> co_elevation_p)
+						{
+							AddMember (members, &num_members, CO_ELEVATION_S, AJM_REAL, coord_p -> co_elevation_p);
+						}
+				}
+				break;
+
+			case AJM_POSTAL_ADDRESS:
+				{
+					const Address *address_p = (const Address *) (member_p -> ajm_value_p);
+
+					AddMember (members, &num_members, S_TYPE_KEY_S, AJM_STRING, S_POSTAL_ADDRESS_S);
+					AddMember (members, &num_members, AD_NAME_S, AJM_STRING, address_p -> ad_name_s);
+					AddMember (members, &num_members, AD_STREET_S, AJM_STRING, address_p -> ad_street_s);
+					AddMember (members, &num_members, AD_TOWN_S, AJM_STRING, address_p -> ad_town_s);
+					AddMember (members, &num_members, AD_COUNTY_S, AJM_STRING, address_p -> ad_county_s);
+					AddMember (members, &num_members, AD_COUNTRY_S, AJM_STRING, address_p -> ad_country_s);
+					AddMember (members, &num_members, AD_POSTCODE_S, AJM_STRING, address_p -> ad_postcode_s);
+				}
+				break;
+
+			case AJM_LOCATION:
+				{
+					const Address *address_p = (const Address *) (member_p -> ajm_value_p);
+
+					AddMember (members, &num_members, AD_CENTRE_LOCATION_S, AJM_COORDINATE, address_p -> ad_gps_centre_p);
+					AddMember (members, &num_members, AD_NORTH_EAST_LOCATION_S, AJM_COORDINATE, address_p -> ad_gps_north_east_p);
+					AddMember (members, &num_members, AD_SOUTH_WEST_LOCATION_S, AJM_COORDINATE, address_p -> ad_gps_south_west_p);
+				}
+				break;
+
+			default:
+				return false;
+		}
+
+	return WriteJSONObject (writer_p, members, num_members, depth);
+}
+
+
+/*
+ * Add a member if it has a value, in the same way that
+ * AddValidJSONField () and AddCoordinateToJSON () skip
+ * NULL values.
+ */
+static void AddMember (AddressJSONMember *members_p, size_t *num_members_p, const char *key_s, const AddressJSONMemberType member_type, const void *value_p)
+{
+	if (value_p)
+		{
+			AddressJSONMember *member_p = members_p + (*num_members_p);
+
+			member_p -> ajm_key_s = key_s;
+			member_p -> ajm_type = member_type;
+			member_p -> ajm_value_p = value_p;
+
+			++ (*num_members_p);
+		}
+}
+
+
+static bool WriteJSONObject (AddressJSONWriter *writer_p, AddressJSONMember *members_p, const size_t num_members, const size_t depth)
+{
+	const char *separator_s = (writer_p -> ajw_flags & JSON_COMPACT) ? ":" : ": ";
+	const size_t separator_length = strlen (separator_s);
+	size_t i;
+
+	if (!WriteJSONData (writer_p, "{", 1))
+		{
+			return false;
+		}
+
+	if (num_members == 0)
+		{
+			return WriteJSONData (writer_p, "}", 1);
+		}
+
+	if (!WriteJSONIndent (writer_p, depth + 1, false))
+		{
+			return false;
+		}
+
+	if (writer_p -> ajw_flags & JSON_SORT_KEYS)
+		{
+			qsort (members_p, num_members, sizeof (AddressJSONMember), CompareAddressJSONMembers);
+		}
+
+	for (i = 0; i < num_members; ++ i)
+		{
+			const AddressJSONMember *member_p = members_p + i;
+
+			if (!WriteJSONString (writer_p, member_p -> ajm_key_s))
+				{
+					return false;
+				}
+
+			if (!WriteJSONData (writer_p, separator_s, separator_length))
+				{
+					return false;
+				}
+
+			if (!WriteJSONMemberValue (writer_p, member_p, depth + 1))
+				{
+					return false;
+				}
+
+			if (i < num_members - 1)
+				{
+					if (! ((WriteJSONData (writer_p, ",", 1)) && (WriteJSONIndent (writer_p, depth + 1, true))))
+						{
+							return false;
+						}
+				}
+			else
+				{
+					if (!WriteJSONIndent (writer_p, depth, false))
+						{
+							return false;
+						}
+				}
+		}
+
+	return WriteJSONData (writer_p, "}", 1);
+}
+
+
+static int CompareAddressJSONMembers (const void *v0_p, const void *v1_p)
+{
+	const AddressJSONMember *member0_p = (const AddressJSONMember *) v0_p;
+	const AddressJSONMember *member1_p = (const AddressJSONMember *) v1_p;
+
+	return strcmp (member0_p -> ajm_key_s, member1_p -> ajm_key_s);
+}
+
+
+static bool WriteJSONData (AddressJSONWriter *writer_p, const char *data_p, const size_t length)
+{
+	bool success_flag = true;
+
+	if (writer_p -> ajw_buffer_p)
+		{
+			success_flag = AppendToByteBuffer (writer_p -> ajw_buffer_p, data_p, length);
+		}
+	else if (writer_p -> ajw_length < writer_p -> ajw_size)
+		{
+			/* leave room for the terminating '\0' */
+			const size_t space = writer_p -> ajw_size - writer_p -> ajw_length - 1;
+			const size_t l = (length < space) ? length : space;
+
+			memcpy (writer_p -> ajw_data_s + writer_p -> ajw_length, data_p, l);
+		}
+
+	writer_p -> ajw_length += length;
+
+	return success_flag;
+}
+
+
+static bool WriteJSONIndent (AddressJSONWriter *writer_p, const size_t depth, const bool space_flag)
+{
+	const size_t indent = AJ_FLAGS_TO_INDENT (writer_p -> ajw_flags);
+
+	if (indent > 0)
+		{
+			static const char S_SPACES_S [] = "                                ";
+			size_t num_spaces = depth * indent;
+
+			if (!WriteJSONData (writer_p, "\n", 1))
+				{
+					return false;
+				}
+
+			while (num_spaces > 0)
+				{
+					const size_t n = (num_spaces < sizeof (S_SPACES_S) - 1) ? num_spaces : sizeof (S_SPACES_S) - 1;
+
+					if (!WriteJSONData (writer_p, S_SPACES_S, n))
+						{
+							return false;
+						}
+
+					num_spaces -= n;
+				}
+		}
+	else if (space_flag && ! (writer_p -> ajw_flags & JSON_COMPACT))
+		{
+			return WriteJSONData (writer_p, " ", 1);
+		}
+
+	return true;
+}
+
+
+static bool WriteJSONString (AddressJSONWriter *writer_p, const char *value_s)
+{
+	const bool escape_slash_flag = ((writer_p -> ajw_flags & JSON_ESCAPE_SLASH) != 0);
+	const bool ensure_ascii_flag = ((writer_p -> ajw_flags & JSON_ENSURE_ASCII) != 0);
+	const char *run_s = value_s;
+	const char *c_p = value_s;
+
+	if (!WriteJSONData (writer_p, "\"", 1))
+		{
+			return false;
+		}
+
+	while (*c_p)
+		{
+			const unsigned char c = (const unsigned char) *c_p;
+
+			/* copy runs of plain ASCII as they are */
+			if ((c >= 0x20) && (c < 0x80) && (c != '"') && (c != '\\') && ((c != '/') || !escape_slash_flag))
+				{
+					++ c_p;
+				}
+			else
+				{
+					uint32 code_point;
+					const char *next_p = GetNextCodePoint (c_p, &code_point);
+
+					if (!next_p)
+						{
+							PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "\"%s\" is not valid UTF-8", value_s);
+							return false;
+						}
+
+					if ((code_point >= 0x80) && !ensure_ascii_flag)
+						{
+							c_p = next_p;
+						}
+					else
+						{
+							char escape_s [13];
+							const char *text_s = escape_s;
+							size_t length = 2;
+
+							if ((c_p > run_s) && (!WriteJSONData (writer_p, run_s, c_p - run_s)))
+								{
+									return false;
+								}
+
+							switch (code_point)
+								{
+									case '\\':
+										text_s = "\\\\";
+										break;
+
+									case '"':
+										text_s = "\\\"";
+										break;
+
+									case '\b':
+										text_s = "\\b";
+										break;
+
+									case '\f':
+										text_s = "\\f";
+										break;
+
+									case '\n':
+										text_s = "\\n";
+										break;
+
+									case '\r':
+										text_s = "\\r";
+										break;
+
+									case '\t':
+										text_s = "\\t";
+										break;
+
+									case '/':
+										text_s = "\\/";
+										break;
+
+									default:
+										if (code_point < 0x10000)
+											{
+												snprintf (escape_s, sizeof (escape_s), "\\u%04X", (unsigned int) code_point);
+												length = 6;
+											}
+										else
+											{
+												const uint32 first = 0xD800 | ((code_point - 0x10000) >> 10);
+												const uint32 last = 0xDC00 | ((code_point - 0x10000) & 0x3FF);
+
+												snprintf (escape_s, sizeof (escape_s), "\\u%04X\\u%04X", (unsigned int) first, (unsigned int) last);
+												length = 12;
+											}
+										break;
+								}
+
+							if (!WriteJSONData (writer_p, text_s, length))
+								{
+									return false;
+								}
+
+							c_p = run_s = next_p;
+						}
+				}
+
+		}		/* while (*c_p) */
+
+	if ((c_p > run_s) && (!WriteJSONData (writer_p, run_s, c_p - run_s)))
+		{
+			return false;
+		}
+
+	return WriteJSONData (writer_p, "\"", 1);
+}
+
+
+/*
+ * Decode a UTF-8 sequence, rejecting overlong forms, surrogates
+ * and values above U+10FFFF just as jansson does.
+ */
+static const char *GetNextCodePoint (const char *value_s, uint32 *code_point_p)
+{
+	const unsigned char *u_p = (const unsigned char *) value_s;
+	uint32 code_point;
+	size_t num_bytes;
+	size_t i;
+
+	if (*u_p < 0x80)
+		{
+			*code_point_p = *u_p;
+			return value_s + 1;
+		}
+	else if ((*u_p >= 0xC2) && (*u_p <= 0xDF))
+		{
+			code_point = *u_p & 0x1F;
+			num_bytes = 2;
+		}
+	else if ((*u_p >= 0xE0) && (*u_p <= 0xEF))
+		{
+			code_point = *u_p & 0x0F;
+			num_bytes = 3;
+		}
+	else if ((*u_p >= 0xF0) && (*u_p <= 0xF4))
+		{
+			code_point = *u_p & 0x07;
+			num_bytes = 4;
+		}
+	else
+		{
+			return NULL;
+		}
+
+	for (i = 1; i < num_bytes; ++ i)
+		{
+			if ((u_p [i] & 0xC0) != 0x80)
+				{
+					return NULL;
+				}
+
+			code_point = (code_point << 6) | (u_p [i] & 0x3F);
+		}
+
+	if (((num_bytes == 3) && (code_point < 0x800)) || ((num_bytes == 4) && (code_point < 0x10000)) || (code_point > 0x10FFFF) || ((code_point >= 0xD800) && (code_point <= 0xDFFF)))
+		{
+			return NULL;
+		}
+
+	*code_point_p = code_point;
+
+	return value_s + num_bytes;
+}
+
+
+static bool WriteJSONReal (AddressJSONWriter *writer_p, const double64 value)
+{
+	char buffer_s [64];
+	size_t length;
+
+	/* json_real () doesn't allow these either */
+	if (isnan (value) || isinf (value))
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Cannot write " DOUBLE64_FMT " as a JSON real", value);
+			return false;
+		}
+
+	if (writer_p -> ajw_flags & ADDRESS_JSON_SHORTEST_REALS)
+		{
+			length = WriteShortestDouble (value, buffer_s);
+		}
+	else
+		{
+			int precision = (int) AJ_FLAGS_TO_PRECISION (writer_p -> ajw_flags);
+			int res;
+			char *c_p;
+
+			if (precision == 0)
+				{
+					precision = 17;
+				}
+
+			res = snprintf (buffer_s, sizeof (buffer_s), "%.*g", precision, value);
+
+			if ((res < 0) || (((size_t) res) >= sizeof (buffer_s) - 3))
+				{
+					return false;
+				}
+
+			length = (size_t) res;
+
+			/* undo any locale-specific decimal point */
+			if ((c_p = strchr (buffer_s, ',')) != NULL)
+				{
+					*c_p = '.';
+				}
+		}
+
+	length = TidyJSONReal (buffer_s, length);
+
+	return WriteJSONData (writer_p, buffer_s, length);
+}
+
+
+/*
+ * Make the same adjustments as jansson's jsonp_dtostr (): make sure
+ * that there is a '.' or 'e' so the value is read back as a real and
+ * remove any '+' and leading zeros from the exponent.
+ */
+static size_t TidyJSONReal (char *buffer_s, size_t length)
+{
+	char *start_p;
+
+	if ((strchr (buffer_s, '.') == NULL) && (strchr (buffer_s, 'e') == NULL))
+		{
+			buffer_s [length] = '.';
+			buffer_s [length + 1] = '0';
+			buffer_s [length + 2] = '\0';
+			length += 2;
+		}
+
+	start_p = strchr (buffer_s, 'e');
+
+	if (start_p)
+		{
+			char *end_p;
+
+			++ start_p;
+			end_p = start_p + 1;
+
+			if (*start_p == '-')
+				{
+					++ start_p;
+				}
+
+			while (*end_p == '0')
+				{
+					++ end_p;
+				}
+
+			if (end_p != start_p)
+				{
+					memmove (start_p, end_p, length - (size_t) (end_p - buffer_s) + 1);
+					length -= (size_t) (end_p - start_p);
+				}
+		}
+
+	return length;
+}
@@ -0,0 +1,690 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * address_record.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "address_record.h"
+#include "coordinate.h"
+#include "fixed_coordinate.h"
+
+#include "memory_allocations.h"
+#include "streams.h"
+#include "string_utils.h"
+
+
+static const char S_MAGIC_S [4] = { 'G', 'G', 'A', 'R' };
+
+/* The bits in a record's flags */
+#define AR_POINT_FLAG(p) (1 << (p))
+#define AR_ELEVATION_FLAG(p) (1 << (ARP_NUM_POINTS + (p)))
+
+#define AR_ABSENT_COMPONENT (0xFFFF)
+
+/* The size of the fixed part of each record */
+#define AR_RECORD_PREFIX_SIZE (16)
+
+/* Coordinates are stored as FixedCoordinates and elevations in millimetres */
+#define AR_ELEVATION_SCALE (1e3)
+
+
+static void StoreUInt16 (uint8 *dest_p, const uint16 value);
+
+static void StoreUInt32 (uint8 *dest_p, const uint32 value);
+
+static void StoreUInt64 (uint8 *dest_p, const uint64 value);
+
+static uint16 LoadUInt16 (const uint8 *src_p);
+
+static uint32 LoadUInt32 (const uint8 *src_p);
+
+static uint64 LoadUInt64 (const uint8 *src_p);
+
+static bool ToFixedPoint (const double64 value, const double64 scale, const double64 limit, int32 *fixed_p);
+
+static uint8 *StorePoint (uint8 *dest_p, const Coordinate *coord_p, const AddressRecordPoint point, uint16 *flags_p);
+
+static bool AppendRecordComponent (ByteBuffer *buffer_p, const char *value_s);
+
+static bool ReadAddressRecordHeader (const uint8 *data_p, const size_t length, uint32 *num_records_p);
+
+static bool SetAddressValueFromRecordView (char **value_ss, const AddressRecordView *view_p, const AddressRecordComponent component);
+
+static bool SetAddressPointFromRecordView (Address *address_p, const AddressRecordView *view_p, const AddressRecordPoint point, Coordinate **coord_pp);
+
+
+
+bool AppendAddressRecordHeaderToByteBuffer (ByteBuffer *buffer_p, const uint32 num_records)
+{
+	uint8 header [ADDRESS_RECORD_HEADER_SIZE];
+
+	memcpy (header, S_MAGIC_S, sizeof (S_MAGIC_S));
+	StoreUInt16 (header + 4, ADDRESS_RECORD_VERSION);
+	StoreUInt16 (header + 6, ADDRESS_RECORD_HEADER_SIZE);
+	StoreUInt32 (header + 8, num_records);
+	StoreUInt32 (header + 12, 0);
+
+	return AppendToByteBuffer (buffer_p, header, ADDRESS_RECORD_HEADER_SIZE);
+}
+
+
+bool AppendAddressRecordToByteBuffer (const Address *address_p, const char *provider_s, const char *provenance_s, const int64 timestamp, ByteBuffer *buffer_p)
+{
+	/* The fixed part plus the largest possible set of points */
+	uint8 prefix [AR_RECORD_PREFIX_SIZE + ARP_NUM_POINTS * 3 * sizeof (int32)];
+	uint8 *prefix_p = prefix + AR_RECORD_PREFIX_SIZE;
+	const size_t start = GetByteBufferSize (buffer_p);
+	uint16 flags = 0;
+
+	if (! ((prefix_p = StorePoint (prefix_p, address_p -> ad_gps_centre_p, ARP_CENTRE, &flags)) &&
+				 (prefix_p = StorePoint (prefix_p, address_p -> ad_gps_north_east_p, ARP_NORTH_EAST, &flags)) &&
+				 (prefix_p = StorePoint (prefix_p, address_p -> ad_gps_south_west_p, ARP_SOUTH_WEST, &flags))))
+		{
+			return false;
+		}
+
+	/* the length is filled in once the whole record has been added */
+	StoreUInt32 (prefix, 0);
+	StoreUInt16 (prefix + 4, flags);
+	StoreUInt16 (prefix + 6, 0);
+	StoreUInt64 (prefix + 8, (uint64) timestamp);
+
+	if (AppendToByteBuffer (buffer_p, prefix, prefix_p - prefix))
+		{
+			const char *values_ss [ARC_NUM_COMPONENTS];
+			size_t i;
+
+			values_ss [ARC_NAME] = address_p -> ad_name_s;
+			values_ss [ARC_STREET] = address_p -> ad_street_s;
+			values_ss [ARC_TOWN] = address_p -> ad_town_s;
+			values_ss [ARC_COUNTY] = address_p -> ad_county_s;
+			values_ss [ARC_COUNTRY] = address_p -> ad_country_s;
+			values_ss [ARC_POSTCODE] = address_p -> ad_postcode_s;
+			values_ss [ARC_COUNTRY_CODE] = address_p -> ad_country_code_s;
+			values_ss [ARC_GPS] = address_p -> ad_gps_s;
+			values_ss [ARC_PROVIDER] = provider_s;
+			values_ss [ARC_PROVENANCE] = provenance_s;
+
+			for (i = 0; i < ARC_NUM_COMPONENTS; ++ i)
+				{
+					if (!AppendRecordComponent (buffer_p, values_ss [i]))
+						{
+							break;
+						}
+				}
+
+			if (i == ARC_NUM_COMPONENTS)
+				{
+					const size_t record_length = GetByteBufferSize (buffer_p) - start;
+
+					StoreUInt32 ((uint8 *) (buffer_p -> bb_data_p + start), (uint32) record_length);
+
+					return true;
+				}
+		}
+
+	/* Don't leave a partial record behind */
+	buffer_p -> bb_current_index = start;
+
+	return false;
+}
+
+
+bool ReadAddressRecord (const void *data_p, const size_t length, AddressRecordView *view_p, size_t *record_length_p)
+{
+	const uint8 *record_p = (const uint8 *) data_p;
+	const uint8 *end_p;
+	const uint8 *current_p;
+	uint32 record_length;
+	size_t i;
+
+	if (length < AR_RECORD_PREFIX_SIZE)
+		{
+			return false;
+		}
+
+	record_length = LoadUInt32 (record_p);
+
+	if ((record_length < AR_RECORD_PREFIX_SIZE) || (record_length > length))
+		{
+			return false;
+		}
+
+	end_p = record_p + record_length;
+
+	view_p -> arv_flags = LoadUInt16 (record_p + 4);
+	view_p -> arv_timestamp = (int64) LoadUInt64 (record_p + 8);
+	current_p = record_p + AR_RECORD_PREFIX_SIZE;
+
+	for (i = 0; i < ARP_NUM_POINTS; ++ i)
+		{
+			int32 *point_p = view_p -> arv_points [i];
+
+			if (view_p -> arv_flags & AR_POINT_FLAG (i))
+				{
+					const size_t point_size = (view_p -> arv_flags & AR_ELEVATION_FLAG (i)) ? 3 * sizeof (int32) : 2 * sizeof (int32);
+
+					if ((size_t) (end_p - current_p) < point_size)
+						{
+							return false;
+						}
+
+					*point_p = (int32) LoadUInt32 (current_p);
+					* (point_p + 1) = (int32) LoadUInt32 (current_p + 4);
+					* (point_p + 2) = (view_p -> arv_flags & AR_ELEVATION_FLAG (i)) ? (int32) LoadUInt32 (current_p + 8) : 0;
+
+					current_p += point_size;
+				}
+			else
+				{
+					memset (point_p, 0, 3 * sizeof (int32));
+				}
+		}
+
+	for (i = 0; i < ARC_NUM_COMPONENTS; ++ i)
+		{
+			uint16 component_length;
+
+			if (end_p - current_p < 2)
+				{
+					return false;
+				}
+
+			component_length = LoadUInt16 (current_p);
+			current_p += 2;
+
+			if (component_length == AR_ABSENT_COMPONENT)
+				{
+					view_p -> arv_components_ss [i] = NULL;
+					view_p -> arv_component_lengths [i] = 0;
+				}
+			else
+				{
+					/* make sure that the value is terminated so it can be used in place */
+					if (((size_t) (end_p - current_p) <= component_length) || (* (current_p + component_length) != '\0'))
+						{
+							return false;
+						}
+
+					view_p -> arv_components_ss [i] = (const char *) current_p;
+					view_p -> arv_component_lengths [i] = component_length;
+
+					current_p += component_length + 1;
+				}
+		}
+
+	if (record_length_p)
+		{
+			*record_length_p = record_length;
+		}
+
+	return true;
+}
+
+
+bool GetAddressRecordPoint (const AddressRecordView *view_p, const AddressRecordPoint point, double64 *latitude_p, double64 *longitude_p, double64 *elevation_p, bool *has_elevation_p)
+{
+	if (view_p -> arv_flags & AR_POINT_FLAG (point))
+		{
+			const int32 *point_p = view_p -> arv_points [point];
+			const bool elevation_flag = ((view_p -> arv_flags & AR_ELEVATION_FLAG (point)) != 0);
+			FixedCoordinate fixed;
+
+			fixed.fc_latitude = *point_p;
+			fixed.fc_longitude = * (point_p + 1);
+
+			*latitude_p = GetFixedCoordinateLatitude (&fixed);
+			*longitude_p = GetFixedCoordinateLongitude (&fixed);
+
+			if (elevation_flag && elevation_p)
+				{
+					*elevation_p = ((double64) * (point_p + 2)) / AR_ELEVATION_SCALE;
+				}
+
+			if (has_elevation_p)
+				{
+					*has_elevation_p = elevation_flag;
+				}
+
+			return true;
+		}
+
+	return false;
+}
+
+
+bool SetAddressFromRecordView (Address *address_p, const AddressRecordView *view_p)
+{
+	return (SetAddressValueFromRecordView (& (address_p -> ad_name_s), view_p, ARC_NAME) &&
+		SetAddressValueFromRecordView (& (address_p -> ad_street_s), view_p, ARC_STREET) &&
+		SetAddressValueFromRecordView (& (address_p -> ad_town_s), view_p, ARC_TOWN) &&
+		SetAddressValueFromRecordView (& (address_p -> ad_county_s), view_p, ARC_COUNTY) &&
+		SetAddressValueFromRecordView (& (address_p -> ad_country_s), view_p, ARC_COUNTRY) &&
+		SetAddressValueFromRecordView (& (address_p -> ad_postcode_s), view_p, ARC_POSTCODE) &&
+		SetAddressValueFromRecordView (& (address_p -> ad_country_code_s), view_p, ARC_COUNTRY_CODE) &&
+		SetAddressValueFromRecordView (& (address_p -> ad_gps_s), view_p, ARC_GPS) &&
+		SetAddressPointFromRecordView (address_p, view_p, ARP_CENTRE, & (address_p -> ad_gps_centre_p)) &&
+		SetAddressPointFromRecordView (address_p, view_p, ARP_NORTH_EAST, & (address_p -> ad_gps_north_east_p)) &&
+		SetAddressPointFromRecordView (address_p, view_p, ARP_SOUTH_WEST, & (address_p -> ad_gps_south_west_p)));
+}
+
+
+AddressRecordWriter *AllocateAddressRecordWriter (const char *filename_s)
+{
+	FILE *out_f = fopen (filename_s, "wb");
+
+	if (out_f)
+		{
+			ByteBuffer *buffer_p = AllocateByteBuffer (1024);
+
+			if (buffer_p)
+				{
+					if (AppendAddressRecordHeaderToByteBuffer (buffer_p, 0))
+						{
+							AddressRecordWriter *writer_p = (AddressRecordWriter *) AllocMemory (sizeof (AddressRecordWriter));
+
+							if (writer_p)
+								{
+									writer_p -> arw_out_f = out_f;
+									writer_p -> arw_buffer_p = buffer_p;
+									writer_p -> arw_num_records = 0;
+
+									return writer_p;
+								}
+						}
+
+					FreeByteBuffer (buffer_p);
+				}
+
+			fclose (out_f);
+		}
+	else
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to open \"%s\" for writing", filename_s);
+		}
+
+	return NULL;
+}
+
+
+bool AddAddressRecord (AddressRecordWriter *writer_p, const Address *address_p, const char *provider_s, const char *provenance_s, const int64 timestamp)
+{
+	ByteBuffer *buffer_p = writer_p -> arw_buffer_p;
+
+	if (AppendAddressRecordToByteBuffer (address_p, provider_s, provenance_s, timestamp, buffer_p))
+		{
+			++ (writer_p -> arw_num_records);
+
+			/* write the records out in reasonably-sized blocks */
+			if (GetByteBufferSize (buffer_p) >= 65536)
+				{
+					const size_t size = GetByteBufferSize (buffer_p);
+
+					if (fwrite (GetByteBufferData (buffer_p), 1, size, writer_p -> arw_out_f) != size)
+						{
+							PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to write " SIZET_FMT " bytes of address records", size);
+							return false;
+						}
+
+					ResetByteBuffer (buffer_p);
+				}
+
+			return true;
+		}
+
+	return false;
+}
+
+
+bool CloseAddressRecordWriter (AddressRecordWriter *writer_p)
+{
+	bool success_flag = true;
+	const size_t size = GetByteBufferSize (writer_p -> arw_buffer_p);
+
+	if (fwrite (GetByteBufferData (writer_p -> arw_buffer_p), 1, size, writer_p -> arw_out_f) != size)
+		{
+			success_flag = false;
+		}
+
+	/* Now that it's known, fill in the number of records in the header */
+	if (success_flag)
+		{
+			uint8 num_records [4];
+
+			StoreUInt32 (num_records, writer_p -> arw_num_records);
+
+			success_flag = ((fseek (writer_p -> arw_out_f, 8, SEEK_SET) == 0) && (fwrite (num_records, 1, sizeof (num_records), writer_p -> arw_out_f) == sizeof (num_records)));
+		}
+
+	if (fclose (writer_p -> arw_out_f) != 0)
+		{
+			success_flag = false;
+		}
+
+	if (!success_flag)
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to finish writing " UINT32_FMT " address records", writer_p -> arw_num_records);
+		}
+
+	FreeByteBuffer (writer_p -> arw_buffer_p);
+	FreeMemory (writer_p);
+
+	return success_flag;
+}
+
+
+AddressRecordFile *OpenAddressRecordFile (const char *filename_s)
+{
+	AddressRecordFile *record_file_p = (AddressRecordFile *) AllocMemory (sizeof (AddressRecordFile));
+
+	if (record_file_p)
+		{
+			/* the records are usually read from start to end */
+			if (OpenMappedFile (& (record_file_p -> arf_file), filename_s, ADDRESS_RECORD_HEADER_SIZE, MFA_SEQUENTIAL))
+				{
+					const uint8 *data_p = record_file_p -> arf_file.mf_data_p;
+					const size_t size = record_file_p -> arf_file.mf_size;
+
+					if (ReadAddressRecordHeader (data_p, size, & (record_file_p -> arf_num_records)))
+						{
+							return record_file_p;
+						}
+
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "\"%s\" is not a supported address record file", filename_s);
+					CloseAddressRecordFile (record_file_p);
+
+					return NULL;
+				}
+			else
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to map \"%s\"", filename_s);
+				}
+
+			FreeMemory (record_file_p);
+		}
+
+	return NULL;
+}
+
+
+void CloseAddressRecordFile (AddressRecordFile *record_file_p)
+{
+	CloseMappedFile (& (record_file_p -> arf_file));
+
+	FreeMemory (record_file_p);
+}
+
+
+uint32 GetAddressRecordFileSize (const AddressRecordFile *record_file_p)
+{
+	return record_file_p -> arf_num_records;
+}
+
+
+void InitAddressRecordIterator (AddressRecordIterator *iterator_p, const AddressRecordFile *record_file_p)
+{
+	/* The header has already been checked by OpenAddressRecordFile () */
+	iterator_p -> ari_current_p = record_file_p -> arf_file.mf_data_p + LoadUInt16 (record_file_p -> arf_file.mf_data_p + 6);
+	iterator_p -> ari_end_p = record_file_p -> arf_file.mf_data_p + record_file_p -> arf_file.mf_size;
+	iterator_p -> ari_failed_flag = false;
+}
+
+
+bool InitAddressRecordBufferIterator (AddressRecordIterator *iterator_p, const void *data_p, const size_t length)
+{
+	const uint8 *start_p = (const uint8 *) data_p;
+	uint32 num_records;
+
+	if (ReadAddressRecordHeader (start_p, length, &num_records))
+		{
+			iterator_p -> ari_current_p = start_p + LoadUInt16 (start_p + 6);
+			iterator_p -> ari_end_p = start_p + length;
+			iterator_p -> ari_failed_flag = false;
+
+			return true;
+		}
+
+	return false;
+}
+
+
+bool GetNextAddressRecord (AddressRecordIterator *iterator_p, AddressRecordView *view_p)
+{
+	if (iterator_p -> ari_current_p < iterator_p -> ari_end_p)
+		{
+			size_t record_length;
+
+			if (ReadAddressRecord (iterator_p -> ari_current_p, iterator_p -> ari_end_p - iterator_p -> ari_current_p, view_p, &record_length))
+				{
+					iterator_p -> ari_current_p += record_length;
+					return true;
+				}
+
+			iterator_p -> ari_failed_flag = true;
+			iterator_p -> ari_current_p = iterator_p -> ari_end_p;
+		}
+
+	return false;
+}
+
+
+bool HasAddressRecordIteratorFailed (const AddressRecordIterator *iterator_p)
+{
+	return iterator_p -> ari_failed_flag;
+}
+
+
+static bool ReadAddressRecordHeader (const uint8 *data_p, const size_t length, uint32 *num_records_p)
+{
+	if ((length >= ADDRESS_RECORD_HEADER_SIZE) && (memcmp (data_p, S_MAGIC_S, sizeof (S_MAGIC_S)) == 0))
+		{
+			const uint16 version = LoadUInt16 (data_p + 4);
+			const uint16 header_size = LoadUInt16 (data_p + 6);
+
+			if ((version >= 1) && (version <= ADDRESS_RECORD_VERSION) && (header_size >= ADDRESS_RECORD_HEADER_SIZE) && (header_size <= length))
+				{
+					*num_records_p = LoadUInt32 (data_p + 8);
+					return true;
+				}
+		}
+
+	return false;
+}
+
+
+static uint8 *StorePoint (uint8 *dest_p, const Coordinate *coord_p, const AddressRecordPoint point, uint16 *flags_p)
+{
+	if (coord_p)
+		{
+			FixedCoordinate fixed;
+
+			if (!SetFixedCoordinateFromCoordinate (&fixed, coord_p))
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Cannot store coordinate [" DOUBLE64_FMT ", " DOUBLE64_FMT "]", coord_p -> co_x, coord_p -> co_y);
+					return NULL;
+				}
+
+			StoreUInt32 (dest_p, (uint32) fixed.fc_latitude);
+			StoreUInt32 (dest_p + 4, (uint32) fixed.fc_longitude);
+			dest_p += 8;
+
+			*flags_p |= AR_POINT_FLAG (point);
+
+			if (coord_p -> co_elevation_p)
+				{
+					int32 elevation;
+
+					/* just over 2000 km either way */
+					if (!ToFixedPoint (* (coord_p -> co_elevation_p), AR_ELEVATION_SCALE, 2.0e6, &elevation))
+						{
+							PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Cannot store elevation " DOUBLE64_FMT, * (coord_p -> co_elevation_p));
+							return NULL;
+						}
+
+					StoreUInt32 (dest_p, (uint32) elevation);
+					dest_p += 4;
+
+					*flags_p |= AR_ELEVATION_FLAG (point);
+				}
+		}
+
+	return dest_p;
+}
+
+
+static bool ToFixedPoint (const double64 value, const double64 scale, const double64 limit, int32 *fixed_p)
+{
+	if ((value >= -limit) && (value <= limit))
+		{
+			*fixed_p = (int32) lround (value * scale);
+			return true;
+		}
+
+	/* This also catches NaNs */
+	return false;
+}
+
+
+static bool AppendRecordComponent (ByteBuffer *buffer_p, const char *value_s)
+{
+	uint8 length_buffer [2];
+
+	if (value_s)
+		{
+			const size_t length = strlen (value_s);
+
+			if (length >= AR_ABSENT_COMPONENT)
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Cannot store value of " SIZET_FMT " bytes", length);
+					return false;
+				}
+
+			StoreUInt16 (length_buffer, (uint16) length);
+
+			/* include the terminating '\0' */
+			return (AppendToByteBuffer (buffer_p, length_buffer, sizeof (length_buffer)) && AppendToByteBuffer (buffer_p, value_s, length + 1));
+		}
+
+	StoreUInt16 (length_buffer, AR_ABSENT_COMPONENT);
+
+	return AppendToByteBuffer (buffer_p, length_buffer, sizeof (length_buffer));
+}
+
+
+static bool SetAddressValueFromRecordView (char **value_ss, const AddressRecordView *view_p, const AddressRecordComponent component)
+{
+	char *value_s = NULL;
+
+	if (view_p -> arv_components_ss [component])
+		{
+			value_s = EasyCopyToNewString (view_p -> arv_components_ss [component]);
+
+			if (!value_s)
+				{
+					return false;
+				}
+		}
+
+	if (*value_ss)
+		{
+			FreeCopiedString (*value_ss);
+		}
+
+	*value_ss = value_s;
+
+	return true;
+}
+
+
+static bool SetAddressPointFromRecordView (Address *address_p, const AddressRecordView *view_p, const AddressRecordPoint point, Coordinate **coord_pp)
+{
+	double64 latitude;
+	double64 longitude;
+	double64 elevation;
+	bool elevation_flag;
+
+	if (GetAddressRecordPoint (view_p, point, &latitude, &longitude, &elevation, &elevation_flag))
+		{
+			const double64 *elevation_p = elevation_flag ? &elevation : NULL;
+
+			switch (point)
+				{
+					case ARP_CENTRE:
+						return SetAddressCentreCoordinate (address_p, latitude, longitude, elevation_p);
+
+					case ARP_NORTH_EAST:
+						return SetAddressNorthEastCoordinate (address_p, latitude, longitude, elevation_p);
+
+					case ARP_SOUTH_WEST:
+						return SetAddressSouthWestCoordinate (address_p, latitude, longitude, elevation_p);
+
+					default:
+						return false;
+				}
+		}
+	else if (*coord_pp)
+		{
+			FreeCoordinate (*coord_pp);
+			*coord_pp = NULL;
+		}
+
+	return true;
+}
+
+
+static void StoreUInt16 (uint8 *dest_p, const uint16 value)
+{
+	*dest_p = (uint8) value;
+	* (dest_p + 1) = (uint8) (value >> 8);
+}
+
+
+static void StoreUInt32 (uint8 *dest_p, const uint32 value)
+{
+	StoreUInt16 (dest_p, (uint16) value);
+	StoreUInt16 (dest_p + 2, (uint16) (value >> 16));
+}
+
+
+static void StoreUInt64 (uint8 *dest_p, const uint64 value)
+{
+	StoreUInt32 (dest_p, (uint32) value);
+	StoreUInt32 (dest_p + 4, (uint32) (value >> 32));
+}
+
+
+static uint16 LoadUInt16 (const uint8 *src_p)
+{
+	return (uint16) (*src_p | (* (src_p + 1) << 8));
+}
+
+
+static uint32 LoadUInt32 (const uint8 *src_p)
+{
+	return ((uint32) LoadUInt16 (src_p)) | (((uint32) LoadUInt16 (src_p + 2)) << 16);
+}
+
+
+static uint64 LoadUInt64 (const uint8 *src_p)
+{
+	return ((uint64) LoadUInt32 (src_p)) | (((uint64) LoadUInt32 (src_p + 4)) << 32);
+}
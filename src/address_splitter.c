@@ -0,0 +1,1558 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * address_splitter.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "address_splitter.h"
+#include "address_canonical.h"
+#include "country_codes.h"
+#include "postcode.h"
+#include "task_threads.h"
+
+#include "memory_allocations.h"
+#include "streams.h"
+#include "string_utils.h"
+
+
+/* Texts with more words or parts than these aren't addresses */
+#define AS_MAX_WORDS (64)
+
+#define AS_MAX_PARTS (32)
+
+/* The most words at the end of a part that are looked up as a place name */
+#define AS_MAX_PLACE_WORDS (6)
+
+/* The longest canonical place name */
+#define AS_MAX_KEY_LENGTH (255)
+
+#define AS_INITIAL_CAPACITY (64)
+
+/* Batches smaller than this many Addresses per thread are not worth splitting up */
+#define AS_MIN_ADDRESSES_PER_THREAD (1024)
+
+/* The kinds of place that a name can be */
+#define AS_TOWN (1 << 0)
+#define AS_COUNTY (1 << 1)
+
+
+/* A known place name */
+typedef struct SplitterPlace
+{
+	/* The canonical name, which is NULL for an unused slot */
+	char *sp_key_s;
+
+	uint32 sp_hash;
+
+	/* AS_TOWN, AS_COUNTY or both */
+	uint32 sp_kinds;
+
+	/* This is empty if the name is used in more than one country */
+	char sp_country_code_s [3];
+} SplitterPlace;
+
+
+/* What each part of the text is used for */
+typedef enum
+{
+	SR_UNKNOWN,
+	SR_NAME,
+	SR_STREET,
+	SR_TOWN,
+	SR_COUNTY,
+	SR_POSTCODE,
+	SR_COUNTRY,
+	SR_NUM_ROLES
+} SplitRole;
+
+
+typedef struct PostcodeCountry
+{
+	const char *pc_country_code_s;
+
+	/* What the rest of the postcode's part is, e.g. the state in "CA 94043" */
+	SplitRole pc_neighbour_role;
+} PostcodeCountry;
+
+
+typedef struct TextWord
+{
+	size_t tw_start;
+
+	size_t tw_end;
+} TextWord;
+
+
+/* A run of words which are all used for the same thing */
+typedef struct TextPart
+{
+	uint32 tp_first_word;
+
+	uint32 tp_num_words;
+
+	SplitRole tp_role;
+
+	/* What the part probably is if nothing better is found */
+	SplitRole tp_hint;
+} TextPart;
+
+
+typedef struct SplitText
+{
+	const char *st_text_s;
+
+	TextWord st_words [AS_MAX_WORDS];
+
+	uint32 st_num_words;
+
+	TextPart st_parts [AS_MAX_PARTS];
+
+	uint32 st_num_parts;
+
+	/* The country code that is known so far or NULL */
+	const char *st_country_code_s;
+
+	char st_postcode_s [POSTCODE_BUFFER_SIZE];
+} SplitText;
+
+
+typedef struct SplitTask
+{
+	const AddressSplitter *st_splitter_p;
+
+	Address **st_addresses_pp;
+
+	size_t st_num_addresses;
+
+	size_t st_num_split;
+} SplitTask;
+
+
+/*
+ * The countries whose postcode formats are tried, in this order, when
+ * the country isn't known. Those with letters in their postcodes, which
+ * are the least likely to be mistaken for anything else, come first.
+ */
+static const PostcodeCountry s_postcode_countries_p [] =
+{
+	{ "GB", SR_TOWN },
+	{ "CA", SR_COUNTY },
+	{ "NL", SR_TOWN },
+	{ "US", SR_COUNTY },
+	{ "JP", SR_TOWN },
+	{ "BR", SR_TOWN },
+	{ "PT", SR_TOWN },
+	{ "PL", SR_TOWN },
+	{ "SE", SR_TOWN },
+	{ "DE", SR_TOWN },
+	{ "FR", SR_TOWN },
+	{ "ES", SR_TOWN },
+	{ "IT", SR_TOWN },
+	{ "MX", SR_TOWN },
+	{ "KE", SR_TOWN },
+	{ "IN", SR_TOWN },
+	{ "CN", SR_TOWN },
+	{ "RU", SR_TOWN },
+	{ "AU", SR_COUNTY },
+	{ "AT", SR_TOWN },
+	{ "BE", SR_TOWN },
+	{ "CH", SR_TOWN },
+	{ "DK", SR_TOWN },
+	{ "NO", SR_TOWN },
+	{ "NZ", SR_TOWN },
+	{ "ZA", SR_TOWN }
+};
+
+
+/*
+ * Country codes that are also US state abbreviations, so "CA" on its own
+ * is more likely to be California than Canada. These are sorted for bsearch ().
+ */
+static const char * const s_ambiguous_country_codes_ss [] =
+{
+	"AL", "AR", "AS", "CA", "CO", "DE", "GA", "GU", "ID", "IL", "IN", "LA", "MA", "MD", "ME",
+	"MN", "MO", "MP", "MS", "MT", "NC", "NE", "PA", "PR", "SC", "VA", "VI"
+};
+
+
+/*
+ * Words that show that a part of an address is a street, in their
+ * canonical forms and sorted for bsearch ().
+ */
+static const char * const s_street_words_ss [] =
+{
+	"alley", "avenida", "avenue", "boulevard", "calle", "close", "court", "crescent", "drive",
+	"gardens", "grove", "highway", "lane", "mews", "parade", "place", "road", "row", "rua",
+	"rue", "square", "street", "terrace", "via", "walk", "way"
+};
+
+
+/*
+ * Words at the start of a part that show that it is within a building
+ * rather than a street, sorted for bsearch ().
+ */
+static const char * const s_premises_words_ss [] =
+{
+	"apartment", "apt", "building", "flat", "floor", "room", "suite", "unit"
+};
+
+
+/* Street words that are joined to the end of the street's name, e.g. "Hauptstraße" */
+static const char * const s_street_suffixes_ss [] =
+{
+	"gasse", "gatan", "straat", "strasse", "vej", "weg"
+};
+
+
+static bool AddPlace (AddressSplitter *splitter_p, const char *name_s, const char *country_code_s, const uint32 kind);
+
+static SplitterPlace *FindPlace (const AddressSplitter *splitter_p, const char *key_s, const uint32 hash);
+
+static bool GrowPlaces (AddressSplitter *splitter_p);
+
+static uint32 GetPlaceKeyHash (const char *key_s);
+
+static uint32 GetPlaceKinds (const AddressSplitter *splitter_p, const SplitText *split_p, const uint32 first_word, const uint32 num_words);
+
+static bool TokeniseText (SplitText *split_p, const char *text_s);
+
+static bool IsPartSeparator (const char c);
+
+static bool GetPhrase (const SplitText *split_p, const uint32 first_word, const uint32 num_words, char *buffer_s, const size_t buffer_size);
+
+static bool SplitPart (SplitText *split_p, const uint32 part, const uint32 num_leading_words);
+
+static bool FindCountry (SplitText *split_p);
+
+static const char *GetCountryCodeForPhrase (const char *phrase_s, const bool whole_part_flag);
+
+static bool IsAmbiguousCountryCode (const char *phrase_s);
+
+static bool FindPostcode (SplitText *split_p);
+
+static const PostcodeCountry *MatchPostcode (const SplitText *split_p, const uint32 first_word, const uint32 num_words, const bool numeric_flag, char *postcode_s);
+
+
+static bool FindPlaces (const AddressSplitter *splitter_p, SplitText *split_p);
+
+static SplitRole ChoosePlaceRole (const AddressSplitter *splitter_p, const SplitText *split_p, const uint32 part, const uint32 kinds);
+
+static void AssignRemainingParts (SplitText *split_p);
+
+static void AssignPartsBeforeStreet (SplitText *split_p, const uint32 *parts_p, const uint32 num_parts, const uint32 street);
+
+static bool IsStreetPart (const SplitText *split_p, const uint32 part);
+
+static bool IsStreet (const SplitText *split_p, const uint32 first_word, const uint32 num_words);
+
+static bool HasRole (const SplitText *split_p, const SplitRole role);
+
+static uint32 GetNumberOfUnknownParts (const SplitText *split_p);
+
+static bool SetAddressFromSplitText (const SplitText *split_p, Address *address_p);
+
+static char **GetAddressField (Address *address_p, const SplitRole role);
+
+static int CompareStrings (const void *v0_p, const void *v1_p);
+
+static void RunSplitTask (void *data_p);
+
+
+
+
+AddressSplitter *AllocateAddressSplitter (void)
+{
+	AddressSplitter *splitter_p = (AddressSplitter *) AllocMemory (sizeof (AddressSplitter));
+
+	if (splitter_p)
+		{
+			memset (splitter_p, 0, sizeof (AddressSplitter));
+
+			return splitter_p;
+		}
+
+	PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to allocate AddressSplitter");
+
+	return NULL;
+}
+
+
+void FreeAddressSplitter (AddressSplitter *splitter_p)
+{
+	uint32 i;
+
+	for (i = 0; i < splitter_p -> as_capacity; ++ i)
+		{
+			if (splitter_p -> as_places_p [i].sp_key_s)
+				{
+					FreeMemory (splitter_p -> as_places_p [i].sp_key_s);
+				}
+		}
+
+	if (splitter_p -> as_places_p)
+		{
+			FreeMemory (splitter_p -> as_places_p);
+		}
+
+	FreeMemory (splitter_p);
+}
+
+
+bool AddTownToAddressSplitter (AddressSplitter *splitter_p, const char *town_s, const char *country_code_s)
+{
+	return AddPlace (splitter_p, town_s, country_code_s, AS_TOWN);
+}
+
+
+bool AddCountyToAddressSplitter (AddressSplitter *splitter_p, const char *county_s, const char *country_code_s)
+{
+	return AddPlace (splitter_p, county_s, country_code_s, AS_COUNTY);
+}
+
+
+bool AddAdminRegionsToAddressSplitter (AddressSplitter *splitter_p, const AdminRegionIndex *index_p)
+{
+	const uint32 num_regions = GetNumberOfAdminRegions (index_p);
+	uint32 i;
+
+	for (i = 0; i < num_regions; ++ i)
+		{
+			AdminRegion region;
+
+			if (GetAdminRegion (index_p, i, &region))
+				{
+					bool success_flag = true;
+
+					if ((region.ar_level >= 4) && (region.ar_level <= 6))
+						{
+							success_flag = AddPlace (splitter_p, region.ar_name_s, NULL, AS_COUNTY);
+						}
+					else if ((region.ar_level == 7) || (region.ar_level == 8))
+						{
+							success_flag = AddPlace (splitter_p, region.ar_name_s, NULL, AS_TOWN);
+						}
+
+					if (!success_flag)
+						{
+							return false;
+						}
+				}
+		}
+
+	return true;
+}
+
+
+bool AddAddressRecordsToAddressSplitter (AddressSplitter *splitter_p, const AddressRecordFile *record_file_p)
+{
+	AddressRecordIterator iterator;
+	AddressRecordView view;
+
+	InitAddressRecordIterator (&iterator, record_file_p);
+
+	while (GetNextAddressRecord (&iterator, &view))
+		{
+			const char *country_code_s = view.arv_components_ss [ARC_COUNTRY_CODE];
+
+			if (view.arv_components_ss [ARC_TOWN])
+				{
+					if (!AddPlace (splitter_p, view.arv_components_ss [ARC_TOWN], country_code_s, AS_TOWN))
+						{
+							return false;
+						}
+				}
+
+			if (view.arv_components_ss [ARC_COUNTY])
+				{
+					if (!AddPlace (splitter_p, view.arv_components_ss [ARC_COUNTY], country_code_s, AS_COUNTY))
+						{
+							return false;
+						}
+				}
+		}
+
+	return true;
+}
+
+
+bool SplitAddressText (const AddressSplitter *splitter_p, const char *text_s, Address *address_p)
+{
+	SplitText split;
+
+	if (!TokeniseText (&split, text_s))
+		{
+			return false;
+		}
+
+	split.st_country_code_s = NULL;
+
+	if (address_p -> ad_country_code_s)
+		{
+			split.st_country_code_s = GetCanonicalCountryCode (address_p -> ad_country_code_s);
+		}
+	else if (address_p -> ad_country_s)
+		{
+			split.st_country_code_s = GetCanonicalCountryCode (address_p -> ad_country_s);
+		}
+
+	if (FindCountry (&split) && FindPostcode (&split))
+		{
+			if (splitter_p && (splitter_p -> as_num_places > 0))
+				{
+					if (!FindPlaces (splitter_p, &split))
+						{
+							return false;
+						}
+				}
+
+			AssignRemainingParts (&split);
+
+			return SetAddressFromSplitText (&split, address_p);
+		}
+
+	return false;
+}
+
+
+bool IsFreeTextAddress (const Address *address_p)
+{
+	return ((address_p -> ad_name_s != NULL) && (* (address_p -> ad_name_s) != '\0') &&
+		(address_p -> ad_street_s == NULL) && (address_p -> ad_town_s == NULL) &&
+		(address_p -> ad_county_s == NULL) && (address_p -> ad_country_s == NULL) &&
+		(address_p -> ad_postcode_s == NULL) && (address_p -> ad_country_code_s == NULL));
+}
+
+
+bool SplitAddressName (const AddressSplitter *splitter_p, Address *address_p)
+{
+	if (IsFreeTextAddress (address_p))
+		{
+			char *name_s = address_p -> ad_name_s;
+
+			address_p -> ad_name_s = NULL;
+
+			if (SplitAddressText (splitter_p, name_s, address_p))
+				{
+					FreeCopiedString (name_s);
+					return true;
+				}
+
+			address_p -> ad_name_s = name_s;
+		}
+
+	return false;
+}
+
+
+size_t SplitAddressNames (const AddressSplitter *splitter_p, Address **addresses_pp, const size_t num_addresses, const uint32 num_threads)
+{
+	const uint32 threads_to_use = GetNumberOfTaskThreads (num_threads, num_addresses, AS_MIN_ADDRESSES_PER_THREAD);
+	SplitTask *tasks_p = (SplitTask *) AllocMemory (threads_to_use * sizeof (SplitTask));
+	size_t num_split = 0;
+
+	if (tasks_p)
+		{
+			const size_t addresses_per_task = num_addresses / threads_to_use;
+			const size_t num_extra_addresses = num_addresses % threads_to_use;
+			size_t first_address = 0;
+			uint32 i;
+
+			for (i = 0; i < threads_to_use; ++ i)
+				{
+					SplitTask *task_p = tasks_p + i;
+
+					task_p -> st_splitter_p = splitter_p;
+					task_p -> st_addresses_pp = addresses_pp + first_address;
+					task_p -> st_num_addresses = addresses_per_task + ((i < num_extra_addresses) ? 1 : 0);
+					task_p -> st_num_split = 0;
+
+					first_address += task_p -> st_num_addresses;
+				}
+
+			RunTasksOnThreads (RunSplitTask, tasks_p, sizeof (SplitTask), threads_to_use);
+
+			for (i = 0; i < threads_to_use; ++ i)
+				{
+					num_split += (tasks_p + i) -> st_num_split;
+				}
+
+			FreeMemory (tasks_p);
+		}
+	else
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to allocate " UINT32_FMT " tasks to split addresses", threads_to_use);
+		}
+
+	return num_split;
+}
+
+
+
+/*
+ * STATIC DEFINITIONS
+ */
+
+
+static bool AddPlace (AddressSplitter *splitter_p, const char *name_s, const char *country_code_s, const uint32 kind)
+{
+	char key_s [AS_MAX_KEY_LENGTH + 1];
+	SplitterPlace *place_p;
+	uint32 hash;
+	uint32 num_words = 1;
+	const char *c_p;
+
+	/* Names that can't be recognised are ignored rather than treated as errors */
+	if (!CanonicaliseAddressValue (name_s, key_s, sizeof (key_s)))
+		{
+			PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Place name \"%s\" is too long to recognise", name_s);
+			return true;
+		}
+
+	if (*key_s == '\0')
+		{
+			return true;
+		}
+
+	if (country_code_s && (strlen (country_code_s) != 2))
+		{
+			PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Country code \"%s\" for \"%s\" is not valid", country_code_s, name_s);
+			return true;
+		}
+
+	/* Keep the table at most half full */
+	if ((splitter_p -> as_num_places + 1) * 2 > splitter_p -> as_capacity)
+		{
+			if (!GrowPlaces (splitter_p))
+				{
+					return false;
+				}
+		}
+
+	hash = GetPlaceKeyHash (key_s);
+	place_p = FindPlace (splitter_p, key_s, hash);
+
+	if (place_p -> sp_key_s)
+		{
+			place_p -> sp_kinds |= kind;
+
+			if ((!country_code_s) || (Stricmp (place_p -> sp_country_code_s, country_code_s) != 0))
+				{
+					* (place_p -> sp_country_code_s) = '\0';
+				}
+
+			return true;
+		}
+
+	place_p -> sp_key_s = EasyCopyToNewString (key_s);
+
+	if (! (place_p -> sp_key_s))
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to copy place name \"%s\"", key_s);
+			return false;
+		}
+
+	place_p -> sp_hash = hash;
+	place_p -> sp_kinds = kind;
+
+	if (country_code_s)
+		{
+			place_p -> sp_country_code_s [0] = (char) toupper ((unsigned char) country_code_s [0]);
+			place_p -> sp_country_code_s [1] = (char) toupper ((unsigned char) country_code_s [1]);
+			place_p -> sp_country_code_s [2] = '\0';
+		}
+	else
+		{
+			* (place_p -> sp_country_code_s) = '\0';
+		}
+
+	++ (splitter_p -> as_num_places);
+
+	for (c_p = key_s; *c_p != '\0'; ++ c_p)
+		{
+			if (*c_p == ' ')
+				{
+					++ num_words;
+				}
+		}
+
+	if (num_words > splitter_p -> as_max_words)
+		{
+			splitter_p -> as_max_words = num_words;
+		}
+
+	return true;
+}
+
+
+/*
+ * Find the place with the given key or, if it isn't there, the free
+ * slot where it can go.
+ */
+static SplitterPlace *FindPlace (const AddressSplitter *splitter_p, const char *key_s, const uint32 hash)
+{
+	const uint32 mask = splitter_p -> as_capacity - 1;
+	uint32 slot = hash & mask;
+
+	while (splitter_p -> as_places_p [slot].sp_key_s)
+		{
+			const SplitterPlace *place_p = splitter_p -> as_places_p + slot;
+
+			if ((place_p -> sp_hash == hash) && (strcmp (place_p -> sp_key_s, key_s) == 0))
+				{
+					break;
+				}
+
+			slot = (slot + 1) & mask;
+		}
+
+	return splitter_p -> as_places_p + slot;
+}
+
+
+static bool GrowPlaces (AddressSplitter *splitter_p)
+{
+	const uint32 new_capacity = (splitter_p -> as_capacity > 0) ? (splitter_p -> as_capacity << 1) : AS_INITIAL_CAPACITY;
+	SplitterPlace *places_p = (SplitterPlace *) AllocMemory (new_capacity * sizeof (SplitterPlace));
+
+	if (places_p)
+		{
+			SplitterPlace *old_places_p = splitter_p -> as_places_p;
+			const uint32 old_capacity = splitter_p -> as_capacity;
+			uint32 i;
+
+			memset (places_p, 0, new_capacity * sizeof (SplitterPlace));
+
+			splitter_p -> as_places_p = places_p;
+			splitter_p -> as_capacity = new_capacity;
+
+			for (i = 0; i < old_capacity; ++ i)
+				{
+					const SplitterPlace *old_place_p = old_places_p + i;
+
+					if (old_place_p -> sp_key_s)
+						{
+							SplitterPlace *place_p = FindPlace (splitter_p, old_place_p -> sp_key_s, old_place_p -> sp_hash);
+
+							*place_p = *old_place_p;
+						}
+				}
+
+			if (old_places_p)
+				{
+					FreeMemory (old_places_p);
+				}
+
+			return true;
+		}
+
+	PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to grow place names to " UINT32_FMT, new_capacity);
+
+	return false;
+}
+
+
+static uint32 GetPlaceKeyHash (const char *key_s)
+{
+	uint32 hash = 2166136261u;
+
+	while (*key_s != '\0')
+		{
+			hash ^= (uint8) *key_s;
+			hash *= 16777619u;
+			++ key_s;
+		}
+
+	return hash;
+}
+
+
+/*
+ * Get the kinds of place that the given words are in the
+ * country being split, or 0 if they aren't a known place.
+ */
+static uint32 GetPlaceKinds (const AddressSplitter *splitter_p, const SplitText *split_p, const uint32 first_word, const uint32 num_words)
+{
+	char phrase_s [AS_MAX_KEY_LENGTH + 1];
+	char key_s [AS_MAX_KEY_LENGTH + 1];
+
+	if (GetPhrase (split_p, first_word, num_words, phrase_s, sizeof (phrase_s)))
+		{
+			if (CanonicaliseAddressValue (phrase_s, key_s, sizeof (key_s)) && (*key_s != '\0'))
+				{
+					const SplitterPlace *place_p = FindPlace (splitter_p, key_s, GetPlaceKeyHash (key_s));
+
+					if (place_p -> sp_key_s)
+						{
+							if ((* (place_p -> sp_country_code_s) == '\0') || (! (split_p -> st_country_code_s)) || (strcmp (place_p -> sp_country_code_s, split_p -> st_country_code_s) == 0))
+								{
+									return place_p -> sp_kinds;
+								}
+						}
+				}
+		}
+
+	return 0;
+}
+
+
+static bool TokeniseText (SplitText *split_p, const char *text_s)
+{
+	size_t i = 0;
+	bool new_part_flag = true;
+
+	split_p -> st_text_s = text_s;
+	split_p -> st_num_words = 0;
+	split_p -> st_num_parts = 0;
+
+	while (text_s [i] != '\0')
+		{
+			if (IsPartSeparator (text_s [i]))
+				{
+					new_part_flag = true;
+					++ i;
+				}
+			else if (isspace ((unsigned char) text_s [i]))
+				{
+					++ i;
+				}
+			else
+				{
+					TextWord *word_p;
+
+					if (split_p -> st_num_words == AS_MAX_WORDS)
+						{
+							PrintErrors (STM_LEVEL_FINE, __FILE__, __LINE__, "\"%s\" has too many words to be split", text_s);
+							return false;
+						}
+
+					if (new_part_flag)
+						{
+							TextPart *part_p;
+
+							if (split_p -> st_num_parts == AS_MAX_PARTS)
+								{
+									PrintErrors (STM_LEVEL_FINE, __FILE__, __LINE__, "\"%s\" has too many parts to be split", text_s);
+									return false;
+								}
+
+							part_p = split_p -> st_parts + split_p -> st_num_parts;
+							part_p -> tp_first_word = split_p -> st_num_words;
+							part_p -> tp_num_words = 0;
+							part_p -> tp_role = SR_UNKNOWN;
+							part_p -> tp_hint = SR_UNKNOWN;
+
+							++ (split_p -> st_num_parts);
+							new_part_flag = false;
+						}
+
+					word_p = split_p -> st_words + split_p -> st_num_words;
+					word_p -> tw_start = i;
+
+					while ((text_s [i] != '\0') && (!IsPartSeparator (text_s [i])) && (!isspace ((unsigned char) text_s [i])))
+						{
+							++ i;
+						}
+
+					word_p -> tw_end = i;
+
+					++ (split_p -> st_num_words);
+					++ (split_p -> st_parts [split_p -> st_num_parts - 1].tp_num_words);
+				}
+		}
+
+	return (split_p -> st_num_words > 0);
+}
+
+
+static bool IsPartSeparator (const char c)
+{
+	return ((c == ',') || (c == ';') || (c == '\n') || (c == '\r') || (c == '|'));
+}
+
+
+/* Copy some consecutive words, separated by single spaces, into a buffer */
+static bool GetPhrase (const SplitText *split_p, const uint32 first_word, const uint32 num_words, char *buffer_s, const size_t buffer_size)
+{
+	size_t length = 0;
+	uint32 i;
+
+	for (i = first_word; i < first_word + num_words; ++ i)
+		{
+			const TextWord *word_p = split_p -> st_words + i;
+			const size_t word_length = word_p -> tw_end - word_p -> tw_start;
+
+			if (length + word_length + 1 >= buffer_size)
+				{
+					return false;
+				}
+
+			if (i > first_word)
+				{
+					buffer_s [length ++] = ' ';
+				}
+
+			memcpy (buffer_s + length, split_p -> st_text_s + word_p -> tw_start, word_length);
+			length += word_length;
+		}
+
+	buffer_s [length] = '\0';
+
+	return true;
+}
+
+
+/* Split a part in two after its first num_leading_words words */
+static bool SplitPart (SplitText *split_p, const uint32 part, const uint32 num_leading_words)
+{
+	TextPart *part_p = split_p -> st_parts + part;
+
+	if (split_p -> st_num_parts == AS_MAX_PARTS)
+		{
+			return false;
+		}
+
+	memmove (part_p + 1, part_p, (split_p -> st_num_parts - part) * sizeof (TextPart));
+	++ (split_p -> st_num_parts);
+
+	(part_p + 1) -> tp_first_word = part_p -> tp_first_word + num_leading_words;
+	(part_p + 1) -> tp_num_words = part_p -> tp_num_words - num_leading_words;
+	part_p -> tp_num_words = num_leading_words;
+
+	return true;
+}
+
+
+/* Look for the country in the words at the end of the text */
+static bool FindCountry (SplitText *split_p)
+{
+	const uint32 part = split_p -> st_num_parts - 1;
+	TextPart *part_p = split_p -> st_parts + part;
+	uint32 n = (part_p -> tp_num_words < AS_MAX_PLACE_WORDS) ? part_p -> tp_num_words : AS_MAX_PLACE_WORDS;
+
+	for ( ; n > 0; -- n)
+		{
+			char phrase_s [AS_MAX_KEY_LENGTH + 1];
+			const uint32 first_word = part_p -> tp_first_word + part_p -> tp_num_words - n;
+
+			if (GetPhrase (split_p, first_word, n, phrase_s, sizeof (phrase_s)))
+				{
+					const bool whole_part_flag = (n == part_p -> tp_num_words);
+					const char *code_s = GetCountryCodeForPhrase (phrase_s, whole_part_flag);
+
+					if (code_s)
+						{
+							if (n < part_p -> tp_num_words)
+								{
+									if (!SplitPart (split_p, part, part_p -> tp_num_words - n))
+										{
+											return false;
+										}
+
+									++ part_p;
+								}
+
+							part_p -> tp_role = SR_COUNTRY;
+
+							/* A country that the Address already has takes precedence */
+							if (! (split_p -> st_country_code_s))
+								{
+									split_p -> st_country_code_s = code_s;
+								}
+
+							return true;
+						}
+
+					/* The state in "Mountain View, CA" */
+					if (whole_part_flag && IsAmbiguousCountryCode (phrase_s))
+						{
+							part_p -> tp_hint = SR_COUNTY;
+						}
+				}
+		}
+
+	return true;
+}
+
+
+static bool IsAmbiguousCountryCode (const char *phrase_s)
+{
+	return ((strlen (phrase_s) == 2) && (bsearch (&phrase_s, s_ambiguous_country_codes_ss, sizeof (s_ambiguous_country_codes_ss) / sizeof (const char *), sizeof (const char *), CompareStrings) != NULL));
+}
+
+
+static const char *GetCountryCodeForPhrase (const char *phrase_s, const bool whole_part_flag)
+{
+	const char *code_s = GetCanonicalCountryCode (phrase_s);
+
+	/*
+	 * Two letter codes are only trusted when they can't be a US
+	 * state and, unless they are a part on their own, are in
+	 * upper case
+	 */
+	if (code_s && (strlen (phrase_s) == 2))
+		{
+			if (IsAmbiguousCountryCode (code_s))
+				{
+					code_s = NULL;
+				}
+			else if ((!whole_part_flag) && (!isupper ((unsigned char) phrase_s [0]) || !isupper ((unsigned char) phrase_s [1])))
+				{
+					code_s = NULL;
+				}
+		}
+
+	return code_s;
+}
+
+
+/*
+ * Look for the postcode nearest the end of the text, either at the end
+ * of a part, as in "Harpenden AL5 2JQ", or at its start, as in "75008 Paris".
+ */
+static bool FindPostcode (SplitText *split_p)
+{
+	uint32 part = split_p -> st_num_parts;
+
+	while (part > 0)
+		{
+			TextPart *part_p = split_p -> st_parts + (-- part);
+
+			if (part_p -> tp_role == SR_UNKNOWN)
+				{
+					/*
+					 * Numbers at the start of an address are far more likely
+					 * to be house numbers, so unless there is nothing else,
+					 * only postcodes with letters are looked for there.
+					 */
+					const bool numeric_flag = (part > 0) || (GetNumberOfUnknownParts (split_p) == 1);
+					uint32 n;
+
+					for (n = 2; n > 0; -- n)
+						{
+							if (part_p -> tp_num_words >= n)
+								{
+									const PostcodeCountry *country_p = MatchPostcode (split_p, part_p -> tp_first_word + part_p -> tp_num_words - n, n, numeric_flag, split_p -> st_postcode_s);
+									bool leading_flag = false;
+
+									if ((!country_p) && (part_p -> tp_num_words > n))
+										{
+											country_p = MatchPostcode (split_p, part_p -> tp_first_word, n, numeric_flag, split_p -> st_postcode_s);
+											leading_flag = true;
+										}
+
+									if (country_p)
+										{
+											TextPart *postcode_p = part_p;
+											TextPart *rest_p = NULL;
+
+											if (n < part_p -> tp_num_words)
+												{
+													if (!SplitPart (split_p, part, leading_flag ? n : part_p -> tp_num_words - n))
+														{
+															return false;
+														}
+
+													if (leading_flag)
+														{
+															rest_p = part_p + 1;
+														}
+													else
+														{
+															rest_p = part_p;
+															postcode_p = part_p + 1;
+														}
+
+													rest_p -> tp_role = SR_UNKNOWN;
+													rest_p -> tp_hint = country_p -> pc_neighbour_role;
+												}
+
+											postcode_p -> tp_role = SR_POSTCODE;
+
+											return true;
+										}
+								}
+						}
+				}
+		}
+
+	return true;
+}
+
+
+static const PostcodeCountry *MatchPostcode (const SplitText *split_p, const uint32 first_word, const uint32 num_words, const bool numeric_flag, char *postcode_s)
+{
+	char value_s [POSTCODE_BUFFER_SIZE];
+
+	if (GetPhrase (split_p, first_word, num_words, value_s, sizeof (value_s)))
+		{
+			const size_t num_countries = sizeof (s_postcode_countries_p) / sizeof (PostcodeCountry);
+			const bool has_letters_flag = (strspn (value_s, "0123456789 -") != strlen (value_s));
+			size_t i;
+
+			if ((!numeric_flag) && (!has_letters_flag))
+				{
+					return NULL;
+				}
+
+			/* Short numbers are only postcodes in a known country */
+			if ((!split_p -> st_country_code_s) && (!has_letters_flag) && (strlen (value_s) < 5))
+				{
+					return NULL;
+				}
+
+			for (i = 0; i < num_countries; ++ i)
+				{
+					const PostcodeCountry *country_p = s_postcode_countries_p + i;
+
+					if ((!split_p -> st_country_code_s) || (strcmp (country_p -> pc_country_code_s, split_p -> st_country_code_s) == 0))
+						{
+							const PostcodeStatus status = ValidatePostcode (value_s, country_p -> pc_country_code_s, postcode_s);
+
+							/* Corrections are too much of a guess when it isn't known that this is a postcode */
+							if ((status == PS_VALID) || (status == PS_NORMALISED))
+								{
+									return country_p;
+								}
+						}
+				}
+		}
+
+	return NULL;
+}
+
+
+/*
+ * Look up the parts, from the end of the text back to the town, in
+ * the dictionary. The last unknown part can also end with a place,
+ * as in "10 Downing Street London".
+ */
+static bool FindPlaces (const AddressSplitter *splitter_p, SplitText *split_p)
+{
+	const uint32 max_words = (splitter_p -> as_max_words < AS_MAX_PLACE_WORDS) ? splitter_p -> as_max_words : AS_MAX_PLACE_WORDS;
+	bool last_part_flag = true;
+	uint32 part = split_p -> st_num_parts;
+
+	while ((part > 0) && (!HasRole (split_p, SR_TOWN)))
+		{
+			TextPart *part_p = split_p -> st_parts + (-- part);
+
+			if (part_p -> tp_role == SR_UNKNOWN)
+				{
+					uint32 kinds = GetPlaceKinds (splitter_p, split_p, part_p -> tp_first_word, part_p -> tp_num_words);
+
+					if (kinds)
+						{
+							part_p -> tp_role = ChoosePlaceRole (splitter_p, split_p, part, kinds);
+						}
+					else if (last_part_flag && (part_p -> tp_num_words > 1))
+						{
+							uint32 n = (part_p -> tp_num_words - 1 < max_words) ? part_p -> tp_num_words - 1 : max_words;
+
+							while ((n > 0) && ((kinds = GetPlaceKinds (splitter_p, split_p, part_p -> tp_first_word + part_p -> tp_num_words - n, n)) == 0))
+								{
+									-- n;
+								}
+
+							if (n > 0)
+								{
+									const SplitRole role = ChoosePlaceRole (splitter_p, split_p, part, kinds);
+
+									/*
+									 * Only split the part if what is left is a street, so "Greater
+									 * London" isn't mistaken for "Greater" in "London".
+									 */
+									if ((role != SR_UNKNOWN) && (IsStreet (split_p, part_p -> tp_first_word, part_p -> tp_num_words - n) || GetPlaceKinds (splitter_p, split_p, part_p -> tp_first_word, part_p -> tp_num_words - n)))
+										{
+											if (!SplitPart (split_p, part, part_p -> tp_num_words - n))
+												{
+													return false;
+												}
+
+											(part_p + 1) -> tp_role = role;
+											(part_p + 1) -> tp_hint = SR_UNKNOWN;
+
+											/* Look at what is left of the part again */
+											++ part;
+											continue;
+										}
+								}
+
+							last_part_flag = false;
+						}
+					else
+						{
+							last_part_flag = false;
+						}
+				}
+		}
+
+	return true;
+}
+
+
+static SplitRole ChoosePlaceRole (const AddressSplitter *splitter_p, const SplitText *split_p, const uint32 part, const uint32 kinds)
+{
+	const bool county_flag = !HasRole (split_p, SR_COUNTY);
+
+	if ((kinds & AS_COUNTY) && county_flag)
+		{
+			/* A name that is both is the county if there is a town before it */
+			if (kinds & AS_TOWN)
+				{
+					uint32 i = part;
+
+					while (i > 0)
+						{
+							const TextPart *part_p = split_p -> st_parts + (-- i);
+
+							if (part_p -> tp_role == SR_UNKNOWN)
+								{
+									if (GetPlaceKinds (splitter_p, split_p, part_p -> tp_first_word, part_p -> tp_num_words) & AS_TOWN)
+										{
+											return SR_COUNTY;
+										}
+
+									break;
+								}
+						}
+
+					return SR_TOWN;
+				}
+
+			return SR_COUNTY;
+		}
+
+	if (kinds & AS_TOWN)
+		{
+			return SR_TOWN;
+		}
+
+	return SR_UNKNOWN;
+}
+
+
+/* Use the positions of any parts that are still unknown to decide what they are */
+static void AssignRemainingParts (SplitText *split_p)
+{
+	uint32 unknown_parts [AS_MAX_PARTS];
+	uint32 num_unknown_parts = 0;
+	int32 town = -1;
+	uint32 i;
+
+	/* Use the hints from the postcode for short parts */
+	for (i = 0; i < split_p -> st_num_parts; ++ i)
+		{
+			TextPart *part_p = split_p -> st_parts + i;
+
+			if ((part_p -> tp_role == SR_UNKNOWN) && (part_p -> tp_hint != SR_UNKNOWN) && (part_p -> tp_num_words <= 3) && (!HasRole (split_p, part_p -> tp_hint)))
+				{
+					part_p -> tp_role = part_p -> tp_hint;
+				}
+		}
+
+	for (i = 0; i < split_p -> st_num_parts; ++ i)
+		{
+			const TextPart *part_p = split_p -> st_parts + i;
+
+			if (part_p -> tp_role == SR_UNKNOWN)
+				{
+					unknown_parts [num_unknown_parts ++] = i;
+				}
+			else if ((part_p -> tp_role == SR_TOWN) && (town == -1))
+				{
+					town = (int32) i;
+				}
+		}
+
+	if (num_unknown_parts == 0)
+		{
+			return;
+		}
+
+	if (town != -1)
+		{
+			uint32 num_before = 0;
+			int32 street = -1;
+
+			/* Anything after the town is the county */
+			for (i = 0; i < num_unknown_parts; ++ i)
+				{
+					if (unknown_parts [i] > (uint32) town)
+						{
+							split_p -> st_parts [unknown_parts [i]].tp_role = HasRole (split_p, SR_COUNTY) ? SR_NAME : SR_COUNTY;
+						}
+					else
+						{
+							++ num_before;
+						}
+				}
+
+			for (i = 0; (i < num_before) && (street == -1); ++ i)
+				{
+					if (IsStreetPart (split_p, unknown_parts [i]))
+						{
+							street = (int32) i;
+						}
+				}
+
+			if (street == -1)
+				{
+					street = (int32) num_before - 1;
+
+					/* A single part that doesn't look like a street is probably the name of a building */
+					if (num_before == 1)
+						{
+							street = 1;
+						}
+				}
+
+			AssignPartsBeforeStreet (split_p, unknown_parts, num_before, (uint32) street);
+		}
+	else
+		{
+			const bool county_flag = !HasRole (split_p, SR_COUNTY);
+			uint32 street = num_unknown_parts;
+			uint32 num_after;
+
+			for (i = 0; (i < num_unknown_parts) && (street == num_unknown_parts); ++ i)
+				{
+					if (IsStreetPart (split_p, unknown_parts [i]))
+						{
+							street = i;
+						}
+				}
+
+			if (street == num_unknown_parts)
+				{
+					/* Without a street, go from the typical "name, street, town, county" order */
+					if (num_unknown_parts == 1)
+						{
+							street = 1;
+						}
+					else if (num_unknown_parts == 2)
+						{
+							street = 0;
+						}
+					else
+						{
+							street = num_unknown_parts - ((county_flag && (num_unknown_parts >= 4)) ? 3 : 2);
+						}
+				}
+
+			num_after = (street < num_unknown_parts) ? num_unknown_parts - street - 1 : num_unknown_parts;
+
+			if (num_after == 1)
+				{
+					split_p -> st_parts [unknown_parts [num_unknown_parts - 1]].tp_role = SR_TOWN;
+				}
+			else if (num_after > 1)
+				{
+					uint32 last = num_unknown_parts - 1;
+
+					if (county_flag)
+						{
+							split_p -> st_parts [unknown_parts [last]].tp_role = SR_COUNTY;
+							-- last;
+						}
+
+					split_p -> st_parts [unknown_parts [last]].tp_role = SR_TOWN;
+
+					/* Anything between the street and the town is part of the street, e.g. a village */
+					for (i = street + 1; i < last; ++ i)
+						{
+							split_p -> st_parts [unknown_parts [i]].tp_role = SR_STREET;
+						}
+				}
+
+			AssignPartsBeforeStreet (split_p, unknown_parts, (street < num_unknown_parts) ? street + 1 : 0, street);
+		}
+}
+
+
+/*
+ * Make the part at the given index of parts_p the street and those
+ * before it the name. If the index is past the end of parts_p, they
+ * are all the name.
+ */
+static void AssignPartsBeforeStreet (SplitText *split_p, const uint32 *parts_p, const uint32 num_parts, const uint32 street)
+{
+	uint32 i;
+
+	for (i = 0; i < num_parts; ++ i)
+		{
+			split_p -> st_parts [parts_p [i]].tp_role = (i < street) ? SR_NAME : SR_STREET;
+		}
+}
+
+
+static bool IsStreetPart (const SplitText *split_p, const uint32 part)
+{
+	const TextPart *part_p = split_p -> st_parts + part;
+
+	return IsStreet (split_p, part_p -> tp_first_word, part_p -> tp_num_words);
+}
+
+
+static bool IsStreet (const SplitText *split_p, const uint32 first_word, const uint32 num_words)
+{
+	char phrase_s [AS_MAX_KEY_LENGTH + 1];
+	char key_s [AS_MAX_KEY_LENGTH + 1];
+
+	if (GetPhrase (split_p, first_word, num_words, phrase_s, sizeof (phrase_s)))
+		{
+			if (CanonicaliseAddressValue (phrase_s, key_s, sizeof (key_s)))
+				{
+					char *word_s = key_s;
+					const char *last_word_s = split_p -> st_text_s + split_p -> st_words [first_word + num_words - 1].tw_start;
+
+					while (*word_s != '\0')
+						{
+							char *end_s = strchr (word_s, ' ');
+							const size_t word_length = end_s ? (size_t) (end_s - word_s) : strlen (word_s);
+							size_t i;
+
+							if (end_s)
+								{
+									*end_s = '\0';
+								}
+
+							if (word_s == key_s)
+								{
+									/* "Flat 2" and the like are part of the name rather than the street */
+									if (bsearch (&word_s, s_premises_words_ss, sizeof (s_premises_words_ss) / sizeof (const char *), sizeof (const char *), CompareStrings))
+										{
+											return false;
+										}
+
+									/* A house number before or after the street's name */
+									if (isdigit ((unsigned char) *phrase_s) || isdigit ((unsigned char) *last_word_s))
+										{
+											return true;
+										}
+								}
+
+							if (bsearch (&word_s, s_street_words_ss, sizeof (s_street_words_ss) / sizeof (const char *), sizeof (const char *), CompareStrings))
+								{
+									return true;
+								}
+
+							for (i = 0; i < sizeof (s_street_suffixes_ss) / sizeof (const char *); ++ i)
+								{
+									const size_t suffix_length = strlen (s_street_suffixes_ss [i]);
+
+									if ((word_length > suffix_length) && (strcmp (word_s + word_length - suffix_length, s_street_suffixes_ss [i]) == 0))
+										{
+											return true;
+										}
+								}
+
+							word_s += word_length;
+
+							if (end_s)
+								{
+									++ word_s;
+								}
+						}
+				}
+		}
+
+	return false;
+}
+
+
+static bool HasRole (const SplitText *split_p, const SplitRole role)
+{
+	uint32 i;
+
+	for (i = 0; i < split_p -> st_num_parts; ++ i)
+		{
+			if (split_p -> st_parts [i].tp_role == role)
+				{
+					return true;
+				}
+		}
+
+	return false;
+}
+
+
+static uint32 GetNumberOfUnknownParts (const SplitText *split_p)
+{
+	uint32 num_parts = 0;
+	uint32 i;
+
+	for (i = 0; i < split_p -> st_num_parts; ++ i)
+		{
+			if (split_p -> st_parts [i].tp_role == SR_UNKNOWN)
+				{
+					++ num_parts;
+				}
+		}
+
+	return num_parts;
+}
+
+
+/*
+ * Copy the values into any of the Address's fields that are empty. Either
+ * all of them are set or, upon error, none of them.
+ */
+static bool SetAddressFromSplitText (const SplitText *split_p, Address *address_p)
+{
+	char *values_ss [SR_NUM_ROLES];
+	char *country_code_s = NULL;
+	char *buffer_s = (char *) AllocMemory (strlen (split_p -> st_text_s) + (2 * AS_MAX_PARTS) + 1);
+	bool success_flag = (buffer_s != NULL);
+	uint32 role;
+
+	memset (values_ss, 0, sizeof (values_ss));
+
+	for (role = SR_NAME; success_flag && (role < SR_NUM_ROLES); ++ role)
+		{
+			char **field_ss = GetAddressField (address_p, (SplitRole) role);
+
+			if (! (*field_ss))
+				{
+					size_t length = 0;
+					uint32 i;
+
+					for (i = 0; i < split_p -> st_num_parts; ++ i)
+						{
+							const TextPart *part_p = split_p -> st_parts + i;
+
+							if (part_p -> tp_role == role)
+								{
+									const size_t start = split_p -> st_words [part_p -> tp_first_word].tw_start;
+									const size_t end = split_p -> st_words [part_p -> tp_first_word + part_p -> tp_num_words - 1].tw_end;
+
+									if (length > 0)
+										{
+											buffer_s [length ++] = ',';
+											buffer_s [length ++] = ' ';
+										}
+
+									memcpy (buffer_s + length, split_p -> st_text_s + start, end - start);
+									length += end - start;
+								}
+						}
+
+					if (length > 0)
+						{
+							buffer_s [length] = '\0';
+
+							values_ss [role] = EasyCopyToNewString ((role == SR_POSTCODE) ? split_p -> st_postcode_s : buffer_s);
+							success_flag = (values_ss [role] != NULL);
+						}
+				}
+		}
+
+	if (success_flag && (split_p -> st_country_code_s) && (! (address_p -> ad_country_code_s)))
+		{
+			country_code_s = EasyCopyToNewString (split_p -> st_country_code_s);
+			success_flag = (country_code_s != NULL);
+		}
+
+	if (success_flag)
+		{
+			for (role = SR_NAME; role < SR_NUM_ROLES; ++ role)
+				{
+					if (values_ss [role])
+						{
+							* (GetAddressField (address_p, (SplitRole) role)) = values_ss [role];
+						}
+				}
+
+			if (country_code_s)
+				{
+					address_p -> ad_country_code_s = country_code_s;
+				}
+		}
+	else
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to copy the values split from \"%s\"", split_p -> st_text_s);
+
+			for (role = SR_NAME; role < SR_NUM_ROLES; ++ role)
+				{
+					if (values_ss [role])
+						{
+							FreeCopiedString (values_ss [role]);
+						}
+				}
+		}
+
+	if (buffer_s)
+		{
+			FreeMemory (buffer_s);
+		}
+
+	return success_flag;
+}
+
+
+static char **GetAddressField (Address *address_p, const SplitRole role)
+{
+	switch (role)
+		{
+			case SR_STREET:
+				return & (address_p -> ad_street_s);
+
+			case SR_TOWN:
+				return & (address_p -> ad_town_s);
+
+			case SR_COUNTY:
+				return & (address_p -> ad_county_s);
+
+			case SR_POSTCODE:
+				return & (address_p -> ad_postcode_s);
+
+			case SR_COUNTRY:
+				return & (address_p -> ad_country_s);
+
+			default:
+				return & (address_p -> ad_name_s);
+		}
+}
+
+
+static int CompareStrings (const void *v0_p, const void *v1_p)
+{
+	const char * const *s0_pp = (const char * const *) v0_p;
+	const char * const *s1_pp = (const char * const *) v1_p;
+
+	return strcmp (*s0_pp, *s1_pp);
+}
+
+
+static void RunSplitTask (void *data_p)
+{
+	SplitTask *task_p = (SplitTask *) data_p;
+	size_t i;
+
+	for (i = 0; i < task_p -> st_num_addresses; ++ i)
+		{
+			if (SplitAddressName (task_p -> st_splitter_p, * (task_p -> st_addresses_pp + i)))
+				{
+					++ (task_p -> st_num_split);
+				}
+		}
+}
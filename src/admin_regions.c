@@ -0,0 +1,997 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * admin_regions.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * The file starts with a header which is followed by the regions, their
+ * rings, the R-tree nodes, the points and finally the names:
+ *
+ *   header   "GGAB", version, numbers of regions, rings, nodes and points,
+ *            size of the names, padded to 64 bytes
+ *   region   bounding box, first ring, number of rings, name offset,
+ *            country code, admin_level, padded to 32 bytes
+ *   ring     bounding box, first point, number of points
+ *   node     bounding box, first child, number of children, leaf flag,
+ *            padded to 24 bytes
+ *   point    latitude, longitude
+ *
+ * All values are little-endian and bounding boxes are the south, west,
+ * north and east edges as FixedCoordinate values. The nodes are written
+ * a level at a time starting with the leaves, so the root is the last
+ * one. The children of a leaf are regions and the children of any other
+ * node are nodes, and either way they are next to each other in the file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "admin_regions.h"
+
+#include "memory_allocations.h"
+#include "streams.h"
+#include "string_utils.h"
+
+
+static const char S_MAGIC_S [4] = { 'G', 'G', 'A', 'B' };
+
+#define AR_VERSION (1)
+
+#define AR_HEADER_SIZE (64)
+#define AR_REGION_SIZE (32)
+#define AR_RING_SIZE (24)
+#define AR_NODE_SIZE (24)
+#define AR_POINT_SIZE (8)
+
+/* The most children that each node of the R-tree has */
+#define AR_NODE_CAPACITY (16)
+
+/* This is enough for a tree over more regions than a file can hold */
+#define AR_MAX_STACK_SIZE (256)
+
+/* The most regions that SetAddressFromAdminRegions () looks at */
+#define AR_MAX_ADDRESS_REGIONS (32)
+
+
+/* A region or node while the R-tree is being built */
+typedef struct RegionBuildItem
+{
+	FixedBoundingBox rbi_box;
+	uint32 rbi_index;
+} RegionBuildItem;
+
+
+typedef struct RegionBuildNode
+{
+	FixedBoundingBox rbn_box;
+	uint32 rbn_first_child;
+	uint32 rbn_num_children;
+	bool rbn_leaf_flag;
+} RegionBuildNode;
+
+
+static bool WriteRegionIndex (FILE *out_f, const AdminRegionData *regions_p, const size_t num_regions, const uint32 *order_p, const FixedBoundingBox *boxes_p, const RegionBuildNode *nodes_p, const uint32 num_nodes);
+
+static bool GetRegionBoundingBox (const AdminRegionData *region_p, FixedBoundingBox *box_p);
+
+static void GetPointsBoundingBox (const FixedCoordinate *points_p, const uint32 num_points, FixedBoundingBox *box_p);
+
+static void SortRegionBuildItems (RegionBuildItem *items_p, const size_t num_items);
+
+static void ExtendRegionBox (FixedBoundingBox *box_p, const FixedBoundingBox *other_box_p);
+
+static int CompareRegionBuildItemsByLongitude (const void *v0_p, const void *v1_p);
+
+static int CompareRegionBuildItemsByLatitude (const void *v0_p, const void *v1_p);
+
+static bool IsPointInRegionBox (const uint8 *box_p, const FixedCoordinate *point_p);
+
+static bool IsPointInRegion (const AdminRegionIndex *index_p, const uint8 *region_p, const FixedCoordinate *point_p);
+
+static void AddAdminRegion (const AdminRegionIndex *index_p, const uint8 *region_p, AdminRegion *regions_p, const uint32 max_regions, uint32 *num_regions_p);
+
+static void SetAdminRegion (const AdminRegionIndex *index_p, const uint8 *region_p, AdminRegion *dest_p);
+
+static bool SetAddressComponent (const char *value_s, char **value_ss);
+
+static void StoreBox (uint8 *dest_p, const FixedBoundingBox *box_p);
+
+static uint32 LoadUInt32 (const uint8 *src_p);
+
+static int32 LoadInt32 (const uint8 *src_p);
+
+static void StoreUInt32 (uint8 *dest_p, const uint32 value);
+
+
+
+AdminRegionIndex *OpenAdminRegionIndex (const char *filename_s)
+{
+	AdminRegionIndex *index_p = (AdminRegionIndex *) AllocMemory (sizeof (AdminRegionIndex));
+
+	if (index_p)
+		{
+			/* each lookup only touches a few of the regions */
+			if (OpenMappedFile (& (index_p -> ari_file), filename_s, AR_HEADER_SIZE, MFA_RANDOM))
+				{
+					const uint8 *data_p = index_p -> ari_file.mf_data_p;
+					const size_t size = index_p -> ari_file.mf_size;
+
+					if ((memcmp (data_p, S_MAGIC_S, sizeof (S_MAGIC_S)) == 0) && (LoadUInt32 (data_p + 4) == AR_VERSION))
+						{
+							const uint32 num_regions = LoadUInt32 (data_p + 8);
+							const uint32 num_rings = LoadUInt32 (data_p + 12);
+							const uint32 num_nodes = LoadUInt32 (data_p + 16);
+							const uint32 num_points = LoadUInt32 (data_p + 20);
+							const uint32 strings_size = LoadUInt32 (data_p + 24);
+							const uint64 regions_offset = AR_HEADER_SIZE;
+							const uint64 rings_offset = regions_offset + ((uint64) num_regions * AR_REGION_SIZE);
+							const uint64 nodes_offset = rings_offset + ((uint64) num_rings * AR_RING_SIZE);
+							const uint64 points_offset = nodes_offset + ((uint64) num_nodes * AR_NODE_SIZE);
+							const uint64 strings_offset = points_offset + ((uint64) num_points * AR_POINT_SIZE);
+
+							/* The names must end with a '\0' so that they can't run off the end of the file */
+							if (((uint64) size >= strings_offset + strings_size) && ((strings_size == 0) || (* (data_p + strings_offset + strings_size - 1) == '\0')) &&
+								((num_regions == 0) == (num_nodes == 0)))
+								{
+									index_p -> ari_num_regions = num_regions;
+									index_p -> ari_num_rings = num_rings;
+									index_p -> ari_num_nodes = num_nodes;
+									index_p -> ari_num_points = num_points;
+									index_p -> ari_regions_p = data_p + regions_offset;
+									index_p -> ari_rings_p = data_p + rings_offset;
+									index_p -> ari_nodes_p = data_p + nodes_offset;
+									index_p -> ari_points_p = data_p + points_offset;
+									index_p -> ari_strings_s = (const char *) (data_p + strings_offset);
+									index_p -> ari_strings_size = strings_size;
+
+									return index_p;
+								}
+						}
+
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "\"%s\" is not a supported admin region index", filename_s);
+					CloseAdminRegionIndex (index_p);
+
+					return NULL;
+				}
+			else
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to map \"%s\"", filename_s);
+				}
+
+			FreeMemory (index_p);
+		}
+
+	return NULL;
+}
+
+
+void CloseAdminRegionIndex (AdminRegionIndex *index_p)
+{
+	CloseMappedFile (& (index_p -> ari_file));
+
+	FreeMemory (index_p);
+}
+
+
+bool SaveAdminRegionIndex (const char *filename_s, const AdminRegionData *regions_p, const size_t num_regions)
+{
+	bool success_flag = false;
+	FixedBoundingBox *boxes_p = NULL;
+	RegionBuildItem *items_p = NULL;
+	uint32 *order_p = NULL;
+	RegionBuildNode *nodes_p = NULL;
+	RegionBuildNode *sorted_nodes_p = NULL;
+	size_t max_nodes = 0;
+	uint32 num_nodes = 0;
+
+	if (num_regions > 0)
+		{
+			size_t level_size = num_regions;
+
+			/* Each level has at most a sixteenth, rounded up, of the one below it */
+			while (level_size > 1)
+				{
+					level_size = (level_size + AR_NODE_CAPACITY - 1) / AR_NODE_CAPACITY;
+					max_nodes += level_size;
+				}
+
+			if (max_nodes == 0)
+				{
+					max_nodes = 1;
+				}
+
+			boxes_p = (FixedBoundingBox *) AllocMemory (num_regions * sizeof (FixedBoundingBox));
+			items_p = (RegionBuildItem *) AllocMemory (num_regions * sizeof (RegionBuildItem));
+			order_p = (uint32 *) AllocMemory (num_regions * sizeof (uint32));
+			nodes_p = (RegionBuildNode *) AllocMemory (max_nodes * sizeof (RegionBuildNode));
+
+			/* The leaves are the largest level that needs sorting */
+			sorted_nodes_p = (RegionBuildNode *) AllocMemory (((num_regions + AR_NODE_CAPACITY - 1) / AR_NODE_CAPACITY) * sizeof (RegionBuildNode));
+
+			if (boxes_p && items_p && order_p && nodes_p && sorted_nodes_p)
+				{
+					size_t i;
+
+					success_flag = true;
+
+					for (i = 0; (i < num_regions) && success_flag; ++ i)
+						{
+							if (GetRegionBoundingBox (regions_p + i, boxes_p + i))
+								{
+									items_p [i].rbi_box = boxes_p [i];
+									items_p [i].rbi_index = (uint32) i;
+								}
+							else
+								{
+									PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Admin region " SIZET_FMT " \"%s\" has no points", i, regions_p [i].ard_name_s ? regions_p [i].ard_name_s : "");
+									success_flag = false;
+								}
+						}
+
+					if (success_flag)
+						{
+							size_t level_start = 0;
+							size_t level_size;
+
+							/* The leaves, whose children are the regions in their sorted order */
+							SortRegionBuildItems (items_p, num_regions);
+
+							for (i = 0; i < num_regions; i += AR_NODE_CAPACITY)
+								{
+									RegionBuildNode *node_p = nodes_p + num_nodes;
+									const size_t num_children = (num_regions - i < AR_NODE_CAPACITY) ? (num_regions - i) : AR_NODE_CAPACITY;
+									size_t j;
+
+									node_p -> rbn_box = items_p [i].rbi_box;
+									node_p -> rbn_first_child = (uint32) i;
+									node_p -> rbn_num_children = (uint32) num_children;
+									node_p -> rbn_leaf_flag = true;
+
+									for (j = 0; j < num_children; ++ j)
+										{
+											order_p [i + j] = items_p [i + j].rbi_index;
+											ExtendRegionBox (& (node_p -> rbn_box), & (items_p [i + j].rbi_box));
+										}
+
+									++ num_nodes;
+								}
+
+							level_size = num_nodes;
+
+							/* Then each level above, sorting the level below so that siblings are next to each other */
+							while (level_size > 1)
+								{
+									RegionBuildNode *level_p = nodes_p + level_start;
+									const size_t next_level_start = num_nodes;
+
+									for (i = 0; i < level_size; ++ i)
+										{
+											items_p [i].rbi_box = level_p [i].rbn_box;
+											items_p [i].rbi_index = (uint32) i;
+										}
+
+									SortRegionBuildItems (items_p, level_size);
+
+									for (i = 0; i < level_size; ++ i)
+										{
+											sorted_nodes_p [i] = level_p [items_p [i].rbi_index];
+										}
+
+									memcpy (level_p, sorted_nodes_p, level_size * sizeof (RegionBuildNode));
+
+									for (i = 0; i < level_size; i += AR_NODE_CAPACITY)
+										{
+											RegionBuildNode *node_p = nodes_p + num_nodes;
+											const size_t num_children = (level_size - i < AR_NODE_CAPACITY) ? (level_size - i) : AR_NODE_CAPACITY;
+											size_t j;
+
+											node_p -> rbn_box = level_p [i].rbn_box;
+											node_p -> rbn_first_child = (uint32) (level_start + i);
+											node_p -> rbn_num_children = (uint32) num_children;
+											node_p -> rbn_leaf_flag = false;
+
+											for (j = 1; j < num_children; ++ j)
+												{
+													ExtendRegionBox (& (node_p -> rbn_box), & (level_p [i + j].rbn_box));
+												}
+
+											++ num_nodes;
+										}
+
+									level_start = next_level_start;
+									level_size = num_nodes - next_level_start;
+								}
+						}
+				}
+			else
+				{
+					success_flag = false;
+				}
+		}
+	else
+		{
+			success_flag = true;
+		}
+
+	if (success_flag)
+		{
+			FILE *out_f = fopen (filename_s, "wb");
+
+			success_flag = false;
+
+			if (out_f)
+				{
+					success_flag = WriteRegionIndex (out_f, regions_p, num_regions, order_p, boxes_p, nodes_p, num_nodes);
+
+					if (fclose (out_f) != 0)
+						{
+							success_flag = false;
+						}
+				}
+
+			if (!success_flag)
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to save admin region index \"%s\"", filename_s);
+				}
+		}
+
+	if (sorted_nodes_p)
+		{
+			FreeMemory (sorted_nodes_p);
+		}
+
+	if (nodes_p)
+		{
+			FreeMemory (nodes_p);
+		}
+
+	if (order_p)
+		{
+			FreeMemory (order_p);
+		}
+
+	if (items_p)
+		{
+			FreeMemory (items_p);
+		}
+
+	if (boxes_p)
+		{
+			FreeMemory (boxes_p);
+		}
+
+	return success_flag;
+}
+
+
+uint32 FindAdminRegions (const AdminRegionIndex *index_p, const Coordinate *coord_p, AdminRegion *regions_p, const uint32 max_regions)
+{
+	uint32 num_found = 0;
+	FixedCoordinate point;
+
+	if ((index_p -> ari_num_nodes > 0) && (max_regions > 0) && SetFixedCoordinateFromCoordinate (&point, coord_p))
+		{
+			uint32 stack [AR_MAX_STACK_SIZE];
+			size_t stack_size = 1;
+
+			/* The root is the last node */
+			stack [0] = index_p -> ari_num_nodes - 1;
+
+			while (stack_size > 0)
+				{
+					const uint8 *node_p = index_p -> ari_nodes_p + ((size_t) stack [-- stack_size] * AR_NODE_SIZE);
+
+					if (IsPointInRegionBox (node_p, &point))
+						{
+							const uint32 first_child = LoadUInt32 (node_p + 16);
+							const uint32 num_children = (uint32) * (node_p + 20) | ((uint32) * (node_p + 21) << 8);
+							const bool leaf_flag = (* (node_p + 22) != 0);
+							uint32 i;
+
+							if (leaf_flag)
+								{
+									if ((first_child <= index_p -> ari_num_regions) && (num_children <= index_p -> ari_num_regions - first_child))
+										{
+											for (i = 0; i < num_children; ++ i)
+												{
+													const uint8 *region_p = index_p -> ari_regions_p + ((size_t) (first_child + i) * AR_REGION_SIZE);
+
+													if (IsPointInRegionBox (region_p, &point) && IsPointInRegion (index_p, region_p, &point))
+														{
+															AddAdminRegion (index_p, region_p, regions_p, max_regions, &num_found);
+														}
+												}
+										}
+								}
+							else if ((first_child <= index_p -> ari_num_nodes) && (num_children <= index_p -> ari_num_nodes - first_child) && (stack_size + num_children <= AR_MAX_STACK_SIZE))
+								{
+									for (i = 0; i < num_children; ++ i)
+										{
+											stack [stack_size ++] = first_child + i;
+										}
+								}
+						}
+				}
+		}
+
+	return num_found;
+}
+
+
+uint32 GetNumberOfAdminRegions (const AdminRegionIndex *index_p)
+{
+	return index_p -> ari_num_regions;
+}
+
+
+bool GetAdminRegion (const AdminRegionIndex *index_p, const uint32 i, AdminRegion *region_p)
+{
+	if (i < index_p -> ari_num_regions)
+		{
+			SetAdminRegion (index_p, index_p -> ari_regions_p + ((size_t) i * AR_REGION_SIZE), region_p);
+			return true;
+		}
+
+	return false;
+}
+
+
+bool SetAddressFromAdminRegions (const AdminRegionIndex *index_p, Address *address_p)
+{
+	bool success_flag = false;
+
+	if (address_p -> ad_gps_centre_p)
+		{
+			AdminRegion regions [AR_MAX_ADDRESS_REGIONS];
+			const uint32 num_regions = FindAdminRegions (index_p, address_p -> ad_gps_centre_p, regions, AR_MAX_ADDRESS_REGIONS);
+			const AdminRegion *country_p = NULL;
+			const AdminRegion *county_p = NULL;
+			const AdminRegion *town_p = NULL;
+			uint32 i;
+
+			/* The regions are in order of level so the last match at each tier is the most specific */
+			for (i = 0; i < num_regions; ++ i)
+				{
+					const AdminRegion *region_p = regions + i;
+
+					if (region_p -> ar_level == 2)
+						{
+							if (!country_p)
+								{
+									country_p = region_p;
+								}
+						}
+					else if ((region_p -> ar_level >= 4) && (region_p -> ar_level <= 6))
+						{
+							county_p = region_p;
+						}
+					else if ((region_p -> ar_level >= 7) && (region_p -> ar_level <= 8))
+						{
+							town_p = region_p;
+						}
+				}
+
+			success_flag = true;
+
+			if (country_p)
+				{
+					success_flag = SetAddressComponent (country_p -> ar_name_s, & (address_p -> ad_country_s));
+
+					if (success_flag && (* (country_p -> ar_country_code_s) != '\0'))
+						{
+							success_flag = SetAddressComponent (country_p -> ar_country_code_s, & (address_p -> ad_country_code_s));
+						}
+				}
+
+			if (county_p && success_flag)
+				{
+					success_flag = SetAddressComponent (county_p -> ar_name_s, & (address_p -> ad_county_s));
+				}
+
+			if (town_p && success_flag)
+				{
+					success_flag = SetAddressComponent (town_p -> ar_name_s, & (address_p -> ad_town_s));
+				}
+
+			if (! (country_p || county_p || town_p))
+				{
+					success_flag = false;
+				}
+		}
+
+	return success_flag;
+}
+
+
+static bool WriteRegionIndex (FILE *out_f, const AdminRegionData *regions_p, const size_t num_regions, const uint32 *order_p, const FixedBoundingBox *boxes_p, const RegionBuildNode *nodes_p, const uint32 num_nodes)
+{
+	uint8 buffer [AR_HEADER_SIZE];
+	uint64 num_rings = 0;
+	uint64 num_points = 0;
+	uint64 strings_size = 0;
+	size_t i;
+
+	for (i = 0; i < num_regions; ++ i)
+		{
+			const AdminRegionData *region_p = regions_p + i;
+			uint32 j;
+
+			num_rings += region_p -> ard_num_rings;
+
+			for (j = 0; j < region_p -> ard_num_rings; ++ j)
+				{
+					num_points += region_p -> ard_ring_lengths_p [j];
+				}
+
+			strings_size += (region_p -> ard_name_s ? strlen (region_p -> ard_name_s) : 0) + 1;
+		}
+
+	if (((uint64) num_regions > 0xFFFFFFFFu) || (num_rings > 0xFFFFFFFFu) || (num_points > 0xFFFFFFFFu) || (strings_size > 0xFFFFFFFFu))
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "There are too many admin regions to save");
+			return false;
+		}
+
+	memset (buffer, 0, AR_HEADER_SIZE);
+	memcpy (buffer, S_MAGIC_S, sizeof (S_MAGIC_S));
+	StoreUInt32 (buffer + 4, AR_VERSION);
+	StoreUInt32 (buffer + 8, (uint32) num_regions);
+	StoreUInt32 (buffer + 12, (uint32) num_rings);
+	StoreUInt32 (buffer + 16, num_nodes);
+	StoreUInt32 (buffer + 20, (uint32) num_points);
+	StoreUInt32 (buffer + 24, (uint32) strings_size);
+
+	if (fwrite (buffer, 1, AR_HEADER_SIZE, out_f) != AR_HEADER_SIZE)
+		{
+			return false;
+		}
+
+	/* The regions */
+	{
+		uint32 first_ring = 0;
+		uint32 name_offset = 0;
+
+		for (i = 0; i < num_regions; ++ i)
+			{
+				const AdminRegionData *region_p = regions_p + order_p [i];
+				const char *code_s = region_p -> ard_country_code_s;
+
+				memset (buffer, 0, AR_REGION_SIZE);
+				StoreBox (buffer, boxes_p + order_p [i]);
+				StoreUInt32 (buffer + 16, first_ring);
+				StoreUInt32 (buffer + 20, region_p -> ard_num_rings);
+				StoreUInt32 (buffer + 24, name_offset);
+
+				if (code_s && (strlen (code_s) == 2))
+					{
+						buffer [28] = (uint8) ((code_s [0] >= 'a' && code_s [0] <= 'z') ? (code_s [0] - 'a' + 'A') : code_s [0]);
+						buffer [29] = (uint8) ((code_s [1] >= 'a' && code_s [1] <= 'z') ? (code_s [1] - 'a' + 'A') : code_s [1]);
+					}
+
+				buffer [30] = (uint8) region_p -> ard_level;
+
+				if (fwrite (buffer, 1, AR_REGION_SIZE, out_f) != AR_REGION_SIZE)
+					{
+						return false;
+					}
+
+				first_ring += region_p -> ard_num_rings;
+				name_offset += (uint32) ((region_p -> ard_name_s ? strlen (region_p -> ard_name_s) : 0) + 1);
+			}
+	}
+
+	/* The rings */
+	{
+		uint32 first_point = 0;
+
+		for (i = 0; i < num_regions; ++ i)
+			{
+				const AdminRegionData *region_p = regions_p + order_p [i];
+				const FixedCoordinate *points_p = region_p -> ard_points_p;
+				uint32 j;
+
+				for (j = 0; j < region_p -> ard_num_rings; ++ j)
+					{
+						const uint32 num_ring_points = region_p -> ard_ring_lengths_p [j];
+						FixedBoundingBox box;
+
+						GetPointsBoundingBox (points_p, num_ring_points, &box);
+
+						StoreBox (buffer, &box);
+						StoreUInt32 (buffer + 16, first_point);
+						StoreUInt32 (buffer + 20, num_ring_points);
+
+						if (fwrite (buffer, 1, AR_RING_SIZE, out_f) != AR_RING_SIZE)
+							{
+								return false;
+							}
+
+						points_p += num_ring_points;
+						first_point += num_ring_points;
+					}
+			}
+	}
+
+	/* The nodes */
+	for (i = 0; i < num_nodes; ++ i)
+		{
+			const RegionBuildNode *node_p = nodes_p + i;
+
+			memset (buffer, 0, AR_NODE_SIZE);
+			StoreBox (buffer, & (node_p -> rbn_box));
+			StoreUInt32 (buffer + 16, node_p -> rbn_first_child);
+			buffer [20] = (uint8) (node_p -> rbn_num_children & 0xFF);
+			buffer [21] = (uint8) ((node_p -> rbn_num_children >> 8) & 0xFF);
+			buffer [22] = node_p -> rbn_leaf_flag ? 1 : 0;
+
+			if (fwrite (buffer, 1, AR_NODE_SIZE, out_f) != AR_NODE_SIZE)
+				{
+					return false;
+				}
+		}
+
+	/* The points */
+	for (i = 0; i < num_regions; ++ i)
+		{
+			const AdminRegionData *region_p = regions_p + order_p [i];
+			const FixedCoordinate *point_p = region_p -> ard_points_p;
+			uint32 j;
+
+			for (j = 0; j < region_p -> ard_num_rings; ++ j)
+				{
+					const FixedCoordinate *end_p = point_p + region_p -> ard_ring_lengths_p [j];
+
+					while (point_p < end_p)
+						{
+							StoreUInt32 (buffer, (uint32) point_p -> fc_latitude);
+							StoreUInt32 (buffer + 4, (uint32) point_p -> fc_longitude);
+
+							if (fwrite (buffer, 1, AR_POINT_SIZE, out_f) != AR_POINT_SIZE)
+								{
+									return false;
+								}
+
+							++ point_p;
+						}
+				}
+		}
+
+	/* The names */
+	for (i = 0; i < num_regions; ++ i)
+		{
+			const char *name_s = regions_p [order_p [i]].ard_name_s;
+			const size_t length = (name_s ? strlen (name_s) : 0) + 1;
+
+			if (fwrite (name_s ? name_s : "", 1, length, out_f) != length)
+				{
+					return false;
+				}
+		}
+
+	return true;
+}
+
+
+static bool GetRegionBoundingBox (const AdminRegionData *region_p, FixedBoundingBox *box_p)
+{
+	const FixedCoordinate *points_p = region_p -> ard_points_p;
+	bool found_flag = false;
+	uint32 i;
+
+	for (i = 0; i < region_p -> ard_num_rings; ++ i)
+		{
+			const uint32 num_points = region_p -> ard_ring_lengths_p [i];
+
+			if (num_points > 0)
+				{
+					FixedBoundingBox ring_box;
+
+					GetPointsBoundingBox (points_p, num_points, &ring_box);
+
+					if (found_flag)
+						{
+							ExtendRegionBox (box_p, &ring_box);
+						}
+					else
+						{
+							*box_p = ring_box;
+							found_flag = true;
+						}
+
+					points_p += num_points;
+				}
+		}
+
+	return found_flag;
+}
+
+
+/*
+ * Boundaries from OpenStreetMap are split at the antimeridian, so unlike
+ * ExpandFixedBoundingBox () this never wraps around.
+ */
+static void GetPointsBoundingBox (const FixedCoordinate *points_p, const uint32 num_points, FixedBoundingBox *box_p)
+{
+	uint32 i;
+
+	box_p -> fbb_south_west = *points_p;
+	box_p -> fbb_north_east = *points_p;
+
+	for (i = 1; i < num_points; ++ i)
+		{
+			const FixedCoordinate *point_p = points_p + i;
+
+			if (point_p -> fc_latitude < box_p -> fbb_south_west.fc_latitude)
+				{
+					box_p -> fbb_south_west.fc_latitude = point_p -> fc_latitude;
+				}
+			else if (point_p -> fc_latitude > box_p -> fbb_north_east.fc_latitude)
+				{
+					box_p -> fbb_north_east.fc_latitude = point_p -> fc_latitude;
+				}
+
+			if (point_p -> fc_longitude < box_p -> fbb_south_west.fc_longitude)
+				{
+					box_p -> fbb_south_west.fc_longitude = point_p -> fc_longitude;
+				}
+			else if (point_p -> fc_longitude > box_p -> fbb_north_east.fc_longitude)
+				{
+					box_p -> fbb_north_east.fc_longitude = point_p -> fc_longitude;
+				}
+		}
+}
+
+
+/*
+ * Sort the items using Sort-Tile-Recursive, so that each run of
+ * AR_NODE_CAPACITY items is a compact tile.
+ */
+static void SortRegionBuildItems (RegionBuildItem *items_p, const size_t num_items)
+{
+	const size_t num_nodes = (num_items + AR_NODE_CAPACITY - 1) / AR_NODE_CAPACITY;
+	size_t num_slices = 1;
+	size_t slice_size;
+	size_t i;
+
+	while (num_slices * num_slices < num_nodes)
+		{
+			++ num_slices;
+		}
+
+	slice_size = ((num_nodes + num_slices - 1) / num_slices) * AR_NODE_CAPACITY;
+
+	qsort (items_p, num_items, sizeof (RegionBuildItem), CompareRegionBuildItemsByLongitude);
+
+	for (i = 0; i < num_items; i += slice_size)
+		{
+			const size_t count = (num_items - i < slice_size) ? (num_items - i) : slice_size;
+
+			qsort (items_p + i, count, sizeof (RegionBuildItem), CompareRegionBuildItemsByLatitude);
+		}
+}
+
+
+static void ExtendRegionBox (FixedBoundingBox *box_p, const FixedBoundingBox *other_box_p)
+{
+	if (other_box_p -> fbb_south_west.fc_latitude < box_p -> fbb_south_west.fc_latitude)
+		{
+			box_p -> fbb_south_west.fc_latitude = other_box_p -> fbb_south_west.fc_latitude;
+		}
+
+	if (other_box_p -> fbb_south_west.fc_longitude < box_p -> fbb_south_west.fc_longitude)
+		{
+			box_p -> fbb_south_west.fc_longitude = other_box_p -> fbb_south_west.fc_longitude;
+		}
+
+	if (other_box_p -> fbb_north_east.fc_latitude > box_p -> fbb_north_east.fc_latitude)
+		{
+			box_p -> fbb_north_east.fc_latitude = other_box_p -> fbb_north_east.fc_latitude;
+		}
+
+	if (other_box_p -> fbb_north_east.fc_longitude > box_p -> fbb_north_east.fc_longitude)
+		{
+			box_p -> fbb_north_east.fc_longitude = other_box_p -> fbb_north_east.fc_longitude;
+		}
+}
+
+
+static int CompareRegionBuildItemsByLongitude (const void *v0_p, const void *v1_p)
+{
+	const RegionBuildItem *item0_p = (const RegionBuildItem *) v0_p;
+	const RegionBuildItem *item1_p = (const RegionBuildItem *) v1_p;
+	const int64 centre0 = (int64) item0_p -> rbi_box.fbb_south_west.fc_longitude + item0_p -> rbi_box.fbb_north_east.fc_longitude;
+	const int64 centre1 = (int64) item1_p -> rbi_box.fbb_south_west.fc_longitude + item1_p -> rbi_box.fbb_north_east.fc_longitude;
+
+	return (centre0 < centre1) ? -1 : ((centre0 > centre1) ? 1 : 0);
+}
+
+
+static int CompareRegionBuildItemsByLatitude (const void *v0_p, const void *v1_p)
+{
+	const RegionBuildItem *item0_p = (const RegionBuildItem *) v0_p;
+	const RegionBuildItem *item1_p = (const RegionBuildItem *) v1_p;
+	const int64 centre0 = (int64) item0_p -> rbi_box.fbb_south_west.fc_latitude + item0_p -> rbi_box.fbb_north_east.fc_latitude;
+	const int64 centre1 = (int64) item1_p -> rbi_box.fbb_south_west.fc_latitude + item1_p -> rbi_box.fbb_north_east.fc_latitude;
+
+	return (centre0 < centre1) ? -1 : ((centre0 > centre1) ? 1 : 0);
+}
+
+
+/* The box is the south, west, north and east edges at the start of a region, ring or node */
+static bool IsPointInRegionBox (const uint8 *box_p, const FixedCoordinate *point_p)
+{
+	return ((point_p -> fc_latitude >= LoadInt32 (box_p)) && (point_p -> fc_longitude >= LoadInt32 (box_p + 4)) &&
+		(point_p -> fc_latitude <= LoadInt32 (box_p + 8)) && (point_p -> fc_longitude <= LoadInt32 (box_p + 12)));
+}
+
+
+/*
+ * Use the even-odd rule over all of the region's rings, so holes and
+ * separate parts need no special treatment.
+ */
+static bool IsPointInRegion (const AdminRegionIndex *index_p, const uint8 *region_p, const FixedCoordinate *point_p)
+{
+	const uint32 first_ring = LoadUInt32 (region_p + 16);
+	const uint32 num_rings = LoadUInt32 (region_p + 20);
+	const int64 x = point_p -> fc_longitude;
+	const int64 y = point_p -> fc_latitude;
+	bool inside_flag = false;
+	uint32 i;
+
+	if ((first_ring > index_p -> ari_num_rings) || (num_rings > index_p -> ari_num_rings - first_ring))
+		{
+			return false;
+		}
+
+	for (i = 0; i < num_rings; ++ i)
+		{
+			const uint8 *ring_p = index_p -> ari_rings_p + ((size_t) (first_ring + i) * AR_RING_SIZE);
+
+			if (IsPointInRegionBox (ring_p, point_p))
+				{
+					const uint32 first_point = LoadUInt32 (ring_p + 16);
+					const uint32 num_points = LoadUInt32 (ring_p + 20);
+
+					if ((num_points > 1) && (first_point <= index_p -> ari_num_points) && (num_points <= index_p -> ari_num_points - first_point))
+						{
+							const uint8 *ring_point_p = index_p -> ari_points_p + ((size_t) first_point * AR_POINT_SIZE);
+							const uint8 *end_p = ring_point_p + ((size_t) num_points * AR_POINT_SIZE);
+							int64 y0 = LoadInt32 (ring_point_p);
+							int64 x0 = LoadInt32 (ring_point_p + 4);
+
+							/* The rings are closed so each edge runs from one point to the next */
+							for (ring_point_p += AR_POINT_SIZE; ring_point_p < end_p; ring_point_p += AR_POINT_SIZE)
+								{
+									const int64 y1 = LoadInt32 (ring_point_p);
+									const int64 x1 = LoadInt32 (ring_point_p + 4);
+
+									if ((y0 > y) != (y1 > y))
+										{
+											/* Whether the point is west of where the edge crosses its latitude, without dividing */
+											const int64 dy = y1 - y0;
+											const int64 lhs = (x - x0) * dy;
+											const int64 rhs = (y - y0) * (x1 - x0);
+
+											if ((dy > 0) ? (lhs < rhs) : (lhs > rhs))
+												{
+													inside_flag = !inside_flag;
+												}
+										}
+
+									x0 = x1;
+									y0 = y1;
+								}
+						}
+				}
+		}
+
+	return inside_flag;
+}
+
+
+/* Insert a region keeping them in order of level, dropping the highest level if there's no room */
+static void AddAdminRegion (const AdminRegionIndex *index_p, const uint8 *region_p, AdminRegion *regions_p, const uint32 max_regions, uint32 *num_regions_p)
+{
+	const uint32 level = * (region_p + 30);
+	uint32 i = *num_regions_p;
+
+	if (i == max_regions)
+		{
+			if (regions_p [i - 1].ar_level <= level)
+				{
+					return;
+				}
+
+			-- i;
+		}
+	else
+		{
+			++ *num_regions_p;
+		}
+
+	while ((i > 0) && (regions_p [i - 1].ar_level > level))
+		{
+			regions_p [i] = regions_p [i - 1];
+			-- i;
+		}
+
+	SetAdminRegion (index_p, region_p, regions_p + i);
+}
+
+
+static void SetAdminRegion (const AdminRegionIndex *index_p, const uint8 *region_p, AdminRegion *dest_p)
+{
+	const uint32 name_offset = LoadUInt32 (region_p + 24);
+
+	dest_p -> ar_name_s = (name_offset < index_p -> ari_strings_size) ? (index_p -> ari_strings_s + name_offset) : "";
+	dest_p -> ar_country_code_s [0] = (char) * (region_p + 28);
+	dest_p -> ar_country_code_s [1] = (char) * (region_p + 29);
+	dest_p -> ar_country_code_s [2] = '\0';
+	dest_p -> ar_level = * (region_p + 30);
+}
+
+
+static bool SetAddressComponent (const char *value_s, char **value_ss)
+{
+	char *copied_value_s = EasyCopyToNewString (value_s);
+
+	if (copied_value_s)
+		{
+			if (*value_ss)
+				{
+					FreeCopiedString (*value_ss);
+				}
+
+			*value_ss = copied_value_s;
+
+			return true;
+		}
+
+	return false;
+}
+
+
+static void StoreBox (uint8 *dest_p, const FixedBoundingBox *box_p)
+{
+	StoreUInt32 (dest_p, (uint32) box_p -> fbb_south_west.fc_latitude);
+	StoreUInt32 (dest_p + 4, (uint32) box_p -> fbb_south_west.fc_longitude);
+	StoreUInt32 (dest_p + 8, (uint32) box_p -> fbb_north_east.fc_latitude);
+	StoreUInt32 (dest_p + 12, (uint32) box_p -> fbb_north_east.fc_longitude);
+}
+
+
+static uint32 LoadUInt32 (const uint8 *src_p)
+{
+	return ((uint32) *src_p) | (((uint32) * (src_p + 1)) << 8) | (((uint32) * (src_p + 2)) << 16) | (((uint32) * (src_p + 3)) << 24);
+}
+
+
+static int32 LoadInt32 (const uint8 *src_p)
+{
+	return (int32) LoadUInt32 (src_p);
+}
+
+
+static void StoreUInt32 (uint8 *dest_p, const uint32 value)
+{
+	*dest_p = (uint8) (value & 0xFF);
+	* (dest_p + 1) = (uint8) ((value >> 8) & 0xFF);
+	* (dest_p + 2) = (uint8) ((value >> 16) & 0xFF);
+	* (dest_p + 3) = (uint8) ((value >> 24) & 0xFF);
+}
@@ -0,0 +1,1306 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * autocomplete.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <pthread.h>
+#endif
+
+#include "autocomplete.h"
+#include "country_codes.h"
+
+#include "memory_allocations.h"
+#include "streams.h"
+#include "string_utils.h"
+
+
+/* The longest normalised value that can be added */
+#define AC_MAX_KEY_LENGTH (255)
+
+#define AC_INITIAL_CAPACITY (64)
+
+
+/* A value in an AutocompleteBuilder */
+typedef struct AutocompleteValue
+{
+	/* The value as it was first added */
+	char *av_value_s;
+
+	/* The normalised value */
+	char *av_key_s;
+
+	uint32 av_key_length;
+
+	uint32 av_count;
+
+	uint32 av_hash;
+
+	AutocompleteField av_field;
+} AutocompleteValue;
+
+
+/*
+ * A node of the radix trie. Each node's children are stored next to
+ * each other, in descending order of an_best_count, so that a search
+ * can stop going through them as soon as they can't beat the
+ * suggestions that it already has.
+ */
+typedef struct AutocompleteNode
+{
+	/* The characters on the edge to this node, from aci_strings_p */
+	uint32 an_label_offset;
+
+	uint32 an_first_child;
+
+	/* The highest count of this node and all of the nodes below it */
+	uint32 an_best_count;
+
+	/* This is 0 if the node isn't the end of a value */
+	uint32 an_count;
+
+	/* The value ending at this node, from aci_strings_p */
+	uint32 an_value_offset;
+
+	uint16 an_label_length;
+
+	uint16 an_num_children;
+} AutocompleteNode;
+
+
+/* A copy of a value that stays the same while the builder is changed */
+typedef struct AutocompleteSnapshotValue
+{
+	const char *asv_value_s;
+
+	const char *asv_key_s;
+
+	uint32 asv_key_length;
+
+	uint32 asv_count;
+
+	/* Where asv_key_s is copied to in aci_strings_p */
+	uint32 asv_key_offset;
+
+	/* Where asv_value_s is copied to in aci_strings_p */
+	uint32 asv_value_offset;
+
+	AutocompleteField asv_field;
+} AutocompleteSnapshotValue;
+
+
+typedef struct AutocompleterSync
+{
+#ifdef _WIN32
+	CRITICAL_SECTION as_lock;
+
+	HANDLE as_thread;
+#else
+	pthread_mutex_t as_lock;
+
+	pthread_t as_thread;
+#endif
+
+	/* This is true if as_thread was started and hasn't been joined */
+	bool as_started_flag;
+
+	/* This is true while a rebuild is running */
+	bool as_active_flag;
+} AutocompleterSync;
+
+
+typedef struct AutocompleteSearchFrame
+{
+	uint32 asf_node;
+
+	uint32 asf_next_child;
+} AutocompleteSearchFrame;
+
+
+static uint32 NormaliseAutocompleteValue (const char *value_s, char *key_s);
+
+static uint32 GetAutocompleteKeyHash (const AutocompleteField field, const char *key_s, const uint32 key_length);
+
+static bool GrowAutocompleteValues (AutocompleteBuilder *builder_p);
+
+static bool GrowAutocompleteSlots (AutocompleteBuilder *builder_p);
+
+static bool AddOptionalAutocompleteValue (AutocompleteBuilder *builder_p, const AutocompleteField field, const char *value_s);
+
+static AutocompleteIndex *BuildAutocompleteIndexFromSnapshot (AutocompleteSnapshotValue *values_p, const uint32 num_values);
+
+static bool BuildAutocompleteTrie (AutocompleteTrie *trie_p, AutocompleteSnapshotValue **values_pp, const uint32 num_values);
+
+static void BuildAutocompleteNode (AutocompleteNode *nodes_p, uint32 *num_nodes_p, const uint32 node, AutocompleteSnapshotValue **values_pp, const uint32 first, const uint32 last, const uint32 depth);
+
+static void AddAutocompleteSuggestion (AutocompleteSuggestion *suggestions_p, uint32 *num_suggestions_p, const uint32 max_suggestions, const char *value_s, const uint32 count);
+
+static AutocompleteSnapshotValue *GetAutocompleteSnapshot (const AutocompleteBuilder *builder_p);
+
+static void RebuildAutocompleter (Autocompleter *autocompleter_p);
+
+static void LockAutocompleter (Autocompleter *autocompleter_p);
+
+static void UnlockAutocompleter (Autocompleter *autocompleter_p);
+
+static void WaitForAutocompleterThread (AutocompleterSync *sync_p);
+
+static int CompareAutocompleteSnapshotValues (const void *v0_p, const void *v1_p);
+
+static int CompareAutocompleteNodes (const void *v0_p, const void *v1_p);
+
+#ifdef _WIN32
+static DWORD WINAPI RunAutocompleterThread (LPVOID data_p);
+#else
+static void *RunAutocompleterThread (void *data_p);
+#endif
+
+
+
+AutocompleteBuilder *AllocateAutocompleteBuilder (void)
+{
+	AutocompleteBuilder *builder_p = (AutocompleteBuilder *) AllocMemory (sizeof (AutocompleteBuilder));
+
+	if (builder_p)
+		{
+			memset (builder_p, 0, sizeof (AutocompleteBuilder));
+
+			return builder_p;
+		}
+
+	PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to allocate AutocompleteBuilder");
+
+	return NULL;
+}
+
+
+void FreeAutocompleteBuilder (AutocompleteBuilder *builder_p)
+{
+	uint32 i;
+
+	for (i = 0; i < builder_p -> ab_num_values; ++ i)
+		{
+			AutocompleteValue *value_p = builder_p -> ab_values_p + i;
+
+			FreeCopiedString (value_p -> av_value_s);
+			FreeMemory (value_p -> av_key_s);
+		}
+
+	if (builder_p -> ab_values_p)
+		{
+			FreeMemory (builder_p -> ab_values_p);
+		}
+
+	if (builder_p -> ab_slots_p)
+		{
+			FreeMemory (builder_p -> ab_slots_p);
+		}
+
+	FreeMemory (builder_p);
+}
+
+
+bool AddAutocompleteValue (AutocompleteBuilder *builder_p, const AutocompleteField field, const char *value_s, const uint32 count)
+{
+	char key_s [AC_MAX_KEY_LENGTH + 1];
+	const uint32 key_length = NormaliseAutocompleteValue (value_s, key_s);
+	uint32 hash;
+	uint32 mask;
+	uint32 slot;
+
+	if ((key_length == 0) || (count == 0))
+		{
+			/* There is nothing to suggest */
+			return true;
+		}
+
+	if (key_length > AC_MAX_KEY_LENGTH)
+		{
+			PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "\"%s\" is too long to suggest", value_s);
+			return true;
+		}
+
+	/* Keep the table at most half full */
+	if ((builder_p -> ab_num_values + 1) * 2 > builder_p -> ab_slots_capacity)
+		{
+			if (!GrowAutocompleteSlots (builder_p))
+				{
+					return false;
+				}
+		}
+
+	hash = GetAutocompleteKeyHash (field, key_s, key_length);
+	mask = builder_p -> ab_slots_capacity - 1;
+	slot = hash & mask;
+
+	while (builder_p -> ab_slots_p [slot] != 0)
+		{
+			AutocompleteValue *existing_p = builder_p -> ab_values_p + (builder_p -> ab_slots_p [slot] - 1);
+
+			if ((existing_p -> av_hash == hash) && (existing_p -> av_field == field) && (existing_p -> av_key_length == key_length) && (memcmp (existing_p -> av_key_s, key_s, key_length) == 0))
+				{
+					/* Don't wrap around if a value is used more than 4 billion times */
+					existing_p -> av_count = (existing_p -> av_count > 0xFFFFFFFFu - count) ? 0xFFFFFFFFu : existing_p -> av_count + count;
+					return true;
+				}
+
+			slot = (slot + 1) & mask;
+		}
+
+	if (builder_p -> ab_num_values == builder_p -> ab_values_capacity)
+		{
+			if (!GrowAutocompleteValues (builder_p))
+				{
+					return false;
+				}
+		}
+
+	{
+		AutocompleteValue *value_p = builder_p -> ab_values_p + builder_p -> ab_num_values;
+
+		value_p -> av_value_s = EasyCopyToNewString (value_s);
+
+		if (value_p -> av_value_s)
+			{
+				value_p -> av_key_s = (char *) AllocMemory (key_length + 1);
+
+				if (value_p -> av_key_s)
+					{
+						memcpy (value_p -> av_key_s, key_s, key_length + 1);
+						value_p -> av_key_length = key_length;
+						value_p -> av_count = count;
+						value_p -> av_hash = hash;
+						value_p -> av_field = field;
+
+						++ (builder_p -> ab_num_values);
+						builder_p -> ab_slots_p [slot] = builder_p -> ab_num_values;
+
+						return true;
+					}
+
+				FreeCopiedString (value_p -> av_value_s);
+			}
+	}
+
+	PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to add autocomplete value \"%s\"", value_s);
+
+	return false;
+}
+
+
+bool AddCountriesToAutocompleteBuilder (AutocompleteBuilder *builder_p)
+{
+	const uint32 num_countries = GetNumberOfCountries ();
+	uint32 i;
+
+	for (i = 0; i < num_countries; ++ i)
+		{
+			const char *name_s;
+			const char *code_s;
+
+			if (GetCountryByIndex (i, &name_s, &code_s))
+				{
+					if (!AddAutocompleteValue (builder_p, AF_COUNTRY, name_s, 1))
+						{
+							return false;
+						}
+				}
+		}
+
+	return true;
+}
+
+
+bool AddAdminRegionsToAutocompleteBuilder (AutocompleteBuilder *builder_p, const AdminRegionIndex *index_p)
+{
+	const uint32 num_regions = GetNumberOfAdminRegions (index_p);
+	uint32 i;
+
+	for (i = 0; i < num_regions; ++ i)
+		{
+			AdminRegion region;
+
+			if (GetAdminRegion (index_p, i, &region))
+				{
+					bool success_flag = true;
+
+					if (region.ar_level == 2)
+						{
+							success_flag = AddAutocompleteValue (builder_p, AF_COUNTRY, region.ar_name_s, 1);
+						}
+					else if ((region.ar_level >= 4) && (region.ar_level <= 6))
+						{
+							success_flag = AddAutocompleteValue (builder_p, AF_COUNTY, region.ar_name_s, 1);
+						}
+					else if ((region.ar_level >= 7) && (region.ar_level <= 8))
+						{
+							success_flag = AddAutocompleteValue (builder_p, AF_TOWN, region.ar_name_s, 1);
+						}
+
+					if (!success_flag)
+						{
+							return false;
+						}
+				}
+		}
+
+	return true;
+}
+
+
+bool AddAddressRecordsToAutocompleteBuilder (AutocompleteBuilder *builder_p, const AddressRecordFile *record_file_p)
+{
+	AddressRecordIterator iterator;
+	AddressRecordView view;
+
+	InitAddressRecordIterator (&iterator, record_file_p);
+
+	while (GetNextAddressRecord (&iterator, &view))
+		{
+			if (! (AddOptionalAutocompleteValue (builder_p, AF_TOWN, view.arv_components_ss [ARC_TOWN]) &&
+				AddOptionalAutocompleteValue (builder_p, AF_COUNTY, view.arv_components_ss [ARC_COUNTY]) &&
+				AddOptionalAutocompleteValue (builder_p, AF_COUNTRY, view.arv_components_ss [ARC_COUNTRY])))
+				{
+					return false;
+				}
+		}
+
+	return true;
+}
+
+
+bool AddAddressToAutocompleteBuilder (AutocompleteBuilder *builder_p, const Address *address_p)
+{
+	return (AddOptionalAutocompleteValue (builder_p, AF_TOWN, address_p -> ad_town_s) &&
+		AddOptionalAutocompleteValue (builder_p, AF_COUNTY, address_p -> ad_county_s) &&
+		AddOptionalAutocompleteValue (builder_p, AF_COUNTRY, address_p -> ad_country_s));
+}
+
+
+AutocompleteIndex *BuildAutocompleteIndex (const AutocompleteBuilder *builder_p)
+{
+	AutocompleteIndex *index_p = NULL;
+	AutocompleteSnapshotValue *values_p = GetAutocompleteSnapshot (builder_p);
+
+	if (values_p || (builder_p -> ab_num_values == 0))
+		{
+			index_p = BuildAutocompleteIndexFromSnapshot (values_p, builder_p -> ab_num_values);
+
+			if (values_p)
+				{
+					FreeMemory (values_p);
+				}
+		}
+
+	return index_p;
+}
+
+
+void FreeAutocompleteIndex (AutocompleteIndex *index_p)
+{
+	uint32 i;
+
+	for (i = 0; i < AF_NUM_FIELDS; ++ i)
+		{
+			if (index_p -> aci_tries [i].at_nodes_p)
+				{
+					FreeMemory (index_p -> aci_tries [i].at_nodes_p);
+				}
+		}
+
+	if (index_p -> aci_strings_p)
+		{
+			FreeMemory (index_p -> aci_strings_p);
+		}
+
+	FreeMemory (index_p);
+}
+
+
+uint32 GetAutocompleteSuggestions (const AutocompleteIndex *index_p, const AutocompleteField field, const char *prefix_s, AutocompleteSuggestion *suggestions_p, const uint32 max_suggestions)
+{
+	const AutocompleteTrie *trie_p = index_p -> aci_tries + field;
+	const AutocompleteNode *nodes_p = trie_p -> at_nodes_p;
+	const char *strings_p = index_p -> aci_strings_p;
+	char key_s [AC_MAX_KEY_LENGTH + 1];
+	const uint32 key_length = NormaliseAutocompleteValue (prefix_s, key_s);
+	AutocompleteSearchFrame stack [AC_MAX_KEY_LENGTH + 1];
+	uint32 stack_size = 0;
+	uint32 num_suggestions = 0;
+	uint32 node = 0;
+	uint32 position = 0;
+
+	if ((trie_p -> at_num_nodes == 0) || (max_suggestions == 0) || (key_length > AC_MAX_KEY_LENGTH))
+		{
+			return 0;
+		}
+
+	/* Find the node whose subtree has all of the values starting with the prefix */
+	while (position < key_length)
+		{
+			const AutocompleteNode *node_p = nodes_p + node;
+			const uint32 last_child = node_p -> an_first_child + node_p -> an_num_children;
+			uint32 child;
+
+			for (child = node_p -> an_first_child; child < last_child; ++ child)
+				{
+					if (strings_p [nodes_p [child].an_label_offset] == key_s [position])
+						{
+							break;
+						}
+				}
+
+			if (child < last_child)
+				{
+					const AutocompleteNode *child_p = nodes_p + child;
+					const uint32 remaining = key_length - position;
+					const uint32 length = (child_p -> an_label_length < remaining) ? child_p -> an_label_length : remaining;
+
+					if (memcmp (strings_p + child_p -> an_label_offset, key_s + position, length) != 0)
+						{
+							return 0;
+						}
+
+					position += length;
+					node = child;
+				}
+			else
+				{
+					return 0;
+				}
+		}
+
+	/*
+	 * Go through the subtree, most used children first, skipping any
+	 * subtrees that can't beat the worst of the suggestions so far
+	 */
+	if (nodes_p [node].an_count > 0)
+		{
+			AddAutocompleteSuggestion (suggestions_p, &num_suggestions, max_suggestions, strings_p + nodes_p [node].an_value_offset, nodes_p [node].an_count);
+		}
+
+	stack [0].asf_node = node;
+	stack [0].asf_next_child = 0;
+	stack_size = 1;
+
+	while (stack_size > 0)
+		{
+			AutocompleteSearchFrame *frame_p = stack + (stack_size - 1);
+			const AutocompleteNode *node_p = nodes_p + frame_p -> asf_node;
+
+			if (frame_p -> asf_next_child < node_p -> an_num_children)
+				{
+					const uint32 child = node_p -> an_first_child + frame_p -> asf_next_child;
+					const AutocompleteNode *child_p = nodes_p + child;
+
+					if ((num_suggestions == max_suggestions) && (child_p -> an_best_count <= suggestions_p [num_suggestions - 1].as_count))
+						{
+							/* The rest of the children have lower counts still */
+							-- stack_size;
+						}
+					else
+						{
+							++ (frame_p -> asf_next_child);
+
+							if (child_p -> an_count > 0)
+								{
+									AddAutocompleteSuggestion (suggestions_p, &num_suggestions, max_suggestions, strings_p + child_p -> an_value_offset, child_p -> an_count);
+								}
+
+							if (child_p -> an_num_children > 0)
+								{
+									stack [stack_size].asf_node = child;
+									stack [stack_size].asf_next_child = 0;
+									++ stack_size;
+								}
+						}
+				}
+			else
+				{
+					-- stack_size;
+				}
+		}
+
+	return num_suggestions;
+}
+
+
+Autocompleter *AllocateAutocompleter (AutocompleteBuilder *builder_p)
+{
+	Autocompleter *autocompleter_p = (Autocompleter *) AllocMemory (sizeof (Autocompleter));
+
+	if (autocompleter_p)
+		{
+			AutocompleterSync *sync_p = (AutocompleterSync *) AllocMemory (sizeof (AutocompleterSync));
+
+			if (sync_p)
+				{
+					AutocompleteIndex *index_p = BuildAutocompleteIndex (builder_p);
+
+					if (index_p)
+						{
+							bool lock_flag;
+
+#ifdef _WIN32
+							InitializeCriticalSection (& (sync_p -> as_lock));
+							lock_flag = true;
+#else
+							lock_flag = (pthread_mutex_init (& (sync_p -> as_lock), NULL) == 0);
+#endif
+
+							if (lock_flag)
+								{
+									sync_p -> as_started_flag = false;
+									sync_p -> as_active_flag = false;
+
+									autocompleter_p -> ac_builder_p = builder_p;
+									autocompleter_p -> ac_index_p = index_p;
+									autocompleter_p -> ac_sync_p = sync_p;
+									autocompleter_p -> ac_dirty_flag = false;
+
+									return autocompleter_p;
+								}
+
+							FreeAutocompleteIndex (index_p);
+						}
+
+					FreeMemory (sync_p);
+				}
+
+			FreeMemory (autocompleter_p);
+		}
+
+	PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to allocate Autocompleter");
+
+	return NULL;
+}
+
+
+void FreeAutocompleter (Autocompleter *autocompleter_p)
+{
+	AutocompleterSync *sync_p = autocompleter_p -> ac_sync_p;
+
+	if (sync_p -> as_started_flag)
+		{
+			WaitForAutocompleterThread (sync_p);
+		}
+
+#ifdef _WIN32
+	DeleteCriticalSection (& (sync_p -> as_lock));
+#else
+	pthread_mutex_destroy (& (sync_p -> as_lock));
+#endif
+
+	FreeAutocompleteIndex (autocompleter_p -> ac_index_p);
+	FreeAutocompleteBuilder (autocompleter_p -> ac_builder_p);
+	FreeMemory (sync_p);
+	FreeMemory (autocompleter_p);
+}
+
+
+bool AddAddressToAutocompleter (Autocompleter *autocompleter_p, const Address *address_p)
+{
+	bool success_flag;
+
+	LockAutocompleter (autocompleter_p);
+
+	success_flag = AddAddressToAutocompleteBuilder (autocompleter_p -> ac_builder_p, address_p);
+	autocompleter_p -> ac_dirty_flag = true;
+
+	UnlockAutocompleter (autocompleter_p);
+
+	return success_flag;
+}
+
+
+bool StartAutocompleterRebuild (Autocompleter *autocompleter_p)
+{
+	AutocompleterSync *sync_p = autocompleter_p -> ac_sync_p;
+	bool start_flag = false;
+	bool join_flag = false;
+
+	LockAutocompleter (autocompleter_p);
+
+	/* A running rebuild will pick up any values added since it started */
+	if ((!sync_p -> as_active_flag) && (autocompleter_p -> ac_dirty_flag))
+		{
+			join_flag = sync_p -> as_started_flag;
+			sync_p -> as_active_flag = true;
+			sync_p -> as_started_flag = false;
+			start_flag = true;
+		}
+
+	UnlockAutocompleter (autocompleter_p);
+
+	if (start_flag)
+		{
+			bool started_flag;
+
+			/* The previous thread has already finished so this won't block */
+			if (join_flag)
+				{
+					WaitForAutocompleterThread (sync_p);
+				}
+
+			/*
+			 * Start the thread while holding the lock so that it can't finish
+			 * and let another rebuild start before as_thread is set
+			 */
+			LockAutocompleter (autocompleter_p);
+
+#ifdef _WIN32
+			sync_p -> as_thread = CreateThread (NULL, 0, RunAutocompleterThread, autocompleter_p, 0, NULL);
+			started_flag = (sync_p -> as_thread != NULL);
+#else
+			started_flag = (pthread_create (& (sync_p -> as_thread), NULL, RunAutocompleterThread, autocompleter_p) == 0);
+#endif
+
+			sync_p -> as_started_flag = started_flag;
+
+			UnlockAutocompleter (autocompleter_p);
+
+			if (!started_flag)
+				{
+					PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to start autocomplete rebuild thread, rebuilding on this thread instead");
+					RebuildAutocompleter (autocompleter_p);
+				}
+		}
+
+	return true;
+}
+
+
+AutocompleteIndex *AcquireAutocompleteIndex (Autocompleter *autocompleter_p)
+{
+	AutocompleteIndex *index_p;
+
+	LockAutocompleter (autocompleter_p);
+
+	index_p = autocompleter_p -> ac_index_p;
+	++ (index_p -> aci_num_users);
+
+	UnlockAutocompleter (autocompleter_p);
+
+	return index_p;
+}
+
+
+void ReleaseAutocompleteIndex (Autocompleter *autocompleter_p, AutocompleteIndex *index_p)
+{
+	bool free_flag;
+
+	LockAutocompleter (autocompleter_p);
+
+	-- (index_p -> aci_num_users);
+	free_flag = (index_p -> aci_retired_flag) && (index_p -> aci_num_users == 0);
+
+	UnlockAutocompleter (autocompleter_p);
+
+	if (free_flag)
+		{
+			FreeAutocompleteIndex (index_p);
+		}
+}
+
+
+
+/*
+ * STATIC DEFINITIONS
+ */
+
+
+/*
+ * Lower-case the value and replace each run of spaces and punctuation
+ * with a single space. The key must have room for AC_MAX_KEY_LENGTH + 1
+ * characters. If the value is too long, a length greater than
+ * AC_MAX_KEY_LENGTH is returned.
+ */
+static uint32 NormaliseAutocompleteValue (const char *value_s, char *key_s)
+{
+	uint32 length = 0;
+	bool space_flag = false;
+	const char *c_p;
+
+	for (c_p = value_s; *c_p != '\0'; ++ c_p)
+		{
+			const unsigned char c = (unsigned char) *c_p;
+
+			if (isspace (c) || (c == '-') || (c == '\'') || (c == '.') || (c == ','))
+				{
+					space_flag = (length > 0);
+				}
+			else
+				{
+					if (length + (space_flag ? 1 : 0) >= AC_MAX_KEY_LENGTH)
+						{
+							return AC_MAX_KEY_LENGTH + 1;
+						}
+
+					if (space_flag)
+						{
+							key_s [length] = ' ';
+							++ length;
+							space_flag = false;
+						}
+
+					key_s [length] = (char) tolower (c);
+					++ length;
+				}
+		}
+
+	key_s [length] = '\0';
+
+	return length;
+}
+
+
+/* FNV-1a over the field and key */
+static uint32 GetAutocompleteKeyHash (const AutocompleteField field, const char *key_s, const uint32 key_length)
+{
+	uint32 hash = 2166136261u;
+	uint32 i;
+
+	hash ^= (uint32) field;
+	hash *= 16777619u;
+
+	for (i = 0; i < key_length; ++ i)
+		{
+			hash ^= (uint8) key_s [i];
+			hash *= 16777619u;
+		}
+
+	return hash;
+}
+
+
+static bool GrowAutocompleteValues (AutocompleteBuilder *builder_p)
+{
+	const uint32 new_capacity = (builder_p -> ab_values_capacity > 0) ? (builder_p -> ab_values_capacity << 1) : AC_INITIAL_CAPACITY;
+	AutocompleteValue *values_p = (AutocompleteValue *) ReallocMemory (builder_p -> ab_values_p, new_capacity * sizeof (AutocompleteValue), builder_p -> ab_values_capacity * sizeof (AutocompleteValue));
+
+	if (values_p)
+		{
+			builder_p -> ab_values_p = values_p;
+			builder_p -> ab_values_capacity = new_capacity;
+
+			return true;
+		}
+
+	PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to grow autocomplete values to " UINT32_FMT, new_capacity);
+
+	return false;
+}
+
+
+static bool GrowAutocompleteSlots (AutocompleteBuilder *builder_p)
+{
+	const uint32 new_capacity = (builder_p -> ab_slots_capacity > 0) ? (builder_p -> ab_slots_capacity << 1) : (AC_INITIAL_CAPACITY << 1);
+	uint32 *slots_p = (uint32 *) AllocMemory (new_capacity * sizeof (uint32));
+
+	if (slots_p)
+		{
+			const uint32 mask = new_capacity - 1;
+			uint32 i;
+
+			memset (slots_p, 0, new_capacity * sizeof (uint32));
+
+			for (i = 0; i < builder_p -> ab_num_values; ++ i)
+				{
+					uint32 slot = builder_p -> ab_values_p [i].av_hash & mask;
+
+					while (slots_p [slot] != 0)
+						{
+							slot = (slot + 1) & mask;
+						}
+
+					slots_p [slot] = i + 1;
+				}
+
+			if (builder_p -> ab_slots_p)
+				{
+					FreeMemory (builder_p -> ab_slots_p);
+				}
+
+			builder_p -> ab_slots_p = slots_p;
+			builder_p -> ab_slots_capacity = new_capacity;
+
+			return true;
+		}
+
+	PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to grow autocomplete table to " UINT32_FMT, new_capacity);
+
+	return false;
+}
+
+
+static bool AddOptionalAutocompleteValue (AutocompleteBuilder *builder_p, const AutocompleteField field, const char *value_s)
+{
+	return (value_s ? AddAutocompleteValue (builder_p, field, value_s, 1) : true);
+}
+
+
+/*
+ * Copy the builder's values so that the index can be built from them
+ * while more are added. The strings aren't copied as the builder never
+ * frees them until it is freed itself.
+ */
+static AutocompleteSnapshotValue *GetAutocompleteSnapshot (const AutocompleteBuilder *builder_p)
+{
+	AutocompleteSnapshotValue *values_p = NULL;
+
+	if (builder_p -> ab_num_values > 0)
+		{
+			values_p = (AutocompleteSnapshotValue *) AllocMemory (builder_p -> ab_num_values * sizeof (AutocompleteSnapshotValue));
+
+			if (values_p)
+				{
+					uint32 i;
+
+					for (i = 0; i < builder_p -> ab_num_values; ++ i)
+						{
+							const AutocompleteValue *src_p = builder_p -> ab_values_p + i;
+							AutocompleteSnapshotValue *dest_p = values_p + i;
+
+							dest_p -> asv_value_s = src_p -> av_value_s;
+							dest_p -> asv_key_s = src_p -> av_key_s;
+							dest_p -> asv_key_length = src_p -> av_key_length;
+							dest_p -> asv_count = src_p -> av_count;
+							dest_p -> asv_field = src_p -> av_field;
+						}
+				}
+			else
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to copy " UINT32_FMT " autocomplete values", builder_p -> ab_num_values);
+				}
+		}
+
+	return values_p;
+}
+
+
+static AutocompleteIndex *BuildAutocompleteIndexFromSnapshot (AutocompleteSnapshotValue *values_p, const uint32 num_values)
+{
+	AutocompleteIndex *index_p = (AutocompleteIndex *) AllocMemory (sizeof (AutocompleteIndex));
+
+	if (index_p)
+		{
+			size_t strings_size = 0;
+			uint32 i;
+
+			memset (index_p, 0, sizeof (AutocompleteIndex));
+
+			for (i = 0; i < num_values; ++ i)
+				{
+					strings_size += values_p [i].asv_key_length + 1 + strlen (values_p [i].asv_value_s) + 1;
+				}
+
+			if (strings_size <= 0xFFFFFFFFu)
+				{
+					index_p -> aci_strings_p = (char *) AllocMemory (strings_size > 0 ? strings_size : 1);
+
+					if (index_p -> aci_strings_p)
+						{
+							AutocompleteSnapshotValue **sorted_values_pp = NULL;
+							bool success_flag = true;
+							uint32 offset = 0;
+
+							for (i = 0; i < num_values; ++ i)
+								{
+									AutocompleteSnapshotValue *value_p = values_p + i;
+									const size_t value_length = strlen (value_p -> asv_value_s);
+
+									value_p -> asv_key_offset = offset;
+									memcpy (index_p -> aci_strings_p + offset, value_p -> asv_key_s, value_p -> asv_key_length + 1);
+									offset += value_p -> asv_key_length + 1;
+
+									value_p -> asv_value_offset = offset;
+									memcpy (index_p -> aci_strings_p + offset, value_p -> asv_value_s, value_length + 1);
+									offset += (uint32) value_length + 1;
+								}
+
+							if (num_values > 0)
+								{
+									sorted_values_pp = (AutocompleteSnapshotValue **) AllocMemory (num_values * sizeof (AutocompleteSnapshotValue *));
+									success_flag = (sorted_values_pp != NULL);
+								}
+
+							if (success_flag)
+								{
+									uint32 field;
+
+									for (i = 0; i < num_values; ++ i)
+										{
+											sorted_values_pp [i] = values_p + i;
+										}
+
+									/* This puts the values in order of field and then key */
+									if (num_values > 1)
+										{
+											qsort (sorted_values_pp, num_values, sizeof (AutocompleteSnapshotValue *), CompareAutocompleteSnapshotValues);
+										}
+
+									i = 0;
+
+									for (field = AF_TOWN; success_flag && (field < AF_NUM_FIELDS); ++ field)
+										{
+											uint32 field_end = i;
+
+											while ((field_end < num_values) && (sorted_values_pp [field_end] -> asv_field == (AutocompleteField) field))
+												{
+													++ field_end;
+												}
+
+											if (field_end > i)
+												{
+													success_flag = BuildAutocompleteTrie (index_p -> aci_tries + field, sorted_values_pp + i, field_end - i);
+												}
+
+											i = field_end;
+										}
+
+									if (sorted_values_pp)
+										{
+											FreeMemory (sorted_values_pp);
+										}
+
+									if (success_flag)
+										{
+											return index_p;
+										}
+								}
+						}
+				}
+
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to build autocomplete index for " UINT32_FMT " values", num_values);
+			FreeAutocompleteIndex (index_p);
+		}
+	else
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to allocate AutocompleteIndex");
+		}
+
+	return NULL;
+}
+
+
+static bool BuildAutocompleteTrie (AutocompleteTrie *trie_p, AutocompleteSnapshotValue **values_pp, const uint32 num_values)
+{
+	/* A radix trie has a node for each value and at most one fewer branching nodes, plus the root */
+	const uint32 max_nodes = (2 * num_values) + 1;
+
+	trie_p -> at_nodes_p = (AutocompleteNode *) AllocMemory (max_nodes * sizeof (AutocompleteNode));
+
+	if (trie_p -> at_nodes_p)
+		{
+			AutocompleteNode *root_p = trie_p -> at_nodes_p;
+			uint32 num_nodes = 1;
+
+			root_p -> an_label_offset = 0;
+			root_p -> an_label_length = 0;
+
+			BuildAutocompleteNode (trie_p -> at_nodes_p, &num_nodes, 0, values_pp, 0, num_values, 0);
+
+			trie_p -> at_num_nodes = num_nodes;
+
+			return true;
+		}
+
+	return false;
+}
+
+
+/*
+ * Fill in a node for the values from first up to last, which are sorted
+ * and all share the first depth characters of their keys.
+ */
+static void BuildAutocompleteNode (AutocompleteNode *nodes_p, uint32 *num_nodes_p, const uint32 node, AutocompleteSnapshotValue **values_pp, const uint32 first, const uint32 last, const uint32 depth)
+{
+	AutocompleteNode *node_p = nodes_p + node;
+	uint32 first_child;
+	uint32 num_children = 0;
+	uint32 best_count;
+	uint32 i = first;
+	uint32 j;
+
+	node_p -> an_count = 0;
+	node_p -> an_value_offset = 0;
+
+	/* The keys are unique so at most one of them ends here and it sorts first */
+	if (values_pp [i] -> asv_key_length == depth)
+		{
+			node_p -> an_count = values_pp [i] -> asv_count;
+			node_p -> an_value_offset = values_pp [i] -> asv_value_offset;
+			++ i;
+		}
+
+	best_count = node_p -> an_count;
+
+	/* Count the children, one for each different next character */
+	for (j = i; j < last; )
+		{
+			const char c = values_pp [j] -> asv_key_s [depth];
+
+			while ((j < last) && (values_pp [j] -> asv_key_s [depth] == c))
+				{
+					++ j;
+				}
+
+			++ num_children;
+		}
+
+	first_child = *num_nodes_p;
+	*num_nodes_p += num_children;
+
+	node_p -> an_first_child = first_child;
+	node_p -> an_num_children = (uint16) num_children;
+
+	num_children = 0;
+
+	while (i < last)
+		{
+			const AutocompleteSnapshotValue *first_value_p = values_pp [i];
+			const char c = first_value_p -> asv_key_s [depth];
+			const AutocompleteSnapshotValue *last_value_p;
+			AutocompleteNode *child_p = nodes_p + first_child + num_children;
+			uint32 group_end = i;
+			uint32 common_length = depth + 1;
+
+			while ((group_end < last) && (values_pp [group_end] -> asv_key_s [depth] == c))
+				{
+					++ group_end;
+				}
+
+			/* As the keys are sorted, the first and last share the prefix of the whole group */
+			last_value_p = values_pp [group_end - 1];
+
+			while ((common_length < first_value_p -> asv_key_length) && (common_length < last_value_p -> asv_key_length) && (first_value_p -> asv_key_s [common_length] == last_value_p -> asv_key_s [common_length]))
+				{
+					++ common_length;
+				}
+
+			child_p -> an_label_offset = first_value_p -> asv_key_offset + depth;
+			child_p -> an_label_length = (uint16) (common_length - depth);
+
+			BuildAutocompleteNode (nodes_p, num_nodes_p, first_child + num_children, values_pp, i, group_end, common_length);
+
+			if (nodes_p [first_child + num_children].an_best_count > best_count)
+				{
+					best_count = nodes_p [first_child + num_children].an_best_count;
+				}
+
+			++ num_children;
+			i = group_end;
+		}
+
+	/*
+	 * Moving the children is fine as each one's own children are found
+	 * by an_first_child rather than by where it is
+	 */
+	if (num_children > 1)
+		{
+			qsort (nodes_p + first_child, num_children, sizeof (AutocompleteNode), CompareAutocompleteNodes);
+		}
+
+	nodes_p [node].an_best_count = best_count;
+}
+
+
+/* Insert a suggestion into the list, which is kept in descending order of count */
+static void AddAutocompleteSuggestion (AutocompleteSuggestion *suggestions_p, uint32 *num_suggestions_p, const uint32 max_suggestions, const char *value_s, const uint32 count)
+{
+	uint32 i = *num_suggestions_p;
+
+	if (i == max_suggestions)
+		{
+			if (count <= suggestions_p [i - 1].as_count)
+				{
+					return;
+				}
+
+			-- i;
+		}
+	else
+		{
+			++ (*num_suggestions_p);
+		}
+
+	while ((i > 0) && (suggestions_p [i - 1].as_count < count))
+		{
+			suggestions_p [i] = suggestions_p [i - 1];
+			-- i;
+		}
+
+	suggestions_p [i].as_value_s = value_s;
+	suggestions_p [i].as_count = count;
+}
+
+
+/* Build new indexes until no more values have been added, then stop */
+static void RebuildAutocompleter (Autocompleter *autocompleter_p)
+{
+	bool loop_flag = true;
+
+	while (loop_flag)
+		{
+			AutocompleteSnapshotValue *values_p = NULL;
+			uint32 num_values = 0;
+			bool snapshot_flag = false;
+
+			LockAutocompleter (autocompleter_p);
+
+			if (autocompleter_p -> ac_dirty_flag)
+				{
+					num_values = autocompleter_p -> ac_builder_p -> ab_num_values;
+					values_p = GetAutocompleteSnapshot (autocompleter_p -> ac_builder_p);
+					snapshot_flag = (values_p != NULL) || (num_values == 0);
+
+					if (snapshot_flag)
+						{
+							autocompleter_p -> ac_dirty_flag = false;
+						}
+				}
+
+			if (!snapshot_flag)
+				{
+					autocompleter_p -> ac_sync_p -> as_active_flag = false;
+					loop_flag = false;
+				}
+
+			UnlockAutocompleter (autocompleter_p);
+
+			if (snapshot_flag)
+				{
+					AutocompleteIndex *index_p = BuildAutocompleteIndexFromSnapshot (values_p, num_values);
+
+					if (values_p)
+						{
+							FreeMemory (values_p);
+						}
+
+					if (index_p)
+						{
+							AutocompleteIndex *old_index_p;
+							bool free_flag;
+
+							LockAutocompleter (autocompleter_p);
+
+							old_index_p = autocompleter_p -> ac_index_p;
+							autocompleter_p -> ac_index_p = index_p;
+							old_index_p -> aci_retired_flag = true;
+							free_flag = (old_index_p -> aci_num_users == 0);
+
+							UnlockAutocompleter (autocompleter_p);
+
+							if (free_flag)
+								{
+									FreeAutocompleteIndex (old_index_p);
+								}
+						}
+					else
+						{
+							/* Try again next time */
+							LockAutocompleter (autocompleter_p);
+
+							autocompleter_p -> ac_dirty_flag = true;
+							autocompleter_p -> ac_sync_p -> as_active_flag = false;
+							loop_flag = false;
+
+							UnlockAutocompleter (autocompleter_p);
+						}
+				}
+		}
+}
+
+
+static void LockAutocompleter (Autocompleter *autocompleter_p)
+{
+#ifdef _WIN32
+	EnterCriticalSection (& (autocompleter_p -> ac_sync_p -> as_lock));
+#else
+	pthread_mutex_lock (& (autocompleter_p -> ac_sync_p -> as_lock));
+#endif
+}
+
+
+static void UnlockAutocompleter (Autocompleter *autocompleter_p)
+{
+#ifdef _WIN32
+	LeaveCriticalSection (& (autocompleter_p -> ac_sync_p -> as_lock));
+#else
+	pthread_mutex_unlock (& (autocompleter_p -> ac_sync_p -> as_lock));
+#endif
+}
+
+
+static void WaitForAutocompleterThread (AutocompleterSync *sync_p)
+{
+#ifdef _WIN32
+	WaitForSingleObject (sync_p -> as_thread, INFINITE);
+	CloseHandle (sync_p -> as_thread);
+#else
+	pthread_join (sync_p -> as_thread, NULL);
+#endif
+}
+
+
+#ifdef _WIN32
+static DWORD WINAPI RunAutocompleterThread (LPVOID data_p)
+{
+	RebuildAutocompleter ((Autocompleter *) data_p);
+	return 0;
+}
+#else
+static void *RunAutocompleterThread (void *data_p)
+{
+	RebuildAutocompleter ((Autocompleter *) data_p);
+	return NULL;
+}
+#endif
+
+
+static int CompareAutocompleteSnapshotValues (const void *v0_p, const void *v1_p)
+{
+	const AutocompleteSnapshotValue *value0_p = * ((const AutocompleteSnapshotValue * const *) v0_p);
+	const AutocompleteSnapshotValue *value1_p = * ((const AutocompleteSnapshotValue * const *) v1_p);
+
+	if (value0_p -> asv_field != value1_p -> asv_field)
+		{
+			return (value0_p -> asv_field < value1_p -> asv_field) ? -1 : 1;
+		}
+
+	/* The keys have no embedded NULs so this sorts a key before any that it is a prefix of */
+	return strcmp (value0_p -> asv_key_s, value1_p -> asv_key_s);
+}
+
+
+/* Sort the children with the highest counts first */
+static int CompareAutocompleteNodes (const void *v0_p, const void *v1_p)
+{
+	const AutocompleteNode *node0_p = (const AutocompleteNode *) v0_p;
+	const AutocompleteNode *node1_p = (const AutocompleteNode *) v1_p;
+
+	return (node0_p -> an_best_count > node1_p -> an_best_count) ? -1 : ((node0_p -> an_best_count < node1_p -> an_best_count) ? 1 : 0);
+}
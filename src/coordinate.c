@@ -10,6 +10,10 @@
 #include "memory_allocations.h"
 #include "streams.h"
 #include "json_util.h"
+#include "double_conversion.h"
+
+
+static bool GetCoordinateValueFromJSON (const json_t *json_p, const char * const key_s, double64 *value_p);
 
 
 Coordinate *AllocateCoordinate (double64 x, double64 y)
@@ -90,20 +94,20 @@ bool SetCoordinateFromCompoundJSON (Coordinate *coord_p, const json_t *value_p,
 bool SetCoordinateFromJSON (Coordinate *coord_p, const json_t *value_p)
 {
 	bool success_flag = false;
-	double latitude;
+	double64 latitude;
 
-	if (GetJSONReal (value_p, CO_LATITUDE_S, &latitude))
+	if (GetCoordinateValueFromJSON (value_p, CO_LATITUDE_S, &latitude))
 		{
-			double longitude;
+			double64 longitude;
 
-			if (GetJSONReal (value_p, CO_LONGITUDE_S, &longitude))
+			if (GetCoordinateValueFromJSON (value_p, CO_LONGITUDE_S, &longitude))
 				{
-					double elevation;
+					double64 elevation;
 
 					coord_p -> co_x = latitude;
 					coord_p -> co_y = longitude;
 
-					if (GetJSONReal (value_p, CO_ELEVATION_S, &elevation))
+					if (GetCoordinateValueFromJSON (value_p, CO_ELEVATION_S, &elevation))
 						{
 							if (SetCoordinateElevation (coord_p, elevation))
 								{
@@ -216,3 +220,28 @@ void ClearCoordinateElevation (Coordinate *coord_p)
 		}
 }
 
+
+/*
+ * Get a coordinate value from either a JSON number or a string
+ * containing one, as some sources store their coordinates as strings.
+ */
+static bool GetCoordinateValueFromJSON (const json_t *json_p, const char * const key_s, double64 *value_p)
+{
+	bool success_flag = false;
+	const json_t *value_json_p = json_object_get (json_p, key_s);
+
+	if (value_json_p)
+		{
+			if (json_is_number (value_json_p))
+				{
+					*value_p = json_number_value (value_json_p);
+					success_flag = true;
+				}
+			else if (json_is_string (value_json_p))
+				{
+					success_flag = ParseDouble (json_string_value (value_json_p), json_string_length (value_json_p), value_p);
+				}
+		}
+
+	return success_flag;
+}
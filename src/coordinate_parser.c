@@ -0,0 +1,504 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * coordinate_parser.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <math.h>
+
+#include "coordinate_parser.h"
+#include "double_conversion.h"
+
+
+/*
+ * The most tokens that two values of degrees, minutes and seconds with
+ * their marks, hemisphere letters and a separator can need.
+ */
+#define CP_MAX_TOKENS (16)
+
+
+typedef enum CoordinateTokenType
+{
+	CTT_NUMBER,
+	CTT_DEGREES,
+	CTT_MINUTES,
+	CTT_SECONDS,
+	CTT_HEMISPHERE,
+	CTT_SEPARATOR
+} CoordinateTokenType;
+
+
+typedef struct CoordinateToken
+{
+	CoordinateTokenType ct_type;
+
+	/* The value of a CTT_NUMBER */
+	double64 ct_value;
+
+	/* Whether a CTT_NUMBER has a sign or a fractional part */
+	bool ct_signed_flag;
+	bool ct_fraction_flag;
+
+	/* The letter of a CTT_HEMISPHERE, always in upper case */
+	char ct_hemisphere;
+} CoordinateToken;
+
+
+/* One of the two values, before it is known which is the latitude */
+typedef struct CoordinateComponent
+{
+	double64 cc_value;
+	char cc_hemisphere;
+	bool cc_marked_flag;
+	bool cc_minutes_flag;
+} CoordinateComponent;
+
+
+static size_t GetCoordinateTokens (const char *value_s, CoordinateToken *tokens_p);
+
+static const char *GetCoordinateMark (const char *value_s, CoordinateTokenType *type_p);
+
+static bool ParseCoordinateComponent (const CoordinateToken *tokens_p, const size_t num_tokens, size_t *index_p, CoordinateComponent *component_p);
+
+static bool IsEndedByHemisphere (const CoordinateToken *tokens_p, const size_t num_tokens, size_t index);
+
+static bool IsLetter (const char c);
+
+
+
+CoordinateStringFormat ParseCoordinateString (const char *value_s, double64 *latitude_p, double64 *longitude_p)
+{
+	CoordinateToken tokens [CP_MAX_TOKENS];
+	const size_t num_tokens = GetCoordinateTokens (value_s, tokens);
+
+	if (num_tokens > 0)
+		{
+			CoordinateComponent first;
+			CoordinateComponent second;
+			size_t i = 0;
+
+			if (ParseCoordinateComponent (tokens, num_tokens, &i, &first))
+				{
+					if ((i < num_tokens) && (tokens [i].ct_type == CTT_SEPARATOR))
+						{
+							++ i;
+						}
+
+					if (ParseCoordinateComponent (tokens, num_tokens, &i, &second) && (i == num_tokens))
+						{
+							const CoordinateComponent *latitude_component_p = &first;
+							const CoordinateComponent *longitude_component_p = &second;
+							const bool first_is_longitude_flag = (first.cc_hemisphere == 'E') || (first.cc_hemisphere == 'W');
+							const bool second_is_latitude_flag = (second.cc_hemisphere == 'N') || (second.cc_hemisphere == 'S');
+
+							if (first_is_longitude_flag || second_is_latitude_flag)
+								{
+									latitude_component_p = &second;
+									longitude_component_p = &first;
+								}
+
+							/* Both values can't be on the same axis */
+							if ((first_is_longitude_flag && ((second.cc_hemisphere == 'E') || (second.cc_hemisphere == 'W'))) ||
+								(second_is_latitude_flag && ((first.cc_hemisphere == 'N') || (first.cc_hemisphere == 'S'))))
+								{
+									return CSF_NONE;
+								}
+
+							if ((latitude_component_p -> cc_hemisphere == 'E') || (latitude_component_p -> cc_hemisphere == 'W') ||
+								(longitude_component_p -> cc_hemisphere == 'N') || (longitude_component_p -> cc_hemisphere == 'S'))
+								{
+									return CSF_NONE;
+								}
+
+							if ((fabs (latitude_component_p -> cc_value) <= 90.0) && (fabs (longitude_component_p -> cc_value) <= 180.0))
+								{
+									*latitude_p = latitude_component_p -> cc_value;
+									*longitude_p = longitude_component_p -> cc_value;
+
+									if (first.cc_minutes_flag || second.cc_minutes_flag)
+										{
+											return CSF_DEGREES_MINUTES_SECONDS;
+										}
+									else if (first.cc_hemisphere || second.cc_hemisphere)
+										{
+											return CSF_HEMISPHERE_DECIMAL;
+										}
+									else
+										{
+											return CSF_SIGNED_DECIMAL;
+										}
+								}
+						}
+				}
+		}
+
+	return CSF_NONE;
+}
+
+
+size_t ParseCoordinateStrings (const char * const *values_ss, const size_t num_values, Coordinate *coords_p)
+{
+	size_t num_parsed = 0;
+	size_t i;
+
+	for (i = 0; i < num_values; ++ i)
+		{
+			const char *value_s = * (values_ss + i);
+			Coordinate *coord_p = coords_p + i;
+
+			if (value_s && (ParseCoordinateString (value_s, & (coord_p -> co_x), & (coord_p -> co_y)) != CSF_NONE))
+				{
+					++ num_parsed;
+				}
+			else
+				{
+					coord_p -> co_x = NAN;
+					coord_p -> co_y = NAN;
+				}
+		}
+
+	return num_parsed;
+}
+
+
+/*
+ * Split the text into numbers, marks, hemisphere letters and separators,
+ * skipping any whitespace.
+ *
+ * Return the number of tokens or 0 if there is anything else in the text
+ * or too many tokens.
+ */
+static size_t GetCoordinateTokens (const char *value_s, CoordinateToken *tokens_p)
+{
+	size_t num_tokens = 0;
+
+	while (*value_s)
+		{
+			const char c = *value_s;
+			CoordinateToken *token_p = tokens_p + num_tokens;
+			CoordinateTokenType mark_type;
+			const char *mark_end_s;
+
+			if ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'))
+				{
+					++ value_s;
+					continue;
+				}
+
+			if (num_tokens == CP_MAX_TOKENS)
+				{
+					return 0;
+				}
+
+			if (((c >= '0') && (c <= '9')) || (c == '.') || (((c == '-') || (c == '+')) && (((* (value_s + 1) >= '0') && (* (value_s + 1) <= '9')) || (* (value_s + 1) == '.'))))
+				{
+					const char *start_s = value_s;
+					bool digits_flag = false;
+
+					token_p -> ct_signed_flag = ((c == '-') || (c == '+'));
+					token_p -> ct_fraction_flag = false;
+
+					if (token_p -> ct_signed_flag)
+						{
+							++ value_s;
+						}
+
+					while (((*value_s >= '0') && (*value_s <= '9')) || ((*value_s == '.') && (!token_p -> ct_fraction_flag)))
+						{
+							if (*value_s == '.')
+								{
+									token_p -> ct_fraction_flag = true;
+								}
+							else
+								{
+									digits_flag = true;
+								}
+
+							++ value_s;
+						}
+
+					if ((!digits_flag) || (!ParseDouble (start_s, value_s - start_s, & (token_p -> ct_value))))
+						{
+							return 0;
+						}
+
+					token_p -> ct_type = CTT_NUMBER;
+				}
+			else if ((mark_end_s = GetCoordinateMark (value_s, &mark_type)) != NULL)
+				{
+					token_p -> ct_type = mark_type;
+					value_s = mark_end_s;
+				}
+			else if ((c == ',') || (c == ';') || (c == '/'))
+				{
+					token_p -> ct_type = CTT_SEPARATOR;
+					++ value_s;
+				}
+			else
+				{
+					/* A hemisphere letter must be on its own, so words such as "Norwich" aren't mistaken for one */
+					const char upper_c = ((c >= 'a') && (c <= 'z')) ? (char) (c - 'a' + 'A') : c;
+
+					if (((upper_c == 'N') || (upper_c == 'S') || (upper_c == 'E') || (upper_c == 'W')) && (!IsLetter (* (value_s + 1))))
+						{
+							token_p -> ct_type = CTT_HEMISPHERE;
+							token_p -> ct_hemisphere = upper_c;
+							++ value_s;
+						}
+					else
+						{
+							return 0;
+						}
+				}
+
+			++ num_tokens;
+		}
+
+	return num_tokens;
+}
+
+
+/*
+ * If the text starts with a degree, minute or second mark, get its type
+ * and return the text after it, otherwise return NULL.
+ */
+static const char *GetCoordinateMark (const char *value_s, CoordinateTokenType *type_p)
+{
+	const unsigned char c0 = (unsigned char) *value_s;
+
+	switch (c0)
+		{
+			case '\'':
+				if (* (value_s + 1) == '\'')
+					{
+						*type_p = CTT_SECONDS;
+						return value_s + 2;
+					}
+
+				*type_p = CTT_MINUTES;
+				return value_s + 1;
+
+			case '"':
+				*type_p = CTT_SECONDS;
+				return value_s + 1;
+
+			/* ° and º in UTF-8 and ´ which is sometimes used for minutes */
+			case 0xC2:
+				{
+					const unsigned char c1 = (unsigned char) * (value_s + 1);
+
+					if ((c1 == 0xB0) || (c1 == 0xBA))
+						{
+							*type_p = CTT_DEGREES;
+							return value_s + 2;
+						}
+					else if (c1 == 0xB4)
+						{
+							*type_p = CTT_MINUTES;
+							return value_s + 2;
+						}
+				}
+				break;
+
+			/* ˚ in UTF-8 */
+			case 0xCB:
+				if ((unsigned char) * (value_s + 1) == 0x9A)
+					{
+						*type_p = CTT_DEGREES;
+						return value_s + 2;
+					}
+				break;
+
+			/* ’, ”, ′ and ″ in UTF-8 */
+			case 0xE2:
+				if ((unsigned char) * (value_s + 1) == 0x80)
+					{
+						const unsigned char c2 = (unsigned char) * (value_s + 2);
+
+						if ((c2 == 0x99) || (c2 == 0xB2))
+							{
+								*type_p = CTT_MINUTES;
+								return value_s + 3;
+							}
+						else if ((c2 == 0x9D) || (c2 == 0xB3))
+							{
+								*type_p = CTT_SECONDS;
+								return value_s + 3;
+							}
+					}
+				break;
+
+			/* A Latin-1 degree sign, which can't be part of a UTF-8 character here */
+			case 0xB0:
+			case 0xBA:
+				*type_p = CTT_DEGREES;
+				return value_s + 1;
+
+			default:
+				break;
+		}
+
+	return NULL;
+}
+
+
+/*
+ * Parse one of the two values starting at *index_p and move *index_p
+ * past it. A value is an optional hemisphere letter, then degrees and
+ * optionally minutes and seconds, and then a hemisphere letter if there
+ * wasn't one before.
+ */
+static bool ParseCoordinateComponent (const CoordinateToken *tokens_p, const size_t num_tokens, size_t *index_p, CoordinateComponent *component_p)
+{
+	static const double64 S_DIVISORS [3] = { 1.0, 60.0, 3600.0 };
+	size_t i = *index_p;
+	bool prefix_flag = false;
+	bool previous_marked_flag = false;
+	bool fraction_flag = false;
+	bool negative_flag = false;
+	bool signed_flag = false;
+	int previous_part = -1;
+	double64 value = 0.0;
+
+	component_p -> cc_hemisphere = '\0';
+	component_p -> cc_marked_flag = false;
+	component_p -> cc_minutes_flag = false;
+
+	if ((i < num_tokens) && (tokens_p [i].ct_type == CTT_HEMISPHERE))
+		{
+			component_p -> cc_hemisphere = tokens_p [i].ct_hemisphere;
+			prefix_flag = true;
+			++ i;
+		}
+
+	while ((i < num_tokens) && (tokens_p [i].ct_type == CTT_NUMBER))
+		{
+			const CoordinateToken *number_p = tokens_p + i;
+			bool marked_flag = false;
+			int part = previous_part + 1;
+
+			if ((i + 1 < num_tokens) && (tokens_p [i + 1].ct_type >= CTT_DEGREES) && (tokens_p [i + 1].ct_type <= CTT_SECONDS))
+				{
+					part = (int) (tokens_p [i + 1].ct_type - CTT_DEGREES);
+					marked_flag = true;
+				}
+
+			if (previous_part >= 0)
+				{
+					/*
+					 * A further number belongs to this value if it is a later part
+					 * and either the marks show that it is, or a hemisphere letter
+					 * ends this value so it can't be the start of the next one.
+					 */
+					if ((part <= previous_part) || (part > 2) || fraction_flag || number_p -> ct_signed_flag)
+						{
+							break;
+						}
+
+					if (!(marked_flag || previous_marked_flag || prefix_flag || IsEndedByHemisphere (tokens_p, num_tokens, i)))
+						{
+							break;
+						}
+
+					/* Minutes and seconds must be less than 60 */
+					if (number_p -> ct_value >= 60.0)
+						{
+							return false;
+						}
+				}
+			else
+				{
+					/* The value must start with its degrees */
+					if (part != 0)
+						{
+							return false;
+						}
+
+					signed_flag = number_p -> ct_signed_flag;
+					negative_flag = (number_p -> ct_value < 0.0) || (signed_flag && (number_p -> ct_value == 0.0) && signbit (number_p -> ct_value));
+				}
+
+			value += fabs (number_p -> ct_value) / S_DIVISORS [part];
+
+			fraction_flag = number_p -> ct_fraction_flag;
+			previous_marked_flag = marked_flag;
+			previous_part = part;
+
+			if (marked_flag)
+				{
+					component_p -> cc_marked_flag = true;
+					++ i;
+				}
+
+			if (part > 0)
+				{
+					component_p -> cc_minutes_flag = true;
+				}
+
+			++ i;
+		}
+
+	if (previous_part < 0)
+		{
+			return false;
+		}
+
+	if ((!prefix_flag) && (i < num_tokens) && (tokens_p [i].ct_type == CTT_HEMISPHERE))
+		{
+			component_p -> cc_hemisphere = tokens_p [i].ct_hemisphere;
+			++ i;
+		}
+
+	if (component_p -> cc_hemisphere)
+		{
+			/* "-52 S" is ambiguous so don't allow a sign and a hemisphere together */
+			if (signed_flag)
+				{
+					return false;
+				}
+
+			negative_flag = (component_p -> cc_hemisphere == 'S') || (component_p -> cc_hemisphere == 'W');
+		}
+
+	component_p -> cc_value = negative_flag ? -value : value;
+	*index_p = i;
+
+	return true;
+}
+
+
+/*
+ * Check whether the numbers and marks starting at index are followed
+ * by a hemisphere letter.
+ */
+static bool IsEndedByHemisphere (const CoordinateToken *tokens_p, const size_t num_tokens, size_t index)
+{
+	while ((index < num_tokens) && (tokens_p [index].ct_type <= CTT_SECONDS))
+		{
+			++ index;
+		}
+
+	return ((index < num_tokens) && (tokens_p [index].ct_type == CTT_HEMISPHERE));
+}
+
+
+static bool IsLetter (const char c)
+{
+	return (((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')));
+}
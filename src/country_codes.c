@@ -792,8 +792,270 @@ static const char *s_country_codes_p [] =
 };
 
 
+/*
+ * The approximate centre and bounds of each country, sorted by code.
+ * "Country code", centre latitude, centre longitude, south, west, north, east.
+ * Where the west edge is greater than the east edge, the country crosses
+ * the antimeridian.
+ */
+static const CountryLocation s_country_locations_p [S_NUM_COUNTRIES] =
+{
+	{ "AD", 42.55, 1.58, 42.43, 1.41, 42.66, 1.79 },
+	{ "AE", 23.90, 54.30, 22.63, 51.58, 26.08, 56.38 },
+	{ "AF", 33.94, 67.71, 29.38, 60.50, 38.49, 74.89 },
+	{ "AG", 17.08, -61.80, 16.99, -62.35, 17.73, -61.66 },
+	{ "AI", 18.22, -63.05, 18.15, -63.43, 18.60, -62.92 },
+	{ "AL", 41.15, 20.17, 39.64, 19.26, 42.66, 21.06 },
+	{ "AM", 40.07, 45.04, 38.84, 43.45, 41.30, 46.63 },
+	{ "AO", -11.20, 17.87, -18.04, 11.68, -4.37, 24.08 },
+	{ "AQ", -82.86, 0.00, -90.00, -180.00, -60.50, 180.00 },
+	{ "AR", -38.42, -63.62, -55.06, -73.58, -21.78, -53.59 },
+	{ "AS", -14.30, -170.70, -14.60, -171.14, -11.05, -168.14 },
+	{ "AT", 47.52, 14.55, 46.37, 9.53, 49.02, 17.16 },
+	{ "AU", -25.27, 133.78, -43.64, 112.92, -10.06, 153.64 },
+	{ "AW", 12.52, -69.97, 12.41, -70.07, 12.63, -69.87 },
+	{ "AX", 60.18, 19.92, 59.90, 19.30, 60.50, 21.10 },
+	{ "AZ", 40.14, 47.58, 38.39, 44.77, 41.91, 50.39 },
+	{ "BA", 43.92, 17.68, 42.56, 15.72, 45.28, 19.62 },
+	{ "BB", 13.19, -59.54, 13.04, -59.65, 13.34, -59.42 },
+	{ "BD", 23.68, 90.36, 20.74, 88.01, 26.63, 92.67 },
+	{ "BE", 50.50, 4.47, 49.50, 2.54, 51.51, 6.41 },
+	{ "BF", 12.24, -1.56, 9.40, -5.52, 15.08, 2.41 },
+	{ "BG", 42.73, 25.49, 41.24, 22.36, 44.22, 28.61 },
+	{ "BH", 26.07, 50.56, 25.79, 50.38, 26.33, 50.82 },
+	{ "BI", -3.37, 29.92, -4.47, 29.00, -2.31, 30.85 },
+	{ "BJ", 9.31, 2.32, 6.14, 0.77, 12.41, 3.85 },
+	{ "BL", 17.90, -62.83, 17.87, -62.95, 17.97, -62.78 },
+	{ "BM", 32.32, -64.76, 32.24, -64.89, 32.39, -64.64 },
+	{ "BN", 4.54, 114.73, 4.00, 114.07, 5.05, 115.36 },
+	{ "BO", -16.29, -63.59, -22.90, -69.64, -9.68, -57.45 },
+	{ "BQ", 12.18, -68.26, 12.02, -68.42, 17.65, -62.94 },
+	{ "BR", -14.24, -51.93, -33.75, -73.99, 5.27, -28.85 },
+	{ "BS", 25.03, -77.40, 20.91, -79.30, 27.27, -72.71 },
+	{ "BT", 27.51, 90.43, 26.70, 88.75, 28.36, 92.13 },
+	{ "BV", -54.42, 3.41, -54.46, 3.33, -54.38, 3.48 },
+	{ "BW", -22.33, 24.68, -26.91, 19.99, -17.78, 29.38 },
+	{ "BY", 53.71, 27.95, 51.26, 23.18, 56.17, 32.78 },
+	{ "BZ", 17.19, -88.50, 15.89, -89.23, 18.50, -87.49 },
+	{ "CA", 56.13, -106.35, 41.68, -141.00, 83.11, -52.62 },
+	{ "CC", -12.16, 96.87, -12.21, 96.81, -11.82, 96.93 },
+	{ "CD", -4.04, 21.76, -13.46, 12.18, 5.39, 31.31 },
+	{ "CF", 6.61, 20.94, 2.22, 14.42, 11.01, 27.46 },
+	{ "CG", -0.23, 15.83, -5.03, 11.09, 3.70, 18.65 },
+	{ "CH", 46.82, 8.23, 45.82, 5.96, 47.81, 10.49 },
+	{ "CI", 7.54, -5.55, 4.36, -8.60, 10.74, -2.49 },
+	{ "CK", -21.24, -159.78, -21.96, -165.85, -8.95, -157.31 },
+	{ "CL", -35.68, -71.54, -55.98, -109.45, -17.50, -66.42 },
+	{ "CM", 7.37, 12.35, 1.65, 8.49, 13.08, 16.19 },
+	{ "CN", 35.86, 104.20, 18.16, 73.50, 53.56, 134.77 },
+	{ "CO", 4.57, -74.30, -4.23, -81.73, 13.39, -66.85 },
+	{ "CR", 9.75, -83.75, 5.49, -87.10, 11.22, -82.55 },
+	{ "CU", 21.52, -77.78, 19.83, -84.95, 23.27, -74.13 },
+	{ "CV", 16.00, -24.01, 14.80, -25.36, 17.21, -22.66 },
+	{ "CW", 12.17, -68.99, 12.03, -69.16, 12.39, -68.64 },
+	{ "CX", -10.49, 105.62, -10.57, 105.53, -10.41, 105.71 },
+	{ "CY", 35.13, 33.43, 34.56, 32.27, 35.71, 34.60 },
+	{ "CZ", 49.82, 15.47, 48.55, 12.09, 51.06, 18.86 },
+	{ "DE", 51.17, 10.45, 47.27, 5.87, 55.06, 15.04 },
+	{ "DJ", 11.83, 42.59, 10.93, 41.77, 12.71, 43.42 },
+	{ "DK", 56.26, 9.50, 54.56, 8.07, 57.75, 15.20 },
+	{ "DM", 15.41, -61.37, 15.20, -61.48, 15.64, -61.24 },
+	{ "DO", 18.74, -70.16, 17.47, -72.01, 19.93, -68.32 },
+	{ "DZ", 28.03, 1.66, 18.96, -8.67, 37.09, 11.98 },
+	{ "EC", -1.83, -78.18, -5.01, -92.01, 1.68, -75.19 },
+	{ "EE", 58.60, 25.01, 57.52, 21.76, 59.68, 28.21 },
+	{ "EG", 26.82, 30.80, 22.00, 24.70, 31.67, 36.90 },
+	{ "EH", 24.22, -12.89, 20.77, -17.10, 27.67, -8.67 },
+	{ "ER", 15.18, 39.78, 12.36, 36.44, 18.00, 43.14 },
+	{ "ES", 40.46, -3.75, 27.64, -18.16, 43.79, 4.33 },
+	{ "ET", 9.15, 40.49, 3.40, 32.99, 14.89, 47.99 },
+	{ "FI", 61.92, 25.75, 59.81, 20.55, 70.09, 31.59 },
+	{ "FJ", -16.58, 179.41, -20.68, 176.90, -12.48, -178.20 },
+	{ "FK", -51.80, -59.52, -52.41, -61.35, -51.24, -57.71 },
+	{ "FM", 7.43, 150.55, 0.91, 137.33, 10.09, 163.04 },
+	{ "FO", 61.89, -6.91, 61.39, -7.69, 62.40, -6.26 },
+	{ "FR", 46.23, 2.21, 41.33, -5.14, 51.09, 9.56 },
+	{ "GA", -0.80, 11.61, -3.98, 8.70, 2.32, 14.50 },
+	{ "GB", 55.38, -3.44, 49.86, -8.65, 60.86, 1.77 },
+	{ "GD", 12.26, -61.60, 11.98, -61.80, 12.53, -61.38 },
+	{ "GE", 42.32, 43.36, 41.05, 40.01, 43.59, 46.74 },
+	{ "GF", 3.93, -53.13, 2.11, -54.60, 5.78, -51.63 },
+	{ "GG", 49.47, -2.59, 49.40, -2.68, 49.73, -2.17 },
+	{ "GH", 7.95, -1.02, 4.74, -3.26, 11.17, 1.20 },
+	{ "GI", 36.14, -5.35, 36.11, -5.37, 36.16, -5.34 },
+	{ "GL", 71.71, -42.60, 59.78, -73.30, 83.63, -11.31 },
+	{ "GM", 13.44, -15.31, 13.06, -16.83, 13.83, -13.80 },
+	{ "GN", 9.95, -9.70, 7.19, -15.08, 12.68, -7.64 },
+	{ "GP", 16.27, -61.55, 15.83, -61.81, 16.52, -61.00 },
+	{ "GQ", 1.65, 10.27, -1.47, 5.61, 3.79, 11.34 },
+	{ "GR", 39.07, 21.82, 34.80, 19.37, 41.75, 29.65 },
+	{ "GS", -54.43, -36.59, -59.48, -38.28, -53.97, -26.24 },
+	{ "GT", 15.78, -90.23, 13.74, -92.23, 17.82, -88.22 },
+	{ "GU", 13.44, 144.79, 13.24, 144.62, 13.65, 144.96 },
+	{ "GW", 11.80, -15.18, 10.86, -16.72, 12.69, -13.64 },
+	{ "GY", 4.86, -58.93, 1.17, -61.40, 8.56, -56.48 },
+	{ "HK", 22.32, 114.17, 22.15, 113.83, 22.56, 114.41 },
+	{ "HM", -53.08, 73.50, -53.20, 72.58, -52.91, 73.87 },
+	{ "HN", 15.20, -86.24, 12.98, -89.36, 17.42, -83.13 },
+	{ "HR", 45.10, 15.20, 42.39, 13.49, 46.56, 19.45 },
+	{ "HT", 18.97, -72.29, 18.02, -74.48, 20.09, -71.62 },
+	{ "HU", 47.16, 19.50, 45.74, 16.11, 48.59, 22.90 },
+	{ "ID", -0.79, 113.92, -11.01, 95.01, 6.08, 141.02 },
+	{ "IE", 53.41, -8.24, 51.42, -10.67, 55.39, -5.99 },
+	{ "IL", 31.05, 34.85, 29.49, 34.27, 33.33, 35.90 },
+	{ "IM", 54.24, -4.55, 54.04, -4.83, 54.42, -4.31 },
+	{ "IN", 20.59, 78.96, 6.75, 68.11, 35.67, 97.40 },
+	{ "IO", -6.34, 71.88, -7.43, 71.26, -5.22, 72.49 },
+	{ "IQ", 33.22, 43.68, 29.06, 38.79, 37.38, 48.57 },
+	{ "IR", 32.43, 53.69, 25.06, 44.03, 39.78, 63.33 },
+	{ "IS", 64.96, -19.02, 63.30, -24.55, 66.57, -13.49 },
+	{ "IT", 41.87, 12.57, 35.49, 6.63, 47.09, 18.52 },
+	{ "JE", 49.21, -2.13, 49.16, -2.26, 49.27, -2.01 },
+	{ "JM", 18.11, -77.30, 17.70, -78.37, 18.53, -76.18 },
+	{ "JO", 30.59, 36.24, 29.19, 34.96, 33.37, 39.30 },
+	{ "JP", 36.20, 138.25, 20.42, 122.93, 45.56, 153.99 },
+	{ "KE", -0.02, 37.91, -4.68, 33.91, 5.02, 41.91 },
+	{ "KG", 41.20, 74.77, 39.17, 69.25, 43.24, 80.28 },
+	{ "KH", 12.57, 104.99, 10.41, 102.34, 14.69, 107.63 },
+	{ "KI", -3.37, -168.73, -11.45, 169.53, 4.72, -150.21 },
+	{ "KM", -11.88, 43.87, -12.42, 43.22, -11.36, 44.54 },
+	{ "KN", 17.36, -62.78, 17.09, -62.87, 17.42, -62.54 },
+	{ "KP", 40.34, 127.51, 37.67, 124.18, 43.01, 130.70 },
+	{ "KR", 35.91, 127.77, 33.11, 124.61, 38.61, 131.87 },
+	{ "KW", 29.31, 47.48, 28.52, 46.55, 30.10, 48.43 },
+	{ "KY", 19.31, -81.25, 19.26, -81.42, 19.76, -79.72 },
+	{ "KZ", 48.02, 66.92, 40.57, 46.49, 55.44, 87.32 },
+	{ "LA", 19.86, 102.50, 13.91, 100.08, 22.50, 107.64 },
+	{ "LB", 33.85, 35.86, 33.05, 35.10, 34.69, 36.62 },
+	{ "LC", 13.91, -60.98, 13.71, -61.08, 14.11, -60.87 },
+	{ "LI", 47.17, 9.56, 47.05, 9.47, 47.27, 9.64 },
+	{ "LK", 7.87, 80.77, 5.92, 79.52, 9.84, 81.88 },
+	{ "LR", 6.43, -9.43, 4.35, -11.49, 8.55, -7.37 },
+	{ "LS", -29.61, 28.23, -30.68, 27.01, -28.57, 29.46 },
+	{ "LT", 55.17, 23.88, 53.90, 20.94, 56.45, 26.84 },
+	{ "LU", 49.82, 6.13, 49.45, 5.73, 50.18, 6.53 },
+	{ "LV", 56.88, 24.60, 55.67, 20.97, 58.09, 28.24 },
+	{ "LY", 26.34, 17.23, 19.50, 9.39, 33.17, 25.15 },
+	{ "MA", 31.79, -7.09, 27.66, -13.17, 35.92, -0.99 },
+	{ "MC", 43.74, 7.42, 43.72, 7.41, 43.75, 7.44 },
+	{ "MD", 47.41, 28.37, 45.47, 26.62, 48.49, 30.13 },
+	{ "ME", 42.71, 19.37, 41.85, 18.43, 43.56, 20.36 },
+	{ "MF", 18.08, -63.05, 18.05, -63.15, 18.13, -62.97 },
+	{ "MG", -18.77, 46.87, -25.61, 43.22, -11.95, 50.48 },
+	{ "MH", 7.13, 171.18, 4.57, 160.80, 14.67, 172.17 },
+	{ "MK", 41.61, 21.75, 40.85, 20.45, 42.37, 23.03 },
+	{ "ML", 17.57, -4.00, 10.16, -12.24, 25.00, 4.27 },
+	{ "MM", 21.91, 95.96, 9.78, 92.17, 28.55, 101.17 },
+	{ "MN", 46.86, 103.85, 41.58, 87.75, 52.15, 119.93 },
+	{ "MO", 22.20, 113.54, 22.11, 113.53, 22.22, 113.60 },
+	{ "MP", 15.10, 145.67, 14.11, 144.89, 20.55, 146.07 },
+	{ "MQ", 14.64, -61.02, 14.39, -61.23, 14.88, -60.81 },
+	{ "MR", 21.01, -10.94, 14.72, -17.07, 27.30, -4.83 },
+	{ "MS", 16.74, -62.19, 16.67, -62.24, 16.82, -62.14 },
+	{ "MT", 35.94, 14.38, 35.79, 14.18, 36.08, 14.58 },
+	{ "MU", -20.35, 57.55, -20.53, 56.51, -10.32, 63.50 },
+	{ "MV", 3.20, 73.22, -0.69, 72.64, 7.11, 73.76 },
+	{ "MW", -13.25, 34.30, -17.13, 32.67, -9.37, 35.92 },
+	{ "MX", 23.63, -102.55, 14.53, -118.40, 32.72, -86.71 },
+	{ "MY", 4.21, 101.98, 0.85, 99.64, 7.36, 119.27 },
+	{ "MZ", -18.67, 35.53, -26.87, 30.22, -10.47, 40.84 },
+	{ "NA", -22.96, 18.49, -28.97, 11.72, -16.96, 25.26 },
+	{ "NC", -20.90, 165.62, -22.70, 163.57, -19.55, 168.14 },
+	{ "NE", 17.61, 8.08, 11.69, 0.16, 23.53, 16.00 },
+	{ "NF", -29.04, 167.95, -29.14, 167.91, -28.99, 168.00 },
+	{ "NG", 9.08, 8.68, 4.27, 2.67, 13.89, 14.68 },
+	{ "NI", 12.87, -85.21, 10.71, -87.69, 15.03, -82.72 },
+	{ "NL", 52.13, 5.29, 50.75, 3.36, 53.56, 7.23 },
+	{ "NO", 60.47, 8.47, 57.96, 4.65, 71.19, 31.17 },
+	{ "NP", 28.39, 84.12, 26.35, 80.06, 30.45, 88.20 },
+	{ "NR", -0.52, 166.93, -0.55, 166.90, -0.50, 166.96 },
+	{ "NU", -19.05, -169.87, -19.15, -169.95, -18.95, -169.78 },
+	{ "NZ", -40.90, 174.89, -52.62, 166.43, -34.39, -176.17 },
+	{ "OM", 21.51, 55.92, 16.65, 52.00, 26.40, 59.84 },
+	{ "PA", 8.54, -80.78, 7.20, -83.05, 9.65, -77.16 },
+	{ "PE", -9.19, -75.02, -18.35, -81.33, -0.04, -68.65 },
+	{ "PF", -17.68, -149.41, -27.65, -154.70, -7.90, -134.45 },
+	{ "PG", -6.31, 143.96, -11.66, 140.84, -0.87, 159.49 },
+	{ "PH", 12.88, 121.77, 4.59, 116.93, 21.12, 126.60 },
+	{ "PK", 30.38, 69.35, 23.69, 60.87, 37.08, 77.84 },
+	{ "PL", 51.92, 19.15, 49.00, 14.12, 54.84, 24.15 },
+	{ "PM", 46.94, -56.27, 46.75, -56.41, 47.15, -56.12 },
+	{ "PN", -24.70, -127.44, -25.08, -130.75, -23.92, -124.77 },
+	{ "PR", 18.22, -66.59, 17.88, -67.95, 18.52, -65.22 },
+	{ "PS", 31.95, 35.23, 31.22, 34.22, 32.55, 35.57 },
+	{ "PT", 39.40, -8.22, 30.03, -31.28, 42.15, -6.19 },
+	{ "PW", 7.51, 134.58, 2.80, 131.12, 8.10, 134.73 },
+	{ "PY", -23.44, -58.44, -27.61, -62.64, -19.29, -54.26 },
+	{ "QA", 25.35, 51.18, 24.47, 50.75, 26.18, 51.64 },
+	{ "RE", -21.12, 55.54, -21.39, 55.22, -20.87, 55.84 },
+	{ "RO", 45.94, 24.97, 43.62, 20.26, 48.27, 29.74 },
+	{ "RS", 44.02, 21.01, 41.86, 18.82, 46.19, 23.01 },
+	{ "RU", 61.52, 105.32, 41.19, 19.64, 81.86, -169.05 },
+	{ "RW", -1.94, 29.87, -2.84, 28.86, -1.05, 30.90 },
+	{ "SA", 23.89, 45.08, 16.38, 34.49, 32.16, 55.67 },
+	{ "SB", -9.65, 160.16, -11.85, 155.51, -6.59, 170.20 },
+	{ "SC", -4.68, 55.49, -10.23, 46.20, -3.71, 56.29 },
+	{ "SD", 12.86, 30.22, 8.69, 21.81, 22.23, 38.61 },
+	{ "SE", 60.13, 18.64, 55.34, 11.11, 69.06, 24.17 },
+	{ "SG", 1.35, 103.82, 1.16, 103.60, 1.47, 104.09 },
+	{ "SH", -15.96, -5.71, -40.38, -14.42, -7.88, -5.64 },
+	{ "SI", 46.15, 14.99, 45.42, 13.38, 46.88, 16.61 },
+	{ "SJ", 77.55, 23.67, 70.83, -9.08, 80.83, 33.64 },
+	{ "SK", 48.67, 19.70, 47.73, 16.83, 49.61, 22.57 },
+	{ "SL", 8.46, -11.78, 6.92, -13.30, 10.00, -10.27 },
+	{ "SM", 43.94, 12.46, 43.89, 12.40, 43.99, 12.52 },
+	{ "SN", 14.50, -14.45, 12.31, -17.54, 16.69, -11.35 },
+	{ "SO", 5.15, 46.20, -1.66, 40.99, 11.99, 51.41 },
+	{ "SR", 3.92, -56.03, 1.83, -58.09, 6.01, -53.98 },
+	{ "SS", 6.88, 31.31, 3.49, 24.15, 12.24, 35.95 },
+	{ "ST", 0.19, 6.61, -0.01, 6.46, 1.70, 7.47 },
+	{ "SV", 13.79, -88.90, 13.15, -90.13, 14.45, -87.69 },
+	{ "SX", 18.04, -63.07, 18.01, -63.14, 18.07, -63.01 },
+	{ "SY", 34.80, 38.99, 32.31, 35.72, 37.32, 42.38 },
+	{ "SZ", -26.52, 31.47, -27.32, 30.79, -25.72, 32.14 },
+	{ "TC", 21.69, -71.80, 21.18, -72.48, 21.96, -71.08 },
+	{ "TD", 15.45, 18.73, 7.44, 13.47, 23.45, 24.00 },
+	{ "TF", -49.28, 69.35, -50.02, 39.70, -11.50, 77.60 },
+	{ "TG", 8.62, 0.82, 6.10, -0.15, 11.14, 1.81 },
+	{ "TH", 15.87, 100.99, 5.61, 97.34, 20.46, 105.64 },
+	{ "TJ", 38.86, 71.28, 36.67, 67.34, 41.04, 75.15 },
+	{ "TK", -9.20, -171.85, -9.44, -172.52, -8.53, -171.18 },
+	{ "TL", -8.87, 125.73, -9.50, 124.04, -8.13, 127.34 },
+	{ "TM", 38.97, 59.56, 35.13, 52.44, 42.80, 66.71 },
+	{ "TN", 33.89, 9.54, 30.23, 7.52, 37.54, 11.60 },
+	{ "TO", -21.18, -175.20, -22.35, -176.22, -15.56, -173.70 },
+	{ "TR", 38.96, 35.24, 35.82, 25.67, 42.11, 44.82 },
+	{ "TT", 10.69, -61.22, 10.04, -61.93, 11.36, -60.49 },
+	{ "TV", -7.11, 177.65, -10.80, 176.06, -5.64, 179.87 },
+	{ "TW", 23.70, 120.96, 21.90, 118.20, 26.39, 122.01 },
+	{ "TZ", -6.37, 34.89, -11.75, 29.34, -0.98, 40.45 },
+	{ "UA", 48.38, 31.17, 44.39, 22.14, 52.38, 40.23 },
+	{ "UG", 1.37, 32.29, -1.48, 29.57, 4.23, 35.04 },
+	{ "UM", 16.73, -169.53, -0.38, 166.60, 28.22, -74.99 },
+	{ "US", 37.09, -95.71, 18.91, 172.44, 71.39, -66.95 },
+	{ "UY", -32.52, -55.77, -34.97, -58.44, -30.09, -53.07 },
+	{ "UZ", 41.38, 64.59, 37.18, 55.99, 45.59, 73.13 },
+	{ "VA", 41.90, 12.45, 41.90, 12.45, 41.91, 12.46 },
+	{ "VC", 12.98, -61.29, 12.58, -61.46, 13.38, -61.11 },
+	{ "VE", 6.42, -66.59, 0.65, -73.35, 15.70, -59.80 },
+	{ "VG", 18.42, -64.64, 18.31, -64.85, 18.76, -64.27 },
+	{ "VI", 18.34, -64.90, 17.67, -65.09, 18.42, -64.56 },
+	{ "VN", 14.06, 108.28, 8.38, 102.14, 23.39, 109.47 },
+	{ "VU", -15.38, 166.96, -20.25, 166.52, -13.07, 170.24 },
+	{ "WF", -13.77, -177.16, -14.36, -178.20, -13.21, -176.12 },
+	{ "WS", -13.76, -172.10, -14.08, -172.80, -13.43, -171.40 },
+	{ "YE", 15.55, 48.52, 12.11, 41.81, 19.00, 54.54 },
+	{ "YT", -12.83, 45.17, -13.00, 45.01, -12.63, 45.30 },
+	{ "ZA", -30.56, 22.94, -34.84, 16.45, -22.13, 32.89 },
+	{ "ZM", -13.13, 27.85, -18.08, 21.99, -8.20, 33.71 },
+	{ "ZW", -19.02, 29.15, -22.42, 25.24, -15.61, 33.06 }
+};
+
+
 static int CompareCountriesByName (const void *v0_p, const void  *v1_p);
 
+static int CompareCountryLocations (const void *v0_p, const void  *v1_p);
+
 static int CompareCountryCodeStrings (const void *v0_p, const void  *v1_p);
 
 
@@ -846,6 +1108,37 @@ bool IsValidCountryCode (const char * const code_s)
 }
 
 
+const CountryLocation *GetCountryLocation (const char * const country_code_s)
+{
+	CountryLocation key;
+
+	memset (&key, 0, sizeof (CountryLocation));
+	key.cl_code_s = country_code_s;
+
+	return (const CountryLocation *) bsearch (&key, s_country_locations_p, S_NUM_COUNTRIES, sizeof (CountryLocation), CompareCountryLocations);
+}
+
+
+uint32 GetNumberOfCountries (void)
+{
+	return S_NUM_COUNTRIES;
+}
+
+
+bool GetCountryByIndex (const uint32 i, const char **name_ss, const char **code_ss)
+{
+	if (i < S_NUM_COUNTRIES)
+		{
+			*name_ss = s_countries_by_name_p [i].cc_name_s;
+			*code_ss = s_countries_by_name_p [i].cc_code_s;
+
+			return true;
+		}
+
+	return false;
+}
+
+
 static int CompareCountriesByName (const void *v0_p, const void  *v1_p)
 {
 	const CountryCode * const country0_p = (const CountryCode * const) v0_p;
@@ -864,4 +1157,10 @@ static int CompareCountryCodeStrings (const void *v0_p, const void  *v1_p)
 }
 
 
+static int CompareCountryLocations (const void *v0_p, const void  *v1_p)
+{
+	const CountryLocation * const location0_p = (const CountryLocation * const) v0_p;
+	const CountryLocation * const location1_p = (const CountryLocation * const) v1_p;
 
+	return Stricmp (location0_p -> cl_code_s, location1_p -> cl_code_s);
+}
@@ -0,0 +1,445 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * elevation.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "elevation.h"
+
+#include "memory_allocations.h"
+#include "streams.h"
+#include "string_utils.h"
+
+
+/* The space needed for a tile's filename, e.g. "/N51W001.hgt" */
+#define EL_TILE_NAME_SIZE (16)
+
+/* The key for Coordinates that aren't on any tile, so they are sorted after all of the others */
+#define EL_NO_TILE (0x7FFFFFFF)
+
+
+typedef struct TileQuery
+{
+	int32 tq_key;
+	size_t tq_index;
+} TileQuery;
+
+
+static bool GetTileIndices (const double64 latitude, const double64 longitude, int32 *tile_latitude_p, int32 *tile_longitude_p);
+
+static ElevationTile *GetTile (ElevationEngine *engine_p, const int32 tile_latitude, const int32 tile_longitude);
+
+static bool MapTile (ElevationEngine *engine_p, ElevationTile *tile_p);
+
+static void UnmapTile (ElevationTile *tile_p);
+
+static int16 GetTileHeight (const ElevationTile *tile_p, const uint32 row, const uint32 column);
+
+static int CompareTileQueries (const void *v0_p, const void *v1_p);
+
+
+
+ElevationEngine *AllocateElevationEngine (const char *directory_s, const uint32 max_tiles)
+{
+	char *copied_directory_s = EasyCopyToNewString (directory_s);
+
+	if (copied_directory_s)
+		{
+			const uint32 num_tiles = (max_tiles > 0) ? max_tiles : ELEVATION_DEFAULT_MAX_TILES;
+			ElevationTile *tiles_p = (ElevationTile *) AllocMemoryArray (num_tiles, sizeof (ElevationTile));
+
+			if (tiles_p)
+				{
+					ElevationEngine *engine_p = (ElevationEngine *) AllocMemory (sizeof (ElevationEngine));
+
+					if (engine_p)
+						{
+							engine_p -> ee_directory_s = copied_directory_s;
+							engine_p -> ee_tiles_p = tiles_p;
+							engine_p -> ee_num_tiles = 0;
+							engine_p -> ee_max_tiles = num_tiles;
+							engine_p -> ee_last_tile_p = NULL;
+							engine_p -> ee_clock = 0;
+
+							return engine_p;
+						}
+
+					FreeMemory (tiles_p);
+				}
+
+			FreeCopiedString (copied_directory_s);
+		}
+
+	return NULL;
+}
+
+
+void FreeElevationEngine (ElevationEngine *engine_p)
+{
+	uint32 i;
+
+	for (i = 0; i < engine_p -> ee_num_tiles; ++ i)
+		{
+			UnmapTile (engine_p -> ee_tiles_p + i);
+		}
+
+	FreeMemory (engine_p -> ee_tiles_p);
+	FreeCopiedString (engine_p -> ee_directory_s);
+	FreeMemory (engine_p);
+}
+
+
+bool GetElevation (ElevationEngine *engine_p, const double64 latitude, const double64 longitude, double64 *elevation_p)
+{
+	int32 tile_latitude;
+	int32 tile_longitude;
+
+	if (GetTileIndices (latitude, longitude, &tile_latitude, &tile_longitude))
+		{
+			const ElevationTile *tile_p = GetTile (engine_p, tile_latitude, tile_longitude);
+
+			if (tile_p && (tile_p -> et_found_flag))
+				{
+					const uint32 last_sample = tile_p -> et_num_samples - 1;
+
+					/* The rows go from the northern edge to the southern one */
+					const double64 row = ((double64) (tile_latitude + 1) - latitude) * last_sample;
+					const double64 column = (longitude - (double64) tile_longitude) * last_sample;
+					uint32 row0 = (uint32) row;
+					uint32 column0 = (uint32) column;
+					double64 row_fraction;
+					double64 column_fraction;
+					double64 weights [4];
+					int16 heights [4];
+					double64 total = 0.0;
+					double64 total_weight = 0.0;
+					int i;
+
+					/* Points on the tile's southern or eastern edges use its last row or column */
+					if (row0 >= last_sample)
+						{
+							row0 = last_sample - 1;
+						}
+
+					if (column0 >= last_sample)
+						{
+							column0 = last_sample - 1;
+						}
+
+					row_fraction = row - row0;
+					column_fraction = column - column0;
+
+					heights [0] = GetTileHeight (tile_p, row0, column0);
+					heights [1] = GetTileHeight (tile_p, row0, column0 + 1);
+					heights [2] = GetTileHeight (tile_p, row0 + 1, column0);
+					heights [3] = GetTileHeight (tile_p, row0 + 1, column0 + 1);
+
+					weights [0] = (1.0 - row_fraction) * (1.0 - column_fraction);
+					weights [1] = (1.0 - row_fraction) * column_fraction;
+					weights [2] = row_fraction * (1.0 - column_fraction);
+					weights [3] = row_fraction * column_fraction;
+
+					/* Leave out any voids and spread their weight over the other points */
+					for (i = 0; i < 4; ++ i)
+						{
+							if ((heights [i] != ELEVATION_VOID) && (weights [i] > 0.0))
+								{
+									total += weights [i] * heights [i];
+									total_weight += weights [i];
+								}
+						}
+
+					if (total_weight > 0.0)
+						{
+							*elevation_p = total / total_weight;
+							return true;
+						}
+				}
+		}
+
+	return false;
+}
+
+
+bool SetCoordinateElevationFromTiles (ElevationEngine *engine_p, Coordinate *coord_p)
+{
+	double64 elevation;
+
+	if (GetElevation (engine_p, coord_p -> co_x, coord_p -> co_y, &elevation))
+		{
+			return SetCoordinateElevation (coord_p, elevation);
+		}
+
+	return false;
+}
+
+
+size_t SetCoordinateElevationsFromTiles (ElevationEngine *engine_p, Coordinate *coords_p, const size_t num_coords)
+{
+	size_t num_set = 0;
+
+	if (num_coords > 0)
+		{
+			TileQuery *queries_p = (TileQuery *) AllocMemoryArray (num_coords, sizeof (TileQuery));
+
+			if (queries_p)
+				{
+					size_t i;
+
+					for (i = 0; i < num_coords; ++ i)
+						{
+							int32 tile_latitude;
+							int32 tile_longitude;
+
+							queries_p [i].tq_index = i;
+
+							if (GetTileIndices (coords_p [i].co_x, coords_p [i].co_y, &tile_latitude, &tile_longitude))
+								{
+									queries_p [i].tq_key = ((tile_latitude + 90) * 360) + (tile_longitude + 180);
+								}
+							else
+								{
+									queries_p [i].tq_key = EL_NO_TILE;
+								}
+						}
+
+					qsort (queries_p, num_coords, sizeof (TileQuery), CompareTileQueries);
+
+					for (i = 0; (i < num_coords) && (queries_p [i].tq_key != EL_NO_TILE); ++ i)
+						{
+							if (SetCoordinateElevationFromTiles (engine_p, coords_p + queries_p [i].tq_index))
+								{
+									++ num_set;
+								}
+						}
+
+					FreeMemory (queries_p);
+				}
+			else
+				{
+					size_t i;
+
+					/* Without the memory to sort them, just go through them in order */
+					for (i = 0; i < num_coords; ++ i)
+						{
+							if (SetCoordinateElevationFromTiles (engine_p, coords_p + i))
+								{
+									++ num_set;
+								}
+						}
+				}
+		}
+
+	return num_set;
+}
+
+
+bool SetAddressElevationFromTiles (ElevationEngine *engine_p, Address *address_p)
+{
+	bool success_flag = false;
+
+	if (address_p -> ad_gps_centre_p)
+		{
+			double64 elevation;
+
+			if (GetElevation (engine_p, address_p -> ad_gps_centre_p -> co_x, address_p -> ad_gps_centre_p -> co_y, &elevation))
+				{
+					if (SetCoordinateElevation (address_p -> ad_gps_centre_p, elevation))
+						{
+							if (! (address_p -> ad_elevation_p))
+								{
+									address_p -> ad_elevation_p = (double64 *) AllocMemory (sizeof (double64));
+								}
+
+							if (address_p -> ad_elevation_p)
+								{
+									* (address_p -> ad_elevation_p) = elevation;
+									success_flag = true;
+								}
+						}
+				}
+		}
+
+	return success_flag;
+}
+
+
+static bool GetTileIndices (const double64 latitude, const double64 longitude, int32 *tile_latitude_p, int32 *tile_longitude_p)
+{
+	if ((latitude >= -90.0) && (latitude <= 90.0) && (longitude >= -180.0) && (longitude <= 180.0))
+		{
+			int32 tile_latitude = (int32) floor (latitude);
+			int32 tile_longitude = (int32) floor (longitude);
+
+			/* The northern and eastern limits are the last rows and columns of the tiles below them */
+			if (tile_latitude == 90)
+				{
+					tile_latitude = 89;
+				}
+
+			if (tile_longitude == 180)
+				{
+					tile_longitude = 179;
+				}
+
+			*tile_latitude_p = tile_latitude;
+			*tile_longitude_p = tile_longitude;
+
+			return true;
+		}
+
+	return false;
+}
+
+
+/*
+ * Get a tile, mapping it if needed. Missing tiles are remembered along
+ * with the mapped ones, so the directory is only checked once for each.
+ */
+static ElevationTile *GetTile (ElevationEngine *engine_p, const int32 tile_latitude, const int32 tile_longitude)
+{
+	ElevationTile *tile_p = engine_p -> ee_last_tile_p;
+	uint32 i;
+
+	++ (engine_p -> ee_clock);
+
+	if (! (tile_p && (tile_p -> et_latitude == tile_latitude) && (tile_p -> et_longitude == tile_longitude)))
+		{
+			ElevationTile *oldest_tile_p = engine_p -> ee_tiles_p;
+
+			tile_p = NULL;
+
+			for (i = 0; (i < engine_p -> ee_num_tiles) && (!tile_p); ++ i)
+				{
+					ElevationTile *current_tile_p = engine_p -> ee_tiles_p + i;
+
+					if ((current_tile_p -> et_latitude == tile_latitude) && (current_tile_p -> et_longitude == tile_longitude))
+						{
+							tile_p = current_tile_p;
+						}
+					else if (current_tile_p -> et_last_used < oldest_tile_p -> et_last_used)
+						{
+							oldest_tile_p = current_tile_p;
+						}
+				}
+
+			if (!tile_p)
+				{
+					if (engine_p -> ee_num_tiles < engine_p -> ee_max_tiles)
+						{
+							tile_p = engine_p -> ee_tiles_p + engine_p -> ee_num_tiles;
+							++ (engine_p -> ee_num_tiles);
+						}
+					else
+						{
+							tile_p = oldest_tile_p;
+							UnmapTile (tile_p);
+						}
+
+					tile_p -> et_latitude = tile_latitude;
+					tile_p -> et_longitude = tile_longitude;
+					tile_p -> et_found_flag = MapTile (engine_p, tile_p);
+				}
+
+			engine_p -> ee_last_tile_p = tile_p;
+		}
+
+	tile_p -> et_last_used = engine_p -> ee_clock;
+
+	return tile_p;
+}
+
+
+static bool MapTile (ElevationEngine *engine_p, ElevationTile *tile_p)
+{
+	const size_t directory_length = strlen (engine_p -> ee_directory_s);
+	char *filename_s = (char *) AllocMemory (directory_length + EL_TILE_NAME_SIZE);
+	bool success_flag = false;
+
+	memset (& (tile_p -> et_file), 0, sizeof (MappedFile));
+	tile_p -> et_num_samples = 0;
+
+	if (!filename_s)
+		{
+			return false;
+		}
+
+	sprintf (filename_s, "%s/%c%02d%c%03d.hgt", engine_p -> ee_directory_s,
+		(tile_p -> et_latitude >= 0) ? 'N' : 'S', abs (tile_p -> et_latitude),
+		(tile_p -> et_longitude >= 0) ? 'E' : 'W', abs (tile_p -> et_longitude));
+
+	/* each lookup only reads a few neighbouring points */
+	if (OpenMappedFile (& (tile_p -> et_file), filename_s, 1, MFA_RANDOM))
+		{
+			/* The tiles have no header so the number of points comes from the file size */
+			const size_t size = tile_p -> et_file.mf_size;
+			const uint32 num_samples = (uint32) (sqrt ((double64) (size / 2)) + 0.5);
+
+			if ((num_samples >= 2) && ((uint64) num_samples * (uint64) num_samples * 2 == (uint64) size))
+				{
+					tile_p -> et_num_samples = num_samples;
+					success_flag = true;
+				}
+			else
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "\"%s\" is not a supported elevation tile", filename_s);
+					UnmapTile (tile_p);
+				}
+		}
+
+	FreeMemory (filename_s);
+
+	return success_flag;
+}
+
+
+static void UnmapTile (ElevationTile *tile_p)
+{
+	CloseMappedFile (& (tile_p -> et_file));
+
+	tile_p -> et_found_flag = false;
+}
+
+
+static int16 GetTileHeight (const ElevationTile *tile_p, const uint32 row, const uint32 column)
+{
+	const uint8 *height_p = tile_p -> et_file.mf_data_p + ((((size_t) row * tile_p -> et_num_samples) + column) * 2);
+
+	return (int16) ((((uint16) *height_p) << 8) | ((uint16) * (height_p + 1)));
+}
+
+
+static int CompareTileQueries (const void *v0_p, const void *v1_p)
+{
+	const TileQuery *query0_p = (const TileQuery *) v0_p;
+	const TileQuery *query1_p = (const TileQuery *) v1_p;
+
+	if (query0_p -> tq_key != query1_p -> tq_key)
+		{
+			return (query0_p -> tq_key < query1_p -> tq_key) ? -1 : 1;
+		}
+
+	/* Keep the original order within each tile */
+	return (query0_p -> tq_index < query1_p -> tq_index) ? -1 : ((query0_p -> tq_index > query1_p -> tq_index) ? 1 : 0);
+}
@@ -0,0 +1,434 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * fixed_coordinate.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <math.h>
+
+#include "fixed_coordinate.h"
+#include "geo_cell.h"
+#include "geo_distance.h"
+
+
+#define FC_DEGREES_TO_RADIANS (0.017453292519943295)
+
+#define FC_RADIANS_TO_DEGREES (57.29577951308232)
+
+/* The number of fixed units all the way round a line of latitude */
+#define FC_FULL_CIRCLE (2 * (int64) FIXED_COORDINATE_LONGITUDE_LIMIT)
+
+
+static bool ToFixedDegrees (const double64 value, const int32 limit, int32 *fixed_p);
+
+static uint32 ScaleToUInt32 (const int32 value, const int32 limit);
+
+static int64 GetLongitudeWidth (const FixedBoundingBox *box_p);
+
+static bool DoLongitudeRangesOverlap (const FixedBoundingBox *box0_p, const FixedBoundingBox *box1_p);
+
+
+
+bool SetFixedCoordinate (FixedCoordinate *fixed_p, const double64 latitude, const double64 longitude)
+{
+	int32 fixed_latitude;
+	int32 fixed_longitude;
+
+	if (ToFixedDegrees (latitude, FIXED_COORDINATE_LATITUDE_LIMIT, &fixed_latitude) && ToFixedDegrees (longitude, FIXED_COORDINATE_LONGITUDE_LIMIT, &fixed_longitude))
+		{
+			fixed_p -> fc_latitude = fixed_latitude;
+			fixed_p -> fc_longitude = fixed_longitude;
+
+			return true;
+		}
+
+	return false;
+}
+
+
+bool SetFixedCoordinateFromCoordinate (FixedCoordinate *fixed_p, const Coordinate *coord_p)
+{
+	return SetFixedCoordinate (fixed_p, coord_p -> co_x, coord_p -> co_y);
+}
+
+
+void SetCoordinateFromFixedCoordinate (Coordinate *coord_p, const FixedCoordinate *fixed_p)
+{
+	coord_p -> co_x = GetFixedCoordinateLatitude (fixed_p);
+	coord_p -> co_y = GetFixedCoordinateLongitude (fixed_p);
+}
+
+
+double64 GetFixedCoordinateLatitude (const FixedCoordinate *fixed_p)
+{
+	/*
+	 * Dividing rather than multiplying by 1e-7 gives the closest double
+	 * to the fixed value so that converting back is always exact.
+	 */
+	return ((double64) (fixed_p -> fc_latitude)) / FIXED_COORDINATE_SCALE;
+}
+
+
+double64 GetFixedCoordinateLongitude (const FixedCoordinate *fixed_p)
+{
+	return ((double64) (fixed_p -> fc_longitude)) / FIXED_COORDINATE_SCALE;
+}
+
+
+int CompareFixedCoordinates (const FixedCoordinate *fixed0_p, const FixedCoordinate *fixed1_p)
+{
+	if (fixed0_p -> fc_latitude != fixed1_p -> fc_latitude)
+		{
+			return (fixed0_p -> fc_latitude < fixed1_p -> fc_latitude) ? -1 : 1;
+		}
+
+	if (fixed0_p -> fc_longitude != fixed1_p -> fc_longitude)
+		{
+			return (fixed0_p -> fc_longitude < fixed1_p -> fc_longitude) ? -1 : 1;
+		}
+
+	return 0;
+}
+
+
+bool AreFixedCoordinatesEqual (const FixedCoordinate *fixed0_p, const FixedCoordinate *fixed1_p)
+{
+	return ((fixed0_p -> fc_latitude == fixed1_p -> fc_latitude) && (fixed0_p -> fc_longitude == fixed1_p -> fc_longitude));
+}
+
+
+uint32 GetFixedCoordinateHash (const FixedCoordinate *fixed_p)
+{
+	/* The 64-bit finaliser from MurmurHash3 */
+	uint64 h = (((uint64) ((uint32) (fixed_p -> fc_latitude))) << 32) | ((uint64) ((uint32) (fixed_p -> fc_longitude)));
+
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ULL;
+	h ^= h >> 33;
+
+	return (uint32) (h ^ (h >> 32));
+}
+
+
+uint32 GetFixedLatitudeIndex (const int32 latitude)
+{
+	return ScaleToUInt32 (latitude, FIXED_COORDINATE_LATITUDE_LIMIT);
+}
+
+
+uint32 GetFixedLongitudeIndex (const int32 longitude)
+{
+	return ScaleToUInt32 (longitude, FIXED_COORDINATE_LONGITUDE_LIMIT);
+}
+
+
+uint64 GetFixedCoordinateMortonCode (const FixedCoordinate *fixed_p)
+{
+	return InterleaveMortonIndices (GetFixedLatitudeIndex (fixed_p -> fc_latitude), GetFixedLongitudeIndex (fixed_p -> fc_longitude));
+}
+
+
+bool GetFixedCoordinateGeohash (const FixedCoordinate *fixed_p, const size_t precision, char *geohash_s)
+{
+	return GetGeohashForMortonCode (GetFixedCoordinateMortonCode (fixed_p), precision, geohash_s);
+}
+
+
+bool SetFixedBoundingBox (FixedBoundingBox *box_p, const Coordinate *south_west_p, const Coordinate *north_east_p)
+{
+	FixedCoordinate south_west;
+	FixedCoordinate north_east;
+
+	if (SetFixedCoordinateFromCoordinate (&south_west, south_west_p) && SetFixedCoordinateFromCoordinate (&north_east, north_east_p))
+		{
+			box_p -> fbb_south_west = south_west;
+			box_p -> fbb_north_east = north_east;
+
+			return true;
+		}
+
+	return false;
+}
+
+
+bool DoesFixedBoundingBoxCrossAntimeridian (const FixedBoundingBox *box_p)
+{
+	return (box_p -> fbb_south_west.fc_longitude > box_p -> fbb_north_east.fc_longitude);
+}
+
+
+bool DoesFixedBoundingBoxContain (const FixedBoundingBox *box_p, const FixedCoordinate *fixed_p)
+{
+	if ((fixed_p -> fc_latitude >= box_p -> fbb_south_west.fc_latitude) && (fixed_p -> fc_latitude <= box_p -> fbb_north_east.fc_latitude))
+		{
+			const bool east_of_west_flag = (fixed_p -> fc_longitude >= box_p -> fbb_south_west.fc_longitude);
+			const bool west_of_east_flag = (fixed_p -> fc_longitude <= box_p -> fbb_north_east.fc_longitude);
+
+			if (DoesFixedBoundingBoxCrossAntimeridian (box_p))
+				{
+					return (east_of_west_flag || west_of_east_flag);
+				}
+			else
+				{
+					return (east_of_west_flag && west_of_east_flag);
+				}
+		}
+
+	return false;
+}
+
+
+bool DoFixedBoundingBoxesIntersect (const FixedBoundingBox *box0_p, const FixedBoundingBox *box1_p)
+{
+	return ((box0_p -> fbb_south_west.fc_latitude <= box1_p -> fbb_north_east.fc_latitude) && (box1_p -> fbb_south_west.fc_latitude <= box0_p -> fbb_north_east.fc_latitude) &&
+		DoLongitudeRangesOverlap (box0_p, box1_p));
+}
+
+
+void ExpandFixedBoundingBox (FixedBoundingBox *box_p, const FixedCoordinate *fixed_p)
+{
+	if (fixed_p -> fc_latitude < box_p -> fbb_south_west.fc_latitude)
+		{
+			box_p -> fbb_south_west.fc_latitude = fixed_p -> fc_latitude;
+		}
+
+	if (fixed_p -> fc_latitude > box_p -> fbb_north_east.fc_latitude)
+		{
+			box_p -> fbb_north_east.fc_latitude = fixed_p -> fc_latitude;
+		}
+
+	if (fixed_p -> fc_longitude < box_p -> fbb_south_west.fc_longitude)
+		{
+			box_p -> fbb_south_west.fc_longitude = fixed_p -> fc_longitude;
+		}
+
+	if (fixed_p -> fc_longitude > box_p -> fbb_north_east.fc_longitude)
+		{
+			box_p -> fbb_north_east.fc_longitude = fixed_p -> fc_longitude;
+		}
+}
+
+
+void GetFixedBoundingBoxUnion (const FixedBoundingBox *box0_p, const FixedBoundingBox *box1_p, FixedBoundingBox *union_p)
+{
+	const int64 west0 = box0_p -> fbb_south_west.fc_longitude;
+	const int64 west1 = box1_p -> fbb_south_west.fc_longitude;
+	const int64 width0 = GetLongitudeWidth (box0_p);
+	const int64 width1 = GetLongitudeWidth (box1_p);
+	const int32 south = (box0_p -> fbb_south_west.fc_latitude < box1_p -> fbb_south_west.fc_latitude) ? box0_p -> fbb_south_west.fc_latitude : box1_p -> fbb_south_west.fc_latitude;
+	const int32 north = (box0_p -> fbb_north_east.fc_latitude > box1_p -> fbb_north_east.fc_latitude) ? box0_p -> fbb_north_east.fc_latitude : box1_p -> fbb_north_east.fc_latitude;
+	int64 offset;
+	int64 width_from_west0;
+	int64 width_from_west1;
+	int64 west;
+	int64 width;
+
+	/*
+	 * The smallest covering range starts at one of the two west edges, so
+	 * work out how far east it needs to reach from each of them.
+	 */
+	offset = west1 - west0;
+	if (offset < 0)
+		{
+			offset += FC_FULL_CIRCLE;
+		}
+
+	width_from_west0 = (offset + width1 > width0) ? (offset + width1) : width0;
+
+	offset = west0 - west1;
+	if (offset < 0)
+		{
+			offset += FC_FULL_CIRCLE;
+		}
+
+	width_from_west1 = (offset + width0 > width1) ? (offset + width0) : width1;
+
+	if (width_from_west0 <= width_from_west1)
+		{
+			west = west0;
+			width = width_from_west0;
+		}
+	else
+		{
+			west = west1;
+			width = width_from_west1;
+		}
+
+	union_p -> fbb_south_west.fc_latitude = south;
+	union_p -> fbb_north_east.fc_latitude = north;
+
+	if (width < FC_FULL_CIRCLE)
+		{
+			int64 east = west + width;
+
+			if (east > FIXED_COORDINATE_LONGITUDE_LIMIT)
+				{
+					east -= FC_FULL_CIRCLE;
+				}
+
+			union_p -> fbb_south_west.fc_longitude = (int32) west;
+			union_p -> fbb_north_east.fc_longitude = (int32) east;
+		}
+	else
+		{
+			union_p -> fbb_south_west.fc_longitude = -FIXED_COORDINATE_LONGITUDE_LIMIT;
+			union_p -> fbb_north_east.fc_longitude = FIXED_COORDINATE_LONGITUDE_LIMIT;
+		}
+}
+
+
+bool ExpandFixedBoundingBoxByDistance (const FixedBoundingBox *box_p, const double64 distance, FixedBoundingBox *expanded_p)
+{
+	/* This also catches NaNs */
+	if (distance >= 0.0)
+		{
+			const double64 angle = distance / GEO_DISTANCE_EARTH_RADIUS;
+			const int64 latitude_margin = (int64) ceil (angle * FC_RADIANS_TO_DEGREES * FIXED_COORDINATE_SCALE);
+			int64 south = (int64) box_p -> fbb_south_west.fc_latitude - latitude_margin;
+			int64 north = (int64) box_p -> fbb_north_east.fc_latitude + latitude_margin;
+			int64 west = -FIXED_COORDINATE_LONGITUDE_LIMIT;
+			int64 east = FIXED_COORDINATE_LONGITUDE_LIMIT;
+
+			/* If the box reaches a pole, every longitude is within the distance */
+			if ((south > -FIXED_COORDINATE_LATITUDE_LIMIT) && (north < FIXED_COORDINATE_LATITUDE_LIMIT))
+				{
+					/*
+					 * The widest that a circle of the given radius gets in longitude is
+					 * asin (sin (angle) / cos (latitude)) and this is largest for the
+					 * edge of the box nearest to a pole.
+					 */
+					const double64 south_degrees = fabs (GetFixedCoordinateLatitude (& (box_p -> fbb_south_west)));
+					const double64 north_degrees = fabs (GetFixedCoordinateLatitude (& (box_p -> fbb_north_east)));
+					const double64 ratio = sin (angle) / cos (((south_degrees > north_degrees) ? south_degrees : north_degrees) * FC_DEGREES_TO_RADIANS);
+
+					if (ratio < 1.0)
+						{
+							const int64 longitude_margin = (int64) ceil (asin (ratio) * FC_RADIANS_TO_DEGREES * FIXED_COORDINATE_SCALE);
+
+							if (GetLongitudeWidth (box_p) + (2 * longitude_margin) < FC_FULL_CIRCLE)
+								{
+									west = (int64) box_p -> fbb_south_west.fc_longitude - longitude_margin;
+									east = (int64) box_p -> fbb_north_east.fc_longitude + longitude_margin;
+
+									if (west < -FIXED_COORDINATE_LONGITUDE_LIMIT)
+										{
+											west += FC_FULL_CIRCLE;
+										}
+
+									if (east > FIXED_COORDINATE_LONGITUDE_LIMIT)
+										{
+											east -= FC_FULL_CIRCLE;
+										}
+								}
+						}
+				}
+			else
+				{
+					if (south < -FIXED_COORDINATE_LATITUDE_LIMIT)
+						{
+							south = -FIXED_COORDINATE_LATITUDE_LIMIT;
+						}
+
+					if (north > FIXED_COORDINATE_LATITUDE_LIMIT)
+						{
+							north = FIXED_COORDINATE_LATITUDE_LIMIT;
+						}
+				}
+
+			expanded_p -> fbb_south_west.fc_latitude = (int32) south;
+			expanded_p -> fbb_south_west.fc_longitude = (int32) west;
+			expanded_p -> fbb_north_east.fc_latitude = (int32) north;
+			expanded_p -> fbb_north_east.fc_longitude = (int32) east;
+
+			return true;
+		}
+
+	return false;
+}
+
+
+static bool ToFixedDegrees (const double64 value, const int32 limit, int32 *fixed_p)
+{
+	const double64 scaled_value = value * FIXED_COORDINATE_SCALE;
+
+	/* This also catches NaNs */
+	if ((scaled_value >= -limit) && (scaled_value <= limit))
+		{
+			*fixed_p = (int32) lround (scaled_value);
+			return true;
+		}
+
+	return false;
+}
+
+
+/*
+ * Map a value in [-limit, limit] onto the full range of a uint32 so that
+ * the top bit splits the range in half, the next bit splits each half and
+ * so on, which is how geohashes subdivide each axis.
+ */
+static uint32 ScaleToUInt32 (const int32 value, const int32 limit)
+{
+	const uint64 offset = (uint64) ((int64) value + limit);
+	const uint64 scaled_value = (offset << 32) / (2 * (uint64) limit);
+
+	/* The upper limit itself belongs to the last cell */
+	return (scaled_value > 0xFFFFFFFFULL) ? 0xFFFFFFFFU : (uint32) scaled_value;
+}
+
+
+static int64 GetLongitudeWidth (const FixedBoundingBox *box_p)
+{
+	int64 width = (int64) box_p -> fbb_north_east.fc_longitude - (int64) box_p -> fbb_south_west.fc_longitude;
+
+	if (width < 0)
+		{
+			width += FC_FULL_CIRCLE;
+		}
+
+	return width;
+}
+
+
+static bool DoLongitudeRangesOverlap (const FixedBoundingBox *box0_p, const FixedBoundingBox *box1_p)
+{
+	const int32 west0 = box0_p -> fbb_south_west.fc_longitude;
+	const int32 east0 = box0_p -> fbb_north_east.fc_longitude;
+	const int32 west1 = box1_p -> fbb_south_west.fc_longitude;
+	const int32 east1 = box1_p -> fbb_north_east.fc_longitude;
+
+	if (west0 > east0)
+		{
+			/* Both ranges include the antimeridian */
+			if (west1 > east1)
+				{
+					return true;
+				}
+
+			return ((east1 >= west0) || (west1 <= east0));
+		}
+	else if (west1 > east1)
+		{
+			return ((east0 >= west1) || (west0 <= east1));
+		}
+
+	return ((west0 <= east1) && (west1 <= east0));
+}
@@ -0,0 +1,773 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * geo_cell.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "geo_cell.h"
+#include "streams.h"
+
+
+/*
+ * The batch Morton code functions have AVX2 and BMI2 versions that are
+ * compiled for those instruction sets using function attributes and
+ * chosen at run time, so the library itself still runs on any x86-64.
+ */
+#if defined (__GNUC__) && defined (__x86_64__)
+	#define GEO_CELL_X86_KERNELS (1)
+	#include <immintrin.h>
+#endif
+
+
+/* How many Coordinates are converted to FixedCoordinates at a time */
+#define GC_COORDINATE_BATCH_SIZE (256)
+
+/* How many cells to examine per range when covering a bounding box before giving up on a depth */
+#define GC_CELLS_PER_RANGE (8)
+
+
+typedef struct GeoCellCover
+{
+	uint32 gcc_min_latitude;
+	uint32 gcc_max_latitude;
+	uint32 gcc_min_longitude;
+	uint32 gcc_max_longitude;
+	uint32 gcc_max_depth;
+	size_t gcc_cells_left;
+	GeoCellRange *gcc_ranges_p;
+	size_t gcc_max_ranges;
+	size_t gcc_num_ranges;
+	bool gcc_exact_flag;
+} GeoCellCover;
+
+
+static const char S_GEOHASH_ALPHABET_S [] = "0123456789bcdefghjkmnpqrstuvwxyz";
+
+
+/* The changes in latitude and longitude index for each neighbour, clockwise from the north */
+static const int S_NEIGHBOUR_OFFSETS [GEO_CELL_MAX_NEIGHBOURS][2] =
+{
+	{ 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 }
+};
+
+
+static uint64 SpreadBits (const uint32 value);
+
+static uint32 CompactBits (uint64 value);
+
+static uint64 GetDepthMask (const uint32 depth);
+
+static void GetCellIndexRange (const uint32 index, const uint32 num_bits, uint32 *first_p, uint32 *last_p);
+
+static int32 GetFixedValueForIndex (const uint64 index, const int32 limit);
+
+static void GetFixedRangeForIndexes (const uint32 first, const uint32 last, const int32 limit, int32 *min_p, int32 *max_p);
+
+static size_t CoverBoundingBoxToDepth (const FixedBoundingBox *box_p, const uint32 depth, GeoCellRange *ranges_p, const size_t max_ranges, bool *exact_flag_p);
+
+static bool CoverBoundingBox (GeoCellCover *cover_p, const FixedBoundingBox *box_p, const int32 min_longitude, const int32 max_longitude);
+
+static bool CoverCell (GeoCellCover *cover_p, const uint64 code, const uint32 depth, const uint32 min_latitude, const uint32 max_latitude, const uint32 min_longitude, const uint32 max_longitude);
+
+static bool AddCoverRange (GeoCellCover *cover_p, const uint64 code, const uint32 depth);
+
+static size_t MergeCoverRanges (GeoCellRange *ranges_p, const size_t num_ranges);
+
+static int CompareGeoCellRanges (const void *v0_p, const void *v1_p);
+
+#ifdef GEO_CELL_X86_KERNELS
+
+static void GetMortonCodesAVX2 (const FixedCoordinate *coords_p, const size_t num_coords, uint64 *codes_p);
+
+static void GetMortonCodesBMI2 (const FixedCoordinate *coords_p, const size_t num_coords, uint64 *codes_p);
+
+#endif
+
+
+
+uint64 InterleaveMortonIndices (const uint32 latitude_index, const uint32 longitude_index)
+{
+	return (SpreadBits (longitude_index) << 1) | SpreadBits (latitude_index);
+}
+
+
+void DeinterleaveMortonCode (const uint64 code, uint32 *latitude_index_p, uint32 *longitude_index_p)
+{
+	*latitude_index_p = CompactBits (code);
+	*longitude_index_p = CompactBits (code >> 1);
+}
+
+
+bool GetGeohashForMortonCode (const uint64 code, const size_t precision, char *geohash_s)
+{
+	if ((precision >= 1) && (precision <= FIXED_COORDINATE_MAX_GEOHASH_LENGTH))
+		{
+			uint64 remaining_code = code;
+			size_t i;
+
+			for (i = 0; i < precision; ++ i)
+				{
+					*geohash_s = S_GEOHASH_ALPHABET_S [remaining_code >> 59];
+					++ geohash_s;
+
+					remaining_code <<= 5;
+				}
+
+			*geohash_s = '\0';
+
+			return true;
+		}
+
+	return false;
+}
+
+
+void GetMortonCodesForFixedCoordinates (const FixedCoordinate *coords_p, const size_t num_coords, uint64 *codes_p)
+{
+#ifdef GEO_CELL_X86_KERNELS
+	/*
+	 * PDEP is microcoded and slow on AMD processors before Zen 3 so
+	 * prefer the AVX2 version when both are available.
+	 */
+	if (__builtin_cpu_supports ("avx2"))
+		{
+			GetMortonCodesAVX2 (coords_p, num_coords, codes_p);
+		}
+	else if (__builtin_cpu_supports ("bmi2"))
+		{
+			GetMortonCodesBMI2 (coords_p, num_coords, codes_p);
+		}
+	else
+#endif
+		{
+			size_t i;
+
+			for (i = 0; i < num_coords; ++ i, ++ coords_p, ++ codes_p)
+				{
+					*codes_p = GetFixedCoordinateMortonCode (coords_p);
+				}
+		}
+}
+
+
+bool GetMortonCodesForCoordinates (const Coordinate *coords_p, const size_t num_coords, uint64 *codes_p)
+{
+	FixedCoordinate fixed_coords [GC_COORDINATE_BATCH_SIZE];
+	size_t num_left = num_coords;
+
+	while (num_left > 0)
+		{
+			const size_t batch_size = (num_left < GC_COORDINATE_BATCH_SIZE) ? num_left : GC_COORDINATE_BATCH_SIZE;
+			size_t i;
+
+			for (i = 0; i < batch_size; ++ i, ++ coords_p)
+				{
+					if (!SetFixedCoordinateFromCoordinate (fixed_coords + i, coords_p))
+						{
+							PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Cannot get Morton code for coordinate [" DOUBLE64_FMT ", " DOUBLE64_FMT "]", coords_p -> co_x, coords_p -> co_y);
+							return false;
+						}
+				}
+
+			GetMortonCodesForFixedCoordinates (fixed_coords, batch_size, codes_p);
+
+			codes_p += batch_size;
+			num_left -= batch_size;
+		}
+
+	return true;
+}
+
+
+void SetGeoCellFromFixedCoordinate (GeoCell *cell_p, const FixedCoordinate *fixed_p, const uint32 depth)
+{
+	SetGeoCellFromMortonCode (cell_p, GetFixedCoordinateMortonCode (fixed_p), depth);
+}
+
+
+void SetGeoCellFromMortonCode (GeoCell *cell_p, const uint64 code, const uint32 depth)
+{
+	cell_p -> gc_depth = (depth < GEO_CELL_MAX_DEPTH) ? depth : GEO_CELL_MAX_DEPTH;
+	cell_p -> gc_code = code & GetDepthMask (cell_p -> gc_depth);
+}
+
+
+bool SetGeoCellFromGeohash (GeoCell *cell_p, const char *geohash_s)
+{
+	uint64 code = 0;
+	uint32 depth = 0;
+
+	while (*geohash_s != '\0')
+		{
+			char c = *geohash_s;
+			const char *match_s;
+
+			if (depth == GEO_CELL_MAX_DEPTH)
+				{
+					return false;
+				}
+
+			if ((c >= 'A') && (c <= 'Z'))
+				{
+					c += 'a' - 'A';
+				}
+
+			match_s = strchr (S_GEOHASH_ALPHABET_S, c);
+
+			if (!match_s)
+				{
+					return false;
+				}
+
+			code |= ((uint64) (match_s - S_GEOHASH_ALPHABET_S)) << (59 - depth);
+			depth += 5;
+
+			++ geohash_s;
+		}
+
+	if (depth > 0)
+		{
+			cell_p -> gc_code = code;
+			cell_p -> gc_depth = depth;
+
+			return true;
+		}
+
+	return false;
+}
+
+
+bool GetGeohashForGeoCell (const GeoCell *cell_p, char *geohash_s)
+{
+	if ((cell_p -> gc_depth % 5) == 0)
+		{
+			return GetGeohashForMortonCode (cell_p -> gc_code, cell_p -> gc_depth / 5, geohash_s);
+		}
+
+	return false;
+}
+
+
+void GetGeoCellRange (const GeoCell *cell_p, GeoCellRange *range_p)
+{
+	range_p -> gcr_first = cell_p -> gc_code;
+	range_p -> gcr_last = cell_p -> gc_code | ~GetDepthMask (cell_p -> gc_depth);
+}
+
+
+void GetGeoCellBoundingBox (const GeoCell *cell_p, FixedBoundingBox *box_p)
+{
+	uint32 latitude_index;
+	uint32 longitude_index;
+	uint32 first;
+	uint32 last;
+
+	DeinterleaveMortonCode (cell_p -> gc_code, &latitude_index, &longitude_index);
+
+	GetCellIndexRange (latitude_index, cell_p -> gc_depth / 2, &first, &last);
+	GetFixedRangeForIndexes (first, last, FIXED_COORDINATE_LATITUDE_LIMIT, & (box_p -> fbb_south_west.fc_latitude), & (box_p -> fbb_north_east.fc_latitude));
+
+	GetCellIndexRange (longitude_index, (cell_p -> gc_depth + 1) / 2, &first, &last);
+	GetFixedRangeForIndexes (first, last, FIXED_COORDINATE_LONGITUDE_LIMIT, & (box_p -> fbb_south_west.fc_longitude), & (box_p -> fbb_north_east.fc_longitude));
+}
+
+
+void GetGeoCellCentre (const GeoCell *cell_p, FixedCoordinate *centre_p)
+{
+	FixedBoundingBox box;
+
+	GetGeoCellBoundingBox (cell_p, &box);
+
+	centre_p -> fc_latitude = (int32) (((int64) box.fbb_south_west.fc_latitude + (int64) box.fbb_north_east.fc_latitude) / 2);
+	centre_p -> fc_longitude = (int32) (((int64) box.fbb_south_west.fc_longitude + (int64) box.fbb_north_east.fc_longitude) / 2);
+}
+
+
+size_t GetGeoCellNeighbours (const GeoCell *cell_p, GeoCell *neighbours_p)
+{
+	const uint32 latitude_bits = cell_p -> gc_depth / 2;
+	const uint32 longitude_bits = (cell_p -> gc_depth + 1) / 2;
+	const int64 num_latitudes = ((int64) 1) << latitude_bits;
+	const int64 longitude_mask = (((int64) 1) << longitude_bits) - 1;
+	uint32 latitude_index;
+	uint32 longitude_index;
+	size_t num_neighbours = 0;
+	size_t i;
+
+	DeinterleaveMortonCode (cell_p -> gc_code, &latitude_index, &longitude_index);
+
+	if (latitude_bits > 0)
+		{
+			latitude_index >>= (32 - latitude_bits);
+		}
+
+	if (longitude_bits > 0)
+		{
+			longitude_index >>= (32 - longitude_bits);
+		}
+
+	for (i = 0; i < GEO_CELL_MAX_NEIGHBOURS; ++ i)
+		{
+			const int64 neighbour_latitude = ((int64) latitude_index) + S_NEIGHBOUR_OFFSETS [i][0];
+
+			/* There is nothing beyond the poles */
+			if ((neighbour_latitude >= 0) && (neighbour_latitude < num_latitudes))
+				{
+					/* but the longitudes wrap around */
+					const int64 neighbour_longitude = (((int64) longitude_index) + S_NEIGHBOUR_OFFSETS [i][1]) & longitude_mask;
+					const uint32 full_latitude = (latitude_bits > 0) ? (((uint32) neighbour_latitude) << (32 - latitude_bits)) : 0;
+					const uint32 full_longitude = (longitude_bits > 0) ? (((uint32) neighbour_longitude) << (32 - longitude_bits)) : 0;
+					const uint64 code = InterleaveMortonIndices (full_latitude, full_longitude);
+
+					if (code != cell_p -> gc_code)
+						{
+							size_t j = 0;
+
+							while ((j < num_neighbours) && ((neighbours_p + j) -> gc_code != code))
+								{
+									++ j;
+								}
+
+							if (j == num_neighbours)
+								{
+									GeoCell *neighbour_p = neighbours_p + num_neighbours;
+
+									neighbour_p -> gc_code = code;
+									neighbour_p -> gc_depth = cell_p -> gc_depth;
+
+									++ num_neighbours;
+								}
+						}
+				}
+		}
+
+	return num_neighbours;
+}
+
+
+size_t GetGeoCellRangesForBoundingBox (const FixedBoundingBox *box_p, const uint32 max_depth, GeoCellRange *ranges_p, const size_t max_ranges)
+{
+	const FixedCoordinate *south_west_p = & (box_p -> fbb_south_west);
+	const FixedCoordinate *north_east_p = & (box_p -> fbb_north_east);
+	const uint32 limit_depth = (max_depth < GEO_CELL_MAX_DEPTH) ? max_depth : GEO_CELL_MAX_DEPTH;
+	uint32 depth = 0;
+	size_t num_ranges;
+	bool exact_flag;
+
+	if ((max_ranges == 0) || (south_west_p -> fc_latitude > north_east_p -> fc_latitude))
+		{
+			PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Cannot cover bounding box from [" INT32_FMT ", " INT32_FMT "] to [" INT32_FMT ", " INT32_FMT "] with " SIZET_FMT " ranges",
+				south_west_p -> fc_latitude, south_west_p -> fc_longitude, north_east_p -> fc_latitude, north_east_p -> fc_longitude, max_ranges);
+			return 0;
+		}
+
+	/*
+	 * Deepen the cover one level at a time while it still fits in the
+	 * given number of ranges. Each attempt is bounded and the number of
+	 * cells grows with depth so the failing attempt dominates the cost.
+	 * At a depth of 0 the whole world is a single range so the first
+	 * attempt always succeeds.
+	 */
+	num_ranges = CoverBoundingBoxToDepth (box_p, 0, ranges_p, max_ranges, &exact_flag);
+
+	while ((!exact_flag) && (depth < limit_depth))
+		{
+			const size_t num_deeper_ranges = CoverBoundingBoxToDepth (box_p, depth + 1, ranges_p, max_ranges, &exact_flag);
+
+			if (num_deeper_ranges == 0)
+				{
+					/* The failed attempt has overwritten the ranges so regenerate them */
+					num_ranges = CoverBoundingBoxToDepth (box_p, depth, ranges_p, max_ranges, &exact_flag);
+					break;
+				}
+
+			num_ranges = num_deeper_ranges;
+			++ depth;
+		}
+
+	return num_ranges;
+}
+
+
+static size_t CoverBoundingBoxToDepth (const FixedBoundingBox *box_p, const uint32 depth, GeoCellRange *ranges_p, const size_t max_ranges, bool *exact_flag_p)
+{
+	GeoCellCover cover;
+	bool success_flag;
+
+	cover.gcc_max_depth = depth;
+	cover.gcc_cells_left = GC_CELLS_PER_RANGE * (depth + 1) * (max_ranges + 1);
+	cover.gcc_ranges_p = ranges_p;
+	cover.gcc_max_ranges = max_ranges;
+	cover.gcc_num_ranges = 0;
+	cover.gcc_exact_flag = true;
+
+	if (box_p -> fbb_south_west.fc_longitude <= box_p -> fbb_north_east.fc_longitude)
+		{
+			success_flag = CoverBoundingBox (&cover, box_p, box_p -> fbb_south_west.fc_longitude, box_p -> fbb_north_east.fc_longitude);
+		}
+	else
+		{
+			/* The box crosses the antimeridian so cover each side of it separately */
+			success_flag = CoverBoundingBox (&cover, box_p, box_p -> fbb_south_west.fc_longitude, FIXED_COORDINATE_LONGITUDE_LIMIT) &&
+				CoverBoundingBox (&cover, box_p, -FIXED_COORDINATE_LONGITUDE_LIMIT, box_p -> fbb_north_east.fc_longitude);
+		}
+
+	if (success_flag)
+		{
+			*exact_flag_p = cover.gcc_exact_flag;
+			return MergeCoverRanges (ranges_p, cover.gcc_num_ranges);
+		}
+
+	return 0;
+}
+
+
+static bool CoverBoundingBox (GeoCellCover *cover_p, const FixedBoundingBox *box_p, const int32 min_longitude, const int32 max_longitude)
+{
+	cover_p -> gcc_min_latitude = GetFixedLatitudeIndex (box_p -> fbb_south_west.fc_latitude);
+	cover_p -> gcc_max_latitude = GetFixedLatitudeIndex (box_p -> fbb_north_east.fc_latitude);
+	cover_p -> gcc_min_longitude = GetFixedLongitudeIndex (min_longitude);
+	cover_p -> gcc_max_longitude = GetFixedLongitudeIndex (max_longitude);
+
+	return CoverCell (cover_p, 0, 0, 0, 0xFFFFFFFFU, 0, 0xFFFFFFFFU);
+}
+
+
+/*
+ * Add the ranges for the parts of the cell that overlap the box. The cell
+ * bounds are inclusive index ranges, which for a cell at depth d have the
+ * top bits fixed by the cell's code and the remaining bits free.
+ */
+static bool CoverCell (GeoCellCover *cover_p, const uint64 code, const uint32 depth, const uint32 min_latitude, const uint32 max_latitude, const uint32 min_longitude, const uint32 max_longitude)
+{
+	if ((max_latitude < cover_p -> gcc_min_latitude) || (min_latitude > cover_p -> gcc_max_latitude) ||
+		(max_longitude < cover_p -> gcc_min_longitude) || (min_longitude > cover_p -> gcc_max_longitude))
+		{
+			return true;
+		}
+
+	if (cover_p -> gcc_cells_left == 0)
+		{
+			return false;
+		}
+
+	-- (cover_p -> gcc_cells_left);
+
+	if ((min_latitude >= cover_p -> gcc_min_latitude) && (max_latitude <= cover_p -> gcc_max_latitude) &&
+		(min_longitude >= cover_p -> gcc_min_longitude) && (max_longitude <= cover_p -> gcc_max_longitude))
+		{
+			return AddCoverRange (cover_p, code, depth);
+		}
+	else if (depth == cover_p -> gcc_max_depth)
+		{
+			/* This cell is only partly inside the box */
+			cover_p -> gcc_exact_flag = false;
+			return AddCoverRange (cover_p, code, depth);
+		}
+	else
+		{
+			const uint64 upper_code = code | (((uint64) 1) << (63 - depth));
+
+			/* Longitude is split first, then latitude and so on */
+			if ((depth & 1) == 0)
+				{
+					const uint32 mid_longitude = min_longitude + ((max_longitude - min_longitude) / 2);
+
+					return (CoverCell (cover_p, code, depth + 1, min_latitude, max_latitude, min_longitude, mid_longitude) &&
+						CoverCell (cover_p, upper_code, depth + 1, min_latitude, max_latitude, mid_longitude + 1, max_longitude));
+				}
+			else
+				{
+					const uint32 mid_latitude = min_latitude + ((max_latitude - min_latitude) / 2);
+
+					return (CoverCell (cover_p, code, depth + 1, min_latitude, mid_latitude, min_longitude, max_longitude) &&
+						CoverCell (cover_p, upper_code, depth + 1, mid_latitude + 1, max_latitude, min_longitude, max_longitude));
+				}
+		}
+}
+
+
+static bool AddCoverRange (GeoCellCover *cover_p, const uint64 code, const uint32 depth)
+{
+	const uint64 last = code | ~GetDepthMask (depth);
+
+	if (cover_p -> gcc_num_ranges > 0)
+		{
+			GeoCellRange *previous_p = cover_p -> gcc_ranges_p + (cover_p -> gcc_num_ranges - 1);
+
+			/* The cells are visited in Morton order so adjacent ones can be joined */
+			if ((previous_p -> gcr_last != UINT64_MAX) && (previous_p -> gcr_last + 1 == code))
+				{
+					previous_p -> gcr_last = last;
+					return true;
+				}
+
+			/* Both halves of a box crossing the antimeridian can lie in the same cell */
+			if ((code >= previous_p -> gcr_first) && (last <= previous_p -> gcr_last))
+				{
+					return true;
+				}
+		}
+
+	if (cover_p -> gcc_num_ranges < cover_p -> gcc_max_ranges)
+		{
+			GeoCellRange *range_p = cover_p -> gcc_ranges_p + cover_p -> gcc_num_ranges;
+
+			range_p -> gcr_first = code;
+			range_p -> gcr_last = last;
+
+			++ (cover_p -> gcc_num_ranges);
+
+			return true;
+		}
+
+	return false;
+}
+
+
+/*
+ * The two halves of a box that crosses the antimeridian are covered
+ * separately so their ranges need sorting and can overlap or touch.
+ */
+static size_t MergeCoverRanges (GeoCellRange *ranges_p, const size_t num_ranges)
+{
+	size_t num_merged_ranges = 0;
+	size_t i;
+
+	qsort (ranges_p, num_ranges, sizeof (GeoCellRange), CompareGeoCellRanges);
+
+	for (i = 0; i < num_ranges; ++ i)
+		{
+			const GeoCellRange *range_p = ranges_p + i;
+
+			if (num_merged_ranges > 0)
+				{
+					GeoCellRange *previous_p = ranges_p + (num_merged_ranges - 1);
+
+					if ((previous_p -> gcr_last == UINT64_MAX) || (range_p -> gcr_first <= previous_p -> gcr_last + 1))
+						{
+							if (range_p -> gcr_last > previous_p -> gcr_last)
+								{
+									previous_p -> gcr_last = range_p -> gcr_last;
+								}
+
+							continue;
+						}
+				}
+
+			* (ranges_p + num_merged_ranges) = *range_p;
+			++ num_merged_ranges;
+		}
+
+	return num_merged_ranges;
+}
+
+
+static int CompareGeoCellRanges (const void *v0_p, const void *v1_p)
+{
+	const GeoCellRange *range0_p = (const GeoCellRange *) v0_p;
+	const GeoCellRange *range1_p = (const GeoCellRange *) v1_p;
+
+	if (range0_p -> gcr_first != range1_p -> gcr_first)
+		{
+			return (range0_p -> gcr_first < range1_p -> gcr_first) ? -1 : 1;
+		}
+
+	return 0;
+}
+
+
+/* The mask for the top depth bits of a Morton code */
+static uint64 GetDepthMask (const uint32 depth)
+{
+	return (depth > 0) ? (UINT64_MAX << (64 - depth)) : 0;
+}
+
+
+/* Get the inclusive range of full indexes that share the top num_bits bits of index */
+static void GetCellIndexRange (const uint32 index, const uint32 num_bits, uint32 *first_p, uint32 *last_p)
+{
+	if (num_bits > 0)
+		{
+			const uint32 mask = 0xFFFFFFFFU << (32 - num_bits);
+
+			*first_p = index & mask;
+			*last_p = *first_p | ~mask;
+		}
+	else
+		{
+			*first_p = 0;
+			*last_p = 0xFFFFFFFFU;
+		}
+}
+
+
+/*
+ * Get the smallest fixed value whose index is at least the given one. This
+ * is the inverse of the scaling done by GetFixedLatitudeIndex() and
+ * GetFixedLongitudeIndex().
+ */
+static int32 GetFixedValueForIndex (const uint64 index, const int32 limit)
+{
+	const uint64 offset = ((index * (2 * (uint64) limit)) + 0xFFFFFFFFULL) >> 32;
+
+	return (int32) ((int64) offset - limit);
+}
+
+
+static void GetFixedRangeForIndexes (const uint32 first, const uint32 last, const int32 limit, int32 *min_p, int32 *max_p)
+{
+	*min_p = GetFixedValueForIndex (first, limit);
+
+	/* The limit itself is given the last index */
+	*max_p = (last == 0xFFFFFFFFU) ? limit : GetFixedValueForIndex (((uint64) last) + 1, limit) - 1;
+}
+
+
+/* Move the bits of value into the even bit positions of the result */
+static uint64 SpreadBits (const uint32 value)
+{
+	uint64 x = value;
+
+	x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+	x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+	x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	x = (x | (x << 2)) & 0x3333333333333333ULL;
+	x = (x | (x << 1)) & 0x5555555555555555ULL;
+
+	return x;
+}
+
+
+/* The inverse of SpreadBits, gathering the even bits of value */
+static uint32 CompactBits (uint64 value)
+{
+	value &= 0x5555555555555555ULL;
+	value = (value | (value >> 1)) & 0x3333333333333333ULL;
+	value = (value | (value >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+	value = (value | (value >> 4)) & 0x00FF00FF00FF00FFULL;
+	value = (value | (value >> 8)) & 0x0000FFFF0000FFFFULL;
+	value = (value | (value >> 16)) & 0x00000000FFFFFFFFULL;
+
+	return (uint32) value;
+}
+
+
+#ifdef GEO_CELL_X86_KERNELS
+
+
+__attribute__ ((target ("avx2")))
+static inline __m256i SpreadBitsAVX2 (__m256i x)
+{
+	x = _mm256_and_si256 (_mm256_or_si256 (x, _mm256_slli_epi64 (x, 16)), _mm256_set1_epi64x (0x0000FFFF0000FFFFLL));
+	x = _mm256_and_si256 (_mm256_or_si256 (x, _mm256_slli_epi64 (x, 8)), _mm256_set1_epi64x (0x00FF00FF00FF00FFLL));
+	x = _mm256_and_si256 (_mm256_or_si256 (x, _mm256_slli_epi64 (x, 4)), _mm256_set1_epi64x (0x0F0F0F0F0F0F0F0FLL));
+	x = _mm256_and_si256 (_mm256_or_si256 (x, _mm256_slli_epi64 (x, 2)), _mm256_set1_epi64x (0x3333333333333333LL));
+	x = _mm256_and_si256 (_mm256_or_si256 (x, _mm256_slli_epi64 (x, 1)), _mm256_set1_epi64x (0x5555555555555555LL));
+
+	return x;
+}
+
+
+/*
+ * The vector version of the latitude and longitude index scaling. AVX2
+ * has no 64-bit division so the quotient is estimated with doubles,
+ * which can be one too high when the exact value is just below an
+ * integer, and then corrected with an exact 32 x 32 bit multiply.
+ */
+__attribute__ ((target ("avx2")))
+static inline __m256i ScaleToIndexesAVX2 (const __m256i offsets, const __m256d range_d, const __m256i range_i)
+{
+	/* 2^52 as a double and its bit pattern, for converting small integers to and from doubles */
+	const __m256d magic_d = _mm256_set1_pd (4503599627370496.0);
+	const __m256i magic_i = _mm256_set1_epi64x (0x4330000000000000LL);
+	const __m256i max_index = _mm256_set1_epi64x (0xFFFFFFFFLL);
+	const __m256i sign_bit = _mm256_set1_epi64x ((long long) 0x8000000000000000ULL);
+	__m256d values = _mm256_sub_pd (_mm256_castsi256_pd (_mm256_or_si256 (offsets, magic_i)), magic_d);
+	__m256i indexes;
+	__m256i products;
+	__m256i targets;
+
+	values = _mm256_floor_pd (_mm256_div_pd (_mm256_mul_pd (values, _mm256_set1_pd (4294967296.0)), range_d));
+	indexes = _mm256_xor_si256 (_mm256_castpd_si256 (_mm256_add_pd (values, magic_d)), magic_i);
+
+	/* The upper limit itself belongs to the last cell */
+	indexes = _mm256_blendv_epi8 (indexes, max_index, _mm256_cmpgt_epi64 (indexes, max_index));
+
+	products = _mm256_mul_epu32 (indexes, range_i);
+	targets = _mm256_slli_epi64 (offsets, 32);
+
+	/* Unsigned comparison by flipping the sign bits, subtracting 1 where the estimate was too high */
+	return _mm256_add_epi64 (indexes, _mm256_cmpgt_epi64 (_mm256_xor_si256 (products, sign_bit), _mm256_xor_si256 (targets, sign_bit)));
+}
+
+
+__attribute__ ((target ("avx2")))
+static void GetMortonCodesAVX2 (const FixedCoordinate *coords_p, const size_t num_coords, uint64 *codes_p)
+{
+	const __m256i limits = _mm256_setr_epi32 (FIXED_COORDINATE_LATITUDE_LIMIT, FIXED_COORDINATE_LONGITUDE_LIMIT, FIXED_COORDINATE_LATITUDE_LIMIT, FIXED_COORDINATE_LONGITUDE_LIMIT,
+		FIXED_COORDINATE_LATITUDE_LIMIT, FIXED_COORDINATE_LONGITUDE_LIMIT, FIXED_COORDINATE_LATITUDE_LIMIT, FIXED_COORDINATE_LONGITUDE_LIMIT);
+	const __m256i low_mask = _mm256_set1_epi64x (0xFFFFFFFFLL);
+	const __m256d latitude_range_d = _mm256_set1_pd (2.0 * FIXED_COORDINATE_LATITUDE_LIMIT);
+	const __m256d longitude_range_d = _mm256_set1_pd (2.0 * FIXED_COORDINATE_LONGITUDE_LIMIT);
+	const __m256i latitude_range_i = _mm256_set1_epi64x (2LL * FIXED_COORDINATE_LATITUDE_LIMIT);
+	const __m256i longitude_range_i = _mm256_set1_epi64x (2LL * FIXED_COORDINATE_LONGITUDE_LIMIT);
+	size_t i = 0;
+
+	for ( ; i + 4 <= num_coords; i += 4)
+		{
+			/*
+			 * Each 64-bit lane holds a latitude in its low half and a longitude
+			 * in its high half. Adding the limits makes them unsigned offsets
+			 * from the south-west corner of the world.
+			 */
+			const __m256i offsets = _mm256_add_epi32 (_mm256_loadu_si256 ((const __m256i *) (coords_p + i)), limits);
+			const __m256i latitudes = ScaleToIndexesAVX2 (_mm256_and_si256 (offsets, low_mask), latitude_range_d, latitude_range_i);
+			const __m256i longitudes = ScaleToIndexesAVX2 (_mm256_srli_epi64 (offsets, 32), longitude_range_d, longitude_range_i);
+			const __m256i codes = _mm256_or_si256 (_mm256_slli_epi64 (SpreadBitsAVX2 (longitudes), 1), SpreadBitsAVX2 (latitudes));
+
+			_mm256_storeu_si256 ((__m256i *) (codes_p + i), codes);
+		}
+
+	for ( ; i < num_coords; ++ i)
+		{
+			* (codes_p + i) = GetFixedCoordinateMortonCode (coords_p + i);
+		}
+}
+
+
+__attribute__ ((target ("bmi2")))
+static void GetMortonCodesBMI2 (const FixedCoordinate *coords_p, const size_t num_coords, uint64 *codes_p)
+{
+	size_t i;
+
+	for (i = 0; i < num_coords; ++ i, ++ coords_p, ++ codes_p)
+		{
+			const uint32 latitude_index = GetFixedLatitudeIndex (coords_p -> fc_latitude);
+			const uint32 longitude_index = GetFixedLongitudeIndex (coords_p -> fc_longitude);
+
+			*codes_p = _pdep_u64 (latitude_index, 0x5555555555555555ULL) | _pdep_u64 (longitude_index, 0xAAAAAAAAAAAAAAAAULL);
+		}
+}
+
+
+#endif
@@ -0,0 +1,529 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * geo_distance.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <math.h>
+
+#include "geo_distance.h"
+#include "task_threads.h"
+
+#include "memory_allocations.h"
+#include "streams.h"
+
+
+/* See the comment in geo_cell.c */
+#if defined (__GNUC__) && defined (__x86_64__)
+	#define GEO_DISTANCE_X86_KERNELS (1)
+	#include <immintrin.h>
+#endif
+
+
+#define GD_DEGREES_TO_RADIANS (0.017453292519943295)
+
+#define GD_HALF_PI (1.5707963267948966)
+
+/* The WGS84 ellipsoid */
+#define GD_WGS84_SEMI_MAJOR_AXIS (6378137.0)
+#define GD_WGS84_FLATTENING (1.0 / 298.257223563)
+#define GD_WGS84_SEMI_MINOR_AXIS ((1.0 - GD_WGS84_FLATTENING) * GD_WGS84_SEMI_MAJOR_AXIS)
+
+#define GD_VINCENTY_MAX_ITERATIONS (200)
+#define GD_VINCENTY_TOLERANCE (1e-12)
+
+/* The number of columns processed at a time, chosen so their values fit in the L1 cache */
+#define GD_TILE_COLUMNS (512)
+
+/* Matrices smaller than this many distances per thread are not worth splitting up */
+#define GD_MIN_DISTANCES_PER_THREAD (65536)
+
+
+/*
+ * The minimax polynomial P such that asin (t) ~= t + t * z * P (z) where
+ * z = t * t, for t in [0, 0.5]. Its relative error is below 1e-15.
+ */
+#define GD_ASIN_P0 (0.16666666666683827)
+#define GD_ASIN_P1 (0.07499999996103213)
+#define GD_ASIN_P2 (0.04464286021569228)
+#define GD_ASIN_P3 (0.030381823859469533)
+#define GD_ASIN_P4 (0.022374899206215434)
+#define GD_ASIN_P5 (0.017313813388173806)
+#define GD_ASIN_P6 (0.014324683487755575)
+#define GD_ASIN_P7 (0.009369540779838766)
+#define GD_ASIN_P8 (0.01828838577147652)
+#define GD_ASIN_P9 (-0.011763086501374077)
+#define GD_ASIN_P10 (0.03156478588660703)
+
+
+/*
+ * Each Coordinate is converted once into the three values that the
+ * distance calculations need, stored as separate arrays so that the
+ * kernels can load several columns at a time.
+ *
+ * For spherical distances these are the x, y and z components of the
+ * point on the unit sphere and for ellipsoidal distances they are the
+ * sine and cosine of the reduced latitude and the longitude in radians.
+ */
+typedef struct PreparedCoordinates
+{
+	double64 *pc_values_p [3];
+} PreparedCoordinates;
+
+
+typedef void (*SphericalKernel) (const double64 x, const double64 y, const double64 z, const double64 *xs_p, const double64 *ys_p, const double64 *zs_p, const size_t num_columns, double64 *distances_p);
+
+
+typedef struct DistanceMatrix
+{
+	const Coordinate *dm_rows_p;
+	const Coordinate *dm_columns_p;
+	PreparedCoordinates dm_prepared_rows;
+	PreparedCoordinates dm_prepared_columns;
+	size_t dm_num_rows;
+	size_t dm_num_columns;
+	GeoDistanceMethod dm_method;
+	SphericalKernel dm_spherical_kernel_fn;
+	double64 *dm_distances_p;
+} DistanceMatrix;
+
+
+typedef struct DistanceMatrixTask
+{
+	const DistanceMatrix *dmt_matrix_p;
+	size_t dmt_first_row;
+	size_t dmt_num_rows;
+} DistanceMatrixTask;
+
+
+static bool IsValidCoordinate (const Coordinate *coord_p);
+
+static bool PrepareCoordinates (PreparedCoordinates *prepared_p, double64 *values_p, const Coordinate *coords_p, const size_t num_coords, const GeoDistanceMethod method);
+
+static bool GetVincentyDistanceForValues (const double64 sin_u0, const double64 cos_u0, const double64 longitude0, const double64 sin_u1, const double64 cos_u1, const double64 longitude1, double64 *distance_p);
+
+static void GetReducedLatitude (const double64 latitude, double64 *sin_u_p, double64 *cos_u_p);
+
+static void RunDistanceMatrixTask (void *data_p);
+
+static void GetSphericalDistances (const double64 x, const double64 y, const double64 z, const double64 *xs_p, const double64 *ys_p, const double64 *zs_p, const size_t num_columns, double64 *distances_p);
+
+
+#ifdef GEO_DISTANCE_X86_KERNELS
+static void GetSphericalDistancesAVX2 (const double64 x, const double64 y, const double64 z, const double64 *xs_p, const double64 *ys_p, const double64 *zs_p, const size_t num_columns, double64 *distances_p);
+#endif
+
+
+
+double64 GetHaversineDistance (const Coordinate *coord0_p, const Coordinate *coord1_p)
+{
+	const double64 latitude0 = (coord0_p -> co_x) * GD_DEGREES_TO_RADIANS;
+	const double64 latitude1 = (coord1_p -> co_x) * GD_DEGREES_TO_RADIANS;
+	const double64 sin_half_latitude = sin (0.5 * (latitude1 - latitude0));
+	const double64 sin_half_longitude = sin (0.5 * ((coord1_p -> co_y) - (coord0_p -> co_y)) * GD_DEGREES_TO_RADIANS);
+	double64 h = (sin_half_latitude * sin_half_latitude) + (cos (latitude0) * cos (latitude1) * sin_half_longitude * sin_half_longitude);
+
+	/* Rounding can push h slightly over 1 for antipodal points */
+	if (h > 1.0)
+		{
+			h = 1.0;
+		}
+
+	return 2.0 * GEO_DISTANCE_EARTH_RADIUS * asin (sqrt (h));
+}
+
+
+bool GetVincentyDistance (const Coordinate *coord0_p, const Coordinate *coord1_p, double64 *distance_p)
+{
+	double64 sin_u0;
+	double64 cos_u0;
+	double64 sin_u1;
+	double64 cos_u1;
+
+	GetReducedLatitude ((coord0_p -> co_x) * GD_DEGREES_TO_RADIANS, &sin_u0, &cos_u0);
+	GetReducedLatitude ((coord1_p -> co_x) * GD_DEGREES_TO_RADIANS, &sin_u1, &cos_u1);
+
+	return GetVincentyDistanceForValues (sin_u0, cos_u0, (coord0_p -> co_y) * GD_DEGREES_TO_RADIANS, sin_u1, cos_u1, (coord1_p -> co_y) * GD_DEGREES_TO_RADIANS, distance_p);
+}
+
+
+bool GetCoordinateDistance (const Coordinate *coord0_p, const Coordinate *coord1_p, const GeoDistanceMethod method, double64 *distance_p)
+{
+	bool success_flag = false;
+
+	switch (method)
+		{
+			case GDM_SPHERICAL:
+				*distance_p = GetHaversineDistance (coord0_p, coord1_p);
+				success_flag = true;
+				break;
+
+			case GDM_ELLIPSOIDAL:
+				success_flag = GetVincentyDistance (coord0_p, coord1_p, distance_p);
+				break;
+
+			default:
+				PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Unknown distance method %d", method);
+				break;
+		}
+
+	return success_flag;
+}
+
+
+bool GetDistanceMatrix (const Coordinate *rows_p, const size_t num_rows, const Coordinate *columns_p, const size_t num_columns, const GeoDistanceMethod method, const uint32 num_threads, double64 *distances_p)
+{
+	bool success_flag = false;
+	double64 *values_p;
+
+	if ((num_rows == 0) || (num_columns == 0))
+		{
+			return true;
+		}
+
+	if ((method != GDM_SPHERICAL) && (method != GDM_ELLIPSOIDAL))
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Unknown distance method %d", method);
+			return false;
+		}
+
+	values_p = (double64 *) AllocMemory (3 * (num_rows + num_columns) * sizeof (double64));
+
+	if (values_p)
+		{
+			DistanceMatrix matrix;
+
+			matrix.dm_rows_p = rows_p;
+			matrix.dm_columns_p = columns_p;
+			matrix.dm_num_rows = num_rows;
+			matrix.dm_num_columns = num_columns;
+			matrix.dm_method = method;
+			matrix.dm_distances_p = distances_p;
+			matrix.dm_spherical_kernel_fn = GetSphericalDistances;
+
+#ifdef GEO_DISTANCE_X86_KERNELS
+			if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma"))
+				{
+					matrix.dm_spherical_kernel_fn = GetSphericalDistancesAVX2;
+				}
+#endif
+
+			if (PrepareCoordinates (& (matrix.dm_prepared_rows), values_p, rows_p, num_rows, method) &&
+				PrepareCoordinates (& (matrix.dm_prepared_columns), values_p + (3 * num_rows), columns_p, num_columns, method))
+				{
+					uint32 threads_to_use = GetNumberOfTaskThreads (num_threads, num_rows * num_columns, GD_MIN_DISTANCES_PER_THREAD);
+					DistanceMatrixTask *tasks_p;
+
+					/* Each thread needs at least one row */
+					if (threads_to_use > num_rows)
+						{
+							threads_to_use = (uint32) num_rows;
+						}
+
+					tasks_p = (DistanceMatrixTask *) AllocMemory (threads_to_use * sizeof (DistanceMatrixTask));
+
+					if (tasks_p)
+						{
+							const size_t rows_per_task = num_rows / threads_to_use;
+							const size_t num_extra_rows = num_rows % threads_to_use;
+							size_t first_row = 0;
+							uint32 i;
+
+							for (i = 0; i < threads_to_use; ++ i)
+								{
+									DistanceMatrixTask *task_p = tasks_p + i;
+
+									task_p -> dmt_matrix_p = &matrix;
+									task_p -> dmt_first_row = first_row;
+									task_p -> dmt_num_rows = rows_per_task + ((i < num_extra_rows) ? 1 : 0);
+
+									first_row += task_p -> dmt_num_rows;
+								}
+
+							RunTasksOnThreads (RunDistanceMatrixTask, tasks_p, sizeof (DistanceMatrixTask), threads_to_use);
+
+							success_flag = true;
+
+							FreeMemory (tasks_p);
+						}
+				}
+
+			FreeMemory (values_p);
+		}
+
+	if (!success_flag)
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to calculate " SIZET_FMT " x " SIZET_FMT " distance matrix", num_rows, num_columns);
+		}
+
+	return success_flag;
+}
+
+
+static void RunDistanceMatrixTask (void *data_p)
+{
+	const DistanceMatrixTask *task_p = (const DistanceMatrixTask *) data_p;
+	const DistanceMatrix *matrix_p = task_p -> dmt_matrix_p;
+	double64 * const *row_values_pp = matrix_p -> dm_prepared_rows.pc_values_p;
+	double64 * const *column_values_pp = matrix_p -> dm_prepared_columns.pc_values_p;
+	const size_t last_row = task_p -> dmt_first_row + task_p -> dmt_num_rows;
+	size_t first_column;
+
+	/*
+	 * Work through the columns a tile at a time, running every row of
+	 * this task against each tile while its values are in the cache.
+	 */
+	for (first_column = 0; first_column < matrix_p -> dm_num_columns; first_column += GD_TILE_COLUMNS)
+		{
+			const size_t num_tile_columns = (matrix_p -> dm_num_columns - first_column < GD_TILE_COLUMNS) ? (matrix_p -> dm_num_columns - first_column) : GD_TILE_COLUMNS;
+			size_t row;
+
+			for (row = task_p -> dmt_first_row; row < last_row; ++ row)
+				{
+					double64 *distances_p = matrix_p -> dm_distances_p + (row * (matrix_p -> dm_num_columns)) + first_column;
+
+					if (matrix_p -> dm_method == GDM_SPHERICAL)
+						{
+							matrix_p -> dm_spherical_kernel_fn (row_values_pp [0][row], row_values_pp [1][row], row_values_pp [2][row],
+								column_values_pp [0] + first_column, column_values_pp [1] + first_column, column_values_pp [2] + first_column, num_tile_columns, distances_p);
+						}
+					else
+						{
+							size_t i;
+
+							for (i = 0; i < num_tile_columns; ++ i, ++ distances_p)
+								{
+									const size_t column = first_column + i;
+
+									if (!GetVincentyDistanceForValues (row_values_pp [0][row], row_values_pp [1][row], row_values_pp [2][row],
+										column_values_pp [0][column], column_values_pp [1][column], column_values_pp [2][column], distances_p))
+										{
+											*distances_p = GetHaversineDistance (matrix_p -> dm_rows_p + row, matrix_p -> dm_columns_p + column);
+										}
+								}
+						}
+				}
+		}
+}
+
+
+static bool PrepareCoordinates (PreparedCoordinates *prepared_p, double64 *values_p, const Coordinate *coords_p, const size_t num_coords, const GeoDistanceMethod method)
+{
+	size_t i;
+
+	prepared_p -> pc_values_p [0] = values_p;
+	prepared_p -> pc_values_p [1] = values_p + num_coords;
+	prepared_p -> pc_values_p [2] = values_p + (2 * num_coords);
+
+	for (i = 0; i < num_coords; ++ i, ++ coords_p)
+		{
+			const double64 latitude = (coords_p -> co_x) * GD_DEGREES_TO_RADIANS;
+			const double64 longitude = (coords_p -> co_y) * GD_DEGREES_TO_RADIANS;
+
+			if (!IsValidCoordinate (coords_p))
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Invalid coordinate [" DOUBLE64_FMT ", " DOUBLE64_FMT "]", coords_p -> co_x, coords_p -> co_y);
+					return false;
+				}
+
+			if (method == GDM_SPHERICAL)
+				{
+					const double64 cos_latitude = cos (latitude);
+
+					prepared_p -> pc_values_p [0][i] = cos_latitude * cos (longitude);
+					prepared_p -> pc_values_p [1][i] = cos_latitude * sin (longitude);
+					prepared_p -> pc_values_p [2][i] = sin (latitude);
+				}
+			else
+				{
+					GetReducedLatitude (latitude, & (prepared_p -> pc_values_p [0][i]), & (prepared_p -> pc_values_p [1][i]));
+					prepared_p -> pc_values_p [2][i] = longitude;
+				}
+		}
+
+	return true;
+}
+
+
+static bool IsValidCoordinate (const Coordinate *coord_p)
+{
+	/* This also catches NaNs */
+	return ((coord_p -> co_x >= -90.0) && (coord_p -> co_x <= 90.0) && (coord_p -> co_y >= -360.0) && (coord_p -> co_y <= 360.0));
+}
+
+
+/*
+ * The chord between two points on the unit sphere has length 2 sin (d / 2)
+ * where d is the angle between them, which is what the haversine formula
+ * calculates. Working from the chord keeps all of the trigonometry in
+ * PrepareCoordinates () so each distance needs just a square root and an
+ * arcsine.
+ */
+static void GetSphericalDistances (const double64 x, const double64 y, const double64 z, const double64 *xs_p, const double64 *ys_p, const double64 *zs_p, const size_t num_columns, double64 *distances_p)
+{
+	size_t i;
+
+	for (i = 0; i < num_columns; ++ i)
+		{
+			const double64 dx = xs_p [i] - x;
+			const double64 dy = ys_p [i] - y;
+			const double64 dz = zs_p [i] - z;
+			double64 s = 0.5 * sqrt ((dx * dx) + (dy * dy) + (dz * dz));
+			double64 a;
+
+			if (s > 1.0)
+				{
+					s = 1.0;
+				}
+
+			a = asin (s);
+
+			distances_p [i] = 2.0 * GEO_DISTANCE_EARTH_RADIUS * a;
+		}
+}
+
+
+static void GetReducedLatitude (const double64 latitude, double64 *sin_u_p, double64 *cos_u_p)
+{
+	const double64 u = atan ((1.0 - GD_WGS84_FLATTENING) * tan (latitude));
+
+	*sin_u_p = sin (u);
+	*cos_u_p = cos (u);
+}
+
+
+static bool GetVincentyDistanceForValues (const double64 sin_u0, const double64 cos_u0, const double64 longitude0, const double64 sin_u1, const double64 cos_u1, const double64 longitude1, double64 *distance_p)
+{
+	const double64 a = GD_WGS84_SEMI_MAJOR_AXIS;
+	const double64 b = GD_WGS84_SEMI_MINOR_AXIS;
+	const double64 f = GD_WGS84_FLATTENING;
+	const double64 l = longitude1 - longitude0;
+	double64 lambda = l;
+	double64 sin_sigma;
+	double64 cos_sigma;
+	double64 sigma;
+	double64 cos_sq_alpha;
+	double64 cos_2_sigma_m;
+	uint32 i;
+
+	for (i = 0; i < GD_VINCENTY_MAX_ITERATIONS; ++ i)
+		{
+			const double64 sin_lambda = sin (lambda);
+			const double64 cos_lambda = cos (lambda);
+			const double64 t0 = cos_u1 * sin_lambda;
+			const double64 t1 = (cos_u0 * sin_u1) - (sin_u0 * cos_u1 * cos_lambda);
+			double64 sin_alpha;
+			double64 c;
+			double64 previous_lambda;
+
+			sin_sigma = sqrt ((t0 * t0) + (t1 * t1));
+
+			if (sin_sigma == 0.0)
+				{
+					/* The points are the same */
+					*distance_p = 0.0;
+					return true;
+				}
+
+			cos_sigma = (sin_u0 * sin_u1) + (cos_u0 * cos_u1 * cos_lambda);
+			sigma = atan2 (sin_sigma, cos_sigma);
+			sin_alpha = cos_u0 * cos_u1 * sin_lambda / sin_sigma;
+			cos_sq_alpha = 1.0 - (sin_alpha * sin_alpha);
+
+			/* Both points are on the equator */
+			cos_2_sigma_m = (cos_sq_alpha != 0.0) ? (cos_sigma - (2.0 * sin_u0 * sin_u1 / cos_sq_alpha)) : 0.0;
+
+			c = (f / 16.0) * cos_sq_alpha * (4.0 + f * (4.0 - 3.0 * cos_sq_alpha));
+
+			previous_lambda = lambda;
+			lambda = l + (1.0 - c) * f * sin_alpha * (sigma + c * sin_sigma * (cos_2_sigma_m + c * cos_sigma * (-1.0 + 2.0 * cos_2_sigma_m * cos_2_sigma_m)));
+
+			if (fabs (lambda - previous_lambda) < GD_VINCENTY_TOLERANCE)
+				{
+					const double64 u_sq = cos_sq_alpha * ((a * a) - (b * b)) / (b * b);
+					const double64 big_a = 1.0 + (u_sq / 16384.0) * (4096.0 + u_sq * (-768.0 + u_sq * (320.0 - 175.0 * u_sq)));
+					const double64 big_b = (u_sq / 1024.0) * (256.0 + u_sq * (-128.0 + u_sq * (74.0 - 47.0 * u_sq)));
+					const double64 delta_sigma = big_b * sin_sigma * (cos_2_sigma_m + (big_b / 4.0) * (cos_sigma * (-1.0 + 2.0 * cos_2_sigma_m * cos_2_sigma_m) -
+						(big_b / 6.0) * cos_2_sigma_m * (-3.0 + 4.0 * sin_sigma * sin_sigma) * (-3.0 + 4.0 * cos_2_sigma_m * cos_2_sigma_m)));
+
+					*distance_p = b * big_a * (sigma - delta_sigma);
+					return true;
+				}
+		}
+
+	return false;
+}
+
+
+#ifdef GEO_DISTANCE_X86_KERNELS
+
+
+/*
+ * The vector version of GetSphericalDistances (). AVX2 has no arcsine so
+ * it uses the polynomial above, with asin (s) = pi / 2 - 2 asin (sqrt ((1 - s) / 2))
+ * for s > 0.5. The results agree with the scalar version to within a
+ * few units in the last place.
+ */
+__attribute__ ((target ("avx2,fma")))
+static void GetSphericalDistancesAVX2 (const double64 x, const double64 y, const double64 z, const double64 *xs_p, const double64 *ys_p, const double64 *zs_p, const size_t num_columns, double64 *distances_p)
+{
+	const __m256d row_x = _mm256_set1_pd (x);
+	const __m256d row_y = _mm256_set1_pd (y);
+	const __m256d row_z = _mm256_set1_pd (z);
+	const __m256d half = _mm256_set1_pd (0.5);
+	const __m256d one = _mm256_set1_pd (1.0);
+	const __m256d half_pi = _mm256_set1_pd (GD_HALF_PI);
+	const __m256d minus_two = _mm256_set1_pd (-2.0);
+	const __m256d diameter = _mm256_set1_pd (2.0 * GEO_DISTANCE_EARTH_RADIUS);
+	size_t i = 0;
+
+	for ( ; i + 4 <= num_columns; i += 4)
+		{
+			const __m256d dx = _mm256_sub_pd (_mm256_loadu_pd (xs_p + i), row_x);
+			const __m256d dy = _mm256_sub_pd (_mm256_loadu_pd (ys_p + i), row_y);
+			const __m256d dz = _mm256_sub_pd (_mm256_loadu_pd (zs_p + i), row_z);
+			const __m256d s = _mm256_min_pd (_mm256_mul_pd (half, _mm256_sqrt_pd (_mm256_fmadd_pd (dx, dx, _mm256_fmadd_pd (dy, dy, _mm256_mul_pd (dz, dz))))), one);
+			const __m256d large = _mm256_cmp_pd (s, half, _CMP_GT_OQ);
+			const __m256d zz = _mm256_blendv_pd (_mm256_mul_pd (s, s), _mm256_mul_pd (half, _mm256_sub_pd (one, s)), large);
+			const __m256d t = _mm256_blendv_pd (s, _mm256_sqrt_pd (zz), large);
+			__m256d p = _mm256_set1_pd (GD_ASIN_P10);
+			__m256d r;
+
+			p = _mm256_fmadd_pd (p, zz, _mm256_set1_pd (GD_ASIN_P9));
+			p = _mm256_fmadd_pd (p, zz, _mm256_set1_pd (GD_ASIN_P8));
+			p = _mm256_fmadd_pd (p, zz, _mm256_set1_pd (GD_ASIN_P7));
+			p = _mm256_fmadd_pd (p, zz, _mm256_set1_pd (GD_ASIN_P6));
+			p = _mm256_fmadd_pd (p, zz, _mm256_set1_pd (GD_ASIN_P5));
+			p = _mm256_fmadd_pd (p, zz, _mm256_set1_pd (GD_ASIN_P4));
+			p = _mm256_fmadd_pd (p, zz, _mm256_set1_pd (GD_ASIN_P3));
+			p = _mm256_fmadd_pd (p, zz, _mm256_set1_pd (GD_ASIN_P2));
+			p = _mm256_fmadd_pd (p, zz, _mm256_set1_pd (GD_ASIN_P1));
+			p = _mm256_fmadd_pd (p, zz, _mm256_set1_pd (GD_ASIN_P0));
+
+			r = _mm256_fmadd_pd (_mm256_mul_pd (t, zz), p, t);
+			r = _mm256_blendv_pd (r, _mm256_fmadd_pd (minus_two, r, half_pi), large);
+
+			_mm256_storeu_pd (distances_p + i, _mm256_mul_pd (diameter, r));
+		}
+
+	GetSphericalDistances (x, y, z, xs_p + i, ys_p + i, zs_p + i, num_columns - i, distances_p + i);
+}
+
+
+#endif
@@ -8,6 +8,12 @@
 #include <ctype.h>
 #include <string.h>
 
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <pthread.h>
+#endif
+
 #include "typedefs.h"
 #include "math_utils.h"
 #include "streams.h"
@@ -21,28 +27,89 @@
 #include "coordinate.h"
 #include "grassroots_server.h"
 #include "string_utils.h"
+#include "url_escape.h"
+#include "json_stream.h"
+#include "coordinate_parser.h"
 
 #include "google.h"
 #include "nominatim.h"
+#include "query_strategy.h"
+
+
+/*
+ * The GeocoderTool for each GrassrootsServer that has called
+ * DetermineGPSLocationForAddress () or DetermineAddressForGPSLocation ()
+ * without one of its own. Building a GeocoderTool means loading its
+ * admin regions and address cache and filling its TownMatcher and
+ * AddressSplitter from them, so this is only done once for each server.
+ */
+typedef struct CachedGeocoderTool
+{
+	GrassrootsServer *cgt_grassroots_p;
+
+	/* This is NULL if the server's configuration doesn't have a usable geocoder */
+	GeocoderTool *cgt_tool_p;
+
+	struct CachedGeocoderTool *cgt_next_p;
+} CachedGeocoderTool;
+
+
+static CachedGeocoderTool *s_cached_tools_p = NULL;
+
+#ifdef _WIN32
+static SRWLOCK s_cached_tools_lock = SRWLOCK_INIT;
+#else
+static pthread_mutex_t s_cached_tools_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 
 static GeocoderTool *AllocateGeocoderTool (void);
 
-static void FreeGeocoderTool (GeocoderTool *config_p);
+static GeocoderTool *GetCachedGeocoderTool (GrassrootsServer *grassroots_p);
+
+static void LockCachedTools (void);
 
-static GeocoderTool *GetGecoderToolFromGrassrootsConfig (GrassrootsServer *grassroots_p);
+static void UnlockCachedTools (void);
 
 static bool DoGeocoding (GeocoderTool *tool_p, Address *address_p);
 
 static bool DoReverseGeocoding (GeocoderTool *tool_p, Address *address_p);
 
+static bool SetLocationFromAddressText (Address *address_p);
+
+static const CountryLocation *GetAddressCountryLocation (const Address *address_p);
+
+static bool IsCountryOnlyAddress (const Address *address_p);
+
+static bool SetLocationFromCountry (Address *address_p, const CountryLocation *country_p);
+
+static Address *SplitAddressForGeocoding (const AddressSplitter *splitter_p, Address *address_p);
+
+static void SwapStrings (char **value0_ss, char **value1_ss);
+
+static bool IsBlankString (const char *value_s);
+
+static bool SetGeocoderToolFromConfig (GeocoderTool *tool_p, const json_t *geocoder_config_p, const char *name_s);
+
+static TownMatcher *SetUpTownMatcher (const GeocoderTool *tool_p);
+
+static AddressSplitter *SetUpAddressSplitter (const GeocoderTool *tool_p);
+
+static bool RunTemplateGeocoder (Address *address_p, const URLTemplate *template_p, int (*parse_results_fn) (Address *address_p, const json_t *web_service_results_p), ParseRawResultsFunction parse_raw_results_fn);
+
+static const char *GetGeocoderWebServiceResponse (CurlTool *curl_tool_p, const char *url_s);
+
+static const char *GetURLWithoutSpaces (const char *url_s, char **copied_url_ss);
+
+static size_t WriteToJSONStreamParser (char *data_p, size_t size, size_t num_items, void *parser_p);
+
 
 
 static bool SetCoordinateFromOpencage (const json_t *coords_p, Address *address_p, bool (*set_coord_fn) (Address *address_p, const double64 latitude, const double64 longitude, const double64 *elevation_p));
 
 
 
-static GeocoderTool *GetGecoderToolFromGrassrootsConfig (GrassrootsServer *grassroots_p)
+GeocoderTool *AllocateGeocoderToolFromGrassrootsConfig (GrassrootsServer *grassroots_p)
 {
 	GeocoderTool *tool_p = AllocateGeocoderTool ();
 
@@ -73,8 +140,11 @@ static GeocoderTool *GetGecoderToolFromGrassrootsConfig (GrassrootsServer *grass
 
 														if (name_s && (strcmp (name_s, value_s) == 0))
 															{
-																tool_p -> gt_geocoder_url_s = GetJSONString (geocoder_p, "geocode_url");
-																tool_p -> gt_reverse_geocoder_url_s = GetJSONString (geocoder_p, "reverse_geocode_url");
+																if (SetGeocoderToolFromConfig (tool_p, geocoder_p, value_s))
+																	{
+																		return tool_p;
+																	}
+
 																i = size;
 															}
 														else
@@ -89,40 +159,13 @@ static GeocoderTool *GetGecoderToolFromGrassrootsConfig (GrassrootsServer *grass
 
 												if (name_s && (strcmp (name_s, value_s) == 0))
 													{
-														tool_p -> gt_geocoder_url_s = GetJSONString (geocoders_p, "geocode_url");
-													}
-											}
-
-										if (tool_p -> gt_geocoder_url_s)
-											{
-												if (Stricmp (value_s, "google") == 0)
-													{
-														tool_p -> gt_geocoder_fn = RunGoogleGeocoder;
-													}
-												else if (Stricmp (value_s, "opencage") == 0)
-													{
-														tool_p -> gt_geocoder_fn = DetermineGPSLocationForAddressByOpencage;
-													}
-												else if (Stricmp (value_s, "locationiq") == 0)
-													{
-														tool_p -> gt_geocoder_fn = DetermineGPSLocationForAddressByLocationIQ;
-													}
-												else if (Stricmp (value_s, "nominatim") == 0)
-													{
-														tool_p -> gt_geocoder_fn = RunNominatimGeocoder;
-
-														if (tool_p -> gt_reverse_geocoder_url_s)
+														if (SetGeocoderToolFromConfig (tool_p, geocoders_p, value_s))
 															{
-																tool_p -> gt_reverse_geocoder_fn = RunNominatimReverseGeocoder;
+																return tool_p;
 															}
 													}
-
-												if (tool_p -> gt_geocoder_fn)
-													{
-														return tool_p;
-													}
-
 											}
+
 									}
 							}
 
@@ -136,22 +179,272 @@ static GeocoderTool *GetGecoderToolFromGrassrootsConfig (GrassrootsServer *grass
 }
 
 
+static bool SetGeocoderToolFromConfig (GeocoderTool *tool_p, const json_t *geocoder_config_p, const char *name_s)
+{
+	const char *template_s = GetJSONString (geocoder_config_p, "geocode_template");
+	const char *format_s = GetJSONString (geocoder_config_p, "response_format");
+	const char *parser_s = GetJSONString (geocoder_config_p, "response_parser");
+	const char *admin_regions_s = GetJSONString (geocoder_config_p, "admin_regions_file");
+	const char *address_cache_s = GetJSONString (geocoder_config_p, "address_cache_file");
+	const char *query_forms_s = GetJSONString (geocoder_config_p, "query_forms");
+	bool on_demand_flag = false;
+
+	tool_p -> gt_geocoder_url_s = GetJSONString (geocoder_config_p, "geocode_url");
+	tool_p -> gt_reverse_geocoder_url_s = GetJSONString (geocoder_config_p, "reverse_geocode_url");
+
+	if (admin_regions_s)
+		{
+			tool_p -> gt_admin_regions_p = OpenAdminRegionIndex (admin_regions_s);
+
+			if (! (tool_p -> gt_admin_regions_p))
+				{
+					PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to open admin_regions_file \"%s\" for \"%s\"", admin_regions_s, name_s);
+				}
+		}
+
+	if (address_cache_s)
+		{
+			tool_p -> gt_address_cache_p = OpenAddressRecordFile (address_cache_s);
+
+			if (! (tool_p -> gt_address_cache_p))
+				{
+					PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to open address_cache_file \"%s\" for \"%s\"", address_cache_s, name_s);
+				}
+		}
+
+	if ((tool_p -> gt_admin_regions_p) || (tool_p -> gt_address_cache_p))
+		{
+			tool_p -> gt_town_matcher_p = SetUpTownMatcher (tool_p);
+
+			if (! (tool_p -> gt_town_matcher_p))
+				{
+					PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to set up town matching for \"%s\"", name_s);
+				}
+
+			tool_p -> gt_address_splitter_p = SetUpAddressSplitter (tool_p);
+
+			if (! (tool_p -> gt_address_splitter_p))
+				{
+					PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to set up address splitting for \"%s\"", name_s);
+				}
+		}
+
+	/*
+	 * If there isn't an explicit response format, then assume
+	 * that the geocoder's name is one that we know about
+	 */
+	if (!format_s)
+		{
+			format_s = name_s;
+		}
+
+	if (parser_s)
+		{
+			if (Stricmp (parser_s, "on_demand") == 0)
+				{
+					on_demand_flag = true;
+				}
+			else if (Stricmp (parser_s, "jansson") != 0)
+				{
+					PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Unknown response_parser \"%s\" for \"%s\", using jansson", parser_s, name_s);
+				}
+		}
+
+	if (tool_p -> gt_geocoder_url_s)
+		{
+			if (Stricmp (name_s, "google") == 0)
+				{
+					tool_p -> gt_geocoder_fn = RunGoogleGeocoder;
+				}
+			else if (Stricmp (name_s, "opencage") == 0)
+				{
+					tool_p -> gt_geocoder_fn = DetermineGPSLocationForAddressByOpencage;
+				}
+			else if (Stricmp (name_s, "locationiq") == 0)
+				{
+					tool_p -> gt_geocoder_fn = DetermineGPSLocationForAddressByLocationIQ;
+				}
+			else if (Stricmp (name_s, "nominatim") == 0)
+				{
+					tool_p -> gt_geocoder_fn = RunNominatimGeocoder;
+
+					if (tool_p -> gt_reverse_geocoder_url_s)
+						{
+							tool_p -> gt_reverse_geocoder_fn = RunNominatimReverseGeocoder;
+						}
+				}
+		}
+
+	/*
+	 * The QueryModes are process-wide, so if servers in the same process
+	 * set different ones, the last to build its GeocoderTool wins. As each
+	 * server's GeocoderTool is only built once, this is only done when the
+	 * server starts using it.
+	 */
+	if (query_forms_s)
+		{
+			QueryMode mode;
+
+			if (GetQueryModeFromString (query_forms_s, &mode))
+				{
+					if (tool_p -> gt_geocoder_fn == RunGoogleGeocoder)
+						{
+							SetQueryMode (QP_GOOGLE, mode);
+						}
+					else if (tool_p -> gt_geocoder_fn == RunNominatimGeocoder)
+						{
+							SetQueryMode (QP_NOMINATIM, mode);
+						}
+					else
+						{
+							PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "query_forms is only used by the google and nominatim geocode_urls, ignoring it for \"%s\"", name_s);
+						}
+				}
+			else
+				{
+					PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Unknown query_forms \"%s\" for \"%s\"", query_forms_s, name_s);
+				}
+		}
+
+	if (Stricmp (format_s, "google") == 0)
+		{
+			tool_p -> gt_parse_results_fn = ParseGoogleResults;
+			tool_p -> gt_parse_reverse_results_fn = ParseGoogleResults;
+
+			if (on_demand_flag)
+				{
+					tool_p -> gt_parse_raw_results_fn = ParseGoogleResultsOnDemand;
+				}
+		}
+	else if (Stricmp (format_s, "nominatim") == 0)
+		{
+			tool_p -> gt_parse_results_fn = ParseNominatimResults;
+			tool_p -> gt_parse_reverse_results_fn = PopulateAddressForNominatim;
+
+			if (on_demand_flag)
+				{
+					tool_p -> gt_parse_raw_results_fn = ParseNominatimResultsOnDemand;
+				}
+		}
+
+	if (template_s)
+		{
+			if (tool_p -> gt_parse_results_fn)
+				{
+					tool_p -> gt_geocoder_template_p = AllocateURLTemplate (template_s);
+
+					if (! (tool_p -> gt_geocoder_template_p))
+						{
+							PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to compile geocode_template \"%s\" for \"%s\"", template_s, name_s);
+						}
+				}
+			else
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Unknown response_format \"%s\" for \"%s\"", format_s, name_s);
+				}
+		}
+
+	template_s = GetJSONString (geocoder_config_p, "reverse_geocode_template");
+
+	if (template_s)
+		{
+			if (tool_p -> gt_parse_reverse_results_fn)
+				{
+					tool_p -> gt_reverse_geocoder_template_p = AllocateURLTemplate (template_s);
+
+					if (! (tool_p -> gt_reverse_geocoder_template_p))
+						{
+							PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to compile reverse_geocode_template \"%s\" for \"%s\"", template_s, name_s);
+						}
+				}
+			else
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Unknown response_format \"%s\" for \"%s\"", format_s, name_s);
+				}
+		}
+
+	return ((tool_p -> gt_geocoder_fn) || (tool_p -> gt_geocoder_template_p) || (tool_p -> gt_admin_regions_p) || (tool_p -> gt_address_cache_p));
+}
+
+
 
 
 bool DetermineGPSLocationForAddress (Address *address_p, GeocoderTool *tool_p, GrassrootsServer *grassroots_p)
 {
 	bool success_flag = false;
+	const CountryLocation *country_p = NULL;
+
+	/* If the Address already has its coordinates, there's no need for a geocoder */
+	if (SetLocationFromAddressText (address_p))
+		{
+			return true;
+		}
+
+	/* Nor is there if all that we have is the country */
+	country_p = GetAddressCountryLocation (address_p);
+
+	if (country_p && IsCountryOnlyAddress (address_p))
+		{
+			return SetLocationFromCountry (address_p, country_p);
+		}
 
 	if (!tool_p)
 		{
-			tool_p = GetGecoderToolFromGrassrootsConfig (grassroots_p);
+			tool_p = GetCachedGeocoderTool (grassroots_p);
 		}
 
 	if (tool_p)
 		{
-			success_flag = DoGeocoding (tool_p, address_p);
+			Address *query_address_p = address_p;
+			Address *split_address_p = NULL;
+
+			/* Give the geocoders a structured query rather than a single blob of text */
+			if ((tool_p -> gt_address_splitter_p) && (IsFreeTextAddress (address_p)))
+				{
+					split_address_p = SplitAddressForGeocoding (tool_p -> gt_address_splitter_p, address_p);
+
+					if (split_address_p)
+						{
+							query_address_p = split_address_p;
+						}
+				}
+
+			if (tool_p -> gt_town_matcher_p)
+				{
+					/*
+					 * Fix any misspelling of the town before it is looked up,
+					 * as the geocoders often can't find misspelt towns
+					 */
+					CorrectAddressTown (tool_p -> gt_town_matcher_p, query_address_p);
+
+					success_flag = SetAddressFromTownMatcherCache (tool_p -> gt_town_matcher_p, query_address_p);
+				}
+
+			if (!success_flag)
+				{
+					success_flag = DoGeocoding (tool_p, query_address_p);
+				}
+
+			if (split_address_p)
+				{
+					if (success_flag)
+						{
+							success_flag = CopyAddressLocation (address_p, split_address_p);
+						}
+
+					FreeAddress (split_address_p);
+				}
 		}		/* if (config_p) */
 
+	/*
+	 * If the rest of the Address couldn't be found, the country is
+	 * still better than nothing.
+	 */
+	if ((!success_flag) && country_p)
+		{
+			success_flag = SetLocationFromCountry (address_p, country_p);
+		}
+
 	return success_flag;
 }
 
@@ -162,7 +455,7 @@ bool DetermineAddressForGPSLocation (Address *address_p, GeocoderTool *tool_p, G
 
 	if (!tool_p)
 		{
-			tool_p = GetGecoderToolFromGrassrootsConfig (grassroots_p);
+			tool_p = GetCachedGeocoderTool (grassroots_p);
 		}
 
 	if (tool_p)
@@ -177,89 +470,223 @@ bool DetermineAddressForGPSLocation (Address *address_p, GeocoderTool *tool_p, G
 int CallGeocoderWebService (CurlTool *curl_tool_p, const char *url_s, Address *address_p, int (*parse_results_fn) (Address *address_p, const json_t *web_service_results_p))
 {
 	int res = -1;
-	char *escaped_url_s = EasyCopyToNewString (url_s);
+	const char *response_s = GetGeocoderWebServiceResponse (curl_tool_p, url_s);
 
-	if (escaped_url_s)
+	if (response_s)
 		{
-			ReplaceChars (escaped_url_s, ' ', '+');
+			json_error_t error;
+			json_t *raw_res_p = NULL;
+
+			PrintLog (STM_LEVEL_FINER, __FILE__, __LINE__, "geo response for %s\n%s\n", url_s, response_s);
 
-			if (SetUriForCurlTool (curl_tool_p, escaped_url_s))
+			raw_res_p = json_loads (response_s, 0, &error);
+
+			if (raw_res_p)
+				{
+					res = parse_results_fn (address_p, raw_res_p);
+
+					json_decref (raw_res_p);
+				}		/* if (raw_res_p) */
+			else
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to parse \"%s\" as json from \"%s\"", response_s, url_s);
+				}
+
+		}		/* if (response_s) */
+
+	return res;
+}
+
+
+int CallGeocoderWebServiceOnDemand (CurlTool *curl_tool_p, const char *url_s, Address *address_p, ParseRawResultsFunction parse_raw_results_fn)
+{
+	int res = -1;
+	const char *response_s = GetGeocoderWebServiceResponse (curl_tool_p, url_s);
+
+	if (response_s)
+		{
+			res = parse_raw_results_fn (address_p, response_s, strlen (response_s));
+		}
+
+	return res;
+}
+
+
+/*
+ * Call a web service and get its full response.
+ */
+static const char *GetGeocoderWebServiceResponse (CurlTool *curl_tool_p, const char *url_s)
+{
+	const char *response_s = NULL;
+	char *escaped_url_s = NULL;
+	const char *full_url_s = GetURLWithoutSpaces (url_s, &escaped_url_s);
+
+	if (full_url_s)
+		{
+			if (SetUriForCurlTool (curl_tool_p, full_url_s))
 				{
 					CURLcode c = RunCurlTool (curl_tool_p);
 
 					if (c == CURLE_OK)
 						{
-							const char *response_s = GetCurlToolData (curl_tool_p);
+							response_s = GetCurlToolData (curl_tool_p);
 
-							if (response_s)
+							if (!response_s)
 								{
-									json_error_t error;
-									json_t *raw_res_p = NULL;
+									PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to get response data from CurlTool for \"%s\"", url_s);
+								}
 
-									PrintLog (STM_LEVEL_INFO, __FILE__, __LINE__, "geo response for %s\n%s\n", url_s, response_s);
+						}		/* if (c == CURLE_OK) */
+					else
+						{
+							PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Error calling \"%s\"for CurlTool, error \"%s\"", url_s, curl_easy_strerror (c));
+						}
 
-									raw_res_p = json_loads (response_s, 0, &error);
+				}		/* if (SetUriForCurlTool (curl_tool_p, url_s)) */
+			else
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to set URL for CurlTool to \"%s\"", url_s);
+				}
 
-									if (raw_res_p)
+
+			if (escaped_url_s)
+				{
+					FreeCopiedString (escaped_url_s);
+				}
+
+		}		/* if (full_url_s) */
+	else
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to copy url \"%s\"", url_s);
+		}
+
+	return response_s;
+}
+
+
+bool CallGeocoderWebServiceStreaming (CurlTool *curl_tool_p, const char *url_s, JSONStreamCallback callback_fn, void *callback_data_p)
+{
+	bool success_flag = false;
+	char *escaped_url_s = NULL;
+	const char *full_url_s = GetURLWithoutSpaces (url_s, &escaped_url_s);
+
+	if (full_url_s)
+		{
+			JSONStreamParser parser;
+
+			if (InitJSONStreamParser (&parser, callback_fn, callback_data_p))
+				{
+					if (SetUriForCurlTool (curl_tool_p, full_url_s))
+						{
+							/*
+							 * Parse the response as it arrives rather than storing it in the CurlTool's buffer
+							 */
+							if ((curl_easy_setopt (curl_tool_p -> ct_curl_p, CURLOPT_WRITEFUNCTION, WriteToJSONStreamParser) == CURLE_OK) &&
+									(curl_easy_setopt (curl_tool_p -> ct_curl_p, CURLOPT_WRITEDATA, &parser) == CURLE_OK))
+								{
+									CURLcode c = RunCurlTool (curl_tool_p);
+
+									if (c == CURLE_OK)
 										{
-											res = parse_results_fn (address_p, raw_res_p);
+											success_flag = ((parser.jsp_status == JSS_STOP) || (IsJSONStreamParserComplete (&parser)));
 
-											json_decref (raw_res_p);
-										}		/* if (raw_res_p) */
+											if (!success_flag)
+												{
+													PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Incomplete JSON response from \"%s\"", url_s);
+												}
+										}
+									else if ((c == CURLE_WRITE_ERROR) && (parser.jsp_status == JSS_STOP))
+										{
+											/* We stopped the transfer as we had all of the values that we needed */
+											PrintLog (STM_LEVEL_FINE, __FILE__, __LINE__, "Stopped reading response from \"%s\" early", url_s);
+
+											success_flag = true;
+										}
 									else
 										{
-											PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to parse \"%s\" as json from \"%s\"", response_s, url_s);
+											PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Error calling \"%s\"for CurlTool, error \"%s\"", url_s, curl_easy_strerror (c));
 										}
 
-								}		/* if (response_s) */
+								}
 							else
 								{
-									PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to get response data from CurlTool for \"%s\"", url_s);
+									PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to set streaming callback for CurlTool for \"%s\"", url_s);
 								}
 
-						}		/* if (c == CURLE_OK) */
+						}		/* if (SetUriForCurlTool (curl_tool_p, full_url_s)) */
 					else
 						{
-							PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Error calling \"%s\"for CurlTool, error \"%s\"", url_s, curl_easy_strerror (c));
+							PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to set URL for CurlTool to \"%s\"", url_s);
 						}
 
-				}		/* if (SetUriForCurlTool (curl_tool_p, url_s)) */
-			else
+					ClearJSONStreamParser (&parser);
+				}		/* if (InitJSONStreamParser (&parser, callback_fn, callback_data_p)) */
+
+			if (escaped_url_s)
 				{
-					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to set URL for CurlTool to \"%s\"", url_s);
+					FreeCopiedString (escaped_url_s);
 				}
 
-		}		/* if (escaped_url_s) */
+		}		/* if (full_url_s) */
 	else
 		{
-			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to allocate CurlTool for \"%s\"", url_s);
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to copy url \"%s\"", url_s);
 		}
 
+	return success_flag;
+}
+
 
-	return res;
+static size_t WriteToJSONStreamParser (char *data_p, size_t size, size_t num_items, void *parser_p)
+{
+	const size_t length = size * num_items;
+
+	/*
+	 * Returning anything other than the number of bytes that we were given
+	 * makes curl abort the transfer, which is what we want once we have
+	 * everything that we need.
+	 */
+	return (FeedJSONStreamParser ((JSONStreamParser *) parser_p, data_p, length) == JSS_CONTINUE) ? length : 0;
 }
 
 
-int AddEscapedValueToByteBuffer (const char *value_s, ByteBuffer *buffer_p, CurlTool *tool_p, const char *prefix_s)
+/*
+ * The address components are already escaped as they are added to
+ * the url so we only need to make a copy to swap any spaces for +
+ * if there are some left over, e.g. from the configured geocoder url.
+ */
+static const char *GetURLWithoutSpaces (const char *url_s, char **copied_url_ss)
+{
+	const char *full_url_s = url_s;
+
+	if (strchr (url_s, ' '))
+		{
+			*copied_url_ss = EasyCopyToNewString (url_s);
+
+			if (*copied_url_ss)
+				{
+					ReplaceChars (*copied_url_ss, ' ', '+');
+				}
+
+			full_url_s = *copied_url_ss;
+		}
+
+	return full_url_s;
+}
+
+
+int AddEscapedValueToByteBuffer (const char *value_s, ByteBuffer *buffer_p, const char *prefix_s)
 {
 	int res = -1;
 
 	if (value_s)
 		{
-			char *escaped_value_s = GetURLEscapedString (tool_p, value_s);
-
-			if (escaped_value_s)
+			if ((!prefix_s) || (AppendStringToByteBuffer (buffer_p, prefix_s)))
 				{
-					if (prefix_s)
+					if (AppendURLEscapedStringToByteBuffer (buffer_p, value_s, false))
 						{
-							res = (AppendStringsToByteBuffer (buffer_p, prefix_s, escaped_value_s, NULL)) ? 1 : -1;
-						}		/* if (prefix_s) */
-					else
-						{
-							res = (AppendStringToByteBuffer (buffer_p, escaped_value_s)) ? 1 : -1;
+							res = 1;
 						}
-
-					FreeURLEscapedString (escaped_value_s);
 				}
 		}		/* if (value_s) */
 	else
@@ -272,14 +699,14 @@ int AddEscapedValueToByteBuffer (const char *value_s, ByteBuffer *buffer_p, Curl
 
 
 
-bool BuildURLUsingAddressParameter (ByteBuffer *buffer_p, CurlTool *curl_p, const Address * const address_p, const char *api_call_s, const char *sep_s)
+bool BuildURLUsingAddressParameter (ByteBuffer *buffer_p, const Address * const address_p, const char *api_call_s, const char *sep_s)
 {
 	bool success_flag = false;
 	const char *prefix_s = api_call_s;
 	int res;
 
 	/* name */
-	if ((res = AddEscapedValueToByteBuffer (address_p -> ad_name_s, buffer_p, curl_p, prefix_s)) >= 0)
+	if ((res = AddEscapedValueToByteBuffer (address_p -> ad_name_s, buffer_p, prefix_s)) >= 0)
 		{
 			if (res == 1)
 				{
@@ -287,7 +714,7 @@ bool BuildURLUsingAddressParameter (ByteBuffer *buffer_p, CurlTool *curl_p, cons
 				}
 
 			/* street */
-			if ((res = AddEscapedValueToByteBuffer (address_p -> ad_street_s, buffer_p, curl_p, prefix_s)) >= 0)
+			if ((res = AddEscapedValueToByteBuffer (address_p -> ad_street_s, buffer_p, prefix_s)) >= 0)
 				{
 					if (res == 1)
 						{
@@ -295,7 +722,7 @@ bool BuildURLUsingAddressParameter (ByteBuffer *buffer_p, CurlTool *curl_p, cons
 						}
 
 					/* town */
-					if ((res = AddEscapedValueToByteBuffer (address_p -> ad_town_s, buffer_p, curl_p, prefix_s)) >= 0)
+					if ((res = AddEscapedValueToByteBuffer (address_p -> ad_town_s, buffer_p, prefix_s)) >= 0)
 						{
 							if (res == 1)
 								{
@@ -303,7 +730,7 @@ bool BuildURLUsingAddressParameter (ByteBuffer *buffer_p, CurlTool *curl_p, cons
 								}
 
 							/* county */
-							if ((res = AddEscapedValueToByteBuffer (address_p -> ad_county_s, buffer_p, curl_p, prefix_s)) >= 0)
+							if ((res = AddEscapedValueToByteBuffer (address_p -> ad_county_s, buffer_p, prefix_s)) >= 0)
 								{
 									const char *value_s = address_p -> ad_country_s;
 
@@ -322,7 +749,10 @@ bool BuildURLUsingAddressParameter (ByteBuffer *buffer_p, CurlTool *curl_p, cons
 
 									if (value_s)
 										{
-											if (AppendStringsToByteBuffer (buffer_p, prefix_s, value_s, NULL))
+											/*
+											 * The country name has spaces encoded as + rather than %20
+											 */
+											if ((AppendStringToByteBuffer (buffer_p, prefix_s)) && (AppendURLEscapedStringToByteBuffer (buffer_p, value_s, true)))
 												{
 													success_flag = true;
 												}
@@ -332,26 +762,26 @@ bool BuildURLUsingAddressParameter (ByteBuffer *buffer_p, CurlTool *curl_p, cons
 												}
 										}
 
-								}		/* if ((res = AddEscapedValueToByteBuffer (address_p -> ad_county_s, buffer_p, tool_p, prefix_s)) >= 0) */
+								}		/* if ((res = AddEscapedValueToByteBuffer (address_p -> ad_county_s, buffer_p, prefix_s)) >= 0) */
 							else
 								{
 									PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to add county \"%s\" to buffer for REST API Address call", address_p -> ad_county_s ? address_p -> ad_county_s : "NULL");
 								}
 
-						}		/* if ((res = AddEscapedValueToByteBuffer (address_p -> ad_town_s, buffer_p, tool_p, prefix_s)) >= 0 */
+						}		/* if ((res = AddEscapedValueToByteBuffer (address_p -> ad_town_s, buffer_p, prefix_s)) >= 0 */
 					else
 						{
 							PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to add town \"%s\" to buffer for REST API Address call", address_p -> ad_town_s ? address_p -> ad_town_s : "NULL");
 						}
 
 
-				}		/* if ((res = AddEscapedValueToByteBuffer (address_p -> ad_street_s, buffer_p, tool_p, prefix_s)) >= 0) */
+				}		/* if ((res = AddEscapedValueToByteBuffer (address_p -> ad_street_s, buffer_p, prefix_s)) >= 0) */
 			else
 				{
 					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to add street \"%s\" to buffer for REST API Address call", address_p -> ad_street_s ? address_p -> ad_street_s : "NULL");
 				}
 
-		}		/* if ((res = AddEscapedValueToByteBuffer (address_p -> ad_name_s, buffer_p, tool_p, prefix_s)) >= 0) */
+		}		/* if ((res = AddEscapedValueToByteBuffer (address_p -> ad_name_s, buffer_p, prefix_s)) >= 0) */
 	else
 		{
 			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to add name \"%s\" to buffer for REST API Address call", address_p -> ad_name_s ? address_p -> ad_name_s : "NULL");
@@ -414,7 +844,7 @@ bool DetermineGPSLocationForAddressByOpencage (Address *address_p, const char *g
 															json_error_t error;
 															json_t *raw_res_p = NULL;
 
-															PrintLog (STM_LEVEL_INFO, __FILE__, __LINE__, "geo response for %s\n%s\n", uri_s, response_s);
+															PrintLog (STM_LEVEL_FINER, __FILE__, __LINE__, "geo response for %s\n%s\n", uri_s, response_s);
 
 															raw_res_p = json_loads (response_s, 0, &error);
 
@@ -445,9 +875,9 @@ bool DetermineGPSLocationForAddressByOpencage (Address *address_p, const char *g
 
 																									if (bounds_p)
 																										{
-																											if (SetCoordinateFromOpencage (json_object_get (result_p, "northeast"), address_p, SetAddressNorthEastCoordinate))
+																											if (SetCoordinateFromOpencage (json_object_get (bounds_p, "northeast"), address_p, SetAddressNorthEastCoordinate))
 																												{
-																													if (SetCoordinateFromOpencage (json_object_get (result_p, "southwest"), address_p, SetAddressNorthEastCoordinate))
+																													if (SetCoordinateFromOpencage (json_object_get (bounds_p, "southwest"), address_p, SetAddressSouthWestCoordinate))
 																														{
 																															done_flag = true;
 																														}
@@ -542,11 +972,170 @@ bool DetermineGPSLocationForAddressByLocationIQ (Address *address_p, const char
 
 
 
+/*
+ * Check whether the Address's GPS text or its first lines are coordinates
+ * that people have typed in. Plain pairs of numbers are only accepted from
+ * the GPS text as something like "12 34" in a street is more likely to be
+ * part of the address.
+ */
+static bool SetLocationFromAddressText (Address *address_p)
+{
+	double64 latitude;
+	double64 longitude;
+
+	if (address_p -> ad_gps_s)
+		{
+			if (ParseCoordinateString (address_p -> ad_gps_s, &latitude, &longitude) != CSF_NONE)
+				{
+					return SetAddressCentreCoordinate (address_p, latitude, longitude, NULL);
+				}
+		}
+
+	if (address_p -> ad_name_s)
+		{
+			const CoordinateStringFormat format = ParseCoordinateString (address_p -> ad_name_s, &latitude, &longitude);
+
+			if ((format != CSF_NONE) && (format != CSF_SIGNED_DECIMAL))
+				{
+					return SetAddressCentreCoordinate (address_p, latitude, longitude, NULL);
+				}
+		}
+
+	if (address_p -> ad_street_s)
+		{
+			const CoordinateStringFormat format = ParseCoordinateString (address_p -> ad_street_s, &latitude, &longitude);
+
+			if ((format != CSF_NONE) && (format != CSF_SIGNED_DECIMAL))
+				{
+					return SetAddressCentreCoordinate (address_p, latitude, longitude, NULL);
+				}
+		}
+
+	return false;
+}
+
+
+static const CountryLocation *GetAddressCountryLocation (const Address *address_p)
+{
+	const CountryLocation *country_p = NULL;
+
+	if (address_p -> ad_country_code_s)
+		{
+			country_p = GetCountryLocation (address_p -> ad_country_code_s);
+		}
+
+	if ((!country_p) && (address_p -> ad_country_s))
+		{
+			const char *code_s = GetCountryCodeFromName (address_p -> ad_country_s);
+
+			/* People often put the code in the country's name */
+			country_p = GetCountryLocation (code_s ? code_s : address_p -> ad_country_s);
+		}
+
+	return country_p;
+}
+
+
+static bool IsCountryOnlyAddress (const Address *address_p)
+{
+	return (IsBlankString (address_p -> ad_name_s) && IsBlankString (address_p -> ad_street_s) && IsBlankString (address_p -> ad_town_s) &&
+		IsBlankString (address_p -> ad_county_s) && IsBlankString (address_p -> ad_postcode_s));
+}
+
+
+static bool SetLocationFromCountry (Address *address_p, const CountryLocation *country_p)
+{
+	return (SetAddressCentreCoordinate (address_p, country_p -> cl_latitude, country_p -> cl_longitude, NULL) &&
+		SetAddressNorthEastCoordinate (address_p, country_p -> cl_north, country_p -> cl_east, NULL) &&
+		SetAddressSouthWestCoordinate (address_p, country_p -> cl_south, country_p -> cl_west, NULL));
+}
+
+
+/*
+ * Split a free-text Address with SplitAddressName (). The Address only
+ * takes the split fields if there was more than one part or a postcode
+ * or country was found. Otherwise, e.g. for a lone "Rothamsted Research",
+ * the split is just a guess, so the Address is left as it is and the
+ * split is returned as a separate Address, which the caller must free,
+ * that is only used for the query.
+ */
+static Address *SplitAddressForGeocoding (const AddressSplitter *splitter_p, Address *address_p)
+{
+	Address *split_address_p = AllocateAddress (address_p -> ad_name_s, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+
+	if (split_address_p)
+		{
+			if (SplitAddressName (splitter_p, split_address_p))
+				{
+					const uint32 num_parts = ((split_address_p -> ad_name_s) ? 1 : 0) + ((split_address_p -> ad_street_s) ? 1 : 0) +
+						((split_address_p -> ad_town_s) ? 1 : 0) + ((split_address_p -> ad_county_s) ? 1 : 0);
+
+					if ((num_parts > 1) || (split_address_p -> ad_postcode_s) || (split_address_p -> ad_country_s) || (split_address_p -> ad_country_code_s))
+						{
+							SwapStrings (& (address_p -> ad_name_s), & (split_address_p -> ad_name_s));
+							SwapStrings (& (address_p -> ad_street_s), & (split_address_p -> ad_street_s));
+							SwapStrings (& (address_p -> ad_town_s), & (split_address_p -> ad_town_s));
+							SwapStrings (& (address_p -> ad_county_s), & (split_address_p -> ad_county_s));
+							SwapStrings (& (address_p -> ad_country_s), & (split_address_p -> ad_country_s));
+							SwapStrings (& (address_p -> ad_postcode_s), & (split_address_p -> ad_postcode_s));
+							SwapStrings (& (address_p -> ad_country_code_s), & (split_address_p -> ad_country_code_s));
+
+							FreeAddress (split_address_p);
+							split_address_p = NULL;
+						}
+				}
+			else
+				{
+					FreeAddress (split_address_p);
+					split_address_p = NULL;
+				}
+		}
+	else
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to copy \"%s\" to split it", address_p -> ad_name_s);
+		}
+
+	return split_address_p;
+}
+
+
+static void SwapStrings (char **value0_ss, char **value1_ss)
+{
+	char *value_s = *value0_ss;
+
+	*value0_ss = *value1_ss;
+	*value1_ss = value_s;
+}
+
+
+static bool IsBlankString (const char *value_s)
+{
+	if (value_s)
+		{
+			while (*value_s)
+				{
+					if (!isspace ((unsigned char) *value_s))
+						{
+							return false;
+						}
+
+					++ value_s;
+				}
+		}
+
+	return true;
+}
+
+
 static bool DoGeocoding (GeocoderTool *tool_p, Address *address_p)
 {
 	bool success_flag = false;
 
-	if ((tool_p -> gt_geocoder_fn) && (tool_p -> gt_geocoder_url_s))
+	if (tool_p -> gt_geocoder_template_p)
+		{
+			success_flag = RunTemplateGeocoder (address_p, tool_p -> gt_geocoder_template_p, tool_p -> gt_parse_results_fn, tool_p -> gt_parse_raw_results_fn);
+		}
+	else if ((tool_p -> gt_geocoder_fn) && (tool_p -> gt_geocoder_url_s))
 		{
 			success_flag = tool_p -> gt_geocoder_fn (address_p, tool_p -> gt_geocoder_url_s);
 		}
@@ -559,7 +1148,23 @@ static bool DoReverseGeocoding (GeocoderTool *tool_p, Address *address_p)
 {
 	bool success_flag = false;
 
-	if ((tool_p -> gt_reverse_geocoder_fn) && (tool_p -> gt_reverse_geocoder_url_s))
+	/* Try the offline index first as it saves a call to the web service */
+	if ((tool_p -> gt_admin_regions_p) && (address_p -> ad_gps_centre_p))
+		{
+			if (SetAddressFromAdminRegions (tool_p -> gt_admin_regions_p, address_p))
+				{
+					return true;
+				}
+		}
+
+	if (tool_p -> gt_reverse_geocoder_template_p)
+		{
+			if (address_p -> ad_gps_centre_p)
+				{
+					success_flag = RunTemplateGeocoder (address_p, tool_p -> gt_reverse_geocoder_template_p, tool_p -> gt_parse_reverse_results_fn, NULL);
+				}
+		}
+	else if ((tool_p -> gt_reverse_geocoder_fn) && (tool_p -> gt_reverse_geocoder_url_s))
 		{
 			success_flag = tool_p -> gt_reverse_geocoder_fn (address_p, tool_p -> gt_reverse_geocoder_url_s);
 		}
@@ -568,6 +1173,100 @@ static bool DoReverseGeocoding (GeocoderTool *tool_p, Address *address_p)
 }
 
 
+static bool RunTemplateGeocoder (Address *address_p, const URLTemplate *template_p, int (*parse_results_fn) (Address *address_p, const json_t *web_service_results_p), ParseRawResultsFunction parse_raw_results_fn)
+{
+	bool success_flag = false;
+	ByteBuffer *buffer_p = AllocateByteBuffer (1024);
+
+	if (buffer_p)
+		{
+			if (BuildURLFromTemplate (template_p, address_p, buffer_p))
+				{
+					CurlTool *curl_p = AllocateMemoryCurlTool (0);
+
+					if (curl_p)
+						{
+							const char *url_s = GetByteBufferData (buffer_p);
+
+							const int res = parse_raw_results_fn ? CallGeocoderWebServiceOnDemand (curl_p, url_s, address_p, parse_raw_results_fn) : CallGeocoderWebService (curl_p, url_s, address_p, parse_results_fn);
+
+							if (res == 1)
+								{
+									success_flag = true;
+								}
+
+							FreeCurlTool (curl_p);
+						}		/* if (curl_p) */
+
+				}		/* if (BuildURLFromTemplate (template_p, address_p, buffer_p)) */
+
+			FreeByteBuffer (buffer_p);
+		}		/* if (buffer_p) */
+
+	return success_flag;
+}
+
+
+
+static TownMatcher *SetUpTownMatcher (const GeocoderTool *tool_p)
+{
+	TownMatcher *matcher_p = AllocateTownMatcher ();
+
+	if (matcher_p)
+		{
+			bool success_flag = true;
+
+			if (tool_p -> gt_admin_regions_p)
+				{
+					success_flag = AddAdminRegionsToTownMatcher (matcher_p, tool_p -> gt_admin_regions_p);
+				}
+
+			if (success_flag && (tool_p -> gt_address_cache_p))
+				{
+					success_flag = AddAddressRecordsToTownMatcher (matcher_p, tool_p -> gt_address_cache_p);
+				}
+
+			if (success_flag)
+				{
+					return matcher_p;
+				}
+
+			FreeTownMatcher (matcher_p);
+		}
+
+	return NULL;
+}
+
+
+static AddressSplitter *SetUpAddressSplitter (const GeocoderTool *tool_p)
+{
+	AddressSplitter *splitter_p = AllocateAddressSplitter ();
+
+	if (splitter_p)
+		{
+			bool success_flag = true;
+
+			if (tool_p -> gt_admin_regions_p)
+				{
+					success_flag = AddAdminRegionsToAddressSplitter (splitter_p, tool_p -> gt_admin_regions_p);
+				}
+
+			if (success_flag && (tool_p -> gt_address_cache_p))
+				{
+					success_flag = AddAddressRecordsToAddressSplitter (splitter_p, tool_p -> gt_address_cache_p);
+				}
+
+			if (success_flag)
+				{
+					return splitter_p;
+				}
+
+			FreeAddressSplitter (splitter_p);
+		}
+
+	return NULL;
+}
+
 
 static GeocoderTool *AllocateGeocoderTool (void)
 {
@@ -579,14 +1278,148 @@ static GeocoderTool *AllocateGeocoderTool (void)
 			config_p -> gt_reverse_geocoder_fn = NULL;
 			config_p -> gt_geocoder_url_s = NULL;
 			config_p -> gt_reverse_geocoder_url_s = NULL;
+			config_p -> gt_geocoder_template_p = NULL;
+			config_p -> gt_reverse_geocoder_template_p = NULL;
+			config_p -> gt_parse_results_fn = NULL;
+			config_p -> gt_parse_reverse_results_fn = NULL;
+			config_p -> gt_parse_raw_results_fn = NULL;
+			config_p -> gt_admin_regions_p = NULL;
+			config_p -> gt_address_cache_p = NULL;
+			config_p -> gt_town_matcher_p = NULL;
+			config_p -> gt_address_splitter_p = NULL;
 		}
 
 	return config_p;
 }
 
 
-static void FreeGeocoderTool (GeocoderTool *config_p)
+void FreeGeocoderTool (GeocoderTool *config_p)
 {
+	if (config_p -> gt_geocoder_template_p)
+		{
+			FreeURLTemplate (config_p -> gt_geocoder_template_p);
+		}
+
+	if (config_p -> gt_reverse_geocoder_template_p)
+		{
+			FreeURLTemplate (config_p -> gt_reverse_geocoder_template_p);
+		}
+
+	if (config_p -> gt_admin_regions_p)
+		{
+			CloseAdminRegionIndex (config_p -> gt_admin_regions_p);
+		}
+
+	/* The matcher points into the address cache so has to go first */
+	if (config_p -> gt_town_matcher_p)
+		{
+			FreeTownMatcher (config_p -> gt_town_matcher_p);
+		}
+
+	if (config_p -> gt_address_splitter_p)
+		{
+			FreeAddressSplitter (config_p -> gt_address_splitter_p);
+		}
+
+	if (config_p -> gt_address_cache_p)
+		{
+			CloseAddressRecordFile (config_p -> gt_address_cache_p);
+		}
+
 	FreeMemory (config_p);
 }
 
+
+void FreeCachedGeocoderTools (void)
+{
+	CachedGeocoderTool *cached_p;
+
+	LockCachedTools ();
+
+	cached_p = s_cached_tools_p;
+	s_cached_tools_p = NULL;
+
+	UnlockCachedTools ();
+
+	while (cached_p)
+		{
+			CachedGeocoderTool *next_p = cached_p -> cgt_next_p;
+
+			if (cached_p -> cgt_tool_p)
+				{
+					FreeGeocoderTool (cached_p -> cgt_tool_p);
+				}
+
+			FreeMemory (cached_p);
+			cached_p = next_p;
+		}
+}
+
+
+/*
+ * Get the GeocoderTool for a server, building it the first time that
+ * it is asked for. The lock is held while the tool is built so that
+ * only one copy of it is ever made.
+ */
+static GeocoderTool *GetCachedGeocoderTool (GrassrootsServer *grassroots_p)
+{
+	GeocoderTool *tool_p = NULL;
+	CachedGeocoderTool *cached_p;
+
+	LockCachedTools ();
+
+	cached_p = s_cached_tools_p;
+
+	while (cached_p && (cached_p -> cgt_grassroots_p != grassroots_p))
+		{
+			cached_p = cached_p -> cgt_next_p;
+		}
+
+	if (cached_p)
+		{
+			tool_p = cached_p -> cgt_tool_p;
+		}
+	else
+		{
+			cached_p = (CachedGeocoderTool *) AllocMemory (sizeof (CachedGeocoderTool));
+
+			if (cached_p)
+				{
+					tool_p = AllocateGeocoderToolFromGrassrootsConfig (grassroots_p);
+
+					cached_p -> cgt_grassroots_p = grassroots_p;
+					cached_p -> cgt_tool_p = tool_p;
+					cached_p -> cgt_next_p = s_cached_tools_p;
+
+					s_cached_tools_p = cached_p;
+				}
+			else
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to allocate the cached GeocoderTool");
+				}
+		}
+
+	UnlockCachedTools ();
+
+	return tool_p;
+}
+
+
+static void LockCachedTools (void)
+{
+#ifdef _WIN32
+	AcquireSRWLockExclusive (&s_cached_tools_lock);
+#else
+	pthread_mutex_lock (&s_cached_tools_lock);
+#endif
+}
+
+
+static void UnlockCachedTools (void)
+{
+#ifdef _WIN32
+	ReleaseSRWLockExclusive (&s_cached_tools_lock);
+#else
+	pthread_mutex_unlock (&s_cached_tools_lock);
+#endif
+}
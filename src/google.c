@@ -20,7 +20,6 @@
  *      Author: billy
  */
 
-#include <ctype.h>
 #include <string.h>
 
 
@@ -33,118 +32,66 @@
 #include "country_codes.h"
 #include "curl_tools.h"
 #include "geocoder_util.h"
-
-static int ParseGoogleResults (Address *address_p, const json_t *web_service_results_p);
+#include "url_escape.h"
+#include "json_stream.h"
+#include "json_on_demand.h"
+#include "postcode.h"
+#include "address_canonical.h"
+#include "query_strategy.h"
 
 static bool RefineLocationDataForGoogle (Address *address_p, const json_t *raw_data_p);
 
 static bool FillInAddressFromGoogleData (Address *address_p, const json_t *google_result_p);
 
-static bool BuildGoogleURLUsingComponentsParameters (ByteBuffer *buffer_p, const Address * const address_p, CurlTool *tool_p);
-
-
-bool RunGoogleGeocoder (Address *address_p, const char *geocoder_uri_s)
-{
-	bool got_location_flag = false;
-
-
-	if (address_p -> ad_gps_s)
-		{
-			/*
-			 * Start to try and scan the coords as decimals
-			 */
-			const char *value_s = address_p -> ad_gps_s;
-			double latitude;
-			double longitude;
-			bool match_flag = false;
-
-			if (GetValidRealNumber (&value_s, &latitude, ","))
-				{
-					while ((!isdigit (*value_s)) && (*value_s != '-') && (*value_s != '+'))
-						{
-							++ value_s;
-						}
-
-					if (*value_s != '\0')
-						{
-							if (GetValidRealNumber (&value_s, &longitude, ","))
-								{
-									while ((isspace (*value_s)) && (*value_s != '\0'))
-										{
-											++ value_s;
-										}
-
-									match_flag = (*value_s == '\0');
-								}
-						}
-				}
-
-			if (match_flag)
-				{
-					got_location_flag = SetAddressCentreCoordinate (address_p, latitude, longitude, NULL);
-				}
-
-		}		/* if (address_p -> ad_gps_s) */
-	else
-		{
-			ByteBuffer *buffer_p = AllocateByteBuffer (1024);
+static bool BuildGoogleURLUsingComponentsParameters (ByteBuffer *buffer_p, const Address * const address_p);
 
-			if (buffer_p)
-				{
-					if (AppendStringToByteBuffer (buffer_p, geocoder_uri_s))
-						{
-							CurlTool *curl_p = AllocateMemoryCurlTool (0);
+static bool BuildGoogleURLUsingAddressParameter (ByteBuffer *buffer_p, const Address * const address_p);
 
-							if (curl_p)
-								{
-									if (BuildURLUsingAddressParameter (buffer_p, curl_p, address_p, "&address=", ",%20"))
-										{
-											const char *url_s = GetByteBufferData (buffer_p);
-											int res = CallGeocoderWebService (curl_p, url_s, address_p, ParseGoogleResults);
 
-											if (res == 1)
-												{
-													got_location_flag = true;
-												}
-											else if (res == 0)
-												{
-													ResetByteBuffer (buffer_p);
+/*
+ * The state used when streaming the results of a Google call
+ */
+typedef struct GoogleStream
+{
+	Address *gs_address_p;
+	double64 gs_location [2];
+	double64 gs_north_east [2];
+	double64 gs_south_west [2];
+	uint32 gs_found_flags;
+	char gs_status_s [32];
+	int gs_res;
+} GoogleStream;
 
-													if (AppendStringToByteBuffer (buffer_p, geocoder_uri_s))
-														{
-															if (BuildGoogleURLUsingComponentsParameters (buffer_p, address_p, curl_p))
-																{
-																	url_s = GetByteBufferData (buffer_p);
-																	res = CallGeocoderWebService (curl_p, url_s, address_p, ParseGoogleResults);
 
-																	if (res == 1)
-																		{
-																			got_location_flag = true;
-																		}
-																}
-														}
+/*
+ * The bits in gs_found_flags for each of the values
+ */
+#define GS_LOCATION_LATITUDE (1 << 0)
+#define GS_LOCATION_LONGITUDE (1 << 1)
+#define GS_NORTH_EAST_LATITUDE (1 << 2)
+#define GS_NORTH_EAST_LONGITUDE (1 << 3)
+#define GS_SOUTH_WEST_LATITUDE (1 << 4)
+#define GS_SOUTH_WEST_LONGITUDE (1 << 5)
 
-												}
 
-										}
+static int CallGoogleGeocoder (CurlTool *curl_p, const char *url_s, Address *address_p);
 
-									FreeCurlTool (curl_p);
-								}
+static JSONStreamStatus ParseGoogleStream (void *data_p, const JSONStreamParser *parser_p, const JSONStreamEvent event, const size_t depth, const char *key_s, const char *value_s, const size_t value_length);
 
+static bool SetGoogleStreamCoordinate (GoogleStream *stream_p, const char *key_s, const char *value_s, double64 *coord_p, const uint32 latitude_flag, const uint32 longitude_flag);
 
+static bool IsGoogleStreamKey (const JSONStreamParser *parser_p, const size_t depth, const char *key_s);
 
-						}		/* if (AppendStringToByteBuffer (buffer_p, data_p -> msd_geocoding_uri_s)) */
-					else
-						{
-						}
+static bool SetAddressFromGoogleStream (GoogleStream *stream_p);
 
-					FreeByteBuffer (buffer_p);
-				}		/* if (buffer_p) */
+static bool GetGoogleSpanCoordinate (const JSONSpan *parent_p, const char *path_s, double64 *latitude_p, double64 *longitude_p);
 
-		}		/* if (address_p -> ad_gps_s) else ... */
 
+bool RunGoogleGeocoder (Address *address_p, const char *geocoder_uri_s)
+{
+	static const BuildQueryFunction build_fns [QF_NUM_FORMS] = { BuildGoogleURLUsingComponentsParameters, BuildGoogleURLUsingAddressParameter };
 
-	return got_location_flag;
+	return RunQueryForms (QP_GOOGLE, address_p, geocoder_uri_s, build_fns, CallGoogleGeocoder, QF_FREE_TEXT);
 }
 
 
@@ -166,7 +113,7 @@ bool RunGoogleReverseGeocoder (Address *address_p, const char *geocoder_uri_s)
 							if (AppendStringToByteBuffer (buffer_p, geocoder_uri_s))
 								{
 									const char *url_s = GetByteBufferData (buffer_p);
-									int res = CallGeocoderWebService (curl_tool_p, url_s, address_p, ParseGoogleResults);
+									int res = CallGoogleGeocoder (curl_tool_p, url_s, address_p);
 
 									if (res == 1)
 										{
@@ -178,10 +125,10 @@ bool RunGoogleReverseGeocoder (Address *address_p, const char *geocoder_uri_s)
 
 											if (AppendStringToByteBuffer (buffer_p, geocoder_uri_s))
 												{
-													if (BuildGoogleURLUsingComponentsParameters (buffer_p, address_p, curl_tool_p))
+													if (BuildGoogleURLUsingComponentsParameters (buffer_p, address_p))
 														{
 															url_s = GetByteBufferData (buffer_p);
-															res = CallGeocoderWebService (curl_tool_p, url_s, address_p, ParseGoogleResults);
+															res = CallGoogleGeocoder (curl_tool_p, url_s, address_p);
 
 															if (res == 1)
 																{
@@ -209,7 +156,7 @@ bool RunGoogleReverseGeocoder (Address *address_p, const char *geocoder_uri_s)
 
 
 
-static int ParseGoogleResults (Address *address_p, const json_t *web_service_results_p)
+int ParseGoogleResults (Address *address_p, const json_t *web_service_results_p)
 {
 	int res = -1;
 
@@ -272,6 +219,299 @@ static int ParseGoogleResults (Address *address_p, const json_t *web_service_res
 
 
 
+int ParseGoogleResultsOnDemand (Address *address_p, const char *response_s, const size_t length)
+{
+	int res = -1;
+	JSONSpan response;
+
+	if (InitJSONSpan (&response, response_s, length))
+		{
+			JSONSpan value;
+
+			if (GetJSONSpanMember (&response, "status", &value))
+				{
+					if (IsJSONSpanStringEqualTo (&value, "OK"))
+						{
+							JSONSpanIterator iterator;
+
+							res = 0;
+
+							if ((GetJSONSpanMember (&response, "results", &value)) && (InitJSONSpanIterator (&iterator, &value)))
+								{
+									JSONSpan result;
+
+									while ((res == 0) && (GetNextJSONSpanElement (&iterator, &result)))
+										{
+											double64 latitude;
+											double64 longitude;
+
+											if (GetGoogleSpanCoordinate (&result, "geometry.location", &latitude, &longitude))
+												{
+													if (SetAddressCentreCoordinate (address_p, latitude, longitude, NULL))
+														{
+															res = 1;
+
+															if (GetGoogleSpanCoordinate (&result, "geometry.viewport.northeast", &latitude, &longitude))
+																{
+																	if (!SetAddressNorthEastCoordinate (address_p, latitude, longitude, NULL))
+																		{
+																			PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to set north east location from %lf %lf ", latitude, longitude);
+																		}
+																}
+
+															if (GetGoogleSpanCoordinate (&result, "geometry.viewport.southwest", &latitude, &longitude))
+																{
+																	if (!SetAddressSouthWestCoordinate (address_p, latitude, longitude, NULL))
+																		{
+																			PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to set south west location from %lf %lf ", latitude, longitude);
+																		}
+																}
+														}
+												}
+
+										}		/* while ((res == 0) && (GetNextJSONSpanElement (&iterator, &result))) */
+
+								}
+							else
+								{
+									PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to get results array");
+								}
+
+						}		/* if (IsJSONSpanStringEqualTo (&value, "OK")) */
+					else if (IsJSONSpanStringEqualTo (&value, "ZERO_RESULTS"))
+						{
+							res = 0;
+						}
+
+				}		/* if (GetJSONSpanMember (&response, "status", &value)) */
+
+		}		/* if (InitJSONSpan (&response, response_s, length)) */
+	else
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to find a json value in the response");
+		}
+
+	return res;
+}
+
+
+static bool GetGoogleSpanCoordinate (const JSONSpan *parent_p, const char *path_s, double64 *latitude_p, double64 *longitude_p)
+{
+	JSONSpan location;
+
+	if (GetJSONSpanPath (parent_p, path_s, &location))
+		{
+			JSONSpan value;
+
+			if ((GetJSONSpanMember (&location, "lat", &value)) && (GetJSONSpanReal (&value, latitude_p)))
+				{
+					if ((GetJSONSpanMember (&location, "lng", &value)) && (GetJSONSpanReal (&value, longitude_p)))
+						{
+							return true;
+						}
+				}
+		}
+
+	return false;
+}
+
+
+
+/*
+ * Make a call and stream its results, stopping as soon as the geometry
+ * of the first result has been read. The return values are the same as
+ * for ParseGoogleResults ().
+ */
+static int CallGoogleGeocoder (CurlTool *curl_p, const char *url_s, Address *address_p)
+{
+	GoogleStream stream;
+
+	memset (&stream, 0, sizeof (GoogleStream));
+	stream.gs_address_p = address_p;
+	stream.gs_res = -1;
+
+	if (!CallGeocoderWebServiceStreaming (curl_p, url_s, ParseGoogleStream, &stream))
+		{
+			stream.gs_res = -1;
+		}
+
+	return stream.gs_res;
+}
+
+
+/*
+ * The values that we need are at
+ *
+ * 	results [i].geometry.location.{lat,lng}
+ * 	results [i].geometry.viewport.{northeast,southwest}.{lat,lng}
+ *
+ * and the status is a top-level member that usually comes after
+ * the results so it is only checked if no usable result is found.
+ */
+static JSONStreamStatus ParseGoogleStream (void *data_p, const JSONStreamParser *parser_p, const JSONStreamEvent event, const size_t depth, const char *key_s, const char *value_s, const size_t value_length)
+{
+	GoogleStream *stream_p = (GoogleStream *) data_p;
+	JSONStreamStatus status = JSS_CONTINUE;
+
+	switch (depth)
+		{
+			case 0:
+				if (event == JSE_OBJECT_END)
+					{
+						const char *status_s = stream_p -> gs_status_s;
+
+						if ((strcmp (status_s, "OK") == 0) || (strcmp (status_s, "ZERO_RESULTS") == 0))
+							{
+								stream_p -> gs_res = 0;
+							}
+						else
+							{
+								PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Google geocoder status \"%s\"", status_s);
+								stream_p -> gs_res = -1;
+							}
+					}
+				else if (event != JSE_OBJECT_START)
+					{
+						PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "response is not an object");
+						status = JSS_STOP;
+					}
+				break;
+
+			case 1:
+				if ((event == JSE_STRING) && key_s && (strcmp (key_s, "status") == 0))
+					{
+						strncpy (stream_p -> gs_status_s, value_s, sizeof (stream_p -> gs_status_s) - 1);
+					}
+				break;
+
+			/* each result */
+			case 2:
+				if ((event == JSE_OBJECT_START) && (IsGoogleStreamKey (parser_p, 1, "results")))
+					{
+						stream_p -> gs_found_flags = 0;
+					}
+				break;
+
+			case 3:
+				if ((event == JSE_OBJECT_END) && (IsGoogleStreamKey (parser_p, 3, "geometry")) && (IsGoogleStreamKey (parser_p, 1, "results")))
+					{
+						if (SetAddressFromGoogleStream (stream_p))
+							{
+								stream_p -> gs_res = 1;
+								status = JSS_STOP;
+							}
+					}
+				break;
+
+			/* results [i].geometry.location.{lat,lng} */
+			case 5:
+				if ((event == JSE_NUMBER) && (IsGoogleStreamKey (parser_p, 4, "location")) && (IsGoogleStreamKey (parser_p, 3, "geometry")))
+					{
+						SetGoogleStreamCoordinate (stream_p, key_s, value_s, stream_p -> gs_location, GS_LOCATION_LATITUDE, GS_LOCATION_LONGITUDE);
+					}
+				break;
+
+			/* results [i].geometry.viewport.{northeast,southwest}.{lat,lng} */
+			case 6:
+				if ((event == JSE_NUMBER) && (IsGoogleStreamKey (parser_p, 4, "viewport")) && (IsGoogleStreamKey (parser_p, 3, "geometry")))
+					{
+						if (IsGoogleStreamKey (parser_p, 5, "northeast"))
+							{
+								SetGoogleStreamCoordinate (stream_p, key_s, value_s, stream_p -> gs_north_east, GS_NORTH_EAST_LATITUDE, GS_NORTH_EAST_LONGITUDE);
+							}
+						else if (IsGoogleStreamKey (parser_p, 5, "southwest"))
+							{
+								SetGoogleStreamCoordinate (stream_p, key_s, value_s, stream_p -> gs_south_west, GS_SOUTH_WEST_LATITUDE, GS_SOUTH_WEST_LONGITUDE);
+							}
+					}
+				break;
+
+			default:
+				break;
+		}
+
+	return status;
+}
+
+
+static bool SetGoogleStreamCoordinate (GoogleStream *stream_p, const char *key_s, const char *value_s, double64 *coord_p, const uint32 latitude_flag, const uint32 longitude_flag)
+{
+	bool success_flag = false;
+
+	/* the coordinates could be in an array rather than an object */
+	if (!key_s)
+		{
+			return false;
+		}
+
+	if (strcmp (key_s, "lat") == 0)
+		{
+			if (GetJSONStreamReal (value_s, coord_p))
+				{
+					stream_p -> gs_found_flags |= latitude_flag;
+					success_flag = true;
+				}
+		}
+	else if (strcmp (key_s, "lng") == 0)
+		{
+			if (GetJSONStreamReal (value_s, coord_p + 1))
+				{
+					stream_p -> gs_found_flags |= longitude_flag;
+					success_flag = true;
+				}
+		}
+
+	return success_flag;
+}
+
+
+static bool IsGoogleStreamKey (const JSONStreamParser *parser_p, const size_t depth, const char *key_s)
+{
+	const char *parent_key_s = GetJSONStreamKey (parser_p, depth);
+
+	return ((parent_key_s != NULL) && (strcmp (parent_key_s, key_s) == 0));
+}
+
+
+static bool SetAddressFromGoogleStream (GoogleStream *stream_p)
+{
+	bool success_flag = false;
+	const uint32 location_flags = GS_LOCATION_LATITUDE | GS_LOCATION_LONGITUDE;
+
+	if ((stream_p -> gs_found_flags & location_flags) == location_flags)
+		{
+			Address *address_p = stream_p -> gs_address_p;
+
+			if (SetAddressCentreCoordinate (address_p, stream_p -> gs_location [0], stream_p -> gs_location [1], NULL))
+				{
+					const uint32 north_east_flags = GS_NORTH_EAST_LATITUDE | GS_NORTH_EAST_LONGITUDE;
+					const uint32 south_west_flags = GS_SOUTH_WEST_LATITUDE | GS_SOUTH_WEST_LONGITUDE;
+
+					success_flag = true;
+
+					if ((stream_p -> gs_found_flags & north_east_flags) == north_east_flags)
+						{
+							if (!SetAddressNorthEastCoordinate (address_p, stream_p -> gs_north_east [0], stream_p -> gs_north_east [1], NULL))
+								{
+									PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to set north east location from %lf %lf ", stream_p -> gs_north_east [0], stream_p -> gs_north_east [1]);
+								}
+						}
+
+					if ((stream_p -> gs_found_flags & south_west_flags) == south_west_flags)
+						{
+							if (!SetAddressSouthWestCoordinate (address_p, stream_p -> gs_south_west [0], stream_p -> gs_south_west [1], NULL))
+								{
+									PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to set south west location from %lf %lf ", stream_p -> gs_south_west [0], stream_p -> gs_south_west [1]);
+								}
+						}
+				}
+		}
+
+	return success_flag;
+}
+
+
+
 static bool RefineLocationDataForGoogle (Address *address_p, const json_t *raw_google_data_p)
 {
 	bool success_flag = false;
@@ -402,50 +642,50 @@ bool FillInAddressFromGoogleData (Address *address_p, const json_t *google_resul
 
 
 
-static bool BuildGoogleURLUsingComponentsParameters (ByteBuffer *buffer_p, const Address * const address_p, CurlTool *tool_p)
+static bool BuildGoogleURLUsingAddressParameter (ByteBuffer *buffer_p, const Address * const address_p)
 {
-	bool success_flag = false;
-	const char *value_s = address_p -> ad_postcode_s;
-	char *escaped_value_s = NULL;
+	return BuildURLUsingAddressParameter (buffer_p, address_p, "&address=", ",%20");
+}
 
 
-	/* remove any leading spaces */
-	while ( (*value_s))
-		{
-			++ value_s;
-		}
-
-	escaped_value_s = GetURLEscapedString (tool_p, value_s);
+static bool BuildGoogleURLUsingComponentsParameters (ByteBuffer *buffer_p, const Address * const address_p)
+{
+	bool success_flag = false;
+	char postcode_s [POSTCODE_BUFFER_SIZE];
 
-	if (escaped_value_s)
+	/*
+	 * There's no point in making the call if there isn't a postcode
+	 * or it can't be valid for the Address's country.
+	 */
+	if (GetAddressPostcodeForQuery (address_p, postcode_s))
 		{
-			success_flag = AppendStringsToByteBuffer (buffer_p, "&components=postal_code:", escaped_value_s, NULL);
-
-			FreeURLEscapedString (escaped_value_s);
-		}
+			if (AppendStringToByteBuffer (buffer_p, "&components=postal_code:"))
+				{
+					success_flag = AppendURLEscapedStringToByteBuffer (buffer_p, postcode_s, false);
+				}
 
-	/* country */
-	if (success_flag)
-		{
-			if (address_p -> ad_country_code_s)
+			/* country */
+			if (success_flag)
 				{
-					if (IsValidCountryCode (address_p -> ad_country_code_s))
+					const char *value_s = NULL;
+
+					if (address_p -> ad_country_code_s)
 						{
-							value_s = address_p -> ad_country_code_s;
+							value_s = GetCanonicalCountryCode (address_p -> ad_country_code_s);
 						}
-				}
 
-			if (!value_s)
-				{
-					value_s = GetCountryCodeFromName (address_p -> ad_country_s);
-				}
+					if ((!value_s) && (address_p -> ad_country_s))
+						{
+							value_s = GetCanonicalCountryCode (address_p -> ad_country_s);
+						}
 
-			if (value_s)
-				{
-					success_flag = AppendStringsToByteBuffer (buffer_p, "|country:", value_s, NULL);
-				}
+					if (value_s)
+						{
+							success_flag = AppendStringsToByteBuffer (buffer_p, "|country:", value_s, NULL);
+						}
 
-		}		/* if (success_flag) */
+				}		/* if (success_flag) */
+		}
 
 	return success_flag;
 }
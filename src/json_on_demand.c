@@ -0,0 +1,800 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * json_on_demand.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <string.h>
+
+#include "json_on_demand.h"
+#include "double_conversion.h"
+
+#include "memory_allocations.h"
+
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#define JSON_ON_DEMAND_USE_SSE2 (1)
+	#include <emmintrin.h>
+
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#endif
+
+
+static const char *SkipJSONWhitespace (const char *data_p, const char *end_p);
+
+static const char *SkipJSONString (const char *data_p, const char *end_p);
+
+static const char *SkipJSONContainer (const char *data_p, const char *end_p);
+
+static const char *SkipJSONScalar (const char *data_p, const char *end_p);
+
+static const char *SkipJSONValue (const char *data_p, const char *end_p);
+
+static bool IsJSONSpanKeyEqualTo (const char *key_start_p, const char *key_end_p, const char *key_s, const size_t key_length);
+
+static const char *GetJSONHexValue (const char *data_p, const char *end_p, uint32 *value_p);
+
+static char *WriteUTF8 (char *dest_s, const uint32 code_point);
+
+#ifdef JSON_ON_DEMAND_USE_SSE2
+static int GetFirstSetBit (const int mask);
+#endif
+
+
+bool InitJSONSpan (JSONSpan *span_p, const char *data_s, const size_t length)
+{
+	const char *end_p = data_s + length;
+	const char *start_p = SkipJSONWhitespace (data_s, end_p);
+
+	if (start_p < end_p)
+		{
+			const char *value_end_p = SkipJSONValue (start_p, end_p);
+
+			if (value_end_p)
+				{
+					span_p -> js_start_p = start_p;
+					span_p -> js_end_p = value_end_p;
+
+					return true;
+				}
+		}
+
+	return false;
+}
+
+
+JSONSpanType GetJSONSpanType (const JSONSpan *span_p)
+{
+	JSONSpanType t = JST_INVALID;
+
+	if (span_p -> js_start_p < span_p -> js_end_p)
+		{
+			switch (*span_p -> js_start_p)
+				{
+					case '{':
+						t = JST_OBJECT;
+						break;
+
+					case '[':
+						t = JST_ARRAY;
+						break;
+
+					case '"':
+						t = JST_STRING;
+						break;
+
+					case 't':
+						t = JST_TRUE;
+						break;
+
+					case 'f':
+						t = JST_FALSE;
+						break;
+
+					case 'n':
+						t = JST_NULL;
+						break;
+
+					default:
+						t = JST_NUMBER;
+						break;
+				}
+		}
+
+	return t;
+}
+
+
+bool GetJSONSpanMember (const JSONSpan *object_p, const char *key_s, JSONSpan *value_p)
+{
+	const char *end_p = object_p -> js_end_p;
+	const char *data_p = object_p -> js_start_p;
+	const size_t key_length = strlen (key_s);
+
+	if ((data_p < end_p) && (*data_p == '{'))
+		{
+			data_p = SkipJSONWhitespace (data_p + 1, end_p);
+
+			while ((data_p < end_p) && (*data_p == '"'))
+				{
+					const char *key_start_p = data_p + 1;
+					const char *key_end_p = SkipJSONString (data_p, end_p);
+					const char *member_value_p;
+					const char *member_end_p;
+
+					if (!key_end_p)
+						{
+							return false;
+						}
+
+					data_p = SkipJSONWhitespace (key_end_p, end_p);
+
+					if ((data_p == end_p) || (*data_p != ':'))
+						{
+							return false;
+						}
+
+					member_value_p = SkipJSONWhitespace (data_p + 1, end_p);
+					member_end_p = SkipJSONValue (member_value_p, end_p);
+
+					if (!member_end_p)
+						{
+							return false;
+						}
+
+					/* key_end_p is after the closing quote */
+					if (IsJSONSpanKeyEqualTo (key_start_p, key_end_p - 1, key_s, key_length))
+						{
+							value_p -> js_start_p = member_value_p;
+							value_p -> js_end_p = member_end_p;
+
+							return true;
+						}
+
+					data_p = SkipJSONWhitespace (member_end_p, end_p);
+
+					if ((data_p < end_p) && (*data_p == ','))
+						{
+							data_p = SkipJSONWhitespace (data_p + 1, end_p);
+						}
+					else
+						{
+							/* either the end of the object or an error */
+							return false;
+						}
+
+				}		/* while ((data_p < end_p) && (*data_p == '"')) */
+
+		}		/* if ((data_p < end_p) && (*data_p == '{')) */
+
+	return false;
+}
+
+
+bool GetJSONSpanPath (const JSONSpan *span_p, const char *path_s, JSONSpan *value_p)
+{
+	JSONSpan current = *span_p;
+	const char *key_start_s = path_s;
+
+	while (*key_start_s)
+		{
+			const char *key_end_s = strchr (key_start_s, '.');
+			char key_s [64];
+			size_t key_length;
+
+			if (!key_end_s)
+				{
+					key_end_s = key_start_s + strlen (key_start_s);
+				}
+
+			key_length = key_end_s - key_start_s;
+
+			if (key_length >= sizeof (key_s))
+				{
+					return false;
+				}
+
+			memcpy (key_s, key_start_s, key_length);
+			key_s [key_length] = '\0';
+
+			if (!GetJSONSpanMember (&current, key_s, &current))
+				{
+					return false;
+				}
+
+			key_start_s = (*key_end_s == '.') ? key_end_s + 1 : key_end_s;
+		}
+
+	*value_p = current;
+
+	return true;
+}
+
+
+bool InitJSONSpanIterator (JSONSpanIterator *iterator_p, const JSONSpan *array_p)
+{
+	if ((array_p -> js_start_p < array_p -> js_end_p) && (*array_p -> js_start_p == '['))
+		{
+			iterator_p -> jsi_current_p = array_p -> js_start_p + 1;
+			iterator_p -> jsi_end_p = array_p -> js_end_p;
+			iterator_p -> jsi_failed_flag = false;
+
+			return true;
+		}
+
+	return false;
+}
+
+
+bool GetNextJSONSpanElement (JSONSpanIterator *iterator_p, JSONSpan *value_p)
+{
+	const char *end_p = iterator_p -> jsi_end_p;
+	const char *data_p = SkipJSONWhitespace (iterator_p -> jsi_current_p, end_p);
+
+	if ((data_p < end_p) && (*data_p != ']'))
+		{
+			const char *value_end_p = SkipJSONValue (data_p, end_p);
+
+			if (value_end_p)
+				{
+					value_p -> js_start_p = data_p;
+					value_p -> js_end_p = value_end_p;
+
+					data_p = SkipJSONWhitespace (value_end_p, end_p);
+
+					if ((data_p < end_p) && (*data_p == ','))
+						{
+							++ data_p;
+						}
+
+					iterator_p -> jsi_current_p = data_p;
+
+					return true;
+				}
+
+			iterator_p -> jsi_failed_flag = true;
+		}
+
+	/* make sure that any further calls also fail */
+	iterator_p -> jsi_current_p = end_p;
+
+	return false;
+}
+
+
+void InitJSONSpanSequenceIterator (JSONSpanIterator *iterator_p, const char *data_s, const size_t length)
+{
+	iterator_p -> jsi_current_p = data_s;
+	iterator_p -> jsi_end_p = data_s + length;
+	iterator_p -> jsi_failed_flag = false;
+}
+
+
+bool InitJSONSpanMemberIterator (JSONSpanIterator *iterator_p, const JSONSpan *object_p)
+{
+	if ((object_p -> js_start_p < object_p -> js_end_p) && (*object_p -> js_start_p == '{'))
+		{
+			iterator_p -> jsi_current_p = object_p -> js_start_p + 1;
+			iterator_p -> jsi_end_p = object_p -> js_end_p;
+			iterator_p -> jsi_failed_flag = false;
+
+			return true;
+		}
+
+	return false;
+}
+
+
+bool GetNextJSONSpanMember (JSONSpanIterator *iterator_p, JSONSpan *key_p, JSONSpan *value_p)
+{
+	const char *end_p = iterator_p -> jsi_end_p;
+	const char *data_p = SkipJSONWhitespace (iterator_p -> jsi_current_p, end_p);
+
+	if ((data_p < end_p) && (*data_p != '}'))
+		{
+			const char *key_end_p = (*data_p == '"') ? SkipJSONString (data_p, end_p) : NULL;
+
+			if (key_end_p)
+				{
+					const char *value_start_p = SkipJSONWhitespace (key_end_p, end_p);
+
+					if ((value_start_p < end_p) && (*value_start_p == ':'))
+						{
+							const char *value_end_p;
+
+							value_start_p = SkipJSONWhitespace (value_start_p + 1, end_p);
+							value_end_p = SkipJSONValue (value_start_p, end_p);
+
+							if (value_end_p)
+								{
+									key_p -> js_start_p = data_p;
+									key_p -> js_end_p = key_end_p;
+									value_p -> js_start_p = value_start_p;
+									value_p -> js_end_p = value_end_p;
+
+									data_p = SkipJSONWhitespace (value_end_p, end_p);
+
+									if ((data_p < end_p) && (*data_p == ','))
+										{
+											++ data_p;
+										}
+
+									iterator_p -> jsi_current_p = data_p;
+
+									return true;
+								}
+						}
+				}
+
+			iterator_p -> jsi_failed_flag = true;
+		}
+
+	iterator_p -> jsi_current_p = end_p;
+
+	return false;
+}
+
+
+bool HasJSONSpanIteratorFailed (const JSONSpanIterator *iterator_p)
+{
+	return iterator_p -> jsi_failed_flag;
+}
+
+
+bool GetJSONSpanReal (const JSONSpan *span_p, double64 *value_p)
+{
+	const char *start_p = span_p -> js_start_p;
+	const char *end_p = span_p -> js_end_p;
+	size_t length;
+
+	if ((start_p < end_p) && (*start_p == '"'))
+		{
+			++ start_p;
+			-- end_p;
+		}
+
+	length = end_p - start_p;
+
+	return ParseDouble (start_p, length, value_p);
+}
+
+
+bool IsJSONSpanStringEqualTo (const JSONSpan *span_p, const char *value_s)
+{
+	if (GetJSONSpanType (span_p) == JST_STRING)
+		{
+			return IsJSONSpanKeyEqualTo (span_p -> js_start_p + 1, span_p -> js_end_p - 1, value_s, strlen (value_s));
+		}
+
+	return false;
+}
+
+
+char *GetJSONSpanString (const JSONSpan *span_p)
+{
+	const char *data_p = span_p -> js_start_p;
+	const char *end_p = span_p -> js_end_p;
+	char *value_s;
+	char *dest_p;
+
+	if ((end_p - data_p < 2) || (*data_p != '"') || (* (end_p - 1) != '"'))
+		{
+			return NULL;
+		}
+
+	++ data_p;
+	-- end_p;
+
+	/* decoding never makes the string longer */
+	value_s = (char *) AllocMemory (end_p - data_p + 1);
+
+	if (!value_s)
+		{
+			return NULL;
+		}
+
+	dest_p = value_s;
+
+	while (data_p < end_p)
+		{
+			const char *escape_p = (const char *) memchr (data_p, '\\', end_p - data_p);
+			const size_t l = (escape_p ? escape_p : end_p) - data_p;
+
+			memcpy (dest_p, data_p, l);
+			dest_p += l;
+			data_p += l;
+
+			if (escape_p)
+				{
+					if (escape_p + 1 == end_p)
+						{
+							break;
+						}
+
+					data_p = escape_p + 2;
+
+					switch (* (escape_p + 1))
+						{
+							case '"':
+							case '\\':
+							case '/':
+								*dest_p ++ = * (escape_p + 1);
+								break;
+
+							case 'b':
+								*dest_p ++ = '\b';
+								break;
+
+							case 'f':
+								*dest_p ++ = '\f';
+								break;
+
+							case 'n':
+								*dest_p ++ = '\n';
+								break;
+
+							case 'r':
+								*dest_p ++ = '\r';
+								break;
+
+							case 't':
+								*dest_p ++ = '\t';
+								break;
+
+							case 'u':
+								{
+									uint32 code_point;
+
+									data_p = GetJSONHexValue (data_p, end_p, &code_point);
+
+									/* a high surrogate must be followed by a low one */
+									if (data_p && (code_point >= 0xD800) && (code_point <= 0xDBFF))
+										{
+											uint32 low;
+
+											if ((end_p - data_p >= 2) && (*data_p == '\\') && (* (data_p + 1) == 'u') && ((data_p = GetJSONHexValue (data_p + 2, end_p, &low)) != NULL) && (low >= 0xDC00) && (low <= 0xDFFF))
+												{
+													code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+												}
+											else
+												{
+													data_p = NULL;
+												}
+										}
+									else if ((code_point >= 0xDC00) && (code_point <= 0xDFFF))
+										{
+											data_p = NULL;
+										}
+
+									/* \u0000 would truncate the string */
+									if ((!data_p) || (code_point == 0))
+										{
+											FreeMemory (value_s);
+											return NULL;
+										}
+
+									dest_p = WriteUTF8 (dest_p, code_point);
+								}
+								break;
+
+							default:
+								FreeMemory (value_s);
+								return NULL;
+						}
+
+				}		/* if (escape_p) */
+
+		}		/* while (data_p < end_p) */
+
+	if (data_p != end_p)
+		{
+			FreeMemory (value_s);
+			return NULL;
+		}
+
+	*dest_p = '\0';
+
+	return value_s;
+}
+
+
+static const char *GetJSONHexValue (const char *data_p, const char *end_p, uint32 *value_p)
+{
+	uint32 value = 0;
+	const char *hex_end_p = data_p + 4;
+
+	if (end_p - data_p < 4)
+		{
+			return NULL;
+		}
+
+	while (data_p < hex_end_p)
+		{
+			const char c = *data_p;
+
+			value <<= 4;
+
+			if ((c >= '0') && (c <= '9'))
+				{
+					value |= (uint32) (c - '0');
+				}
+			else if ((c >= 'a') && (c <= 'f'))
+				{
+					value |= (uint32) (c - 'a' + 10);
+				}
+			else if ((c >= 'A') && (c <= 'F'))
+				{
+					value |= (uint32) (c - 'A' + 10);
+				}
+			else
+				{
+					return NULL;
+				}
+
+			++ data_p;
+		}
+
+	*value_p = value;
+
+	return data_p;
+}
+
+
+/*
+ * An escape of n bytes, i.e. 6 or 12, never decodes to more than n bytes of UTF-8
+ */
+static char *WriteUTF8 (char *dest_s, const uint32 code_point)
+{
+	unsigned char *dest_p = (unsigned char *) dest_s;
+
+	if (code_point < 0x80)
+		{
+			*dest_p ++ = (unsigned char) code_point;
+		}
+	else if (code_point < 0x800)
+		{
+			*dest_p ++ = (unsigned char) (0xC0 | (code_point >> 6));
+			*dest_p ++ = (unsigned char) (0x80 | (code_point & 0x3F));
+		}
+	else if (code_point < 0x10000)
+		{
+			*dest_p ++ = (unsigned char) (0xE0 | (code_point >> 12));
+			*dest_p ++ = (unsigned char) (0x80 | ((code_point >> 6) & 0x3F));
+			*dest_p ++ = (unsigned char) (0x80 | (code_point & 0x3F));
+		}
+	else
+		{
+			*dest_p ++ = (unsigned char) (0xF0 | (code_point >> 18));
+			*dest_p ++ = (unsigned char) (0x80 | ((code_point >> 12) & 0x3F));
+			*dest_p ++ = (unsigned char) (0x80 | ((code_point >> 6) & 0x3F));
+			*dest_p ++ = (unsigned char) (0x80 | (code_point & 0x3F));
+		}
+
+	return (char *) dest_p;
+}
+
+
+static bool IsJSONSpanKeyEqualTo (const char *key_start_p, const char *key_end_p, const char *key_s, const size_t key_length)
+{
+	return ((((size_t) (key_end_p - key_start_p)) == key_length) && (memcmp (key_start_p, key_s, key_length) == 0));
+}
+
+
+static const char *SkipJSONWhitespace (const char *data_p, const char *end_p)
+{
+	while ((data_p < end_p) && ((*data_p == ' ') || (*data_p == '\n') || (*data_p == '\r') || (*data_p == '\t')))
+		{
+			++ data_p;
+		}
+
+	return data_p;
+}
+
+
+static const char *SkipJSONValue (const char *data_p, const char *end_p)
+{
+	if (data_p < end_p)
+		{
+			switch (*data_p)
+				{
+					case '{':
+					case '[':
+						return SkipJSONContainer (data_p, end_p);
+
+					case '"':
+						return SkipJSONString (data_p, end_p);
+
+					default:
+						return SkipJSONScalar (data_p, end_p);
+				}
+		}
+
+	return NULL;
+}
+
+
+/*
+ * data_p points to the opening quote. Return the position
+ * after the closing quote or NULL if the string is not closed.
+ */
+static const char *SkipJSONString (const char *data_p, const char *end_p)
+{
+	++ data_p;
+
+	while (data_p < end_p)
+		{
+#ifdef JSON_ON_DEMAND_USE_SSE2
+			const __m128i quote = _mm_set1_epi8 ('"');
+			const __m128i backslash = _mm_set1_epi8 ('\\');
+
+			/* jump over the blocks that contain neither a quote nor a backslash */
+			while (data_p + 16 <= end_p)
+				{
+					const __m128i v = _mm_loadu_si128 ((const __m128i *) data_p);
+					const int mask = _mm_movemask_epi8 (_mm_or_si128 (_mm_cmpeq_epi8 (v, quote), _mm_cmpeq_epi8 (v, backslash)));
+
+					if (mask)
+						{
+							data_p += GetFirstSetBit (mask);
+							break;
+						}
+					else
+						{
+							data_p += 16;
+						}
+				}
+#endif
+
+			while ((data_p < end_p) && (*data_p != '"') && (*data_p != '\\'))
+				{
+					++ data_p;
+				}
+
+			if (data_p < end_p)
+				{
+					if (*data_p == '"')
+						{
+							return data_p + 1;
+						}
+					else
+						{
+							/* skip the escaped character */
+							data_p += 2;
+						}
+				}
+		}
+
+	return NULL;
+}
+
+
+/*
+ * data_p points to the opening bracket. Return the position after
+ * the matching closing bracket or NULL if it is not found. Only the
+ * nesting is checked, the contents are validated if and when they
+ * are accessed.
+ */
+static const char *SkipJSONContainer (const char *data_p, const char *end_p)
+{
+	size_t depth = 0;
+
+	while (data_p < end_p)
+		{
+#ifdef JSON_ON_DEMAND_USE_SSE2
+			const __m128i quote = _mm_set1_epi8 ('"');
+			const __m128i open_brace = _mm_set1_epi8 ('{');
+			const __m128i close_brace = _mm_set1_epi8 ('}');
+			const __m128i open_bracket = _mm_set1_epi8 ('[');
+			const __m128i close_bracket = _mm_set1_epi8 (']');
+
+			/* jump over the blocks that contain no structural characters */
+			while (data_p + 16 <= end_p)
+				{
+					const __m128i v = _mm_loadu_si128 ((const __m128i *) data_p);
+					__m128i hits = _mm_or_si128 (_mm_cmpeq_epi8 (v, quote), _mm_cmpeq_epi8 (v, open_brace));
+					int mask;
+
+					hits = _mm_or_si128 (hits, _mm_or_si128 (_mm_cmpeq_epi8 (v, close_brace), _mm_cmpeq_epi8 (v, open_bracket)));
+					hits = _mm_or_si128 (hits, _mm_cmpeq_epi8 (v, close_bracket));
+					mask = _mm_movemask_epi8 (hits);
+
+					if (mask)
+						{
+							data_p += GetFirstSetBit (mask);
+							break;
+						}
+					else
+						{
+							data_p += 16;
+						}
+				}
+
+			if (data_p >= end_p)
+				{
+					break;
+				}
+#endif
+
+			switch (*data_p)
+				{
+					case '"':
+						data_p = SkipJSONString (data_p, end_p);
+
+						if (!data_p)
+							{
+								return NULL;
+							}
+						break;
+
+					case '{':
+					case '[':
+						++ depth;
+						++ data_p;
+						break;
+
+					case '}':
+					case ']':
+						-- depth;
+						++ data_p;
+
+						if (depth == 0)
+							{
+								return data_p;
+							}
+						break;
+
+					default:
+						++ data_p;
+						break;
+				}
+		}
+
+	return NULL;
+}
+
+
+static const char *SkipJSONScalar (const char *data_p, const char *end_p)
+{
+	const char *start_p = data_p;
+
+	while ((data_p < end_p) && (*data_p != ',') && (*data_p != '}') && (*data_p != ']') && (*data_p != ' ') && (*data_p != '\n') && (*data_p != '\r') && (*data_p != '\t'))
+		{
+			++ data_p;
+		}
+
+	return (data_p > start_p) ? data_p : NULL;
+}
+
+
+#ifdef JSON_ON_DEMAND_USE_SSE2
+static int GetFirstSetBit (const int mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+
+	_BitScanForward (&index, (unsigned long) mask);
+
+	return (int) index;
+#else
+	return __builtin_ctz ((unsigned int) mask);
+#endif
+}
+#endif
@@ -0,0 +1,753 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * json_stream.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <string.h>
+
+#include "json_stream.h"
+#include "double_conversion.h"
+
+#include "streams.h"
+
+
+typedef enum
+{
+	JSP_EXPECT_VALUE,
+	JSP_EXPECT_VALUE_OR_END,
+	JSP_EXPECT_KEY,
+	JSP_EXPECT_KEY_OR_END,
+	JSP_EXPECT_COLON,
+	JSP_EXPECT_SEPARATOR,
+	JSP_STRING,
+	JSP_STRING_ESCAPE,
+	JSP_STRING_UNICODE,
+	JSP_NUMBER,
+	JSP_LITERAL,
+	JSP_DONE
+} JSONStreamParserState;
+
+
+static bool IsJSONWhitespace (const char c);
+
+static JSONStreamStatus CallJSONStreamCallback (JSONStreamParser *parser_p, const JSONStreamEvent event, const char *value_s, const size_t value_length);
+
+static JSONStreamStatus StartValue (JSONStreamParser *parser_p, const char c, const bool allow_end_flag);
+
+static JSONStreamStatus EndContainer (JSONStreamParser *parser_p, const char c);
+
+static JSONStreamStatus EndScalar (JSONStreamParser *parser_p, const JSONStreamEvent event);
+
+static JSONStreamStatus EndString (JSONStreamParser *parser_p);
+
+static JSONStreamStatus EndLiteral (JSONStreamParser *parser_p);
+
+static bool AppendCodePoint (JSONStreamParser *parser_p, uint32 code_point);
+
+static bool AppendCharToToken (JSONStreamParser *parser_p, const char c);
+
+static bool IsValidJSONNumber (const char *value_s, const size_t length);
+
+
+
+bool InitJSONStreamParser (JSONStreamParser *parser_p, JSONStreamCallback callback_fn, void *callback_data_p)
+{
+	parser_p -> jsp_token_p = AllocateByteBuffer (256);
+
+	if (parser_p -> jsp_token_p)
+		{
+			parser_p -> jsp_callback_fn = callback_fn;
+			parser_p -> jsp_callback_data_p = callback_data_p;
+			parser_p -> jsp_depth = 0;
+			parser_p -> jsp_state = JSP_EXPECT_VALUE;
+			parser_p -> jsp_key_flag = false;
+			parser_p -> jsp_code_point = 0;
+			parser_p -> jsp_high_surrogate = 0;
+			parser_p -> jsp_num_hex_digits = 0;
+			parser_p -> jsp_status = JSS_CONTINUE;
+
+			return true;
+		}
+
+	return false;
+}
+
+
+void ClearJSONStreamParser (JSONStreamParser *parser_p)
+{
+	if (parser_p -> jsp_token_p)
+		{
+			FreeByteBuffer (parser_p -> jsp_token_p);
+			parser_p -> jsp_token_p = NULL;
+		}
+}
+
+
+bool IsJSONStreamParserComplete (const JSONStreamParser *parser_p)
+{
+	return ((parser_p -> jsp_state == JSP_DONE) ||
+		((parser_p -> jsp_state == JSP_NUMBER) && (parser_p -> jsp_depth == 0) &&
+			(IsValidJSONNumber (GetByteBufferData (parser_p -> jsp_token_p), GetByteBufferSize (parser_p -> jsp_token_p)))));
+}
+
+
+const char *GetJSONStreamKey (const JSONStreamParser *parser_p, const size_t depth)
+{
+	if ((depth > 0) && (depth <= parser_p -> jsp_depth) && ((parser_p -> jsp_containers [depth - 1]) == '{'))
+		{
+			return parser_p -> jsp_keys [depth - 1];
+		}
+
+	return NULL;
+}
+
+
+bool GetJSONStreamReal (const char *value_s, double64 *value_p)
+{
+	bool success_flag = false;
+
+	if (value_s)
+		{
+			success_flag = ParseDoubleString (value_s, value_p);
+		}
+
+	return success_flag;
+}
+
+
+JSONStreamStatus FeedJSONStreamParser (JSONStreamParser *parser_p, const char *data_p, const size_t length)
+{
+	const char *c_p = data_p;
+	const char * const end_p = data_p + length;
+	JSONStreamStatus status = parser_p -> jsp_status;
+
+	while ((c_p < end_p) && (status == JSS_CONTINUE))
+		{
+			const char c = *c_p;
+			bool consumed_flag = true;
+
+			switch (parser_p -> jsp_state)
+				{
+					case JSP_EXPECT_VALUE:
+					case JSP_EXPECT_VALUE_OR_END:
+						if (!IsJSONWhitespace (c))
+							{
+								status = StartValue (parser_p, c, (parser_p -> jsp_state == JSP_EXPECT_VALUE_OR_END));
+							}
+						break;
+
+					case JSP_EXPECT_KEY:
+					case JSP_EXPECT_KEY_OR_END:
+						if (c == '"')
+							{
+								ResetByteBuffer (parser_p -> jsp_token_p);
+								parser_p -> jsp_key_flag = true;
+								parser_p -> jsp_state = JSP_STRING;
+							}
+						else if ((c == '}') && (parser_p -> jsp_state == JSP_EXPECT_KEY_OR_END))
+							{
+								status = EndContainer (parser_p, c);
+							}
+						else if (!IsJSONWhitespace (c))
+							{
+								status = JSS_ERROR;
+							}
+						break;
+
+					case JSP_EXPECT_COLON:
+						if (c == ':')
+							{
+								parser_p -> jsp_state = JSP_EXPECT_VALUE;
+							}
+						else if (!IsJSONWhitespace (c))
+							{
+								status = JSS_ERROR;
+							}
+						break;
+
+					case JSP_EXPECT_SEPARATOR:
+						if (c == ',')
+							{
+								parser_p -> jsp_state = (parser_p -> jsp_containers [parser_p -> jsp_depth - 1] == '{') ? JSP_EXPECT_KEY : JSP_EXPECT_VALUE;
+							}
+						else if ((c == '}') || (c == ']'))
+							{
+								status = EndContainer (parser_p, c);
+							}
+						else if (!IsJSONWhitespace (c))
+							{
+								status = JSS_ERROR;
+							}
+						break;
+
+					case JSP_STRING:
+						{
+							/*
+							 * Copy everything up to the next quote or escape in one go
+							 */
+							const char *run_p = c_p;
+
+							while ((run_p < end_p) && (*run_p != '"') && (*run_p != '\\'))
+								{
+									++ run_p;
+								}
+
+							if (parser_p -> jsp_high_surrogate)
+								{
+									/* a high surrogate must be followed straight away by an escaped low one */
+									if (c != '\\')
+										{
+											status = JSS_ERROR;
+										}
+									else
+										{
+											parser_p -> jsp_state = JSP_STRING_ESCAPE;
+										}
+								}
+							else if (run_p > c_p)
+								{
+									if (!AppendToByteBuffer (parser_p -> jsp_token_p, c_p, run_p - c_p))
+										{
+											status = JSS_ERROR;
+										}
+
+									c_p = run_p;
+									consumed_flag = false;
+								}
+							else if (c == '"')
+								{
+									status = EndString (parser_p);
+								}
+							else
+								{
+									parser_p -> jsp_state = JSP_STRING_ESCAPE;
+								}
+						}
+						break;
+
+					case JSP_STRING_ESCAPE:
+						{
+							char unescaped_c = '\0';
+
+							parser_p -> jsp_state = JSP_STRING;
+
+							if ((parser_p -> jsp_high_surrogate) && (c != 'u'))
+								{
+									status = JSS_ERROR;
+								}
+
+							switch (c)
+								{
+									case '"':
+									case '\\':
+									case '/':
+										unescaped_c = c;
+										break;
+
+									case 'b':
+										unescaped_c = '\b';
+										break;
+
+									case 'f':
+										unescaped_c = '\f';
+										break;
+
+									case 'n':
+										unescaped_c = '\n';
+										break;
+
+									case 'r':
+										unescaped_c = '\r';
+										break;
+
+									case 't':
+										unescaped_c = '\t';
+										break;
+
+									case 'u':
+										parser_p -> jsp_state = JSP_STRING_UNICODE;
+										parser_p -> jsp_code_point = 0;
+										parser_p -> jsp_num_hex_digits = 0;
+										break;
+
+									default:
+										status = JSS_ERROR;
+										break;
+								}
+
+							if (unescaped_c != '\0')
+								{
+									if (!AppendCharToToken (parser_p, unescaped_c))
+										{
+											status = JSS_ERROR;
+										}
+								}
+						}
+						break;
+
+					case JSP_STRING_UNICODE:
+						{
+							uint32 digit;
+
+							if ((c >= '0') && (c <= '9'))
+								{
+									digit = c - '0';
+								}
+							else if ((c >= 'a') && (c <= 'f'))
+								{
+									digit = c - 'a' + 10;
+								}
+							else if ((c >= 'A') && (c <= 'F'))
+								{
+									digit = c - 'A' + 10;
+								}
+							else
+								{
+									digit = 16;
+									status = JSS_ERROR;
+								}
+
+							if (digit < 16)
+								{
+									parser_p -> jsp_code_point = ((parser_p -> jsp_code_point) << 4) | digit;
+
+									if (++ (parser_p -> jsp_num_hex_digits) == 4)
+										{
+											const uint32 code_point = parser_p -> jsp_code_point;
+
+											parser_p -> jsp_state = JSP_STRING;
+
+											if ((code_point >= 0xD800) && (code_point <= 0xDBFF))
+												{
+													if (parser_p -> jsp_high_surrogate)
+														{
+															status = JSS_ERROR;
+														}
+													else
+														{
+															/* wait for the low surrogate */
+															parser_p -> jsp_high_surrogate = code_point;
+														}
+												}
+											else if ((code_point >= 0xDC00) && (code_point <= 0xDFFF))
+												{
+													if (parser_p -> jsp_high_surrogate)
+														{
+															const uint32 combined = 0x10000 + (((parser_p -> jsp_high_surrogate) - 0xD800) << 10) + (code_point - 0xDC00);
+
+															parser_p -> jsp_high_surrogate = 0;
+
+															if (!AppendCodePoint (parser_p, combined))
+																{
+																	status = JSS_ERROR;
+																}
+														}
+													else
+														{
+															/* a low surrogate without a high one */
+															status = JSS_ERROR;
+														}
+												}
+											else if (parser_p -> jsp_high_surrogate)
+												{
+													status = JSS_ERROR;
+												}
+											else
+												{
+													if (!AppendCodePoint (parser_p, code_point))
+														{
+															status = JSS_ERROR;
+														}
+												}
+										}
+								}
+						}
+						break;
+
+					case JSP_NUMBER:
+						if (((c >= '0') && (c <= '9')) || (c == '.') || (c == 'e') || (c == 'E') || (c == '+') || (c == '-'))
+							{
+								if (!AppendCharToToken (parser_p, c))
+									{
+										status = JSS_ERROR;
+									}
+							}
+						else if (IsValidJSONNumber (GetByteBufferData (parser_p -> jsp_token_p), GetByteBufferSize (parser_p -> jsp_token_p)))
+							{
+								status = EndScalar (parser_p, JSE_NUMBER);
+								consumed_flag = false;
+							}
+						else
+							{
+								status = JSS_ERROR;
+							}
+						break;
+
+					case JSP_LITERAL:
+						if ((c >= 'a') && (c <= 'z'))
+							{
+								if (!AppendCharToToken (parser_p, c))
+									{
+										status = JSS_ERROR;
+									}
+							}
+						else
+							{
+								status = EndLiteral (parser_p);
+								consumed_flag = false;
+							}
+						break;
+
+					case JSP_DONE:
+						if (!IsJSONWhitespace (c))
+							{
+								status = JSS_ERROR;
+							}
+						break;
+
+					default:
+						status = JSS_ERROR;
+						break;
+				}		/* switch (parser_p -> jsp_state) */
+
+			if (consumed_flag)
+				{
+					++ c_p;
+				}
+
+		}		/* while ((c_p < end_p) && (status == JSS_CONTINUE)) */
+
+	if (status == JSS_ERROR)
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to parse JSON stream at depth " SIZET_FMT, parser_p -> jsp_depth);
+		}
+
+	parser_p -> jsp_status = status;
+
+	return status;
+}
+
+
+static bool IsJSONWhitespace (const char c)
+{
+	return ((c == ' ') || (c == '\n') || (c == '\r') || (c == '\t'));
+}
+
+
+static JSONStreamStatus CallJSONStreamCallback (JSONStreamParser *parser_p, const JSONStreamEvent event, const char *value_s, const size_t value_length)
+{
+	const size_t depth = parser_p -> jsp_depth;
+
+	return parser_p -> jsp_callback_fn (parser_p -> jsp_callback_data_p, parser_p, event, depth, GetJSONStreamKey (parser_p, depth), value_s, value_length);
+}
+
+
+static JSONStreamStatus StartValue (JSONStreamParser *parser_p, const char c, const bool allow_end_flag)
+{
+	JSONStreamStatus status = JSS_CONTINUE;
+
+	switch (c)
+		{
+			case '{':
+			case '[':
+				if (parser_p -> jsp_depth < JSON_STREAM_MAX_DEPTH)
+					{
+						status = CallJSONStreamCallback (parser_p, (c == '{') ? JSE_OBJECT_START : JSE_ARRAY_START, NULL, 0);
+
+						parser_p -> jsp_containers [parser_p -> jsp_depth] = c;
+						* (parser_p -> jsp_keys [parser_p -> jsp_depth]) = '\0';
+						++ (parser_p -> jsp_depth);
+
+						parser_p -> jsp_state = (c == '{') ? JSP_EXPECT_KEY_OR_END : JSP_EXPECT_VALUE_OR_END;
+					}
+				else
+					{
+						PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "JSON is nested more than %d levels deep", JSON_STREAM_MAX_DEPTH);
+						status = JSS_ERROR;
+					}
+				break;
+
+			case ']':
+				status = allow_end_flag ? EndContainer (parser_p, c) : JSS_ERROR;
+				break;
+
+			case '"':
+				ResetByteBuffer (parser_p -> jsp_token_p);
+				parser_p -> jsp_key_flag = false;
+				parser_p -> jsp_state = JSP_STRING;
+				break;
+
+			case 't':
+			case 'f':
+			case 'n':
+				ResetByteBuffer (parser_p -> jsp_token_p);
+
+				if (AppendCharToToken (parser_p, c))
+					{
+						parser_p -> jsp_state = JSP_LITERAL;
+					}
+				else
+					{
+						status = JSS_ERROR;
+					}
+				break;
+
+			default:
+				if (((c >= '0') && (c <= '9')) || (c == '-'))
+					{
+						ResetByteBuffer (parser_p -> jsp_token_p);
+
+						if (AppendCharToToken (parser_p, c))
+							{
+								parser_p -> jsp_state = JSP_NUMBER;
+							}
+						else
+							{
+								status = JSS_ERROR;
+							}
+					}
+				else
+					{
+						status = JSS_ERROR;
+					}
+				break;
+		}
+
+	return status;
+}
+
+
+static JSONStreamStatus EndContainer (JSONStreamParser *parser_p, const char c)
+{
+	JSONStreamStatus status = JSS_ERROR;
+
+	if (parser_p -> jsp_depth > 0)
+		{
+			const char open_c = parser_p -> jsp_containers [parser_p -> jsp_depth - 1];
+
+			if (((open_c == '{') && (c == '}')) || ((open_c == '[') && (c == ']')))
+				{
+					-- (parser_p -> jsp_depth);
+
+					status = CallJSONStreamCallback (parser_p, (c == '}') ? JSE_OBJECT_END : JSE_ARRAY_END, NULL, 0);
+
+					parser_p -> jsp_state = (parser_p -> jsp_depth == 0) ? JSP_DONE : JSP_EXPECT_SEPARATOR;
+				}
+		}
+
+	return status;
+}
+
+
+static JSONStreamStatus EndScalar (JSONStreamParser *parser_p, const JSONStreamEvent event)
+{
+	JSONStreamStatus status;
+
+	if ((event == JSE_STRING) || (event == JSE_NUMBER))
+		{
+			status = CallJSONStreamCallback (parser_p, event, GetByteBufferData (parser_p -> jsp_token_p), GetByteBufferSize (parser_p -> jsp_token_p));
+		}
+	else
+		{
+			status = CallJSONStreamCallback (parser_p, event, NULL, 0);
+		}
+
+	parser_p -> jsp_state = (parser_p -> jsp_depth == 0) ? JSP_DONE : JSP_EXPECT_SEPARATOR;
+
+	return status;
+}
+
+
+static JSONStreamStatus EndString (JSONStreamParser *parser_p)
+{
+	JSONStreamStatus status = JSS_CONTINUE;
+
+	if (parser_p -> jsp_key_flag)
+		{
+			char *key_s = parser_p -> jsp_keys [parser_p -> jsp_depth - 1];
+			size_t key_length = GetByteBufferSize (parser_p -> jsp_token_p);
+
+			if (key_length >= JSON_STREAM_MAX_KEY_LENGTH)
+				{
+					key_length = JSON_STREAM_MAX_KEY_LENGTH - 1;
+				}
+
+			if (key_length > 0)
+				{
+					memcpy (key_s, GetByteBufferData (parser_p -> jsp_token_p), key_length);
+				}
+
+			* (key_s + key_length) = '\0';
+
+			parser_p -> jsp_key_flag = false;
+			parser_p -> jsp_state = JSP_EXPECT_COLON;
+		}
+	else
+		{
+			status = EndScalar (parser_p, JSE_STRING);
+		}
+
+	return status;
+}
+
+
+static JSONStreamStatus EndLiteral (JSONStreamParser *parser_p)
+{
+	JSONStreamStatus status = JSS_ERROR;
+	const char *literal_s = GetByteBufferData (parser_p -> jsp_token_p);
+
+	if (strcmp (literal_s, "true") == 0)
+		{
+			status = EndScalar (parser_p, JSE_TRUE);
+		}
+	else if (strcmp (literal_s, "false") == 0)
+		{
+			status = EndScalar (parser_p, JSE_FALSE);
+		}
+	else if (strcmp (literal_s, "null") == 0)
+		{
+			status = EndScalar (parser_p, JSE_NULL);
+		}
+
+	return status;
+}
+
+
+static bool AppendCharToToken (JSONStreamParser *parser_p, const char c)
+{
+	return AppendToByteBuffer (parser_p -> jsp_token_p, &c, 1);
+}
+
+
+/*
+ * Write a unicode code point from a \u escape as UTF-8
+ */
+static bool AppendCodePoint (JSONStreamParser *parser_p, uint32 code_point)
+{
+	char utf8_s [4];
+	size_t length;
+
+	if (code_point < 0x80)
+		{
+			utf8_s [0] = (char) code_point;
+			length = 1;
+		}
+	else if (code_point < 0x800)
+		{
+			utf8_s [0] = (char) (0xC0 | (code_point >> 6));
+			utf8_s [1] = (char) (0x80 | (code_point & 0x3F));
+			length = 2;
+		}
+	else if (code_point < 0x10000)
+		{
+			utf8_s [0] = (char) (0xE0 | (code_point >> 12));
+			utf8_s [1] = (char) (0x80 | ((code_point >> 6) & 0x3F));
+			utf8_s [2] = (char) (0x80 | (code_point & 0x3F));
+			length = 3;
+		}
+	else
+		{
+			utf8_s [0] = (char) (0xF0 | (code_point >> 18));
+			utf8_s [1] = (char) (0x80 | ((code_point >> 12) & 0x3F));
+			utf8_s [2] = (char) (0x80 | ((code_point >> 6) & 0x3F));
+			utf8_s [3] = (char) (0x80 | (code_point & 0x3F));
+			length = 4;
+		}
+
+	return AppendToByteBuffer (parser_p -> jsp_token_p, utf8_s, length);
+}
+
+
+/*
+ * Check that a number matches the JSON grammar, i.e.
+ * -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+ * so that the likes of "01" and "1.2.3" are rejected.
+ */
+static bool IsValidJSONNumber (const char *value_s, const size_t length)
+{
+	const char *c_p = value_s;
+	const char * const end_p = value_s + length;
+	const char *digits_p;
+
+	if ((c_p < end_p) && (*c_p == '-'))
+		{
+			++ c_p;
+		}
+
+	if (c_p == end_p)
+		{
+			return false;
+		}
+
+	if (*c_p == '0')
+		{
+			++ c_p;
+		}
+	else if ((*c_p >= '1') && (*c_p <= '9'))
+		{
+			while ((c_p < end_p) && (*c_p >= '0') && (*c_p <= '9'))
+				{
+					++ c_p;
+				}
+		}
+	else
+		{
+			return false;
+		}
+
+	if ((c_p < end_p) && (*c_p == '.'))
+		{
+			digits_p = ++ c_p;
+
+			while ((c_p < end_p) && (*c_p >= '0') && (*c_p <= '9'))
+				{
+					++ c_p;
+				}
+
+			if (c_p == digits_p)
+				{
+					return false;
+				}
+		}
+
+	if ((c_p < end_p) && ((*c_p == 'e') || (*c_p == 'E')))
+		{
+			++ c_p;
+
+			if ((c_p < end_p) && ((*c_p == '+') || (*c_p == '-')))
+				{
+					++ c_p;
+				}
+
+			digits_p = c_p;
+
+			while ((c_p < end_p) && (*c_p >= '0') && (*c_p <= '9'))
+				{
+					++ c_p;
+				}
+
+			if (c_p == digits_p)
+				{
+					return false;
+				}
+		}
+
+	return (c_p == end_p);
+}
@@ -0,0 +1,121 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * mapped_file.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include "mapped_file.h"
+
+
+bool OpenMappedFile (MappedFile *file_p, const char *filename_s, const size_t min_size, const MappedFileAccess access)
+{
+#ifdef _WIN32
+	HANDLE file_handle = CreateFileA (filename_s, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+#else
+	int fd = open (filename_s, O_RDONLY);
+#endif
+
+	file_p -> mf_data_p = NULL;
+	file_p -> mf_size = 0;
+	file_p -> mf_handle_p = NULL;
+
+#ifdef _WIN32
+	/* Windows has no equivalent of madvise for a whole view */
+	(void) access;
+
+	if (file_handle != INVALID_HANDLE_VALUE)
+		{
+			LARGE_INTEGER file_size;
+
+			if (GetFileSizeEx (file_handle, &file_size) && (file_size.QuadPart >= (LONGLONG) min_size))
+				{
+					HANDLE mapping_handle = CreateFileMappingA (file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+					if (mapping_handle)
+						{
+							const uint8 *data_p = (const uint8 *) MapViewOfFile (mapping_handle, FILE_MAP_READ, 0, 0, 0);
+
+							if (data_p)
+								{
+									file_p -> mf_data_p = data_p;
+									file_p -> mf_size = (size_t) file_size.QuadPart;
+									file_p -> mf_handle_p = mapping_handle;
+								}
+							else
+								{
+									CloseHandle (mapping_handle);
+								}
+						}
+				}
+
+			/* the mapping keeps its own reference to the file */
+			CloseHandle (file_handle);
+		}
+#else
+	if (fd != -1)
+		{
+			struct stat st;
+
+			if ((fstat (fd, &st) == 0) && (st.st_size >= (off_t) min_size))
+				{
+					void *map_p = mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+					if (map_p != MAP_FAILED)
+						{
+							file_p -> mf_data_p = (const uint8 *) map_p;
+							file_p -> mf_size = (size_t) st.st_size;
+
+							madvise (map_p, file_p -> mf_size, (access == MFA_SEQUENTIAL) ? MADV_SEQUENTIAL : MADV_RANDOM);
+						}
+				}
+
+			/* the mapping stays valid after the file is closed */
+			close (fd);
+		}
+#endif
+
+	return (file_p -> mf_data_p != NULL);
+}
+
+
+void CloseMappedFile (MappedFile *file_p)
+{
+	if (file_p -> mf_data_p)
+		{
+#ifdef _WIN32
+			UnmapViewOfFile (file_p -> mf_data_p);
+			CloseHandle ((HANDLE) (file_p -> mf_handle_p));
+#else
+			munmap ((void *) (file_p -> mf_data_p), file_p -> mf_size);
+#endif
+
+			file_p -> mf_data_p = NULL;
+			file_p -> mf_size = 0;
+			file_p -> mf_handle_p = NULL;
+		}
+}
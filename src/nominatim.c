@@ -21,6 +21,8 @@
  */
 
 #include <ctype.h>
+#include <stddef.h>
+#include <string.h>
 
 #include "nominatim.h"
 
@@ -32,79 +34,92 @@
 #include "string_utils.h"
 #include "math_utils.h"
 #include "geocoder_util.h"
+#include "url_escape.h"
+#include "json_stream.h"
+#include "json_on_demand.h"
+#include "double_conversion.h"
+#include "memory_allocations.h"
+#include "postcode.h"
+#include "query_strategy.h"
 
 
 
-static int PopulateAddressForNominatim (Address *address_p, const json_t *result_p);
+/*
+ * The state used when streaming the results of a search call
+ */
+typedef struct NominatimSearchStream
+{
+	Address *nss_address_p;
+	double64 nss_latitude;
+	double64 nss_longitude;
+	double64 nss_bounds [4];
+	size_t nss_num_bounds;
+	bool nss_has_latitude_flag;
+	bool nss_has_longitude_flag;
+	size_t nss_num_results;
+	int nss_res;
+} NominatimSearchStream;
 
-static int ParseNominatimResults (Address *address_p, const json_t *web_service_results_p);
 
-static bool SetValidAddressComponent (const json_t *json_p, const char *key_s, char **value_ss);
+/*
+ * The state used when streaming the results of a reverse call
+ */
+typedef struct NominatimReverseStream
+{
+	Address *nrs_address_p;
+	int nrs_res;
+} NominatimReverseStream;
 
-static int AddEscapedValue (ByteBuffer *buffer_p, const char *key_s, const char *value_s, bool *first_param_flag_p, CurlTool *tool_p);
 
-static bool BuildNominatimURLUsingComponentsParameters (ByteBuffer *buffer_p, const Address * const address_p, CurlTool *tool_p);
+/*
+ * The keys within the address object of a reverse call and
+ * where they are stored in an Address.
+ */
+typedef struct NominatimAddressKey
+{
+	const char *nak_key_s;
+	size_t nak_offset;
+} NominatimAddressKey;
 
 
-bool RunNominatimGeocoder (Address *address_p, const char *geocoder_uri_s)
+static const NominatimAddressKey S_ADDRESS_KEYS_P [] =
 {
-	bool got_location_flag = false;
+	{ "street", offsetof (Address, ad_street_s) },
+	{ "city", offsetof (Address, ad_town_s) },
+	{ "county", offsetof (Address, ad_county_s) },
+	{ "country", offsetof (Address, ad_country_s) },
+	{ "country_code", offsetof (Address, ad_country_code_s) },
+	{ "postcode", offsetof (Address, ad_postcode_s) },
+	{ NULL, 0 }
+};
 
-	ByteBuffer *buffer_p = AllocateByteBuffer (1024);
 
-	if (buffer_p)
-		{
-			if (AppendStringToByteBuffer (buffer_p, geocoder_uri_s))
-				{
-					CurlTool *curl_p = AllocateMemoryCurlTool (0);
+static bool SetValidAddressComponent (const json_t *json_p, const char *key_s, char **value_ss);
 
-					if (curl_p)
-						{
-							if (BuildNominatimURLUsingComponentsParameters (buffer_p, address_p, curl_p))
-								{
-									const char *url_s = GetByteBufferData (buffer_p);
-									int res = CallGeocoderWebService (curl_p, url_s, address_p, ParseNominatimResults);
+static bool ReplaceAddressComponent (const char *value_s, char **value_ss);
 
-									if (res == 1)
-										{
-											got_location_flag = true;
-										}
-									else if (res == 0)
-										{
-											ResetByteBuffer (buffer_p);
+static bool GetNominatimReal (const json_t *json_p, const char *key_s, double64 *value_p);
 
-											if (AppendStringToByteBuffer (buffer_p, geocoder_uri_s))
-												{
-													if (BuildURLUsingAddressParameter (buffer_p, curl_p, address_p, "&q=", ",%20"))
-														{
-															url_s = GetByteBufferData (buffer_p);
-															res = CallGeocoderWebService (curl_p, url_s, address_p, ParseNominatimResults);
+static bool GetNominatimRealValue (const json_t *value_p, double64 *real_p);
 
-															if (res == 1)
-																{
-																	got_location_flag = true;
-																}
-														}
-												}
+static int CallNominatimSearch (CurlTool *curl_p, const char *url_s, Address *address_p);
 
-										}
+static JSONStreamStatus ParseNominatimSearchStream (void *data_p, const JSONStreamParser *parser_p, const JSONStreamEvent event, const size_t depth, const char *key_s, const char *value_s, const size_t value_length);
 
-								}
+static JSONStreamStatus ParseNominatimReverseStream (void *data_p, const JSONStreamParser *parser_p, const JSONStreamEvent event, const size_t depth, const char *key_s, const char *value_s, const size_t value_length);
 
-							FreeCurlTool (curl_p);
-						}
+static int AddEscapedValue (ByteBuffer *buffer_p, const char *key_s, const char *value_s, bool *first_param_flag_p);
 
+static bool BuildNominatimURLUsingComponentsParameters (ByteBuffer *buffer_p, const Address * const address_p);
 
+static bool BuildNominatimURLUsingAddressParameter (ByteBuffer *buffer_p, const Address * const address_p);
 
-				}		/* if (AppendStringToByteBuffer (buffer_p, data_p -> msd_geocoding_uri_s)) */
-			else
-				{
-				}
 
-			FreeByteBuffer (buffer_p);
-		}		/* if (buffer_p) */
+bool RunNominatimGeocoder (Address *address_p, const char *geocoder_uri_s)
+{
+	static const BuildQueryFunction build_fns [QF_NUM_FORMS] = { BuildNominatimURLUsingComponentsParameters, BuildNominatimURLUsingAddressParameter };
 
-	return got_location_flag;
+	return RunQueryForms (QP_NOMINATIM, address_p, geocoder_uri_s, build_fns, CallNominatimSearch, QF_STRUCTURED);
 }
 
 
@@ -120,43 +135,30 @@ bool RunNominatimReverseGeocoder (Address *address_p, const char *reverse_geocod
 
 			if (buffer_p)
 				{
-					if (AppendStringToByteBuffer (buffer_p, reverse_geocoder_url_s))
-						{
-							char *lat_s = ConvertDoubleToString (address_p -> ad_gps_centre_p -> co_x);
+					char lat_s [DOUBLE_CONVERSION_BUFFER_SIZE];
+					char lon_s [DOUBLE_CONVERSION_BUFFER_SIZE];
 
-							if (lat_s)
-								{
-									if (AppendStringsToByteBuffer (buffer_p, "?format=json&lat=", lat_s, NULL))
-										{
-											char *lon_s = ConvertDoubleToString (address_p -> ad_gps_centre_p -> co_y);
+					WriteShortestDouble (address_p -> ad_gps_centre_p -> co_x, lat_s);
+					WriteShortestDouble (address_p -> ad_gps_centre_p -> co_y, lon_s);
 
-											if (lon_s)
-												{
-													if (AppendStringsToByteBuffer (buffer_p, "&lon=", lon_s, NULL))
-														{
-															if (AppendStringToByteBuffer (buffer_p, "&addressdetails=1"))
-																{
-																	CurlTool *curl_p = AllocateMemoryCurlTool (0);
-
-																	if (curl_p)
-																		{
-																			const char *url_s = GetByteBufferData (buffer_p);
+					if (AppendStringsToByteBuffer (buffer_p, reverse_geocoder_url_s, "?format=json&lat=", lat_s, "&lon=", lon_s, "&addressdetails=1", NULL))
+						{
+							CurlTool *curl_p = AllocateMemoryCurlTool (0);
 
-																			if (CallGeocoderWebService (curl_p, url_s, address_p, PopulateAddressForNominatim))
-																				{
-																					got_location_flag = true;
-																				}
+							if (curl_p)
+								{
+									const char *url_s = GetByteBufferData (buffer_p);
+									NominatimReverseStream stream;
 
-																			FreeCurlTool (curl_p);
-																		}
-																}
-														}
+									stream.nrs_address_p = address_p;
+									stream.nrs_res = 0;
 
-													FreeCopiedString (lon_s);
-												}
+									if (CallGeocoderWebServiceStreaming (curl_p, url_s, ParseNominatimReverseStream, &stream))
+										{
+											got_location_flag = (stream.nrs_res == 1);
 										}
 
-									FreeCopiedString (lat_s);
+									FreeCurlTool (curl_p);
 								}
 						}
 
@@ -204,7 +206,7 @@ bool RunNominatimReverseGeocoder (Address *address_p, const char *reverse_geocod
     }
   },
  */
-static int PopulateAddressForNominatim (Address *address_p, const json_t *result_p)
+int PopulateAddressForNominatim (Address *address_p, const json_t *result_p)
 {
 	bool success_flag = false;
 	const json_t *address_json_p = json_object_get (result_p, "address");
@@ -250,16 +252,8 @@ static bool SetValidAddressComponent (const json_t *json_p, const char *key_s, c
 
 	if (value_s)
 		{
-			char *copied_value_s = EasyCopyToNewString (value_s);
-
-			if (copied_value_s)
+			if (ReplaceAddressComponent (value_s, value_ss))
 				{
-					if (*value_ss)
-						{
-							FreeCopiedString (*value_ss);
-						}
-
-					*value_ss = copied_value_s;
 					success_flag = true;
 				}
 			else
@@ -277,6 +271,56 @@ static bool SetValidAddressComponent (const json_t *json_p, const char *key_s, c
 }
 
 
+/*
+ * Nominatim sends its coordinates as strings so accept
+ * either these or plain numbers.
+ */
+static bool GetNominatimReal (const json_t *json_p, const char *key_s, double64 *value_p)
+{
+	const json_t *value_json_p = json_object_get (json_p, key_s);
+
+	return ((value_json_p != NULL) && (GetNominatimRealValue (value_json_p, value_p)));
+}
+
+
+static bool GetNominatimRealValue (const json_t *value_p, double64 *real_p)
+{
+	bool success_flag = false;
+
+	if (json_is_string (value_p))
+		{
+			success_flag = ParseDouble (json_string_value (value_p), json_string_length (value_p), real_p);
+		}
+	else if (json_is_number (value_p))
+		{
+			*real_p = json_number_value (value_p);
+			success_flag = true;
+		}
+
+	return success_flag;
+}
+
+
+static bool ReplaceAddressComponent (const char *value_s, char **value_ss)
+{
+	bool success_flag = false;
+	char *copied_value_s = EasyCopyToNewString (value_s);
+
+	if (copied_value_s)
+		{
+			if (*value_ss)
+				{
+					FreeCopiedString (*value_ss);
+				}
+
+			*value_ss = copied_value_s;
+			success_flag = true;
+		}
+
+	return success_flag;
+}
+
+
 /*
  [
   {
@@ -318,7 +362,7 @@ static bool SetValidAddressComponent (const json_t *json_p, const char *key_s, c
 ]
  *
  */
-static int ParseNominatimResults (Address *address_p, const json_t *web_service_results_p)
+int ParseNominatimResults (Address *address_p, const json_t *web_service_results_p)
 {
 	int res = -1;
 
@@ -337,11 +381,11 @@ static int ParseNominatimResults (Address *address_p, const json_t *web_service_
 									const json_t *result_p = json_array_get (web_service_results_p, i);
 									double latitude;
 
-									if (GetJSONStringAsDouble (result_p, "lat", &latitude))
+									if (GetNominatimReal (result_p, "lat", &latitude))
 										{
 											double longitude;
 
-											if (GetJSONStringAsDouble (result_p, "lon", &longitude))
+											if (GetNominatimReal (result_p, "lon", &longitude))
 												{
 													if (SetAddressCentreCoordinate (address_p, latitude, longitude, NULL))
 														{
@@ -357,55 +401,55 @@ static int ParseNominatimResults (Address *address_p, const json_t *web_service_
 																				{
 																					double min_latitude;
 
-																					if (GetRealValueFromJSONString (json_array_get (bounds_p, 0), &min_latitude))
+																					if (GetNominatimRealValue (json_array_get (bounds_p, 0), &min_latitude))
 																						{
 																							double max_latitude;
 
-																							if (GetRealValueFromJSONString (json_array_get (bounds_p, 1), &max_latitude))
+																							if (GetNominatimRealValue (json_array_get (bounds_p, 1), &max_latitude))
 																								{
 																									double min_longitude;
 
-																									if (GetRealValueFromJSONString (json_array_get (bounds_p, 2), &min_longitude))
+																									if (GetNominatimRealValue (json_array_get (bounds_p, 2), &min_longitude))
 																										{
 																											double max_longitude;
 
-																											if (GetRealValueFromJSONString (json_array_get (bounds_p, 3), &max_longitude))
+																											if (GetNominatimRealValue (json_array_get (bounds_p, 3), &max_longitude))
 																												{
-																													if (SetAddressNorthEastCoordinate (address_p, min_latitude, min_longitude, NULL))
+																													if (SetAddressNorthEastCoordinate (address_p, max_latitude, max_longitude, NULL))
 																														{
-																															if (SetAddressSouthWestCoordinate (address_p, max_latitude, max_longitude, NULL))
+																															if (SetAddressSouthWestCoordinate (address_p, min_latitude, min_longitude, NULL))
 																																{
 																																	res = 1;
 																																}
 																															else
 																																{
-																																	PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to set south-west location from %lf %lf ", max_latitude, max_longitude);
+																																	PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to set south-west location from %lf %lf ", min_latitude, min_longitude);
 																																}
 																														}
 																													else
 																														{
-																															PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to set north-east location from %lf %lf ", min_latitude, min_longitude);
+																															PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to set north-east location from %lf %lf ", max_latitude, max_longitude);
 																														}
 
-																												}		/* if (GetRealValueFromJSONString (json_array_get (bounds_p, 3), &max_longitude)) */
+																												}		/* if (GetNominatimRealValue (json_array_get (bounds_p, 3), &max_longitude)) */
 																											else
 																												{
 																													PrintJSONToErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, bounds_p, "failed to get index 3 as real value from string");
 																												}
 
-																										}		/* if (GetRealValueFromJSONString (json_array_get (bounds_p, 2), &min_longitude)) */
+																										}		/* if (GetNominatimRealValue (json_array_get (bounds_p, 2), &min_longitude)) */
 																									else
 																										{
 																											PrintJSONToErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, bounds_p, "failed to get index 2 as real value from string");
 																										}
 
-																								}		/* if (GetRealValueFromJSONString (json_array_get (bounds_p, 1), &max_latitude)) */
+																								}		/* if (GetNominatimRealValue (json_array_get (bounds_p, 1), &max_latitude)) */
 																							else
 																								{
 																									PrintJSONToErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, bounds_p, "failed to get index 1 as real value from string");
 																								}
 
-																						}		/* if (GetRealValueFromJSONString (json_array_get (bounds_p, 0), &min_latitude)) */
+																						}		/* if (GetNominatimRealValue (json_array_get (bounds_p, 0), &min_latitude)) */
 																					else
 																						{
 																							PrintJSONToErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, bounds_p, "failed to get index 0 as real value from string");
@@ -435,13 +479,13 @@ static int ParseNominatimResults (Address *address_p, const json_t *web_service_
 															PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "SetAddressCentreCoordinate failed for \"%s\" to %lf,%lf", address_p -> ad_name_s, latitude, longitude);
 														}
 
-												}		/* if (GetJSONStringAsDouble (result_p, "lon", &longitude)) */
+												}		/* if (GetNominatimReal (result_p, "lon", &longitude)) */
 											else
 												{
 													PrintJSONToErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, result_p, "Failed to get longitude");
 												}
 
-										}		/* if (GetJSONStringAsDouble (result_p, "lat", &latitude)) */
+										}		/* if (GetNominatimReal (result_p, "lat", &latitude)) */
 									else
 										{
 											PrintJSONToErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, result_p, "Failed to get latitude");
@@ -471,27 +515,337 @@ static int ParseNominatimResults (Address *address_p, const json_t *web_service_
 
 
 
-static bool BuildNominatimURLUsingComponentsParameters (ByteBuffer *buffer_p, const Address * const address_p, CurlTool *tool_p)
+int ParseNominatimResultsOnDemand (Address *address_p, const char *response_s, const size_t length)
+{
+	int res = -1;
+	JSONSpan results;
+
+	if (InitJSONSpan (&results, response_s, length))
+		{
+			JSONSpanIterator iterator;
+
+			if (InitJSONSpanIterator (&iterator, &results))
+				{
+					JSONSpan result;
+					size_t num_results = 0;
+
+					while ((res == -1) && (GetNextJSONSpanElement (&iterator, &result)))
+						{
+							JSONSpan value;
+							double64 latitude;
+							double64 longitude;
+
+							++ num_results;
+
+							if ((GetJSONSpanMember (&result, "lat", &value)) && (GetJSONSpanReal (&value, &latitude)))
+								{
+									if ((GetJSONSpanMember (&result, "lon", &value)) && (GetJSONSpanReal (&value, &longitude)))
+										{
+											if (SetAddressCentreCoordinate (address_p, latitude, longitude, NULL))
+												{
+													JSONSpanIterator bounds_iterator;
+													double64 bounds [4];
+													size_t num_bounds = 0;
+
+													if ((GetJSONSpanMember (&result, "boundingbox", &value)) && (InitJSONSpanIterator (&bounds_iterator, &value)))
+														{
+															JSONSpan bound;
+
+															while ((num_bounds < 4) && (GetNextJSONSpanElement (&bounds_iterator, &bound)) && (GetJSONSpanReal (&bound, bounds + num_bounds)))
+																{
+																	++ num_bounds;
+																}
+
+															if (num_bounds == 4)
+																{
+																	if (SetAddressNorthEastCoordinate (address_p, bounds [1], bounds [3], NULL))
+																		{
+																			if (SetAddressSouthWestCoordinate (address_p, bounds [0], bounds [2], NULL))
+																				{
+																					res = 1;
+																				}
+																			else
+																				{
+																					PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to set south-west location from %lf %lf ", bounds [0], bounds [2]);
+																				}
+																		}
+																	else
+																		{
+																			PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to set north-east location from %lf %lf ", bounds [1], bounds [3]);
+																		}
+																}
+															else
+																{
+																	PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "boundingbox for result " SIZET_FMT " doesn't have 4 valid entries", num_results);
+																}
+														}
+													else
+														{
+															PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to get boundingbox array for result " SIZET_FMT, num_results);
+														}
+												}
+											else
+												{
+													PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "SetAddressCentreCoordinate failed for \"%s\" to %lf,%lf", address_p -> ad_name_s, latitude, longitude);
+												}
+										}
+									else
+										{
+											PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to get longitude for result " SIZET_FMT, num_results);
+										}
+								}
+							else
+								{
+									PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to get latitude for result " SIZET_FMT, num_results);
+								}
+
+						}		/* while ((res == -1) && (GetNextJSONSpanElement (&iterator, &result))) */
+
+					if (num_results == 0)
+						{
+							res = 0;
+						}
+				}
+			else
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "response is not an array");
+				}
+		}
+	else
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to find a json value in the response");
+		}
+
+	return res;
+}
+
+
+
+/*
+ * Make a search call and stream its results, stopping as soon as the
+ * first usable result has been read. The return values are the same
+ * as for ParseNominatimResults ().
+ */
+static int CallNominatimSearch (CurlTool *curl_p, const char *url_s, Address *address_p)
+{
+	NominatimSearchStream stream;
+
+	memset (&stream, 0, sizeof (NominatimSearchStream));
+	stream.nss_address_p = address_p;
+	stream.nss_res = -1;
+
+	if (!CallGeocoderWebServiceStreaming (curl_p, url_s, ParseNominatimSearchStream, &stream))
+		{
+			stream.nss_res = -1;
+		}
+
+	return stream.nss_res;
+}
+
+
+static JSONStreamStatus ParseNominatimSearchStream (void *data_p, const JSONStreamParser *parser_p, const JSONStreamEvent event, const size_t depth, const char *key_s, const char *value_s, const size_t value_length)
+{
+	NominatimSearchStream *stream_p = (NominatimSearchStream *) data_p;
+	JSONStreamStatus status = JSS_CONTINUE;
+
+	switch (depth)
+		{
+			case 0:
+				if (event == JSE_ARRAY_END)
+					{
+						if (stream_p -> nss_num_results == 0)
+							{
+								stream_p -> nss_res = 0;
+							}
+					}
+				else if (event != JSE_ARRAY_START)
+					{
+						PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "response is not an array");
+						status = JSS_STOP;
+					}
+				break;
+
+			/* each result */
+			case 1:
+				if (event == JSE_OBJECT_START)
+					{
+						stream_p -> nss_has_latitude_flag = false;
+						stream_p -> nss_has_longitude_flag = false;
+						stream_p -> nss_num_bounds = 0;
+						++ (stream_p -> nss_num_results);
+					}
+				else if (event == JSE_OBJECT_END)
+					{
+						if ((stream_p -> nss_has_latitude_flag) && (stream_p -> nss_has_longitude_flag))
+							{
+								if (SetAddressCentreCoordinate (stream_p -> nss_address_p, stream_p -> nss_latitude, stream_p -> nss_longitude, NULL))
+									{
+										if (stream_p -> nss_num_bounds == 4)
+											{
+												const double64 *bounds_p = stream_p -> nss_bounds;
+
+												if (SetAddressNorthEastCoordinate (stream_p -> nss_address_p, bounds_p [1], bounds_p [3], NULL))
+													{
+														if (SetAddressSouthWestCoordinate (stream_p -> nss_address_p, bounds_p [0], bounds_p [2], NULL))
+															{
+																stream_p -> nss_res = 1;
+																status = JSS_STOP;
+															}
+														else
+															{
+																PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to set south-west location from %lf %lf ", bounds_p [0], bounds_p [2]);
+															}
+													}
+												else
+													{
+														PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Failed to set north-east location from %lf %lf ", bounds_p [1], bounds_p [3]);
+													}
+											}
+										else
+											{
+												PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "boundingbox for result " SIZET_FMT " doesn't have 4 valid entries", stream_p -> nss_num_results);
+											}
+									}
+								else
+									{
+										PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "SetAddressCentreCoordinate failed for \"%s\" to %lf,%lf", stream_p -> nss_address_p -> ad_name_s, stream_p -> nss_latitude, stream_p -> nss_longitude);
+									}
+							}
+						else
+							{
+								PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to get latitude and longitude for result " SIZET_FMT, stream_p -> nss_num_results);
+							}
+					}
+				break;
+
+			/* the values within each result */
+			case 2:
+				if (key_s && ((event == JSE_STRING) || (event == JSE_NUMBER)))
+					{
+						if (strcmp (key_s, "lat") == 0)
+							{
+								stream_p -> nss_has_latitude_flag = GetJSONStreamReal (value_s, & (stream_p -> nss_latitude));
+							}
+						else if (strcmp (key_s, "lon") == 0)
+							{
+								stream_p -> nss_has_longitude_flag = GetJSONStreamReal (value_s, & (stream_p -> nss_longitude));
+							}
+					}
+				break;
+
+			/* the entries in the boundingbox array */
+			case 3:
+				if ((event == JSE_STRING) || (event == JSE_NUMBER))
+					{
+						const char *parent_key_s = GetJSONStreamKey (parser_p, 2);
+
+						if (parent_key_s && (strcmp (parent_key_s, "boundingbox") == 0))
+							{
+								if (stream_p -> nss_num_bounds < 4)
+									{
+										if (GetJSONStreamReal (value_s, (stream_p -> nss_bounds) + (stream_p -> nss_num_bounds)))
+											{
+												++ (stream_p -> nss_num_bounds);
+											}
+										else
+											{
+												/* make sure that this boundingbox is rejected */
+												stream_p -> nss_num_bounds = 5;
+											}
+									}
+								else
+									{
+										stream_p -> nss_num_bounds = 5;
+									}
+							}
+					}
+				break;
+
+			default:
+				break;
+		}
+
+	return status;
+}
+
+
+static JSONStreamStatus ParseNominatimReverseStream (void *data_p, const JSONStreamParser *parser_p, const JSONStreamEvent event, const size_t depth, const char *key_s, const char *value_s, const size_t value_length)
+{
+	NominatimReverseStream *stream_p = (NominatimReverseStream *) data_p;
+	JSONStreamStatus status = JSS_CONTINUE;
+
+	if (depth == 2)
+		{
+			/* the values of "address" are only of use if it is an object */
+			if ((event == JSE_STRING) && key_s)
+				{
+					const char *parent_key_s = GetJSONStreamKey (parser_p, 1);
+
+					if (parent_key_s && (strcmp (parent_key_s, "address") == 0))
+						{
+							const NominatimAddressKey *address_key_p = S_ADDRESS_KEYS_P;
+
+							while ((address_key_p -> nak_key_s) && (strcmp (address_key_p -> nak_key_s, key_s) != 0))
+								{
+									++ address_key_p;
+								}
+
+							if (address_key_p -> nak_key_s)
+								{
+									char **value_ss = (char **) (((char *) (stream_p -> nrs_address_p)) + (address_key_p -> nak_offset));
+
+									if (!ReplaceAddressComponent (value_s, value_ss))
+										{
+											PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to copy \"%s\" for key \"%s\"", value_s, key_s);
+											stream_p -> nrs_res = -1;
+											status = JSS_ERROR;
+										}
+								}
+						}
+				}
+		}
+	else if ((depth == 1) && (event == JSE_OBJECT_END) && key_s && (strcmp (key_s, "address") == 0))
+		{
+			/*
+			 * We have all of the address details so there's no need to read
+			 * anything else such as the extratags
+			 */
+			stream_p -> nrs_res = 1;
+			status = JSS_STOP;
+		}
+
+	return status;
+}
+
+
+
+static bool BuildNominatimURLUsingComponentsParameters (ByteBuffer *buffer_p, const Address * const address_p)
 {
 	bool success_flag = false;
 	bool first_param_flag = false;
-	int res = AddEscapedValue (buffer_p, "street", address_p -> ad_street_s, &first_param_flag, tool_p);
+	int res = AddEscapedValue (buffer_p, "street", address_p -> ad_street_s, &first_param_flag);
 
 	if (res != -1)
 		{
-			res = AddEscapedValue (buffer_p, "city", address_p -> ad_town_s, &first_param_flag, tool_p);
+			res = AddEscapedValue (buffer_p, "city", address_p -> ad_town_s, &first_param_flag);
 
 			if (res != -1)
 				{
-					res = AddEscapedValue (buffer_p, "county", address_p -> ad_county_s, &first_param_flag, tool_p);
+					res = AddEscapedValue (buffer_p, "county", address_p -> ad_county_s, &first_param_flag);
 
 					if (res != -1)
 						{
-							res = AddEscapedValue (buffer_p, "country", address_p -> ad_country_code_s, &first_param_flag, tool_p);
+							res = AddEscapedValue (buffer_p, "country", address_p -> ad_country_code_s, &first_param_flag);
 
 							if (res != -1)
 								{
-									res = AddEscapedValue (buffer_p, "postalcode", address_p -> ad_postcode_s, &first_param_flag, tool_p);
+									char postcode_s [POSTCODE_BUFFER_SIZE];
+
+									/* Leave out any postcode that can't be valid rather than letting it spoil the search */
+									if (GetAddressPostcodeForQuery (address_p, postcode_s))
+										{
+											res = AddEscapedValue (buffer_p, "postalcode", postcode_s, &first_param_flag);
+										}
 
 									if (res != -1)
 										{
@@ -528,14 +882,18 @@ static bool BuildNominatimURLUsingComponentsParameters (ByteBuffer *buffer_p, co
 }
 
 
-static int AddEscapedValue (ByteBuffer *buffer_p, const char *key_s, const char *value_s, bool *first_param_flag_p, CurlTool *tool_p)
+static bool BuildNominatimURLUsingAddressParameter (ByteBuffer *buffer_p, const Address * const address_p)
+{
+	return BuildURLUsingAddressParameter (buffer_p, address_p, "&q=", ",%20");
+}
+
+
+static int AddEscapedValue (ByteBuffer *buffer_p, const char *key_s, const char *value_s, bool *first_param_flag_p)
 {
 	int res = 0;
 
 	if (value_s)
 		{
-			char *escaped_value_s = NULL;
-
 			/* remove any leading spaces */
 			while ((*value_s != '\0') && (isspace (*value_s)))
 				{
@@ -544,26 +902,22 @@ static int AddEscapedValue (ByteBuffer *buffer_p, const char *key_s, const char
 
 			if (*value_s != '\0')
 				{
-					escaped_value_s = GetURLEscapedString (tool_p, value_s);
-
-					if (escaped_value_s)
+					if (AppendStringsToByteBuffer (buffer_p, (*first_param_flag_p) ? "?": "&", key_s, "=", NULL))
 						{
-							if (AppendStringsToByteBuffer (buffer_p, (*first_param_flag_p) ? "?": "&", key_s, "=", escaped_value_s, NULL))
+							if (AppendURLEscapedStringToByteBuffer (buffer_p, value_s, false))
 								{
 									res = 1;
 									*first_param_flag_p = false;
 								}
 							else
 								{
-									PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "AppendStringsToByteBuffer failed for \"%s\" and \"%s\"", key_s, escaped_value_s);
+									PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "AppendURLEscapedStringToByteBuffer failed for \"%s\"", value_s);
 									res = -1;
 								}
-
-							FreeURLEscapedString (escaped_value_s);
 						}
 					else
 						{
-							PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "GetURLEscapedString failed for \"%s\"", value_s);
+							PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "AppendStringsToByteBuffer failed for \"%s\"", key_s);
 							res = -1;
 						}
 				}
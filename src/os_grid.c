@@ -0,0 +1,878 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * os_grid.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * The formulae are from the Ordnance Survey's "A guide to coordinate
+ * systems in Great Britain" and the OSTN15 transformation user guide.
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "os_grid.h"
+#include "task_threads.h"
+
+#include "memory_allocations.h"
+#include "streams.h"
+
+
+static const char S_MAGIC_S [4] = { 'G', 'G', 'G', 'S' };
+
+#define OG_VERSION (1)
+
+/* The magic, version, number of columns, number of rows, spacing and a reserved value */
+#define OG_HEADER_SIZE (24)
+
+/* The easting and northing shifts for each point */
+#define OG_SHIFT_SIZE (8)
+
+
+#define OG_DEGREES_TO_RADIANS (0.017453292519943295)
+
+#define OG_RADIANS_TO_DEGREES (57.29577951308232)
+
+#define OG_ARC_SECONDS_TO_RADIANS (OG_DEGREES_TO_RADIANS / 3600.0)
+
+
+/* The National Grid's Transverse Mercator projection */
+#define OG_SCALE_FACTOR (0.9996012717)
+#define OG_ORIGIN_LATITUDE (49.0 * OG_DEGREES_TO_RADIANS)
+#define OG_ORIGIN_LONGITUDE (-2.0 * OG_DEGREES_TO_RADIANS)
+#define OG_FALSE_EASTING (400000.0)
+#define OG_FALSE_NORTHING (-100000.0)
+
+
+/* The Helmert transformation from WGS84 to OSGB36 */
+#define OG_HELMERT_TX (-446.448)
+#define OG_HELMERT_TY (125.157)
+#define OG_HELMERT_TZ (-542.060)
+#define OG_HELMERT_SCALE (20.4894e-6)
+#define OG_HELMERT_RX (-0.1502 * OG_ARC_SECONDS_TO_RADIANS)
+#define OG_HELMERT_RY (-0.2470 * OG_ARC_SECONDS_TO_RADIANS)
+#define OG_HELMERT_RZ (-0.8421 * OG_ARC_SECONDS_TO_RADIANS)
+
+
+/* The extent of the lettered 100 kilometre squares */
+#define OG_GRID_SQUARE_SIZE (100000.0)
+#define OG_MAX_EASTING (700000.0)
+#define OG_MAX_NORTHING (1300000.0)
+
+
+/* When inverting the grid shifts, stop once they change by less than a tenth of a millimetre */
+#define OG_SHIFT_TOLERANCE (0.0001)
+#define OG_MAX_SHIFT_ITERATIONS (20)
+
+#define OG_MIN_POINTS_PER_THREAD (4096)
+
+
+typedef struct Ellipsoid
+{
+	double64 el_semi_major_axis;
+	double64 el_semi_minor_axis;
+	double64 el_eccentricity_sq;
+	double64 el_n;
+} Ellipsoid;
+
+
+/* Airy 1830, used by OSGB36 */
+static const Ellipsoid S_AIRY =
+{
+	6377563.396,
+	6356256.909,
+	(6377563.396 * 6377563.396 - 6356256.909 * 6356256.909) / (6377563.396 * 6377563.396),
+	(6377563.396 - 6356256.909) / (6377563.396 + 6356256.909)
+};
+
+
+/* GRS80, used by ETRS89 and within a millimetre of WGS84 */
+static const Ellipsoid S_GRS80 =
+{
+	6378137.0,
+	6356752.314140,
+	(6378137.0 * 6378137.0 - 6356752.314140 * 6356752.314140) / (6378137.0 * 6378137.0),
+	(6378137.0 - 6356752.314140) / (6378137.0 + 6356752.314140)
+};
+
+
+typedef struct GridConversionTask
+{
+	const GridShiftTable *gct_table_p;
+
+	/* Exactly one of these two pairs is used */
+	const Coordinate *gct_coordinates_in_p;
+	GridPosition *gct_positions_out_p;
+
+	const GridPosition *gct_positions_in_p;
+	Coordinate *gct_coordinates_out_p;
+
+	size_t gct_first;
+	size_t gct_count;
+	size_t gct_num_converted;
+} GridConversionTask;
+
+
+static void ProjectToGrid (const Ellipsoid *ellipsoid_p, const double64 latitude, const double64 longitude, GridPosition *position_p);
+
+static void UnprojectFromGrid (const Ellipsoid *ellipsoid_p, const GridPosition *position_p, double64 *latitude_p, double64 *longitude_p);
+
+static double64 GetMeridionalArc (const Ellipsoid *ellipsoid_p, const double64 latitude);
+
+static void ChangeDatum (const Ellipsoid *from_p, const Ellipsoid *to_p, const double64 direction, double64 *latitude_p, double64 *longitude_p);
+
+static bool GetGridShift (const GridShiftTable *table_p, const double64 easting, const double64 northing, double64 *easting_shift_p, double64 *northing_shift_p);
+
+static size_t RunGridConversion (const GridConversionTask *conversion_p, const size_t num_points, const uint32 num_threads);
+
+
+static void RunGridConversionTask (void *data_p);
+
+static int GetGridLetterIndex (const char c);
+
+static uint32 LoadUInt32 (const uint8 *src_p);
+
+static void StoreUInt32 (uint8 *dest_p, const uint32 value);
+
+
+
+GridShiftTable *OpenGridShiftTable (const char *filename_s)
+{
+	GridShiftTable *table_p = (GridShiftTable *) AllocMemory (sizeof (GridShiftTable));
+
+	if (table_p)
+		{
+			/* neighbouring points are usually looked up together but not in file order */
+			if (OpenMappedFile (& (table_p -> gst_file), filename_s, OG_HEADER_SIZE, MFA_RANDOM))
+				{
+					const uint8 *data_p = table_p -> gst_file.mf_data_p;
+					const size_t size = table_p -> gst_file.mf_size;
+
+					if ((memcmp (data_p, S_MAGIC_S, sizeof (S_MAGIC_S)) == 0) && (LoadUInt32 (data_p + 4) == OG_VERSION))
+						{
+							const uint32 num_columns = LoadUInt32 (data_p + 8);
+							const uint32 num_rows = LoadUInt32 (data_p + 12);
+							const uint32 spacing = LoadUInt32 (data_p + 16);
+
+							if ((num_columns >= 2) && (num_rows >= 2) && (spacing > 0) &&
+								((uint64) size >= OG_HEADER_SIZE + ((uint64) num_columns * (uint64) num_rows * OG_SHIFT_SIZE)))
+								{
+									table_p -> gst_num_columns = num_columns;
+									table_p -> gst_num_rows = num_rows;
+									table_p -> gst_spacing = spacing;
+
+									return table_p;
+								}
+						}
+
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "\"%s\" is not a supported grid shift file", filename_s);
+					CloseGridShiftTable (table_p);
+
+					return NULL;
+				}
+			else
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to map \"%s\"", filename_s);
+				}
+
+			FreeMemory (table_p);
+		}
+
+	return NULL;
+}
+
+
+void CloseGridShiftTable (GridShiftTable *table_p)
+{
+	CloseMappedFile (& (table_p -> gst_file));
+
+	FreeMemory (table_p);
+}
+
+
+bool SaveGridShiftTable (const char *filename_s, const uint32 num_columns, const uint32 num_rows, const uint32 spacing, const int32 *shifts_p)
+{
+	bool success_flag = false;
+	FILE *out_f = fopen (filename_s, "wb");
+
+	if (out_f)
+		{
+			uint8 header [OG_HEADER_SIZE];
+
+			memcpy (header, S_MAGIC_S, sizeof (S_MAGIC_S));
+			StoreUInt32 (header + 4, OG_VERSION);
+			StoreUInt32 (header + 8, num_columns);
+			StoreUInt32 (header + 12, num_rows);
+			StoreUInt32 (header + 16, spacing);
+			StoreUInt32 (header + 20, 0);
+
+			if (fwrite (header, 1, OG_HEADER_SIZE, out_f) == OG_HEADER_SIZE)
+				{
+					const size_t num_values = 2 * (size_t) num_columns * (size_t) num_rows;
+					size_t i;
+
+					success_flag = true;
+
+					for (i = 0; (i < num_values) && success_flag; ++ i)
+						{
+							uint8 value [4];
+
+							StoreUInt32 (value, (uint32) * (shifts_p + i));
+							success_flag = (fwrite (value, 1, 4, out_f) == 4);
+						}
+				}
+
+			if (fclose (out_f) != 0)
+				{
+					success_flag = false;
+				}
+		}
+
+	if (!success_flag)
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to save grid shift file \"%s\"", filename_s);
+		}
+
+	return success_flag;
+}
+
+
+bool ConvertCoordinateToGridPosition (const Coordinate *coord_p, const GridShiftTable *table_p, GridPosition *position_p)
+{
+	/* This also catches NaNs */
+	if ((coord_p -> co_x >= -90.0) && (coord_p -> co_x <= 90.0) && (coord_p -> co_y >= -180.0) && (coord_p -> co_y <= 180.0))
+		{
+			double64 latitude = coord_p -> co_x * OG_DEGREES_TO_RADIANS;
+			double64 longitude = coord_p -> co_y * OG_DEGREES_TO_RADIANS;
+
+			if (table_p)
+				{
+					GridPosition etrs89_position;
+					double64 easting_shift;
+					double64 northing_shift;
+
+					ProjectToGrid (&S_GRS80, latitude, longitude, &etrs89_position);
+
+					if (GetGridShift (table_p, etrs89_position.gp_easting, etrs89_position.gp_northing, &easting_shift, &northing_shift))
+						{
+							position_p -> gp_easting = etrs89_position.gp_easting + easting_shift;
+							position_p -> gp_northing = etrs89_position.gp_northing + northing_shift;
+
+							return true;
+						}
+				}
+
+			ChangeDatum (&S_GRS80, &S_AIRY, 1.0, &latitude, &longitude);
+			ProjectToGrid (&S_AIRY, latitude, longitude, position_p);
+
+			return true;
+		}
+
+	return false;
+}
+
+
+bool ConvertGridPositionToCoordinate (const GridPosition *position_p, const GridShiftTable *table_p, Coordinate *coord_p)
+{
+	double64 latitude;
+	double64 longitude;
+
+	if (isnan (position_p -> gp_easting) || isnan (position_p -> gp_northing))
+		{
+			return false;
+		}
+
+	if (table_p)
+		{
+			double64 easting_shift;
+			double64 northing_shift;
+
+			/*
+			 * The shifts are indexed by the ETRS89 position, so start from the
+			 * OSGB36 one and refine the estimate until it settles.
+			 */
+			if (GetGridShift (table_p, position_p -> gp_easting, position_p -> gp_northing, &easting_shift, &northing_shift))
+				{
+					GridPosition etrs89_position;
+					bool shift_flag = true;
+					uint32 i;
+
+					etrs89_position.gp_easting = position_p -> gp_easting - easting_shift;
+					etrs89_position.gp_northing = position_p -> gp_northing - northing_shift;
+
+					for (i = 0; (i < OG_MAX_SHIFT_ITERATIONS) && shift_flag; ++ i)
+						{
+							if (GetGridShift (table_p, etrs89_position.gp_easting, etrs89_position.gp_northing, &easting_shift, &northing_shift))
+								{
+									const double64 easting = position_p -> gp_easting - easting_shift;
+									const double64 northing = position_p -> gp_northing - northing_shift;
+									const bool settled_flag = (fabs (easting - etrs89_position.gp_easting) < OG_SHIFT_TOLERANCE) && (fabs (northing - etrs89_position.gp_northing) < OG_SHIFT_TOLERANCE);
+
+									etrs89_position.gp_easting = easting;
+									etrs89_position.gp_northing = northing;
+
+									if (settled_flag)
+										{
+											break;
+										}
+								}
+							else
+								{
+									shift_flag = false;
+								}
+						}
+
+					if (shift_flag)
+						{
+							UnprojectFromGrid (&S_GRS80, &etrs89_position, &latitude, &longitude);
+
+							coord_p -> co_x = latitude * OG_RADIANS_TO_DEGREES;
+							coord_p -> co_y = longitude * OG_RADIANS_TO_DEGREES;
+
+							return true;
+						}
+				}
+		}
+
+	UnprojectFromGrid (&S_AIRY, position_p, &latitude, &longitude);
+	ChangeDatum (&S_AIRY, &S_GRS80, -1.0, &latitude, &longitude);
+
+	coord_p -> co_x = latitude * OG_RADIANS_TO_DEGREES;
+	coord_p -> co_y = longitude * OG_RADIANS_TO_DEGREES;
+
+	return true;
+}
+
+
+size_t ConvertCoordinatesToGridPositions (const Coordinate *coords_p, const size_t num_coords, const GridShiftTable *table_p, const uint32 num_threads, GridPosition *positions_p)
+{
+	GridConversionTask conversion;
+
+	memset (&conversion, 0, sizeof (GridConversionTask));
+
+	conversion.gct_table_p = table_p;
+	conversion.gct_coordinates_in_p = coords_p;
+	conversion.gct_positions_out_p = positions_p;
+
+	return RunGridConversion (&conversion, num_coords, num_threads);
+}
+
+
+size_t ConvertGridPositionsToCoordinates (const GridPosition *positions_p, const size_t num_positions, const GridShiftTable *table_p, const uint32 num_threads, Coordinate *coords_p)
+{
+	GridConversionTask conversion;
+
+	memset (&conversion, 0, sizeof (GridConversionTask));
+
+	conversion.gct_table_p = table_p;
+	conversion.gct_positions_in_p = positions_p;
+	conversion.gct_coordinates_out_p = coords_p;
+
+	return RunGridConversion (&conversion, num_positions, num_threads);
+}
+
+
+bool ParseGridReference (const char *grid_ref_s, GridPosition *position_p, double64 *precision_p)
+{
+	const char *digits_s [2] = { NULL, NULL };
+	size_t group_lengths [2] = { 0, 0 };
+	size_t num_groups = 0;
+	int first_letter;
+	int second_letter;
+	int square_easting;
+	int square_northing;
+	uint32 easting_digits;
+	uint32 northing_digits;
+	size_t num_digits;
+	double64 precision;
+	size_t i;
+
+	while (isspace ((unsigned char) *grid_ref_s))
+		{
+			++ grid_ref_s;
+		}
+
+	first_letter = GetGridLetterIndex (*grid_ref_s);
+
+	if (first_letter < 0)
+		{
+			return false;
+		}
+
+	second_letter = GetGridLetterIndex (* (++ grid_ref_s));
+
+	if (second_letter < 0)
+		{
+			return false;
+		}
+
+	++ grid_ref_s;
+
+	/* Collect up to two groups of digits separated by spaces */
+	while (*grid_ref_s)
+		{
+			if (isspace ((unsigned char) *grid_ref_s))
+				{
+					++ grid_ref_s;
+				}
+			else if (isdigit ((unsigned char) *grid_ref_s) && (num_groups < 2))
+				{
+					digits_s [num_groups] = grid_ref_s;
+
+					while (isdigit ((unsigned char) *grid_ref_s))
+						{
+							++ grid_ref_s;
+						}
+
+					group_lengths [num_groups] = grid_ref_s - digits_s [num_groups];
+					++ num_groups;
+				}
+			else
+				{
+					return false;
+				}
+		}
+
+	if (num_groups == 2)
+		{
+			if (group_lengths [0] != group_lengths [1])
+				{
+					return false;
+				}
+
+			num_digits = group_lengths [0];
+		}
+	else if (num_groups == 1)
+		{
+			if ((group_lengths [0] & 1) != 0)
+				{
+					return false;
+				}
+
+			num_digits = group_lengths [0] / 2;
+			digits_s [1] = digits_s [0] + num_digits;
+		}
+	else
+		{
+			num_digits = 0;
+		}
+
+	if (num_digits > OS_GRID_MAX_REFERENCE_DIGITS)
+		{
+			return false;
+		}
+
+	/*
+	 * The first letter gives the 500 kilometre square, starting from S at
+	 * the false origin, and the second gives the 100 kilometre square
+	 * within it. Both go in rows of 5 from the north-west corner.
+	 */
+	square_easting = (((first_letter - 2) % 5) * 5) + (second_letter % 5);
+	square_northing = (19 - ((first_letter / 5) * 5)) - (second_letter / 5);
+
+	if ((square_easting < 0) || (square_easting >= (int) (OG_MAX_EASTING / OG_GRID_SQUARE_SIZE)) || (square_northing < 0) || (square_northing >= (int) (OG_MAX_NORTHING / OG_GRID_SQUARE_SIZE)))
+		{
+			return false;
+		}
+
+	easting_digits = 0;
+	northing_digits = 0;
+
+	for (i = 0; i < num_digits; ++ i)
+		{
+			easting_digits = (easting_digits * 10) + (uint32) (* (digits_s [0] + i) - '0');
+			northing_digits = (northing_digits * 10) + (uint32) (* (digits_s [1] + i) - '0');
+		}
+
+	precision = OG_GRID_SQUARE_SIZE;
+
+	for (i = 0; i < num_digits; ++ i)
+		{
+			precision /= 10.0;
+		}
+
+	position_p -> gp_easting = (square_easting * OG_GRID_SQUARE_SIZE) + (easting_digits * precision);
+	position_p -> gp_northing = (square_northing * OG_GRID_SQUARE_SIZE) + (northing_digits * precision);
+
+	if (precision_p)
+		{
+			*precision_p = precision;
+		}
+
+	return true;
+}
+
+
+bool GetGridReference (const GridPosition *position_p, const uint32 num_digits, char *grid_ref_s)
+{
+	/* The grid letters, which skip I */
+	static const char S_LETTERS_S [] = "ABCDEFGHJKLMNOPQRSTUVWXYZ";
+
+	/* This also catches NaNs */
+	if ((num_digits <= OS_GRID_MAX_REFERENCE_DIGITS) && (position_p -> gp_easting >= 0.0) && (position_p -> gp_easting < OG_MAX_EASTING) && (position_p -> gp_northing >= 0.0) && (position_p -> gp_northing < OG_MAX_NORTHING))
+		{
+			const uint32 easting = (uint32) position_p -> gp_easting;
+			const uint32 northing = (uint32) position_p -> gp_northing;
+			const int square_easting = (int) (easting / 100000);
+			const int square_northing = (int) (northing / 100000);
+			const int first_letter = ((19 - square_northing) - ((19 - square_northing) % 5)) + ((square_easting + 10) / 5);
+			const int second_letter = (((19 - square_northing) * 5) % 25) + (square_easting % 5);
+			uint32 divisor = 100000;
+			uint32 i;
+
+			for (i = 0; i < num_digits; ++ i)
+				{
+					divisor /= 10;
+				}
+
+			*grid_ref_s = S_LETTERS_S [first_letter];
+			* (grid_ref_s + 1) = S_LETTERS_S [second_letter];
+
+			if (num_digits > 0)
+				{
+					sprintf (grid_ref_s + 2, " %0*u %0*u", (int) num_digits, (easting % 100000) / divisor, (int) num_digits, (northing % 100000) / divisor);
+				}
+			else
+				{
+					* (grid_ref_s + 2) = '\0';
+				}
+
+			return true;
+		}
+
+	return false;
+}
+
+
+/*
+ * Project a latitude and longitude in radians onto the National Grid's
+ * Transverse Mercator projection using the given ellipsoid.
+ */
+static void ProjectToGrid (const Ellipsoid *ellipsoid_p, const double64 latitude, const double64 longitude, GridPosition *position_p)
+{
+	const double64 a_f0 = ellipsoid_p -> el_semi_major_axis * OG_SCALE_FACTOR;
+	const double64 e2 = ellipsoid_p -> el_eccentricity_sq;
+	const double64 sin_latitude = sin (latitude);
+	const double64 cos_latitude = cos (latitude);
+	const double64 tan_latitude_sq = (sin_latitude * sin_latitude) / (cos_latitude * cos_latitude);
+	const double64 cos_latitude_3 = cos_latitude * cos_latitude * cos_latitude;
+	const double64 cos_latitude_5 = cos_latitude_3 * cos_latitude * cos_latitude;
+	const double64 factor = 1.0 - (e2 * sin_latitude * sin_latitude);
+	const double64 nu = a_f0 / sqrt (factor);
+	const double64 rho = a_f0 * (1.0 - e2) / (factor * sqrt (factor));
+	const double64 eta_sq = (nu / rho) - 1.0;
+	const double64 dl = longitude - OG_ORIGIN_LONGITUDE;
+	const double64 dl2 = dl * dl;
+	const double64 i = GetMeridionalArc (ellipsoid_p, latitude) + OG_FALSE_NORTHING;
+	const double64 ii = (nu / 2.0) * sin_latitude * cos_latitude;
+	const double64 iii = (nu / 24.0) * sin_latitude * cos_latitude_3 * (5.0 - tan_latitude_sq + (9.0 * eta_sq));
+	const double64 iiia = (nu / 720.0) * sin_latitude * cos_latitude_5 * (61.0 - (58.0 * tan_latitude_sq) + (tan_latitude_sq * tan_latitude_sq));
+	const double64 iv = nu * cos_latitude;
+	const double64 v = (nu / 6.0) * cos_latitude_3 * ((nu / rho) - tan_latitude_sq);
+	const double64 vi = (nu / 120.0) * cos_latitude_5 * (5.0 - (18.0 * tan_latitude_sq) + (tan_latitude_sq * tan_latitude_sq) + (14.0 * eta_sq) - (58.0 * tan_latitude_sq * eta_sq));
+
+	position_p -> gp_northing = i + (dl2 * (ii + (dl2 * (iii + (dl2 * iiia)))));
+	position_p -> gp_easting = OG_FALSE_EASTING + (dl * (iv + (dl2 * (v + (dl2 * vi)))));
+}
+
+
+static void UnprojectFromGrid (const Ellipsoid *ellipsoid_p, const GridPosition *position_p, double64 *latitude_p, double64 *longitude_p)
+{
+	const double64 a_f0 = ellipsoid_p -> el_semi_major_axis * OG_SCALE_FACTOR;
+	const double64 e2 = ellipsoid_p -> el_eccentricity_sq;
+	const double64 northing = position_p -> gp_northing - OG_FALSE_NORTHING;
+	double64 latitude = (northing / a_f0) + OG_ORIGIN_LATITUDE;
+	double64 m = GetMeridionalArc (ellipsoid_p, latitude);
+	uint32 iterations = 0;
+
+	/* Find the latitude whose meridional arc matches the northing to within 0.01 mm */
+	while ((fabs (northing - m) >= 0.00001) && (iterations < 100))
+		{
+			latitude += (northing - m) / a_f0;
+			m = GetMeridionalArc (ellipsoid_p, latitude);
+			++ iterations;
+		}
+
+		{
+			const double64 sin_latitude = sin (latitude);
+			const double64 cos_latitude = cos (latitude);
+			const double64 tan_latitude = sin_latitude / cos_latitude;
+			const double64 tan_latitude_2 = tan_latitude * tan_latitude;
+			const double64 tan_latitude_4 = tan_latitude_2 * tan_latitude_2;
+			const double64 sec_latitude = 1.0 / cos_latitude;
+			const double64 factor = 1.0 - (e2 * sin_latitude * sin_latitude);
+			const double64 nu = a_f0 / sqrt (factor);
+			const double64 nu_3 = nu * nu * nu;
+			const double64 nu_5 = nu_3 * nu * nu;
+			const double64 nu_7 = nu_5 * nu * nu;
+			const double64 rho = a_f0 * (1.0 - e2) / (factor * sqrt (factor));
+			const double64 eta_sq = (nu / rho) - 1.0;
+			const double64 vii = tan_latitude / (2.0 * rho * nu);
+			const double64 viii = tan_latitude / (24.0 * rho * nu_3) * (5.0 + (3.0 * tan_latitude_2) + eta_sq - (9.0 * tan_latitude_2 * eta_sq));
+			const double64 ix = tan_latitude / (720.0 * rho * nu_5) * (61.0 + (90.0 * tan_latitude_2) + (45.0 * tan_latitude_4));
+			const double64 x = sec_latitude / nu;
+			const double64 xi = sec_latitude / (6.0 * nu_3) * ((nu / rho) + (2.0 * tan_latitude_2));
+			const double64 xii = sec_latitude / (120.0 * nu_5) * (5.0 + (28.0 * tan_latitude_2) + (24.0 * tan_latitude_4));
+			const double64 xiia = sec_latitude / (5040.0 * nu_7) * (61.0 + (662.0 * tan_latitude_2) + (1320.0 * tan_latitude_4) + (720.0 * tan_latitude_4 * tan_latitude_2));
+			const double64 de = position_p -> gp_easting - OG_FALSE_EASTING;
+			const double64 de2 = de * de;
+
+			*latitude_p = latitude - (de2 * (vii - (de2 * (viii - (de2 * ix)))));
+			*longitude_p = OG_ORIGIN_LONGITUDE + (de * (x - (de2 * (xi - (de2 * (xii - (de2 * xiia)))))));
+		}
+}
+
+
+static double64 GetMeridionalArc (const Ellipsoid *ellipsoid_p, const double64 latitude)
+{
+	const double64 n = ellipsoid_p -> el_n;
+	const double64 n2 = n * n;
+	const double64 n3 = n2 * n;
+	const double64 difference = latitude - OG_ORIGIN_LATITUDE;
+	const double64 sum = latitude + OG_ORIGIN_LATITUDE;
+
+	return ellipsoid_p -> el_semi_minor_axis * OG_SCALE_FACTOR *
+		(((1.0 + n + (1.25 * n2) + (1.25 * n3)) * difference)
+		- (((3.0 * n) + (3.0 * n2) + (2.625 * n3)) * sin (difference) * cos (sum))
+		+ (((1.875 * n2) + (1.875 * n3)) * sin (2.0 * difference) * cos (2.0 * sum))
+		- ((35.0 / 24.0) * n3 * sin (3.0 * difference) * cos (3.0 * sum)));
+}
+
+
+/*
+ * Move a latitude and longitude in radians between datums by converting
+ * to Cartesian coordinates, applying the Helmert transformation and
+ * converting back. A direction of 1 goes from WGS84 to OSGB36 and -1
+ * goes back, which is accurate to within a few millimetres of the
+ * exact inverse for rotations this small.
+ */
+static void ChangeDatum (const Ellipsoid *from_p, const Ellipsoid *to_p, const double64 direction, double64 *latitude_p, double64 *longitude_p)
+{
+	const double64 sin_latitude = sin (*latitude_p);
+	const double64 cos_latitude = cos (*latitude_p);
+	const double64 nu = from_p -> el_semi_major_axis / sqrt (1.0 - (from_p -> el_eccentricity_sq * sin_latitude * sin_latitude));
+	const double64 x = nu * cos_latitude * cos (*longitude_p);
+	const double64 y = nu * cos_latitude * sin (*longitude_p);
+	const double64 z = (1.0 - from_p -> el_eccentricity_sq) * nu * sin_latitude;
+	const double64 scale = 1.0 + (direction * OG_HELMERT_SCALE);
+	const double64 rx = direction * OG_HELMERT_RX;
+	const double64 ry = direction * OG_HELMERT_RY;
+	const double64 rz = direction * OG_HELMERT_RZ;
+	const double64 x2 = (direction * OG_HELMERT_TX) + (scale * x) - (rz * y) + (ry * z);
+	const double64 y2 = (direction * OG_HELMERT_TY) + (rz * x) + (scale * y) - (rx * z);
+	const double64 z2 = (direction * OG_HELMERT_TZ) - (ry * x) + (rx * y) + (scale * z);
+	const double64 p = sqrt ((x2 * x2) + (y2 * y2));
+	const double64 e2 = to_p -> el_eccentricity_sq;
+	double64 latitude = atan2 (z2, p * (1.0 - e2));
+	uint32 i;
+
+	for (i = 0; i < 10; ++ i)
+		{
+			const double64 sin_new_latitude = sin (latitude);
+			const double64 new_nu = to_p -> el_semi_major_axis / sqrt (1.0 - (e2 * sin_new_latitude * sin_new_latitude));
+			const double64 next_latitude = atan2 (z2 + (e2 * new_nu * sin_new_latitude), p);
+
+			if (fabs (next_latitude - latitude) < 1e-12)
+				{
+					latitude = next_latitude;
+					break;
+				}
+
+			latitude = next_latitude;
+		}
+
+	*latitude_p = latitude;
+	*longitude_p = atan2 (y2, x2);
+}
+
+
+/*
+ * Get the shifts for an ETRS89 position by bilinear interpolation
+ * between the four surrounding points in the table.
+ */
+static bool GetGridShift (const GridShiftTable *table_p, const double64 easting, const double64 northing, double64 *easting_shift_p, double64 *northing_shift_p)
+{
+	const double64 x = easting / table_p -> gst_spacing;
+	const double64 y = northing / table_p -> gst_spacing;
+
+	/* This also catches NaNs */
+	if ((x >= 0.0) && (y >= 0.0) && (x < (double64) (table_p -> gst_num_columns - 1)) && (y < (double64) (table_p -> gst_num_rows - 1)))
+		{
+			const uint32 column = (uint32) x;
+			const uint32 row = (uint32) y;
+			const uint8 *south_p = table_p -> gst_file.mf_data_p + OG_HEADER_SIZE + (((size_t) row * table_p -> gst_num_columns + column) * OG_SHIFT_SIZE);
+			const uint8 *north_p = south_p + ((size_t) table_p -> gst_num_columns * OG_SHIFT_SIZE);
+			const int32 shifts [8] =
+				{
+					(int32) LoadUInt32 (south_p), (int32) LoadUInt32 (south_p + 4),
+					(int32) LoadUInt32 (south_p + OG_SHIFT_SIZE), (int32) LoadUInt32 (south_p + OG_SHIFT_SIZE + 4),
+					(int32) LoadUInt32 (north_p), (int32) LoadUInt32 (north_p + 4),
+					(int32) LoadUInt32 (north_p + OG_SHIFT_SIZE), (int32) LoadUInt32 (north_p + OG_SHIFT_SIZE + 4)
+				};
+
+			if ((shifts [0] != OS_GRID_NO_SHIFT) && (shifts [2] != OS_GRID_NO_SHIFT) && (shifts [4] != OS_GRID_NO_SHIFT) && (shifts [6] != OS_GRID_NO_SHIFT))
+				{
+					const double64 t = x - column;
+					const double64 u = y - row;
+					const double64 w0 = (1.0 - t) * (1.0 - u);
+					const double64 w1 = t * (1.0 - u);
+					const double64 w2 = (1.0 - t) * u;
+					const double64 w3 = t * u;
+
+					/* The shifts are in millimetres */
+					*easting_shift_p = ((w0 * shifts [0]) + (w1 * shifts [2]) + (w2 * shifts [4]) + (w3 * shifts [6])) * 0.001;
+					*northing_shift_p = ((w0 * shifts [1]) + (w1 * shifts [3]) + (w2 * shifts [5]) + (w3 * shifts [7])) * 0.001;
+
+					return true;
+				}
+		}
+
+	return false;
+}
+
+
+static size_t RunGridConversion (const GridConversionTask *conversion_p, const size_t num_points, const uint32 num_threads)
+{
+	const uint32 threads_to_use = GetNumberOfTaskThreads (num_threads, num_points, OG_MIN_POINTS_PER_THREAD);
+	GridConversionTask *tasks_p = NULL;
+	size_t num_converted = 0;
+
+	if (threads_to_use > 1)
+		{
+			tasks_p = (GridConversionTask *) AllocMemory (threads_to_use * sizeof (GridConversionTask));
+		}
+
+	if (tasks_p)
+		{
+			const size_t points_per_task = num_points / threads_to_use;
+			const size_t num_extra_points = num_points % threads_to_use;
+			size_t first_point = 0;
+			uint32 i;
+
+			for (i = 0; i < threads_to_use; ++ i)
+				{
+					GridConversionTask *task_p = tasks_p + i;
+
+					*task_p = *conversion_p;
+					task_p -> gct_first = first_point;
+					task_p -> gct_count = points_per_task + ((i < num_extra_points) ? 1 : 0);
+
+					first_point += task_p -> gct_count;
+				}
+
+			RunTasksOnThreads (RunGridConversionTask, tasks_p, sizeof (GridConversionTask), threads_to_use);
+
+			for (i = 0; i < threads_to_use; ++ i)
+				{
+					num_converted += (tasks_p + i) -> gct_num_converted;
+				}
+
+			FreeMemory (tasks_p);
+		}
+	else
+		{
+			/* Either one thread was wanted or the tasks couldn't be allocated so do it all here */
+			GridConversionTask task = *conversion_p;
+
+			task.gct_first = 0;
+			task.gct_count = num_points;
+
+			RunGridConversionTask (&task);
+
+			num_converted = task.gct_num_converted;
+		}
+
+	return num_converted;
+}
+
+
+static void RunGridConversionTask (void *data_p)
+{
+	GridConversionTask *task_p = (GridConversionTask *) data_p;
+	const size_t last = task_p -> gct_first + task_p -> gct_count;
+	size_t num_converted = 0;
+	size_t i;
+
+	if (task_p -> gct_coordinates_in_p)
+		{
+			for (i = task_p -> gct_first; i < last; ++ i)
+				{
+					GridPosition *position_p = task_p -> gct_positions_out_p + i;
+
+					if (ConvertCoordinateToGridPosition (task_p -> gct_coordinates_in_p + i, task_p -> gct_table_p, position_p))
+						{
+							++ num_converted;
+						}
+					else
+						{
+							position_p -> gp_easting = NAN;
+							position_p -> gp_northing = NAN;
+						}
+				}
+		}
+	else
+		{
+			for (i = task_p -> gct_first; i < last; ++ i)
+				{
+					Coordinate *coord_p = task_p -> gct_coordinates_out_p + i;
+
+					if (ConvertGridPositionToCoordinate (task_p -> gct_positions_in_p + i, task_p -> gct_table_p, coord_p))
+						{
+							++ num_converted;
+						}
+					else
+						{
+							coord_p -> co_x = NAN;
+							coord_p -> co_y = NAN;
+						}
+				}
+		}
+
+	task_p -> gct_num_converted = num_converted;
+}
+
+
+/* Get the position of a grid letter in the alphabet without I */
+static int GetGridLetterIndex (const char c)
+{
+	const int upper_c = toupper ((unsigned char) c);
+
+	if ((upper_c >= 'A') && (upper_c <= 'Z') && (upper_c != 'I'))
+		{
+			return (upper_c > 'I') ? (upper_c - 'A' - 1) : (upper_c - 'A');
+		}
+
+	return -1;
+}
+
+
+static uint32 LoadUInt32 (const uint8 *src_p)
+{
+	return ((uint32) *src_p) | (((uint32) * (src_p + 1)) << 8) | (((uint32) * (src_p + 2)) << 16) | (((uint32) * (src_p + 3)) << 24);
+}
+
+
+static void StoreUInt32 (uint8 *dest_p, const uint32 value)
+{
+	*dest_p = (uint8) (value & 0xFF);
+	* (dest_p + 1) = (uint8) ((value >> 8) & 0xFF);
+	* (dest_p + 2) = (uint8) ((value >> 16) & 0xFF);
+	* (dest_p + 3) = (uint8) ((value >> 24) & 0xFF);
+}
@@ -0,0 +1,967 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * postcode.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <pthread.h>
+#endif
+
+#include "postcode.h"
+#include "address_canonical.h"
+
+#include "streams.h"
+#include "string_utils.h"
+
+
+/* The symbols are the letters, then the digits, then a space and a hyphen */
+#define PC_NUM_SYMBOLS (38)
+#define PC_FIRST_DIGIT_SYMBOL (26)
+#define PC_SPACE_SYMBOL (36)
+#define PC_HYPHEN_SYMBOL (37)
+
+#define PC_LETTER_SYMBOLS ((1ULL << 26) - 1)
+#define PC_DIGIT_SYMBOLS (((1ULL << 10) - 1) << PC_FIRST_DIGIT_SYMBOL)
+
+#define PC_MAX_FORMATS (8)
+
+#define PC_MAX_STEPS (12)
+
+/* Each format has a state for each of its steps along with its accepting state */
+#define PC_MAX_NFA_STATES (PC_MAX_FORMATS * (PC_MAX_STEPS + 1))
+
+#define PC_NFA_SET_WORDS ((PC_MAX_NFA_STATES + 63) / 64)
+
+#define PC_MAX_DFA_STATES (64)
+
+/* Any transition to this state means that the postcode is invalid */
+#define PC_DEAD_STATE (0)
+
+#define PC_START_STATE (1)
+
+/* The most letters and digits that are swapped when correcting a postcode */
+#define PC_MAX_SWAPS (2)
+
+/* The inward code of a GB postcode */
+#define PC_GB_INWARD "9[ABD-HJLNP-UW-Z][ABD-HJLNP-UW-Z]"
+
+
+/*
+ * The formats of a country's postcodes, in which:
+ *
+ * - 'A' is any letter.
+ * - '9' is any digit.
+ * - "[...]" is any of the letters and digits in the brackets, which can include ranges such as "A-H".
+ * - ' ' is an optional space, or hyphen, which is a space in the normalised postcode.
+ * - '-' is an optional hyphen, or space, which is a hyphen in the normalised postcode.
+ * - '_' is an optional space, or hyphen, which is removed from the normalised postcode.
+ */
+typedef struct CountryPostcodes
+{
+	const char *cp_country_code_s;
+
+	/* The formats, which finish with a NULL */
+	const char *cp_formats_ss [PC_MAX_FORMATS + 1];
+
+	/*
+	 * If this isn't 0, the country's postcodes are all digits that
+	 * are this long and can start with a zero, so they might have
+	 * lost their leading zeros by being stored as numbers.
+	 */
+	uint32 cp_padded_length;
+} CountryPostcodes;
+
+
+typedef struct PostcodeStep
+{
+	/* The symbols that the step accepts, or 0 for an optional separator */
+	uint64 ps_symbols;
+
+	/* The character that a separator is in the normalised postcode, or '\0' for none */
+	char ps_separator;
+} PostcodeStep;
+
+
+/* A set of states of the nondeterministic automaton for a country's formats */
+typedef struct NFASet
+{
+	uint64 ns_bits [PC_NFA_SET_WORDS];
+} NFASet;
+
+
+typedef struct PostcodeAutomaton
+{
+	PostcodeStep pa_steps [PC_MAX_FORMATS][PC_MAX_STEPS];
+
+	uint32 pa_num_steps [PC_MAX_FORMATS];
+
+	uint32 pa_num_formats;
+
+	uint8 pa_transitions [PC_MAX_DFA_STATES][PC_NUM_SYMBOLS];
+
+	/* The first format that a postcode which finishes in each state matches, or -1 */
+	int8 pa_matched_formats [PC_MAX_DFA_STATES];
+
+	uint32 pa_num_states;
+
+	bool pa_compiled_flag;
+} PostcodeAutomaton;
+
+
+/*
+ * These are sorted by country code for bsearch (). Each country's most
+ * common formats are listed first as they are preferred when correcting.
+ */
+static const CountryPostcodes s_country_postcodes_p [] =
+{
+	{ "AT", { "[1-9]999", NULL }, 0 },
+	{ "AU", { "9999", NULL }, 4 },
+	{ "BE", { "[1-9]999", NULL }, 0 },
+	{ "BR", { "99999-999", NULL }, 0 },
+	{ "CA", { "[ABCEGHJ-NPRSTVXY]9[ABCEGHJ-NPRSTV-Z] 9[ABCEGHJ-NPRSTV-Z]9", NULL }, 0 },
+	{ "CH", { "[1-9]999", NULL }, 0 },
+	{ "CN", { "[0-8]99999", NULL }, 0 },
+	{ "DE", { "[0][1-9]999", "[1-9]9999", NULL }, 5 },
+	{ "DK", { "[1-9]999", NULL }, 0 },
+	{ "ES", { "[0][1-9]999", "[1-4]9999", "[5][0-2]999", NULL }, 5 },
+	{ "FR", { "[0][1-9]999", "[1-8]9999", "[9][0-5]999", "[9][78]999", NULL }, 5 },
+	{
+		"GB",
+		{
+			"[A-PR-UWYZ][A-HK-Y]9 " PC_GB_INWARD,
+			"[A-PR-UWYZ][A-HK-Y]99 " PC_GB_INWARD,
+			"[A-PR-UWYZ][A-HK-Y]9[ABEHMNPRV-Y] " PC_GB_INWARD,
+			"[A-PR-UWYZ]9 " PC_GB_INWARD,
+			"[A-PR-UWYZ]99 " PC_GB_INWARD,
+			"[A-PR-UWYZ]9[A-HJKPSTUW] " PC_GB_INWARD,
+			"[G][I][R] [0][A][A]",
+			NULL
+		},
+		0
+	},
+	{ "IN", { "[1-9]99_999", NULL }, 0 },
+	{ "IT", { "99999", NULL }, 5 },
+	{ "JP", { "999-9999", NULL }, 0 },
+	{ "KE", { "99999", NULL }, 5 },
+	{ "MX", { "99999", NULL }, 5 },
+	{ "NL", { "[1-9]999 AA", NULL }, 0 },
+	{ "NO", { "9999", NULL }, 4 },
+	{ "NZ", { "9999", NULL }, 4 },
+	{ "PL", { "99-999", NULL }, 0 },
+	{ "PT", { "[1-9]999-999", NULL }, 0 },
+	{ "RU", { "[1-9]99999", NULL }, 0 },
+	{ "SE", { "[1-9]99 99", NULL }, 0 },
+	{ "US", { "99999", "99999-9999", NULL }, 5 },
+	{ "ZA", { "9999", NULL }, 4 }
+};
+
+
+#define PC_NUM_COUNTRIES (sizeof (s_country_postcodes_p) / sizeof (CountryPostcodes))
+
+
+/* These are compiled from s_country_postcodes_p the first time that they are needed */
+static PostcodeAutomaton s_automata_p [PC_NUM_COUNTRIES];
+
+#ifdef _WIN32
+static INIT_ONCE s_compile_once = INIT_ONCE_STATIC_INIT;
+#else
+static pthread_once_t s_compile_once = PTHREAD_ONCE_INIT;
+#endif
+
+
+static const PostcodeAutomaton *GetPostcodeAutomaton (const char *country_code_s, const CountryPostcodes **country_pp);
+
+static void CompilePostcodeAutomata (void);
+
+#ifdef _WIN32
+static BOOL CALLBACK CompilePostcodeAutomataOnce (PINIT_ONCE once_p, PVOID param_p, PVOID *context_pp);
+#endif
+
+static bool CompilePostcodeAutomaton (const CountryPostcodes *country_p, PostcodeAutomaton *automaton_p);
+
+static bool ParsePostcodeFormat (const char *format_s, PostcodeStep *steps_p, uint32 *num_steps_p);
+
+static void CloseNFASet (NFASet *set_p, const PostcodeStep * const *steps_pp, const uint32 num_states);
+
+static bool IsInNFASet (const NFASet *set_p, const uint32 state);
+
+static void AddToNFASet (NFASet *set_p, const uint32 state);
+
+static int GetPostcodeSymbol (const char c);
+
+static bool CleanPostcode (const char *postcode_s, char *cleaned_s);
+
+static int32 RunPostcodeAutomaton (const PostcodeAutomaton *automaton_p, const char *postcode_s);
+
+static void FormatPostcode (const PostcodeStep *steps_p, const uint32 num_steps, const char *postcode_s, char *formatted_s);
+
+static bool CorrectPostcode (const PostcodeAutomaton *automaton_p, const CountryPostcodes *country_p, const char *postcode_s, char *corrected_s);
+
+static uint32 SwapPostcodeCharacters (const PostcodeStep *steps_p, const uint32 num_steps, const char *postcode_s, char *swapped_s);
+
+static char GetSwappedCharacter (const char c, const uint64 symbols);
+
+static const char *GetQueryCountryCode (const Address *address_p);
+
+static int CompareCountryPostcodes (const void *v0_p, const void *v1_p);
+
+
+
+bool IsPostcodeCountrySupported (const char *country_code_s)
+{
+	return (GetPostcodeAutomaton (country_code_s, NULL) != NULL);
+}
+
+
+PostcodeStatus ValidatePostcode (const char *postcode_s, const char *country_code_s, char *normalised_s)
+{
+	const CountryPostcodes *country_p = NULL;
+	const PostcodeAutomaton *automaton_p = GetPostcodeAutomaton (country_code_s, &country_p);
+	PostcodeStatus status = PS_INVALID;
+
+	if (!automaton_p)
+		{
+			return PS_UNSUPPORTED_COUNTRY;
+		}
+
+	if (postcode_s)
+		{
+			char cleaned_s [POSTCODE_BUFFER_SIZE];
+			char formatted_s [POSTCODE_BUFFER_SIZE];
+
+			if (CleanPostcode (postcode_s, cleaned_s))
+				{
+					const int32 format = RunPostcodeAutomaton (automaton_p, cleaned_s);
+
+					if (format >= 0)
+						{
+							FormatPostcode (automaton_p -> pa_steps [format], automaton_p -> pa_num_steps [format], cleaned_s, formatted_s);
+							status = (strcmp (formatted_s, postcode_s) == 0) ? PS_VALID : PS_NORMALISED;
+						}
+					else if (CorrectPostcode (automaton_p, country_p, cleaned_s, formatted_s))
+						{
+							status = PS_CORRECTED;
+						}
+
+					if ((status != PS_INVALID) && normalised_s)
+						{
+							strcpy (normalised_s, formatted_s);
+						}
+				}
+		}
+
+	return status;
+}
+
+
+size_t ValidatePostcodes (const char * const *postcodes_ss, const char * const *country_codes_ss, const size_t num_postcodes, PostcodeStatus *statuses_p, char *normalised_s)
+{
+	size_t num_valid = 0;
+	size_t i;
+
+	for (i = 0; i < num_postcodes; ++ i)
+		{
+			char *row_s = normalised_s ? normalised_s + (i * POSTCODE_BUFFER_SIZE) : NULL;
+			const char *country_code_s = * (country_codes_ss + i);
+			PostcodeStatus status = PS_UNSUPPORTED_COUNTRY;
+
+			if (! (* (postcodes_ss + i)))
+				{
+					status = PS_INVALID;
+				}
+			else if (country_code_s)
+				{
+					status = ValidatePostcode (* (postcodes_ss + i), country_code_s, row_s);
+				}
+
+			* (statuses_p + i) = status;
+
+			if ((status == PS_VALID) || (status == PS_NORMALISED) || (status == PS_CORRECTED))
+				{
+					++ num_valid;
+				}
+			else if (row_s)
+				{
+					*row_s = '\0';
+				}
+		}
+
+	return num_valid;
+}
+
+
+bool GetAddressPostcodeForQuery (const Address *address_p, char *postcode_s)
+{
+	const char *value_s = address_p -> ad_postcode_s;
+
+	if (value_s)
+		{
+			const PostcodeStatus status = ValidatePostcode (value_s, GetQueryCountryCode (address_p), postcode_s);
+
+			if (status == PS_UNSUPPORTED_COUNTRY)
+				{
+					/* It can't be checked, so just remove any surrounding whitespace */
+					size_t length;
+
+					while (isspace ((unsigned char) *value_s))
+						{
+							++ value_s;
+						}
+
+					length = strlen (value_s);
+
+					while ((length > 0) && isspace ((unsigned char) value_s [length - 1]))
+						{
+							-- length;
+						}
+
+					if ((length > 0) && (length < POSTCODE_BUFFER_SIZE))
+						{
+							memcpy (postcode_s, value_s, length);
+							postcode_s [length] = '\0';
+
+							return true;
+						}
+				}
+			else if (status != PS_INVALID)
+				{
+					return true;
+				}
+		}
+
+	return false;
+}
+
+
+PostcodeStatus CorrectAddressPostcode (Address *address_p)
+{
+	PostcodeStatus status = PS_INVALID;
+
+	if (address_p -> ad_postcode_s)
+		{
+			char postcode_s [POSTCODE_BUFFER_SIZE];
+
+			status = ValidatePostcode (address_p -> ad_postcode_s, GetQueryCountryCode (address_p), postcode_s);
+
+			if ((status == PS_NORMALISED) || (status == PS_CORRECTED))
+				{
+					char *copied_postcode_s = EasyCopyToNewString (postcode_s);
+
+					if (copied_postcode_s)
+						{
+							FreeCopiedString (address_p -> ad_postcode_s);
+							address_p -> ad_postcode_s = copied_postcode_s;
+						}
+					else
+						{
+							PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to copy postcode \"%s\"", postcode_s);
+						}
+				}
+			else if (status == PS_INVALID)
+				{
+					FreeCopiedString (address_p -> ad_postcode_s);
+					address_p -> ad_postcode_s = NULL;
+				}
+		}
+
+	return status;
+}
+
+
+
+/*
+ * STATIC DEFINITIONS
+ */
+
+
+static const PostcodeAutomaton *GetPostcodeAutomaton (const char *country_code_s, const CountryPostcodes **country_pp)
+{
+	if (country_code_s)
+		{
+			const CountryPostcodes *country_p;
+			CountryPostcodes key;
+
+#ifdef _WIN32
+			InitOnceExecuteOnce (&s_compile_once, CompilePostcodeAutomataOnce, NULL, NULL);
+#else
+			pthread_once (&s_compile_once, CompilePostcodeAutomata);
+#endif
+
+			key.cp_country_code_s = country_code_s;
+			country_p = (const CountryPostcodes *) bsearch (&key, s_country_postcodes_p, PC_NUM_COUNTRIES, sizeof (CountryPostcodes), CompareCountryPostcodes);
+
+			if (country_p)
+				{
+					const PostcodeAutomaton *automaton_p = s_automata_p + (country_p - s_country_postcodes_p);
+
+					if (automaton_p -> pa_compiled_flag)
+						{
+							if (country_pp)
+								{
+									*country_pp = country_p;
+								}
+
+							return automaton_p;
+						}
+				}
+		}
+
+	return NULL;
+}
+
+
+static void CompilePostcodeAutomata (void)
+{
+	size_t i;
+
+	for (i = 0; i < PC_NUM_COUNTRIES; ++ i)
+		{
+			if (!CompilePostcodeAutomaton (s_country_postcodes_p + i, s_automata_p + i))
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to compile the postcode formats for \"%s\"", s_country_postcodes_p [i].cp_country_code_s);
+				}
+		}
+}
+
+
+#ifdef _WIN32
+static BOOL CALLBACK CompilePostcodeAutomataOnce (PINIT_ONCE once_p, PVOID param_p, PVOID *context_pp)
+{
+	CompilePostcodeAutomata ();
+	return TRUE;
+}
+#endif
+
+
+/*
+ * Build a nondeterministic automaton from the formats, where state
+ * i of format f is the state before its ith step, and then turn it
+ * into a deterministic one with the subset construction.
+ */
+static bool CompilePostcodeAutomaton (const CountryPostcodes *country_p, PostcodeAutomaton *automaton_p)
+{
+	NFASet dfa_sets [PC_MAX_DFA_STATES];
+	const PostcodeStep *nfa_steps_pp [PC_MAX_NFA_STATES];
+	uint32 accepting_states [PC_MAX_FORMATS];
+	uint32 num_nfa_states = 0;
+	uint32 state;
+	uint32 f;
+
+	memset (automaton_p, 0, sizeof (PostcodeAutomaton));
+	memset (dfa_sets, 0, sizeof (dfa_sets));
+
+	for (f = 0; country_p -> cp_formats_ss [f]; ++ f)
+		{
+			uint32 i;
+
+			if (!ParsePostcodeFormat (country_p -> cp_formats_ss [f], automaton_p -> pa_steps [f], automaton_p -> pa_num_steps + f))
+				{
+					return false;
+				}
+
+			for (i = 0; i < automaton_p -> pa_num_steps [f]; ++ i)
+				{
+					nfa_steps_pp [num_nfa_states ++] = automaton_p -> pa_steps [f] + i;
+				}
+
+			/* The accepting state has no step */
+			accepting_states [f] = num_nfa_states;
+			nfa_steps_pp [num_nfa_states ++] = NULL;
+
+			/* The start of the format */
+			AddToNFASet (dfa_sets + PC_START_STATE, accepting_states [f] - automaton_p -> pa_num_steps [f]);
+		}
+
+	automaton_p -> pa_num_formats = f;
+
+	CloseNFASet (dfa_sets + PC_START_STATE, nfa_steps_pp, num_nfa_states);
+	automaton_p -> pa_num_states = PC_START_STATE + 1;
+	automaton_p -> pa_matched_formats [PC_DEAD_STATE] = -1;
+
+	for (state = PC_START_STATE; state < automaton_p -> pa_num_states; ++ state)
+		{
+			int symbol;
+
+			automaton_p -> pa_matched_formats [state] = -1;
+
+			for (f = 0; f < automaton_p -> pa_num_formats; ++ f)
+				{
+					if (IsInNFASet (dfa_sets + state, accepting_states [f]))
+						{
+							automaton_p -> pa_matched_formats [state] = (int8) f;
+							break;
+						}
+				}
+
+			for (symbol = 0; symbol < PC_NUM_SYMBOLS; ++ symbol)
+				{
+					NFASet next;
+					bool empty_flag = true;
+					uint32 i;
+
+					memset (&next, 0, sizeof (NFASet));
+
+					for (i = 0; i < num_nfa_states; ++ i)
+						{
+							if (IsInNFASet (dfa_sets + state, i) && nfa_steps_pp [i])
+								{
+									const PostcodeStep *step_p = nfa_steps_pp [i];
+									bool move_flag;
+
+									if (step_p -> ps_symbols)
+										{
+											move_flag = ((step_p -> ps_symbols & (1ULL << symbol)) != 0);
+										}
+									else
+										{
+											move_flag = ((symbol == PC_SPACE_SYMBOL) || (symbol == PC_HYPHEN_SYMBOL));
+										}
+
+									if (move_flag)
+										{
+											AddToNFASet (&next, i + 1);
+											empty_flag = false;
+										}
+								}
+						}
+
+					if (!empty_flag)
+						{
+							uint32 next_state;
+
+							CloseNFASet (&next, nfa_steps_pp, num_nfa_states);
+
+							for (next_state = PC_START_STATE; next_state < automaton_p -> pa_num_states; ++ next_state)
+								{
+									if (memcmp (dfa_sets + next_state, &next, sizeof (NFASet)) == 0)
+										{
+											break;
+										}
+								}
+
+							if (next_state == automaton_p -> pa_num_states)
+								{
+									if (next_state == PC_MAX_DFA_STATES)
+										{
+											return false;
+										}
+
+									dfa_sets [next_state] = next;
+									++ (automaton_p -> pa_num_states);
+								}
+
+							automaton_p -> pa_transitions [state][symbol] = (uint8) next_state;
+						}
+				}
+		}
+
+	automaton_p -> pa_compiled_flag = true;
+
+	return true;
+}
+
+
+static bool ParsePostcodeFormat (const char *format_s, PostcodeStep *steps_p, uint32 *num_steps_p)
+{
+	uint32 num_steps = 0;
+
+	while (*format_s != '\0')
+		{
+			PostcodeStep *step_p = steps_p + num_steps;
+
+			if (num_steps == PC_MAX_STEPS)
+				{
+					return false;
+				}
+
+			step_p -> ps_symbols = 0;
+			step_p -> ps_separator = '\0';
+
+			switch (*format_s)
+				{
+					case 'A':
+						step_p -> ps_symbols = PC_LETTER_SYMBOLS;
+						break;
+
+					case '9':
+						step_p -> ps_symbols = PC_DIGIT_SYMBOLS;
+						break;
+
+					case ' ':
+					case '-':
+						step_p -> ps_separator = *format_s;
+						break;
+
+					case '_':
+						break;
+
+					case '[':
+						while (* (++ format_s) != ']')
+							{
+								int first = GetPostcodeSymbol (*format_s);
+								int last = first;
+
+								if (format_s [1] == '-')
+									{
+										last = GetPostcodeSymbol (format_s [2]);
+										format_s += 2;
+									}
+
+								if ((first < 0) || (last < first) || (first >= PC_SPACE_SYMBOL) || (last >= PC_SPACE_SYMBOL))
+									{
+										return false;
+									}
+
+								for ( ; first <= last; ++ first)
+									{
+										step_p -> ps_symbols |= 1ULL << first;
+									}
+							}
+						break;
+
+					default:
+						return false;
+				}
+
+			++ format_s;
+			++ num_steps;
+		}
+
+	*num_steps_p = num_steps;
+
+	return true;
+}
+
+
+/* Add the states that can be reached by skipping optional separators */
+static void CloseNFASet (NFASet *set_p, const PostcodeStep * const *steps_pp, const uint32 num_states)
+{
+	uint32 i;
+
+	/* Skipping a separator only ever moves forward so one pass is enough */
+	for (i = 0; i < num_states; ++ i)
+		{
+			if (IsInNFASet (set_p, i) && steps_pp [i] && (steps_pp [i] -> ps_symbols == 0))
+				{
+					AddToNFASet (set_p, i + 1);
+				}
+		}
+}
+
+
+static bool IsInNFASet (const NFASet *set_p, const uint32 state)
+{
+	return ((set_p -> ns_bits [state >> 6] & (1ULL << (state & 63))) != 0);
+}
+
+
+static void AddToNFASet (NFASet *set_p, const uint32 state)
+{
+	set_p -> ns_bits [state >> 6] |= 1ULL << (state & 63);
+}
+
+
+static int GetPostcodeSymbol (const char c)
+{
+	if ((c >= 'A') && (c <= 'Z'))
+		{
+			return c - 'A';
+		}
+	else if ((c >= 'a') && (c <= 'z'))
+		{
+			return c - 'a';
+		}
+	else if ((c >= '0') && (c <= '9'))
+		{
+			return PC_FIRST_DIGIT_SYMBOL + (c - '0');
+		}
+	else if (c == ' ')
+		{
+			return PC_SPACE_SYMBOL;
+		}
+	else if (c == '-')
+		{
+			return PC_HYPHEN_SYMBOL;
+		}
+
+	return -1;
+}
+
+
+/*
+ * Upper-case the postcode, remove any surrounding whitespace and
+ * replace any other runs of whitespace with single spaces.
+ */
+static bool CleanPostcode (const char *postcode_s, char *cleaned_s)
+{
+	size_t length = 0;
+	bool space_flag = false;
+
+	while (isspace ((unsigned char) *postcode_s))
+		{
+			++ postcode_s;
+		}
+
+	for ( ; *postcode_s != '\0'; ++ postcode_s)
+		{
+			const char c = *postcode_s;
+
+			if (isspace ((unsigned char) c))
+				{
+					space_flag = true;
+				}
+			else if (GetPostcodeSymbol (c) >= 0)
+				{
+					if (length + (space_flag ? 2 : 1) >= POSTCODE_BUFFER_SIZE)
+						{
+							return false;
+						}
+
+					if (space_flag)
+						{
+							cleaned_s [length ++] = ' ';
+							space_flag = false;
+						}
+
+					cleaned_s [length ++] = (char) toupper ((unsigned char) c);
+				}
+			else
+				{
+					return false;
+				}
+		}
+
+	cleaned_s [length] = '\0';
+
+	return (length > 0);
+}
+
+
+/* Get the first format that the postcode matches or -1 if it is invalid */
+static int32 RunPostcodeAutomaton (const PostcodeAutomaton *automaton_p, const char *postcode_s)
+{
+	uint32 state = PC_START_STATE;
+
+	while ((*postcode_s != '\0') && (state != PC_DEAD_STATE))
+		{
+			const int symbol = GetPostcodeSymbol (*postcode_s);
+
+			state = (symbol >= 0) ? automaton_p -> pa_transitions [state][symbol] : PC_DEAD_STATE;
+			++ postcode_s;
+		}
+
+	return automaton_p -> pa_matched_formats [state];
+}
+
+
+/* Write a cleaned postcode, which must match the format, with the format's separators */
+static void FormatPostcode (const PostcodeStep *steps_p, const uint32 num_steps, const char *postcode_s, char *formatted_s)
+{
+	uint32 i;
+
+	for (i = 0; i < num_steps; ++ i)
+		{
+			if (steps_p [i].ps_symbols)
+				{
+					* (formatted_s ++) = * (postcode_s ++);
+				}
+			else
+				{
+					if ((*postcode_s == ' ') || (*postcode_s == '-'))
+						{
+							++ postcode_s;
+						}
+
+					if (steps_p [i].ps_separator != '\0')
+						{
+							* (formatted_s ++) = steps_p [i].ps_separator;
+						}
+				}
+		}
+
+	*formatted_s = '\0';
+}
+
+
+static bool CorrectPostcode (const PostcodeAutomaton *automaton_p, const CountryPostcodes *country_p, const char *postcode_s, char *corrected_s)
+{
+	char candidate_s [POSTCODE_BUFFER_SIZE];
+	uint32 best_swaps = PC_MAX_SWAPS + 1;
+	int32 format;
+	uint32 f;
+
+	/* Put back any leading zeros that have been lost */
+	if (country_p -> cp_padded_length > 0)
+		{
+			const size_t length = strlen (postcode_s);
+
+			if ((length + 2 >= country_p -> cp_padded_length) && (length < country_p -> cp_padded_length) && (strspn (postcode_s, "0123456789") == length))
+				{
+					const size_t num_zeros = country_p -> cp_padded_length - length;
+
+					memset (candidate_s, '0', num_zeros);
+					strcpy (candidate_s + num_zeros, postcode_s);
+
+					format = RunPostcodeAutomaton (automaton_p, candidate_s);
+
+					if (format >= 0)
+						{
+							FormatPostcode (automaton_p -> pa_steps [format], automaton_p -> pa_num_steps [format], candidate_s, corrected_s);
+							return true;
+						}
+				}
+		}
+
+	/*
+	 * Use the format that needs the fewest letters and digits swapping
+	 * and, if there is a tie, the one that is listed first.
+	 */
+	for (f = 0; f < automaton_p -> pa_num_formats; ++ f)
+		{
+			char swapped_s [POSTCODE_BUFFER_SIZE];
+			const uint32 num_swaps = SwapPostcodeCharacters (automaton_p -> pa_steps [f], automaton_p -> pa_num_steps [f], postcode_s, swapped_s);
+
+			if ((num_swaps > 0) && (num_swaps < best_swaps))
+				{
+					best_swaps = num_swaps;
+					strcpy (candidate_s, swapped_s);
+				}
+		}
+
+	if (best_swaps <= PC_MAX_SWAPS)
+		{
+			format = RunPostcodeAutomaton (automaton_p, candidate_s);
+
+			if (format >= 0)
+				{
+					FormatPostcode (automaton_p -> pa_steps [format], automaton_p -> pa_num_steps [format], candidate_s, corrected_s);
+					return true;
+				}
+		}
+
+	return false;
+}
+
+
+/*
+ * Try to make a postcode match a format by swapping letters and digits
+ * that look alike. The number of swaps is returned or, if the postcode
+ * can't be made to match, a number greater than PC_MAX_SWAPS.
+ */
+static uint32 SwapPostcodeCharacters (const PostcodeStep *steps_p, const uint32 num_steps, const char *postcode_s, char *swapped_s)
+{
+	uint32 num_swaps = 0;
+	uint32 i;
+
+	for (i = 0; i < num_steps; ++ i)
+		{
+			const PostcodeStep *step_p = steps_p + i;
+
+			if (step_p -> ps_symbols)
+				{
+					const int symbol = GetPostcodeSymbol (*postcode_s);
+					char c = *postcode_s;
+
+					if ((symbol < 0) || ((step_p -> ps_symbols & (1ULL << symbol)) == 0))
+						{
+							c = GetSwappedCharacter (c, step_p -> ps_symbols);
+
+							if ((c == '\0') || (++ num_swaps > PC_MAX_SWAPS))
+								{
+									return PC_MAX_SWAPS + 1;
+								}
+						}
+
+					* (swapped_s ++) = c;
+					++ postcode_s;
+				}
+			else if ((*postcode_s == ' ') || (*postcode_s == '-'))
+				{
+					* (swapped_s ++) = * (postcode_s ++);
+				}
+		}
+
+	*swapped_s = '\0';
+
+	return (*postcode_s == '\0') ? num_swaps : PC_MAX_SWAPS + 1;
+}
+
+
+/* Get the look-alike of a letter or digit if it is one of the given symbols, or '\0' */
+static char GetSwappedCharacter (const char c, const uint64 symbols)
+{
+	static const char * const letters_s = "ODILZSGB";
+	static const char * const digits_s = "00112568";
+	static const char * const digits_to_letters_s = "012568";
+	static const char * const letters_from_digits_s = "OIZSGB";
+	const char *match_s = strchr (letters_s, c);
+	char swapped = '\0';
+
+	if (c == '\0')
+		{
+			return '\0';
+		}
+
+	if (match_s)
+		{
+			swapped = digits_s [match_s - letters_s];
+		}
+	else if ((match_s = strchr (digits_to_letters_s, c)) != NULL)
+		{
+			swapped = letters_from_digits_s [match_s - digits_to_letters_s];
+		}
+
+	if ((swapped != '\0') && (symbols & (1ULL << GetPostcodeSymbol (swapped))))
+		{
+			return swapped;
+		}
+
+	return '\0';
+}
+
+
+static const char *GetQueryCountryCode (const Address *address_p)
+{
+	if (address_p -> ad_country_code_s)
+		{
+			return GetCanonicalCountryCode (address_p -> ad_country_code_s);
+		}
+	else if (address_p -> ad_country_s)
+		{
+			return GetCanonicalCountryCode (address_p -> ad_country_s);
+		}
+
+	return NULL;
+}
+
+
+static int CompareCountryPostcodes (const void *v0_p, const void *v1_p)
+{
+	const CountryPostcodes *country0_p = (const CountryPostcodes *) v0_p;
+	const CountryPostcodes *country1_p = (const CountryPostcodes *) v1_p;
+
+	return Stricmp (country0_p -> cp_country_code_s, country1_p -> cp_country_code_s);
+}
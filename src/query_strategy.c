@@ -0,0 +1,757 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * query_strategy.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <string.h>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <pthread.h>
+#endif
+
+#include "query_strategy.h"
+
+#include "memory_allocations.h"
+#include "streams.h"
+#include "string_utils.h"
+
+
+/* Both forms need to have been tried first this many times before their hit rates are compared */
+#define QS_MIN_ATTEMPTS (8)
+
+/*
+ * When a form has been tried this many times, its counts are halved so
+ * that the hit rates follow any changes in how the provider behaves.
+ */
+#define QS_MAX_ATTEMPTS (1 << 12)
+
+/*
+ * Only the form that is sent first gets a fair hit rate, so once in this
+ * many choices for each combination of fields the other form goes first.
+ */
+#define QS_SWAP_INTERVAL (16)
+
+
+typedef struct QueryFormResults
+{
+	uint32 qfr_attempts;
+
+	uint32 qfr_hits;
+} QueryFormResults;
+
+
+typedef struct QueryStrategy
+{
+	QueryFormResults qs_results [QS_NUM_FIELD_SETS][QF_NUM_FORMS];
+
+	uint32 qs_num_choices [QS_NUM_FIELD_SETS];
+
+	QueryMode qs_mode;
+} QueryStrategy;
+
+
+struct ConcurrentQueries;
+
+
+typedef struct ConcurrentQuery
+{
+	struct ConcurrentQueries *cq_queries_p;
+
+	QueryForm cq_form;
+
+	char *cq_url_s;
+
+	/* A copy of the caller's Address that the thread stores its location in */
+	Address *cq_address_p;
+} ConcurrentQuery;
+
+
+/*
+ * The state shared between the caller and the threads sending each form.
+ * The caller stops waiting as soon as one of them finds a location, so
+ * this is freed by whichever of them finishes with it last.
+ */
+typedef struct ConcurrentQueries
+{
+	ConcurrentQuery cqs_queries [QF_NUM_FORMS];
+
+	QueryProvider cqs_provider;
+
+	uint32 cqs_fields;
+
+	CallQueryFunction cqs_call_fn;
+
+	/* The form that found a location first or -1 */
+	int32 cqs_winner;
+
+	uint32 cqs_num_running;
+
+	uint32 cqs_num_references;
+
+#ifdef _WIN32
+	SRWLOCK cqs_lock;
+	CONDITION_VARIABLE cqs_finished;
+#else
+	pthread_mutex_t cqs_lock;
+	pthread_cond_t cqs_finished;
+#endif
+} ConcurrentQueries;
+
+
+static QueryStrategy s_strategies_p [QP_NUM_PROVIDERS];
+
+#ifdef _WIN32
+static SRWLOCK s_results_lock = SRWLOCK_INIT;
+#else
+static pthread_mutex_t s_results_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+static void LockResults (void);
+
+static void UnlockResults (void);
+
+static char *BuildQueryURL (ByteBuffer *buffer_p, const char *uri_s, BuildQueryFunction build_fn, const Address *address_p);
+
+static bool RunSequentialQueries (const QueryProvider provider, const uint32 fields, Address *address_p, char **urls_ss, const QueryForm first_form, CallQueryFunction call_fn);
+
+static bool RunConcurrentQueries (const QueryProvider provider, const uint32 fields, Address *address_p, char **urls_ss, CallQueryFunction call_fn, const QueryForm default_form);
+
+static ConcurrentQueries *AllocateConcurrentQueries (const QueryProvider provider, const uint32 fields, const Address *address_p, char **urls_ss, CallQueryFunction call_fn);
+
+static void FreeConcurrentQueries (ConcurrentQueries *queries_p);
+
+static void ReleaseConcurrentQueries (ConcurrentQueries *queries_p, Address *address_p);
+
+static void RunConcurrentQuery (ConcurrentQuery *query_p);
+
+#ifdef _WIN32
+static DWORD WINAPI RunConcurrentQueryThread (LPVOID data_p);
+#else
+static void *RunConcurrentQueryThread (void *data_p);
+#endif
+
+
+
+uint32 GetAddressQueryFields (const Address *address_p)
+{
+	uint32 fields = 0;
+
+	if (address_p -> ad_name_s)
+		{
+			fields |= QS_NAME_FIELD;
+		}
+
+	if (address_p -> ad_street_s)
+		{
+			fields |= QS_STREET_FIELD;
+		}
+
+	if (address_p -> ad_town_s)
+		{
+			fields |= QS_TOWN_FIELD;
+		}
+
+	if (address_p -> ad_county_s)
+		{
+			fields |= QS_COUNTY_FIELD;
+		}
+
+	if (address_p -> ad_postcode_s)
+		{
+			fields |= QS_POSTCODE_FIELD;
+		}
+
+	if ((address_p -> ad_country_s) || (address_p -> ad_country_code_s))
+		{
+			fields |= QS_COUNTRY_FIELD;
+		}
+
+	return fields;
+}
+
+
+bool GetQueryModeFromString (const char *mode_s, QueryMode *mode_p)
+{
+	bool success_flag = true;
+
+	if (Stricmp (mode_s, "adaptive") == 0)
+		{
+			*mode_p = QM_ADAPTIVE;
+		}
+	else if (Stricmp (mode_s, "fixed") == 0)
+		{
+			*mode_p = QM_FIXED;
+		}
+	else if (Stricmp (mode_s, "concurrent") == 0)
+		{
+			*mode_p = QM_CONCURRENT;
+		}
+	else
+		{
+			success_flag = false;
+		}
+
+	return success_flag;
+}
+
+
+void SetQueryMode (const QueryProvider provider, const QueryMode mode)
+{
+	LockResults ();
+	s_strategies_p [provider].qs_mode = mode;
+	UnlockResults ();
+}
+
+
+QueryMode GetQueryMode (const QueryProvider provider)
+{
+	QueryMode mode;
+
+	LockResults ();
+	mode = s_strategies_p [provider].qs_mode;
+	UnlockResults ();
+
+	return mode;
+}
+
+
+QueryForm ChooseFirstQueryForm (const QueryProvider provider, const uint32 fields, const QueryForm default_form)
+{
+	const QueryForm other_form = (default_form == QF_STRUCTURED) ? QF_FREE_TEXT : QF_STRUCTURED;
+	QueryForm form = default_form;
+	QueryFormResults default_results;
+	QueryFormResults other_results;
+	bool swap_flag;
+
+	LockResults ();
+	default_results = s_strategies_p [provider].qs_results [fields][default_form];
+	other_results = s_strategies_p [provider].qs_results [fields][other_form];
+	swap_flag = ((++ (s_strategies_p [provider].qs_num_choices [fields])) % QS_SWAP_INTERVAL == 0);
+	UnlockResults ();
+
+	if ((default_results.qfr_attempts < QS_MIN_ATTEMPTS) || (other_results.qfr_attempts < QS_MIN_ATTEMPTS))
+		{
+			/* Until there's enough to go on, take turns so that both forms get tried first */
+			if (other_results.qfr_attempts < default_results.qfr_attempts)
+				{
+					form = other_form;
+				}
+		}
+	else
+		{
+			/*
+			 * Compare (hits + 1) / (attempts + 2) for each form, which stops
+			 * a form that has only been tried a few times from looking
+			 * perfect or hopeless.
+			 */
+			const uint64 other_score = ((uint64) other_results.qfr_hits + 1) * ((uint64) default_results.qfr_attempts + 2);
+			const uint64 default_score = ((uint64) default_results.qfr_hits + 1) * ((uint64) other_results.qfr_attempts + 2);
+
+			if (other_score > default_score)
+				{
+					form = other_form;
+				}
+
+			if (swap_flag)
+				{
+					form = (form == default_form) ? other_form : default_form;
+				}
+		}
+
+	return form;
+}
+
+
+void RecordQueryResult (const QueryProvider provider, const uint32 fields, const QueryForm form, const bool hit_flag)
+{
+	QueryFormResults *results_p = & (s_strategies_p [provider].qs_results [fields][form]);
+
+	LockResults ();
+
+	if (results_p -> qfr_attempts == QS_MAX_ATTEMPTS)
+		{
+			results_p -> qfr_attempts >>= 1;
+			results_p -> qfr_hits >>= 1;
+		}
+
+	++ (results_p -> qfr_attempts);
+
+	if (hit_flag)
+		{
+			++ (results_p -> qfr_hits);
+		}
+
+	UnlockResults ();
+}
+
+
+void GetQueryFormResults (const QueryProvider provider, const uint32 fields, const QueryForm form, uint32 *attempts_p, uint32 *hits_p)
+{
+	LockResults ();
+	*attempts_p = s_strategies_p [provider].qs_results [fields][form].qfr_attempts;
+	*hits_p = s_strategies_p [provider].qs_results [fields][form].qfr_hits;
+	UnlockResults ();
+}
+
+
+void ResetQueryResults (const QueryProvider provider)
+{
+	LockResults ();
+	memset (s_strategies_p [provider].qs_results, 0, sizeof (s_strategies_p [provider].qs_results));
+	memset (s_strategies_p [provider].qs_num_choices, 0, sizeof (s_strategies_p [provider].qs_num_choices));
+	UnlockResults ();
+}
+
+
+bool RunQueryForms (const QueryProvider provider, Address *address_p, const char *uri_s, const BuildQueryFunction *build_fns_p, CallQueryFunction call_fn, const QueryForm default_form)
+{
+	bool got_location_flag = false;
+	ByteBuffer *buffer_p = AllocateByteBuffer (1024);
+
+	if (buffer_p)
+		{
+			const uint32 fields = GetAddressQueryFields (address_p);
+			const QueryMode mode = GetQueryMode (provider);
+			char *urls_ss [QF_NUM_FORMS];
+			uint32 num_urls = 0;
+			uint32 i;
+
+			for (i = 0; i < QF_NUM_FORMS; ++ i)
+				{
+					urls_ss [i] = BuildQueryURL (buffer_p, uri_s, * (build_fns_p + i), address_p);
+
+					if (urls_ss [i])
+						{
+							++ num_urls;
+						}
+				}
+
+			FreeByteBuffer (buffer_p);
+
+			if ((mode == QM_CONCURRENT) && (num_urls == QF_NUM_FORMS))
+				{
+					got_location_flag = RunConcurrentQueries (provider, fields, address_p, urls_ss, call_fn, default_form);
+				}
+			else if (num_urls > 0)
+				{
+					const QueryForm first_form = (mode == QM_ADAPTIVE) ? ChooseFirstQueryForm (provider, fields, default_form) : default_form;
+
+					got_location_flag = RunSequentialQueries (provider, fields, address_p, urls_ss, first_form, call_fn);
+				}
+
+			for (i = 0; i < QF_NUM_FORMS; ++ i)
+				{
+					if (urls_ss [i])
+						{
+							FreeCopiedString (urls_ss [i]);
+						}
+				}
+		}
+
+	return got_location_flag;
+}
+
+
+
+/*
+ * STATIC DEFINITIONS
+ */
+
+
+static void LockResults (void)
+{
+#ifdef _WIN32
+	AcquireSRWLockExclusive (&s_results_lock);
+#else
+	pthread_mutex_lock (&s_results_lock);
+#endif
+}
+
+
+static void UnlockResults (void)
+{
+#ifdef _WIN32
+	ReleaseSRWLockExclusive (&s_results_lock);
+#else
+	pthread_mutex_unlock (&s_results_lock);
+#endif
+}
+
+
+static char *BuildQueryURL (ByteBuffer *buffer_p, const char *uri_s, BuildQueryFunction build_fn, const Address *address_p)
+{
+	char *url_s = NULL;
+
+	ResetByteBuffer (buffer_p);
+
+	if (AppendStringToByteBuffer (buffer_p, uri_s))
+		{
+			if (build_fn (buffer_p, address_p))
+				{
+					url_s = EasyCopyToNewString (GetByteBufferData (buffer_p));
+
+					if (!url_s)
+						{
+							PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to copy url \"%s\"", GetByteBufferData (buffer_p));
+						}
+				}
+		}
+
+	return url_s;
+}
+
+
+static bool RunSequentialQueries (const QueryProvider provider, const uint32 fields, Address *address_p, char **urls_ss, const QueryForm first_form, CallQueryFunction call_fn)
+{
+	bool got_location_flag = false;
+	CurlTool *curl_p = AllocateMemoryCurlTool (0);
+
+	if (curl_p)
+		{
+			const QueryForm forms [QF_NUM_FORMS] = { first_form, (first_form == QF_STRUCTURED) ? QF_FREE_TEXT : QF_STRUCTURED };
+			bool sent_flag = false;
+			uint32 i;
+
+			for (i = 0; i < QF_NUM_FORMS; ++ i)
+				{
+					const QueryForm form = forms [i];
+
+					if (urls_ss [form])
+						{
+							const int res = call_fn (curl_p, urls_ss [form], address_p);
+
+							/* Errors say nothing about how good the form is */
+							if (res < 0)
+								{
+									break;
+								}
+
+							/*
+							 * A form that is only sent after the other one has missed
+							 * is tried on the harder addresses, so its hit rate
+							 * wouldn't be comparable and isn't recorded.
+							 */
+							if (!sent_flag)
+								{
+									RecordQueryResult (provider, fields, form, (res == 1));
+									sent_flag = true;
+								}
+
+							if (res == 1)
+								{
+									got_location_flag = true;
+									break;
+								}
+						}
+				}
+
+			FreeCurlTool (curl_p);
+		}
+
+	return got_location_flag;
+}
+
+
+static bool RunConcurrentQueries (const QueryProvider provider, const uint32 fields, Address *address_p, char **urls_ss, CallQueryFunction call_fn, const QueryForm default_form)
+{
+	bool got_location_flag = false;
+	ConcurrentQueries *queries_p = AllocateConcurrentQueries (provider, fields, address_p, urls_ss, call_fn);
+
+	if (queries_p)
+		{
+			uint32 i;
+
+			for (i = 0; i < QF_NUM_FORMS; ++ i)
+				{
+					ConcurrentQuery *query_p = queries_p -> cqs_queries + i;
+					bool started_flag;
+
+#ifdef _WIN32
+					HANDLE thread = CreateThread (NULL, 0, RunConcurrentQueryThread, query_p, 0, NULL);
+
+					started_flag = (thread != NULL);
+
+					if (started_flag)
+						{
+							CloseHandle (thread);
+						}
+#else
+					pthread_t thread;
+
+					started_flag = (pthread_create (&thread, NULL, RunConcurrentQueryThread, query_p) == 0);
+
+					if (started_flag)
+						{
+							pthread_detach (thread);
+						}
+#endif
+
+					if (!started_flag)
+						{
+							RunConcurrentQuery (query_p);
+						}
+				}
+
+			/* Wait for the first location or for both forms to find nothing */
+#ifdef _WIN32
+			AcquireSRWLockExclusive (& (queries_p -> cqs_lock));
+
+			while ((queries_p -> cqs_winner < 0) && (queries_p -> cqs_num_running > 0))
+				{
+					SleepConditionVariableSRW (& (queries_p -> cqs_finished), & (queries_p -> cqs_lock), INFINITE, 0);
+				}
+
+			got_location_flag = (queries_p -> cqs_winner >= 0);
+			ReleaseSRWLockExclusive (& (queries_p -> cqs_lock));
+#else
+			pthread_mutex_lock (& (queries_p -> cqs_lock));
+
+			while ((queries_p -> cqs_winner < 0) && (queries_p -> cqs_num_running > 0))
+				{
+					pthread_cond_wait (& (queries_p -> cqs_finished), & (queries_p -> cqs_lock));
+				}
+
+			got_location_flag = (queries_p -> cqs_winner >= 0);
+			pthread_mutex_unlock (& (queries_p -> cqs_lock));
+#endif
+
+			ReleaseConcurrentQueries (queries_p, got_location_flag ? address_p : NULL);
+		}
+	else
+		{
+			got_location_flag = RunSequentialQueries (provider, fields, address_p, urls_ss, default_form, call_fn);
+		}
+
+	return got_location_flag;
+}
+
+
+static ConcurrentQueries *AllocateConcurrentQueries (const QueryProvider provider, const uint32 fields, const Address *address_p, char **urls_ss, CallQueryFunction call_fn)
+{
+	ConcurrentQueries *queries_p = (ConcurrentQueries *) AllocMemory (sizeof (ConcurrentQueries));
+
+	if (queries_p)
+		{
+			bool success_flag = true;
+			uint32 i;
+
+			memset (queries_p, 0, sizeof (ConcurrentQueries));
+
+			queries_p -> cqs_provider = provider;
+			queries_p -> cqs_fields = fields;
+			queries_p -> cqs_call_fn = call_fn;
+			queries_p -> cqs_winner = -1;
+
+			for (i = 0; i < QF_NUM_FORMS; ++ i)
+				{
+					ConcurrentQuery *query_p = queries_p -> cqs_queries + i;
+
+					query_p -> cq_queries_p = queries_p;
+					query_p -> cq_form = (QueryForm) i;
+
+					if (success_flag)
+						{
+							query_p -> cq_url_s = EasyCopyToNewString (urls_ss [i]);
+
+							/*
+							 * Each thread gets its own copy of the Address, as the geocoders
+							 * store their results in it and log its fields upon error
+							 */
+							query_p -> cq_address_p = AllocateAddress (address_p -> ad_name_s, address_p -> ad_street_s, address_p -> ad_town_s, address_p -> ad_county_s,
+								address_p -> ad_country_s, address_p -> ad_postcode_s, address_p -> ad_country_code_s, address_p -> ad_gps_s);
+
+							success_flag = (query_p -> cq_url_s) && (query_p -> cq_address_p);
+						}
+				}
+
+			if (success_flag)
+				{
+#ifdef _WIN32
+					InitializeSRWLock (& (queries_p -> cqs_lock));
+					InitializeConditionVariable (& (queries_p -> cqs_finished));
+#else
+					if (pthread_mutex_init (& (queries_p -> cqs_lock), NULL) == 0)
+						{
+							if (pthread_cond_init (& (queries_p -> cqs_finished), NULL) != 0)
+								{
+									pthread_mutex_destroy (& (queries_p -> cqs_lock));
+									success_flag = false;
+								}
+						}
+					else
+						{
+							success_flag = false;
+						}
+#endif
+				}
+
+			if (success_flag)
+				{
+					queries_p -> cqs_num_running = QF_NUM_FORMS;
+
+					/* One for each thread and one for the caller */
+					queries_p -> cqs_num_references = QF_NUM_FORMS + 1;
+
+					return queries_p;
+				}
+
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to set up concurrent queries");
+
+			for (i = 0; i < QF_NUM_FORMS; ++ i)
+				{
+					ConcurrentQuery *query_p = queries_p -> cqs_queries + i;
+
+					if (query_p -> cq_url_s)
+						{
+							FreeCopiedString (query_p -> cq_url_s);
+						}
+
+					if (query_p -> cq_address_p)
+						{
+							FreeAddress (query_p -> cq_address_p);
+						}
+				}
+
+			FreeMemory (queries_p);
+		}
+
+	return NULL;
+}
+
+
+static void FreeConcurrentQueries (ConcurrentQueries *queries_p)
+{
+	uint32 i;
+
+	for (i = 0; i < QF_NUM_FORMS; ++ i)
+		{
+			FreeCopiedString (queries_p -> cqs_queries [i].cq_url_s);
+			FreeAddress (queries_p -> cqs_queries [i].cq_address_p);
+		}
+
+#ifndef _WIN32
+	pthread_cond_destroy (& (queries_p -> cqs_finished));
+	pthread_mutex_destroy (& (queries_p -> cqs_lock));
+#endif
+
+	FreeMemory (queries_p);
+}
+
+
+/*
+ * Drop a reference to the ConcurrentQueries, first copying the winning
+ * location into address_p if it is not NULL, and free them if this was
+ * the last one.
+ */
+static void ReleaseConcurrentQueries (ConcurrentQueries *queries_p, Address *address_p)
+{
+	uint32 num_references;
+
+#ifdef _WIN32
+	AcquireSRWLockExclusive (& (queries_p -> cqs_lock));
+#else
+	pthread_mutex_lock (& (queries_p -> cqs_lock));
+#endif
+
+	if (address_p)
+		{
+			if (!CopyAddressLocation (address_p, queries_p -> cqs_queries [queries_p -> cqs_winner].cq_address_p))
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to copy location to \"%s\"", address_p -> ad_name_s ? address_p -> ad_name_s : "");
+				}
+		}
+
+	num_references = -- (queries_p -> cqs_num_references);
+
+#ifdef _WIN32
+	ReleaseSRWLockExclusive (& (queries_p -> cqs_lock));
+#else
+	pthread_mutex_unlock (& (queries_p -> cqs_lock));
+#endif
+
+	if (num_references == 0)
+		{
+			FreeConcurrentQueries (queries_p);
+		}
+}
+
+
+static void RunConcurrentQuery (ConcurrentQuery *query_p)
+{
+	ConcurrentQueries *queries_p = query_p -> cq_queries_p;
+	CurlTool *curl_p = AllocateMemoryCurlTool (0);
+	int res = -1;
+
+	if (curl_p)
+		{
+			res = queries_p -> cqs_call_fn (curl_p, query_p -> cq_url_s, query_p -> cq_address_p);
+			FreeCurlTool (curl_p);
+		}
+
+	/*
+	 * Both forms are always sent in this mode, so unlike the sequential
+	 * queries the results of both of them are a fair comparison.
+	 */
+	if (res >= 0)
+		{
+			RecordQueryResult (queries_p -> cqs_provider, queries_p -> cqs_fields, query_p -> cq_form, (res == 1));
+		}
+
+#ifdef _WIN32
+	AcquireSRWLockExclusive (& (queries_p -> cqs_lock));
+#else
+	pthread_mutex_lock (& (queries_p -> cqs_lock));
+#endif
+
+	if ((res == 1) && (queries_p -> cqs_winner < 0))
+		{
+			queries_p -> cqs_winner = (int32) (query_p -> cq_form);
+		}
+
+	-- (queries_p -> cqs_num_running);
+
+#ifdef _WIN32
+	WakeAllConditionVariable (& (queries_p -> cqs_finished));
+	ReleaseSRWLockExclusive (& (queries_p -> cqs_lock));
+#else
+	pthread_cond_broadcast (& (queries_p -> cqs_finished));
+	pthread_mutex_unlock (& (queries_p -> cqs_lock));
+#endif
+
+	ReleaseConcurrentQueries (queries_p, NULL);
+}
+
+
+#ifdef _WIN32
+static DWORD WINAPI RunConcurrentQueryThread (LPVOID data_p)
+{
+	RunConcurrentQuery ((ConcurrentQuery *) data_p);
+	return 0;
+}
+#else
+static void *RunConcurrentQueryThread (void *data_p)
+{
+	RunConcurrentQuery ((ConcurrentQuery *) data_p);
+	return NULL;
+}
+#endif
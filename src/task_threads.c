@@ -0,0 +1,172 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * task_threads.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <pthread.h>
+	#include <unistd.h>
+#endif
+
+#include "task_threads.h"
+
+#include "memory_allocations.h"
+
+
+/*
+ * A task and the thread that is running it.
+ */
+typedef struct TaskThread
+{
+	TaskFunction tt_task_fn;
+
+	void *tt_task_p;
+
+#ifdef _WIN32
+	HANDLE tt_thread;
+#else
+	pthread_t tt_thread;
+#endif
+
+	bool tt_started_flag;
+} TaskThread;
+
+
+#ifdef _WIN32
+static DWORD WINAPI RunTaskThread (LPVOID data_p);
+#else
+static void *RunTaskThread (void *data_p);
+#endif
+
+
+
+uint32 GetNumberOfTaskThreads (const uint32 num_threads, const size_t num_items, const size_t min_items_per_thread)
+{
+	size_t max_threads = num_threads;
+
+	if (max_threads == 0)
+		{
+#ifdef _WIN32
+			SYSTEM_INFO info;
+
+			GetSystemInfo (&info);
+			max_threads = info.dwNumberOfProcessors;
+#else
+			const long num_processors = sysconf (_SC_NPROCESSORS_ONLN);
+
+			max_threads = (num_processors > 0) ? (size_t) num_processors : 1;
+#endif
+		}
+
+	if (max_threads > num_items / min_items_per_thread)
+		{
+			max_threads = num_items / min_items_per_thread;
+		}
+
+	return (max_threads > 0) ? (uint32) max_threads : 1;
+}
+
+
+void RunTasksOnThreads (TaskFunction task_fn, void *tasks_p, const size_t task_size, const uint32 num_tasks)
+{
+	TaskThread *threads_p = NULL;
+	uint32 i;
+
+	if (num_tasks > 1)
+		{
+			threads_p = (TaskThread *) AllocMemory (num_tasks * sizeof (TaskThread));
+		}
+
+	if (threads_p)
+		{
+			/* The first task is run on this thread */
+			threads_p -> tt_started_flag = false;
+
+			for (i = 1; i < num_tasks; ++ i)
+				{
+					TaskThread *thread_p = threads_p + i;
+
+					thread_p -> tt_task_fn = task_fn;
+					thread_p -> tt_task_p = ((char *) tasks_p) + (i * task_size);
+
+#ifdef _WIN32
+					thread_p -> tt_thread = CreateThread (NULL, 0, RunTaskThread, thread_p, 0, NULL);
+					thread_p -> tt_started_flag = (thread_p -> tt_thread != NULL);
+#else
+					thread_p -> tt_started_flag = (pthread_create (& (thread_p -> tt_thread), NULL, RunTaskThread, thread_p) == 0);
+#endif
+				}
+		}
+
+	for (i = 0; i < num_tasks; ++ i)
+		{
+			if ((!threads_p) || (! ((threads_p + i) -> tt_started_flag)))
+				{
+					task_fn (((char *) tasks_p) + (i * task_size));
+				}
+		}
+
+	if (threads_p)
+		{
+			for (i = 1; i < num_tasks; ++ i)
+				{
+					TaskThread *thread_p = threads_p + i;
+
+					if (thread_p -> tt_started_flag)
+						{
+#ifdef _WIN32
+							WaitForSingleObject (thread_p -> tt_thread, INFINITE);
+							CloseHandle (thread_p -> tt_thread);
+#else
+							pthread_join (thread_p -> tt_thread, NULL);
+#endif
+						}
+				}
+
+			FreeMemory (threads_p);
+		}
+}
+
+
+
+/*
+ * STATIC DEFINITIONS
+ */
+
+
+#ifdef _WIN32
+static DWORD WINAPI RunTaskThread (LPVOID data_p)
+{
+	TaskThread *thread_p = (TaskThread *) data_p;
+
+	thread_p -> tt_task_fn (thread_p -> tt_task_p);
+	return 0;
+}
+#else
+static void *RunTaskThread (void *data_p)
+{
+	TaskThread *thread_p = (TaskThread *) data_p;
+
+	thread_p -> tt_task_fn (thread_p -> tt_task_p);
+	return NULL;
+}
+#endif
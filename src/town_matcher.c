@@ -0,0 +1,1352 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * town_matcher.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <pthread.h>
+#endif
+
+#include "town_matcher.h"
+
+#include "memory_allocations.h"
+#include "streams.h"
+#include "string_utils.h"
+
+
+/* The longest normalised name that can be matched */
+#define TM_MAX_KEY_LENGTH (255)
+
+/* The longest name that Myers' algorithm can handle in a single word */
+#define TM_MAX_WORD_KEY_LENGTH (64)
+
+#define TM_MAX_COUNTRY_CODE_LENGTH (3)
+
+#define TM_INITIAL_CAPACITY (64)
+
+/* The town given by AddTown () for names that are ignored */
+#define TM_NO_TOWN (0xFFFFFFFFu)
+
+
+/* A name in the index */
+typedef struct TownEntry
+{
+	/* The name as it was added */
+	char *te_name_s;
+
+	/* The normalised name */
+	char *te_key_s;
+
+	uint32 te_key_length;
+
+	/* The number of distinct trigrams in the normalised name */
+	uint32 te_num_trigrams;
+
+	uint32 te_hash;
+
+	/* This is empty if the name matches in every country */
+	char te_country_code_s [TM_MAX_COUNTRY_CODE_LENGTH + 1];
+} TownEntry;
+
+
+/* The towns that contain a trigram, in the order that they were added */
+typedef struct TrigramPostings
+{
+	/* This is 0 for an unused slot which no trigram can be since they all contain a space or letter */
+	uint32 tp_key;
+
+	uint32 *tp_towns_p;
+
+	uint32 tp_num_towns;
+
+	uint32 tp_capacity;
+} TrigramPostings;
+
+
+typedef struct CachedTownRecord
+{
+	AddressRecordView ctr_view;
+
+	uint32 ctr_town;
+} CachedTownRecord;
+
+
+/* The working space for a search, which counts the trigrams that each town shares with the query */
+typedef struct TownScratch
+{
+	/* These are all 0 between searches */
+	uint32 *ts_counts_p;
+
+	uint32 *ts_candidates_p;
+
+	uint32 ts_capacity;
+
+	struct TownScratch *ts_next_p;
+} TownScratch;
+
+
+/*
+ * Each search takes a TownScratch from this pool and puts it back
+ * afterwards, so concurrent searches never share one and the pool
+ * only grows to the number of searches that run at the same time.
+ */
+typedef struct TownMatcherSync
+{
+#ifdef _WIN32
+	CRITICAL_SECTION tms_lock;
+#else
+	pthread_mutex_t tms_lock;
+#endif
+
+	TownScratch *tms_free_scratch_p;
+} TownMatcherSync;
+
+
+static uint32 NormaliseTownName (const char *name_s, char *key_s);
+
+static uint32 GetTownKeyHash (const char *key_s, const uint32 key_length);
+
+static uint32 GetTrigrams (const char *key_s, const uint32 key_length, uint32 *trigrams_p);
+
+static bool AddTown (TownMatcher *matcher_p, const char *town_s, const char *country_code_s, uint32 *town_p);
+
+static int32 FindTown (const TownMatcher *matcher_p, const char *key_s, const uint32 key_length, const uint32 hash, const char *country_code_s, uint32 *slot_p);
+
+static bool GrowTowns (TownMatcher *matcher_p);
+
+static bool GrowTownSlots (TownMatcher *matcher_p);
+
+static const TrigramPostings *FindTrigramPostings (const TownMatcher *matcher_p, const uint32 trigram);
+
+static TrigramPostings *AddTrigramPostings (TownMatcher *matcher_p, const uint32 trigram);
+
+static bool GrowTrigrams (TownMatcher *matcher_p);
+
+static bool AddTownToPostings (TrigramPostings *postings_p, const uint32 town);
+
+static bool IsSameCountryCode (const char *entry_code_s, const char *country_code_s);
+
+static uint32 GetAutomaticDistance (const uint32 key_length);
+
+static uint32 GetWordEditDistance (const uint64 *peq_p, const uint32 pattern_length, const char *text_s, const uint32 text_length);
+
+static uint32 GetEditDistance (const char *pattern_s, const uint32 pattern_length, const char *text_s, const uint32 text_length);
+
+static bool DoesRecordMatchAddress (const AddressRecordView *view_p, const Address *address_p);
+
+static bool DoesRecordValueMatch (const AddressRecordView *view_p, const AddressRecordComponent component, const char *value_s);
+
+static int CompareUInt32s (const void *v0_p, const void *v1_p);
+
+static int CompareCachedTownRecords (const void *v0_p, const void *v1_p);
+
+static TownScratch *GetTownScratch (const TownMatcher *matcher_p);
+
+static void ReleaseTownScratch (const TownMatcher *matcher_p, TownScratch *scratch_p);
+
+static void FreeTownScratch (TownScratch *scratch_p);
+
+
+
+TownMatcher *AllocateTownMatcher (void)
+{
+	TownMatcher *matcher_p = (TownMatcher *) AllocMemory (sizeof (TownMatcher));
+
+	if (matcher_p)
+		{
+			TownMatcherSync *sync_p = (TownMatcherSync *) AllocMemory (sizeof (TownMatcherSync));
+
+			if (sync_p)
+				{
+					bool lock_flag;
+
+#ifdef _WIN32
+					InitializeCriticalSection (& (sync_p -> tms_lock));
+					lock_flag = true;
+#else
+					lock_flag = (pthread_mutex_init (& (sync_p -> tms_lock), NULL) == 0);
+#endif
+
+					if (lock_flag)
+						{
+							memset (matcher_p, 0, sizeof (TownMatcher));
+
+							sync_p -> tms_free_scratch_p = NULL;
+							matcher_p -> tm_sync_p = sync_p;
+
+							return matcher_p;
+						}
+
+					FreeMemory (sync_p);
+				}
+
+			FreeMemory (matcher_p);
+		}
+
+	PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to allocate TownMatcher");
+
+	return NULL;
+}
+
+
+void FreeTownMatcher (TownMatcher *matcher_p)
+{
+	uint32 i;
+
+	for (i = 0; i < matcher_p -> tm_num_towns; ++ i)
+		{
+			TownEntry *entry_p = matcher_p -> tm_towns_p + i;
+
+			FreeCopiedString (entry_p -> te_name_s);
+			FreeMemory (entry_p -> te_key_s);
+		}
+
+	for (i = 0; i < matcher_p -> tm_trigrams_capacity; ++ i)
+		{
+			TrigramPostings *postings_p = matcher_p -> tm_trigrams_p + i;
+
+			if (postings_p -> tp_towns_p)
+				{
+					FreeMemory (postings_p -> tp_towns_p);
+				}
+		}
+
+	if (matcher_p -> tm_towns_p)
+		{
+			FreeMemory (matcher_p -> tm_towns_p);
+		}
+
+	if (matcher_p -> tm_town_slots_p)
+		{
+			FreeMemory (matcher_p -> tm_town_slots_p);
+		}
+
+	if (matcher_p -> tm_trigrams_p)
+		{
+			FreeMemory (matcher_p -> tm_trigrams_p);
+		}
+
+	if (matcher_p -> tm_records_p)
+		{
+			FreeMemory (matcher_p -> tm_records_p);
+		}
+
+	while (matcher_p -> tm_sync_p -> tms_free_scratch_p)
+		{
+			TownScratch *scratch_p = matcher_p -> tm_sync_p -> tms_free_scratch_p;
+
+			matcher_p -> tm_sync_p -> tms_free_scratch_p = scratch_p -> ts_next_p;
+			FreeTownScratch (scratch_p);
+		}
+
+#ifdef _WIN32
+	DeleteCriticalSection (& (matcher_p -> tm_sync_p -> tms_lock));
+#else
+	pthread_mutex_destroy (& (matcher_p -> tm_sync_p -> tms_lock));
+#endif
+
+	FreeMemory (matcher_p -> tm_sync_p);
+	FreeMemory (matcher_p);
+}
+
+
+bool AddTownToMatcher (TownMatcher *matcher_p, const char *town_s, const char *country_code_s)
+{
+	uint32 town;
+
+	return (AddTown (matcher_p, town_s, country_code_s, &town) && (town != TM_NO_TOWN));
+}
+
+
+bool AddAdminRegionsToTownMatcher (TownMatcher *matcher_p, const AdminRegionIndex *index_p)
+{
+	const uint32 num_regions = GetNumberOfAdminRegions (index_p);
+	uint32 i;
+
+	for (i = 0; i < num_regions; ++ i)
+		{
+			AdminRegion region;
+
+			if (GetAdminRegion (index_p, i, &region))
+				{
+					if ((region.ar_level == 7) || (region.ar_level == 8))
+						{
+							uint32 town;
+
+							if (!AddTown (matcher_p, region.ar_name_s, NULL, &town))
+								{
+									return false;
+								}
+						}
+				}
+		}
+
+	return true;
+}
+
+
+bool AddAddressRecordsToTownMatcher (TownMatcher *matcher_p, const AddressRecordFile *record_file_p)
+{
+	AddressRecordIterator iterator;
+	AddressRecordView view;
+	bool success_flag = true;
+
+	InitAddressRecordIterator (&iterator, record_file_p);
+
+	while (success_flag && GetNextAddressRecord (&iterator, &view))
+		{
+			const char *town_s = view.arv_components_ss [ARC_TOWN];
+
+			if (town_s)
+				{
+					uint32 town;
+
+					if (!AddTown (matcher_p, town_s, view.arv_components_ss [ARC_COUNTRY_CODE], &town))
+						{
+							success_flag = false;
+						}
+					else if (town != TM_NO_TOWN)
+						{
+							if (matcher_p -> tm_num_records == matcher_p -> tm_records_capacity)
+								{
+									const size_t new_capacity = (matcher_p -> tm_records_capacity > 0) ? (matcher_p -> tm_records_capacity << 1) : TM_INITIAL_CAPACITY;
+									CachedTownRecord *records_p = (CachedTownRecord *) ReallocMemory (matcher_p -> tm_records_p, new_capacity * sizeof (CachedTownRecord), matcher_p -> tm_records_capacity * sizeof (CachedTownRecord));
+
+									if (records_p)
+										{
+											matcher_p -> tm_records_p = records_p;
+											matcher_p -> tm_records_capacity = new_capacity;
+										}
+									else
+										{
+											PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to grow cached address records to " SIZET_FMT, new_capacity);
+											success_flag = false;
+										}
+								}
+
+							if (success_flag)
+								{
+									CachedTownRecord *record_p = matcher_p -> tm_records_p + matcher_p -> tm_num_records;
+
+									record_p -> ctr_view = view;
+									record_p -> ctr_town = town;
+									++ (matcher_p -> tm_num_records);
+								}
+						}
+				}
+		}
+
+	/*
+	 * Keep the records for each town together so that
+	 * SetAddressFromTownMatcherCache () can do a binary search
+	 */
+	if (matcher_p -> tm_num_records > 1)
+		{
+			qsort (matcher_p -> tm_records_p, matcher_p -> tm_num_records, sizeof (CachedTownRecord), CompareCachedTownRecords);
+		}
+
+	return success_flag;
+}
+
+
+bool FindTownMatch (const TownMatcher *matcher_p, const char *town_s, const char *country_code_s, const uint32 max_distance, TownMatch *match_p)
+{
+	char key_s [TM_MAX_KEY_LENGTH + 1];
+	uint32 trigrams [TM_MAX_KEY_LENGTH + 1];
+	uint64 peq [256];
+	const uint32 key_length = NormaliseTownName (town_s, key_s);
+	uint32 num_trigrams;
+	uint32 num_candidates = 0;
+	uint32 distance;
+	uint32 min_shared;
+	uint32 i;
+	int32 best_town = -1;
+	uint32 best_distance = 0;
+	uint32 best_shared = 0;
+	bool best_country_flag = false;
+	bool ambiguous_flag = false;
+	TownScratch *scratch_p;
+
+	if ((key_length == 0) || (key_length > TM_MAX_KEY_LENGTH) || (matcher_p -> tm_num_towns == 0))
+		{
+			return false;
+		}
+
+	scratch_p = GetTownScratch (matcher_p);
+
+	if (!scratch_p)
+		{
+			return false;
+		}
+
+	distance = (max_distance == TOWN_MATCHER_AUTO_DISTANCE) ? GetAutomaticDistance (key_length) : max_distance;
+	num_trigrams = GetTrigrams (key_s, key_length, trigrams);
+
+	/* Count how many of the query's trigrams each town shares */
+	for (i = 0; i < num_trigrams; ++ i)
+		{
+			const TrigramPostings *postings_p = FindTrigramPostings (matcher_p, trigrams [i]);
+
+			if (postings_p)
+				{
+					uint32 j;
+
+					for (j = 0; j < postings_p -> tp_num_towns; ++ j)
+						{
+							const uint32 town = postings_p -> tp_towns_p [j];
+
+							if (scratch_p -> ts_counts_p [town] == 0)
+								{
+									scratch_p -> ts_candidates_p [num_candidates] = town;
+									++ num_candidates;
+								}
+
+							++ (scratch_p -> ts_counts_p [town]);
+						}
+				}
+		}
+
+	if (key_length <= TM_MAX_WORD_KEY_LENGTH)
+		{
+			memset (peq, 0, sizeof (peq));
+
+			for (i = 0; i < key_length; ++ i)
+				{
+					peq [(uint8) key_s [i]] |= ((uint64) 1) << i;
+				}
+		}
+
+	/*
+	 * Each edit changes at most 3 of the padded trigrams so a town within
+	 * the distance must share all but 3 * distance of the query's distinct
+	 * trigrams and vice versa.
+	 */
+	min_shared = 3 * distance;
+
+	for (i = 0; i < num_candidates; ++ i)
+		{
+			const uint32 town = scratch_p -> ts_candidates_p [i];
+			const uint32 shared = scratch_p -> ts_counts_p [town];
+			const TownEntry *entry_p = matcher_p -> tm_towns_p + town;
+			const uint32 most_trigrams = (entry_p -> te_num_trigrams > num_trigrams) ? entry_p -> te_num_trigrams : num_trigrams;
+			const uint32 length_difference = (entry_p -> te_key_length > key_length) ? entry_p -> te_key_length - key_length : key_length - entry_p -> te_key_length;
+
+			scratch_p -> ts_counts_p [town] = 0;
+
+			if ((length_difference <= distance) && (shared + min_shared >= most_trigrams) && IsSameCountryCode (entry_p -> te_country_code_s, country_code_s))
+				{
+					uint32 d;
+
+					if (key_length <= TM_MAX_WORD_KEY_LENGTH)
+						{
+							d = GetWordEditDistance (peq, key_length, entry_p -> te_key_s, entry_p -> te_key_length);
+						}
+					else
+						{
+							d = GetEditDistance (key_s, key_length, entry_p -> te_key_s, entry_p -> te_key_length);
+						}
+
+					if (d <= distance)
+						{
+							const bool country_flag = (country_code_s != NULL) && (* (entry_p -> te_country_code_s) != '\0');
+							int comparison = 0;
+
+							if (best_town == -1)
+								{
+									comparison = -1;
+								}
+							else if (d != best_distance)
+								{
+									comparison = (d < best_distance) ? -1 : 1;
+								}
+							else if (shared != best_shared)
+								{
+									comparison = (shared > best_shared) ? -1 : 1;
+								}
+							else if (country_flag != best_country_flag)
+								{
+									comparison = country_flag ? -1 : 1;
+								}
+
+							if (comparison < 0)
+								{
+									best_town = (int32) town;
+									best_distance = d;
+									best_shared = shared;
+									best_country_flag = country_flag;
+									ambiguous_flag = false;
+								}
+							else if (comparison == 0)
+								{
+									/* The same name in different countries isn't ambiguous but different names are */
+									if (strcmp (entry_p -> te_key_s, matcher_p -> tm_towns_p [best_town].te_key_s) != 0)
+										{
+											ambiguous_flag = true;
+										}
+								}
+						}
+				}
+		}
+
+	ReleaseTownScratch (matcher_p, scratch_p);
+
+	if ((best_town != -1) && !ambiguous_flag)
+		{
+			const TownEntry *entry_p = matcher_p -> tm_towns_p + best_town;
+
+			match_p -> tm_town_s = entry_p -> te_name_s;
+			match_p -> tm_country_code_s = (* (entry_p -> te_country_code_s) != '\0') ? entry_p -> te_country_code_s : NULL;
+			match_p -> tm_distance = best_distance;
+
+			return true;
+		}
+
+	return false;
+}
+
+
+bool CorrectAddressTown (const TownMatcher *matcher_p, Address *address_p)
+{
+	TownMatch match;
+
+	if (address_p -> ad_town_s && FindTownMatch (matcher_p, address_p -> ad_town_s, address_p -> ad_country_code_s, TOWN_MATCHER_AUTO_DISTANCE, &match))
+		{
+			if (strcmp (address_p -> ad_town_s, match.tm_town_s) != 0)
+				{
+					char *town_s = EasyCopyToNewString (match.tm_town_s);
+
+					if (town_s)
+						{
+							FreeCopiedString (address_p -> ad_town_s);
+							address_p -> ad_town_s = town_s;
+
+							return true;
+						}
+					else
+						{
+							PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to copy town \"%s\"", match.tm_town_s);
+						}
+				}
+		}
+
+	return false;
+}
+
+
+bool SetAddressFromTownMatcherCache (const TownMatcher *matcher_p, Address *address_p)
+{
+	if (address_p -> ad_town_s && (matcher_p -> tm_num_records > 0))
+		{
+			char key_s [TM_MAX_KEY_LENGTH + 1];
+			const uint32 key_length = NormaliseTownName (address_p -> ad_town_s, key_s);
+
+			if ((key_length > 0) && (key_length <= TM_MAX_KEY_LENGTH))
+				{
+					const uint32 hash = GetTownKeyHash (key_s, key_length);
+					const uint32 mask = matcher_p -> tm_town_slots_capacity - 1;
+					uint32 slot = hash & mask;
+
+					/* The same name can have been added for several countries so check each of them */
+					while (matcher_p -> tm_town_slots_p [slot] != 0)
+						{
+							const uint32 town = matcher_p -> tm_town_slots_p [slot] - 1;
+							const TownEntry *entry_p = matcher_p -> tm_towns_p + town;
+
+							if ((entry_p -> te_hash == hash) && (entry_p -> te_key_length == key_length) && (memcmp (entry_p -> te_key_s, key_s, key_length) == 0))
+								{
+									size_t lower = 0;
+									size_t upper = matcher_p -> tm_num_records;
+
+									while (lower < upper)
+										{
+											const size_t middle = lower + ((upper - lower) >> 1);
+
+											if (matcher_p -> tm_records_p [middle].ctr_town < town)
+												{
+													lower = middle + 1;
+												}
+											else
+												{
+													upper = middle;
+												}
+										}
+
+									while ((lower < matcher_p -> tm_num_records) && (matcher_p -> tm_records_p [lower].ctr_town == town))
+										{
+											const AddressRecordView *view_p = & (matcher_p -> tm_records_p [lower].ctr_view);
+
+											if (DoesRecordMatchAddress (view_p, address_p))
+												{
+													if (SetAddressFromRecordView (address_p, view_p))
+														{
+															return true;
+														}
+													else
+														{
+															PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to set address from cached record for \"%s\"", view_p -> arv_components_ss [ARC_TOWN]);
+															return false;
+														}
+												}
+
+											++ lower;
+										}
+								}
+
+							slot = (slot + 1) & mask;
+						}
+				}
+		}
+
+	return false;
+}
+
+
+
+/*
+ * STATIC DEFINITIONS
+ */
+
+
+/*
+ * Lower-case the name and replace each run of spaces and punctuation
+ * with a single space, so that "St. Albans" and "st albans" match.
+ * The key must have room for TM_MAX_KEY_LENGTH + 1 characters. If the
+ * name is too long, a length greater than TM_MAX_KEY_LENGTH is returned.
+ */
+static uint32 NormaliseTownName (const char *name_s, char *key_s)
+{
+	uint32 length = 0;
+	bool space_flag = false;
+	const char *c_p;
+
+	for (c_p = name_s; *c_p != '\0'; ++ c_p)
+		{
+			const unsigned char c = (unsigned char) *c_p;
+
+			if (isspace (c) || (c == '-') || (c == '\'') || (c == '.') || (c == ','))
+				{
+					space_flag = (length > 0);
+				}
+			else
+				{
+					if (space_flag)
+						{
+							if (length == TM_MAX_KEY_LENGTH)
+								{
+									return TM_MAX_KEY_LENGTH + 1;
+								}
+
+							key_s [length] = ' ';
+							++ length;
+							space_flag = false;
+						}
+
+					if (length == TM_MAX_KEY_LENGTH)
+						{
+							return TM_MAX_KEY_LENGTH + 1;
+						}
+
+					key_s [length] = (char) tolower (c);
+					++ length;
+				}
+		}
+
+	key_s [length] = '\0';
+
+	return length;
+}
+
+
+/* FNV-1a */
+static uint32 GetTownKeyHash (const char *key_s, const uint32 key_length)
+{
+	uint32 hash = 2166136261u;
+	uint32 i;
+
+	for (i = 0; i < key_length; ++ i)
+		{
+			hash ^= (uint8) key_s [i];
+			hash *= 16777619u;
+		}
+
+	return hash;
+}
+
+
+/*
+ * Get the distinct trigrams of the key padded as "  key ", so that its
+ * start counts for more than its end, in ascending order. Each one is
+ * packed into the lowest 24 bits of a uint32. There is room needed
+ * for key_length + 1 trigrams.
+ */
+static uint32 GetTrigrams (const char *key_s, const uint32 key_length, uint32 *trigrams_p)
+{
+	uint32 num_trigrams = 0;
+	uint32 trigram = (((uint32) ' ') << 8) | ((uint32) ' ');
+	uint32 i;
+
+	for (i = 0; i <= key_length; ++ i)
+		{
+			const uint8 c = (i < key_length) ? (uint8) key_s [i] : (uint8) ' ';
+
+			trigram = ((trigram << 8) | c) & 0xFFFFFF;
+			trigrams_p [i] = trigram;
+		}
+
+	qsort (trigrams_p, key_length + 1, sizeof (uint32), CompareUInt32s);
+
+	for (i = 0; i <= key_length; ++ i)
+		{
+			if ((num_trigrams == 0) || (trigrams_p [num_trigrams - 1] != trigrams_p [i]))
+				{
+					trigrams_p [num_trigrams] = trigrams_p [i];
+					++ num_trigrams;
+				}
+		}
+
+	return num_trigrams;
+}
+
+
+static bool AddTown (TownMatcher *matcher_p, const char *town_s, const char *country_code_s, uint32 *town_p)
+{
+	char key_s [TM_MAX_KEY_LENGTH + 1];
+	const uint32 key_length = NormaliseTownName (town_s, key_s);
+	uint32 hash;
+	uint32 slot;
+	int32 existing_town;
+
+	*town_p = TM_NO_TOWN;
+
+	/* Names that can't be matched are ignored rather than treated as errors */
+	if (key_length == 0)
+		{
+			return true;
+		}
+
+	if (key_length > TM_MAX_KEY_LENGTH)
+		{
+			PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Town name \"%s\" is too long to match", town_s);
+			return true;
+		}
+
+	if (country_code_s && (strlen (country_code_s) > TM_MAX_COUNTRY_CODE_LENGTH))
+		{
+			PrintErrors (STM_LEVEL_WARNING, __FILE__, __LINE__, "Country code \"%s\" for \"%s\" is not valid", country_code_s, town_s);
+			return true;
+		}
+
+	/* Keep the table at most half full */
+	if ((matcher_p -> tm_num_towns + 1) * 2 > matcher_p -> tm_town_slots_capacity)
+		{
+			if (!GrowTownSlots (matcher_p))
+				{
+					return false;
+				}
+		}
+
+	hash = GetTownKeyHash (key_s, key_length);
+	existing_town = FindTown (matcher_p, key_s, key_length, hash, country_code_s, &slot);
+
+	if (existing_town != -1)
+		{
+			*town_p = (uint32) existing_town;
+			return true;
+		}
+
+	if (matcher_p -> tm_num_towns == matcher_p -> tm_towns_capacity)
+		{
+			if (!GrowTowns (matcher_p))
+				{
+					return false;
+				}
+		}
+
+	if ((matcher_p -> tm_num_trigrams + key_length + 1) * 2 > matcher_p -> tm_trigrams_capacity)
+		{
+			if (!GrowTrigrams (matcher_p))
+				{
+					return false;
+				}
+		}
+
+	{
+		const uint32 town = matcher_p -> tm_num_towns;
+		TownEntry *entry_p = matcher_p -> tm_towns_p + town;
+		uint32 trigrams [TM_MAX_KEY_LENGTH + 1];
+		const uint32 num_trigrams = GetTrigrams (key_s, key_length, trigrams);
+		uint32 i;
+
+		entry_p -> te_name_s = EasyCopyToNewString (town_s);
+
+		if (! (entry_p -> te_name_s))
+			{
+				PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to copy town \"%s\"", town_s);
+				return false;
+			}
+
+		entry_p -> te_key_s = (char *) AllocMemory (key_length + 1);
+
+		if (! (entry_p -> te_key_s))
+			{
+				PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to copy town key \"%s\"", key_s);
+				FreeCopiedString (entry_p -> te_name_s);
+				return false;
+			}
+
+		memcpy (entry_p -> te_key_s, key_s, key_length + 1);
+		entry_p -> te_key_length = key_length;
+		entry_p -> te_num_trigrams = num_trigrams;
+		entry_p -> te_hash = hash;
+
+		if (country_code_s)
+			{
+				for (i = 0; country_code_s [i] != '\0'; ++ i)
+					{
+						entry_p -> te_country_code_s [i] = (char) toupper ((unsigned char) country_code_s [i]);
+					}
+
+				entry_p -> te_country_code_s [i] = '\0';
+			}
+		else
+			{
+				* (entry_p -> te_country_code_s) = '\0';
+			}
+
+		/*
+		 * The town is only in the index once it is in all of its
+		 * postings, so if one of these fails it is just left out
+		 * of the count and the index stays consistent.
+		 */
+		for (i = 0; i < num_trigrams; ++ i)
+			{
+				TrigramPostings *postings_p = AddTrigramPostings (matcher_p, trigrams [i]);
+
+				if (!AddTownToPostings (postings_p, town))
+					{
+						uint32 j;
+
+						for (j = 0; j < i; ++ j)
+							{
+								-- (AddTrigramPostings (matcher_p, trigrams [j]) -> tp_num_towns);
+							}
+
+						FreeMemory (entry_p -> te_key_s);
+						FreeCopiedString (entry_p -> te_name_s);
+						return false;
+					}
+			}
+
+		matcher_p -> tm_town_slots_p [slot] = town + 1;
+		++ (matcher_p -> tm_num_towns);
+		*town_p = town;
+	}
+
+	return true;
+}
+
+
+/*
+ * Find a town with the given key and country code. If it isn't there,
+ * -1 is returned and slot_p is set to the free slot where it can go.
+ */
+static int32 FindTown (const TownMatcher *matcher_p, const char *key_s, const uint32 key_length, const uint32 hash, const char *country_code_s, uint32 *slot_p)
+{
+	const uint32 mask = matcher_p -> tm_town_slots_capacity - 1;
+	uint32 slot = hash & mask;
+
+	while (matcher_p -> tm_town_slots_p [slot] != 0)
+		{
+			const uint32 town = matcher_p -> tm_town_slots_p [slot] - 1;
+			const TownEntry *entry_p = matcher_p -> tm_towns_p + town;
+
+			if ((entry_p -> te_hash == hash) && (entry_p -> te_key_length == key_length) && (memcmp (entry_p -> te_key_s, key_s, key_length) == 0))
+				{
+					const char *entry_code_s = entry_p -> te_country_code_s;
+
+					if (country_code_s ? (Stricmp (entry_code_s, country_code_s) == 0) : (*entry_code_s == '\0'))
+						{
+							*slot_p = slot;
+							return (int32) town;
+						}
+				}
+
+			slot = (slot + 1) & mask;
+		}
+
+	*slot_p = slot;
+
+	return -1;
+}
+
+
+static bool GrowTowns (TownMatcher *matcher_p)
+{
+	const uint32 new_capacity = (matcher_p -> tm_towns_capacity > 0) ? (matcher_p -> tm_towns_capacity << 1) : TM_INITIAL_CAPACITY;
+	TownEntry *towns_p = (TownEntry *) ReallocMemory (matcher_p -> tm_towns_p, new_capacity * sizeof (TownEntry), matcher_p -> tm_towns_capacity * sizeof (TownEntry));
+
+	if (towns_p)
+		{
+			matcher_p -> tm_towns_p = towns_p;
+			matcher_p -> tm_towns_capacity = new_capacity;
+
+			return true;
+		}
+
+	PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to grow towns to " UINT32_FMT, new_capacity);
+
+	return false;
+}
+
+
+static bool GrowTownSlots (TownMatcher *matcher_p)
+{
+	const uint32 new_capacity = (matcher_p -> tm_town_slots_capacity > 0) ? (matcher_p -> tm_town_slots_capacity << 1) : (TM_INITIAL_CAPACITY << 1);
+	uint32 *slots_p = (uint32 *) AllocMemory (new_capacity * sizeof (uint32));
+
+	if (slots_p)
+		{
+			const uint32 mask = new_capacity - 1;
+			uint32 i;
+
+			memset (slots_p, 0, new_capacity * sizeof (uint32));
+
+			for (i = 0; i < matcher_p -> tm_num_towns; ++ i)
+				{
+					uint32 slot = matcher_p -> tm_towns_p [i].te_hash & mask;
+
+					while (slots_p [slot] != 0)
+						{
+							slot = (slot + 1) & mask;
+						}
+
+					slots_p [slot] = i + 1;
+				}
+
+			if (matcher_p -> tm_town_slots_p)
+				{
+					FreeMemory (matcher_p -> tm_town_slots_p);
+				}
+
+			matcher_p -> tm_town_slots_p = slots_p;
+			matcher_p -> tm_town_slots_capacity = new_capacity;
+
+			return true;
+		}
+
+	PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to grow town table to " UINT32_FMT, new_capacity);
+
+	return false;
+}
+
+
+static const TrigramPostings *FindTrigramPostings (const TownMatcher *matcher_p, const uint32 trigram)
+{
+	if (matcher_p -> tm_trigrams_capacity > 0)
+		{
+			const uint32 mask = matcher_p -> tm_trigrams_capacity - 1;
+			uint32 slot = (trigram * 2654435761u) & mask;
+
+			while (matcher_p -> tm_trigrams_p [slot].tp_key != 0)
+				{
+					if (matcher_p -> tm_trigrams_p [slot].tp_key == trigram)
+						{
+							return matcher_p -> tm_trigrams_p + slot;
+						}
+
+					slot = (slot + 1) & mask;
+				}
+		}
+
+	return NULL;
+}
+
+
+/* Get the postings for a trigram, adding them if they aren't already there */
+static TrigramPostings *AddTrigramPostings (TownMatcher *matcher_p, const uint32 trigram)
+{
+	if (matcher_p -> tm_trigrams_capacity > 0)
+		{
+			const uint32 mask = matcher_p -> tm_trigrams_capacity - 1;
+			uint32 slot = (trigram * 2654435761u) & mask;
+
+			while (matcher_p -> tm_trigrams_p [slot].tp_key != 0)
+				{
+					if (matcher_p -> tm_trigrams_p [slot].tp_key == trigram)
+						{
+							return matcher_p -> tm_trigrams_p + slot;
+						}
+
+					slot = (slot + 1) & mask;
+				}
+
+			matcher_p -> tm_trigrams_p [slot].tp_key = trigram;
+			++ (matcher_p -> tm_num_trigrams);
+
+			return matcher_p -> tm_trigrams_p + slot;
+		}
+
+	return NULL;
+}
+
+
+static bool GrowTrigrams (TownMatcher *matcher_p)
+{
+	uint32 new_capacity = (matcher_p -> tm_trigrams_capacity > 0) ? matcher_p -> tm_trigrams_capacity : (TM_INITIAL_CAPACITY << 2);
+	TrigramPostings *trigrams_p;
+
+	/* Make sure that there is room for the longest possible name */
+	while ((matcher_p -> tm_num_trigrams + TM_MAX_KEY_LENGTH + 1) * 2 > new_capacity)
+		{
+			new_capacity <<= 1;
+		}
+
+	trigrams_p = (TrigramPostings *) AllocMemory (new_capacity * sizeof (TrigramPostings));
+
+	if (trigrams_p)
+		{
+			const uint32 mask = new_capacity - 1;
+			uint32 i;
+
+			memset (trigrams_p, 0, new_capacity * sizeof (TrigramPostings));
+
+			for (i = 0; i < matcher_p -> tm_trigrams_capacity; ++ i)
+				{
+					const TrigramPostings *postings_p = matcher_p -> tm_trigrams_p + i;
+
+					if (postings_p -> tp_key != 0)
+						{
+							uint32 slot = (postings_p -> tp_key * 2654435761u) & mask;
+
+							while (trigrams_p [slot].tp_key != 0)
+								{
+									slot = (slot + 1) & mask;
+								}
+
+							trigrams_p [slot] = *postings_p;
+						}
+				}
+
+			if (matcher_p -> tm_trigrams_p)
+				{
+					FreeMemory (matcher_p -> tm_trigrams_p);
+				}
+
+			matcher_p -> tm_trigrams_p = trigrams_p;
+			matcher_p -> tm_trigrams_capacity = new_capacity;
+
+			return true;
+		}
+
+	PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to grow trigram table to " UINT32_FMT, new_capacity);
+
+	return false;
+}
+
+
+static bool AddTownToPostings (TrigramPostings *postings_p, const uint32 town)
+{
+	if (postings_p -> tp_num_towns == postings_p -> tp_capacity)
+		{
+			const uint32 new_capacity = (postings_p -> tp_capacity > 0) ? (postings_p -> tp_capacity << 1) : 4;
+			uint32 *towns_p = (uint32 *) ReallocMemory (postings_p -> tp_towns_p, new_capacity * sizeof (uint32), postings_p -> tp_capacity * sizeof (uint32));
+
+			if (!towns_p)
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to grow trigram postings to " UINT32_FMT, new_capacity);
+					return false;
+				}
+
+			postings_p -> tp_towns_p = towns_p;
+			postings_p -> tp_capacity = new_capacity;
+		}
+
+	postings_p -> tp_towns_p [postings_p -> tp_num_towns] = town;
+	++ (postings_p -> tp_num_towns);
+
+	return true;
+}
+
+
+static bool IsSameCountryCode (const char *entry_code_s, const char *country_code_s)
+{
+	return ((*entry_code_s == '\0') || (country_code_s == NULL) || (Stricmp (entry_code_s, country_code_s) == 0));
+}
+
+
+static uint32 GetAutomaticDistance (const uint32 key_length)
+{
+	if (key_length <= 3)
+		{
+			return 0;
+		}
+	else if (key_length <= 7)
+		{
+			return 1;
+		}
+
+	return 2;
+}
+
+
+/*
+ * Myers' bit-parallel algorithm, as given for the whole-string edit
+ * distance by Hyyrö, with one bit for each character of the pattern.
+ * peq_p has the bit for each position of each character in the pattern.
+ */
+static uint32 GetWordEditDistance (const uint64 *peq_p, const uint32 pattern_length, const char *text_s, const uint32 text_length)
+{
+	const uint64 last = ((uint64) 1) << (pattern_length - 1);
+	uint64 pv = ~ ((uint64) 0);
+	uint64 mv = 0;
+	uint32 score = pattern_length;
+	uint32 i;
+
+	for (i = 0; i < text_length; ++ i)
+		{
+			const uint64 eq = peq_p [(uint8) text_s [i]];
+			const uint64 xv = eq | mv;
+			const uint64 xh = (((eq & pv) + pv) ^ pv) | eq;
+			uint64 ph = mv | ~ (xh | pv);
+			uint64 mh = pv & xh;
+
+			if (ph & last)
+				{
+					++ score;
+				}
+			else if (mh & last)
+				{
+					-- score;
+				}
+
+			/* Unlike searching, each step along the text costs 1 in the top row */
+			ph = (ph << 1) | 1;
+			mh <<= 1;
+
+			pv = mh | ~ (xv | ph);
+			mv = ph & xv;
+		}
+
+	return score;
+}
+
+
+/* The standard dynamic programming algorithm, for names too long for a single word */
+static uint32 GetEditDistance (const char *pattern_s, const uint32 pattern_length, const char *text_s, const uint32 text_length)
+{
+	uint32 row [TM_MAX_KEY_LENGTH + 1];
+	uint32 i;
+
+	for (i = 0; i <= pattern_length; ++ i)
+		{
+			row [i] = i;
+		}
+
+	for (i = 0; i < text_length; ++ i)
+		{
+			uint32 diagonal = row [0];
+			uint32 j;
+
+			row [0] = i + 1;
+
+			for (j = 1; j <= pattern_length; ++ j)
+				{
+					const uint32 above = row [j];
+					uint32 value = diagonal + ((pattern_s [j - 1] == text_s [i]) ? 0 : 1);
+
+					if (above + 1 < value)
+						{
+							value = above + 1;
+						}
+
+					if (row [j - 1] + 1 < value)
+						{
+							value = row [j - 1] + 1;
+						}
+
+					row [j] = value;
+					diagonal = above;
+				}
+		}
+
+	return row [pattern_length];
+}
+
+
+static bool DoesRecordMatchAddress (const AddressRecordView *view_p, const Address *address_p)
+{
+	double64 latitude;
+	double64 longitude;
+
+	return (GetAddressRecordPoint (view_p, ARP_CENTRE, &latitude, &longitude, NULL, NULL) &&
+		DoesRecordValueMatch (view_p, ARC_NAME, address_p -> ad_name_s) &&
+		DoesRecordValueMatch (view_p, ARC_STREET, address_p -> ad_street_s) &&
+		DoesRecordValueMatch (view_p, ARC_COUNTY, address_p -> ad_county_s) &&
+		DoesRecordValueMatch (view_p, ARC_COUNTRY, address_p -> ad_country_s) &&
+		DoesRecordValueMatch (view_p, ARC_POSTCODE, address_p -> ad_postcode_s));
+}
+
+
+static bool DoesRecordValueMatch (const AddressRecordView *view_p, const AddressRecordComponent component, const char *value_s)
+{
+	if (value_s)
+		{
+			const char *record_value_s = view_p -> arv_components_ss [component];
+
+			return ((record_value_s != NULL) && (Stricmp (record_value_s, value_s) == 0));
+		}
+
+	return true;
+}
+
+
+static int CompareUInt32s (const void *v0_p, const void *v1_p)
+{
+	const uint32 u0 = * ((const uint32 *) v0_p);
+	const uint32 u1 = * ((const uint32 *) v1_p);
+
+	return (u0 < u1) ? -1 : ((u0 > u1) ? 1 : 0);
+}
+
+
+static int CompareCachedTownRecords (const void *v0_p, const void *v1_p)
+{
+	const CachedTownRecord *record0_p = (const CachedTownRecord *) v0_p;
+	const CachedTownRecord *record1_p = (const CachedTownRecord *) v1_p;
+
+	return (record0_p -> ctr_town < record1_p -> ctr_town) ? -1 : ((record0_p -> ctr_town > record1_p -> ctr_town) ? 1 : 0);
+}
+
+
+static TownScratch *GetTownScratch (const TownMatcher *matcher_p)
+{
+	TownMatcherSync *sync_p = matcher_p -> tm_sync_p;
+	TownScratch *scratch_p;
+
+#ifdef _WIN32
+	EnterCriticalSection (& (sync_p -> tms_lock));
+#else
+	pthread_mutex_lock (& (sync_p -> tms_lock));
+#endif
+
+	scratch_p = sync_p -> tms_free_scratch_p;
+
+	if (scratch_p)
+		{
+			sync_p -> tms_free_scratch_p = scratch_p -> ts_next_p;
+		}
+
+#ifdef _WIN32
+	LeaveCriticalSection (& (sync_p -> tms_lock));
+#else
+	pthread_mutex_unlock (& (sync_p -> tms_lock));
+#endif
+
+	if (!scratch_p)
+		{
+			scratch_p = (TownScratch *) AllocMemory (sizeof (TownScratch));
+
+			if (scratch_p)
+				{
+					memset (scratch_p, 0, sizeof (TownScratch));
+				}
+		}
+
+	/* More towns might have been added since the scratch was last used */
+	if (scratch_p && (scratch_p -> ts_capacity < matcher_p -> tm_num_towns))
+		{
+			const uint32 capacity = matcher_p -> tm_towns_capacity;
+			uint32 *counts_p = (uint32 *) AllocMemory (capacity * sizeof (uint32));
+			uint32 *candidates_p = (uint32 *) AllocMemory (capacity * sizeof (uint32));
+
+			if (counts_p && candidates_p)
+				{
+					memset (counts_p, 0, capacity * sizeof (uint32));
+
+					if (scratch_p -> ts_counts_p)
+						{
+							FreeMemory (scratch_p -> ts_counts_p);
+							FreeMemory (scratch_p -> ts_candidates_p);
+						}
+
+					scratch_p -> ts_counts_p = counts_p;
+					scratch_p -> ts_candidates_p = candidates_p;
+					scratch_p -> ts_capacity = capacity;
+				}
+			else
+				{
+					PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to allocate town search space for " UINT32_FMT " towns", capacity);
+
+					if (counts_p)
+						{
+							FreeMemory (counts_p);
+						}
+
+					if (candidates_p)
+						{
+							FreeMemory (candidates_p);
+						}
+
+					FreeTownScratch (scratch_p);
+					scratch_p = NULL;
+				}
+		}
+
+	return scratch_p;
+}
+
+
+static void ReleaseTownScratch (const TownMatcher *matcher_p, TownScratch *scratch_p)
+{
+	TownMatcherSync *sync_p = matcher_p -> tm_sync_p;
+
+#ifdef _WIN32
+	EnterCriticalSection (& (sync_p -> tms_lock));
+#else
+	pthread_mutex_lock (& (sync_p -> tms_lock));
+#endif
+
+	scratch_p -> ts_next_p = sync_p -> tms_free_scratch_p;
+	sync_p -> tms_free_scratch_p = scratch_p;
+
+#ifdef _WIN32
+	LeaveCriticalSection (& (sync_p -> tms_lock));
+#else
+	pthread_mutex_unlock (& (sync_p -> tms_lock));
+#endif
+}
+
+
+static void FreeTownScratch (TownScratch *scratch_p)
+{
+	if (scratch_p -> ts_counts_p)
+		{
+			FreeMemory (scratch_p -> ts_counts_p);
+			FreeMemory (scratch_p -> ts_candidates_p);
+		}
+
+	FreeMemory (scratch_p);
+}
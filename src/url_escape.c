@@ -0,0 +1,228 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * url_escape.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <string.h>
+
+#include "url_escape.h"
+
+#include "streams.h"
+
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#define URL_ESCAPE_USE_SSE2 (1)
+	#include <emmintrin.h>
+#endif
+
+
+static const char * const S_HEX_DIGITS_S = "0123456789ABCDEF";
+
+
+static bool IsUnreservedURLChar (const unsigned char c);
+
+static char *ReserveByteBufferSpace (ByteBuffer *buffer_p, const size_t length);
+
+static size_t GetUnreservedRunLength (const char *value_s, const size_t length);
+
+
+bool AppendURLEscapedStringToByteBuffer (ByteBuffer *buffer_p, const char *value_s, const bool spaces_as_plus_flag)
+{
+	return AppendURLEscapedDataToByteBuffer (buffer_p, value_s, strlen (value_s), spaces_as_plus_flag);
+}
+
+
+bool AppendURLEscapedDataToByteBuffer (ByteBuffer *buffer_p, const char *value_s, const size_t length, const bool spaces_as_plus_flag)
+{
+	bool success_flag = false;
+
+	/*
+	 * Every byte expands to at most 3 bytes so reserve
+	 * that up front and then write directly into the buffer.
+	 */
+	char *dest_p = ReserveByteBufferSpace (buffer_p, length * 3);
+
+	if (dest_p)
+		{
+			char *end_p = WriteURLEscapedData (dest_p, value_s, length, spaces_as_plus_flag);
+
+			buffer_p -> bb_current_index += (end_p - dest_p);
+			* ((buffer_p -> bb_data_p) + (buffer_p -> bb_current_index)) = '\0';
+
+			success_flag = true;
+		}		/* if (dest_p) */
+	else
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to reserve " SIZET_FMT " bytes for escaped value", length * 3);
+		}
+
+	return success_flag;
+}
+
+
+char *WriteURLEscapedData (char *dest_p, const char *value_s, const size_t length, const bool spaces_as_plus_flag)
+{
+	const char *src_p = value_s;
+	const char * const end_p = value_s + length;
+
+	while (src_p < end_p)
+		{
+			const size_t run_length = GetUnreservedRunLength (src_p, end_p - src_p);
+
+			if (run_length > 0)
+				{
+					memcpy (dest_p, src_p, run_length);
+					dest_p += run_length;
+					src_p += run_length;
+				}
+
+			if (src_p < end_p)
+				{
+					const unsigned char c = (const unsigned char) *src_p;
+
+					if ((c == ' ') && spaces_as_plus_flag)
+						{
+							*dest_p = '+';
+							++ dest_p;
+						}
+					else
+						{
+							*dest_p = '%';
+							* (dest_p + 1) = S_HEX_DIGITS_S [c >> 4];
+							* (dest_p + 2) = S_HEX_DIGITS_S [c & 0x0F];
+							dest_p += 3;
+						}
+
+					++ src_p;
+				}
+
+		}		/* while (src_p < end_p) */
+
+	return dest_p;
+}
+
+
+size_t GetURLEscapedLength (const char *value_s, const size_t length)
+{
+	size_t escaped_length = 0;
+	const char *src_p = value_s;
+	const char * const end_p = value_s + length;
+
+	while (src_p < end_p)
+		{
+			const size_t run_length = GetUnreservedRunLength (src_p, end_p - src_p);
+
+			escaped_length += run_length;
+			src_p += run_length;
+
+			if (src_p < end_p)
+				{
+					escaped_length += 3;
+					++ src_p;
+				}
+		}
+
+	return escaped_length;
+}
+
+
+static bool IsUnreservedURLChar (const unsigned char c)
+{
+	return (((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || ((c >= '0') && (c <= '9')) || (c == '-') || (c == '.') || (c == '_') || (c == '~'));
+}
+
+
+/*
+ * Get the number of bytes at the start of value_s that can be
+ * copied verbatim. Address components are mostly letters so with
+ * SSE2 we check 16 bytes at a time and only drop to the byte-by-byte
+ * check for the block containing the first reserved character.
+ */
+static size_t GetUnreservedRunLength (const char *value_s, const size_t length)
+{
+	size_t i = 0;
+
+#ifdef URL_ESCAPE_USE_SSE2
+	const __m128i lower_min = _mm_set1_epi8 ('a' - 1);
+	const __m128i lower_max = _mm_set1_epi8 ('z' + 1);
+	const __m128i upper_min = _mm_set1_epi8 ('A' - 1);
+	const __m128i upper_max = _mm_set1_epi8 ('Z' + 1);
+	const __m128i digit_min = _mm_set1_epi8 ('0' - 1);
+	const __m128i digit_max = _mm_set1_epi8 ('9' + 1);
+	const __m128i hyphen = _mm_set1_epi8 ('-');
+	const __m128i dot = _mm_set1_epi8 ('.');
+	const __m128i underscore = _mm_set1_epi8 ('_');
+	const __m128i tilde = _mm_set1_epi8 ('~');
+
+	while (i + 16 <= length)
+		{
+			/*
+			 * The comparisons are signed so any bytes >= 0x80, i.e. UTF-8
+			 * sequences, are negative and fail all of the range checks.
+			 */
+			const __m128i v = _mm_loadu_si128 ((const __m128i *) (value_s + i));
+			__m128i ok = _mm_and_si128 (_mm_cmpgt_epi8 (v, lower_min), _mm_cmplt_epi8 (v, lower_max));
+			int mask;
+
+			ok = _mm_or_si128 (ok, _mm_and_si128 (_mm_cmpgt_epi8 (v, upper_min), _mm_cmplt_epi8 (v, upper_max)));
+			ok = _mm_or_si128 (ok, _mm_and_si128 (_mm_cmpgt_epi8 (v, digit_min), _mm_cmplt_epi8 (v, digit_max)));
+			ok = _mm_or_si128 (ok, _mm_or_si128 (_mm_cmpeq_epi8 (v, hyphen), _mm_cmpeq_epi8 (v, dot)));
+			ok = _mm_or_si128 (ok, _mm_or_si128 (_mm_cmpeq_epi8 (v, underscore), _mm_cmpeq_epi8 (v, tilde)));
+
+			mask = _mm_movemask_epi8 (ok);
+
+			if (mask == 0xFFFF)
+				{
+					i += 16;
+				}
+			else
+				{
+					break;
+				}
+		}
+#endif
+
+	while ((i < length) && (IsUnreservedURLChar ((const unsigned char) * (value_s + i))))
+		{
+			++ i;
+		}
+
+	return i;
+}
+
+
+/*
+ * Make sure that there is room for length bytes plus a terminating '\0'
+ * and return where they should be written.
+ */
+static char *ReserveByteBufferSpace (ByteBuffer *buffer_p, const size_t length)
+{
+	const size_t space_remaining = GetRemainingSpaceInByteBuffer (buffer_p);
+
+	if (space_remaining <= length)
+		{
+			if (!ExtendByteBuffer (buffer_p, length - space_remaining + 1))
+				{
+					return NULL;
+				}
+		}
+
+	return (buffer_p -> bb_data_p) + (buffer_p -> bb_current_index);
+}
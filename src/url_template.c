@@ -0,0 +1,421 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * url_template.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ */
+
+#include <string.h>
+
+#include "url_template.h"
+#include "url_escape.h"
+#include "double_conversion.h"
+
+#include "memory_allocations.h"
+#include "string_utils.h"
+#include "streams.h"
+#include "country_codes.h"
+
+
+/*
+ * The separator used between the components for the {address} slot
+ */
+static const char * const S_ADDRESS_SEPARATOR_S = ",%20";
+
+
+typedef struct SlotName
+{
+	const char *sn_name_s;
+	URLTemplateSlot sn_slot;
+} SlotName;
+
+
+static const SlotName S_SLOT_NAMES_P [] =
+{
+	{ "name", UTS_NAME },
+	{ "street", UTS_STREET },
+	{ "town", UTS_TOWN },
+	{ "city", UTS_TOWN },
+	{ "county", UTS_COUNTY },
+	{ "country", UTS_COUNTRY },
+	{ "country_code", UTS_COUNTRY_CODE },
+	{ "postcode", UTS_POSTCODE },
+	{ "postalcode", UTS_POSTCODE },
+	{ "lat", UTS_LATITUDE },
+	{ "lon", UTS_LONGITUDE },
+	{ "lng", UTS_LONGITUDE },
+	{ "address", UTS_ADDRESS },
+	{ NULL, UTS_NUM_SLOTS }
+};
+
+
+/*
+ * The raw, unescaped, values for each slot for a given Address
+ */
+typedef struct SlotValues
+{
+	const char *sv_values_ss [UTS_NUM_SLOTS];
+	size_t sv_lengths [UTS_NUM_SLOTS];
+	size_t sv_escaped_lengths [UTS_NUM_SLOTS];
+	char sv_latitude_s [DOUBLE_CONVERSION_BUFFER_SIZE];
+	char sv_longitude_s [DOUBLE_CONVERSION_BUFFER_SIZE];
+} SlotValues;
+
+
+static bool GetSlotFromName (const char *name_s, const size_t name_length, URLTemplateSlot *slot_p);
+
+static void FillSlotValues (SlotValues *values_p, const Address *address_p, const uint32 used_slots);
+
+static size_t CalculateEscapedSlotLength (const SlotValues *values_p, const URLTemplateSlot slot);
+
+static char *WriteSlot (char *dest_p, const SlotValues *values_p, const URLTemplateSlot slot);
+
+
+
+URLTemplate *AllocateURLTemplate (const char *template_s)
+{
+	char *copied_template_s = EasyCopyToNewString (template_s);
+
+	if (copied_template_s)
+		{
+			/* There can be at most one segment per slot plus one trailing literal segment */
+			size_t max_num_segments = 1;
+			const char *c_p = copied_template_s;
+			URLTemplateSegment *segments_p = NULL;
+
+			while ((c_p = strchr (c_p, '{')) != NULL)
+				{
+					++ max_num_segments;
+					++ c_p;
+				}
+
+			segments_p = (URLTemplateSegment *) AllocMemoryArray (max_num_segments, sizeof (URLTemplateSegment));
+
+			if (segments_p)
+				{
+					URLTemplateSegment *segment_p = segments_p;
+					size_t literal_length = 0;
+					uint32 used_slots = 0;
+					bool success_flag = true;
+
+					c_p = copied_template_s;
+
+					while ((*c_p != '\0') && success_flag)
+						{
+							const char *open_p = strchr (c_p, '{');
+
+							segment_p -> uts_literal_s = c_p;
+							segment_p -> uts_prefix_s = NULL;
+							segment_p -> uts_prefix_length = 0;
+							segment_p -> uts_slot = UTS_NUM_SLOTS;
+
+							if (open_p)
+								{
+									const char *close_p = strchr (open_p + 1, '}');
+
+									segment_p -> uts_literal_length = open_p - c_p;
+
+									if (close_p)
+										{
+											const char *name_p = open_p + 1;
+											const char *equals_p = (const char *) memchr (name_p, '=', close_p - name_p);
+
+											if (equals_p)
+												{
+													segment_p -> uts_prefix_s = name_p;
+													segment_p -> uts_prefix_length = equals_p - name_p + 1;
+													name_p = equals_p + 1;
+												}
+
+											if (GetSlotFromName (name_p, close_p - name_p, & (segment_p -> uts_slot)))
+												{
+													used_slots |= (1 << (segment_p -> uts_slot));
+													c_p = close_p + 1;
+												}
+											else
+												{
+													PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Unknown slot \"%.*s\" in url template \"%s\"", (int) (close_p - name_p), name_p, template_s);
+													success_flag = false;
+												}
+										}
+									else
+										{
+											PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Unterminated slot in url template \"%s\"", template_s);
+											success_flag = false;
+										}
+								}
+							else
+								{
+									segment_p -> uts_literal_length = strlen (c_p);
+									c_p += segment_p -> uts_literal_length;
+								}
+
+							literal_length += segment_p -> uts_literal_length;
+							++ segment_p;
+						}		/* while ((*c_p != '\0') && success_flag) */
+
+					if (success_flag)
+						{
+							URLTemplate *template_p = (URLTemplate *) AllocMemory (sizeof (URLTemplate));
+
+							if (template_p)
+								{
+									template_p -> ut_template_s = copied_template_s;
+									template_p -> ut_segments_p = segments_p;
+									template_p -> ut_num_segments = segment_p - segments_p;
+									template_p -> ut_literal_length = literal_length;
+									template_p -> ut_used_slots = used_slots;
+
+									return template_p;
+								}
+						}
+
+					FreeMemory (segments_p);
+				}		/* if (segments_p) */
+
+			FreeCopiedString (copied_template_s);
+		}		/* if (copied_template_s) */
+
+	return NULL;
+}
+
+
+void FreeURLTemplate (URLTemplate *template_p)
+{
+	FreeMemory (template_p -> ut_segments_p);
+	FreeCopiedString (template_p -> ut_template_s);
+	FreeMemory (template_p);
+}
+
+
+bool DoesURLTemplateUseSlot (const URLTemplate *template_p, const URLTemplateSlot slot)
+{
+	return ((template_p -> ut_used_slots & (1 << slot)) != 0);
+}
+
+
+bool BuildURLFromTemplate (const URLTemplate *template_p, const Address *address_p, ByteBuffer *buffer_p)
+{
+	bool success_flag = false;
+	SlotValues values;
+	size_t url_length = template_p -> ut_literal_length;
+	size_t space_remaining;
+	const URLTemplateSegment *segment_p = template_p -> ut_segments_p;
+	size_t i;
+
+	FillSlotValues (&values, address_p, template_p -> ut_used_slots);
+
+	/*
+	 * Work out the exact size of the url so that we only need
+	 * to resize the buffer once
+	 */
+	for (i = template_p -> ut_num_segments; i > 0; -- i, ++ segment_p)
+		{
+			if (segment_p -> uts_slot != UTS_NUM_SLOTS)
+				{
+					const size_t slot_length = values.sv_escaped_lengths [segment_p -> uts_slot];
+
+					if (slot_length > 0)
+						{
+							url_length += (segment_p -> uts_prefix_length) + slot_length;
+						}
+				}
+		}
+
+	space_remaining = GetRemainingSpaceInByteBuffer (buffer_p);
+
+	if (space_remaining > url_length)
+		{
+			success_flag = true;
+		}
+	else
+		{
+			success_flag = ExtendByteBuffer (buffer_p, url_length - space_remaining + 1);
+		}
+
+	if (success_flag)
+		{
+			char *dest_p = (buffer_p -> bb_data_p) + (buffer_p -> bb_current_index);
+
+			segment_p = template_p -> ut_segments_p;
+
+			for (i = template_p -> ut_num_segments; i > 0; -- i, ++ segment_p)
+				{
+					memcpy (dest_p, segment_p -> uts_literal_s, segment_p -> uts_literal_length);
+					dest_p += segment_p -> uts_literal_length;
+
+					if (segment_p -> uts_slot != UTS_NUM_SLOTS)
+						{
+							if ((segment_p -> uts_prefix_length == 0) || (values.sv_escaped_lengths [segment_p -> uts_slot] > 0))
+								{
+									if (segment_p -> uts_prefix_length > 0)
+										{
+											memcpy (dest_p, segment_p -> uts_prefix_s, segment_p -> uts_prefix_length);
+											dest_p += segment_p -> uts_prefix_length;
+										}
+
+									dest_p = WriteSlot (dest_p, &values, segment_p -> uts_slot);
+								}
+						}
+				}
+
+			buffer_p -> bb_current_index += url_length;
+			* ((buffer_p -> bb_data_p) + (buffer_p -> bb_current_index)) = '\0';
+		}
+	else
+		{
+			PrintErrors (STM_LEVEL_SEVERE, __FILE__, __LINE__, "Failed to extend buffer to " SIZET_FMT " bytes for url template \"%s\"", url_length, template_p -> ut_template_s);
+		}
+
+	return success_flag;
+}
+
+
+static bool GetSlotFromName (const char *name_s, const size_t name_length, URLTemplateSlot *slot_p)
+{
+	const SlotName *slot_name_p = S_SLOT_NAMES_P;
+
+	while (slot_name_p -> sn_name_s)
+		{
+			if ((strncmp (slot_name_p -> sn_name_s, name_s, name_length) == 0) && (* ((slot_name_p -> sn_name_s) + name_length) == '\0'))
+				{
+					*slot_p = slot_name_p -> sn_slot;
+					return true;
+				}
+
+			++ slot_name_p;
+		}
+
+	return false;
+}
+
+
+static void FillSlotValues (SlotValues *values_p, const Address *address_p, const uint32 used_slots)
+{
+	const char *country_s = address_p -> ad_country_s;
+	const char *country_code_s = address_p -> ad_country_code_s;
+	size_t i;
+
+	if ((!country_s) && country_code_s)
+		{
+			country_s = GetCountryNameFromCode (country_code_s);
+		}
+
+	if ((!country_code_s) && country_s)
+		{
+			country_code_s = GetCountryCodeFromName (country_s);
+		}
+
+	values_p -> sv_values_ss [UTS_NAME] = address_p -> ad_name_s;
+	values_p -> sv_values_ss [UTS_STREET] = address_p -> ad_street_s;
+	values_p -> sv_values_ss [UTS_TOWN] = address_p -> ad_town_s;
+	values_p -> sv_values_ss [UTS_COUNTY] = address_p -> ad_county_s;
+	values_p -> sv_values_ss [UTS_COUNTRY] = country_s;
+	values_p -> sv_values_ss [UTS_COUNTRY_CODE] = country_code_s;
+	values_p -> sv_values_ss [UTS_POSTCODE] = address_p -> ad_postcode_s;
+	values_p -> sv_values_ss [UTS_LATITUDE] = NULL;
+	values_p -> sv_values_ss [UTS_LONGITUDE] = NULL;
+	values_p -> sv_values_ss [UTS_ADDRESS] = NULL;
+
+	if ((address_p -> ad_gps_centre_p) && (used_slots & ((1 << UTS_LATITUDE) | (1 << UTS_LONGITUDE))))
+		{
+			WriteShortestDouble (address_p -> ad_gps_centre_p -> co_x, values_p -> sv_latitude_s);
+			WriteShortestDouble (address_p -> ad_gps_centre_p -> co_y, values_p -> sv_longitude_s);
+
+			values_p -> sv_values_ss [UTS_LATITUDE] = values_p -> sv_latitude_s;
+			values_p -> sv_values_ss [UTS_LONGITUDE] = values_p -> sv_longitude_s;
+		}
+
+	for (i = 0; i < UTS_NUM_SLOTS; ++ i)
+		{
+			const char *value_s = values_p -> sv_values_ss [i];
+
+			values_p -> sv_lengths [i] = value_s ? strlen (value_s) : 0;
+		}
+
+	for (i = 0; i < UTS_NUM_SLOTS; ++ i)
+		{
+			values_p -> sv_escaped_lengths [i] = (used_slots & (1 << i)) ? CalculateEscapedSlotLength (values_p, (URLTemplateSlot) i) : 0;
+		}
+}
+
+
+/*
+ * Get the escaped length of a slot's value. This is only called once per
+ * slot when filling in the SlotValues.
+ */
+static size_t CalculateEscapedSlotLength (const SlotValues *values_p, const URLTemplateSlot slot)
+{
+	size_t length = 0;
+
+	if (slot == UTS_ADDRESS)
+		{
+			const size_t sep_length = strlen (S_ADDRESS_SEPARATOR_S);
+			URLTemplateSlot i;
+
+			for (i = UTS_NAME; i <= UTS_COUNTRY; ++ i)
+				{
+					if (values_p -> sv_lengths [i] > 0)
+						{
+							if (length > 0)
+								{
+									length += sep_length;
+								}
+
+							length += GetURLEscapedLength (values_p -> sv_values_ss [i], values_p -> sv_lengths [i]);
+						}
+				}
+		}
+	else if (values_p -> sv_lengths [slot] > 0)
+		{
+			length = GetURLEscapedLength (values_p -> sv_values_ss [slot], values_p -> sv_lengths [slot]);
+		}
+
+	return length;
+}
+
+
+static char *WriteSlot (char *dest_p, const SlotValues *values_p, const URLTemplateSlot slot)
+{
+	if (slot == UTS_ADDRESS)
+		{
+			const size_t sep_length = strlen (S_ADDRESS_SEPARATOR_S);
+			const char * const start_p = dest_p;
+			URLTemplateSlot i;
+
+			for (i = UTS_NAME; i <= UTS_COUNTRY; ++ i)
+				{
+					if (values_p -> sv_lengths [i] > 0)
+						{
+							if (dest_p != start_p)
+								{
+									memcpy (dest_p, S_ADDRESS_SEPARATOR_S, sep_length);
+									dest_p += sep_length;
+								}
+
+							dest_p = WriteURLEscapedData (dest_p, values_p -> sv_values_ss [i], values_p -> sv_lengths [i], false);
+						}
+				}
+		}
+	else if (values_p -> sv_lengths [slot] > 0)
+		{
+			dest_p = WriteURLEscapedData (dest_p, values_p -> sv_values_ss [slot], values_p -> sv_lengths [slot], false);
+		}
+
+	return dest_p;
+}
@@ -0,0 +1,300 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * address_record_converter.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * Convert between the JSON representation of Addresses and the
+ * binary address record format.
+ *
+ *   address_record_converter -to-binary <in.json> <out.ggar> [-provider <name>] [-timestamp <seconds>]
+ *   address_record_converter -to-json <in.ggar> <out.json> [-lines]
+ *
+ * JSON input can be either an array of Addresses or one Address per line.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "address_json.h"
+#include "address_record.h"
+
+#include "byte_buffer.h"
+#include "memory_allocations.h"
+
+
+typedef struct RecordConversion
+{
+	AddressRecordWriter *rc_writer_p;
+	const char *rc_provider_s;
+	const char *rc_provenance_s;
+	int64 rc_timestamp;
+} RecordConversion;
+
+
+static int ConvertJSONToRecords (const char *in_s, const char *out_s, const char *provider_s, const int64 timestamp);
+
+static int ConvertRecordsToJSON (const char *in_s, const char *out_s, const AddressJSONFormat format);
+
+static bool AddAddressToRecords (Address *address_p, void *user_data_p);
+
+static char *LoadFile (const char *filename_s, size_t *length_p);
+
+static bool FlushByteBuffer (ByteBuffer *buffer_p, FILE *out_f);
+
+static void PrintUsage (const char *program_s);
+
+
+
+int main (int argc, char *argv [])
+{
+	int res = 1;
+
+	if (argc >= 4)
+		{
+			const char *provider_s = NULL;
+			int64 timestamp = (int64) time (NULL);
+			AddressJSONFormat format = AJF_ARRAY;
+			int i;
+
+			for (i = 4; i < argc; ++ i)
+				{
+					if ((strcmp (argv [i], "-provider") == 0) && (i + 1 < argc))
+						{
+							provider_s = argv [++ i];
+						}
+					else if ((strcmp (argv [i], "-timestamp") == 0) && (i + 1 < argc))
+						{
+							timestamp = (int64) strtoll (argv [++ i], NULL, 10);
+						}
+					else if (strcmp (argv [i], "-lines") == 0)
+						{
+							format = AJF_JSON_LINES;
+						}
+					else
+						{
+							PrintUsage (argv [0]);
+							return 1;
+						}
+				}
+
+			if (strcmp (argv [1], "-to-binary") == 0)
+				{
+					res = ConvertJSONToRecords (argv [2], argv [3], provider_s, timestamp);
+				}
+			else if (strcmp (argv [1], "-to-json") == 0)
+				{
+					res = ConvertRecordsToJSON (argv [2], argv [3], format);
+				}
+			else
+				{
+					PrintUsage (argv [0]);
+				}
+		}
+	else
+		{
+			PrintUsage (argv [0]);
+		}
+
+	return res;
+}
+
+
+static int ConvertJSONToRecords (const char *in_s, const char *out_s, const char *provider_s, const int64 timestamp)
+{
+	int res = 1;
+	size_t length;
+	char *json_s = LoadFile (in_s, &length);
+
+	if (json_s)
+		{
+			RecordConversion conversion;
+
+			conversion.rc_writer_p = AllocateAddressRecordWriter (out_s);
+			conversion.rc_provider_s = provider_s;
+			conversion.rc_provenance_s = in_s;
+			conversion.rc_timestamp = timestamp;
+
+			if (conversion.rc_writer_p)
+				{
+					const int64 num_addresses = ParseAddressesFromJSONText (json_s, length, AddAddressToRecords, &conversion);
+
+					if (CloseAddressRecordWriter (conversion.rc_writer_p) && (num_addresses >= 0))
+						{
+							printf ("Converted %lld addresses from \"%s\" to \"%s\"\n", (long long) num_addresses, in_s, out_s);
+							res = 0;
+						}
+					else
+						{
+							fprintf (stderr, "Failed to convert \"%s\" to \"%s\"\n", in_s, out_s);
+						}
+				}
+
+			FreeMemory (json_s);
+		}
+
+	return res;
+}
+
+
+static bool AddAddressToRecords (Address *address_p, void *user_data_p)
+{
+	RecordConversion *conversion_p = (RecordConversion *) user_data_p;
+
+	return AddAddressRecord (conversion_p -> rc_writer_p, address_p, conversion_p -> rc_provider_s, conversion_p -> rc_provenance_s, conversion_p -> rc_timestamp);
+}
+
+
+static int ConvertRecordsToJSON (const char *in_s, const char *out_s, const AddressJSONFormat format)
+{
+	int res = 1;
+	AddressRecordFile *record_file_p = OpenAddressRecordFile (in_s);
+
+	if (record_file_p)
+		{
+			FILE *out_f = fopen (out_s, "w");
+
+			if (out_f)
+				{
+					ByteBuffer *buffer_p = AllocateByteBuffer (65536);
+
+					if (buffer_p)
+						{
+							AddressJSONStream stream;
+
+							if (StartAddressJSONStream (&stream, buffer_p, format, 0))
+								{
+									bool success_flag = true;
+									AddressRecordIterator iterator;
+									AddressRecordView view;
+									Address address;
+									uint32 num_addresses = 0;
+
+									memset (&address, 0, sizeof (Address));
+									InitAddressRecordIterator (&iterator, record_file_p);
+
+									while (success_flag && GetNextAddressRecord (&iterator, &view))
+										{
+											success_flag = SetAddressFromRecordView (&address, &view) && AppendAddressToJSONStream (&stream, &address);
+
+											if (success_flag && (GetByteBufferSize (buffer_p) >= 60000))
+												{
+													success_flag = FlushByteBuffer (buffer_p, out_f);
+												}
+
+											++ num_addresses;
+										}
+
+									if (success_flag && !HasAddressRecordIteratorFailed (&iterator) && EndAddressJSONStream (&stream) && FlushByteBuffer (buffer_p, out_f))
+										{
+											printf ("Converted " UINT32_FMT " addresses from \"%s\" to \"%s\"\n", num_addresses, in_s, out_s);
+											res = 0;
+										}
+									else
+										{
+											fprintf (stderr, "Failed to convert \"%s\" to \"%s\"\n", in_s, out_s);
+										}
+
+									ClearAddress (&address);
+								}
+
+							FreeByteBuffer (buffer_p);
+						}
+
+					if (fclose (out_f) != 0)
+						{
+							res = 1;
+						}
+				}
+			else
+				{
+					fprintf (stderr, "Failed to open \"%s\" for writing\n", out_s);
+				}
+
+			CloseAddressRecordFile (record_file_p);
+		}
+
+	return res;
+}
+
+
+static bool FlushByteBuffer (ByteBuffer *buffer_p, FILE *out_f)
+{
+	const size_t size = GetByteBufferSize (buffer_p);
+	bool success_flag = (fwrite (GetByteBufferData (buffer_p), 1, size, out_f) == size);
+
+	ResetByteBuffer (buffer_p);
+
+	return success_flag;
+}
+
+
+static char *LoadFile (const char *filename_s, size_t *length_p)
+{
+	FILE *in_f = fopen (filename_s, "rb");
+
+	if (in_f)
+		{
+			char *data_s = NULL;
+
+			if (fseek (in_f, 0, SEEK_END) == 0)
+				{
+					const long length = ftell (in_f);
+
+					if ((length >= 0) && (fseek (in_f, 0, SEEK_SET) == 0))
+						{
+							data_s = (char *) AllocMemory ((size_t) length + 1);
+
+							if (data_s)
+								{
+									if (fread (data_s, 1, (size_t) length, in_f) == (size_t) length)
+										{
+											* (data_s + length) = '\0';
+											*length_p = (size_t) length;
+										}
+									else
+										{
+											FreeMemory (data_s);
+											data_s = NULL;
+										}
+								}
+						}
+				}
+
+			fclose (in_f);
+
+			if (data_s)
+				{
+					return data_s;
+				}
+		}
+
+	fprintf (stderr, "Failed to read \"%s\"\n", filename_s);
+
+	return NULL;
+}
+
+
+static void PrintUsage (const char *program_s)
+{
+	fprintf (stderr, "Usage:\n");
+	fprintf (stderr, "  %s -to-binary <in.json> <out.ggar> [-provider <name>] [-timestamp <seconds>]\n", program_s);
+	fprintf (stderr, "  %s -to-json <in.ggar> <out.json> [-lines]\n", program_s);
+}
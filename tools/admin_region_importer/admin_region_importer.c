@@ -0,0 +1,2346 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * admin_region_importer.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * Build an AdminRegionIndex from the administrative boundaries in an
+ * OpenStreetMap PBF extract.
+ *
+ *   admin_region_importer [-threads <n>] [-tolerance <metres>] <in.osm.pbf> <out.ggab>
+ *
+ * The extract is memory-mapped and read in three passes, each of which
+ * shares the file's blocks between the threads:
+ *
+ *   1. the boundary=administrative relations with an admin_level from 2
+ *      to 8 and a name, and the ways that they use,
+ *   2. the nodes of those ways, along with any closed administrative ways
+ *      that aren't part of a relation,
+ *   3. the coordinates of those nodes.
+ *
+ * The ways of each region are then joined into rings which are simplified
+ * with the Douglas-Peucker algorithm before being saved.
+ */
+
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+#include "admin_regions.h"
+
+#include "memory_allocations.h"
+#include "string_utils.h"
+
+
+/* The default distance, in metres, that the simplified boundaries can be from the originals */
+#define ARI_DEFAULT_TOLERANCE (20.0)
+
+/* The size limits from the PBF specification */
+#define ARI_MAX_BLOB_HEADER_SIZE (64 * 1024)
+#define ARI_MAX_BLOB_SIZE (32 * 1024 * 1024)
+
+#define ARI_MAX_THREADS (64)
+
+#define ARI_METRES_PER_DEGREE (111319.49)
+
+#define ARI_DEGREES_TO_RADIANS (0.017453292519943295)
+
+/* The kinds of element in each block, which are found during the first pass */
+#define ARI_BLOB_NODES (1)
+#define ARI_BLOB_WAYS (2)
+#define ARI_BLOB_RELATIONS (4)
+
+/* The PBF wire types */
+#define ARI_WIRE_VARINT (0)
+#define ARI_WIRE_64_BIT (1)
+#define ARI_WIRE_LENGTH (2)
+#define ARI_WIRE_32_BIT (5)
+
+
+typedef enum ImportPass
+{
+	IP_RELATIONS,
+	IP_WAYS,
+	IP_NODES
+} ImportPass;
+
+
+typedef struct PBFReader
+{
+	const uint8 *pr_data_p;
+	const uint8 *pr_end_p;
+} PBFReader;
+
+
+typedef struct PBFString
+{
+	const char *ps_value_s;
+	size_t ps_length;
+} PBFString;
+
+
+typedef struct GrowableArray
+{
+	void *ga_items_p;
+	size_t ga_size;
+	size_t ga_capacity;
+	size_t ga_item_size;
+} GrowableArray;
+
+
+typedef struct Blob
+{
+	size_t bl_offset;
+	size_t bl_size;
+	uint8 bl_kinds;
+} Blob;
+
+
+/* A relation, or a closed way, that is the boundary of a region */
+typedef struct RegionRelation
+{
+	char *rr_name_s;
+	char rr_country_code_s [3];
+	uint32 rr_level;
+	size_t rr_first_member;
+	size_t rr_num_members;
+} RegionRelation;
+
+
+typedef struct RelationMember
+{
+	int64 rm_way_id;
+	bool rm_inner_flag;
+} RelationMember;
+
+
+typedef struct WayRecord
+{
+	int64 wr_id;
+	size_t wr_first_ref;
+	size_t wr_num_refs;
+} WayRecord;
+
+
+/* A way, or part of a ring, that is being joined into a ring */
+typedef struct RingSegment
+{
+	const int64 *rs_refs_p;
+	size_t rs_num_refs;
+	bool rs_used_flag;
+} RingSegment;
+
+
+typedef struct SegmentEnd
+{
+	int64 se_node_id;
+	size_t se_segment;
+} SegmentEnd;
+
+
+typedef struct AdminTags
+{
+	PBFString at_name;
+	PBFString at_country_code;
+	uint32 at_level;
+	bool at_boundary_flag;
+} AdminTags;
+
+
+typedef struct Importer
+{
+	const uint8 *im_data_p;
+	size_t im_size;
+
+	Blob *im_blobs_p;
+	size_t im_num_blobs;
+
+	uint32 im_num_threads;
+	double64 im_tolerance;
+
+	GrowableArray im_relations;
+	GrowableArray im_members;
+
+	int64 *im_way_ids_p;
+	size_t im_num_way_ids;
+
+	GrowableArray im_ways;
+	GrowableArray im_refs;
+
+	int64 *im_node_ids_p;
+	size_t im_num_node_ids;
+	FixedCoordinate *im_node_coords_p;
+	uint8 *im_node_found_p;
+} Importer;
+
+
+typedef struct ImportTask
+{
+	Importer *it_importer_p;
+	ImportPass it_pass;
+	uint32 it_index;
+
+	uint8 *it_buffer_p;
+	size_t it_buffer_size;
+
+	GrowableArray it_strings;
+	int64 it_granularity;
+	int64 it_lat_offset;
+	int64 it_lon_offset;
+
+	GrowableArray it_relations;
+	GrowableArray it_members;
+	GrowableArray it_ways;
+	GrowableArray it_refs;
+
+	size_t it_cursor;
+	bool it_success_flag;
+} ImportTask;
+
+
+static int ImportRegions (const char *in_s, const char *out_s, const uint32 num_threads, const double64 tolerance);
+
+static bool FindBlobs (Importer *importer_p);
+
+static bool RunPass (Importer *importer_p, ImportTask *tasks_p, const ImportPass pass);
+
+static void *RunImportTaskThread (void *data_p);
+
+static void RunImportTask (ImportTask *task_p);
+
+static bool ProcessBlob (ImportTask *task_p, Blob *blob_p);
+
+static bool ReadBlob (ImportTask *task_p, const Blob *blob_p, PBFReader *block_p);
+
+static bool ReadStringTable (ImportTask *task_p, PBFReader *table_p);
+
+static bool ProcessGroup (ImportTask *task_p, PBFReader *group_p, uint8 *kinds_p);
+
+static bool ProcessRelation (ImportTask *task_p, PBFReader *relation_p);
+
+static bool ProcessWay (ImportTask *task_p, PBFReader *way_p);
+
+static bool ProcessNode (ImportTask *task_p, PBFReader *node_p);
+
+static bool ProcessDenseNodes (ImportTask *task_p, PBFReader *dense_p);
+
+static void SetNodeCoordinate (ImportTask *task_p, const int64 id, const int64 raw_latitude, const int64 raw_longitude);
+
+static bool GetAdminTags (const ImportTask *task_p, PBFReader keys, PBFReader vals, AdminTags *tags_p);
+
+static bool AddRegionRelation (ImportTask *task_p, const AdminTags *tags_p, size_t first_member);
+
+static bool MergeTaskResults (Importer *importer_p, ImportTask *tasks_p, const ImportPass pass);
+
+static int64 *GetSortedIds (const int64 *ids_p, const size_t stride, const size_t num_ids, size_t *num_unique_ids_p);
+
+static size_t FindId (const int64 *ids_p, const size_t num_ids, const int64 id, size_t *cursor_p);
+
+static bool AssembleRegions (Importer *importer_p, GrowableArray *regions_p, GrowableArray *ring_lengths_p, GrowableArray *points_p);
+
+static bool AssembleRings (Importer *importer_p, const RegionRelation *relation_p, const bool inner_flag, GrowableArray *segments_p, GrowableArray *ends_p, GrowableArray *ring_p, GrowableArray *ring_lengths_p, GrowableArray *points_p, uint32 *num_rings_p);
+
+static bool AddRing (Importer *importer_p, const GrowableArray *ring_p, GrowableArray *ring_lengths_p, GrowableArray *points_p);
+
+static size_t SimplifyRing (FixedCoordinate *points_p, const size_t num_points, const double64 tolerance);
+
+static double64 GetDistanceToSegment (const double64 x, const double64 y, const double64 x0, const double64 y0, const double64 x1, const double64 y1);
+
+static bool ReadVarint (PBFReader *reader_p, uint64 *value_p);
+
+static bool ReadKey (PBFReader *reader_p, uint32 *field_p, uint32 *wire_type_p);
+
+static bool ReadLengthDelimited (PBFReader *reader_p, PBFReader *value_p);
+
+static bool SkipValue (PBFReader *reader_p, const uint32 wire_type);
+
+static int64 DecodeZigZag (const uint64 value);
+
+static bool IsPBFString (const PBFString *string_p, const char *value_s);
+
+static const PBFString *GetBlockString (const ImportTask *task_p, const uint64 index);
+
+static void InitGrowableArray (GrowableArray *array_p, const size_t item_size);
+
+static void *AddToGrowableArray (GrowableArray *array_p, const size_t num_items);
+
+static void ClearGrowableArray (GrowableArray *array_p);
+
+static int CompareIds (const void *v0_p, const void *v1_p);
+
+static int CompareWayRecords (const void *v0_p, const void *v1_p);
+
+static int CompareSegmentEnds (const void *v0_p, const void *v1_p);
+
+
+
+int main (int argc, char *argv [])
+{
+	uint32 num_threads = 0;
+	double64 tolerance = ARI_DEFAULT_TOLERANCE;
+	const char *in_s = NULL;
+	const char *out_s = NULL;
+	bool args_flag = true;
+	int i;
+
+	for (i = 1; (i < argc) && args_flag; ++ i)
+		{
+			if ((strcmp (argv [i], "-threads") == 0) && (i + 1 < argc))
+				{
+					num_threads = (uint32) strtoul (argv [++ i], NULL, 10);
+				}
+			else if ((strcmp (argv [i], "-tolerance") == 0) && (i + 1 < argc))
+				{
+					tolerance = strtod (argv [++ i], NULL);
+				}
+			else if (!in_s)
+				{
+					in_s = argv [i];
+				}
+			else if (!out_s)
+				{
+					out_s = argv [i];
+				}
+			else
+				{
+					args_flag = false;
+				}
+		}
+
+	if (args_flag && in_s && out_s)
+		{
+			if (num_threads == 0)
+				{
+					const long num_processors = sysconf (_SC_NPROCESSORS_ONLN);
+
+					num_threads = (num_processors > 0) ? (uint32) num_processors : 1;
+				}
+
+			if (num_threads > ARI_MAX_THREADS)
+				{
+					num_threads = ARI_MAX_THREADS;
+				}
+
+			return ImportRegions (in_s, out_s, num_threads, tolerance);
+		}
+
+	fprintf (stderr, "Usage:\n");
+	fprintf (stderr, "  %s [-threads <n>] [-tolerance <metres>] <in.osm.pbf> <out.ggab>\n", argv [0]);
+	fprintf (stderr, "\n");
+	fprintf (stderr, "  -threads     the number of threads to use, defaulting to one per processor\n");
+	fprintf (stderr, "  -tolerance   how far the simplified boundaries can be from the originals, defaulting to %g metres\n", ARI_DEFAULT_TOLERANCE);
+
+	return 1;
+}
+
+
+static int ImportRegions (const char *in_s, const char *out_s, const uint32 num_threads, const double64 tolerance)
+{
+	int res = 1;
+	int fd = open (in_s, O_RDONLY);
+
+	if (fd != -1)
+		{
+			struct stat st;
+
+			if (fstat (fd, &st) == 0)
+				{
+					void *map_p = (st.st_size > 0) ? mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+
+					if (map_p != MAP_FAILED)
+						{
+							Importer importer;
+							ImportTask *tasks_p = (ImportTask *) AllocMemoryArray (num_threads, sizeof (ImportTask));
+
+							memset (&importer, 0, sizeof (Importer));
+							importer.im_data_p = (const uint8 *) map_p;
+							importer.im_size = (size_t) st.st_size;
+							importer.im_num_threads = num_threads;
+							importer.im_tolerance = tolerance;
+
+							InitGrowableArray (& (importer.im_relations), sizeof (RegionRelation));
+							InitGrowableArray (& (importer.im_members), sizeof (RelationMember));
+							InitGrowableArray (& (importer.im_ways), sizeof (WayRecord));
+							InitGrowableArray (& (importer.im_refs), sizeof (int64));
+
+							/* each pass reads the file from start to end */
+							madvise (map_p, importer.im_size, MADV_SEQUENTIAL);
+
+							if (tasks_p && FindBlobs (&importer))
+								{
+									uint32 i;
+
+									for (i = 0; i < num_threads; ++ i)
+										{
+											ImportTask *task_p = tasks_p + i;
+
+											task_p -> it_importer_p = &importer;
+											task_p -> it_index = i;
+
+											InitGrowableArray (& (task_p -> it_strings), sizeof (PBFString));
+											InitGrowableArray (& (task_p -> it_relations), sizeof (RegionRelation));
+											InitGrowableArray (& (task_p -> it_members), sizeof (RelationMember));
+											InitGrowableArray (& (task_p -> it_ways), sizeof (WayRecord));
+											InitGrowableArray (& (task_p -> it_refs), sizeof (int64));
+										}
+
+									if (RunPass (&importer, tasks_p, IP_RELATIONS) && RunPass (&importer, tasks_p, IP_WAYS) && RunPass (&importer, tasks_p, IP_NODES))
+										{
+											GrowableArray regions;
+											GrowableArray ring_lengths;
+											GrowableArray points;
+
+											InitGrowableArray (&regions, sizeof (AdminRegionData));
+											InitGrowableArray (&ring_lengths, sizeof (uint32));
+											InitGrowableArray (&points, sizeof (FixedCoordinate));
+
+											if (AssembleRegions (&importer, &regions, &ring_lengths, &points))
+												{
+													if (SaveAdminRegionIndex (out_s, (const AdminRegionData *) regions.ga_items_p, regions.ga_size))
+														{
+															printf ("Saved " SIZET_FMT " of " SIZET_FMT " regions with " SIZET_FMT " points to \"%s\"\n", regions.ga_size, importer.im_relations.ga_size, points.ga_size, out_s);
+															res = 0;
+														}
+												}
+											else
+												{
+													fprintf (stderr, "Failed to build the regions\n");
+												}
+
+											ClearGrowableArray (&points);
+											ClearGrowableArray (&ring_lengths);
+											ClearGrowableArray (&regions);
+										}
+
+									for (i = 0; i < num_threads; ++ i)
+										{
+											ImportTask *task_p = tasks_p + i;
+
+											if (task_p -> it_buffer_p)
+												{
+													FreeMemory (task_p -> it_buffer_p);
+												}
+
+											ClearGrowableArray (& (task_p -> it_strings));
+											ClearGrowableArray (& (task_p -> it_relations));
+											ClearGrowableArray (& (task_p -> it_members));
+											ClearGrowableArray (& (task_p -> it_ways));
+											ClearGrowableArray (& (task_p -> it_refs));
+										}
+								}
+
+							if (importer.im_relations.ga_items_p)
+								{
+									RegionRelation *relation_p = (RegionRelation *) importer.im_relations.ga_items_p;
+									size_t j;
+
+									for (j = 0; j < importer.im_relations.ga_size; ++ j, ++ relation_p)
+										{
+											FreeCopiedString (relation_p -> rr_name_s);
+										}
+								}
+
+							ClearGrowableArray (& (importer.im_relations));
+							ClearGrowableArray (& (importer.im_members));
+							ClearGrowableArray (& (importer.im_ways));
+							ClearGrowableArray (& (importer.im_refs));
+
+							if (importer.im_way_ids_p)
+								{
+									FreeMemory (importer.im_way_ids_p);
+								}
+
+							if (importer.im_node_ids_p)
+								{
+									FreeMemory (importer.im_node_ids_p);
+								}
+
+							if (importer.im_node_coords_p)
+								{
+									FreeMemory (importer.im_node_coords_p);
+								}
+
+							if (importer.im_node_found_p)
+								{
+									FreeMemory (importer.im_node_found_p);
+								}
+
+							if (importer.im_blobs_p)
+								{
+									FreeMemory (importer.im_blobs_p);
+								}
+
+							if (tasks_p)
+								{
+									FreeMemory (tasks_p);
+								}
+
+							munmap (map_p, importer.im_size);
+						}
+					else
+						{
+							fprintf (stderr, "Failed to map \"%s\"\n", in_s);
+						}
+				}
+
+			close (fd);
+		}
+	else
+		{
+			fprintf (stderr, "Failed to open \"%s\"\n", in_s);
+		}
+
+	return res;
+}
+
+
+/*
+ * The file is a sequence of a 4 byte big-endian length, a BlobHeader of
+ * that length and then the Blob whose size is given in the BlobHeader.
+ */
+static bool FindBlobs (Importer *importer_p)
+{
+	GrowableArray blobs;
+	size_t offset = 0;
+	bool success_flag = true;
+
+	InitGrowableArray (&blobs, sizeof (Blob));
+
+	while ((offset < importer_p -> im_size) && success_flag)
+		{
+			const uint8 *data_p = importer_p -> im_data_p + offset;
+			size_t header_size;
+
+			success_flag = false;
+
+			if (importer_p -> im_size - offset >= 4)
+				{
+					header_size = ((size_t) data_p [0] << 24) | ((size_t) data_p [1] << 16) | ((size_t) data_p [2] << 8) | (size_t) data_p [3];
+
+					if ((header_size <= ARI_MAX_BLOB_HEADER_SIZE) && (header_size <= importer_p -> im_size - offset - 4))
+						{
+							PBFReader header;
+							PBFString type;
+							uint64 blob_size = 0;
+							bool header_flag = true;
+
+							header.pr_data_p = data_p + 4;
+							header.pr_end_p = header.pr_data_p + header_size;
+
+							memset (&type, 0, sizeof (PBFString));
+
+							while ((header.pr_data_p < header.pr_end_p) && header_flag)
+								{
+									uint32 field;
+									uint32 wire_type;
+
+									header_flag = ReadKey (&header, &field, &wire_type);
+
+									if (header_flag)
+										{
+											if ((field == 1) && (wire_type == ARI_WIRE_LENGTH))
+												{
+													PBFReader value;
+
+													if ((header_flag = ReadLengthDelimited (&header, &value)) == true)
+														{
+															type.ps_value_s = (const char *) value.pr_data_p;
+															type.ps_length = (size_t) (value.pr_end_p - value.pr_data_p);
+														}
+												}
+											else if ((field == 3) && (wire_type == ARI_WIRE_VARINT))
+												{
+													header_flag = ReadVarint (&header, &blob_size);
+												}
+											else
+												{
+													header_flag = SkipValue (&header, wire_type);
+												}
+										}
+								}
+
+							offset += 4 + header_size;
+
+							if (header_flag && (blob_size <= ARI_MAX_BLOB_SIZE) && (blob_size <= importer_p -> im_size - offset))
+								{
+									success_flag = true;
+
+									if (IsPBFString (&type, "OSMData"))
+										{
+											Blob *blob_p = (Blob *) AddToGrowableArray (&blobs, 1);
+
+											if (blob_p)
+												{
+													blob_p -> bl_offset = offset;
+													blob_p -> bl_size = (size_t) blob_size;
+													blob_p -> bl_kinds = 0;
+												}
+											else
+												{
+													success_flag = false;
+												}
+										}
+
+									offset += (size_t) blob_size;
+								}
+						}
+				}
+		}
+
+	if (success_flag)
+		{
+			importer_p -> im_blobs_p = (Blob *) blobs.ga_items_p;
+			importer_p -> im_num_blobs = blobs.ga_size;
+		}
+	else
+		{
+			fprintf (stderr, "The file is not a valid PBF file at byte " SIZET_FMT "\n", offset);
+			ClearGrowableArray (&blobs);
+		}
+
+	return success_flag;
+}
+
+
+static bool RunPass (Importer *importer_p, ImportTask *tasks_p, const ImportPass pass)
+{
+	pthread_t threads [ARI_MAX_THREADS];
+	bool started [ARI_MAX_THREADS];
+	bool success_flag = true;
+	uint32 i;
+
+	for (i = 0; i < importer_p -> im_num_threads; ++ i)
+		{
+			tasks_p [i].it_pass = pass;
+			tasks_p [i].it_success_flag = true;
+			tasks_p [i].it_cursor = 0;
+		}
+
+	/* The first task runs on this thread */
+	for (i = 1; i < importer_p -> im_num_threads; ++ i)
+		{
+			started [i] = (pthread_create (threads + i, NULL, RunImportTaskThread, tasks_p + i) == 0);
+		}
+
+	RunImportTask (tasks_p);
+
+	for (i = 1; i < importer_p -> im_num_threads; ++ i)
+		{
+			if (started [i])
+				{
+					pthread_join (threads [i], NULL);
+				}
+			else
+				{
+					RunImportTask (tasks_p + i);
+				}
+		}
+
+	for (i = 0; i < importer_p -> im_num_threads; ++ i)
+		{
+			if (! (tasks_p [i].it_success_flag))
+				{
+					success_flag = false;
+				}
+		}
+
+	if (success_flag)
+		{
+			success_flag = MergeTaskResults (importer_p, tasks_p, pass);
+		}
+	else
+		{
+			fprintf (stderr, "Failed to read the file\n");
+		}
+
+	return success_flag;
+}
+
+
+static void *RunImportTaskThread (void *data_p)
+{
+	RunImportTask ((ImportTask *) data_p);
+
+	return NULL;
+}
+
+
+/* Each task takes every n-th block so that each gets a similar mix of nodes, ways and relations */
+static void RunImportTask (ImportTask *task_p)
+{
+	Importer *importer_p = task_p -> it_importer_p;
+	size_t i;
+
+	for (i = task_p -> it_index; (i < importer_p -> im_num_blobs) && (task_p -> it_success_flag); i += importer_p -> im_num_threads)
+		{
+			Blob *blob_p = importer_p -> im_blobs_p + i;
+			bool needed_flag = true;
+
+			if (task_p -> it_pass == IP_WAYS)
+				{
+					needed_flag = ((blob_p -> bl_kinds & ARI_BLOB_WAYS) != 0);
+				}
+			else if (task_p -> it_pass == IP_NODES)
+				{
+					needed_flag = ((blob_p -> bl_kinds & ARI_BLOB_NODES) != 0);
+				}
+
+			if (needed_flag)
+				{
+					task_p -> it_success_flag = ProcessBlob (task_p, blob_p);
+				}
+		}
+}
+
+
+static bool ProcessBlob (ImportTask *task_p, Blob *blob_p)
+{
+	PBFReader block;
+	bool success_flag = ReadBlob (task_p, blob_p, &block);
+
+	if (success_flag)
+		{
+			PBFReader reader = block;
+			uint8 kinds = 0;
+
+			task_p -> it_strings.ga_size = 0;
+			task_p -> it_granularity = 100;
+			task_p -> it_lat_offset = 0;
+			task_p -> it_lon_offset = 0;
+
+			/* The string table and the coordinate settings can come after the groups that use them */
+			while ((reader.pr_data_p < reader.pr_end_p) && success_flag)
+				{
+					uint32 field;
+					uint32 wire_type;
+
+					if ((success_flag = ReadKey (&reader, &field, &wire_type)) == true)
+						{
+							if ((field == 1) && (wire_type == ARI_WIRE_LENGTH))
+								{
+									PBFReader table;
+
+									success_flag = ReadLengthDelimited (&reader, &table) && ReadStringTable (task_p, &table);
+								}
+							else if (((field == 17) || (field == 19) || (field == 20)) && (wire_type == ARI_WIRE_VARINT))
+								{
+									uint64 value;
+
+									if ((success_flag = ReadVarint (&reader, &value)) == true)
+										{
+											if (field == 17)
+												{
+													task_p -> it_granularity = (int64) value;
+												}
+											else if (field == 19)
+												{
+													task_p -> it_lat_offset = (int64) value;
+												}
+											else
+												{
+													task_p -> it_lon_offset = (int64) value;
+												}
+										}
+								}
+							else
+								{
+									success_flag = SkipValue (&reader, wire_type);
+								}
+						}
+				}
+
+			reader = block;
+
+			while ((reader.pr_data_p < reader.pr_end_p) && success_flag)
+				{
+					uint32 field;
+					uint32 wire_type;
+
+					if ((success_flag = ReadKey (&reader, &field, &wire_type)) == true)
+						{
+							if ((field == 2) && (wire_type == ARI_WIRE_LENGTH))
+								{
+									PBFReader group;
+
+									success_flag = ReadLengthDelimited (&reader, &group) && ProcessGroup (task_p, &group, &kinds);
+								}
+							else
+								{
+									success_flag = SkipValue (&reader, wire_type);
+								}
+						}
+				}
+
+			if (task_p -> it_pass == IP_RELATIONS)
+				{
+					blob_p -> bl_kinds = kinds;
+				}
+		}
+
+	return success_flag;
+}
+
+
+static bool ReadBlob (ImportTask *task_p, const Blob *blob_p, PBFReader *block_p)
+{
+	PBFReader reader;
+	PBFReader raw;
+	PBFReader zlib_data;
+	uint64 raw_size = 0;
+	bool success_flag = true;
+
+	reader.pr_data_p = task_p -> it_importer_p -> im_data_p + blob_p -> bl_offset;
+	reader.pr_end_p = reader.pr_data_p + blob_p -> bl_size;
+
+	raw.pr_data_p = NULL;
+	zlib_data.pr_data_p = NULL;
+
+	while ((reader.pr_data_p < reader.pr_end_p) && success_flag)
+		{
+			uint32 field;
+			uint32 wire_type;
+
+			if ((success_flag = ReadKey (&reader, &field, &wire_type)) == true)
+				{
+					if ((field == 1) && (wire_type == ARI_WIRE_LENGTH))
+						{
+							success_flag = ReadLengthDelimited (&reader, &raw);
+						}
+					else if ((field == 2) && (wire_type == ARI_WIRE_VARINT))
+						{
+							success_flag = ReadVarint (&reader, &raw_size);
+						}
+					else if ((field == 3) && (wire_type == ARI_WIRE_LENGTH))
+						{
+							success_flag = ReadLengthDelimited (&reader, &zlib_data);
+						}
+					else
+						{
+							success_flag = SkipValue (&reader, wire_type);
+						}
+				}
+		}
+
+	if (success_flag)
+		{
+			success_flag = false;
+
+			if (raw.pr_data_p)
+				{
+					*block_p = raw;
+					success_flag = true;
+				}
+			else if (zlib_data.pr_data_p && (raw_size <= ARI_MAX_BLOB_SIZE))
+				{
+					uLongf size = (uLongf) raw_size;
+
+					/* Each task keeps its buffer for the next block */
+					if (task_p -> it_buffer_size < raw_size)
+						{
+							if (task_p -> it_buffer_p)
+								{
+									FreeMemory (task_p -> it_buffer_p);
+								}
+
+							task_p -> it_buffer_p = (uint8 *) AllocMemory ((size_t) raw_size);
+							task_p -> it_buffer_size = task_p -> it_buffer_p ? (size_t) raw_size : 0;
+						}
+
+					if ((raw_size == 0) || task_p -> it_buffer_p)
+						{
+							if (uncompress (task_p -> it_buffer_p, &size, zlib_data.pr_data_p, (uLong) (zlib_data.pr_end_p - zlib_data.pr_data_p)) == Z_OK)
+								{
+									block_p -> pr_data_p = task_p -> it_buffer_p;
+									block_p -> pr_end_p = task_p -> it_buffer_p + size;
+									success_flag = true;
+								}
+						}
+				}
+			else
+				{
+					fprintf (stderr, "Unsupported compression for the block at byte " SIZET_FMT "\n", blob_p -> bl_offset);
+				}
+		}
+
+	return success_flag;
+}
+
+
+static bool ReadStringTable (ImportTask *task_p, PBFReader *table_p)
+{
+	bool success_flag = true;
+
+	while ((table_p -> pr_data_p < table_p -> pr_end_p) && success_flag)
+		{
+			uint32 field;
+			uint32 wire_type;
+
+			if ((success_flag = ReadKey (table_p, &field, &wire_type)) == true)
+				{
+					if ((field == 1) && (wire_type == ARI_WIRE_LENGTH))
+						{
+							PBFReader value;
+
+							if ((success_flag = ReadLengthDelimited (table_p, &value)) == true)
+								{
+									PBFString *string_p = (PBFString *) AddToGrowableArray (& (task_p -> it_strings), 1);
+
+									if (string_p)
+										{
+											string_p -> ps_value_s = (const char *) value.pr_data_p;
+											string_p -> ps_length = (size_t) (value.pr_end_p - value.pr_data_p);
+										}
+									else
+										{
+											success_flag = false;
+										}
+								}
+						}
+					else
+						{
+							success_flag = SkipValue (table_p, wire_type);
+						}
+				}
+		}
+
+	return success_flag;
+}
+
+
+static bool ProcessGroup (ImportTask *task_p, PBFReader *group_p, uint8 *kinds_p)
+{
+	bool success_flag = true;
+
+	while ((group_p -> pr_data_p < group_p -> pr_end_p) && success_flag)
+		{
+			uint32 field;
+			uint32 wire_type;
+
+			if ((success_flag = ReadKey (group_p, &field, &wire_type)) == true)
+				{
+					PBFReader value;
+
+					if ((wire_type == ARI_WIRE_LENGTH) && (field >= 1) && (field <= 4))
+						{
+							if ((success_flag = ReadLengthDelimited (group_p, &value)) == true)
+								{
+									switch (field)
+										{
+											case 1:
+												*kinds_p |= ARI_BLOB_NODES;
+
+												if (task_p -> it_pass == IP_NODES)
+													{
+														success_flag = ProcessNode (task_p, &value);
+													}
+												break;
+
+											case 2:
+												*kinds_p |= ARI_BLOB_NODES;
+
+												if (task_p -> it_pass == IP_NODES)
+													{
+														success_flag = ProcessDenseNodes (task_p, &value);
+													}
+												break;
+
+											case 3:
+												*kinds_p |= ARI_BLOB_WAYS;
+
+												if (task_p -> it_pass == IP_WAYS)
+													{
+														success_flag = ProcessWay (task_p, &value);
+													}
+												break;
+
+											case 4:
+												*kinds_p |= ARI_BLOB_RELATIONS;
+
+												if (task_p -> it_pass == IP_RELATIONS)
+													{
+														success_flag = ProcessRelation (task_p, &value);
+													}
+												break;
+
+											default:
+												break;
+										}
+								}
+						}
+					else
+						{
+							success_flag = SkipValue (group_p, wire_type);
+						}
+				}
+		}
+
+	return success_flag;
+}
+
+
+static bool ProcessRelation (ImportTask *task_p, PBFReader *relation_p)
+{
+	PBFReader keys;
+	PBFReader vals;
+	PBFReader roles;
+	PBFReader member_ids;
+	PBFReader types;
+	bool success_flag = true;
+
+	memset (&keys, 0, sizeof (PBFReader));
+	memset (&vals, 0, sizeof (PBFReader));
+	memset (&roles, 0, sizeof (PBFReader));
+	memset (&member_ids, 0, sizeof (PBFReader));
+	memset (&types, 0, sizeof (PBFReader));
+
+	while ((relation_p -> pr_data_p < relation_p -> pr_end_p) && success_flag)
+		{
+			uint32 field;
+			uint32 wire_type;
+
+			if ((success_flag = ReadKey (relation_p, &field, &wire_type)) == true)
+				{
+					if (wire_type == ARI_WIRE_LENGTH)
+						{
+							PBFReader value;
+
+							if ((success_flag = ReadLengthDelimited (relation_p, &value)) == true)
+								{
+									switch (field)
+										{
+											case 2:
+												keys = value;
+												break;
+
+											case 3:
+												vals = value;
+												break;
+
+											case 8:
+												roles = value;
+												break;
+
+											case 9:
+												member_ids = value;
+												break;
+
+											case 10:
+												types = value;
+												break;
+
+											default:
+												break;
+										}
+								}
+						}
+					else
+						{
+							success_flag = SkipValue (relation_p, wire_type);
+						}
+				}
+		}
+
+	if (success_flag)
+		{
+			AdminTags tags;
+
+			if (GetAdminTags (task_p, keys, vals, &tags))
+				{
+					const size_t first_member = task_p -> it_members.ga_size;
+					int64 member_id = 0;
+
+					while ((member_ids.pr_data_p < member_ids.pr_end_p) && success_flag)
+						{
+							uint64 role;
+							uint64 delta;
+							uint64 type;
+
+							if (ReadVarint (&roles, &role) && ReadVarint (&member_ids, &delta) && ReadVarint (&types, &type))
+								{
+									member_id += DecodeZigZag (delta);
+
+									/* Only ways are used, so any subareas or admin centres are skipped */
+									if (type == 1)
+										{
+											const PBFString *role_p = GetBlockString (task_p, role);
+											const bool inner_flag = (role_p && IsPBFString (role_p, "inner"));
+
+											if (inner_flag || (!role_p) || (role_p -> ps_length == 0) || IsPBFString (role_p, "outer"))
+												{
+													RelationMember *member_p = (RelationMember *) AddToGrowableArray (& (task_p -> it_members), 1);
+
+													if (member_p)
+														{
+															member_p -> rm_way_id = member_id;
+															member_p -> rm_inner_flag = inner_flag;
+														}
+													else
+														{
+															success_flag = false;
+														}
+												}
+										}
+								}
+							else
+								{
+									success_flag = false;
+								}
+						}
+
+					if (success_flag && (task_p -> it_members.ga_size > first_member))
+						{
+							success_flag = AddRegionRelation (task_p, &tags, first_member);
+						}
+				}
+		}
+
+	return success_flag;
+}
+
+
+static bool ProcessWay (ImportTask *task_p, PBFReader *way_p)
+{
+	PBFReader keys;
+	PBFReader vals;
+	PBFReader refs;
+	uint64 id = 0;
+	bool success_flag = true;
+
+	memset (&keys, 0, sizeof (PBFReader));
+	memset (&vals, 0, sizeof (PBFReader));
+	memset (&refs, 0, sizeof (PBFReader));
+
+	while ((way_p -> pr_data_p < way_p -> pr_end_p) && success_flag)
+		{
+			uint32 field;
+			uint32 wire_type;
+
+			if ((success_flag = ReadKey (way_p, &field, &wire_type)) == true)
+				{
+					if ((field == 1) && (wire_type == ARI_WIRE_VARINT))
+						{
+							success_flag = ReadVarint (way_p, &id);
+						}
+					else if ((wire_type == ARI_WIRE_LENGTH) && ((field == 2) || (field == 3) || (field == 8)))
+						{
+							PBFReader value;
+
+							if ((success_flag = ReadLengthDelimited (way_p, &value)) == true)
+								{
+									if (field == 2)
+										{
+											keys = value;
+										}
+									else if (field == 3)
+										{
+											vals = value;
+										}
+									else
+										{
+											refs = value;
+										}
+								}
+						}
+					else
+						{
+							success_flag = SkipValue (way_p, wire_type);
+						}
+				}
+		}
+
+	if (success_flag)
+		{
+			const Importer *importer_p = task_p -> it_importer_p;
+			const bool member_flag = (FindId (importer_p -> im_way_ids_p, importer_p -> im_num_way_ids, (int64) id, & (task_p -> it_cursor)) < importer_p -> im_num_way_ids);
+			AdminTags tags;
+
+			/* Closed ways can be regions on their own if they aren't already part of one */
+			if (member_flag || GetAdminTags (task_p, keys, vals, &tags))
+				{
+					const size_t first_ref = task_p -> it_refs.ga_size;
+					int64 ref = 0;
+
+					while ((refs.pr_data_p < refs.pr_end_p) && success_flag)
+						{
+							uint64 delta;
+
+							if ((success_flag = ReadVarint (&refs, &delta)) == true)
+								{
+									int64 *ref_p = (int64 *) AddToGrowableArray (& (task_p -> it_refs), 1);
+
+									if (ref_p)
+										{
+											ref += DecodeZigZag (delta);
+											*ref_p = ref;
+										}
+									else
+										{
+											success_flag = false;
+										}
+								}
+						}
+
+					if (success_flag)
+						{
+							const size_t num_refs = task_p -> it_refs.ga_size - first_ref;
+							const int64 *refs_p = ((const int64 *) task_p -> it_refs.ga_items_p) + first_ref;
+							bool keep_flag = member_flag;
+
+							if ((!member_flag) && (num_refs >= 4) && (refs_p [0] == refs_p [num_refs - 1]))
+								{
+									RelationMember *member_p = (RelationMember *) AddToGrowableArray (& (task_p -> it_members), 1);
+
+									if (member_p)
+										{
+											member_p -> rm_way_id = (int64) id;
+											member_p -> rm_inner_flag = false;
+
+											success_flag = AddRegionRelation (task_p, &tags, task_p -> it_members.ga_size - 1);
+											keep_flag = true;
+										}
+									else
+										{
+											success_flag = false;
+										}
+								}
+
+							if (keep_flag && success_flag)
+								{
+									WayRecord *way_record_p = (WayRecord *) AddToGrowableArray (& (task_p -> it_ways), 1);
+
+									if (way_record_p)
+										{
+											way_record_p -> wr_id = (int64) id;
+											way_record_p -> wr_first_ref = first_ref;
+											way_record_p -> wr_num_refs = num_refs;
+										}
+									else
+										{
+											success_flag = false;
+										}
+								}
+							else
+								{
+									task_p -> it_refs.ga_size = first_ref;
+								}
+						}
+				}
+		}
+
+	return success_flag;
+}
+
+
+static bool ProcessNode (ImportTask *task_p, PBFReader *node_p)
+{
+	uint64 id = 0;
+	uint64 latitude = 0;
+	uint64 longitude = 0;
+	bool success_flag = true;
+
+	while ((node_p -> pr_data_p < node_p -> pr_end_p) && success_flag)
+		{
+			uint32 field;
+			uint32 wire_type;
+
+			if ((success_flag = ReadKey (node_p, &field, &wire_type)) == true)
+				{
+					if (wire_type == ARI_WIRE_VARINT)
+						{
+							if (field == 1)
+								{
+									success_flag = ReadVarint (node_p, &id);
+								}
+							else if (field == 8)
+								{
+									success_flag = ReadVarint (node_p, &latitude);
+								}
+							else if (field == 9)
+								{
+									success_flag = ReadVarint (node_p, &longitude);
+								}
+							else
+								{
+									success_flag = SkipValue (node_p, wire_type);
+								}
+						}
+					else
+						{
+							success_flag = SkipValue (node_p, wire_type);
+						}
+				}
+		}
+
+	if (success_flag)
+		{
+			SetNodeCoordinate (task_p, DecodeZigZag (id), DecodeZigZag (latitude), DecodeZigZag (longitude));
+		}
+
+	return success_flag;
+}
+
+
+static bool ProcessDenseNodes (ImportTask *task_p, PBFReader *dense_p)
+{
+	PBFReader ids;
+	PBFReader latitudes;
+	PBFReader longitudes;
+	bool success_flag = true;
+
+	memset (&ids, 0, sizeof (PBFReader));
+	memset (&latitudes, 0, sizeof (PBFReader));
+	memset (&longitudes, 0, sizeof (PBFReader));
+
+	while ((dense_p -> pr_data_p < dense_p -> pr_end_p) && success_flag)
+		{
+			uint32 field;
+			uint32 wire_type;
+
+			if ((success_flag = ReadKey (dense_p, &field, &wire_type)) == true)
+				{
+					if ((wire_type == ARI_WIRE_LENGTH) && ((field == 1) || (field == 8) || (field == 9)))
+						{
+							PBFReader value;
+
+							if ((success_flag = ReadLengthDelimited (dense_p, &value)) == true)
+								{
+									if (field == 1)
+										{
+											ids = value;
+										}
+									else if (field == 8)
+										{
+											latitudes = value;
+										}
+									else
+										{
+											longitudes = value;
+										}
+								}
+						}
+					else
+						{
+							success_flag = SkipValue (dense_p, wire_type);
+						}
+				}
+		}
+
+	if (success_flag)
+		{
+			int64 id = 0;
+			int64 latitude = 0;
+			int64 longitude = 0;
+
+			while ((ids.pr_data_p < ids.pr_end_p) && success_flag)
+				{
+					uint64 id_delta;
+					uint64 latitude_delta;
+					uint64 longitude_delta;
+
+					if (ReadVarint (&ids, &id_delta) && ReadVarint (&latitudes, &latitude_delta) && ReadVarint (&longitudes, &longitude_delta))
+						{
+							id += DecodeZigZag (id_delta);
+							latitude += DecodeZigZag (latitude_delta);
+							longitude += DecodeZigZag (longitude_delta);
+
+							SetNodeCoordinate (task_p, id, latitude, longitude);
+						}
+					else
+						{
+							success_flag = false;
+						}
+				}
+		}
+
+	return success_flag;
+}
+
+
+/* Each node is only in one block, so the tasks never write to the same place */
+static void SetNodeCoordinate (ImportTask *task_p, const int64 id, const int64 raw_latitude, const int64 raw_longitude)
+{
+	Importer *importer_p = task_p -> it_importer_p;
+	const size_t i = FindId (importer_p -> im_node_ids_p, importer_p -> im_num_node_ids, id, & (task_p -> it_cursor));
+
+	if (i < importer_p -> im_num_node_ids)
+		{
+			/* The PBF values are in nanodegrees */
+			importer_p -> im_node_coords_p [i].fc_latitude = (int32) ((task_p -> it_lat_offset + task_p -> it_granularity * raw_latitude) / 100);
+			importer_p -> im_node_coords_p [i].fc_longitude = (int32) ((task_p -> it_lon_offset + task_p -> it_granularity * raw_longitude) / 100);
+			importer_p -> im_node_found_p [i] = 1;
+		}
+}
+
+
+static bool GetAdminTags (const ImportTask *task_p, PBFReader keys, PBFReader vals, AdminTags *tags_p)
+{
+	memset (tags_p, 0, sizeof (AdminTags));
+
+	while (keys.pr_data_p < keys.pr_end_p)
+		{
+			uint64 key_index;
+			uint64 value_index;
+
+			if (ReadVarint (&keys, &key_index) && ReadVarint (&vals, &value_index))
+				{
+					const PBFString *key_p = GetBlockString (task_p, key_index);
+					const PBFString *value_p = GetBlockString (task_p, value_index);
+
+					if (key_p && value_p)
+						{
+							if (IsPBFString (key_p, "boundary"))
+								{
+									tags_p -> at_boundary_flag = IsPBFString (value_p, "administrative");
+								}
+							else if (IsPBFString (key_p, "admin_level"))
+								{
+									if ((value_p -> ps_length == 1) && (* (value_p -> ps_value_s) >= '0') && (* (value_p -> ps_value_s) <= '9'))
+										{
+											tags_p -> at_level = (uint32) (* (value_p -> ps_value_s) - '0');
+										}
+								}
+							else if (IsPBFString (key_p, "name"))
+								{
+									tags_p -> at_name = *value_p;
+								}
+							else if (IsPBFString (key_p, "ISO3166-1:alpha2") || ((tags_p -> at_country_code.ps_length == 0) && IsPBFString (key_p, "ISO3166-1")))
+								{
+									if (value_p -> ps_length == 2)
+										{
+											tags_p -> at_country_code = *value_p;
+										}
+								}
+						}
+				}
+			else
+				{
+					return false;
+				}
+		}
+
+	return ((tags_p -> at_boundary_flag) && (tags_p -> at_level >= ADMIN_REGION_MIN_LEVEL) && (tags_p -> at_level <= ADMIN_REGION_MAX_LEVEL) && (tags_p -> at_name.ps_length > 0));
+}
+
+
+static bool AddRegionRelation (ImportTask *task_p, const AdminTags *tags_p, size_t first_member)
+{
+	RegionRelation *relation_p = (RegionRelation *) AddToGrowableArray (& (task_p -> it_relations), 1);
+
+	if (relation_p)
+		{
+			relation_p -> rr_name_s = CopyToNewString (tags_p -> at_name.ps_value_s, tags_p -> at_name.ps_length, false);
+
+			if (relation_p -> rr_name_s)
+				{
+					memset (relation_p -> rr_country_code_s, 0, sizeof (relation_p -> rr_country_code_s));
+
+					if (tags_p -> at_country_code.ps_length == 2)
+						{
+							memcpy (relation_p -> rr_country_code_s, tags_p -> at_country_code.ps_value_s, 2);
+						}
+
+					relation_p -> rr_level = tags_p -> at_level;
+					relation_p -> rr_first_member = first_member;
+					relation_p -> rr_num_members = task_p -> it_members.ga_size - first_member;
+
+					return true;
+				}
+
+			-- (task_p -> it_relations.ga_size);
+		}
+
+	return false;
+}
+
+
+/*
+ * Gather each task's results, adjusting the offsets into their members
+ * and refs, and then work out the ids needed by the next pass.
+ */
+static bool MergeTaskResults (Importer *importer_p, ImportTask *tasks_p, const ImportPass pass)
+{
+	uint32 i;
+
+	if (pass == IP_NODES)
+		{
+			return true;
+		}
+
+	for (i = 0; i < importer_p -> im_num_threads; ++ i)
+		{
+			ImportTask *task_p = tasks_p + i;
+			const size_t members_base = importer_p -> im_members.ga_size;
+			const size_t refs_base = importer_p -> im_refs.ga_size;
+			RegionRelation *relations_p = (RegionRelation *) AddToGrowableArray (& (importer_p -> im_relations), task_p -> it_relations.ga_size);
+			RelationMember *members_p = (RelationMember *) AddToGrowableArray (& (importer_p -> im_members), task_p -> it_members.ga_size);
+			WayRecord *ways_p = (WayRecord *) AddToGrowableArray (& (importer_p -> im_ways), task_p -> it_ways.ga_size);
+			int64 *refs_p = (int64 *) AddToGrowableArray (& (importer_p -> im_refs), task_p -> it_refs.ga_size);
+			size_t j;
+
+			if ((relations_p || (task_p -> it_relations.ga_size == 0)) && (members_p || (task_p -> it_members.ga_size == 0)) &&
+				(ways_p || (task_p -> it_ways.ga_size == 0)) && (refs_p || (task_p -> it_refs.ga_size == 0)))
+				{
+					const RegionRelation *task_relations_p = (const RegionRelation *) task_p -> it_relations.ga_items_p;
+					const WayRecord *task_ways_p = (const WayRecord *) task_p -> it_ways.ga_items_p;
+
+					for (j = 0; j < task_p -> it_relations.ga_size; ++ j)
+						{
+							relations_p [j] = task_relations_p [j];
+							relations_p [j].rr_first_member += members_base;
+						}
+
+					for (j = 0; j < task_p -> it_ways.ga_size; ++ j)
+						{
+							ways_p [j] = task_ways_p [j];
+							ways_p [j].wr_first_ref += refs_base;
+						}
+
+					if (task_p -> it_members.ga_size > 0)
+						{
+							memcpy (members_p, task_p -> it_members.ga_items_p, task_p -> it_members.ga_size * sizeof (RelationMember));
+						}
+
+					if (task_p -> it_refs.ga_size > 0)
+						{
+							memcpy (refs_p, task_p -> it_refs.ga_items_p, task_p -> it_refs.ga_size * sizeof (int64));
+						}
+
+					/* The names now belong to the importer */
+					task_p -> it_relations.ga_size = 0;
+					task_p -> it_members.ga_size = 0;
+					task_p -> it_ways.ga_size = 0;
+					task_p -> it_refs.ga_size = 0;
+				}
+			else
+				{
+					fprintf (stderr, "Failed to gather the results\n");
+					return false;
+				}
+		}
+
+	if (pass == IP_RELATIONS)
+		{
+			importer_p -> im_way_ids_p = GetSortedIds (&(((const RelationMember *) importer_p -> im_members.ga_items_p) -> rm_way_id), sizeof (RelationMember), importer_p -> im_members.ga_size, & (importer_p -> im_num_way_ids));
+
+			printf ("Found " SIZET_FMT " regions using " SIZET_FMT " ways\n", importer_p -> im_relations.ga_size, importer_p -> im_num_way_ids);
+
+			return (importer_p -> im_way_ids_p || (importer_p -> im_num_way_ids == 0));
+		}
+	else
+		{
+			if (importer_p -> im_ways.ga_size > 0)
+				{
+					qsort (importer_p -> im_ways.ga_items_p, importer_p -> im_ways.ga_size, sizeof (WayRecord), CompareWayRecords);
+				}
+
+			importer_p -> im_node_ids_p = GetSortedIds ((const int64 *) importer_p -> im_refs.ga_items_p, sizeof (int64), importer_p -> im_refs.ga_size, & (importer_p -> im_num_node_ids));
+
+			printf ("Found " SIZET_FMT " ways using " SIZET_FMT " nodes\n", importer_p -> im_ways.ga_size, importer_p -> im_num_node_ids);
+
+			if (importer_p -> im_num_node_ids > 0)
+				{
+					if (importer_p -> im_node_ids_p)
+						{
+							importer_p -> im_node_coords_p = (FixedCoordinate *) AllocMemoryArray (importer_p -> im_num_node_ids, sizeof (FixedCoordinate));
+							importer_p -> im_node_found_p = (uint8 *) AllocMemoryArray (importer_p -> im_num_node_ids, sizeof (uint8));
+
+							return ((importer_p -> im_node_coords_p) && (importer_p -> im_node_found_p));
+						}
+
+					return false;
+				}
+
+			return true;
+		}
+}
+
+
+static int64 *GetSortedIds (const int64 *ids_p, const size_t stride, const size_t num_ids, size_t *num_unique_ids_p)
+{
+	int64 *sorted_ids_p = NULL;
+
+	*num_unique_ids_p = 0;
+
+	if (num_ids > 0)
+		{
+			sorted_ids_p = (int64 *) AllocMemoryArray (num_ids, sizeof (int64));
+
+			if (sorted_ids_p)
+				{
+					const uint8 *id_p = (const uint8 *) ids_p;
+					size_t num_unique_ids = 0;
+					size_t i;
+
+					for (i = 0; i < num_ids; ++ i, id_p += stride)
+						{
+							memcpy (sorted_ids_p + i, id_p, sizeof (int64));
+						}
+
+					qsort (sorted_ids_p, num_ids, sizeof (int64), CompareIds);
+
+					for (i = 0; i < num_ids; ++ i)
+						{
+							if ((num_unique_ids == 0) || (sorted_ids_p [num_unique_ids - 1] != sorted_ids_p [i]))
+								{
+									sorted_ids_p [num_unique_ids ++] = sorted_ids_p [i];
+								}
+						}
+
+					*num_unique_ids_p = num_unique_ids;
+				}
+		}
+
+	return sorted_ids_p;
+}
+
+
+/*
+ * The ids within each block are usually in order, so rather than a
+ * binary search over all of the ids, gallop forward from where the
+ * previous one was found.
+ */
+static size_t FindId (const int64 *ids_p, const size_t num_ids, const int64 id, size_t *cursor_p)
+{
+	size_t low = *cursor_p;
+	size_t high;
+	size_t step = 1;
+
+	if ((low >= num_ids) || (ids_p [low] > id))
+		{
+			low = 0;
+		}
+
+	high = low;
+
+	while ((high < num_ids) && (ids_p [high] < id))
+		{
+			low = high;
+			high += step;
+			step <<= 1;
+		}
+
+	if (high > num_ids)
+		{
+			high = num_ids;
+		}
+
+	/* ids_p [low] < id <= ids_p [high] if it is there */
+	while (low < high)
+		{
+			const size_t mid = low + ((high - low) >> 1);
+
+			if (ids_p [mid] < id)
+				{
+					low = mid + 1;
+				}
+			else
+				{
+					high = mid;
+				}
+		}
+
+	*cursor_p = low;
+
+	return ((low < num_ids) && (ids_p [low] == id)) ? low : num_ids;
+}
+
+
+static bool AssembleRegions (Importer *importer_p, GrowableArray *regions_p, GrowableArray *ring_lengths_p, GrowableArray *points_p)
+{
+	const RegionRelation *relation_p = (const RegionRelation *) importer_p -> im_relations.ga_items_p;
+	GrowableArray segments;
+	GrowableArray ends;
+	GrowableArray ring;
+	GrowableArray first_rings;
+	bool success_flag = true;
+	size_t i;
+
+	InitGrowableArray (&segments, sizeof (RingSegment));
+	InitGrowableArray (&ends, sizeof (SegmentEnd));
+	InitGrowableArray (&ring, sizeof (int64));
+	InitGrowableArray (&first_rings, sizeof (size_t));
+
+	for (i = 0; (i < importer_p -> im_relations.ga_size) && success_flag; ++ i, ++ relation_p)
+		{
+			const size_t first_ring = ring_lengths_p -> ga_size;
+			uint32 num_rings = 0;
+
+			success_flag = AssembleRings (importer_p, relation_p, false, &segments, &ends, &ring, ring_lengths_p, points_p, &num_rings);
+
+			/* Holes are only worth having if there's something for them to be holes in */
+			if (success_flag && (num_rings > 0))
+				{
+					success_flag = AssembleRings (importer_p, relation_p, true, &segments, &ends, &ring, ring_lengths_p, points_p, &num_rings);
+
+					if (success_flag)
+						{
+							AdminRegionData *region_p = (AdminRegionData *) AddToGrowableArray (regions_p, 1);
+							size_t *first_ring_p = (size_t *) AddToGrowableArray (&first_rings, 1);
+
+							if (region_p && first_ring_p)
+								{
+									region_p -> ard_name_s = relation_p -> rr_name_s;
+									region_p -> ard_country_code_s = ((relation_p -> rr_level == 2) && (* (relation_p -> rr_country_code_s) != '\0')) ? relation_p -> rr_country_code_s : NULL;
+									region_p -> ard_level = relation_p -> rr_level;
+									region_p -> ard_points_p = NULL;
+									region_p -> ard_ring_lengths_p = NULL;
+									region_p -> ard_num_rings = num_rings;
+
+									*first_ring_p = first_ring;
+								}
+							else
+								{
+									success_flag = false;
+								}
+						}
+				}
+		}
+
+	/* Now that the arrays won't move, point each region at its rings and points */
+	if (success_flag)
+		{
+			AdminRegionData *region_p = (AdminRegionData *) regions_p -> ga_items_p;
+			const size_t *first_ring_p = (const size_t *) first_rings.ga_items_p;
+			const uint32 *ring_lengths_data_p = (const uint32 *) ring_lengths_p -> ga_items_p;
+			const FixedCoordinate *point_p = (const FixedCoordinate *) points_p -> ga_items_p;
+			size_t ring_index = 0;
+
+			for (i = 0; i < regions_p -> ga_size; ++ i, ++ region_p, ++ first_ring_p)
+				{
+					/* Move past the points of the rings before this region's first one */
+					while (ring_index < *first_ring_p)
+						{
+							point_p += ring_lengths_data_p [ring_index ++];
+						}
+
+					region_p -> ard_points_p = point_p;
+					region_p -> ard_ring_lengths_p = ring_lengths_data_p + ring_index;
+				}
+		}
+
+	ClearGrowableArray (&first_rings);
+	ClearGrowableArray (&ring);
+	ClearGrowableArray (&ends);
+	ClearGrowableArray (&segments);
+
+	return success_flag;
+}
+
+
+/*
+ * Join the outer or inner ways of a region into closed rings, matching
+ * up their ends in either direction. Any ways that can't be closed, or
+ * that have missing nodes, are dropped.
+ */
+static bool AssembleRings (Importer *importer_p, const RegionRelation *relation_p, const bool inner_flag, GrowableArray *segments_p, GrowableArray *ends_p, GrowableArray *ring_p, GrowableArray *ring_lengths_p, GrowableArray *points_p, uint32 *num_rings_p)
+{
+	const RelationMember *member_p = ((const RelationMember *) importer_p -> im_members.ga_items_p) + relation_p -> rr_first_member;
+	const WayRecord *ways_p = (const WayRecord *) importer_p -> im_ways.ga_items_p;
+	const int64 *refs_p = (const int64 *) importer_p -> im_refs.ga_items_p;
+	RingSegment *segments_data_p;
+	SegmentEnd *ends_data_p;
+	size_t i;
+
+	segments_p -> ga_size = 0;
+	ends_p -> ga_size = 0;
+
+	for (i = 0; i < relation_p -> rr_num_members; ++ i, ++ member_p)
+		{
+			if (member_p -> rm_inner_flag == inner_flag)
+				{
+					WayRecord key;
+					const WayRecord *way_p;
+
+					key.wr_id = member_p -> rm_way_id;
+					way_p = (const WayRecord *) bsearch (&key, ways_p, importer_p -> im_ways.ga_size, sizeof (WayRecord), CompareWayRecords);
+
+					if (way_p && (way_p -> wr_num_refs >= 2))
+						{
+							RingSegment *segment_p = (RingSegment *) AddToGrowableArray (segments_p, 1);
+
+							if (segment_p)
+								{
+									segment_p -> rs_refs_p = refs_p + way_p -> wr_first_ref;
+									segment_p -> rs_num_refs = way_p -> wr_num_refs;
+									segment_p -> rs_used_flag = false;
+								}
+							else
+								{
+									return false;
+								}
+						}
+				}
+		}
+
+	segments_data_p = (RingSegment *) segments_p -> ga_items_p;
+
+	for (i = 0; i < segments_p -> ga_size; ++ i)
+		{
+			const RingSegment *segment_p = segments_data_p + i;
+			SegmentEnd *end_p = (SegmentEnd *) AddToGrowableArray (ends_p, 2);
+
+			if (end_p)
+				{
+					end_p -> se_node_id = segment_p -> rs_refs_p [0];
+					end_p -> se_segment = i;
+
+					++ end_p;
+					end_p -> se_node_id = segment_p -> rs_refs_p [segment_p -> rs_num_refs - 1];
+					end_p -> se_segment = i;
+				}
+			else
+				{
+					return false;
+				}
+		}
+
+	ends_data_p = (SegmentEnd *) ends_p -> ga_items_p;
+
+	if (ends_p -> ga_size > 0)
+		{
+			qsort (ends_data_p, ends_p -> ga_size, sizeof (SegmentEnd), CompareSegmentEnds);
+		}
+
+	for (i = 0; i < segments_p -> ga_size; ++ i)
+		{
+			RingSegment *segment_p = segments_data_p + i;
+
+			if (! (segment_p -> rs_used_flag))
+				{
+					int64 *ids_p;
+					bool closed_flag = false;
+					bool open_flag = true;
+
+					ring_p -> ga_size = 0;
+					ids_p = (int64 *) AddToGrowableArray (ring_p, segment_p -> rs_num_refs);
+
+					if (!ids_p)
+						{
+							return false;
+						}
+
+					memcpy (ids_p, segment_p -> rs_refs_p, segment_p -> rs_num_refs * sizeof (int64));
+					segment_p -> rs_used_flag = true;
+
+					while (open_flag)
+						{
+							const int64 *ring_ids_p = (const int64 *) ring_p -> ga_items_p;
+							const int64 last_id = ring_ids_p [ring_p -> ga_size - 1];
+
+							if (last_id == ring_ids_p [0])
+								{
+									closed_flag = true;
+									open_flag = false;
+								}
+							else
+								{
+									SegmentEnd key;
+									const SegmentEnd *end_p;
+									const SegmentEnd *ends_end_p = ends_data_p + ends_p -> ga_size;
+									RingSegment *next_p = NULL;
+
+									key.se_node_id = last_id;
+									key.se_segment = 0;
+
+									/* Find the first end at this node and then look for one on a segment that's still free */
+									end_p = (const SegmentEnd *) bsearch (&key, ends_data_p, ends_p -> ga_size, sizeof (SegmentEnd), CompareSegmentEnds);
+
+									if (end_p)
+										{
+											while ((end_p > ends_data_p) && ((end_p - 1) -> se_node_id == last_id))
+												{
+													-- end_p;
+												}
+
+											while ((end_p < ends_end_p) && (end_p -> se_node_id == last_id) && (!next_p))
+												{
+													if (! (segments_data_p [end_p -> se_segment].rs_used_flag))
+														{
+															next_p = segments_data_p + end_p -> se_segment;
+														}
+
+													++ end_p;
+												}
+										}
+
+									if (next_p)
+										{
+											const size_t num_new_ids = next_p -> rs_num_refs - 1;
+
+											if ((ids_p = (int64 *) AddToGrowableArray (ring_p, num_new_ids)) != NULL)
+												{
+													size_t j;
+
+													/* Skip the shared node, going backwards if the segment ends here */
+													if (next_p -> rs_refs_p [0] == last_id)
+														{
+															memcpy (ids_p, next_p -> rs_refs_p + 1, num_new_ids * sizeof (int64));
+														}
+													else
+														{
+															for (j = 0; j < num_new_ids; ++ j)
+																{
+																	ids_p [j] = next_p -> rs_refs_p [num_new_ids - 1 - j];
+																}
+														}
+
+													next_p -> rs_used_flag = true;
+												}
+											else
+												{
+													return false;
+												}
+										}
+									else
+										{
+											open_flag = false;
+										}
+								}
+						}
+
+					if (closed_flag && (ring_p -> ga_size >= 4))
+						{
+							const size_t num_rings = ring_lengths_p -> ga_size;
+
+							if (!AddRing (importer_p, ring_p, ring_lengths_p, points_p))
+								{
+									return false;
+								}
+
+							if (ring_lengths_p -> ga_size > num_rings)
+								{
+									++ *num_rings_p;
+								}
+						}
+				}
+		}
+
+	return true;
+}
+
+
+static bool AddRing (Importer *importer_p, const GrowableArray *ring_p, GrowableArray *ring_lengths_p, GrowableArray *points_p)
+{
+	const int64 *ids_p = (const int64 *) ring_p -> ga_items_p;
+	const size_t num_points = ring_p -> ga_size;
+	FixedCoordinate *ring_points_p = (FixedCoordinate *) AddToGrowableArray (points_p, num_points);
+	size_t cursor = 0;
+	size_t i;
+
+	if (!ring_points_p)
+		{
+			return false;
+		}
+
+	for (i = 0; i < num_points; ++ i)
+		{
+			const size_t j = FindId (importer_p -> im_node_ids_p, importer_p -> im_num_node_ids, ids_p [i], &cursor);
+
+			if ((j < importer_p -> im_num_node_ids) && (importer_p -> im_node_found_p [j]))
+				{
+					ring_points_p [i] = importer_p -> im_node_coords_p [j];
+				}
+			else
+				{
+					/* The extract doesn't have all of the ring's nodes, so leave it out */
+					points_p -> ga_size -= num_points;
+					return true;
+				}
+		}
+
+	if (importer_p -> im_tolerance > 0.0)
+		{
+			const size_t num_kept_points = SimplifyRing (ring_points_p, num_points, importer_p -> im_tolerance);
+
+			if (num_kept_points == 0)
+				{
+					return false;
+				}
+
+			points_p -> ga_size -= num_points - num_kept_points;
+			i = num_kept_points;
+		}
+
+	{
+		uint32 *length_p = (uint32 *) AddToGrowableArray (ring_lengths_p, 1);
+
+		if (length_p)
+			{
+				*length_p = (uint32) i;
+				return true;
+			}
+	}
+
+	return false;
+}
+
+
+/*
+ * Simplify a closed ring in place with the Douglas-Peucker algorithm,
+ * using an explicit stack so that long rings don't overflow the call
+ * stack. The points are projected onto a plane using the ring's middle
+ * latitude, which is close enough for the tolerances used. If too few
+ * points would be left to make a ring, it is left unchanged.
+ *
+ * Returns the number of points left, or 0 if the memory couldn't be
+ * allocated.
+ */
+static size_t SimplifyRing (FixedCoordinate *points_p, const size_t num_points, const double64 tolerance)
+{
+	size_t num_kept_points = num_points;
+	uint8 *keep_p = (uint8 *) AllocMemoryArray (num_points, sizeof (uint8));
+	size_t *stack_p = (size_t *) AllocMemoryArray (2 * num_points, sizeof (size_t));
+	double64 *xs_p = (double64 *) AllocMemoryArray (2 * num_points, sizeof (double64));
+
+	if (keep_p && stack_p && xs_p)
+		{
+			double64 *ys_p = xs_p + num_points;
+			int32 south = points_p [0].fc_latitude;
+			int32 north = south;
+			double64 x_scale;
+			size_t stack_size = 0;
+			size_t i;
+
+			for (i = 1; i < num_points; ++ i)
+				{
+					if (points_p [i].fc_latitude < south)
+						{
+							south = points_p [i].fc_latitude;
+						}
+					else if (points_p [i].fc_latitude > north)
+						{
+							north = points_p [i].fc_latitude;
+						}
+				}
+
+			x_scale = cos ((((double64) south + (double64) north) / (2.0 * FIXED_COORDINATE_SCALE)) * ARI_DEGREES_TO_RADIANS) * ARI_METRES_PER_DEGREE / FIXED_COORDINATE_SCALE;
+
+			for (i = 0; i < num_points; ++ i)
+				{
+					xs_p [i] = points_p [i].fc_longitude * x_scale;
+					ys_p [i] = points_p [i].fc_latitude * (ARI_METRES_PER_DEGREE / FIXED_COORDINATE_SCALE);
+				}
+
+			keep_p [0] = 1;
+			keep_p [num_points - 1] = 1;
+			num_kept_points = 2;
+
+			stack_p [stack_size ++] = 0;
+			stack_p [stack_size ++] = num_points - 1;
+
+			/*
+			 * The ring starts and ends at the same point, so the first split
+			 * is at the point furthest from it.
+			 */
+			while (stack_size > 0)
+				{
+					const size_t end = stack_p [-- stack_size];
+					const size_t start = stack_p [-- stack_size];
+					double64 max_distance = 0.0;
+					size_t furthest = start;
+
+					for (i = start + 1; i < end; ++ i)
+						{
+							const double64 distance = GetDistanceToSegment (xs_p [i], ys_p [i], xs_p [start], ys_p [start], xs_p [end], ys_p [end]);
+
+							if (distance > max_distance)
+								{
+									max_distance = distance;
+									furthest = i;
+								}
+						}
+
+					if (max_distance > tolerance)
+						{
+							keep_p [furthest] = 1;
+							++ num_kept_points;
+
+							if (furthest - start > 1)
+								{
+									stack_p [stack_size ++] = start;
+									stack_p [stack_size ++] = furthest;
+								}
+
+							if (end - furthest > 1)
+								{
+									stack_p [stack_size ++] = furthest;
+									stack_p [stack_size ++] = end;
+								}
+						}
+				}
+
+			if (num_kept_points >= 4)
+				{
+					size_t j = 0;
+
+					for (i = 0; i < num_points; ++ i)
+						{
+							if (keep_p [i])
+								{
+									points_p [j ++] = points_p [i];
+								}
+						}
+				}
+			else
+				{
+					num_kept_points = num_points;
+				}
+		}
+	else
+		{
+			num_kept_points = 0;
+		}
+
+	if (xs_p)
+		{
+			FreeMemory (xs_p);
+		}
+
+	if (stack_p)
+		{
+			FreeMemory (stack_p);
+		}
+
+	if (keep_p)
+		{
+			FreeMemory (keep_p);
+		}
+
+	return num_kept_points;
+}
+
+
+static double64 GetDistanceToSegment (const double64 x, const double64 y, const double64 x0, const double64 y0, const double64 x1, const double64 y1)
+{
+	const double64 dx = x1 - x0;
+	const double64 dy = y1 - y0;
+	const double64 length_squared = dx * dx + dy * dy;
+	double64 t = 0.0;
+
+	if (length_squared > 0.0)
+		{
+			t = ((x - x0) * dx + (y - y0) * dy) / length_squared;
+
+			if (t < 0.0)
+				{
+					t = 0.0;
+				}
+			else if (t > 1.0)
+				{
+					t = 1.0;
+				}
+		}
+
+	return hypot (x - (x0 + t * dx), y - (y0 + t * dy));
+}
+
+
+static bool ReadVarint (PBFReader *reader_p, uint64 *value_p)
+{
+	uint64 value = 0;
+	uint32 shift = 0;
+
+	while ((reader_p -> pr_data_p < reader_p -> pr_end_p) && (shift < 64))
+		{
+			const uint8 b = * (reader_p -> pr_data_p ++);
+
+			value |= ((uint64) (b & 0x7F)) << shift;
+
+			if ((b & 0x80) == 0)
+				{
+					*value_p = value;
+					return true;
+				}
+
+			shift += 7;
+		}
+
+	return false;
+}
+
+
+static bool ReadKey (PBFReader *reader_p, uint32 *field_p, uint32 *wire_type_p)
+{
+	uint64 key;
+
+	if (ReadVarint (reader_p, &key))
+		{
+			*field_p = (uint32) (key >> 3);
+			*wire_type_p = (uint32) (key & 0x7);
+
+			return true;
+		}
+
+	return false;
+}
+
+
+static bool ReadLengthDelimited (PBFReader *reader_p, PBFReader *value_p)
+{
+	uint64 length;
+
+	if (ReadVarint (reader_p, &length) && (length <= (uint64) (reader_p -> pr_end_p - reader_p -> pr_data_p)))
+		{
+			value_p -> pr_data_p = reader_p -> pr_data_p;
+			value_p -> pr_end_p = reader_p -> pr_data_p + length;
+			reader_p -> pr_data_p = value_p -> pr_end_p;
+
+			return true;
+		}
+
+	return false;
+}
+
+
+static bool SkipValue (PBFReader *reader_p, const uint32 wire_type)
+{
+	const size_t remaining = (size_t) (reader_p -> pr_end_p - reader_p -> pr_data_p);
+	uint64 value;
+	PBFReader skipped;
+
+	switch (wire_type)
+		{
+			case ARI_WIRE_VARINT:
+				return ReadVarint (reader_p, &value);
+
+			case ARI_WIRE_64_BIT:
+				if (remaining >= 8)
+					{
+						reader_p -> pr_data_p += 8;
+						return true;
+					}
+				break;
+
+			case ARI_WIRE_LENGTH:
+				return ReadLengthDelimited (reader_p, &skipped);
+
+			case ARI_WIRE_32_BIT:
+				if (remaining >= 4)
+					{
+						reader_p -> pr_data_p += 4;
+						return true;
+					}
+				break;
+
+			default:
+				break;
+		}
+
+	return false;
+}
+
+
+static int64 DecodeZigZag (const uint64 value)
+{
+	return (int64) (value >> 1) ^ - (int64) (value & 1);
+}
+
+
+static bool IsPBFString (const PBFString *string_p, const char *value_s)
+{
+	const size_t length = strlen (value_s);
+
+	return ((string_p -> ps_length == length) && (memcmp (string_p -> ps_value_s, value_s, length) == 0));
+}
+
+
+static const PBFString *GetBlockString (const ImportTask *task_p, const uint64 index)
+{
+	return (index < task_p -> it_strings.ga_size) ? ((const PBFString *) task_p -> it_strings.ga_items_p) + index : NULL;
+}
+
+
+static void InitGrowableArray (GrowableArray *array_p, const size_t item_size)
+{
+	array_p -> ga_items_p = NULL;
+	array_p -> ga_size = 0;
+	array_p -> ga_capacity = 0;
+	array_p -> ga_item_size = item_size;
+}
+
+
+/* Add space for num_items to the end of an array and return the first of them */
+static void *AddToGrowableArray (GrowableArray *array_p, const size_t num_items)
+{
+	const size_t new_size = array_p -> ga_size + num_items;
+
+	if (new_size > array_p -> ga_capacity)
+		{
+			size_t new_capacity = (array_p -> ga_capacity > 0) ? (array_p -> ga_capacity << 1) : 64;
+			void *items_p;
+
+			if (new_capacity < new_size)
+				{
+					new_capacity = new_size;
+				}
+
+			items_p = ReallocMemory (array_p -> ga_items_p, new_capacity * array_p -> ga_item_size, array_p -> ga_capacity * array_p -> ga_item_size);
+
+			if (!items_p)
+				{
+					return NULL;
+				}
+
+			array_p -> ga_items_p = items_p;
+			array_p -> ga_capacity = new_capacity;
+		}
+
+	array_p -> ga_size = new_size;
+
+	return ((uint8 *) array_p -> ga_items_p) + ((new_size - num_items) * array_p -> ga_item_size);
+}
+
+
+static void ClearGrowableArray (GrowableArray *array_p)
+{
+	if (array_p -> ga_items_p)
+		{
+			FreeMemory (array_p -> ga_items_p);
+		}
+
+	InitGrowableArray (array_p, array_p -> ga_item_size);
+}
+
+
+static int CompareIds (const void *v0_p, const void *v1_p)
+{
+	const int64 id0 = * ((const int64 *) v0_p);
+	const int64 id1 = * ((const int64 *) v1_p);
+
+	return (id0 < id1) ? -1 : ((id0 > id1) ? 1 : 0);
+}
+
+
+static int CompareWayRecords (const void *v0_p, const void *v1_p)
+{
+	return CompareIds (& (((const WayRecord *) v0_p) -> wr_id), & (((const WayRecord *) v1_p) -> wr_id));
+}
+
+
+static int CompareSegmentEnds (const void *v0_p, const void *v1_p)
+{
+	return CompareIds (& (((const SegmentEnd *) v0_p) -> se_node_id), & (((const SegmentEnd *) v1_p) -> se_node_id));
+}
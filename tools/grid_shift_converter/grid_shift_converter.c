@@ -0,0 +1,175 @@
+/*
+** Copyright 2026 The Earlham Institute
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+/*
+ * grid_shift_converter.c
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: agent
+ *
+ * Convert the Ordnance Survey's OSTN15 data file into a GridShiftTable.
+ *
+ *   grid_shift_converter <OSTN15_OSGM15_DataFile.txt> <out.gggs>
+ *
+ * The data file is a CSV file with a header line followed by lines of
+ *
+ *   Point_ID,ETRS89_Easting,ETRS89_Northing,ETRS89_OSGB36_EShift,ETRS89_OSGB36_NShift,ETRS89_ODN_HeightShift,Height_Datum_Flag
+ *
+ * for a 1 kilometre grid of points.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "os_grid.h"
+
+#include "memory_allocations.h"
+
+
+#define GSC_NUM_COLUMNS (701)
+#define GSC_NUM_ROWS (1251)
+#define GSC_SPACING (1000)
+
+
+static int ConvertDataFile (const char *in_s, const char *out_s);
+
+static bool ParseDataLine (char *line_s, int32 *shifts_p, uint32 *num_points_p);
+
+
+
+int main (int argc, char *argv [])
+{
+	if (argc == 3)
+		{
+			return ConvertDataFile (argv [1], argv [2]);
+		}
+
+	fprintf (stderr, "Usage:\n");
+	fprintf (stderr, "  %s <OSTN15_OSGM15_DataFile.txt> <out.gggs>\n", argv [0]);
+
+	return 1;
+}
+
+
+static int ConvertDataFile (const char *in_s, const char *out_s)
+{
+	int res = 1;
+	FILE *in_f = fopen (in_s, "r");
+
+	if (in_f)
+		{
+			const size_t num_values = 2 * (size_t) GSC_NUM_COLUMNS * (size_t) GSC_NUM_ROWS;
+			int32 *shifts_p = (int32 *) AllocMemory (num_values * sizeof (int32));
+
+			if (shifts_p)
+				{
+					char line [256];
+					bool success_flag = true;
+					uint32 num_points = 0;
+					uint32 line_number = 1;
+					size_t i;
+
+					for (i = 0; i < num_values; ++ i)
+						{
+							* (shifts_p + i) = OS_GRID_NO_SHIFT;
+						}
+
+					/* skip the header */
+					if (!fgets (line, sizeof (line), in_f))
+						{
+							success_flag = false;
+						}
+
+					while (success_flag && fgets (line, sizeof (line), in_f))
+						{
+							++ line_number;
+
+							if ((*line != '\0') && (*line != '\n') && (*line != '\r'))
+								{
+									if (!ParseDataLine (line, shifts_p, &num_points))
+										{
+											fprintf (stderr, "Invalid data at line " UINT32_FMT " of \"%s\"\n", line_number, in_s);
+											success_flag = false;
+										}
+								}
+						}
+
+					if (success_flag && (num_points > 0) && SaveGridShiftTable (out_s, GSC_NUM_COLUMNS, GSC_NUM_ROWS, GSC_SPACING, shifts_p))
+						{
+							printf ("Converted " UINT32_FMT " points from \"%s\" to \"%s\"\n", num_points, in_s, out_s);
+							res = 0;
+						}
+					else
+						{
+							fprintf (stderr, "Failed to convert \"%s\" to \"%s\"\n", in_s, out_s);
+						}
+
+					FreeMemory (shifts_p);
+				}
+
+			fclose (in_f);
+		}
+	else
+		{
+			fprintf (stderr, "Failed to open \"%s\"\n", in_s);
+		}
+
+	return res;
+}
+
+
+static bool ParseDataLine (char *line_s, int32 *shifts_p, uint32 *num_points_p)
+{
+	double64 values [5];
+	char *value_s = line_s;
+	uint32 i;
+
+	for (i = 0; i < 5; ++ i)
+		{
+			char *end_s;
+
+			values [i] = strtod (value_s, &end_s);
+
+			if ((end_s == value_s) || ((*end_s != ',') && (i < 4)))
+				{
+					return false;
+				}
+
+			value_s = end_s + 1;
+		}
+
+	/* The points are on whole kilometres, so rounding gets the exact row and column */
+	{
+		const long column = lround (values [1] / GSC_SPACING);
+		const long row = lround (values [2] / GSC_SPACING);
+
+		if ((column >= 0) && (column < GSC_NUM_COLUMNS) && (row >= 0) && (row < GSC_NUM_ROWS))
+			{
+				int32 *shift_p = shifts_p + (2 * ((size_t) row * GSC_NUM_COLUMNS + (size_t) column));
+
+				/* The shifts are in metres with millimetre precision */
+				*shift_p = (int32) lround (values [3] * 1000.0);
+				* (shift_p + 1) = (int32) lround (values [4] * 1000.0);
+
+				++ *num_points_p;
+
+				return true;
+			}
+	}
+
+	return false;
+}